@@ -0,0 +1,821 @@
+// Microbenchmarks for the closed loop's hottest code. Self-contained so it
+// builds wherever pid_core does: each case is calibrated to --min-time,
+// repeated, and reported as the median ns/op plus instructions and cycles
+// per op from hardware counters when the OS allows it.
+#include "capi/pid.h"
+#include "core/async_logger.h"
+#include "core/batch_engine.h"
+#include "core/collisions.h"
+#include "core/compact_sweep.h"
+#include "core/lane_stepper.h"
+#include "core/monte_carlo.h"
+#include "core/multi_axis.h"
+#include "core/perf_counters.h"
+#include "core/philox.h"
+#include "core/plant.h"
+#include "core/scenario.h"
+#include "core/simulation.h"
+#include "core/thread_pool.h"
+#include "core/trajectory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+template <class T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct Case {
+    const char* name;
+    uint64_t ops_per_iteration;  // e.g. lanes stepped per iteration for batched cases
+    std::function<void(uint64_t iterations)> body;
+};
+
+struct Measurement {
+    double ns_per_op = 0.0;
+    double per_op[PerfCounters::EVENTS] = {};  // hardware events per op, summed over repetitions
+};
+
+double time_iterations(const Case& c, uint64_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    c.body(iterations);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+Measurement measure(const Case& c, double min_time, int repetitions, PerfCounters& counters) {
+    // Grow the iteration count until one run takes long enough to time reliably
+    uint64_t iterations = 1;
+    while (time_iterations(c, iterations) < min_time / repetitions && iterations < (1ull << 40)) {
+        iterations *= 2;
+    }
+
+    std::vector<double> seconds;
+    uint64_t events[PerfCounters::EVENTS] = {};
+    for (int r = 0; r < repetitions; ++r) {
+        counters.start();
+        seconds.push_back(time_iterations(c, iterations));
+        counters.stop();
+        for (int e = 0; e < PerfCounters::EVENTS; ++e) events[e] += counters.count(static_cast<PerfCounters::Event>(e));
+    }
+    std::nth_element(seconds.begin(), seconds.begin() + repetitions / 2, seconds.end());
+
+    double ops = static_cast<double>(iterations) * c.ops_per_iteration;
+    Measurement m;
+    m.ns_per_op = seconds[repetitions / 2] * 1e9 / ops;
+    for (int e = 0; e < PerfCounters::EVENTS; ++e) m.per_op[e] = events[e] / (ops * repetitions);
+    return m;
+}
+
+constexpr std::size_t LANES = 4096;
+constexpr std::size_t SCENE_BALLS = 100000;
+
+std::vector<double> scene_centers(double width) {
+    const double spacing = static_cast<double>(WINDOW_WIDTH) / SCENE_BALLS;
+    std::vector<double> x(SCENE_BALLS);
+    for (std::size_t i = 0; i < SCENE_BALLS; ++i) x[i] = std::min(i * spacing, WINDOW_WIDTH - width) + width / 2;
+    return x;
+}
+
+// The GUI's --scene 100000 --scene-collide, stacked and gained the same
+// way, after two seconds of stepping and colliding
+struct SettledScene {
+    static constexpr double WIDTH = 2.0;  // BallScene's size for this many balls
+
+    BatchEngine engine{SCENE_BALLS};
+    BallCollider collider{scene_centers(WIDTH), WIDTH};
+
+    SettledScene() {
+        const auto levels = static_cast<std::size_t>(std::ceil(WIDTH * SCENE_BALLS / WINDOW_WIDTH));
+        const double gap = std::min(1.5 * WIDTH, static_cast<double>(WINDOW_HEIGHT - BALL_SIZE) / levels);
+        for (std::size_t i = 0; i < SCENE_BALLS; ++i) {
+            engine.set_gains(i, 20.0 + 380.0 * static_cast<double>(i / 16) / (SCENE_BALLS / 16 - 1), 0.0, (i % 16) * 2.5);
+            double level = (static_cast<double>(i % levels) - (levels - 1) / 2.0) * gap;
+            engine.y[i] = WINDOW_HEIGHT / 2.0 + level;
+            engine.set_setpoint(i, WINDOW_HEIGHT / 2.0 + level);
+        }
+        for (int s = 0; s < 120; ++s) {
+            engine.step(FIXED_TIMESTEP);
+            collider.resolve(engine.y.data(), engine.velocity.data(), FIXED_TIMESTEP);
+        }
+    }
+};
+
+// update_physics in a narrower scalar type; names are static so Case can hold them
+template <class T>
+void add_scalar_case(std::vector<Case>& cases) {
+    static const std::string name = std::string("update_physics<") + scalar_name<T>() + ">";
+    cases.push_back({name.c_str(), 1, [](uint64_t n) {
+        BasicSimulation<T> sim;
+        const T dt(FIXED_TIMESTEP);
+        for (uint64_t i = 0; i < n; ++i) {
+            sim.step(dt);
+            do_not_optimize(sim.ball.y);
+        }
+    }});
+}
+
+// The history is recorded once per size and kept for later repetitions
+void decimate_history(std::size_t samples, uint64_t n) {
+    static std::map<std::size_t, std::unique_ptr<TrajectoryHistory>> built;
+    std::unique_ptr<TrajectoryHistory>& history = built[samples];
+    if (!history) {
+        history = std::make_unique<TrajectoryHistory>(samples);
+        Simulation sim;
+        for (std::size_t i = 0; i < samples; ++i) {
+            sim.step(FIXED_TIMESTEP);
+            history->push(sample_of(sim));
+        }
+    }
+    auto raw = [&](uint64_t index, std::size_t series) { return history->value(index, series); };
+    LodPoint points[2 * 300 + 2];
+    for (uint64_t i = 0; i < n; ++i) {
+        std::size_t drawn = history->pyramid().decimate(static_cast<std::size_t>(PlotSeries::Y), history->first(),
+                                                        history->end(), static_cast<double>(samples), 300, raw, points);
+        do_not_optimize(drawn);
+    }
+}
+
+// Every core/plant.h model in a closed loop, stepped through the template
+// (inlined) and through DynamicPlant (one virtual call each for output and step)
+void add_plant_cases(std::vector<Case>& cases) {
+    static std::vector<std::string> names;
+    if (names.empty()) {
+        for (const PlantPreset& p : PLANT_PRESETS) {
+            names.push_back(std::string("plant/") + p.name + "/static");
+            names.push_back(std::string("plant/") + p.name + "/virtual");
+        }
+    }
+    std::size_t n = 0;
+    for (const PlantPreset& p : PLANT_PRESETS) {
+        const PlantPreset* preset = &p;
+        visit_plant(p.name, [&](const auto& model) {
+            using Model = std::decay_t<decltype(model)>;
+            cases.push_back({names[n++].c_str(), 1, [preset](uint64_t iterations) {
+                PlantLoop<Model> loop;
+                loop.pid = PID_Controller(preset->kp, preset->ki, preset->kd);
+                loop.setpoint = preset->setpoint;
+                for (uint64_t i = 0; i < iterations; ++i) {
+                    loop.step(FIXED_TIMESTEP);
+                    do_not_optimize(loop.output);
+                }
+            }});
+        });
+        cases.push_back({names[n++].c_str(), 1, [preset](uint64_t iterations) {
+            DynamicPlantLoop loop{make_dynamic_plant(preset->name)};
+            loop.pid = PID_Controller(preset->kp, preset->ki, preset->kd);
+            loop.setpoint = preset->setpoint;
+            for (uint64_t i = 0; i < iterations; ++i) {
+                loop.step(FIXED_TIMESTEP);
+                do_not_optimize(loop.output);
+            }
+        }});
+    }
+}
+
+struct PrecisionReport {
+    double max_error = 0.0;   // px, against the double trajectory
+    double rms_error = 0.0;
+    double final_y = 0.0;
+};
+
+// Runs the same damped step response in T and in double and compares ball.y
+// every step, so the speed columns above can be weighed against accuracy
+template <class T>
+PrecisionReport compare_precision(uint64_t steps) {
+    Simulation reference;
+    BasicSimulation<T> sim;
+    reference.pid = PID_Controller{300.0, 2.0, 20.0};
+    sim.pid = BasicPID_Controller<T>{T(300.0), T(2.0), T(20.0)};
+    reference.setpoint = 200.0;
+    sim.setpoint = T(200.0);
+    const T dt(FIXED_TIMESTEP);
+
+    PrecisionReport r;
+    double sum_sq = 0.0;
+    for (uint64_t i = 0; i < steps; ++i) {
+        reference.step(FIXED_TIMESTEP);
+        sim.step(dt);
+        double e = std::fabs(static_cast<double>(sim.ball.y) - reference.ball.y);
+        r.max_error = std::max(r.max_error, e);
+        sum_sq += e * e;
+    }
+    r.rms_error = std::sqrt(sum_sq / static_cast<double>(steps));
+    r.final_y = static_cast<double>(sim.ball.y);
+    return r;
+}
+
+template <class T>
+void print_precision(uint64_t steps) {
+    PrecisionReport r = compare_precision<T>(steps);
+    std::printf("%-10s %14.3e %14.3e %14.6f\n", scalar_name<T>(), r.max_error, r.rms_error, r.final_y);
+}
+
+// Step response used to rank the integrators. Gains, start and setpoint keep
+// the ball off the walls and the integral inside its clamp, so the loop stays
+// linear and the fine RK4 run below is effectively the analytic solution.
+Simulation integrator_scenario(Integrator method) {
+    Simulation sim;
+    sim.integrator = method;
+    sim.pid = PID_Controller{300.0, 2.0, 20.0};
+    sim.setpoint = 200.0;
+    // Start with prev_error at the initial error, so the sampled loops get no
+    // first-step derivative kick the continuous reference doesn't have
+    sim.pid.load_state(0.0, sim.setpoint - (sim.ball.y + BALL_SIZE / 2));
+    return sim;
+}
+
+// Edits late in a long timeline, resumed from checkpoints versus rerun from t=0
+void run_checkpoint_report() {
+    constexpr uint64_t horizon = 1'000'000;
+    constexpr uint64_t edits = 20;
+    auto seconds_since = [](std::chrono::steady_clock::time_point t) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+    };
+    auto same = [](const Simulation& a, const Simulation& b) {
+        return a.ball.y == b.ball.y && a.ball.velocity == b.ball.velocity &&
+               a.pid.integral_value() == b.pid.integral_value() && a.pid.last_error() == b.pid.last_error();
+    };
+
+    Simulation initial;
+    initial.pid = PID_Controller(300.0, 2.0, 20.0);
+    // Square-wave setpoint; edit e retunes Kp somewhere in the last 10%
+    auto build = [&](Scenario& sc, uint64_t edit_count) {
+        for (uint64_t s = 6000; s < horizon; s += 6000) sc.set_setpoint(s, s / 6000 % 2 ? 200.0 : 400.0);
+        for (uint64_t e = 0; e < edit_count; ++e) {
+            sc.set_gains(horizon - 1 - (e * 7919 % (horizon / 10)), 300.0 + e, 2.0, 20.0);
+        }
+    };
+
+    Scenario scenario(initial);
+    build(scenario, 0);
+    auto start = std::chrono::steady_clock::now();
+    scenario.run_to(horizon);
+    const double full = seconds_since(start);
+
+    double resumed = 0.0;
+    uint64_t resimulated = 0;
+    for (uint64_t e = 0; e < edits; ++e) {
+        scenario.set_gains(horizon - 1 - (e * 7919 % (horizon / 10)), 300.0 + e, 2.0, 20.0);
+        uint64_t before = scenario.steps_simulated();
+        start = std::chrono::steady_clock::now();
+        scenario.run_to(horizon);
+        resumed += seconds_since(start);
+        resimulated += scenario.steps_simulated() - before;
+    }
+
+    // The same final timeline in one pass with no checkpoint to resume from
+    Scenario scratch(initial, scenario.timestep(), horizon + 1);
+    build(scratch, edits);
+    const bool exact = same(scratch.run_to(horizon), scenario.state());
+
+    // Branch: two what-ifs from the same past
+    Scenario branch = scenario;
+    branch.set_gains(horizon / 2, 150.0, 1.0, 10.0);
+    start = std::chrono::steady_clock::now();
+    branch.run_to(horizon);
+    const double branched = seconds_since(start);
+
+    std::printf("timeline     %llu steps, %zu checkpoints every %d steps\n",
+                static_cast<unsigned long long>(horizon), scenario.checkpoints(), 600);
+    std::printf("full run     %.3f ms\n", full * 1e3);
+    std::printf("edit+rerun   %.3f ms avg over %llu late edits, %.0f steps each (%.0fx faster)\n",
+                resumed / edits * 1e3, static_cast<unsigned long long>(edits),
+                static_cast<double>(resimulated) / edits, full / (resumed / edits));
+    std::printf("branch       %.3f ms for an edit at the midpoint\n", branched * 1e3);
+    std::printf("reference    %s\n", exact ? "bit-exact" : "MISMATCH");
+}
+
+void run_integrator_report() {
+    constexpr double horizon = 6.0;
+    constexpr int ref_per_second = 60000;  // every dt below divides into this grid
+    std::vector<double> ref(static_cast<std::size_t>(horizon * ref_per_second) + 1);
+    {
+        Simulation sim = integrator_scenario(Integrator::Rk4);
+        ref[0] = sim.ball.y;
+        for (std::size_t i = 1; i < ref.size(); ++i) {
+            sim.step(1.0 / ref_per_second);
+            ref[i] = sim.ball.y;
+        }
+    }
+
+    std::printf("integrator error over %.0f s, step response kp=300 ki=2 kd=20, 400 -> 200 px\n", horizon);
+    std::printf("  continuous: max |y - y_ref| against RK4 at dt = 1/%d\n", ref_per_second);
+    std::printf("  sampled:    max |y - y_zoh| against the same sampled controller with an exact plant\n");
+    std::printf("%-8s %8s %8s %14s %14s %10s %12s\n",
+                "method", "dt", "steps", "continuous px", "sampled px", "ns/step", "us/horizon");
+
+    const int rates[] = {600, 240, 120, 60, 30, 12, 6};
+    for (Integrator method : {Integrator::SemiImplicitEuler, Integrator::ExactZoh, Integrator::Rk4}) {
+        for (int rate : rates) {
+            const double dt = 1.0 / rate;
+            const uint64_t steps = static_cast<uint64_t>(horizon * rate);
+            const std::size_t stride = ref_per_second / rate;
+            Simulation sim = integrator_scenario(method);
+            Simulation sampled = integrator_scenario(Integrator::ExactZoh);
+            double continuous_err = 0.0, sampled_err = 0.0;
+            for (uint64_t i = 1; i <= steps; ++i) {
+                sim.step(dt);
+                sampled.step(dt);
+                continuous_err = std::max(continuous_err, std::fabs(sim.ball.y - ref[i * stride]));
+                sampled_err = std::max(sampled_err, std::fabs(sim.ball.y - sampled.ball.y));
+            }
+
+            // Cost per step from a longer timed run of the same loop
+            Simulation timed = integrator_scenario(method);
+            const uint64_t timed_steps = 2'000'000;
+            RunStats stats = run_headless(timed, timed_steps, dt);
+            do_not_optimize(timed.ball.y);
+
+            std::printf("%-8s %8s %8llu %14.3e %14.3e %10.2f %12.2f\n", integrator_name(method),
+                        ("1/" + std::to_string(rate)).c_str(), static_cast<unsigned long long>(steps),
+                        continuous_err, sampled_err, stats.ns_per_step(), stats.ns_per_step() * steps / 1e3);
+        }
+    }
+}
+
+void run_precision_report(uint64_t steps) {
+    std::printf("precision vs double over %llu steps (kp=300 ki=2 kd=20, setpoint 200)\n",
+                static_cast<unsigned long long>(steps));
+    std::printf("%-10s %14s %14s %14s\n", "scalar", "max |dy| px", "rms |dy| px", "final y");
+    print_precision<double>(steps);
+    print_precision<float>(steps);
+    print_precision<q16_16>(steps);
+#ifdef PID_HAVE_Q32_31
+    print_precision<q32_31>(steps);
+#endif
+}
+
+std::vector<Case> make_cases() {
+    std::vector<Case> cases;
+
+    cases.push_back({"PID_Controller::calculate", 1, [](uint64_t n) {
+        PID_Controller pid{80.0, 2.0, 10.0};
+        for (uint64_t i = 0; i < n; ++i) {
+            double out = pid.calculate(WINDOW_HEIGHT / 2.0, 380.0 + static_cast<double>(i & 63), FIXED_TIMESTEP);
+            do_not_optimize(out);
+        }
+    }});
+
+    // Compile-time structures against the generic controller with zero gains
+    cases.push_back({"PID_Controller::calculate/P", 1, [](uint64_t n) {
+        PID_Controller pid{80.0, 0.0, 0.0};
+        for (uint64_t i = 0; i < n; ++i) {
+            double out = pid.calculate(WINDOW_HEIGHT / 2.0, 380.0 + static_cast<double>(i & 63), FIXED_TIMESTEP);
+            do_not_optimize(out);
+        }
+    }});
+
+    cases.push_back({"P_Controller::calculate", 1, [](uint64_t n) {
+        P_Controller pid{80.0};
+        for (uint64_t i = 0; i < n; ++i) {
+            double out = pid.calculate(WINDOW_HEIGHT / 2.0, 380.0 + static_cast<double>(i & 63));
+            do_not_optimize(out);
+        }
+    }});
+
+    cases.push_back({"PID_Controller::calculate/PD", 1, [](uint64_t n) {
+        PID_Controller pid{80.0, 0.0, 10.0};
+        for (uint64_t i = 0; i < n; ++i) {
+            double out = pid.calculate(WINDOW_HEIGHT / 2.0, 380.0 + static_cast<double>(i & 63), FIXED_TIMESTEP);
+            do_not_optimize(out);
+        }
+    }});
+
+    cases.push_back({"PD_Controller::calculate", 1, [](uint64_t n) {
+        PD_Controller pid{80.0, 0.0, 10.0};
+        for (uint64_t i = 0; i < n; ++i) {
+            double out = pid.calculate(WINDOW_HEIGHT / 2.0, 380.0 + static_cast<double>(i & 63));
+            do_not_optimize(out);
+        }
+    }});
+
+    cases.push_back({"PI_Controller::calculate", 1, [](uint64_t n) {
+        PI_Controller pid{80.0, 2.0};
+        for (uint64_t i = 0; i < n; ++i) {
+            double out = pid.calculate(WINDOW_HEIGHT / 2.0, 380.0 + static_cast<double>(i & 63));
+            do_not_optimize(out);
+        }
+    }});
+
+    // The same controller through libpid's C ABI: a call across the shared
+    // library boundary, plus the state round-trip through pid_state
+    cases.push_back({"capi/pid_step", 1, [](uint64_t n) {
+        pid_state pid;
+        pid_init(&pid, 80.0, 2.0, 20.0);
+        for (uint64_t i = 0; i < n; ++i) {
+            double out = pid_step(&pid, WINDOW_HEIGHT / 2.0, static_cast<double>(i & 255), FIXED_TIMESTEP);
+            do_not_optimize(out);
+        }
+    }});
+
+    cases.push_back({"capi/pid_step_n", LANES, [](uint64_t n) {
+        static std::vector<pid_state> states(LANES);
+        static std::vector<double> setpoints(LANES, WINDOW_HEIGHT / 2.0), pvs(LANES, 0.0), outputs(LANES);
+        for (std::size_t i = 0; i < LANES; ++i) pid_init(&states[i], 80.0 + i % 64, 2.0, 20.0);
+        for (uint64_t i = 0; i < n; ++i) {
+            pid_step_n(states.data(), setpoints.data(), pvs.data(), outputs.data(), LANES, FIXED_TIMESTEP);
+            do_not_optimize(outputs[0]);
+        }
+    }});
+
+    // The default pid{80, 0, 0} loop, generic versus P-only with a constant dt
+    cases.push_back({"closed_loop/generic_P", 1, [](uint64_t n) {
+        Ball ball;
+        PID_Controller pid{80.0, 0.0, 0.0};
+        for (uint64_t i = 0; i < n; ++i) {
+            ball.update(pid.calculate(WINDOW_HEIGHT / 2.0, ball.y + BALL_SIZE / 2, FIXED_TIMESTEP), FIXED_TIMESTEP);
+            do_not_optimize(ball.y);
+        }
+    }});
+
+    cases.push_back({"closed_loop/static_P", 1, [](uint64_t n) {
+        Ball ball;
+        P_Controller pid{80.0};
+        for (uint64_t i = 0; i < n; ++i) {
+            ball.update(pid.calculate(WINDOW_HEIGHT / 2.0, ball.y + BALL_SIZE / 2), FIXED_TIMESTEP);
+            do_not_optimize(ball.y);
+        }
+    }});
+
+    cases.push_back({"Ball::update/free", 1, [](uint64_t n) {
+        Ball ball;
+        for (uint64_t i = 0; i < n; ++i) {
+            ball.update(GRAVITY + static_cast<double>(i & 1), FIXED_TIMESTEP);
+            do_not_optimize(ball.y);
+        }
+    }});
+
+    // Pushed into the floor every step, so apply_boundary_constraints bounces each time
+    cases.push_back({"Ball::update/bounce", 1, [](uint64_t n) {
+        Ball ball;
+        ball.y = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            ball.update(-1e4, FIXED_TIMESTEP);
+            do_not_optimize(ball.y);
+        }
+    }});
+
+    cases.push_back({"update_physics", 1, [](uint64_t n) {
+        Simulation sim;
+        for (uint64_t i = 0; i < n; ++i) {
+            sim.step(FIXED_TIMESTEP);
+            do_not_optimize(sim.ball.y);
+        }
+    }});
+
+    // With an event log attached: the flag snapshot around every step, plus
+    // the events themselves, since this undamped P loop chatters on the
+    // integral clamp every few dozen steps
+    cases.push_back({"update_physics/logged", 1, [](uint64_t n) {
+        AsyncLogger log("/dev/null");
+        Simulation sim;
+        sim.events = &log;
+        for (uint64_t i = 0; i < n; ++i) {
+            sim.step(FIXED_TIMESTEP);
+            do_not_optimize(sim.ball.y);
+        }
+    }});
+
+    // The hot-path cost of one event; a ring the writer has not drained yet
+    // drops it, which costs the same
+    cases.push_back({"AsyncLogger::log", 1, [](uint64_t n) {
+        AsyncLogger log("/dev/null");
+        for (uint64_t i = 0; i < n; ++i) {
+            bool queued = log.log("integral saturated at %g, error %g (t=%g s)", 1000.0, static_cast<double>(i), 0.0);
+            do_not_optimize(queued);
+        }
+    }});
+
+    // Gains rewritten every step, as if handle_keypress fired constantly
+    cases.push_back({"update_physics/varying_gains", 1, [](uint64_t n) {
+        Simulation sim;
+        for (uint64_t i = 0; i < n; ++i) {
+            sim.pid.Kp = 60.0 + static_cast<double>(i & 15) * 5.0;
+            sim.pid.Kd = static_cast<double>(i & 7);
+            sim.step(FIXED_TIMESTEP);
+            do_not_optimize(sim.ball.y);
+        }
+    }});
+
+    // Incremental controller: held output plus a change each step
+    cases.push_back({"update_physics/velocity_form", 1, [](uint64_t n) {
+        Simulation sim;
+        sim.pid.set_form(PidForm::Velocity);
+        for (uint64_t i = 0; i < n; ++i) {
+            sim.step(FIXED_TIMESTEP);
+            do_not_optimize(sim.ball.y);
+        }
+    }});
+
+    // Derivative of the measurement through the first-order filter
+    cases.push_back({"update_physics/filtered_derivative", 1, [](uint64_t n) {
+        Simulation sim;
+        sim.pid.Kd = 20.0;
+        sim.pid.derivative_filter = 0.05;
+        sim.pid.derivative_on_measurement = true;
+        for (uint64_t i = 0; i < n; ++i) {
+            sim.step(FIXED_TIMESTEP);
+            do_not_optimize(sim.ball.y);
+        }
+    }});
+
+    add_scalar_case<float>(cases);
+    add_scalar_case<q16_16>(cases);
+#ifdef PID_HAVE_Q32_31
+    add_scalar_case<q32_31>(cases);
+#endif
+
+    cases.push_back({"batch/scalar_kernel", LANES, [](uint64_t n) {
+        BatchEngine engine(LANES);
+        BatchView v{engine.kp.data(), engine.ki.data(), engine.kd.data(), engine.setpoint.data(),
+                    engine.integral.data(), engine.prev_error.data(), engine.y.data(), engine.velocity.data(), nullptr, nullptr, nullptr};
+        for (uint64_t i = 0; i < n; ++i) {
+            step_lanes_scalar(v, 0, LANES, FIXED_TIMESTEP);
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+
+    cases.push_back({"batch/dispatched_kernel", LANES, [](uint64_t n) {
+        BatchEngine engine(LANES);
+        for (uint64_t i = 0; i < n; ++i) {
+            engine.step(FIXED_TIMESTEP);
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+
+    // A fixed 600-step horizon through run(): one kernel call per step and
+    // block, against the register kernel unrolled 4, 8 and 16 steps
+    auto run_case = [&](const char* name, unsigned unroll) {
+        cases.push_back({name, LANES * 600, [unroll](uint64_t n) {
+            BatchEngine engine(LANES);
+            engine.set_unroll(unroll);
+            for (uint64_t i = 0; i < n; ++i) {
+                engine.run(600, FIXED_TIMESTEP);
+                do_not_optimize(engine.y[0]);
+            }
+        }});
+    };
+    run_case("batch/run_600_per_step", 0);
+    run_case("batch/run_600_unroll1", 1);
+    run_case("batch/run_600_unroll4", 4);
+    run_case("batch/run_600_unroll8", 8);
+    run_case("batch/run_600_unroll16", 16);
+
+    cases.push_back({"batch/velocity_form", LANES, [](uint64_t n) {
+        BatchEngine engine(LANES);
+        engine.set_form(PidForm::Velocity);
+        for (uint64_t i = 0; i < n; ++i) {
+            engine.step(FIXED_TIMESTEP);
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+
+    cases.push_back({"batch/filtered_derivative", LANES, [](uint64_t n) {
+        BatchEngine engine(LANES);
+        engine.set_derivative_filter(0.05, true);
+        for (uint64_t i = 0; i < n; ++i) {
+            engine.step(FIXED_TIMESTEP);
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+
+    cases.push_back({"batch/feed_forward", LANES, [](uint64_t n) {
+        BatchEngine engine(LANES);
+        engine.set_compensation({GRAVITY});
+        for (uint64_t i = 0; i < n; ++i) {
+            engine.step(FIXED_TIMESTEP);
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+
+    cases.push_back({"batch/observer", LANES, [](uint64_t n) {
+        BatchEngine engine(LANES);
+        engine.set_compensation({GRAVITY, true, 0.05});
+        for (uint64_t i = 0; i < n; ++i) {
+            engine.step(FIXED_TIMESTEP);
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+
+    // Every lane a different candidate, as in a sweep
+    cases.push_back({"batch/varying_gains", LANES, [](uint64_t n) {
+        BatchEngine engine(LANES);
+        for (std::size_t i = 0; i < LANES; ++i) {
+            engine.set_gains(i, 20.0 + (i % 64) * 8.0, (i / 64 % 8) * 0.5, (i / 512) * 4.0);
+        }
+        for (uint64_t i = 0; i < n; ++i) {
+            engine.step(FIXED_TIMESTEP);
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+
+    // The float32 layout: twice the lanes per vector, gains as floats or grid indices
+    cases.push_back({"batch/compact_f32", LANES, [](uint64_t n) {
+        SweepConfig grid;
+        grid.kp = {20.0, 400.0, 64};
+        CompactEngine engine(LANES, CompactGains::Float32, grid);
+        for (std::size_t i = 0; i < LANES; ++i) engine.set_cell(i, i % 64, 0, 0);
+        for (uint64_t i = 0; i < n; ++i) {
+            engine.step_range(0, LANES, static_cast<float>(FIXED_TIMESTEP));
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+    cases.push_back({"batch/compact_grid16", LANES, [](uint64_t n) {
+        SweepConfig grid;
+        grid.kp = {20.0, 400.0, 64};
+        CompactEngine engine(LANES, CompactGains::Grid16, grid);
+        for (std::size_t i = 0; i < LANES; ++i) engine.set_cell(i, i % 64, 0, 0);
+        for (uint64_t i = 0; i < n; ++i) {
+            engine.step_range(0, LANES, static_cast<float>(FIXED_TIMESTEP));
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+
+    // The batched loop behind a 4-step, 1 px quantized sensor: the delay
+    // lines add one ring write and one masked read per lane and step
+    cases.push_back({"batch/delayed_sensor", LANES, [](uint64_t n) {
+        BatchEngine engine(LANES);
+        SensorModel sensor;
+        sensor.delay_steps = 4;
+        sensor.quantum = 1.0;
+        engine.set_sensor(sensor);
+        for (uint64_t i = 0; i < n; ++i) {
+            engine.step(FIXED_TIMESTEP);
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+
+    // One contact pass over the 100k-ball --scene-collide layout after it
+    // has settled into piles, inline and on a pool of every core
+    cases.push_back({"collide/100k_balls", SCENE_BALLS, [](uint64_t n) {
+        static SettledScene scene;
+        for (uint64_t i = 0; i < n; ++i) {
+            scene.collider.resolve(scene.engine.y.data(), scene.engine.velocity.data(), FIXED_TIMESTEP);
+            do_not_optimize(scene.engine.y[0]);
+        }
+    }});
+    cases.push_back({"collide/100k_balls_pool", SCENE_BALLS, [](uint64_t n) {
+        static SettledScene scene;
+        static ThreadPool pool;
+        for (uint64_t i = 0; i < n; ++i) {
+            scene.collider.resolve(scene.engine.y.data(), scene.engine.velocity.data(), FIXED_TIMESTEP, &pool);
+            do_not_optimize(scene.engine.y[0]);
+        }
+    }});
+
+    // One frame of the 100k-ball --scene, two substeps with the snapshot the
+    // renderer interpolates from, on the calling thread and on a pool of
+    // every core; the ratio is the scene's worker scaling
+    cases.push_back({"scene/100k_frame", SCENE_BALLS, [](uint64_t n) {
+        BatchEngine engine(SCENE_BALLS);
+        LaneStepper stepper(engine, nullptr);
+        for (uint64_t i = 0; i < n; ++i) {
+            stepper.advance(2, FIXED_TIMESTEP, true);
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+    cases.push_back({"scene/100k_frame_pool", SCENE_BALLS, [](uint64_t n) {
+        static ThreadPool pool;
+        BatchEngine engine(SCENE_BALLS, pool);
+        LaneStepper stepper(engine, &pool);
+        for (uint64_t i = 0; i < n; ++i) {
+            stepper.advance(2, FIXED_TIMESTEP, true);
+            do_not_optimize(engine.y[0]);
+        }
+    }});
+
+    // Three axes as one fixed-width loop, against three scalar Ball + PID pairs
+    cases.push_back({"multi_axis/3_axes", 3, [](uint64_t n) {
+        MultiAxisPlant plant(3);
+        for (uint64_t i = 0; i < n; ++i) {
+            plant.step(FIXED_TIMESTEP);
+            do_not_optimize(plant.position(MultiAxisPlant::Y));
+        }
+    }});
+
+    cases.push_back({"multi_axis/3_scalar", 3, [](uint64_t n) {
+        Ball balls[3];
+        PID_Controller pids[3] = {{80.0, 0.0, 0.0}, {80.0, 0.0, 0.0}, {80.0, 0.0, 0.0}};
+        for (uint64_t i = 0; i < n; ++i) {
+            for (int a = 0; a < 3; ++a) {
+                balls[a].update(pids[a].calculate(WINDOW_HEIGHT / 2.0, balls[a].y + BALL_SIZE / 2, FIXED_TIMESTEP),
+                                FIXED_TIMESTEP);
+            }
+            do_not_optimize(balls[1].y);
+        }
+    }});
+
+    // Monte Carlo noise source: a Philox stream against the sequential
+    // generator it replaces, both through the same Box-Muller normal
+    cases.push_back({"rng/philox_normal", 1, [](uint64_t n) {
+        PhiloxStream rng(1, 0);
+        for (uint64_t i = 0; i < n; ++i) do_not_optimize(rng.normal());
+    }});
+
+    cases.push_back({"rng/mt19937_normal", 1, [](uint64_t n) {
+        std::mt19937_64 rng(1);
+        std::normal_distribution<double> normal;
+        for (uint64_t i = 0; i < n; ++i) do_not_optimize(normal(rng));
+    }});
+
+    // One perturbed Monte Carlo sample: parameter draws, then a noisy 600-step run
+    cases.push_back({"monte_carlo/sample", 600, [](uint64_t n) {
+        MonteCarloConfig config;
+        config.kp = 300.0;
+        config.ki = 2.0;
+        config.kd = 20.0;
+        for (uint64_t i = 0; i < n; ++i) do_not_optimize(run_monte_carlo_sample(config, i).iae);
+    }});
+
+    // One plot series zoomed all the way out, 300 columns wide: ten seconds
+    // of history against almost twenty hours. Through the pyramid the cost
+    // grows with the number of levels, not with the samples.
+    cases.push_back({"plot/decimate_600", 1, [](uint64_t n) { decimate_history(600, n); }});
+    cases.push_back({"plot/decimate_4M", 1, [](uint64_t n) { decimate_history(std::size_t{1} << 22, n); }});
+
+    add_plant_cases(cases);
+
+    return cases;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* filter = nullptr;
+    double min_time = 0.5;
+    int repetitions = 5;
+    uint64_t precision_steps = 0;
+    bool integrators = false;
+    bool checkpoints = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) filter = argv[++i];
+        else if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc) min_time = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--integrators")) integrators = true;
+        else if (!std::strcmp(argv[i], "--checkpoints")) checkpoints = true;
+        else if (!std::strcmp(argv[i], "--precision")) {
+            precision_steps = 36000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') precision_steps = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!std::strcmp(argv[i], "--repetitions") && i + 1 < argc) repetitions = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::printf("Usage: pid_bench [--filter SUBSTRING] [--min-time SECONDS] [--repetitions N] [--precision [STEPS]] [--integrators] [--checkpoints]\n");
+            return !std::strcmp(argv[i], "--help") ? 0 : 1;
+        }
+    }
+
+    if (integrators) {
+        run_integrator_report();
+        return 0;
+    }
+    if (checkpoints) {
+        run_checkpoint_report();
+        return 0;
+    }
+    if (precision_steps) {
+        run_precision_report(precision_steps);
+        return 0;
+    }
+
+    PerfCounters counters;
+    std::printf("batch kernel: %s, hardware counters: %s\n",
+                BatchEngine(1).isa(), counters.available() ? "on" : "unavailable");
+    // Misses per op tell a layout change's cache behavior apart from its
+    // instruction count; a column the PMU lacks prints "-"
+    std::printf("%-32s %12s %12s %12s %10s %10s %10s\n", "benchmark", "ns/op", "instr/op", "cycles/op", "L1d/op",
+                "LLC/op", "brmiss/op");
+
+    for (const Case& c : make_cases()) {
+        if (filter && !std::strstr(c.name, filter)) continue;
+        Measurement m = measure(c, min_time, repetitions, counters);
+        std::printf("%-32s %12.3f", c.name, m.ns_per_op);
+        for (int e = 0; e < PerfCounters::EVENTS; ++e) {
+            const int width = e < PerfCounters::L1dMisses ? 12 : 10;
+            const int digits = e < PerfCounters::L1dMisses ? 2 : 4;
+            if (counters.has(static_cast<PerfCounters::Event>(e))) std::printf(" %*.*f", width, digits, m.per_op[e]);
+            else std::printf(" %*s", width, "-");
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+    std::printf("peak RSS: %.1f MiB\n", peak_resident_bytes() / (1024.0 * 1024.0));
+    return 0;
+}
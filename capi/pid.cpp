@@ -0,0 +1,55 @@
+#include "pid.h"
+
+#include "core/pid_controller.h"
+
+#include <new>
+
+namespace {
+
+// The state round-trips through a real PID_Controller so the step is its
+// calculate(), inlined; load_state leaves an in-range integral untouched
+inline double step_one(pid_state& s, double setpoint, double pv, double dt) {
+    PID_Controller pid(s.kp, s.ki, s.kd);
+    pid.load_state(s.integral, s.prev_error);
+    double out = pid.calculate(setpoint, pv, dt);
+    s.integral = pid.integral_value();
+    s.prev_error = pid.last_error();
+    s.derivative = pid.last_derivative();
+    return out;
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t pid_api_version(void) { return PID_API_VERSION; }
+double pid_integral_limit(void) { return INTEGRAL_LIMIT; }
+
+void pid_init(pid_state* state, double kp, double ki, double kd) {
+    *state = pid_state{kp, ki, kd, 0.0, 0.0, 0.0};
+}
+
+void pid_reset(pid_state* state) {
+    state->integral = 0.0;
+    state->prev_error = 0.0;
+    state->derivative = 0.0;
+}
+
+double pid_step(pid_state* state, double setpoint, double pv, double dt) {
+    return step_one(*state, setpoint, pv, dt);
+}
+
+void pid_step_n(pid_state* states, const double* setpoints, const double* pvs,
+                double* outputs, size_t n, double dt) {
+    for (size_t i = 0; i < n; ++i) outputs[i] = step_one(states[i], setpoints[i], pvs[i], dt);
+}
+
+pid_state* pid_create(double kp, double ki, double kd) {
+    pid_state* state = new (std::nothrow) pid_state;
+    if (state) pid_init(state, kp, ki, kd);
+    return state;
+}
+
+void pid_destroy(pid_state* state) { delete state; }
+
+} // extern "C"
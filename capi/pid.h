@@ -0,0 +1,64 @@
+/* C ABI for the simulator's PID controller (libpid).
+ *
+ * The arithmetic is PID_Controller::calculate itself, so a service linking
+ * libpid computes bit for bit what the simulator validated. Controller
+ * state is a plain struct the caller owns: stepping never allocates, never
+ * locks and never calls back. pid_create/pid_destroy are a convenience for
+ * FFI layers that prefer handles; they are the only calls that allocate.
+ *
+ * ABI: PID_API_VERSION changes whenever pid_state's layout or a signature
+ * does. Check pid_api_version() against the header at load time. */
+#ifndef PID_CAPI_H
+#define PID_CAPI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  ifdef PID_BUILDING
+#    define PID_API __declspec(dllexport)
+#  else
+#    define PID_API __declspec(dllimport)
+#  endif
+#else
+#  define PID_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PID_API_VERSION 1
+
+/* One controller: gains plus the state calculate() carries between steps.
+ * Zero-initialized state (or pid_init) is a freshly reset controller. */
+typedef struct pid_state {
+    double kp, ki, kd;
+    double integral;    /* clamped to +/- pid_integral_limit() */
+    double prev_error;
+    double derivative;  /* derivative term of the latest step */
+} pid_state;
+
+PID_API uint32_t pid_api_version(void);
+PID_API double pid_integral_limit(void);
+
+/* Caller-owned state */
+PID_API void pid_init(pid_state* state, double kp, double ki, double kd);
+PID_API void pid_reset(pid_state* state);  /* keeps the gains */
+PID_API double pid_step(pid_state* state, double setpoint, double pv, double dt);
+
+/* n independent controllers over caller-owned arrays, one dt for all:
+ * outputs[i] = step of states[i] with setpoints[i] and pvs[i].
+ * outputs may alias setpoints or pvs. */
+PID_API void pid_step_n(pid_state* states, const double* setpoints, const double* pvs,
+                        double* outputs, size_t n, double dt);
+
+/* Heap handle around a pid_state; NULL if out of memory */
+PID_API pid_state* pid_create(double kp, double ki, double kd);
+PID_API void pid_destroy(pid_state* state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PID_CAPI_H */
@@ -0,0 +1,14 @@
+# 把二进制文件转换为 C++ 字节数组：
+# cmake -DINPUT=<文件> -DOUTPUT=<.cpp> -DNAME=<符号名> -P embed_file.cmake
+file(READ "${INPUT}" hex HEX)
+string(LENGTH "${hex}" hex_length)
+math(EXPR size "${hex_length} / 2")
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+# 每行 16 个字节（CMake 正则不支持 {n}）
+string(REPEAT "0x..," 16 row)
+string(REGEX REPLACE "(${row})" "\\1\n    " bytes "${bytes}")
+file(WRITE "${OUTPUT}"
+        "// Generated from ${INPUT} by cmake/embed_file.cmake; do not edit\n"
+        "#include <cstddef>\n\n"
+        "extern const unsigned char ${NAME}[] = {\n    ${bytes}\n};\n"
+        "extern const std::size_t ${NAME}_SIZE = ${size};\n")
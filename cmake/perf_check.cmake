@@ -0,0 +1,65 @@
+# 性能回归检查，由 CTest 调用：
+# cmake -DNAME=<基线键> -DFIELD=<输出字段> -DBASELINE=<文件> -DTOLERANCE=<百分比>
+#       -DREPEAT=<次数> -DPROGRAM=<程序> -DARGS="<参数>" -P perf_check.cmake
+# 运行 REPEAT 次取最高吞吐（排除偶发的调度抖动），低于 基线 × (100 - TOLERANCE)% 时失败。
+# 设置环境变量 PID_PERF_UPDATE=1 时改为把本机测得的吞吐写回基线文件。
+foreach(var NAME FIELD BASELINE TOLERANCE REPEAT PROGRAM ARGS)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "perf_check.cmake: -D${var}=... is required")
+    endif()
+endforeach()
+separate_arguments(args UNIX_COMMAND "${ARGS}")
+
+set(best 0)
+foreach(run RANGE 1 ${REPEAT})
+    execute_process(COMMAND "${PROGRAM}" ${args} RESULT_VARIABLE status OUTPUT_VARIABLE output ERROR_VARIABLE error)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "${NAME}: command failed (${status})\n${output}${error}")
+    endif()
+    if(NOT output MATCHES "${FIELD} +([0-9]+)")
+        message(FATAL_ERROR "${NAME}: no '${FIELD}' in the output\n${output}")
+    endif()
+    if(CMAKE_MATCH_1 GREATER best)
+        set(best ${CMAKE_MATCH_1})
+    endif()
+endforeach()
+
+# 基线文件每行“键 吞吐”，# 开头为注释
+set(lines)
+set(baseline "")
+if(EXISTS "${BASELINE}")
+    file(STRINGS "${BASELINE}" lines)
+endif()
+foreach(line IN LISTS lines)
+    if(line MATCHES "^${NAME} +([0-9]+)$")
+        set(baseline ${CMAKE_MATCH_1})
+    endif()
+endforeach()
+
+if("$ENV{PID_PERF_UPDATE}")
+    set(updated "")
+    set(replaced FALSE)
+    foreach(line IN LISTS lines)
+        if(line MATCHES "^${NAME} ")
+            set(line "${NAME} ${best}")
+            set(replaced TRUE)
+        endif()
+        string(APPEND updated "${line}\n")
+    endforeach()
+    if(NOT replaced)
+        string(APPEND updated "${NAME} ${best}\n")
+    endif()
+    file(WRITE "${BASELINE}" "${updated}")
+    message(STATUS "${NAME}: baseline set to ${best} ${FIELD}")
+    return()
+endif()
+
+if(baseline STREQUAL "")
+    message(FATAL_ERROR "${NAME}: no baseline in ${BASELINE}; record one with PID_PERF_UPDATE=1 ctest -L perf")
+endif()
+math(EXPR limit "${baseline} * (100 - ${TOLERANCE}) / 100")
+math(EXPR percent "${best} * 100 / ${baseline}")
+if(best LESS limit)
+    message(FATAL_ERROR "${NAME}: ${best} ${FIELD} is ${percent}% of the baseline ${baseline} (limit ${limit})")
+endif()
+message(STATUS "${NAME}: ${best} ${FIELD}, ${percent}% of the baseline ${baseline}")
@@ -0,0 +1,59 @@
+# PGO 训练，由 PID_PGO=ON 的构建调用（pgo_profile 目标）：
+# cmake -DSOURCE_DIR=<源码> -DBUILD_DIR=<插桩构建目录> -DPROFILE_DIR=<profile 目录>
+#       -DGENERATOR=<生成器> -DCXX_COMPILER=<编译器> -DC_COMPILER=<编译器> -DBUILD_TYPE=<配置>
+#       -DLTO=<ON|OFF> -DDETERMINISTIC=<ON|OFF> [-DPROFDATA=<llvm-profdata>] -DSTAMP=<完成标记> -P pgo_train.cmake
+# 构建插桩版 pid_headless，运行下面固定的训练负载，Clang 下再合并 .profraw。
+# 负载与参数都写在这里，同一源码总是得到同样的训练过程。
+foreach(var SOURCE_DIR BUILD_DIR PROFILE_DIR GENERATOR CXX_COMPILER C_COMPILER BUILD_TYPE LTO DETERMINISTIC STAMP)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "pgo_train.cmake: -D${var}=... is required")
+    endif()
+endforeach()
+
+function(run_checked what)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE status OUTPUT_VARIABLE output ERROR_VARIABLE output)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "PGO ${what} failed (${status}):\n${output}")
+    endif()
+endfunction()
+
+# 旧计数会和新的累加，每次训练都从空目录开始
+file(REMOVE_RECURSE "${PROFILE_DIR}")
+file(MAKE_DIRECTORY "${PROFILE_DIR}")
+
+run_checked("configure" ${CMAKE_COMMAND} -S "${SOURCE_DIR}" -B "${BUILD_DIR}" -G "${GENERATOR}"
+        -DCMAKE_CXX_COMPILER=${CXX_COMPILER} -DCMAKE_C_COMPILER=${C_COMPILER} -DCMAKE_BUILD_TYPE=${BUILD_TYPE}
+        -DPID_LTO=${LTO} -DPID_DETERMINISTIC=${DETERMINISTIC} -DPID_PGO=OFF -DPID_PGO_INSTRUMENT=${PROFILE_DIR} -DBUILD_GUI=OFF)
+set(config)
+if(BUILD_TYPE)
+    set(config --config ${BUILD_TYPE})
+endif()
+run_checked("instrumented build" ${CMAKE_COMMAND} --build "${BUILD_DIR}" --target pid_headless ${config})
+
+set(headless "")
+foreach(candidate "${BUILD_DIR}/pid_headless" "${BUILD_DIR}/pid_headless.exe"
+                  "${BUILD_DIR}/${BUILD_TYPE}/pid_headless.exe")
+    if(EXISTS "${candidate}" AND NOT IS_DIRECTORY "${candidate}")
+        set(headless "${candidate}")
+        break()
+    endif()
+endforeach()
+if(NOT headless)
+    message(FATAL_ERROR "PGO: no pid_headless in ${BUILD_DIR}")
+endif()
+
+# 训练负载：SDL_game --bench 的默认闭环（同一 run_benchmark 初始状态），带积分的
+# 稳定闭环，批量引擎，以及带指标的增益扫描
+run_checked("training (bench loop)" "${headless}" --steps 10000000)
+run_checked("training (settling loop)" "${headless}" --steps 2000000 --kp 300 --ki 2 --kd 20)
+run_checked("training (lanes)" "${headless}" --lanes 1024 --steps 20000 --kp 300 --ki 2 --kd 20)
+run_checked("training (sweep)" "${headless}" --sweep-kp 20:400:64 --sweep-kd 0:40:32 --steps 600 --metrics --threads 2)
+
+if(PROFDATA)
+    file(GLOB raw "${PROFILE_DIR}/*.profraw")
+    if(NOT raw)
+        message(FATAL_ERROR "PGO: training wrote no .profraw files to ${PROFILE_DIR}")
+    endif()
+    run_checked("profile merge" "${PROFDATA}" merge -output=${PROFILE_DIR}/pid.profdata ${raw})
+endif()
+file(WRITE "${STAMP}" "")
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+constexpr std::size_t CACHE_LINE = 64;
+
+template <class T, std::size_t Align = CACHE_LINE>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <class U>
+    struct rebind { using other = AlignedAllocator<U, Align>; };
+
+    AlignedAllocator() = default;
+    template <class U>
+    AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+    }
+    void deallocate(T* p, std::size_t) {
+        ::operator delete(p, std::align_val_t(Align));
+    }
+
+    template <class U>
+    bool operator==(const AlignedAllocator<U, Align>&) const { return true; }
+    template <class U>
+    bool operator!=(const AlignedAllocator<U, Align>&) const { return false; }
+};
+
+template <class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// AlignedAllocator whose value-initialization is a default-initialization:
+// resize(n) of a trivial type reserves the memory without writing it, so
+// (for an allocation large enough to come straight from the OS) each page
+// lands on the NUMA node of the thread that writes it first. Copies and
+// explicit values construct as usual.
+template <class T, std::size_t Align = CACHE_LINE>
+struct FirstTouchAllocator : AlignedAllocator<T, Align> {
+    template <class U>
+    struct rebind { using other = FirstTouchAllocator<U, Align>; };
+
+    FirstTouchAllocator() = default;
+    template <class U>
+    FirstTouchAllocator(const FirstTouchAllocator<U, Align>&) {}
+
+    template <class U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new (static_cast<void*>(p)) U;
+    }
+    template <class U, class... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+template <class T>
+using FirstTouchVector = std::vector<T, FirstTouchAllocator<T>>;
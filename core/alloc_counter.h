@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// Debug hook on the global operator new: alloc_counter.cpp replaces every
+// new/delete form to count allocations on the calling thread. Only C++
+// allocations are seen; SDL's and the C library's own malloc calls are not.
+// Configure with -DPID_ALLOC_COUNTER=OFF to keep the default operators.
+
+// False when built without the hook; counts then stay at zero
+bool allocation_counting_enabled();
+
+// operator new calls made by this thread since it started
+uint64_t thread_allocations();
+
+// Allocations made by this thread since construction
+class AllocationScope {
+public:
+    AllocationScope() : start(thread_allocations()) {}
+    uint64_t count() const { return thread_allocations() - start; }
+
+private:
+    uint64_t start;
+};
@@ -0,0 +1,132 @@
+#include "app_config.h"
+
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr char CONFIG_HEADER[] = "# pid config";
+constexpr char SEPARATORS[] = " \t\r\n";
+
+// One argument as a finite number; false when the line has run out too
+bool number(char* token, double& value) {
+    if (!token) return false;
+    char* end;
+    value = std::strtod(token, &end);
+    return end != token && *end == '\0' && std::isfinite(value);
+}
+
+bool numbers(double& a, double& b, double& c) {
+    return number(std::strtok(nullptr, SEPARATORS), a) && number(std::strtok(nullptr, SEPARATORS), b) &&
+           number(std::strtok(nullptr, SEPARATORS), c);
+}
+
+} // namespace
+
+unsigned AppConfig::diff(const AppConfig& other) const {
+    unsigned changed = 0;
+    if (gravity != other.gravity || bounce != other.bounce || integral_limit != other.integral_limit) changed |= Plant;
+    if (timestep != other.timestep) changed |= Timestep;
+    if (kp != other.kp || ki != other.ki || kd != other.kd) changed |= Gains;
+    if (kp_step != other.kp_step || ki_step != other.ki_step || kd_step != other.kd_step) changed |= KeySteps;
+    return changed;
+}
+
+void AppConfig::validate() const {
+    if (!std::isfinite(gravity)) throw std::invalid_argument("gravity must be finite");
+    if (!(bounce >= -1.0 && bounce <= 0.0)) throw std::invalid_argument("bounce must be in [-1, 0]");
+    if (!(integral_limit > 0.0) || !std::isfinite(integral_limit)) {
+        throw std::invalid_argument("integral_limit must be positive");
+    }
+    if (!(timestep > 0.0 && timestep <= 0.1)) throw std::invalid_argument("timestep must be in (0, 0.1] s");
+    if (!(kp >= 0.0 && ki >= 0.0 && kd >= 0.0)) throw std::invalid_argument("gains must not be negative");
+    if (!(kp_step >= 0.0 && ki_step >= 0.0 && kd_step >= 0.0)) {
+        throw std::invalid_argument("key steps must not be negative");
+    }
+}
+
+AppConfig AppConfig::load(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "r");
+    if (!f) throw std::runtime_error("cannot read " + path + ": " + std::strerror(errno));
+    auto fail = [&](const std::string& what) {
+        std::fclose(f);
+        return std::runtime_error(path + ": " + what);
+    };
+
+    char line[256];
+    if (!std::fgets(line, sizeof(line), f) || std::strncmp(line, CONFIG_HEADER, sizeof(CONFIG_HEADER) - 1) != 0) {
+        throw fail("not a config file (no \"# pid config\" header)");
+    }
+    AppConfig config;
+    unsigned long line_number = 1;
+    while (std::fgets(line, sizeof(line), f)) {
+        ++line_number;
+        if (char* comment = std::strchr(line, '#')) *comment = '\0';
+        char* key = std::strtok(line, SEPARATORS);
+        if (!key) continue;
+        const std::string where = "line " + std::to_string(line_number) + ": ";
+
+        bool ok;
+        if (!std::strcmp(key, "gravity")) ok = number(std::strtok(nullptr, SEPARATORS), config.gravity);
+        else if (!std::strcmp(key, "bounce")) ok = number(std::strtok(nullptr, SEPARATORS), config.bounce);
+        else if (!std::strcmp(key, "integral_limit")) ok = number(std::strtok(nullptr, SEPARATORS), config.integral_limit);
+        else if (!std::strcmp(key, "timestep")) ok = number(std::strtok(nullptr, SEPARATORS), config.timestep);
+        else if (!std::strcmp(key, "gains")) ok = numbers(config.kp, config.ki, config.kd);
+        else if (!std::strcmp(key, "key_steps")) ok = numbers(config.kp_step, config.ki_step, config.kd_step);
+        else {
+            throw fail(where + "unknown setting " + key +
+                       " (gravity, bounce, integral_limit, timestep, gains or key_steps)");
+        }
+        if (!ok) {
+            bool triple = !std::strcmp(key, "gains") || !std::strcmp(key, "key_steps");
+            throw fail(where + key + (triple ? " takes Kp Ki Kd" : " takes a number"));
+        }
+        if (std::strtok(nullptr, SEPARATORS)) throw fail(where + "too many arguments for " + key);
+    }
+    std::fclose(f);
+    try {
+        config.validate();
+    } catch (const std::invalid_argument& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+    return config;
+}
+
+ConfigWatcher::ConfigWatcher(const std::string& path, double interval)
+        : file(path), interval(interval), current(AppConfig::load(path)) {
+    stamp(mtime_ns, size);
+}
+
+bool ConfigWatcher::stamp(int64_t& mtime, int64_t& bytes) const {
+    struct stat st;
+    if (::stat(file.c_str(), &st) != 0) return false;
+    mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    bytes = static_cast<int64_t>(st.st_size);
+    return true;
+}
+
+unsigned ConfigWatcher::poll(double now) {
+    if (now < next_check) return 0;
+    next_check = now + interval;
+    int64_t mtime, bytes;
+    // A missing file is an editor replacing it; the next poll sees the new one
+    if (!stamp(mtime, bytes) || (mtime == mtime_ns && bytes == size)) return 0;
+    mtime_ns = mtime;
+    size = bytes;
+    try {
+        AppConfig loaded = AppConfig::load(file);
+        problem.clear();
+        unsigned changed = loaded.diff(current);
+        current = loaded;
+        return changed;
+    } catch (const std::exception& e) {
+        problem = e.what();
+        return REJECTED;
+    }
+}
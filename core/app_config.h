@@ -0,0 +1,86 @@
+#pragma once
+
+#include "constants.h"
+#include "simulation.h"
+
+#include <cstdint>
+#include <string>
+
+// Tunables that used to be compiled in, read from a text file by
+// SDL_game --config (which reloads it while running) and pid_headless
+// --config:
+//
+//   # pid config
+//   gravity 98              # px/s^2
+//   bounce -0.3             # wall restitution, velocity factor
+//   integral_limit 1000     # anti-windup clamp
+//   timestep 0.0166667      # physics step, s
+//   gains 80 0 0            # Kp Ki Kd
+//   key_steps 5 0.1 5       # Kp Ki Kd change per key press
+//
+// Every line is optional; a missing one keeps the compiled default. '#'
+// starts a comment. The arena and ball size stay compile-time constants:
+// the SIMD kernels, goldens and draw layers are built around them.
+struct AppConfig {
+    double gravity = GRAVITY;
+    double bounce = BOUNCE_COEFFICIENT;
+    double integral_limit = INTEGRAL_LIMIT;
+    double timestep = FIXED_TIMESTEP;
+    double kp = 80.0, ki = 0.0, kd = 0.0;
+    double kp_step = 5.0, ki_step = 0.1, kd_step = 5.0;
+
+    // What a reload changed, so only the parts that depend on it are redone
+    enum Change : unsigned {
+        Plant = 1u << 0,     // gravity, bounce or integral_limit
+        Timestep = 1u << 1,
+        Gains = 1u << 2,
+        KeySteps = 1u << 3,
+    };
+    unsigned diff(const AppConfig& other) const;
+
+    // Throws std::invalid_argument for a value the loop cannot run with
+    void validate() const;
+    // Throws std::runtime_error for an unreadable or malformed file, naming
+    // the line
+    static AppConfig load(const std::string& path);
+
+    // Plant constants onto a loop; its state and gains are left alone
+    void apply_plant(Simulation& sim) const {
+        sim.ball.gravity = gravity;
+        sim.ball.bounce = bounce;
+        sim.pid.integral_limit = integral_limit;
+    }
+};
+
+// Polls a config file for edits. The modification time and size are
+// checked at most once per `interval` seconds, a stat() that never
+// allocates, so an idle frame stays allocation-free; a reload happens only
+// when they moved. A file that fails to parse (a save caught half-written,
+// a typo) keeps the previous config and is reported once, as REJECTED.
+class ConfigWatcher {
+public:
+    static constexpr unsigned REJECTED = 1u << 31;
+
+    // Loads `path`; throws as AppConfig::load
+    explicit ConfigWatcher(const std::string& path, double interval = 0.25);
+
+    const AppConfig& config() const { return current; }
+    const std::string& path() const { return file; }
+    // Why the latest reload was rejected; empty after a good one
+    const std::string& error() const { return problem; }
+
+    // `now` in seconds on any monotonic clock. Returns the AppConfig::Change
+    // bits of a reload that took effect, REJECTED for one that did not (see
+    // error()), 0 when the file is unchanged.
+    unsigned poll(double now);
+
+private:
+    bool stamp(int64_t& mtime_ns, int64_t& size) const;
+
+    std::string file;
+    double interval;
+    double next_check = 0.0;
+    int64_t mtime_ns = 0, size = -1;
+    AppConfig current;
+    std::string problem;
+};
@@ -0,0 +1,75 @@
+#include "async_logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+std::atomic<uint64_t> next_serial{1};
+
+} // namespace
+
+AsyncLogger::AsyncLogger(const std::string& path)
+        : out_path(path), serial(next_serial.fetch_add(1, std::memory_order_relaxed)),
+          batch(std::make_unique<LogRecord[]>(MAX_THREADS * RING_RECORDS)) {
+    if (path == "-") {
+        out = stderr;
+    } else {
+        out = std::fopen(path.c_str(), "w");
+        if (!out) throw std::runtime_error("cannot write " + path + ": " + std::strerror(errno));
+        owns_out = true;
+    }
+    // Every ring exists up front, so claiming one never allocates
+    for (std::size_t i = 0; i < MAX_THREADS; ++i) {
+        rings[i] = std::make_unique<Ring>();
+        rings[i]->id = static_cast<uint32_t>(i);
+    }
+    writer = std::thread(&AsyncLogger::writer_main, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    close();
+}
+
+AsyncLogger::Ring* AsyncLogger::claim_ring() {
+    uint32_t id = claimed.fetch_add(1, std::memory_order_relaxed);
+    return id < MAX_THREADS ? rings[id].get() : nullptr;
+}
+
+std::size_t AsyncLogger::drain() {
+    std::size_t n = 0;
+    for (const std::unique_ptr<Ring>& ring : rings) {
+        // At most one ring's worth each, however fast the thread refills it
+        for (std::size_t k = 0; k < RING_RECORDS && ring->queue.pop(batch[n]); ++k) ++n;
+    }
+    if (n == 0) return 0;
+    // Each ring is in order already; interleave the threads by time
+    std::stable_sort(batch.get(), batch.get() + n,
+                     [](const LogRecord& x, const LogRecord& y) { return x.nanos < y.nanos; });
+    char message[256];
+    for (std::size_t i = 0; i < n; ++i) {
+        const LogRecord& r = batch[i];
+        std::snprintf(message, sizeof(message), r.format, r.a, r.b, r.c);
+        std::fprintf(out, "%12.6f t%u %s\n", r.nanos * 1e-9, r.thread, message);
+    }
+    std::fflush(out);
+    written_count.fetch_add(n, std::memory_order_relaxed);
+    return n;
+}
+
+void AsyncLogger::writer_main() {
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (drain() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    drain();
+}
+
+void AsyncLogger::close() {
+    if (closed) return;
+    closed = true;
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    if (owns_out) std::fclose(out);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "spsc_queue.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+// One diagnostic event, half a cache line. The message is not formatted
+// where it happens: the record keeps the format and up to three numbers,
+// and the logger thread runs printf on them later.
+struct LogRecord {
+    const char* format;  // string literal whose conversions all take a double
+    uint64_t nanos;      // steady_clock, since the logger started
+    double a, b, c;
+    uint32_t thread;     // order in which the thread first logged, from 0
+    uint32_t reserved;
+};
+static_assert(sizeof(LogRecord) == 48, "log records are fixed-width");
+
+// Event log for the stepping and render threads. log() pushes a LogRecord
+// into the calling thread's own lock-free ring: a thread-local lookup, a
+// clock read and a ring push, with no lock, allocation or system call (the
+// clock is read through the vDSO), so an event
+// inside the step loop neither blocks it nor changes what it computes. A
+// background thread drains every ring, orders each batch by time, formats
+// it and writes it out. A thread claims one of MAX_THREADS preallocated
+// rings on its first event (a thread logs to one logger at a time);
+// events from further threads, or into a full ring, are dropped and
+// counted.
+//
+//   logger.log("integral saturated at %g, error %g", integral, error);
+class AsyncLogger {
+public:
+    static constexpr std::size_t MAX_THREADS = 16;
+    static constexpr std::size_t RING_RECORDS = 1 << 11;
+
+    // "-" writes to stderr
+    explicit AsyncLogger(const std::string& path);
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // Any thread. `format` must outlive the logger (a literal does) and may
+    // use only double conversions (%g, %f, %e), at most three.
+    bool log(const char* format, double a = 0.0, double b = 0.0, double c = 0.0) {
+        Ring* ring = own_ring();
+        if (ring) {
+            uint64_t nanos = static_cast<uint64_t>((std::chrono::steady_clock::now() - start).count());
+            if (ring->queue.push({format, nanos, a, b, c, ring->id, 0})) return true;
+        }
+        dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Writes everything logged so far and flushes the output
+    void close();
+
+    uint64_t written() const { return written_count.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_count.load(std::memory_order_relaxed); }
+    const std::string& path() const { return out_path; }
+
+private:
+    struct Ring {
+        SpscQueue<LogRecord, RING_RECORDS> queue;
+        uint32_t id = 0;
+    };
+
+    struct ThreadSlot {
+        uint64_t serial = 0;  // logger the ring belongs to
+        Ring* ring = nullptr;
+    };
+
+    // The calling thread's ring, claimed on its first call; nullptr once all are taken
+    Ring* own_ring() {
+        thread_local ThreadSlot slot;
+        if (slot.serial != serial) {
+            slot.serial = serial;
+            slot.ring = claim_ring();
+        }
+        return slot.ring;
+    }
+    Ring* claim_ring();
+
+    void writer_main();
+    std::size_t drain();
+
+    std::string out_path;
+    std::FILE* out = nullptr;
+    bool owns_out = false;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const uint64_t serial;  // unique per logger, so a new one at an old one's address claims afresh
+    std::array<std::unique_ptr<Ring>, MAX_THREADS> rings;
+    std::atomic<uint32_t> claimed{0};
+    std::unique_ptr<LogRecord[]> batch;
+    std::atomic<uint64_t> written_count{0};
+    std::atomic<uint64_t> dropped_count{0};
+    std::atomic<bool> stopping{false};
+    bool closed = false;
+    std::thread writer;
+};
@@ -0,0 +1,242 @@
+#include "auto_tune.h"
+#include "batch_engine.h"
+#include "philox.h"
+#include "result_cache.h"
+#include "result_store.h"
+#include "sweep.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+constexpr int N = 3;  // Kp, Ki, Kd
+using Vec = std::array<double, N>;
+using Mat = std::array<Vec, N>;
+
+// Added per squared box-fraction a sample lies outside the box
+constexpr double BOUND_PENALTY = 1e4;
+
+// Symmetric eigendecomposition by cyclic Jacobi rotations: a = v diag(d) v^T,
+// eigenvectors in the columns of v. Plenty for a 3x3 covariance.
+void eigen_symmetric(Mat a, Mat& v, Vec& d) {
+    v = {};
+    for (int i = 0; i < N; ++i) v[i][i] = 1.0;
+    for (int sweep = 0; sweep < 32; ++sweep) {
+        double off = 0.0;
+        for (int p = 0; p < N; ++p) {
+            for (int q = p + 1; q < N; ++q) off += a[p][q] * a[p][q];
+        }
+        if (off < 1e-30) break;
+        for (int p = 0; p < N; ++p) {
+            for (int q = p + 1; q < N; ++q) {
+                if (a[p][q] == 0.0) continue;
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+                for (int k = 0; k < N; ++k) {
+                    double akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < N; ++k) {
+                    double apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < N; ++k) {
+                    double vkp = v[k][p], vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < N; ++i) d[i] = std::max(a[i][i], 1e-20);
+}
+
+// Appends a generation's in-box samples to config.store; the runs are the
+// ones a metrics sweep would make for the same gains
+void record(const AutoTuneConfig& config, const std::vector<Vec>& x, const std::vector<LoopMetrics>& metrics) {
+    SweepConfig cell;
+    cell.setpoint = config.setpoint;
+    cell.steps = config.steps;
+    cell.dt = config.dt;
+    cell.metrics = true;
+    const Vec box{config.kp_max, config.ki_max, config.kd_max};
+    for (std::size_t k = 0; k < x.size(); ++k) {
+        bool inside = true;
+        for (double v : x[k]) inside = inside && v >= 0.0 && v <= 1.0;
+        if (!inside) continue;
+        config.store->append(sweep_key(cell, x[k][0] * box[0], x[k][1] * box[1], x[k][2] * box[2]), metrics[k]);
+    }
+}
+
+} // namespace
+
+void AutoTuneConfig::validate() const {
+    if (!(kp_max > 0.0) || !(ki_max >= 0.0) || !(kd_max >= 0.0)) {
+        throw std::invalid_argument("the auto-tune box needs Kp max > 0 and Ki, Kd max >= 0");
+    }
+    if (population < 4) throw std::invalid_argument("the auto-tune population needs at least 4 candidates");
+    if (generations == 0 || steps == 0) throw std::invalid_argument("auto-tune needs at least one generation and step");
+    if (!(sigma0 > 0.0) || !(effort_weight >= 0.0)) {
+        throw std::invalid_argument("auto-tune step size must be positive and the effort weight not negative");
+    }
+    if (store && compensation.any()) throw std::invalid_argument("the auto-tune store takes no compensation");
+}
+
+double auto_tune_cost(const AutoTuneConfig& config, const LoopMetrics& m) {
+    return m.itae + config.effort_weight * m.effort;
+}
+
+AutoTuneResult run_auto_tune(ThreadPool& pool, const AutoTuneConfig& config,
+                             const std::function<bool(const AutoTuneGeneration&)>& progress) {
+    config.validate();
+    const Vec box{config.kp_max, config.ki_max, config.kd_max};
+    const std::size_t lambda = config.population;
+    const std::size_t mu = lambda / 2;
+
+    // Strategy parameters after Hansen's tutorial defaults
+    std::vector<double> weights(mu);
+    for (std::size_t i = 0; i < mu; ++i) weights[i] = std::log(mu + 0.5) - std::log(i + 1.0);
+    double weight_sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+    double weight_sq = 0.0;
+    for (double& w : weights) {
+        w /= weight_sum;
+        weight_sq += w * w;
+    }
+    const double mueff = 1.0 / weight_sq;
+    const double n = N;
+    const double cc = (4.0 + mueff / n) / (n + 4.0 + 2.0 * mueff / n);
+    const double cs = (mueff + 2.0) / (n + mueff + 5.0);
+    const double c1 = 2.0 / ((n + 1.3) * (n + 1.3) + mueff);
+    const double cmu = std::min(1.0 - c1, 2.0 * (mueff - 2.0 + 1.0 / mueff) / ((n + 2.0) * (n + 2.0) + mueff));
+    const double damps = 1.0 + 2.0 * std::max(0.0, std::sqrt((mueff - 1.0) / (n + 1.0)) - 1.0) + cs;
+    const double chi_n = std::sqrt(n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+
+    Vec mean{0.5, 0.5, 0.5}, ps{}, pc{};
+    Mat cov{}, basis;
+    Vec eig;
+    for (int i = 0; i < N; ++i) cov[i][i] = 1.0;
+    double sigma = config.sigma0;
+
+    AutoTuneResult result;
+    result.cost = HUGE_VAL;
+    BatchEngine engine(lambda);
+    engine.set_compensation(config.compensation);
+    std::vector<Vec> x(lambda);
+    std::vector<LoopMetrics> metrics(lambda);
+    std::vector<double> cost(lambda);
+    std::vector<std::size_t> order(lambda);
+    const std::size_t padded = (lambda + BatchEngine::LANE_PAD - 1) / BatchEngine::LANE_PAD * BatchEngine::LANE_PAD;
+
+    for (unsigned g = 0; g < config.generations; ++g) {
+        eigen_symmetric(cov, basis, eig);
+        Vec scale;
+        for (int i = 0; i < N; ++i) scale[i] = std::sqrt(eig[i]);
+
+        PhiloxStream rng(config.seed, g);
+        for (std::size_t k = 0; k < lambda; ++k) {
+            Vec z;
+            for (double& v : z) v = rng.normal();
+            double gains[N];
+            for (int i = 0; i < N; ++i) {
+                double step = 0.0;
+                for (int j = 0; j < N; ++j) step += basis[i][j] * scale[j] * z[j];
+                x[k][i] = mean[i] + sigma * step;
+                gains[i] = std::clamp(x[k][i], 0.0, 1.0) * box[i];
+            }
+            engine.reset_lane(k);
+            engine.set_gains(k, gains[0], gains[1], gains[2]);
+            engine.set_setpoint(k, config.setpoint);
+        }
+
+        // Small blocks so even a modest population spreads over the pool
+        pool.parallel_for(padded, BatchEngine::LANE_PAD, [&](std::size_t begin, std::size_t end, unsigned) {
+            LoopMetrics block[BatchEngine::LANE_PAD];
+            evaluate_metrics(engine, begin, end, config.steps, config.dt, block);
+            for (std::size_t k = begin; k < std::min(end, lambda); ++k) metrics[k] = block[k - begin];
+        });
+        result.evaluations += lambda;
+        if (config.store) record(config, x, metrics);
+
+        for (std::size_t k = 0; k < lambda; ++k) {
+            double outside = 0.0;
+            for (int i = 0; i < N; ++i) {
+                double d = x[k][i] - std::clamp(x[k][i], 0.0, 1.0);
+                outside += d * d;
+            }
+            cost[k] = auto_tune_cost(config, metrics[k]) + BOUND_PENALTY * outside;
+            if (outside == 0.0 && cost[k] < result.cost) {
+                result.cost = cost[k];
+                result.metrics = metrics[k];
+                result.kp = x[k][0] * box[0];
+                result.ki = x[k][1] * box[1];
+                result.kd = x[k][2] * box[2];
+            }
+        }
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return cost[a] < cost[b]; });
+
+        // Recombination, then the evolution paths and covariance update
+        Vec old_mean = mean, y_w{};
+        mean = {};
+        for (std::size_t r = 0; r < mu; ++r) {
+            for (int i = 0; i < N; ++i) mean[i] += weights[r] * x[order[r]][i];
+        }
+        for (int i = 0; i < N; ++i) y_w[i] = (mean[i] - old_mean[i]) / sigma;
+
+        // C^-1/2 y_w = B D^-1 B^T y_w
+        Vec bt{}, whitened{};
+        for (int j = 0; j < N; ++j) {
+            for (int i = 0; i < N; ++i) bt[j] += basis[i][j] * y_w[i];
+            bt[j] /= scale[j];
+        }
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < N; ++j) whitened[i] += basis[i][j] * bt[j];
+        }
+        double ps_norm = 0.0;
+        for (int i = 0; i < N; ++i) {
+            ps[i] = (1.0 - cs) * ps[i] + std::sqrt(cs * (2.0 - cs) * mueff) * whitened[i];
+            ps_norm += ps[i] * ps[i];
+        }
+        ps_norm = std::sqrt(ps_norm);
+        bool hsig = ps_norm / std::sqrt(1.0 - std::pow(1.0 - cs, 2.0 * (g + 1))) / chi_n < 1.4 + 2.0 / (n + 1.0);
+        for (int i = 0; i < N; ++i) {
+            pc[i] = (1.0 - cc) * pc[i] + (hsig ? std::sqrt(cc * (2.0 - cc) * mueff) : 0.0) * y_w[i];
+        }
+        Mat next;
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < N; ++j) {
+                double rank_mu = 0.0;
+                for (std::size_t r = 0; r < mu; ++r) {
+                    const Vec& xr = x[order[r]];
+                    rank_mu += weights[r] * (xr[i] - old_mean[i]) * (xr[j] - old_mean[j]) / (sigma * sigma);
+                }
+                double rank_one = pc[i] * pc[j] + (hsig ? 0.0 : cc * (2.0 - cc) * cov[i][j]);
+                next[i][j] = (1.0 - c1 - cmu) * cov[i][j] + c1 * rank_one + cmu * rank_mu;
+            }
+        }
+        cov = next;
+        sigma *= std::exp(cs / damps * (ps_norm / chi_n - 1.0));
+
+        AutoTuneGeneration gen;
+        gen.best_cost = result.cost;
+        gen.sigma = sigma;
+        gen.kp = std::clamp(mean[0], 0.0, 1.0) * box[0];
+        gen.ki = std::clamp(mean[1], 0.0, 1.0) * box[1];
+        gen.kd = std::clamp(mean[2], 0.0, 1.0) * box[2];
+        result.history.push_back(gen);
+        if (progress && !progress(gen)) break;
+
+        double spread = 0.0;
+        for (int i = 0; i < N; ++i) spread = std::max(spread, sigma * std::sqrt(cov[i][i]));
+        if (spread < config.tolerance) break;
+    }
+    return result;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "constants.h"
+#include "loop_metrics.h"
+#include "pid_controller.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class ResultStore;
+class ThreadPool;
+
+// Black-box gain search by CMA-ES (covariance matrix adaptation evolution
+// strategy). Each generation samples `population` gain sets from a Gaussian
+// over the search box, runs them all from App's initial state as lanes of
+// one BatchEngine across the pool, and moves the Gaussian's mean, step size
+// and covariance towards the best half. The search works in box-normalised
+// coordinates, so Kp, Ki and Kd are on one scale; samples outside the box
+// are evaluated at the nearest point inside it plus a penalty, which keeps
+// the mean from wandering off. Generation g draws from PhiloxStream(seed, g),
+// so a run depends only on the config, never on the thread count.
+struct AutoTuneConfig {
+    double kp_max = 400.0, ki_max = 20.0, kd_max = 60.0;  // box from 0 to these
+    double effort_weight = 1e-3;  // cost = ITAE + effort_weight * effort
+    double setpoint = WINDOW_HEIGHT / 2.0;
+    uint64_t steps = 600;
+    double dt = FIXED_TIMESTEP;
+    std::size_t population = 64;  // lanes per generation
+    unsigned generations = 60;    // at most
+    double sigma0 = 0.3;          // initial step size, as a fraction of the box
+    double tolerance = 1e-4;      // stop once the search spread is below this fraction of the box
+    uint64_t seed = 1;
+    // Output compensation of every candidate; the gains found are tuned for it
+    Compensation compensation;
+    // Every evaluation inside the box is appended here from the calling
+    // thread, keyed as a metrics sweep cell would be, so only without
+    // compensation. Not owned.
+    ResultStore* store = nullptr;
+
+    void validate() const;  // throws std::invalid_argument
+};
+
+struct AutoTuneGeneration {
+    double best_cost = 0.0;  // over all generations so far
+    double sigma = 0.0;
+    double kp = 0.0, ki = 0.0, kd = 0.0;  // the mean
+};
+
+struct AutoTuneResult {
+    double kp = 0.0, ki = 0.0, kd = 0.0;  // best gains evaluated
+    double cost = 0.0;
+    LoopMetrics metrics;
+    std::size_t evaluations = 0;
+    std::vector<AutoTuneGeneration> history;  // one entry per generation run
+};
+
+double auto_tune_cost(const AutoTuneConfig& config, const LoopMetrics& m);
+
+// Runs until config.generations or the tolerance; `progress`, if set, is
+// called after each generation from the calling thread and may return false
+// to stop the search there
+AutoTuneResult run_auto_tune(ThreadPool& pool, const AutoTuneConfig& config,
+                             const std::function<bool(const AutoTuneGeneration&)>& progress = {});
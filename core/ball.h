@@ -0,0 +1,53 @@
+#pragma once
+
+#include "scalar_traits.h"
+
+// Point mass moving along y inside the arena; x only positions it for drawing
+template <class T>
+class BasicBall {
+    using Traits = ScalarTraits<T>;
+
+public:
+    double x = WINDOW_WIDTH / 2 - BALL_SIZE / 2;
+    T y = T(WINDOW_HEIGHT / 2.0);
+    T velocity = T(0.0);
+    // Plant constants, runtime so a reloaded config can change them in place
+    T gravity = Traits::gravity();
+    T bounce = Traits::bounce();
+
+    void update(T force, T dt) {
+        T acceleration = force - gravity;
+        velocity += acceleration * dt;
+        y += velocity * dt;
+        apply_boundary_constraints();
+    }
+
+    // Closed-form step under a force held constant for dt:
+    // y += v dt + a dt^2 / 2, v += a dt, then the same wall handling
+    void update_exact(T force, T dt) {
+        T acceleration = force - gravity;
+        y += velocity * dt + T(0.5) * acceleration * dt * dt;
+        velocity += acceleration * dt;
+        apply_boundary_constraints();
+    }
+
+    // For integrators that advance position and velocity themselves
+    void set_state(T new_y, T new_velocity) {
+        y = new_y;
+        velocity = new_velocity;
+        apply_boundary_constraints();
+    }
+
+private:
+    void apply_boundary_constraints() {
+        if (y < Traits::zero()) {
+            y = Traits::zero();
+            velocity *= bounce;
+        } else if (y > Traits::y_max()) {
+            y = Traits::y_max();
+            velocity *= bounce;
+        }
+    }
+};
+
+using Ball = BasicBall<double>;
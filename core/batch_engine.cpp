@@ -0,0 +1,398 @@
+#include "batch_engine.h"
+#include "ball.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr double PV_OFFSET = BALL_SIZE / 2;
+constexpr double Y_MAX = WINDOW_HEIGHT - BALL_SIZE;
+// prev_input of a lane that has not stepped since its controller was reset
+constexpr double UNPRIMED = std::numeric_limits<double>::quiet_NaN();
+
+bool cpu_has_avx2() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#elif defined(_M_X64) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7) return false;
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+// Same arithmetic, in the same order, as PID_Controller::calculate followed by
+// Ball::update, but with the clamp and the wall bounce written as selects.
+template <bool Measured, bool Disturbed, bool Velocity, bool Filtered, int Compensate>
+void step_scalar(const BatchView& v, std::size_t begin, std::size_t end, double dt) {
+    // The derivative filter's and the observer's coefficients, as PID_Controller caches them
+    const double gain = 1.0 / (v.derivative_filter + dt);
+    const double keep = v.derivative_filter * gain;
+    const double error_weight = 1.0 - v.measurement_weight;
+    const double observer_gain = dt / (v.observer_filter + dt);
+    const double observer_keep = v.observer_filter / (v.observer_filter + dt);
+    const double dt2 = dt * dt;
+    for (std::size_t i = begin; i < end; ++i) {
+        double pv = Measured ? v.pv[i] : v.y[i] + PV_OFFSET;
+        double error = v.setpoint[i] - pv;
+        double derivative;
+        if (Filtered) {
+            double x = error_weight * error - v.measurement_weight * pv;
+            double x1 = v.prev_input[i];
+            derivative = keep * v.prev_derivative[i] + gain * (x - (x1 == x1 ? x1 : x));
+            v.prev_input[i] = x;
+        } else {
+            derivative = (error - v.prev_error[i]) / dt;
+        }
+        double force;
+        if (Velocity) {
+            double change = v.kp[i] * (error - v.prev_error[i]) + v.ki[i] * (error * dt) +
+                            v.kd[i] * (derivative - v.prev_derivative[i]);
+            force = std::min(std::max(v.integral[i] + change, -OUTPUT_LIMIT), OUTPUT_LIMIT);
+            v.integral[i] = force;
+        } else {
+            double integral = std::min(std::max(v.integral[i] + error * dt, -INTEGRAL_LIMIT), INTEGRAL_LIMIT);
+            force = v.kp[i] * error + v.ki[i] * integral + v.kd[i] * derivative;
+            v.integral[i] = integral;
+        }
+        if (Velocity || Filtered) v.prev_derivative[i] = derivative;
+        if (Compensate == COMPENSATE_OBSERVER) {
+            const double pv1 = v.observer_pv1[i];
+            const double w = (pv - 2.0 * pv1 + v.observer_pv2[i]) / dt2 - v.observer_output[i];
+            double estimate = v.observer_estimate[i];
+            // NaN until the lane has two earlier measurements
+            if (w == w) estimate = observer_keep * estimate + observer_gain * w;
+            v.observer_estimate[i] = estimate;
+            v.observer_pv2[i] = pv1;
+            v.observer_pv1[i] = pv;
+            force = force - estimate;
+            v.observer_output[i] = force;
+        }
+        if (Compensate != COMPENSATE_NONE) force = force + v.feed_forward;
+        if (Disturbed) force += v.disturbance[i];
+        v.prev_error[i] = error;
+
+        double velocity = v.velocity[i] + (force - GRAVITY) * dt;
+        double y = v.y[i] + velocity * dt;
+        bool below = y < 0;
+        bool above = y > Y_MAX;
+        v.y[i] = below ? 0.0 : (above ? Y_MAX : y);
+        v.velocity[i] = (below || above) ? velocity * BOUNCE_COEFFICIENT : velocity;
+    }
+}
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+template <bool Measured, bool Disturbed>
+void step_neon(const BatchView& v, std::size_t begin, std::size_t end, double dt) {
+    const float64x2_t vdt = vdupq_n_f64(dt);
+    const float64x2_t offset = vdupq_n_f64(PV_OFFSET);
+    const float64x2_t lo_limit = vdupq_n_f64(-INTEGRAL_LIMIT);
+    const float64x2_t hi_limit = vdupq_n_f64(INTEGRAL_LIMIT);
+    const float64x2_t gravity = vdupq_n_f64(GRAVITY);
+    const float64x2_t zero = vdupq_n_f64(0.0);
+    const float64x2_t y_max = vdupq_n_f64(Y_MAX);
+    const float64x2_t bounce = vdupq_n_f64(BOUNCE_COEFFICIENT);
+
+    for (std::size_t i = begin; i < end; i += 2) {
+        float64x2_t pv = Measured ? vld1q_f64(v.pv + i) : vaddq_f64(vld1q_f64(v.y + i), offset);
+        float64x2_t error = vsubq_f64(vld1q_f64(v.setpoint + i), pv);
+        float64x2_t integral = vaddq_f64(vld1q_f64(v.integral + i), vmulq_f64(error, vdt));
+        integral = vminq_f64(vmaxq_f64(integral, lo_limit), hi_limit);
+        float64x2_t derivative = vdivq_f64(vsubq_f64(error, vld1q_f64(v.prev_error + i)), vdt);
+        float64x2_t force = vaddq_f64(vaddq_f64(vmulq_f64(vld1q_f64(v.kp + i), error),
+                                                vmulq_f64(vld1q_f64(v.ki + i), integral)),
+                                      vmulq_f64(vld1q_f64(v.kd + i), derivative));
+        if (Disturbed) force = vaddq_f64(force, vld1q_f64(v.disturbance + i));
+        vst1q_f64(v.integral + i, integral);
+        vst1q_f64(v.prev_error + i, error);
+
+        float64x2_t velocity = vaddq_f64(vld1q_f64(v.velocity + i),
+                                         vmulq_f64(vsubq_f64(force, gravity), vdt));
+        float64x2_t y = vaddq_f64(vld1q_f64(v.y + i), vmulq_f64(velocity, vdt));
+        uint64x2_t below = vcltq_f64(y, zero);
+        uint64x2_t above = vcgtq_f64(y, y_max);
+        y = vbslq_f64(below, zero, vbslq_f64(above, y_max, y));
+        velocity = vbslq_f64(vorrq_u64(below, above), vmulq_f64(velocity, bounce), velocity);
+        vst1q_f64(v.y + i, y);
+        vst1q_f64(v.velocity + i, velocity);
+    }
+}
+#endif
+
+} // namespace
+
+void step_lanes_scalar(const BatchView& v, std::size_t begin, std::size_t end, double dt) {
+    dispatch_lanes(v, [&](auto measured, auto disturbed) {
+        dispatch_controller(v, [&](auto velocity, auto filtered, auto compensate) {
+            step_scalar<decltype(measured)::value, decltype(disturbed)::value, decltype(velocity)::value,
+                        decltype(filtered)::value, decltype(compensate)::value>(v, begin, end, dt);
+        });
+    });
+}
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+void step_lanes_neon(const BatchView& v, std::size_t begin, std::size_t end, double dt) {
+    dispatch_lanes(v, [&](auto measured, auto disturbed) {
+        step_neon<decltype(measured)::value, decltype(disturbed)::value>(v, begin, end, dt);
+    });
+}
+#endif
+
+BatchEngine::BatchEngine(std::size_t lanes) : BatchEngine(lanes, nullptr) {}
+
+BatchEngine::BatchEngine(std::size_t lanes, ThreadPool& pool) : BatchEngine(lanes, &pool) {}
+
+BatchEngine::BatchEngine(std::size_t lanes, ThreadPool* pool)
+        : lanes(lanes),
+          padded((lanes + LANE_PAD - 1) / LANE_PAD * LANE_PAD),
+          kernel(step_lanes_scalar),
+          schedule_kernel(schedule_lanes_scalar),
+          isa_name("scalar") {
+    // Reserved untouched; every element is written below
+    for (auto* a : {&kp, &ki, &kd, &setpoint, &integral, &prev_error, &y, &velocity, &disturbance}) {
+        a->resize(padded);
+    }
+    auto initialize = [this](std::size_t begin, std::size_t end, unsigned) {
+        for (std::size_t i = begin; i < end; ++i) {
+            set_gains(i, 80.0, 0, 0);
+            reset_lane(i);
+            disturbance[i] = 0.0;
+        }
+    };
+    if (pool) pool->parallel_for(padded, BLOCK_LANES, initialize);
+    else initialize(0, padded, 0);
+
+#if defined(__x86_64__) || defined(_M_X64)
+    if (cpu_has_avx2()) {
+        kernel = step_lanes_avx2;
+        schedule_kernel = schedule_lanes_avx2;
+        isa_name = "avx2";
+    }
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    kernel = step_lanes_neon;
+    isa_name = "neon";
+#endif
+    isa_kernel = kernel;
+    isa_kernel_name = isa_name;
+    select_kernel();
+}
+
+void BatchEngine::select_kernel() {
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+    const bool fallback = pid_form == PidForm::Velocity || filtered() || comp.any();
+#else
+    const bool fallback = false;
+#endif
+    kernel = fallback ? step_lanes_scalar : isa_kernel;
+    isa_name = fallback ? "scalar" : isa_kernel_name;
+    run_kernel = nullptr;
+#if defined(__x86_64__) || defined(_M_X64)
+    if (kernel == step_lanes_avx2 && pid_form == PidForm::Positional && !filtered() && !comp.any()) {
+        run_kernel = run_lanes_avx2(unroll_steps);
+    }
+#endif
+}
+
+void BatchEngine::set_unroll(unsigned steps) {
+    if (steps != 0 && steps != 1 && steps != 4 && steps != 8 && steps != 16) {
+        throw std::invalid_argument("unroll must be 0, 1, 4, 8 or 16 steps");
+    }
+    unroll_steps = steps;
+    select_kernel();
+}
+
+void BatchEngine::set_gains(std::size_t lane, double p, double i, double d) {
+    kp[lane] = p;
+    ki[lane] = i;
+    kd[lane] = d;
+}
+
+void BatchEngine::set_setpoint(std::size_t lane, double sp) {
+    setpoint[lane] = sp;
+}
+
+void BatchEngine::reset_lane(std::size_t lane) {
+    Ball initial;
+    setpoint[lane] = WINDOW_HEIGHT / 2.0;
+    integral[lane] = 0.0;
+    prev_error[lane] = 0.0;
+    if (!derivative.empty()) derivative[lane] = 0.0;
+    if (filtered()) prev_input[lane] = UNPRIMED;
+    if (observing()) reset_observer(lane);
+    y[lane] = initial.y;
+    velocity[lane] = initial.velocity;
+    if (sensing) fill_sensor_history(lane);
+}
+
+void BatchEngine::set_disturbance_enabled(bool enabled) {
+    disturbed = enabled;
+}
+
+void BatchEngine::set_form(PidForm form) {
+    pid_form = form;
+    std::fill(integral.begin(), integral.end(), 0.0);
+    std::fill(prev_error.begin(), prev_error.end(), 0.0);
+    std::fill(prev_input.begin(), prev_input.end(), UNPRIMED);
+    if (form == PidForm::Velocity || filtered()) derivative.assign(padded, 0.0);
+    else derivative = AlignedVector<double>();
+    if (observing()) {
+        for (std::size_t lane = 0; lane < padded; ++lane) reset_observer(lane);
+    }
+    select_kernel();
+}
+
+void BatchEngine::set_compensation(const Compensation& c) {
+    if (!std::isfinite(c.feed_forward)) throw std::invalid_argument("feed-forward must be finite");
+    if (!(c.observer_filter >= 0.0) || !std::isfinite(c.observer_filter)) {
+        throw std::invalid_argument("observer time constant must be finite and not negative");
+    }
+    comp = c;
+    if (c.observer) {
+        observer_pv1.assign(padded, UNPRIMED);
+        observer_pv2.assign(padded, UNPRIMED);
+        observer_output.assign(padded, 0.0);
+        observer_estimate.assign(padded, 0.0);
+    } else {
+        observer_pv1 = observer_pv2 = observer_output = observer_estimate = AlignedVector<double>();
+    }
+    select_kernel();
+}
+
+void BatchEngine::reset_observer(std::size_t lane) {
+    observer_pv1[lane] = UNPRIMED;
+    observer_pv2[lane] = UNPRIMED;
+    observer_output[lane] = 0.0;
+    observer_estimate[lane] = 0.0;
+}
+
+void BatchEngine::set_derivative_filter(double time_constant, bool on_measurement) {
+    if (!(time_constant >= 0.0) || !std::isfinite(time_constant)) {
+        throw std::invalid_argument("derivative filter time constant must be finite and not negative");
+    }
+    derivative_filter = time_constant;
+    measurement_weight = on_measurement ? 1.0 : 0.0;
+    if (on_measurement || time_constant > 0.0) {
+        prev_input.assign(padded, UNPRIMED);
+        derivative.assign(padded, 0.0);
+    } else {
+        prev_input = AlignedVector<double>();
+        if (pid_form == PidForm::Positional) derivative = AlignedVector<double>();
+    }
+    select_kernel();
+}
+
+void BatchEngine::set_sensor(const SensorModel& model) {
+    model.validate();
+    sensor_model = model;
+    sensing = !model.ideal();
+    if (!sensing) return;
+    measured.assign(padded, 0.0);
+    sensor_history.assign(padded * SENSOR_HISTORY, 0.0);
+    sensor_head.assign(padded, 0);
+    sensor_rng.clear();
+    sensor_rng.reserve(padded);
+    for (std::size_t i = 0; i < padded; ++i) {
+        sensor_rng.emplace_back(model.seed, i);
+        fill_sensor_history(i);
+    }
+}
+
+void BatchEngine::fill_sensor_history(std::size_t lane) {
+    double* history = sensor_history.data() + lane * SENSOR_HISTORY;
+    std::fill(history, history + SENSOR_HISTORY, y[lane] + PV_OFFSET);
+}
+
+// Sensor::measure for each lane, with the lane's ring in sensor_history
+void BatchEngine::sense(std::size_t begin, std::size_t end) {
+    constexpr unsigned MASK = SENSOR_HISTORY - 1;
+    for (std::size_t i = begin; i < end; ++i) {
+        double* history = sensor_history.data() + i * SENSOR_HISTORY;
+        unsigned head = (sensor_head[i] + 1) & MASK;
+        sensor_head[i] = head;
+        history[head] = sensor_model.sample(y[i] + PV_OFFSET, sensor_rng[i]);
+        measured[i] = history[(head - sensor_model.delay_steps) & MASK];
+    }
+}
+
+void BatchEngine::set_schedule(const GainSchedule* s) {
+    schedule = s;
+    schedule_phase = 0;
+    if (schedule) exact_pv.assign(padded, 0.0);
+}
+
+void BatchEngine::apply_schedule(std::size_t begin, std::size_t end) {
+    const double* pv = measured.data();
+    if (!sensing) {
+        for (std::size_t i = begin; i < end; ++i) exact_pv[i] = y[i] + PV_OFFSET;
+        pv = exact_pv.data();
+    }
+    const double *u, *v;
+    schedule->select_inputs(pv, velocity.data(), setpoint.data(), u, v);
+    schedule_kernel(schedule->view(), u, v, begin, end, kp.data(), ki.data(), kd.data());
+}
+
+BatchView BatchEngine::view() {
+    return {kp.data(), ki.data(), kd.data(), setpoint.data(),
+            integral.data(), prev_error.data(), y.data(), velocity.data(),
+            sensing ? measured.data() : nullptr, disturbed ? disturbance.data() : nullptr,
+            derivative.empty() ? nullptr : derivative.data(), pid_form == PidForm::Velocity,
+            filtered() ? prev_input.data() : nullptr, derivative_filter, measurement_weight,
+            comp.feed_forward, observing() ? observer_pv1.data() : nullptr,
+            observing() ? observer_pv2.data() : nullptr, observing() ? observer_output.data() : nullptr,
+            observing() ? observer_estimate.data() : nullptr, comp.observer_filter};
+}
+
+void BatchEngine::step(double dt) {
+    step_range(0, padded, dt);
+    if (schedule && ++schedule_phase == schedule->hold_steps()) schedule_phase = 0;
+}
+
+void BatchEngine::run(uint64_t steps, double dt) {
+    run_range(0, padded, steps, dt);
+    count_steps(steps);
+}
+
+void BatchEngine::count_steps(uint64_t steps) {
+    if (schedule) schedule_phase = static_cast<unsigned>((schedule_phase + steps) % schedule->hold_steps());
+}
+
+void BatchEngine::run_range(std::size_t begin, std::size_t end, uint64_t steps, double dt, uint64_t taken) {
+    if (begin % LANE_PAD || end % LANE_PAD || end > padded) {
+        throw std::out_of_range("BatchEngine::run_range: unaligned lane range");
+    }
+    BatchView v = view();
+    // Lanes are independent, so each cache-sized block runs every step before moving on
+    for (std::size_t block = begin; block < end; block += BLOCK_LANES) {
+        std::size_t block_end = std::min(block + BLOCK_LANES, end);
+        if (sensing || schedule) {
+            const unsigned hold = schedule ? schedule->hold_steps() : 1;
+            auto phase = static_cast<unsigned>((schedule_phase + taken) % hold);
+            for (uint64_t s = 0; s < steps; ++s) {
+                if (sensing) sense(block, block_end);
+                if (schedule && phase == 0) apply_schedule(block, block_end);
+                if (++phase == hold) phase = 0;
+                kernel(v, block, block_end, dt);
+            }
+        } else if (run_kernel && !disturbed) {
+            run_kernel(v, block, block_end, steps, dt);
+        } else {
+            for (uint64_t s = 0; s < steps; ++s) {
+                kernel(v, block, block_end, dt);
+            }
+        }
+    }
+}
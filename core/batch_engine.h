@@ -0,0 +1,164 @@
+#pragma once
+
+#include "aligned.h"
+#include "batch_kernels.h"
+#include "constants.h"
+#include "gain_schedule.h"
+#include "pid_controller.h"
+#include "sensor.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// N independent PID_Controller + Ball loops in structure-of-arrays form.
+// Lanes are stepped with the widest kernel the CPU supports; results match
+// the scalar Simulation::step reference bit for bit.
+class BatchEngine {
+public:
+    // Lane storage is padded so SIMD kernels never need a remainder loop
+    static constexpr std::size_t LANE_PAD = 8;
+    // Lanes advanced together through all steps of run(), sized to stay in L1
+    static constexpr std::size_t BLOCK_LANES = 256;
+
+    explicit BatchEngine(std::size_t lanes);
+    // Lane state is written first by the pool participant that steps it in
+    // a parallel_for over the lanes in BLOCK_LANES chunks, so with a pinned
+    // pool each block's state is local to its thread's NUMA node
+    BatchEngine(std::size_t lanes, ThreadPool& pool);
+
+    std::size_t size() const { return lanes; }
+    const char* isa() const { return isa_name; }
+
+    void set_gains(std::size_t lane, double kp, double ki, double kd);
+    void set_setpoint(std::size_t lane, double setpoint);
+    void reset_lane(std::size_t lane);  // controller and ball back to App's initial state
+
+    // Delay, quantization and noise between every ball and its controller,
+    // with each lane's history starting at its current position. Lane i
+    // draws noise from stream i, so it tracks Simulation::set_sensor(model, i).
+    // An ideal model turns the pipeline off again.
+    void set_sensor(const SensorModel& model);
+    const SensorModel& sensor() const { return sensor_model; }
+
+    // While enabled, disturbance[lane] is added to that lane's controller
+    // force on every step, e.g. an injected test signal. Off by default.
+    void set_disturbance_enabled(bool enabled);
+
+    // Every lane's controller form, as PID_Controller::set_form. Switching
+    // zeroes each lane's controller state rather than transferring it, so
+    // choose the form before stepping. A velocity lane keeps its held output
+    // in integral[] and one more value per lane, its previous error slope.
+    // NEON has no velocity kernel; those lanes step on the scalar one.
+    void set_form(PidForm form);
+    PidForm form() const { return pid_form; }
+
+    // Every lane's derivative as PID_Controller::derivative_filter and
+    // derivative_on_measurement, as a branch-free recurrence on the SIMD
+    // kernels (NEON steps these lanes on the scalar one). Lanes start with
+    // zero filter history, so set it before stepping. Throws
+    // std::invalid_argument for a negative or non-finite time constant.
+    void set_derivative_filter(double time_constant, bool on_measurement);
+
+    // Every lane's output compensation as PID_Controller::set_compensation:
+    // the feed-forward costs one add per lane-step, the observer four more
+    // arrays (NEON steps compensated lanes on the scalar kernel). Lanes
+    // start with no observer history, so set it before stepping. Throws
+    // std::invalid_argument for a non-finite feed-forward or a negative or
+    // non-finite observer time constant.
+    void set_compensation(const Compensation& compensation);
+    const Compensation& compensation() const { return comp; }
+    // `force`, lane's PID terms of the latest step, with that step's
+    // compensation applied as the kernel applied it
+    double compensated(std::size_t lane, double force) const {
+        if (observing()) force = force - observer_estimate[lane];
+        return comp.any() ? force + comp.feed_forward : force;
+    }
+
+    // Every lane's gains from `schedule` at its operating point, looked up
+    // after the sensor every hold_steps() steps, as Simulation::schedule
+    // does; set_gains() values are overwritten. step() and run() count the
+    // held steps; step_range() and run_range() start from that count and
+    // leave it alone. Not owned; nullptr turns scheduling off.
+    void set_schedule(const GainSchedule* schedule);
+
+    // Steps the register run kernel unrolls between loop tests: 1, 4, 8 or
+    // 16, or 0 to step every block one kernel call per step. run() and
+    // run_range() use the run kernel (AVX2 only) when no sensor, schedule,
+    // disturbance, velocity form, derivative filter or compensation needs
+    // memory between steps; results are bit-identical either way. Throws
+    // std::invalid_argument for any other count.
+    static constexpr unsigned DEFAULT_UNROLL = 4;
+    void set_unroll(unsigned steps);
+    unsigned unroll() const { return unroll_steps; }
+    // Whether run() currently takes the run kernel
+    bool register_run() const { return run_kernel != nullptr && !sensing && !schedule && !disturbed; }
+
+    void step(double dt);
+    void run(uint64_t steps, double dt = FIXED_TIMESTEP);
+    // Steps lanes [begin, end) `steps` times; begin/end must be multiples of
+    // LANE_PAD. `taken` steps since the held count have already run, so a
+    // range can finish a run() in two calls.
+    void run_range(std::size_t begin, std::size_t end, uint64_t steps, double dt, uint64_t taken = 0);
+    // Counts `steps` held steps, as run() does after its run_range(); for
+    // callers that cover every lane with ranges of their own
+    void count_steps(uint64_t steps);
+    // One step of lanes [begin, end), same alignment rule; for callers that
+    // reduce per-lane results between steps
+    void step_range(std::size_t begin, std::size_t end, double dt) {
+        if (sensing) sense(begin, end);
+        if (schedule && schedule_phase == 0) apply_schedule(begin, end);
+        kernel(view(), begin, end, dt);
+    }
+
+    FirstTouchVector<double> kp, ki, kd, setpoint;
+    FirstTouchVector<double> integral, prev_error, y, velocity;
+    FirstTouchVector<double> disturbance;
+
+private:
+    BatchEngine(std::size_t lanes, ThreadPool* pool);
+    BatchView view();
+    // Pushes one reading per lane into its delay line and loads `measured`
+    void sense(std::size_t begin, std::size_t end);
+    // Loads kp/ki/kd from the schedule
+    void apply_schedule(std::size_t begin, std::size_t end);
+    void fill_sensor_history(std::size_t lane);
+
+    std::size_t lanes;
+    std::size_t padded;
+    BatchKernel kernel;
+    ScheduleKernel schedule_kernel;
+    const char* isa_name;
+
+    // Picks the ISA's kernel, or the scalar one for variants it lacks
+    void select_kernel();
+    bool filtered() const { return !prev_input.empty(); }
+    bool observing() const { return !observer_estimate.empty(); }
+    void reset_observer(std::size_t lane);
+
+    BatchKernel isa_kernel;
+    const char* isa_kernel_name;
+    BatchRunKernel run_kernel = nullptr;  // plain-variant lanes only
+    unsigned unroll_steps = DEFAULT_UNROLL;
+    PidForm pid_form = PidForm::Positional;
+    double derivative_filter = 0.0;
+    double measurement_weight = 0.0;
+    AlignedVector<double> derivative;  // velocity form or filtered only: the previous step's derivative
+    AlignedVector<double> prev_input;  // filtered only: the derivative's previous input
+    Compensation comp;
+    // Observer only: each lane's previous two pv, output less feed-forward, estimate
+    AlignedVector<double> observer_pv1, observer_pv2, observer_output, observer_estimate;
+
+    SensorModel sensor_model;
+    bool sensing = false;
+    bool disturbed = false;
+    const GainSchedule* schedule = nullptr;
+    unsigned schedule_phase = 0;     // steps since the last lookup
+    AlignedVector<double> exact_pv;  // y + BALL_SIZE / 2 for scheduling without a sensor
+    AlignedVector<double> measured;        // pv the kernels see this step
+    AlignedVector<double> sensor_history;  // SENSOR_HISTORY readings per lane, lane-major
+    std::vector<unsigned> sensor_head;
+    std::vector<PhiloxStream> sensor_rng;
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Raw SoA view handed to the per-ISA step kernels. Every array holds at
+// least `end` elements and a kernel steps lanes [begin, end) once.
+struct BatchView {
+    const double* kp;
+    const double* ki;
+    const double* kd;
+    const double* setpoint;
+    double* integral;
+    double* prev_error;
+    double* y;
+    double* velocity;
+    // Measured pv per lane (BatchEngine's sensor pipeline), or nullptr for
+    // the exact y + BALL_SIZE / 2
+    const double* pv;
+    // External force added to each controller output, or nullptr for none
+    const double* disturbance;
+    // Each lane's previous derivative, for velocity-form or filtered
+    // controllers; nullptr otherwise
+    double* prev_derivative = nullptr;
+    // Velocity-form controllers (PidForm::Velocity), with `integral`
+    // holding each lane's output instead
+    bool velocity_form = false;
+    // Filtered or on-measurement derivative (PID_Controller::derivative_filter
+    // and derivative_on_measurement): each lane's previous derivative input
+    // x = (1 - measurement_weight) * error - measurement_weight * pv, with
+    // the weight 0 or 1, or NaN before a lane's first step (its dx is then
+    // 0). nullptr for the raw (e - e1) / dt. The NEON kernel has neither
+    // this nor the velocity variant.
+    double* prev_input = nullptr;
+    double derivative_filter = 0.0;  // Tf, s
+    double measurement_weight = 0.0;
+    // Output compensation (PID_Controller::feed_forward and its disturbance
+    // observer). With the observer, each lane's previous two pv (NaN until
+    // the lane has taken them, which holds its estimate), its previous
+    // output less the feed-forward and its estimate; nullptr without it.
+    // The NEON kernel has neither.
+    double feed_forward = 0.0;
+    double* observer_pv1 = nullptr;
+    double* observer_pv2 = nullptr;
+    double* observer_output = nullptr;
+    double* observer_estimate = nullptr;
+    double observer_filter = 0.0;  // Tq, s
+};
+
+// Compensation variants of the step kernels
+enum : int { COMPENSATE_NONE, COMPENSATE_FEED_FORWARD, COMPENSATE_OBSERVER };
+
+// Calls f(Measured, Disturbed), two std::bool_constant tags saying which
+// optional inputs of v are present, so kernels pick their variant once per
+// call instead of testing inside the lane loop
+template <class F>
+inline void dispatch_lanes(const BatchView& v, F&& f) {
+    if (v.pv) {
+        if (v.disturbance) f(std::true_type{}, std::true_type{});
+        else f(std::true_type{}, std::false_type{});
+    } else {
+        if (v.disturbance) f(std::false_type{}, std::true_type{});
+        else f(std::false_type{}, std::false_type{});
+    }
+}
+
+// Calls f(Velocity, Filtered, Compensate) for the controller variant of v,
+// as dispatch_lanes; Compensate is a std::integral_constant holding one of
+// the COMPENSATE_ values (the observer variant adds the feed-forward too)
+template <class F>
+inline void dispatch_controller(const BatchView& v, F&& f) {
+    auto compensated = [&](auto velocity, auto filtered) {
+        if (v.observer_estimate) f(velocity, filtered, std::integral_constant<int, COMPENSATE_OBSERVER>{});
+        else if (v.feed_forward != 0.0) f(velocity, filtered, std::integral_constant<int, COMPENSATE_FEED_FORWARD>{});
+        else f(velocity, filtered, std::integral_constant<int, COMPENSATE_NONE>{});
+    };
+    if (v.velocity_form) {
+        if (v.prev_input) compensated(std::true_type{}, std::true_type{});
+        else compensated(std::true_type{}, std::false_type{});
+    } else {
+        if (v.prev_input) compensated(std::false_type{}, std::true_type{});
+        else compensated(std::false_type{}, std::false_type{});
+    }
+}
+
+using BatchKernel = void (*)(const BatchView& v, std::size_t begin, std::size_t end, double dt);
+
+// `steps` steps of lanes [begin, end) at once, for the plain variant only
+// (no pv or disturbance, positional, raw derivative, uncompensated): each group of lanes
+// is loaded into registers, carried through every step and stored once,
+// so a step costs no loads or stores of state. Matches `steps` calls of
+// the step kernel bit for bit; begin and end must be multiples of 8.
+using BatchRunKernel = void (*)(const BatchView& v, std::size_t begin, std::size_t end, uint64_t steps, double dt);
+
+// State of the compact float32 layout (compact_sweep.h). Gains are either
+// float arrays, or 16-bit grid indices when kp_index is set: gain = base +
+// index * step, in float. iae[] takes |setpoint - pv| dt every step.
+struct CompactView {
+    const float* kp;
+    const float* ki;
+    const float* kd;
+    const uint16_t* kp_index;
+    const uint16_t* ki_index;
+    const uint16_t* kd_index;
+    float base[3];  // kp, ki, kd at index 0
+    float step[3];
+    float setpoint;
+    float* integral;
+    float* prev_error;
+    float* y;
+    float* velocity;
+    float* iae;
+};
+
+// One step of compact lanes [begin, end), the batch kernel's arithmetic in
+// float with the derivative as a multiply by 1/dt. The AVX2 kernel needs
+// begin and end to be multiples of 8; scalar and AVX2 results are identical.
+using CompactKernel = void (*)(const CompactView& v, std::size_t begin, std::size_t end, float dt);
+
+struct ScheduleView;  // gain_schedule.h
+
+// GainSchedule lookups for lanes [begin, end), with the operating point in
+// u[] and v[]; results match schedule_lookup() bit for bit. The AVX2 kernel
+// needs begin and end to be multiples of 4.
+using ScheduleKernel = void (*)(const ScheduleView& s, const double* u, const double* v, std::size_t begin,
+                                std::size_t end, double* kp, double* ki, double* kd);
+
+void step_lanes_scalar(const BatchView& v, std::size_t begin, std::size_t end, double dt);
+void step_compact_scalar(const CompactView& v, std::size_t begin, std::size_t end, float dt);
+void schedule_lanes_scalar(const ScheduleView& s, const double* u, const double* v, std::size_t begin,
+                           std::size_t end, double* kp, double* ki, double* kd);
+// stability.h's screen for candidates [begin, end): keep[i] = 1 when every
+// closed-loop pole lies inside `radius`. The arrays need no alignment; the
+// AVX2 kernel needs end - begin to be a multiple of 4.
+void screen_lanes_scalar(const double* kp, const double* ki, const double* kd, std::size_t begin, std::size_t end,
+                         double dt, double radius, uint8_t* keep);
+#if defined(__x86_64__) || defined(_M_X64)
+void step_lanes_avx2(const BatchView& v, std::size_t begin, std::size_t end, double dt);
+// The run kernel unrolling `unroll` steps (1, 4, 8 or 16); nullptr for any other count
+BatchRunKernel run_lanes_avx2(unsigned unroll);
+void step_compact_avx2(const CompactView& v, std::size_t begin, std::size_t end, float dt);
+void schedule_lanes_avx2(const ScheduleView& s, const double* u, const double* v, std::size_t begin,
+                         std::size_t end, double* kp, double* ki, double* kd);
+void screen_lanes_avx2(const double* kp, const double* ki, const double* kd, std::size_t begin, std::size_t end,
+                       double dt, double radius, uint8_t* keep);
+#endif
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+void step_lanes_neon(const BatchView& v, std::size_t begin, std::size_t end, double dt);
+#endif
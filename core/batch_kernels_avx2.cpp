@@ -0,0 +1,324 @@
+// Built with AVX2 code generation enabled; only called after a runtime CPU check.
+#include "batch_kernels.h"
+#include "constants.h"
+#include "gain_schedule.h"
+
+#include <immintrin.h>
+
+namespace {
+
+// Independent groups of four lanes a run kernel interleaves, enough for
+// one step's dependency chain (led by the derivative's divide) of each to
+// overlap the others'. Their state outgrows AVX2's 16 registers, but the
+// spills stay off those chains.
+constexpr int GROUPS = 8;
+
+template <bool Measured, bool Disturbed, bool Velocity, bool Filtered, int Compensate>
+void step_avx2(const BatchView& v, std::size_t begin, std::size_t end, double dt) {
+    const __m256d observer_gain = _mm256_set1_pd(dt / (v.observer_filter + dt));
+    const __m256d observer_keep = _mm256_set1_pd(v.observer_filter / (v.observer_filter + dt));
+    const __m256d dt2 = _mm256_set1_pd(dt * dt);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d feed_forward = _mm256_set1_pd(v.feed_forward);
+    const double filter_gain = 1.0 / (v.derivative_filter + dt);
+    const __m256d gain = _mm256_set1_pd(filter_gain);
+    const __m256d keep = _mm256_set1_pd(v.derivative_filter * filter_gain);
+    const __m256d error_weight = _mm256_set1_pd(1.0 - v.measurement_weight);
+    const __m256d measurement_weight = _mm256_set1_pd(v.measurement_weight);
+    const __m256d vdt = _mm256_set1_pd(dt);
+    const __m256d offset = _mm256_set1_pd(BALL_SIZE / 2);
+    const __m256d lo_limit = _mm256_set1_pd(Velocity ? -OUTPUT_LIMIT : -INTEGRAL_LIMIT);
+    const __m256d hi_limit = _mm256_set1_pd(Velocity ? OUTPUT_LIMIT : INTEGRAL_LIMIT);
+    const __m256d gravity = _mm256_set1_pd(GRAVITY);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d y_max = _mm256_set1_pd(WINDOW_HEIGHT - BALL_SIZE);
+    const __m256d bounce = _mm256_set1_pd(BOUNCE_COEFFICIENT);
+
+    for (std::size_t i = begin; i < end; i += 4) {
+        __m256d pv = Measured ? _mm256_load_pd(v.pv + i) : _mm256_add_pd(_mm256_load_pd(v.y + i), offset);
+        __m256d error = _mm256_sub_pd(_mm256_load_pd(v.setpoint + i), pv);
+        __m256d delta = _mm256_sub_pd(error, _mm256_load_pd(v.prev_error + i));
+        __m256d derivative;
+        if (Filtered) {
+            __m256d x = _mm256_sub_pd(_mm256_mul_pd(error_weight, error), _mm256_mul_pd(measurement_weight, pv));
+            __m256d x1 = _mm256_load_pd(v.prev_input + i);
+            x1 = _mm256_blendv_pd(x, x1, _mm256_cmp_pd(x1, x1, _CMP_ORD_Q));
+            derivative = _mm256_add_pd(_mm256_mul_pd(keep, _mm256_load_pd(v.prev_derivative + i)),
+                                       _mm256_mul_pd(gain, _mm256_sub_pd(x, x1)));
+            _mm256_store_pd(v.prev_input + i, x);
+        } else {
+            derivative = _mm256_div_pd(delta, vdt);
+        }
+        __m256d force;
+        if (Velocity) {
+            __m256d change = _mm256_add_pd(
+                _mm256_add_pd(_mm256_mul_pd(_mm256_load_pd(v.kp + i), delta),
+                              _mm256_mul_pd(_mm256_load_pd(v.ki + i), _mm256_mul_pd(error, vdt))),
+                _mm256_mul_pd(_mm256_load_pd(v.kd + i), _mm256_sub_pd(derivative, _mm256_load_pd(v.prev_derivative + i))));
+            force = _mm256_add_pd(_mm256_load_pd(v.integral + i), change);
+            force = _mm256_min_pd(_mm256_max_pd(force, lo_limit), hi_limit);
+            _mm256_store_pd(v.integral + i, force);
+        } else {
+            __m256d integral = _mm256_add_pd(_mm256_load_pd(v.integral + i), _mm256_mul_pd(error, vdt));
+            integral = _mm256_min_pd(_mm256_max_pd(integral, lo_limit), hi_limit);
+            force = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_load_pd(v.kp + i), error),
+                                                _mm256_mul_pd(_mm256_load_pd(v.ki + i), integral)),
+                                  _mm256_mul_pd(_mm256_load_pd(v.kd + i), derivative));
+            _mm256_store_pd(v.integral + i, integral);
+        }
+        if (Velocity || Filtered) _mm256_store_pd(v.prev_derivative + i, derivative);
+        if (Compensate == COMPENSATE_OBSERVER) {
+            __m256d pv1 = _mm256_load_pd(v.observer_pv1 + i);
+            __m256d w = _mm256_sub_pd(
+                _mm256_div_pd(_mm256_add_pd(_mm256_sub_pd(pv, _mm256_mul_pd(two, pv1)), _mm256_load_pd(v.observer_pv2 + i)),
+                              dt2),
+                _mm256_load_pd(v.observer_output + i));
+            __m256d estimate = _mm256_load_pd(v.observer_estimate + i);
+            __m256d updated = _mm256_add_pd(_mm256_mul_pd(observer_keep, estimate), _mm256_mul_pd(observer_gain, w));
+            estimate = _mm256_blendv_pd(estimate, updated, _mm256_cmp_pd(w, w, _CMP_ORD_Q));
+            _mm256_store_pd(v.observer_estimate + i, estimate);
+            _mm256_store_pd(v.observer_pv2 + i, pv1);
+            _mm256_store_pd(v.observer_pv1 + i, pv);
+            force = _mm256_sub_pd(force, estimate);
+            _mm256_store_pd(v.observer_output + i, force);
+        }
+        if (Compensate != COMPENSATE_NONE) force = _mm256_add_pd(force, feed_forward);
+        if (Disturbed) force = _mm256_add_pd(force, _mm256_load_pd(v.disturbance + i));
+        _mm256_store_pd(v.prev_error + i, error);
+
+        __m256d velocity = _mm256_add_pd(_mm256_load_pd(v.velocity + i),
+                                         _mm256_mul_pd(_mm256_sub_pd(force, gravity), vdt));
+        __m256d y = _mm256_add_pd(_mm256_load_pd(v.y + i), _mm256_mul_pd(velocity, vdt));
+        __m256d below = _mm256_cmp_pd(y, zero, _CMP_LT_OQ);
+        __m256d above = _mm256_cmp_pd(y, y_max, _CMP_GT_OQ);
+        y = _mm256_blendv_pd(_mm256_blendv_pd(y, y_max, above), zero, below);
+        velocity = _mm256_blendv_pd(velocity, _mm256_mul_pd(velocity, bounce), _mm256_or_pd(below, above));
+        _mm256_store_pd(v.y + i, y);
+        _mm256_store_pd(v.velocity + i, velocity);
+    }
+}
+
+// step_avx2<false, false, false, false, COMPENSATE_NONE> `steps` times over lanes [begin,
+// end) with each group of 4 * Groups lanes loaded once, carried in
+// registers through every step and stored once; the groups are
+// independent, so their dependency chains overlap. The step loop runs
+// Unroll steps per test.
+template <int Groups, int Unroll>
+void run_avx2(const BatchView& v, std::size_t begin, std::size_t end, uint64_t steps, double dt) {
+    const __m256d vdt = _mm256_set1_pd(dt);
+    const __m256d offset = _mm256_set1_pd(BALL_SIZE / 2);
+    const __m256d lo_limit = _mm256_set1_pd(-INTEGRAL_LIMIT);
+    const __m256d hi_limit = _mm256_set1_pd(INTEGRAL_LIMIT);
+    const __m256d gravity = _mm256_set1_pd(GRAVITY);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d y_max = _mm256_set1_pd(WINDOW_HEIGHT - BALL_SIZE);
+    const __m256d bounce = _mm256_set1_pd(BOUNCE_COEFFICIENT);
+
+    if (Groups > 2 && (end - begin) % (4 * Groups)) {
+        // A ragged end of fewer than 4 * Groups lanes goes eight at a time
+        const std::size_t split = end - (end - begin) % (4 * Groups);
+        run_avx2<2, Unroll>(v, split, end, steps, dt);
+        end = split;
+    }
+    for (std::size_t i = begin; i < end; i += 4 * Groups) {
+        __m256d integral[Groups], prev_error[Groups], y[Groups], velocity[Groups];
+        for (int g = 0; g < Groups; ++g) {
+            integral[g] = _mm256_load_pd(v.integral + i + 4 * g);
+            prev_error[g] = _mm256_load_pd(v.prev_error + i + 4 * g);
+            y[g] = _mm256_load_pd(v.y + i + 4 * g);
+            velocity[g] = _mm256_load_pd(v.velocity + i + 4 * g);
+        }
+        // Gains and setpoints never change; they are read from L1 as operands
+        auto step = [&] {
+            for (int g = 0; g < Groups; ++g) {
+                const std::size_t at = i + 4 * g;
+                __m256d error = _mm256_sub_pd(_mm256_load_pd(v.setpoint + at), _mm256_add_pd(y[g], offset));
+                __m256d derivative = _mm256_div_pd(_mm256_sub_pd(error, prev_error[g]), vdt);
+                integral[g] = _mm256_min_pd(_mm256_max_pd(_mm256_add_pd(integral[g], _mm256_mul_pd(error, vdt)), lo_limit),
+                                            hi_limit);
+                __m256d force = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_load_pd(v.kp + at), error),
+                                                            _mm256_mul_pd(_mm256_load_pd(v.ki + at), integral[g])),
+                                              _mm256_mul_pd(_mm256_load_pd(v.kd + at), derivative));
+                prev_error[g] = error;
+                __m256d vel = _mm256_add_pd(velocity[g], _mm256_mul_pd(_mm256_sub_pd(force, gravity), vdt));
+                __m256d pos = _mm256_add_pd(y[g], _mm256_mul_pd(vel, vdt));
+                __m256d below = _mm256_cmp_pd(pos, zero, _CMP_LT_OQ);
+                __m256d above = _mm256_cmp_pd(pos, y_max, _CMP_GT_OQ);
+                y[g] = _mm256_blendv_pd(_mm256_blendv_pd(pos, y_max, above), zero, below);
+                velocity[g] = _mm256_blendv_pd(vel, _mm256_mul_pd(vel, bounce), _mm256_or_pd(below, above));
+            }
+        };
+        uint64_t s = 0;
+        for (; s + Unroll <= steps; s += Unroll) {
+            for (int k = 0; k < Unroll; ++k) step();
+        }
+        for (; s < steps; ++s) step();
+        for (int g = 0; g < Groups; ++g) {
+            _mm256_store_pd(v.integral + i + 4 * g, integral[g]);
+            _mm256_store_pd(v.prev_error + i + 4 * g, prev_error[g]);
+            _mm256_store_pd(v.y + i + 4 * g, y[g]);
+            _mm256_store_pd(v.velocity + i + 4 * g, velocity[g]);
+        }
+    }
+}
+
+template <bool Grid>
+void compact_avx2(const CompactView& v, std::size_t begin, std::size_t end, float dt) {
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 inv_dt = _mm256_set1_ps(1.0f / dt);
+    const __m256 offset = _mm256_set1_ps(BALL_SIZE / 2);
+    const __m256 lo_limit = _mm256_set1_ps(-INTEGRAL_LIMIT);
+    const __m256 hi_limit = _mm256_set1_ps(INTEGRAL_LIMIT);
+    const __m256 gravity = _mm256_set1_ps(GRAVITY);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 y_max = _mm256_set1_ps(WINDOW_HEIGHT - BALL_SIZE);
+    const __m256 bounce = _mm256_set1_ps(BOUNCE_COEFFICIENT);
+    const __m256 setpoint = _mm256_set1_ps(v.setpoint);
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 base[3], step[3];
+    for (int g = 0; g < 3; ++g) {
+        base[g] = _mm256_set1_ps(v.base[g]);
+        step[g] = _mm256_set1_ps(v.step[g]);
+    }
+    auto gain = [&](int g, const float* f, const uint16_t* index, std::size_t i) {
+        if (!Grid) return _mm256_load_ps(f + i);
+        __m256i wide = _mm256_cvtepu16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(index + i)));
+        return _mm256_add_ps(base[g], _mm256_mul_ps(_mm256_cvtepi32_ps(wide), step[g]));
+    };
+
+    for (std::size_t i = begin; i < end; i += 8) {
+        __m256 error = _mm256_sub_ps(setpoint, _mm256_add_ps(_mm256_load_ps(v.y + i), offset));
+        __m256 integral = _mm256_add_ps(_mm256_load_ps(v.integral + i), _mm256_mul_ps(error, vdt));
+        integral = _mm256_min_ps(_mm256_max_ps(integral, lo_limit), hi_limit);
+        __m256 derivative = _mm256_mul_ps(_mm256_sub_ps(error, _mm256_load_ps(v.prev_error + i)), inv_dt);
+        __m256 force = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gain(0, v.kp, v.kp_index, i), error),
+                                                   _mm256_mul_ps(gain(1, v.ki, v.ki_index, i), integral)),
+                                     _mm256_mul_ps(gain(2, v.kd, v.kd_index, i), derivative));
+        _mm256_store_ps(v.integral + i, integral);
+        _mm256_store_ps(v.prev_error + i, error);
+
+        __m256 velocity = _mm256_add_ps(_mm256_load_ps(v.velocity + i), _mm256_mul_ps(_mm256_sub_ps(force, gravity), vdt));
+        __m256 y = _mm256_add_ps(_mm256_load_ps(v.y + i), _mm256_mul_ps(velocity, vdt));
+        __m256 below = _mm256_cmp_ps(y, zero, _CMP_LT_OQ);
+        __m256 above = _mm256_cmp_ps(y, y_max, _CMP_GT_OQ);
+        y = _mm256_blendv_ps(_mm256_blendv_ps(y, y_max, above), zero, below);
+        velocity = _mm256_blendv_ps(velocity, _mm256_mul_ps(velocity, bounce), _mm256_or_ps(below, above));
+        _mm256_store_ps(v.y + i, y);
+        _mm256_store_ps(v.velocity + i, velocity);
+
+        __m256 miss = _mm256_and_ps(_mm256_sub_ps(setpoint, _mm256_add_ps(y, offset)), abs_mask);
+        _mm256_store_ps(v.iae + i, _mm256_add_ps(_mm256_load_ps(v.iae + i), _mm256_mul_ps(miss, vdt)));
+    }
+}
+
+// schedule_cell() for four lanes; the indices come back as int32s
+__m128i cells_avx2(const ScheduleView& s, int a, __m256d x, __m256d& frac) {
+    __m256d t = _mm256_mul_pd(_mm256_sub_pd(x, _mm256_set1_pd(s.min[a])), _mm256_set1_pd(s.scale[a]));
+    t = _mm256_max_pd(t, _mm256_setzero_pd());
+    t = _mm256_min_pd(t, _mm256_set1_pd(s.span[a]));
+    __m128i i = _mm_min_epi32(_mm256_cvttpd_epi32(t), _mm_set1_epi32(s.last_cell[a]));
+    frac = _mm256_sub_pd(t, _mm256_cvtepi32_pd(i));
+    return i;
+}
+
+} // namespace
+
+// Indices and fractions four lanes at a time; then each lane's four nodes
+// are four aligned loads of (kp, ki, kd, 0) and blend as one vector, and a
+// 4x4 transpose turns the per-lane vectors back into the SoA gain arrays
+void schedule_lanes_avx2(const ScheduleView& s, const double* u, const double* v, std::size_t begin,
+                         std::size_t end, double* kp, double* ki, double* kd) {
+    const std::ptrdiff_t row = s.stride * 4;
+    const __m128i stride = _mm_set1_epi32(static_cast<int>(s.stride));
+    alignas(32) double fu[4], fv[4];
+    alignas(16) int offset[4];
+    for (std::size_t i = begin; i < end; i += 4) {
+        __m256d wu, wv;
+        __m128i iu = cells_avx2(s, 0, _mm256_loadu_pd(u + i), wu);
+        __m128i iv = cells_avx2(s, 1, _mm256_loadu_pd(v + i), wv);
+        _mm256_store_pd(fu, wu);
+        _mm256_store_pd(fv, wv);
+        _mm_store_si128(reinterpret_cast<__m128i*>(offset),
+                        _mm_slli_epi32(_mm_add_epi32(_mm_mullo_epi32(iv, stride), iu), 2));
+
+        __m256d g[4];
+        for (int k = 0; k < 4; ++k) {
+            const double* a = s.nodes + offset[k];
+            const double* c = a + row;
+            __m256d su = _mm256_broadcast_sd(fu + k), sv = _mm256_broadcast_sd(fv + k);
+            __m256d a0 = _mm256_load_pd(a), c0 = _mm256_load_pd(c);
+            __m256d lo = _mm256_add_pd(a0, _mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(a + 4), a0), su));
+            __m256d hi = _mm256_add_pd(c0, _mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(c + 4), c0), su));
+            g[k] = _mm256_add_pd(lo, _mm256_mul_pd(_mm256_sub_pd(hi, lo), sv));
+        }
+        __m256d p01 = _mm256_unpacklo_pd(g[0], g[1]);  // kp0 kp1 kd0 kd1
+        __m256d i01 = _mm256_unpackhi_pd(g[0], g[1]);  // ki0 ki1 0 0
+        __m256d p23 = _mm256_unpacklo_pd(g[2], g[3]);
+        __m256d i23 = _mm256_unpackhi_pd(g[2], g[3]);
+        _mm256_storeu_pd(kp + i, _mm256_permute2f128_pd(p01, p23, 0x20));
+        _mm256_storeu_pd(kd + i, _mm256_permute2f128_pd(p01, p23, 0x31));
+        _mm256_storeu_pd(ki + i, _mm256_permute2f128_pd(i01, i23, 0x20));
+    }
+}
+
+void step_compact_avx2(const CompactView& v, std::size_t begin, std::size_t end, float dt) {
+    if (v.kp_index) compact_avx2<true>(v, begin, end, dt);
+    else compact_avx2<false>(v, begin, end, dt);
+}
+
+void step_lanes_avx2(const BatchView& v, std::size_t begin, std::size_t end, double dt) {
+    dispatch_lanes(v, [&](auto measured, auto disturbed) {
+        dispatch_controller(v, [&](auto velocity, auto filtered, auto compensate) {
+            step_avx2<decltype(measured)::value, decltype(disturbed)::value, decltype(velocity)::value,
+                      decltype(filtered)::value, decltype(compensate)::value>(v, begin, end, dt);
+        });
+    });
+}
+
+BatchRunKernel run_lanes_avx2(unsigned unroll) {
+    switch (unroll) {
+        case 1: return run_avx2<GROUPS, 1>;
+        case 4: return run_avx2<GROUPS, 4>;
+        case 8: return run_avx2<GROUPS, 8>;
+        case 16: return run_avx2<GROUPS, 16>;
+        default: return nullptr;
+    }
+}
+
+void screen_lanes_avx2(const double* kp, const double* ki, const double* kd, std::size_t begin, std::size_t end,
+                       double dt, double radius, uint8_t* keep) {
+    const double r2 = radius * radius, r3 = r2 * radius;
+    const double dt2 = dt * dt, dt3 = dt2 * dt;
+    const __m256d vr = _mm256_set1_pd(radius), vr2 = _mm256_set1_pd(r2), vr3 = _mm256_set1_pd(r3);
+    const __m256d vdt = _mm256_set1_pd(dt), vdt2 = _mm256_set1_pd(dt2), vdt3 = _mm256_set1_pd(dt3);
+    const __m256d one = _mm256_set1_pd(1.0), two = _mm256_set1_pd(2.0), three = _mm256_set1_pd(3.0);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    auto abs = [&](__m256d x) { return _mm256_andnot_pd(sign, x); };
+    auto gt = [](__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); };
+
+    for (std::size_t i = begin; i < end; i += 4) {
+        __m256d p = _mm256_mul_pd(_mm256_loadu_pd(kp + i), vdt2);
+        __m256d vki = _mm256_loadu_pd(ki + i);
+        __m256d q = _mm256_mul_pd(vki, vdt3);
+        __m256d d = _mm256_mul_pd(_mm256_loadu_pd(kd + i), vdt);
+
+        __m256d a2 = _mm256_div_pd(_mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_set1_pd(-3.0), p), q), d), vr);
+        __m256d a1 = _mm256_div_pd(_mm256_sub_pd(_mm256_sub_pd(three, p), _mm256_mul_pd(two, d)), vr2);
+        __m256d a0 = _mm256_div_pd(_mm256_sub_pd(d, one), vr3);
+        __m256d cubic = _mm256_cmp_pd(abs(a0), one, _CMP_LT_OQ);
+        cubic = _mm256_and_pd(cubic, gt(_mm256_add_pd(_mm256_add_pd(_mm256_add_pd(one, a2), a1), a0), zero));
+        cubic = _mm256_and_pd(cubic, gt(_mm256_sub_pd(_mm256_add_pd(_mm256_sub_pd(one, a2), a1), a0), zero));
+        cubic = _mm256_and_pd(cubic, gt(_mm256_sub_pd(one, _mm256_mul_pd(a0, a0)),
+                                        abs(_mm256_sub_pd(_mm256_mul_pd(a0, a2), a1))));
+
+        __m256d b1 = _mm256_div_pd(_mm256_add_pd(_mm256_add_pd(_mm256_set1_pd(-2.0), p), d), vr);
+        __m256d b0 = _mm256_div_pd(_mm256_sub_pd(one, d), vr2);
+        __m256d quadratic = _mm256_cmp_pd(abs(b0), one, _CMP_LT_OQ);
+        quadratic = _mm256_and_pd(quadratic, gt(_mm256_add_pd(_mm256_add_pd(one, b1), b0), zero));
+        quadratic = _mm256_and_pd(quadratic, gt(_mm256_add_pd(_mm256_sub_pd(one, b1), b0), zero));
+
+        int mask = _mm256_movemask_pd(_mm256_blendv_pd(cubic, quadratic, _mm256_cmp_pd(vki, zero, _CMP_EQ_OQ)));
+        for (int k = 0; k < 4; ++k) keep[i + k] = static_cast<uint8_t>((mask >> k) & 1);
+    }
+}
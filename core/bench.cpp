@@ -0,0 +1,21 @@
+#include "bench.h"
+
+#include <cstring>
+
+BenchResult run_benchmark(uint64_t steps) {
+    Simulation sim;
+    BenchResult result;
+    result.stats = run_headless(sim, steps, FIXED_TIMESTEP);
+    result.final_y = sim.ball.y;
+    std::memcpy(&result.checksum, &result.final_y, sizeof(result.checksum));
+    return result;
+}
+
+void print_benchmark(const BenchResult& result, std::FILE* out) {
+    std::fprintf(out, "steps        %llu\n", static_cast<unsigned long long>(result.stats.steps));
+    std::fprintf(out, "wall time    %.3f s\n", result.stats.seconds);
+    std::fprintf(out, "steps/sec    %.0f\n", result.stats.steps_per_second());
+    std::fprintf(out, "ns/step      %.3f\n", result.stats.ns_per_step());
+    std::fprintf(out, "final y      %.17g\n", result.final_y);
+    std::fprintf(out, "checksum     %016llx\n", static_cast<unsigned long long>(result.checksum));
+}
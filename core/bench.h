@@ -0,0 +1,16 @@
+#pragma once
+
+#include "simulation.h"
+
+#include <cstdint>
+#include <cstdio>
+
+struct BenchResult {
+    RunStats stats;
+    double final_y = 0.0;
+    uint64_t checksum = 0;  // bit pattern of final_y, so the loop can't be elided
+};
+
+// Runs the default closed loop (App's initial state) for the given number of steps
+BenchResult run_benchmark(uint64_t steps);
+void print_benchmark(const BenchResult& result, std::FILE* out);
@@ -0,0 +1,125 @@
+#include "collisions.h"
+#include "constants.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr double Y_MAX = WINDOW_HEIGHT - BALL_SIZE;
+constexpr double RESTITUTION = -BOUNCE_COEFFICIENT;
+
+} // namespace
+
+BallCollider::BallCollider(std::vector<double> x_positions, double diameter)
+        : x(std::move(x_positions)), reach(diameter) {
+    if (!(diameter > 0.0)) throw std::invalid_argument("ball diameter must be positive");
+    if (x.size() > UINT32_MAX) throw std::invalid_argument("too many balls for one collider");
+    inv_cell = 1.0 / diameter;
+    double x_max = 0.0;
+    for (double v : x) x_max = std::max(x_max, v);
+    cols = static_cast<std::size_t>(x_max * inv_cell) + 1;
+    rows = static_cast<std::size_t>(Y_MAX * inv_cell) + 1;
+
+    const std::size_t n = x.size();
+    cell_of.resize(n);
+    start.resize(cols * rows + 1);
+    order.resize(n);
+    sx.resize(n);
+    sy.resize(n);
+    sv.resize(n);
+    ny.resize(n);
+    nv.resize(n);
+}
+
+void BallCollider::build(const double* y, const double* velocity) {
+    const std::size_t n = x.size();
+    std::fill(start.begin(), start.end(), 0u);
+    for (std::size_t i = 0; i < n; ++i) {
+        auto cx = static_cast<std::size_t>(std::max(x[i], 0.0) * inv_cell);
+        auto cy = static_cast<std::size_t>(std::clamp(y[i], 0.0, Y_MAX) * inv_cell);
+        uint32_t c = static_cast<uint32_t>(std::min(cy, rows - 1) * cols + std::min(cx, cols - 1));
+        cell_of[i] = c;
+        ++start[c + 1];
+    }
+    for (std::size_t c = 1; c < start.size(); ++c) start[c] += start[c - 1];
+    // start[c] now counts balls before cell c; bump a cursor per cell and
+    // restore it afterwards, so no second array is needed
+    for (std::size_t i = 0; i < n; ++i) {
+        uint32_t slot = start[cell_of[i]]++;
+        order[slot] = static_cast<uint32_t>(i);
+        sx[slot] = x[i];
+        sy[slot] = y[i];
+        sv[slot] = velocity[i];
+    }
+    for (std::size_t c = start.size() - 1; c > 0; --c) start[c] = start[c - 1];
+    start[0] = 0;
+}
+
+std::size_t BallCollider::resolve_rows(std::size_t row_begin, std::size_t row_end, double inv_dt) {
+    const double d2 = reach * reach;
+    const double half_restitution = 0.5 * (1.0 + RESTITUTION);
+    std::size_t touching = 0;
+    for (std::size_t r = row_begin; r < row_end; ++r) {
+        const std::size_t r0 = r > 0 ? r - 1 : 0, r1 = std::min(r + 1, rows - 1);
+        for (std::size_t c = 0; c < cols; ++c) {
+            const std::size_t c0 = c > 0 ? c - 1 : 0, c1 = std::min(c + 1, cols - 1);
+            for (uint32_t s = start[r * cols + c]; s < start[r * cols + c + 1]; ++s) {
+                const double xi = sx[s], yi = sy[s], vi = sv[s];
+                double push = 0.0, impulse = 0.0;
+                for (std::size_t nr = r0; nr <= r1; ++nr) {
+                    // Cells c0..c1 of one row are contiguous in sorted order
+                    const uint32_t end = start[nr * cols + c1 + 1];
+                    for (uint32_t t = start[nr * cols + c0]; t < end; ++t) {
+                        double dx = sx[t] - xi, dy = sy[t] - yi;
+                        double gap2 = dx * dx + dy * dy;
+                        if (gap2 >= d2 || t == s) continue;
+                        // The centres must be `reach` apart, and only y can move
+                        double overlap = std::sqrt(d2 - dx * dx) - std::fabs(dy);
+                        // Coincident balls split by slot, the lower one going up
+                        double away = dy != 0.0 ? (dy > 0.0 ? -1.0 : 1.0) : (t > s ? -1.0 : 1.0);
+                        // A partner held by a wall cannot give way, so this ball takes all of it
+                        bool held = away > 0.0 ? sy[t] <= 0.0 : sy[t] >= Y_MAX;
+                        push += (held ? 1.0 : 0.5) * overlap * away;
+                        double closing = sv[t] - vi;
+                        if (closing * away < 0.0) impulse += half_restitution * closing;
+                        touching += t > s;
+                    }
+                }
+                ny[s] = yi + push;
+                nv[s] = vi + impulse + push * inv_dt;
+            }
+        }
+    }
+    return touching;
+}
+
+void BallCollider::resolve(double* y, double* velocity, double dt, ThreadPool* pool) {
+    if (!(dt > 0.0)) throw std::invalid_argument("collision step must be positive");
+    const double inv_dt = 1.0 / dt;
+    build(y, velocity);
+    found.store(0, std::memory_order_relaxed);
+    if (pool && rows > GRAIN_ROWS) {
+        pool->parallel_for(rows, GRAIN_ROWS, [this, inv_dt](std::size_t begin, std::size_t end, unsigned) {
+            found.fetch_add(resolve_rows(begin, end, inv_dt), std::memory_order_relaxed);
+        });
+    } else {
+        found.store(resolve_rows(0, rows, inv_dt), std::memory_order_relaxed);
+    }
+    pairs = found.load(std::memory_order_relaxed);
+
+    for (std::size_t s = 0; s < order.size(); ++s) {
+        double yi = ny[s], vi = nv[s];
+        if (yi < 0.0) {
+            yi = 0.0;
+            vi *= BOUNCE_COEFFICIENT;
+        } else if (yi > Y_MAX) {
+            yi = Y_MAX;
+            vi *= BOUNCE_COEFFICIENT;
+        }
+        y[order[s]] = yi;
+        velocity[order[s]] = vi;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "aligned.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Ball-ball contacts for many balls that each keep a fixed x and move in y,
+// as the --scene balls do. Balls are discs of one diameter; a touching pair
+// is pushed apart along y and exchanges y momentum with the wall bounce's
+// restitution, the counterpart of Ball's wall handling between balls. The
+// push is also kept as velocity over the step, as position-based solvers
+// do, so a pile squeezed by its controllers stops closing instead of
+// sinking further into itself step after step.
+//
+// Every resolve() rebuilds a uniform grid of diameter-sized cells with a
+// counting sort (count per cell, prefix sum, stable scatter), gathering the
+// balls' state into cell order, so a ball only meets the balls of its 3x3
+// block of cells and those sit next to each other in memory. Each ball's
+// correction is summed from the state before the pass and written to its
+// own slot, so rows of cells are independent: they run in parallel on a
+// ThreadPool, and the result does not depend on the thread count.
+class BallCollider {
+public:
+    // Grid rows handed to a pool participant at a time
+    static constexpr std::size_t GRAIN_ROWS = 8;
+
+    // x[i] is ball i's horizontal centre. resolve() takes Ball::y, which is
+    // the same distance from the centre for every ball, and Ball's walls.
+    BallCollider(std::vector<double> x, double diameter);
+
+    std::size_t size() const { return x.size(); }
+    double diameter() const { return reach; }
+
+    // One contact pass over y[0, size()) and velocity[0, size()) after a
+    // step of dt, then the arena walls as Ball applies them; `pool` may be
+    // null to run inline
+    void resolve(double* y, double* velocity, double dt, ThreadPool* pool = nullptr);
+
+    // Touching pairs found by the latest resolve(), each counted once
+    uint64_t contacts() const { return pairs; }
+
+private:
+    void build(const double* y, const double* velocity);
+    std::size_t resolve_rows(std::size_t row_begin, std::size_t row_end, double inv_dt);
+
+    std::vector<double> x;
+    double reach;
+    double inv_cell;
+    std::size_t cols, rows;
+
+    std::vector<uint32_t> cell_of;   // per ball
+    std::vector<uint32_t> start;     // first sorted slot of each cell, plus an end marker
+    std::vector<uint32_t> order;     // ball in each sorted slot
+    AlignedVector<double> sx, sy, sv;  // state in sorted order
+    AlignedVector<double> ny, nv;      // corrected state in sorted order
+    uint64_t pairs = 0;
+    std::atomic<uint64_t> found{0};
+};
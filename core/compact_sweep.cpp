@@ -0,0 +1,224 @@
+#include "compact_sweep.h"
+#include "ball.h"
+#include "batch_engine.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr float PV_OFFSET = BALL_SIZE / 2;
+constexpr float Y_MAX = WINDOW_HEIGHT - BALL_SIZE;
+constexpr float LIMIT = static_cast<float>(INTEGRAL_LIMIT);
+constexpr float GRAVITY_F = static_cast<float>(GRAVITY);
+constexpr float BOUNCE_F = static_cast<float>(BOUNCE_COEFFICIENT);
+
+// Steps between folds of the float IAE into the double total; short enough
+// that a float sum of this many terms loses nothing that matters
+constexpr uint64_t IAE_FOLD_STEPS = 256;
+
+bool cpu_has_avx2() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+float step_of(const GainRange& r) {
+    return r.count > 1 ? static_cast<float>((r.max - r.min) / static_cast<double>(r.count - 1)) : 0.0f;
+}
+
+// The AVX2 kernel's operations in the same order, one lane at a time
+template <bool Grid>
+void compact_scalar(const CompactView& v, std::size_t begin, std::size_t end, float dt) {
+    const float inv_dt = 1.0f / dt;
+    for (std::size_t i = begin; i < end; ++i) {
+        float kp = Grid ? v.base[0] + static_cast<float>(v.kp_index[i]) * v.step[0] : v.kp[i];
+        float ki = Grid ? v.base[1] + static_cast<float>(v.ki_index[i]) * v.step[1] : v.ki[i];
+        float kd = Grid ? v.base[2] + static_cast<float>(v.kd_index[i]) * v.step[2] : v.kd[i];
+        float error = v.setpoint - (v.y[i] + PV_OFFSET);
+        float integral = std::min(std::max(v.integral[i] + error * dt, -LIMIT), LIMIT);
+        float derivative = (error - v.prev_error[i]) * inv_dt;
+        float force = kp * error + ki * integral + kd * derivative;
+        v.integral[i] = integral;
+        v.prev_error[i] = error;
+
+        float velocity = v.velocity[i] + (force - GRAVITY_F) * dt;
+        float y = v.y[i] + velocity * dt;
+        bool below = y < 0;
+        bool above = y > Y_MAX;
+        y = below ? 0.0f : (above ? Y_MAX : y);
+        v.y[i] = y;
+        v.velocity[i] = (below || above) ? velocity * BOUNCE_F : velocity;
+        v.iae[i] += std::fabs(v.setpoint - (y + PV_OFFSET)) * dt;
+    }
+}
+
+} // namespace
+
+void step_compact_scalar(const CompactView& v, std::size_t begin, std::size_t end, float dt) {
+    if (v.kp_index) compact_scalar<true>(v, begin, end, dt);
+    else compact_scalar<false>(v, begin, end, dt);
+}
+
+bool parse_compact_gains(const char* name, CompactGains& out) {
+    if (!std::strcmp(name, "f32")) out = CompactGains::Float32;
+    else if (!std::strcmp(name, "grid16")) out = CompactGains::Grid16;
+    else return false;
+    return true;
+}
+
+const char* compact_gains_name(CompactGains gains) {
+    return gains == CompactGains::Grid16 ? "grid16" : "f32";
+}
+
+CompactEngine::CompactEngine(std::size_t lanes, CompactGains gains, const SweepConfig& grid)
+        : lanes(lanes),
+          padded((lanes + LANE_PAD - 1) / LANE_PAD * LANE_PAD),
+          layout(gains),
+          grid(grid),
+          kernel(step_compact_scalar),
+          isa_name("scalar") {
+    if (gains == CompactGains::Grid16 && (grid.kp.count > 65536 || grid.ki.count > 65536 || grid.kd.count > 65536)) {
+        throw std::invalid_argument("grid16 gains take at most 65536 points per axis");
+    }
+    Ball initial;
+    y.assign(padded, static_cast<float>(initial.y));
+    velocity.assign(padded, static_cast<float>(initial.velocity));
+    integral.assign(padded, 0.0f);
+    prev_error.assign(padded, 0.0f);
+    iae.assign(padded, 0.0f);
+    if (gains == CompactGains::Grid16) {
+        for (auto* a : {&kp_index, &ki_index, &kd_index}) a->assign(padded, 0);
+    } else {
+        for (auto* a : {&kp, &ki, &kd}) a->assign(padded, 0.0f);
+    }
+#if defined(__x86_64__) || defined(_M_X64)
+    if (cpu_has_avx2()) {
+        kernel = step_compact_avx2;
+        isa_name = "avx2";
+    }
+#endif
+}
+
+std::size_t CompactEngine::bytes_per_lane() const {
+    return 5 * sizeof(float) + (layout == CompactGains::Grid16 ? 3 * sizeof(uint16_t) : 3 * sizeof(float));
+}
+
+void CompactEngine::set_cell(std::size_t lane, std::size_t i, std::size_t j, std::size_t k) {
+    if (layout == CompactGains::Grid16) {
+        kp_index[lane] = static_cast<uint16_t>(i);
+        ki_index[lane] = static_cast<uint16_t>(j);
+        kd_index[lane] = static_cast<uint16_t>(k);
+    } else {
+        kp[lane] = static_cast<float>(grid.kp.at(i));
+        ki[lane] = static_cast<float>(grid.ki.at(j));
+        kd[lane] = static_cast<float>(grid.kd.at(k));
+    }
+}
+
+CompactView CompactEngine::view() {
+    CompactView v{};
+    if (layout == CompactGains::Grid16) {
+        v.kp_index = kp_index.data();
+        v.ki_index = ki_index.data();
+        v.kd_index = kd_index.data();
+        v.base[0] = static_cast<float>(grid.kp.min);
+        v.base[1] = static_cast<float>(grid.ki.min);
+        v.base[2] = static_cast<float>(grid.kd.min);
+        v.step[0] = step_of(grid.kp);
+        v.step[1] = step_of(grid.ki);
+        v.step[2] = step_of(grid.kd);
+    } else {
+        v.kp = kp.data();
+        v.ki = ki.data();
+        v.kd = kd.data();
+    }
+    v.setpoint = static_cast<float>(grid.setpoint);
+    v.integral = integral.data();
+    v.prev_error = prev_error.data();
+    v.y = y.data();
+    v.velocity = velocity.data();
+    v.iae = iae.data();
+    return v;
+}
+
+SweepResult run_compact_sweep(ThreadPool& pool, const SweepConfig& config, CompactGains gains) {
+    if (config.cache || config.exporter || config.metrics) {
+        throw std::invalid_argument("compact sweeps report IAE only, without cache or export");
+    }
+    SweepResult result;
+    result.config = config;
+    const std::size_t cells = config.kp.count * config.ki.count * config.kd.count;
+    result.cost.assign(cells, 0.0);
+
+    CompactEngine engine(cells, gains, config);
+    for (std::size_t cell = 0; cell < cells; ++cell) {
+        std::size_t k = cell % config.kd.count;
+        std::size_t j = cell / config.kd.count % config.ki.count;
+        std::size_t i = cell / (config.kd.count * config.ki.count);
+        engine.set_cell(cell, i, j, k);
+    }
+
+    const float dt = static_cast<float>(config.dt);
+    const std::size_t padded = (cells + CompactEngine::LANE_PAD - 1) / CompactEngine::LANE_PAD * CompactEngine::LANE_PAD;
+    pool.parallel_for(padded, CompactEngine::BLOCK_LANES, [&](std::size_t begin, std::size_t end, unsigned) {
+        double total[CompactEngine::BLOCK_LANES] = {};
+        float* iae = engine.iae.data();
+        for (uint64_t s = 0; s < config.steps; ++s) {
+            engine.step_range(begin, end, dt);
+            if ((s + 1) % IAE_FOLD_STEPS == 0 || s + 1 == config.steps) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    total[i - begin] += iae[i];
+                    iae[i] = 0.0f;
+                }
+            }
+        }
+        std::size_t last = std::min(end, cells);
+        for (std::size_t i = begin; i < last; ++i) result.cost[i] = total[i - begin];
+    });
+    return result;
+}
+
+CompactAccuracy compact_accuracy(ThreadPool& pool, const SweepResult& compact, std::size_t sample_cells) {
+    const SweepConfig& cfg = compact.config;
+    const std::size_t cells = compact.cells();
+    std::vector<std::size_t> checked;
+    const std::size_t stride = std::max<std::size_t>(1, cells / std::max<std::size_t>(sample_cells, 1));
+    for (std::size_t c = 0; c < cells && checked.size() < sample_cells; c += stride) checked.push_back(c);
+    const std::size_t best = compact.best();
+    checked.push_back(best);
+
+    BatchEngine engine(checked.size());
+    for (std::size_t i = 0; i < checked.size(); ++i) {
+        double kp, ki, kd;
+        compact.gains(checked[i], kp, ki, kd);
+        engine.set_gains(i, kp, ki, kd);
+        engine.set_setpoint(i, cfg.setpoint);
+    }
+    std::vector<double> cost(checked.size());
+    const std::size_t padded = (checked.size() + BatchEngine::LANE_PAD - 1) / BatchEngine::LANE_PAD * BatchEngine::LANE_PAD;
+    pool.parallel_for(padded, BatchEngine::BLOCK_LANES, [&](std::size_t begin, std::size_t end, unsigned) {
+        LoopMetrics block[BatchEngine::BLOCK_LANES];
+        evaluate_metrics(engine, begin, end, cfg.steps, cfg.dt, block);
+        for (std::size_t i = begin; i < std::min(end, checked.size()); ++i) cost[i] = block[i - begin].iae;
+    });
+
+    CompactAccuracy a;
+    a.cells = checked.size();
+    a.reference_best = cost[0];
+    double sum = 0.0;
+    for (std::size_t i = 0; i < checked.size(); ++i) {
+        double rel = std::abs(compact.cost[checked[i]] - cost[i]) / std::max(std::abs(cost[i]), 1e-12);
+        a.max_rel_error = std::max(a.max_rel_error, rel);
+        sum += rel;
+        a.reference_best = std::min(a.reference_best, cost[i]);
+    }
+    a.mean_rel_error = sum / static_cast<double>(checked.size());
+    a.best_cost = cost.back();
+    return a;
+}
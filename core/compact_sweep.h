@@ -0,0 +1,80 @@
+#pragma once
+
+#include "aligned.h"
+#include "batch_kernels.h"
+#include "sweep.h"
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// How a compact lane stores its gains
+enum class CompactGains {
+    Float32,  // three floats
+    Grid16,   // three 16-bit indices into the sweep grid; axes up to 65536 points
+};
+
+bool parse_compact_gains(const char* name, CompactGains& out);  // "f32" or "grid16"
+const char* compact_gains_name(CompactGains gains);
+
+// BatchEngine's loops in float32 with no padding between fields: 16 bytes
+// of state and 4 of running IAE per loop plus 12 (Float32) or 6 (Grid16)
+// bytes of gains, against 72 for a double lane, so ten million loops take
+// about a quarter of a gigabyte and an AVX2 register holds eight lanes instead of four. Every
+// lane shares one setpoint, as sweep lanes do. Float rounding makes the
+// trajectories drift from the double reference; compact_accuracy() says
+// by how much for a given campaign.
+class CompactEngine {
+public:
+    static constexpr std::size_t LANE_PAD = 8;
+    // Lanes advanced together through all steps of a sweep, sized to stay in L1
+    static constexpr std::size_t BLOCK_LANES = 512;
+
+    // Grid16 lanes decode their gains from `grid`'s ranges, whose counts
+    // must each fit 16 bits; Float32 ignores it
+    CompactEngine(std::size_t lanes, CompactGains gains, const SweepConfig& grid);
+
+    std::size_t size() const { return lanes; }
+    CompactGains gains() const { return layout; }
+    const char* isa() const { return isa_name; }
+    std::size_t bytes_per_lane() const;
+
+    // Gains of cell (i, j, k) of the grid, `grid.kp.at(i)` and so on
+    void set_cell(std::size_t lane, std::size_t i, std::size_t j, std::size_t k);
+
+    // One step of lanes [begin, end), multiples of LANE_PAD
+    void step_range(std::size_t begin, std::size_t end, float dt) { kernel(view(), begin, end, dt); }
+
+    AlignedVector<float> integral, prev_error, y, velocity;
+    AlignedVector<float> iae;  // running |error| dt, folded into double by the sweep
+
+private:
+    CompactView view();
+
+    std::size_t lanes;
+    std::size_t padded;
+    CompactGains layout;
+    SweepConfig grid;
+    CompactKernel kernel;
+    const char* isa_name;
+    AlignedVector<float> kp, ki, kd;
+    AlignedVector<uint16_t> kp_index, ki_index, kd_index;
+};
+
+// run_sweep's IAE sweep on a CompactEngine; config.cache, exporter and
+// metrics must be unset
+SweepResult run_compact_sweep(ThreadPool& pool, const SweepConfig& config, CompactGains gains);
+
+// A compact sweep against the double engine on a sample of its cells
+struct CompactAccuracy {
+    std::size_t cells = 0;        // cells re-run in double, the compact best among them
+    double max_rel_error = 0.0;   // of IAE
+    double mean_rel_error = 0.0;
+    double best_cost = 0.0;       // double IAE of the compact sweep's best cell
+    double reference_best = 0.0;  // best double IAE among the sampled cells
+};
+
+// Re-runs up to `sample_cells` cells spread evenly over the grid, plus the
+// compact best, through BatchEngine
+CompactAccuracy compact_accuracy(ThreadPool& pool, const SweepResult& compact, std::size_t sample_cells = 4096);
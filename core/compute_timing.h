@@ -0,0 +1,111 @@
+#pragma once
+
+#include "philox.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+// Steps of output latency a loop can queue; a power of two so the ring index is a mask
+constexpr std::size_t COMPUTE_QUEUE = 64;
+constexpr unsigned MAX_COMPUTE_DELAY = COMPUTE_QUEUE - 1;
+
+// How late the controller's output reaches the plant. Every step the
+// update is first dropped with probability `miss_probability` (a deadline
+// miss: the controller does not run and the actuator holds its last
+// output); otherwise the output it computes is applied `delay` steps later,
+// with the delay drawn per update:
+//   Uniform      integer in [delay_min, delay_max]
+//   Exponential  delay_min + floor(Exp(delay_mean)), capped at delay_max,
+//                the long-tailed overruns of a loaded CPU
+// An output that lands after a newer one has been applied is discarded.
+// The default is the ideal controller the loop always had.
+struct ComputeTimingModel {
+    enum class Jitter : uint8_t { Uniform, Exponential };
+
+    unsigned delay_min = 0, delay_max = 0;  // steps
+    Jitter jitter = Jitter::Uniform;
+    double delay_mean = 0.0;  // Exponential only, steps above delay_min
+    double miss_probability = 0.0;
+    uint64_t seed = 1;  // draws come from PhiloxStream(seed, loop index)
+
+    bool ideal() const { return delay_max == 0 && miss_probability == 0.0; }
+
+    void validate() const {
+        if (delay_max > MAX_COMPUTE_DELAY) throw std::invalid_argument("compute delay is limited to 63 steps");
+        if (delay_min > delay_max) throw std::invalid_argument("compute delay range is empty");
+        if (!(miss_probability >= 0.0) || !(miss_probability < 1.0)) {
+            throw std::invalid_argument("miss probability must be in [0, 1)");
+        }
+        if (!(delay_mean >= 0.0)) throw std::invalid_argument("compute delay mean must not be negative");
+    }
+
+    // Delay of one update; Uniform draws nothing when the range is a single value
+    unsigned draw_delay(PhiloxStream& rng) const {
+        if (jitter == Jitter::Exponential) {
+            double extra = std::floor(-delay_mean * std::log(1.0 - rng.uniform()));
+            return extra >= static_cast<double>(delay_max - delay_min) ? delay_max
+                                                                       : delay_min + static_cast<unsigned>(extra);
+        }
+        if (delay_min == delay_max) return delay_min;
+        unsigned span = delay_max - delay_min + 1;
+        unsigned k = static_cast<unsigned>(rng.uniform() * span);
+        return delay_min + (k < span ? k : span - 1);
+    }
+};
+
+// Output queue of one loop: a fixed ring indexed by the step an output
+// becomes due. step() is O(1) and never allocates.
+class ComputeTiming {
+public:
+    ComputeTiming() = default;
+    ComputeTiming(const ComputeTimingModel& model, uint64_t stream)
+            : model_(model), rng(model.seed, stream), active(!model.ideal()) {
+        model.validate();
+    }
+
+    const ComputeTimingModel& model() const { return model_; }
+    bool ideal() const { return !active; }
+    uint64_t misses() const { return missed; }
+
+    // One control period: runs `compute` unless the update is missed, queues
+    // its result and returns the output the actuator holds this step.
+    // Draw order: the miss first, then the delay of a computed update.
+    template <class Compute>
+    double step(Compute&& compute) {
+        if (model_.miss_probability > 0.0 && rng.uniform() < model_.miss_probability) {
+            ++missed;
+        } else {
+            double value = compute();
+            uint64_t due = now + model_.draw_delay(rng);
+            queue[due & MASK] = {due, now + 1, value};
+        }
+        const Pending& p = queue[now & MASK];
+        if (p.due == now && p.issued > held_issued) {
+            held = p.value;
+            held_issued = p.issued;
+        }
+        ++now;
+        return held;
+    }
+
+private:
+    static constexpr unsigned MASK = COMPUTE_QUEUE - 1;
+
+    struct Pending {
+        uint64_t due = ~uint64_t{0};
+        uint64_t issued = 0;  // step it was computed in, plus one; 0 = never
+        double value = 0.0;
+    };
+
+    ComputeTimingModel model_;
+    PhiloxStream rng{1, 0};
+    std::array<Pending, COMPUTE_QUEUE> queue{};
+    uint64_t now = 0;
+    uint64_t held_issued = 0;
+    uint64_t missed = 0;
+    double held = 0.0;  // actuator output before the first update lands
+    bool active = false;
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+constexpr int WINDOW_WIDTH = 800;
+constexpr int WINDOW_HEIGHT = 800;
+constexpr int BALL_SIZE = 30;
+constexpr double GRAVITY = 98;
+constexpr double FIXED_TIMESTEP = 1.0 / 60.0;
+constexpr double INTEGRAL_LIMIT = 1000.0;
+constexpr double OUTPUT_LIMIT = 1.0e6;  // velocity-form anti-windup clamp on the controller output
+constexpr double BOUNCE_COEFFICIENT = -0.3;
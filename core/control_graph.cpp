@@ -0,0 +1,228 @@
+#include "control_graph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+ControlGraph::ControlGraph(std::size_t lanes, double dt) : lane_count(lanes ? lanes : 1), dt(dt) {}
+
+NodeId ControlGraph::add(Node n, uint32_t outputs) {
+    if (compiled) throw std::logic_error("ControlGraph: add after compile()");
+    n.out = slot_count;
+    slot_count += outputs;
+    nodes.push_back(n);
+    return static_cast<NodeId>(nodes.size() - 1);
+}
+
+void ControlGraph::wire(Node& n, Port p) {
+    if (p.node >= nodes.size() || p.index >= (nodes[p.node].kind == NodeKind::Ball ? 2 : 1)) {
+        throw std::logic_error("ControlGraph: input from a nonexistent port");
+    }
+    n.from[n.inputs] = p.node;
+    n.in[n.inputs] = slot(p);
+    ++n.inputs;
+}
+
+NodeId ControlGraph::add_input(double value) {
+    Node n{NodeKind::Input};
+    n.p0 = value;
+    return add(n, 1);
+}
+
+NodeId ControlGraph::add_constant(double value) {
+    Node n{NodeKind::Constant};
+    n.p0 = value;
+    return add(n, 1);
+}
+
+NodeId ControlGraph::add_gain(Port in, double k) {
+    Node n{NodeKind::Gain};
+    wire(n, in);
+    n.p0 = k;
+    return add(n, 1);
+}
+
+NodeId ControlGraph::add_sum(Port a, Port b, double b_sign) {
+    Node n{NodeKind::Sum};
+    wire(n, a);
+    wire(n, b);
+    n.p0 = b_sign;
+    return add(n, 1);
+}
+
+NodeId ControlGraph::add_clamp(Port in, double lo, double hi) {
+    Node n{NodeKind::Clamp};
+    wire(n, in);
+    n.p0 = lo;
+    n.p1 = hi;
+    return add(n, 1);
+}
+
+NodeId ControlGraph::add_pid(Port setpoint, Port measurement, double kp, double ki, double kd, unsigned divider) {
+    Node n{NodeKind::Pid};
+    wire(n, setpoint);
+    wire(n, measurement);
+    n.kp = kp;
+    n.ki = ki;
+    n.kd = kd;
+    n.divider = divider ? divider : 1;
+    return add(n, 1);
+}
+
+NodeId ControlGraph::add_ball() {
+    return add(Node{NodeKind::Ball}, 2);
+}
+
+void ControlGraph::connect_force(NodeId ball, Port force) {
+    if (compiled) throw std::logic_error("ControlGraph: connect after compile()");
+    if (ball >= nodes.size() || nodes[ball].kind != NodeKind::Ball || nodes[ball].inputs) {
+        throw std::logic_error("ControlGraph: connect_force needs an unconnected ball");
+    }
+    wire(nodes[ball], force);
+}
+
+void ControlGraph::compile() {
+    if (compiled) return;
+    // Kahn's algorithm over the non-plant nodes; plant outputs are sources
+    std::vector<uint32_t> pending(nodes.size(), 0);
+    std::vector<std::vector<NodeId>> users(nodes.size());
+    std::vector<NodeId> ready;
+    for (NodeId id = 0; id < nodes.size(); ++id) {
+        const Node& n = nodes[id];
+        if (n.kind == NodeKind::Ball) {
+            if (n.inputs == 0) throw std::logic_error("ControlGraph: ball without a force input");
+            plants.push_back(id);
+            continue;
+        }
+        for (uint8_t k = 0; k < n.inputs; ++k) {
+            if (nodes[n.from[k]].kind == NodeKind::Ball) continue;
+            ++pending[id];
+            users[n.from[k]].push_back(id);
+        }
+        if (pending[id] == 0) ready.push_back(id);
+    }
+    while (!ready.empty()) {
+        NodeId id = ready.back();
+        ready.pop_back();
+        order.push_back(id);
+        for (NodeId u : users[id]) {
+            if (--pending[u] == 0) ready.push_back(u);
+        }
+    }
+    if (order.size() + plants.size() != nodes.size()) {
+        throw std::logic_error("ControlGraph: algebraic loop (a cycle not broken by a plant)");
+    }
+
+    values.assign(static_cast<std::size_t>(slot_count) * lane_count, 0.0);
+    for (NodeId id = 0; id < nodes.size(); ++id) {
+        Node& n = nodes[id];
+        if (n.kind == NodeKind::Pid) {
+            n.state = static_cast<uint32_t>(pids.size());
+            pids.insert(pids.end(), lane_count, PID_Controller(n.kp, n.ki, n.kd));
+        } else if (n.kind == NodeKind::Ball) {
+            n.state = static_cast<uint32_t>(balls.size());
+            balls.insert(balls.end(), lane_count, Ball{});
+        } else if (n.kind == NodeKind::Input || n.kind == NodeKind::Constant) {
+            std::fill_n(values.begin() + static_cast<std::ptrdiff_t>(n.out) * lane_count, lane_count, n.p0);
+        }
+    }
+    compiled = true;
+}
+
+void ControlGraph::set_input(NodeId input, std::size_t lane, double v) {
+    if (input >= nodes.size() || nodes[input].kind != NodeKind::Input) {
+        throw std::logic_error("ControlGraph: set_input on a node that is not an input");
+    }
+    if (!compiled) nodes[input].p0 = v;
+    else values[nodes[input].out * lane_count + lane] = v;
+}
+
+PID_Controller& ControlGraph::pid(NodeId node, std::size_t lane) {
+    if (!compiled || nodes.at(node).kind != NodeKind::Pid) throw std::logic_error("ControlGraph: not a compiled Pid node");
+    return pids[nodes[node].state + lane];
+}
+
+Ball& ControlGraph::ball(NodeId node, std::size_t lane) {
+    if (!compiled || nodes.at(node).kind != NodeKind::Ball) throw std::logic_error("ControlGraph: not a compiled Ball node");
+    return balls[nodes[node].state + lane];
+}
+
+void ControlGraph::step() {
+    const std::size_t L = lane_count;
+    double* v = values.data();
+
+    for (NodeId id : plants) {
+        const Node& n = nodes[id];
+        const Ball* b = balls.data() + n.state;
+        double* pv = v + n.out * L;
+        double* vel = pv + L;
+        for (std::size_t l = 0; l < L; ++l) {
+            pv[l] = b[l].y + ScalarTraits<double>::pv_offset();
+            vel[l] = b[l].velocity;
+        }
+    }
+
+    for (NodeId id : order) {
+        const Node& n = nodes[id];
+        double* out = v + n.out * L;
+        const double* a = v + n.in[0] * L;
+        const double* b = v + n.in[1] * L;
+        switch (n.kind) {
+            case NodeKind::Input:
+            case NodeKind::Constant:
+            case NodeKind::Ball:
+                break;
+            case NodeKind::Gain:
+                for (std::size_t l = 0; l < L; ++l) out[l] = n.p0 * a[l];
+                break;
+            case NodeKind::Sum:
+                for (std::size_t l = 0; l < L; ++l) out[l] = a[l] + n.p0 * b[l];
+                break;
+            case NodeKind::Clamp:
+                for (std::size_t l = 0; l < L; ++l) out[l] = std::clamp(a[l], n.p0, n.p1);
+                break;
+            case NodeKind::Pid: {
+                if (tick % n.divider) break;  // hold the last output
+                const double node_dt = dt * n.divider;
+                PID_Controller* c = pids.data() + n.state;
+                for (std::size_t l = 0; l < L; ++l) out[l] = c[l].calculate(a[l], b[l], node_dt);
+                break;
+            }
+        }
+    }
+
+    for (NodeId id : plants) {
+        const Node& n = nodes[id];
+        Ball* b = balls.data() + n.state;
+        const double* force = v + n.in[0] * L;
+        for (std::size_t l = 0; l < L; ++l) b[l].update(force[l], dt);
+    }
+    ++tick;
+}
+
+GraphLoop make_single_loop(double kp, double ki, double kd, double setpoint, std::size_t lanes, double dt) {
+    GraphLoop g{ControlGraph(lanes, dt)};
+    g.setpoint = g.graph.add_input(setpoint);
+    g.ball = g.graph.add_ball();
+    g.controller = g.graph.add_pid({g.setpoint}, {g.ball, 0}, kp, ki, kd);
+    g.force = {g.controller};
+    g.graph.connect_force(g.ball, g.force);
+    g.graph.compile();
+    return g;
+}
+
+GraphLoop make_cascade(double setpoint, std::size_t lanes, double dt, unsigned outer_divider) {
+    // Inner loop y'' = Kv (v_ref - y') with gravity cancelled; the outer
+    // P loop v_ref = Kp (sp - y) closes s^2 + Kv s + Kv Kp, critically damped
+    constexpr double KV = 20.0, KP = 5.0;
+    GraphLoop g{ControlGraph(lanes, dt)};
+    g.setpoint = g.graph.add_input(setpoint);
+    g.ball = g.graph.add_ball();
+    g.controller = g.graph.add_pid({g.setpoint}, {g.ball, 0}, KP, 0.0, 0.0, outer_divider);
+    NodeId velocity_loop = g.graph.add_pid({g.controller}, {g.ball, 1}, KV, 0.0, 0.0);
+    NodeId feed_forward = g.graph.add_constant(GRAVITY);
+    NodeId force = g.graph.add_sum({velocity_loop}, {feed_forward});
+    g.force = {force};
+    g.graph.connect_force(g.ball, g.force);
+    g.graph.compile();
+    return g;
+}
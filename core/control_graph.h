@@ -0,0 +1,103 @@
+#pragma once
+
+#include "ball.h"
+#include "constants.h"
+#include "pid_controller.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using NodeId = uint32_t;
+
+// One output of a node; most nodes have a single output, port 0
+struct Port {
+    NodeId node = 0;
+    uint8_t index = 0;
+};
+
+enum class NodeKind : uint8_t { Input, Constant, Gain, Sum, Clamp, Pid, Ball };
+
+// Dataflow graph of controllers and plants for cascaded, feed-forward and
+// multi-loop control. Build it with the add_* calls, compile() once, then
+// step() runs the nodes as a flat array in topological order without
+// allocating. Every node exists once per lane, so one graph drives one loop
+// in the GUI or `lanes` independent copies of it in a batch run.
+//
+// Plants break cycles: a Ball's outputs are its state at the start of the
+// step and its force input is applied after every other node has run, the
+// same order as Simulation::step. A Pid can run at a fraction of the base
+// rate (divider N: every Nth step, with dt * N) and holds its output between.
+class ControlGraph {
+public:
+    explicit ControlGraph(std::size_t lanes = 1, double dt = FIXED_TIMESTEP);
+
+    NodeId add_input(double value);  // set per lane with set_input()
+    NodeId add_constant(double value);
+    NodeId add_gain(Port in, double k);
+    NodeId add_sum(Port a, Port b, double b_sign = 1.0);  // a + b_sign * b
+    NodeId add_clamp(Port in, double lo, double hi);
+    NodeId add_pid(Port setpoint, Port measurement, double kp, double ki, double kd, unsigned divider = 1);
+    // Outputs: 0 = measured height (ball centre, the pv PID_Controller sees), 1 = velocity
+    NodeId add_ball();
+    void connect_force(NodeId ball, Port force);
+
+    // Orders the nodes and allocates all state; throws std::logic_error on
+    // an algebraic loop or a ball without a force input
+    void compile();
+    void step();
+
+    std::size_t lanes() const { return lane_count; }
+    double timestep() const { return dt; }
+    uint64_t ticks() const { return tick; }
+
+    double value(Port p, std::size_t lane = 0) const { return values[slot(p) * lane_count + lane]; }
+    void set_input(NodeId input, std::size_t lane, double v);
+    PID_Controller& pid(NodeId node, std::size_t lane = 0);
+    Ball& ball(NodeId node, std::size_t lane = 0);
+
+private:
+    struct Node {
+        NodeKind kind;
+        uint8_t inputs = 0;
+        NodeId from[2] = {0, 0};  // producers, for ordering
+        uint32_t in[2] = {0, 0};  // value slots read
+        uint32_t out = 0;         // first value slot written
+        uint32_t state = 0;       // index into pids/balls, times lanes
+        unsigned divider = 1;
+        double p0 = 0.0, p1 = 0.0;  // value, gain, sign or clamp bounds; Pid: none
+        double kp = 0.0, ki = 0.0, kd = 0.0;
+    };
+
+    NodeId add(Node n, uint32_t outputs);
+    void wire(Node& n, Port p);
+    uint32_t slot(Port p) const { return nodes[p.node].out + p.index; }
+
+    const std::size_t lane_count;
+    const double dt;
+    std::vector<Node> nodes;     // by NodeId
+    std::vector<NodeId> order;   // non-plant nodes, topologically sorted
+    std::vector<NodeId> plants;
+    std::vector<double> values;  // slot-major: values[slot * lanes + lane]
+    std::vector<PID_Controller> pids;
+    std::vector<Ball> balls;
+    uint32_t slot_count = 0;
+    uint64_t tick = 0;
+    bool compiled = false;
+};
+
+// Ready-made graphs. `controller` is the loop the GUI's gain keys tune.
+struct GraphLoop {
+    ControlGraph graph;
+    NodeId setpoint = 0, controller = 0, ball = 0;
+    Port force{};
+};
+
+// The plain loop, bit-identical to Simulation
+GraphLoop make_single_loop(double kp, double ki, double kd, double setpoint,
+                           std::size_t lanes = 1, double dt = FIXED_TIMESTEP);
+
+// Position loop at 1/`outer_divider` of the rate producing a velocity
+// reference, inner velocity loop producing force, plus gravity feed-forward
+GraphLoop make_cascade(double setpoint, std::size_t lanes = 1, double dt = FIXED_TIMESTEP,
+                       unsigned outer_divider = 4);
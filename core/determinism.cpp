@@ -0,0 +1,108 @@
+#include "determinism.h"
+
+#include <algorithm>
+#include <cfenv>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define PID_HAVE_MXCSR 1
+#endif
+
+namespace {
+
+#ifdef PID_HAVE_MXCSR
+constexpr unsigned MXCSR_FTZ = 0x8000;  // flush denormal results to zero
+constexpr unsigned MXCSR_DAZ = 0x0040;  // read denormal inputs as zero
+#endif
+
+uint64_t bits_of(double v) {
+    uint64_t b;
+    std::memcpy(&b, &v, sizeof(b));
+    return b;
+}
+
+// One word into the digest: a multiply-xorshift round, so a flipped bit
+// anywhere spreads over the whole state before the next word arrives
+inline uint64_t mix(uint64_t h, uint64_t word) {
+    h ^= word;
+    h *= 0x9e3779b97f4a7c15ull;
+    return h ^ (h >> 32);
+}
+
+} // namespace
+
+FloatEnvironment::FloatEnvironment() : saved_rounding(std::fegetround()) {
+    std::fesetround(FE_TONEAREST);
+#ifdef PID_HAVE_MXCSR
+    saved_csr = _mm_getcsr();
+    _mm_setcsr(saved_csr & ~(MXCSR_FTZ | MXCSR_DAZ));
+#endif
+}
+
+FloatEnvironment::~FloatEnvironment() {
+#ifdef PID_HAVE_MXCSR
+    _mm_setcsr(saved_csr);
+#endif
+    std::fesetround(saved_rounding);
+}
+
+StateHasher::StateHasher(uint64_t every) : every(every), digest_value(0xcbf29ce484222325ull) {
+    if (every == 0) throw std::invalid_argument("state hashes need a checkpoint interval of at least one step");
+}
+
+void StateHasher::fold(const Simulation& sim) {
+    const PID_Controller& pid = sim.pid;
+    const double words[] = {pid.Kp, pid.Ki, pid.Kd, pid.integral_value(), pid.last_error(), pid.last_derivative(),
+                            sim.ball.y, sim.ball.velocity, sim.setpoint, sim.measurement, sim.output};
+    uint64_t h = digest_value;
+    for (double w : words) h = mix(h, bits_of(w));
+    digest_value = h;
+}
+
+void write_state_hashes(const std::string& path, const StateHasher& hasher, double dt) {
+    std::unique_ptr<FILE, int (*)(FILE*)> file(std::fopen(path.c_str(), "w"), &std::fclose);
+    if (!file) throw std::runtime_error("cannot write " + path);
+    std::fprintf(file.get(), "# pid state hashes every=%" PRIu64 " dt=%.17g steps=%" PRIu64 " digest=%016" PRIx64
+                 " deterministic=%d\n",
+                 hasher.interval(), dt, hasher.sampled(), hasher.digest(), DETERMINISTIC_BUILD ? 1 : 0);
+    for (const StateCheckpoint& c : hasher.checkpoints()) {
+        std::fprintf(file.get(), "%" PRIu64 " %016" PRIx64 "\n", c.step, c.hash);
+    }
+    if (std::fflush(file.get()) != 0) throw std::runtime_error("cannot write " + path);
+}
+
+StateHashLog load_state_hashes(const std::string& path) {
+    std::unique_ptr<FILE, int (*)(FILE*)> file(std::fopen(path.c_str(), "r"), &std::fclose);
+    if (!file) throw std::runtime_error("cannot open " + path);
+    StateHashLog log;
+    int deterministic = 0;
+    if (std::fscanf(file.get(), "# pid state hashes every=%" SCNu64 " dt=%lf steps=%" SCNu64 " digest=%" SCNx64
+                    " deterministic=%d", &log.every, &log.dt, &log.steps, &log.digest, &deterministic) != 5 ||
+        log.every == 0 || !(log.dt > 0.0)) {
+        throw std::runtime_error(path + " is not a state hash log");
+    }
+    log.deterministic = deterministic != 0;
+    StateCheckpoint c;
+    while (std::fscanf(file.get(), "%" SCNu64 " %" SCNx64, &c.step, &c.hash) == 2) {
+        if (c.step != (log.checkpoints.size() + 1) * log.every) {
+            throw std::runtime_error(path + ": checkpoint out of order at step " + std::to_string(c.step));
+        }
+        log.checkpoints.push_back(c);
+    }
+    if (!std::feof(file.get())) throw std::runtime_error(path + ": malformed checkpoint line");
+    return log;
+}
+
+const StateCheckpoint* first_divergence(const StateHashLog& log, const StateHasher& run) {
+    const std::vector<StateCheckpoint>& got = run.checkpoints();
+    std::size_t n = std::min(log.checkpoints.size(), got.size());
+    for (std::size_t i = 0; i < n; ++i) {
+        if (log.checkpoints[i].hash != got[i].hash) return &log.checkpoints[i];
+    }
+    return nullptr;
+}
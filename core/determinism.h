@@ -0,0 +1,99 @@
+#pragma once
+
+#include "simulation.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bit-exact reproducibility across runs, machines and builds.
+//
+// The loop is deterministic as long as every machine rounds every operation
+// the same way. A PID_DETERMINISTIC build (the CMake option of the same
+// name) rules out the compile-time differences: no a*b + c contracted into
+// an FMA on targets that have one, no fast-math reassociation, SSE2 rather
+// than x87 extended precision on 32-bit x86. FloatEnvironment rules out the
+// run-time ones, a rounding mode or flush-to-zero left behind by a library.
+// Input is quantized to step indices already: a click or a reference
+// setpoint takes effect at the start of one particular step.
+//
+// StateHasher then condenses a run into a digest and a checkpoint every N
+// steps, so two runs can be compared without shipping whole trajectories,
+// and the first checkpoint that differs says roughly where they parted.
+#ifdef PID_DETERMINISTIC
+constexpr bool DETERMINISTIC_BUILD = true;
+#else
+constexpr bool DETERMINISTIC_BUILD = false;
+#endif
+
+// Round-to-nearest with denormals kept for its lifetime; the previous
+// environment comes back on destruction
+class FloatEnvironment {
+public:
+    FloatEnvironment();
+    ~FloatEnvironment();
+
+    FloatEnvironment(const FloatEnvironment&) = delete;
+    FloatEnvironment& operator=(const FloatEnvironment&) = delete;
+
+private:
+    int saved_rounding;
+    unsigned saved_csr = 0;  // MXCSR on x86
+};
+
+struct StateCheckpoint {
+    uint64_t step = 0;
+    uint64_t hash = 0;  // rolling digest of every sample up to and including this step
+};
+
+// Folds the bits of the controller and ball state after a step into a
+// rolling 64-bit digest: gains, integral, previous error and derivative,
+// position, velocity, setpoint, the measurement and the controller output.
+// Cheap enough to sample every step; `every` only decides how often a
+// checkpoint is kept.
+class StateHasher {
+public:
+    explicit StateHasher(uint64_t every = 1000);
+
+    void sample(const Simulation& sim) {
+        fold(sim);
+        if (++steps % every == 0) marks.push_back({steps, digest_value});
+    }
+
+    // Room for the checkpoints of `total` steps, so sampling never allocates
+    void reserve(uint64_t total) { marks.reserve(total / every); }
+
+    uint64_t digest() const { return digest_value; }
+    uint64_t sampled() const { return steps; }
+    uint64_t interval() const { return every; }
+    const std::vector<StateCheckpoint>& checkpoints() const { return marks; }
+
+private:
+    void fold(const Simulation& sim);
+
+    uint64_t every;
+    uint64_t steps = 0;
+    uint64_t digest_value;
+    std::vector<StateCheckpoint> marks;
+};
+
+// The text form is a "# pid state hashes every=<N> dt=<dt> steps=<S>
+// digest=<hex> deterministic=<0|1>" header and one "<step> <hex>" line per
+// checkpoint
+struct StateHashLog {
+    uint64_t every = 0;
+    double dt = 0.0;
+    uint64_t steps = 0;
+    uint64_t digest = 0;
+    bool deterministic = false;  // recorded by a PID_DETERMINISTIC build
+    std::vector<StateCheckpoint> checkpoints;
+};
+
+// Throws std::runtime_error when the file cannot be written
+void write_state_hashes(const std::string& path, const StateHasher& hasher, double dt);
+// Throws std::runtime_error for an unreadable or malformed file
+StateHashLog load_state_hashes(const std::string& path);
+
+// First checkpoint of `run` that differs from `log`, or nullptr when every
+// checkpoint both have matches
+const StateCheckpoint* first_divergence(const StateHashLog& log, const StateHasher& run);
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+// Forward-mode automatic differentiation: a value and its partial
+// derivatives with respect to N seeded inputs, carried through every
+// operation by the chain rule. The value part does exactly the double
+// arithmetic, so a BasicSimulation<Dual<N>> follows the double loop bit for
+// bit and adds the gradient on top.
+//
+// Comparisons look at the value only, which fixes the subgradients of the
+// loop's non-smooth spots: std::clamp returns the limit itself when it
+// clamps, so the clamped integral has zero derivative (the anti-windup
+// freezes it), and a wall contact sets y to the wall (zero derivative)
+// and scales the velocity's derivative by the bounce coefficient. abs()
+// takes the derivative of +x at 0.
+template <std::size_t N>
+class Dual {
+public:
+    constexpr Dual() = default;
+    constexpr explicit Dual(double v) : val(v) {}
+
+    // Input `index` of N, with d(this)/d(input) = 1
+    static constexpr Dual variable(double v, std::size_t index) {
+        Dual d(v);
+        d.grad[index] = 1.0;
+        return d;
+    }
+
+    constexpr double value() const { return val; }
+    constexpr double derivative(std::size_t i) const { return grad[i]; }
+    constexpr const std::array<double, N>& gradient() const { return grad; }
+    constexpr explicit operator double() const { return val; }
+
+    friend constexpr Dual operator+(const Dual& a, const Dual& b) {
+        Dual r(a.val + b.val);
+        for (std::size_t i = 0; i < N; ++i) r.grad[i] = a.grad[i] + b.grad[i];
+        return r;
+    }
+    friend constexpr Dual operator-(const Dual& a, const Dual& b) {
+        Dual r(a.val - b.val);
+        for (std::size_t i = 0; i < N; ++i) r.grad[i] = a.grad[i] - b.grad[i];
+        return r;
+    }
+    friend constexpr Dual operator*(const Dual& a, const Dual& b) {
+        Dual r(a.val * b.val);
+        for (std::size_t i = 0; i < N; ++i) r.grad[i] = a.grad[i] * b.val + a.val * b.grad[i];
+        return r;
+    }
+    friend constexpr Dual operator/(const Dual& a, const Dual& b) {
+        Dual r(a.val / b.val);
+        for (std::size_t i = 0; i < N; ++i) r.grad[i] = (a.grad[i] - r.val * b.grad[i]) / b.val;
+        return r;
+    }
+    constexpr Dual operator-() const {
+        Dual r(-val);
+        for (std::size_t i = 0; i < N; ++i) r.grad[i] = -grad[i];
+        return r;
+    }
+
+    Dual& operator+=(const Dual& b) { return *this = *this + b; }
+    Dual& operator-=(const Dual& b) { return *this = *this - b; }
+    Dual& operator*=(const Dual& b) { return *this = *this * b; }
+    Dual& operator/=(const Dual& b) { return *this = *this / b; }
+
+    friend constexpr bool operator<(const Dual& a, const Dual& b) { return a.val < b.val; }
+    friend constexpr bool operator>(const Dual& a, const Dual& b) { return a.val > b.val; }
+    friend constexpr bool operator<=(const Dual& a, const Dual& b) { return a.val <= b.val; }
+    friend constexpr bool operator>=(const Dual& a, const Dual& b) { return a.val >= b.val; }
+    friend constexpr bool operator==(const Dual& a, const Dual& b) { return a.val == b.val; }
+    friend constexpr bool operator!=(const Dual& a, const Dual& b) { return a.val != b.val; }
+
+    friend Dual abs(const Dual& a) { return a.val < 0.0 ? -a : a; }
+
+private:
+    double val = 0.0;
+    std::array<double, N> grad{};
+};
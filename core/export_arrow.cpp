@@ -0,0 +1,91 @@
+// Arrow IPC and Parquet encoders for Exporter; built only with -DPID_ARROW=ON
+#include "exporter.h"
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/writer.h>
+#include <parquet/arrow/writer.h>
+
+#include <stdexcept>
+
+namespace {
+
+void check(const arrow::Status& status) {
+    if (!status.ok()) throw std::runtime_error(status.ToString());
+}
+
+template <class T>
+T check(arrow::Result<T> result) {
+    if (!result.ok()) throw std::runtime_error(result.status().ToString());
+    return std::move(result).ValueUnsafe();
+}
+
+// Rows are transposed into one buffer per column and written as an IPC
+// record batch, or a Parquet row group, every BATCH_ROWS rows
+class ArrowEncoder : public ExportEncoder {
+public:
+    ArrowEncoder(const std::string& path, const std::vector<std::string>& columns, bool parquet) {
+        arrow::FieldVector fields;
+        for (const std::string& name : columns) fields.push_back(arrow::field(name, arrow::float64(), false));
+        schema = arrow::schema(fields);
+        sink = check(arrow::io::FileOutputStream::Open(path));
+        if (parquet) {
+            parquet_writer = check(parquet::arrow::FileWriter::Open(*schema, arrow::default_memory_pool(), sink));
+        } else {
+            ipc_writer = check(arrow::ipc::MakeFileWriter(sink, schema));
+        }
+        values.resize(columns.size());
+        for (auto& column : values) column.reserve(BATCH_ROWS);
+    }
+
+    void append(const ExportRow* rows, std::size_t count) override {
+        for (std::size_t r = 0; r < count; ++r) {
+            for (std::size_t c = 0; c < values.size(); ++c) values[c].push_back(rows[r][c]);
+            if (values[0].size() == BATCH_ROWS) write_batch();
+        }
+    }
+
+    void finish() override {
+        write_batch();
+        if (parquet_writer) check(parquet_writer->Close());
+        if (ipc_writer) check(ipc_writer->Close());
+        check(sink->Close());
+    }
+
+private:
+    static constexpr std::size_t BATCH_ROWS = 1 << 16;
+
+    void write_batch() {
+        const int64_t rows = static_cast<int64_t>(values[0].size());
+        if (rows == 0) return;
+        arrow::ArrayVector arrays;
+        for (auto& column : values) {
+            arrow::DoubleBuilder builder;
+            check(builder.AppendValues(column.data(), rows));
+            std::shared_ptr<arrow::Array> array;
+            check(builder.Finish(&array));
+            arrays.push_back(std::move(array));
+            column.clear();
+        }
+        auto batch = arrow::RecordBatch::Make(schema, rows, std::move(arrays));
+        if (parquet_writer) {
+            auto table = check(arrow::Table::FromRecordBatches(schema, {batch}));
+            check(parquet_writer->WriteTable(*table, rows));
+        } else {
+            check(ipc_writer->WriteRecordBatch(*batch));
+        }
+    }
+
+    std::shared_ptr<arrow::Schema> schema;
+    std::shared_ptr<arrow::io::FileOutputStream> sink;
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> ipc_writer;
+    std::unique_ptr<parquet::arrow::FileWriter> parquet_writer;
+    std::vector<std::vector<double>> values;
+};
+
+} // namespace
+
+std::unique_ptr<ExportEncoder> make_arrow_encoder(const std::string& path, const std::vector<std::string>& columns,
+                                                  bool parquet) {
+    return std::make_unique<ArrowEncoder>(path, columns, parquet);
+}
@@ -0,0 +1,258 @@
+#include "exporter.h"
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+bool ends_with(const std::string& s, const char* suffix) {
+    std::size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// The last stage of an export: writes filled buffers to the file on a
+// thread of its own, so the encoder goes on formatting while the disk (or
+// the kernel's writeback throttling) catches up. BUFFERS buffers cycle
+// between the two threads; when every one is waiting to be written,
+// next() waits too, which bounds the memory an export holds. Handing a
+// buffer over costs a lock once per buffer, not per row.
+class FileStage {
+public:
+    static constexpr std::size_t BUFFERS = 4;
+
+    FileStage(const std::string& path, std::size_t capacity)
+            : path(path), file(std::fopen(path.c_str(), "wb")) {
+        if (!file) throw std::runtime_error("cannot write " + path + ": " + std::strerror(errno));
+        std::setvbuf(file, nullptr, _IONBF, 0);
+        for (std::vector<char>& b : buffers) b.resize(capacity);
+        thread = std::thread(&FileStage::main, this);
+    }
+
+    ~FileStage() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        if (thread.joinable()) thread.join();
+        if (file) std::fclose(file);
+    }
+
+    // The buffer to fill first
+    char* first() { return buffers[0].data(); }
+
+    // Queues the buffer being filled with `used` bytes and returns the next
+    // one to fill, once the writer has finished with it. Rethrows a write error.
+    char* next(std::size_t used) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!error.empty()) throw std::runtime_error(error);
+        sizes[filling] = used;
+        ++queued;
+        changed.notify_all();
+        filling = (filling + 1) % BUFFERS;
+        // The next buffer is free once fewer than BUFFERS are queued
+        changed.wait(lock, [&] { return queued < BUFFERS || !error.empty(); });
+        if (!error.empty()) throw std::runtime_error(error);
+        return buffers[filling].data();
+    }
+
+    // Writes the last `used` bytes and everything queued, then closes the file
+    void finish(std::size_t used) {
+        next(used);
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return queued == 0 || !error.empty(); });
+        if (!error.empty()) throw std::runtime_error(error);
+        std::FILE* f = file;
+        file = nullptr;
+        if (std::fclose(f) != 0) throw std::runtime_error("cannot finish " + path + ": " + std::strerror(errno));
+    }
+
+private:
+    void main() {
+        std::size_t writing = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            changed.wait(lock, [&] { return queued > 0 || stopping; });
+            if (queued == 0) return;
+            const std::size_t used = sizes[writing];
+            lock.unlock();
+            bool ok = used == 0 || std::fwrite(buffers[writing].data(), 1, used, file) == used;
+            lock.lock();
+            if (!ok && error.empty()) error = "cannot write " + path + ": " + std::strerror(errno);
+            writing = (writing + 1) % BUFFERS;
+            --queued;
+            changed.notify_all();
+        }
+    }
+
+    std::string path;
+    std::FILE* file;
+    std::vector<char> buffers[BUFFERS];
+    std::size_t sizes[BUFFERS] = {};
+    std::size_t filling = 0;  // encoder's buffer; the writer works through those queued after it
+    std::size_t queued = 0;
+    bool stopping = false;
+    std::string error;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread thread;
+};
+
+// Rows are formatted into one large buffer with std::to_chars (shortest
+// round-trip form); once it passes FLUSH_BYTES it goes to the FileStage,
+// so the file sees a few big sequential writes and formatting never waits
+// for them
+class CsvEncoder : public ExportEncoder {
+public:
+    CsvEncoder(const std::string& path, const std::vector<std::string>& columns)
+            : stage(path, FLUSH_BYTES + LINE_RESERVE), buffer(stage.first()), width(columns.size()) {
+        for (std::size_t c = 0; c < columns.size(); ++c) {
+            if (c) put(',');
+            for (char ch : columns[c]) put(ch);
+        }
+        put('\n');
+    }
+
+    void append(const ExportRow* rows, std::size_t count) override {
+        for (std::size_t r = 0; r < count; ++r) {
+            for (std::size_t c = 0; c < width; ++c) {
+                if (c) put(',');
+                used = static_cast<std::size_t>(format(buffer + used, rows[r][c]) - buffer);
+            }
+            put('\n');
+            if (used >= FLUSH_BYTES) {
+                buffer = stage.next(used);
+                used = 0;
+            }
+        }
+    }
+
+    void finish() override {
+        stage.finish(used);
+        used = 0;
+    }
+
+private:
+    static constexpr std::size_t FLUSH_BYTES = 4u << 20;
+    // Room for one more row past FLUSH_BYTES: 16 columns of at most 24 characters
+    static constexpr std::size_t LINE_RESERVE = EXPORT_MAX_COLUMNS * 32;
+
+    void put(char ch) { buffer[used++] = ch; }
+
+    // Whole numbers (cells, steps) as integers, not 1e+06
+    char* format(char* at, double v) {
+        char* end = buffer + FLUSH_BYTES + LINE_RESERVE;
+        if (v == std::trunc(v) && std::fabs(v) < 0x1p53) return std::to_chars(at, end, static_cast<int64_t>(v)).ptr;
+        return std::to_chars(at, end, v).ptr;
+    }
+
+    FileStage stage;
+    char* buffer;  // the stage's buffer being filled
+    std::size_t width;
+    std::size_t used = 0;
+};
+
+} // namespace
+
+ExportFormat export_format_for(const std::string& path) {
+    if (ends_with(path, ".arrow") || ends_with(path, ".feather")) return ExportFormat::Arrow;
+    if (ends_with(path, ".parquet")) return ExportFormat::Parquet;
+    return ExportFormat::Csv;
+}
+
+bool export_format_available(ExportFormat format) {
+#ifdef PID_HAVE_ARROW
+    static_cast<void>(format);
+    return true;
+#else
+    return format == ExportFormat::Csv;
+#endif
+}
+
+std::unique_ptr<ExportEncoder> make_csv_encoder(const std::string& path, const std::vector<std::string>& columns) {
+    return std::make_unique<CsvEncoder>(path, columns);
+}
+
+Exporter::Exporter(const std::string& path, std::vector<std::string> columns, unsigned producers)
+        : Exporter(path, std::move(columns), producers, export_format_for(path)) {}
+
+Exporter::Exporter(const std::string& path, std::vector<std::string> columns, unsigned producers, ExportFormat format)
+        : names(std::move(columns)), output_format(format) {
+    if (names.empty() || names.size() > EXPORT_MAX_COLUMNS) {
+        throw std::invalid_argument("exports take 1 to 16 columns");
+    }
+    if (producers == 0) throw std::invalid_argument("an export needs at least one producer");
+    if (!export_format_available(format)) {
+        throw std::invalid_argument(path + ": Arrow and Parquet exports need a build with -DPID_ARROW=ON");
+    }
+#ifdef PID_HAVE_ARROW
+    if (format != ExportFormat::Csv) encoder = make_arrow_encoder(path, names, format == ExportFormat::Parquet);
+#endif
+    if (!encoder) encoder = make_csv_encoder(path, names);
+
+    rings.reserve(producers);
+    for (unsigned p = 0; p < producers; ++p) rings.push_back(std::make_unique<Ring>());
+    writer = std::thread(&Exporter::writer_main, this);
+}
+
+Exporter::~Exporter() {
+    try {
+        close();
+    } catch (...) {
+        // Destructors must not throw; call close() to see the error
+    }
+}
+
+std::size_t Exporter::drain() {
+    std::size_t n = 0;
+    for (auto& ring : rings) {
+        const ExportRow* first;
+        std::size_t total;
+        // Up to the wrap, then from the start of the ring; anything pushed
+        // meanwhile waits for the next pass so one busy ring cannot starve the rest
+        for (int pass = 0; pass < 2; ++pass) {
+            std::size_t span = ring->peek(first, total);
+            if (span == 0) break;
+            if (error.empty()) {
+                try {
+                    encoder->append(first, span);
+                } catch (const std::exception& e) {
+                    error = e.what();  // keep draining so producers never block on a dead writer
+                }
+            }
+            ring->consume(span);
+            n += span;
+        }
+    }
+    if (n) written.fetch_add(n, std::memory_order_relaxed);
+    return n;
+}
+
+void Exporter::writer_main() {
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (drain() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    drain();
+    if (error.empty()) {
+        try {
+            encoder->finish();
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+    }
+}
+
+void Exporter::close() {
+    if (closed) return;
+    closed = true;
+    stopping.store(true, std::memory_order_release);
+    if (writer.joinable()) writer.join();
+    if (!error.empty()) throw std::runtime_error(error);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "spsc_queue.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr std::size_t EXPORT_MAX_COLUMNS = 16;
+
+// One exported row; only the first Exporter::columns().size() values are used
+using ExportRow = std::array<double, EXPORT_MAX_COLUMNS>;
+
+enum class ExportFormat { Csv, Arrow, Parquet };
+
+// By extension: .arrow/.feather (Arrow IPC file), .parquet, anything else CSV
+ExportFormat export_format_for(const std::string& path);
+bool export_format_available(ExportFormat format);  // Arrow/Parquet need -DPID_ARROW=ON
+
+// Turns batches of rows into bytes on disk; runs on the writer thread only
+class ExportEncoder {
+public:
+    virtual ~ExportEncoder() = default;
+    virtual void append(const ExportRow* rows, std::size_t count) = 0;
+    virtual void finish() = 0;
+};
+
+std::unique_ptr<ExportEncoder> make_csv_encoder(const std::string& path, const std::vector<std::string>& columns);
+#ifdef PID_HAVE_ARROW
+std::unique_ptr<ExportEncoder> make_arrow_encoder(const std::string& path, const std::vector<std::string>& columns,
+                                                  bool parquet);
+#endif
+
+// Streams rows of doubles from compute threads to a file. Each producer
+// (a thread pool participant, say) owns one lock-free ring and only pushes
+// into it; a background thread drains every ring and encodes the rows in
+// batches, and the CSV encoder hands its output to a thread of its own
+// for large sequential writes. No compute thread formats or touches the
+// file, and encoding does not wait on the disk. Each stage hands over
+// through a fixed number of bounded buffers, so an export's memory stays
+// the same however long it runs; only when the disk falls behind all of
+// them does a producer wait. Rows from different producers are
+// interleaved in arrival order, so exports carry their own key column
+// (the sweep cell, the step) where order matters.
+class Exporter {
+public:
+    // `producers` rings are created; producer indices are 0 .. producers - 1
+    Exporter(const std::string& path, std::vector<std::string> columns, unsigned producers = 1);
+    Exporter(const std::string& path, std::vector<std::string> columns, unsigned producers, ExportFormat format);
+    ~Exporter();
+
+    Exporter(const Exporter&) = delete;
+    Exporter& operator=(const Exporter&) = delete;
+
+    const std::vector<std::string>& columns() const { return names; }
+    ExportFormat format() const { return output_format; }
+
+    // Producer `producer` only, one thread at a time. Unlike telemetry,
+    // export rows are never dropped: a full ring makes the producer wait
+    // for the writer, which only happens if the disk cannot keep up.
+    void write(unsigned producer, const ExportRow& row) {
+        Ring& ring = *rings[producer];
+        if (ring.push(row)) return;
+        stalls.fetch_add(1, std::memory_order_relaxed);
+        while (!ring.push(row)) std::this_thread::yield();
+    }
+
+    // Drains every ring, finishes the file and joins the writer; further
+    // writes are not allowed. Rethrows a write error from the writer thread.
+    void close();
+
+    uint64_t rows_written() const { return written.load(std::memory_order_relaxed); }
+    // Writes that found their ring full and had to wait
+    uint64_t producer_stalls() const { return stalls.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t RING_ROWS = 1 << 13;  // 1 MiB of rows per producer
+    using Ring = SpscQueue<ExportRow, RING_ROWS>;
+
+    void writer_main();
+    std::size_t drain();
+
+    std::vector<std::string> names;
+    ExportFormat output_format;
+    std::unique_ptr<ExportEncoder> encoder;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> stalls{0};
+    std::atomic<bool> stopping{false};
+    std::string error;  // set by the writer thread, read after join
+    bool closed = false;
+    std::thread writer;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace detail {
+
+template <class Storage>
+struct WideOf;
+template <>
+struct WideOf<int32_t> { using type = int64_t; };
+#if defined(__SIZEOF_INT128__)
+template <>
+struct WideOf<int64_t> { using type = __int128; };
+#endif
+
+} // namespace detail
+
+// Saturating two's-complement fixed point with FracBits fractional bits.
+// Products and quotients go through the next wider integer and round to
+// nearest, the way an FPU-less MCU build would implement them.
+template <class Storage, int FracBits>
+class Fixed {
+public:
+    using Wide = typename detail::WideOf<Storage>::type;
+    static constexpr Storage ONE = Storage(1) << FracBits;
+
+    constexpr Fixed() = default;
+    constexpr explicit Fixed(double v) : raw(from_double(v)) {}
+
+    static constexpr Fixed from_raw(Storage r) {
+        Fixed f;
+        f.raw = r;
+        return f;
+    }
+
+    constexpr Storage bits() const { return raw; }
+    constexpr double to_double() const { return static_cast<double>(raw) / ONE; }
+    constexpr explicit operator double() const { return to_double(); }
+
+    friend constexpr Fixed operator+(Fixed a, Fixed b) { return from_raw(saturate(Wide(a.raw) + b.raw)); }
+    friend constexpr Fixed operator-(Fixed a, Fixed b) { return from_raw(saturate(Wide(a.raw) - b.raw)); }
+    friend constexpr Fixed operator*(Fixed a, Fixed b) {
+        Wide p = Wide(a.raw) * b.raw;
+        return from_raw(saturate((p + (Wide(1) << (FracBits - 1))) >> FracBits));
+    }
+    friend constexpr Fixed operator/(Fixed a, Fixed b) {
+        if (b.raw == 0) return from_raw(a.raw < 0 ? MIN : MAX);
+        Wide n = Wide(a.raw) * ONE;
+        Wide half = (b.raw < 0 ? -Wide(b.raw) : Wide(b.raw)) / 2;
+        // Round half away from zero
+        Wide q = ((n < 0) == (b.raw < 0) ? n + half : n - half) / b.raw;
+        return from_raw(saturate(q));
+    }
+    constexpr Fixed operator-() const { return from_raw(saturate(-Wide(raw))); }
+
+    Fixed& operator+=(Fixed b) { return *this = *this + b; }
+    Fixed& operator-=(Fixed b) { return *this = *this - b; }
+    Fixed& operator*=(Fixed b) { return *this = *this * b; }
+    Fixed& operator/=(Fixed b) { return *this = *this / b; }
+
+    friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+    friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+    friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+    friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+    friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+
+private:
+    static constexpr Storage MIN = std::numeric_limits<Storage>::min();
+    static constexpr Storage MAX = std::numeric_limits<Storage>::max();
+
+    static constexpr Storage saturate(Wide v) {
+        return v < MIN ? MIN : (v > MAX ? MAX : static_cast<Storage>(v));
+    }
+    static constexpr Storage from_double(double v) {
+        double scaled = v * ONE;
+        if (scaled <= static_cast<double>(MIN)) return MIN;
+        if (scaled >= static_cast<double>(MAX)) return MAX;
+        return static_cast<Storage>(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+    }
+
+    Storage raw = 0;
+};
+
+// Q16.16: 32-bit storage, range +-32768, resolution 1.5e-5
+using q16_16 = Fixed<int32_t, 16>;
+#if defined(__SIZEOF_INT128__)
+// 31 fractional bits in 64-bit storage. A pure Q1.31 word can't hold the
+// plant's pixel-scale positions and forces, so the integer part is widened.
+using q32_31 = Fixed<int64_t, 31>;
+#define PID_HAVE_Q32_31 1
+#endif
@@ -0,0 +1,32 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(std::size_t capacity)
+        : block(new unsigned char[capacity]), size(capacity) {}
+
+void* FrameArena::allocate(std::size_t bytes, std::size_t align) {
+    auto base = reinterpret_cast<std::uintptr_t>(block.get());
+    std::size_t start = ((base + offset + align - 1) & ~(std::uintptr_t(align) - 1)) - base;
+    if (start + bytes <= size) {
+        offset = start + bytes;
+        return block.get() + start;
+    }
+    // new[] of unsigned char is only aligned for max_align_t, so over-allocate
+    overflow.emplace_back(new unsigned char[bytes + align]);
+    spilled += bytes + align;
+    auto p = reinterpret_cast<std::uintptr_t>(overflow.back().get());
+    return reinterpret_cast<void*>((p + align - 1) & ~(std::uintptr_t(align) - 1));
+}
+
+void FrameArena::reset() {
+    peak = std::max(peak, used());
+    if (!overflow.empty()) {
+        overflow.clear();
+        size = std::max(size * 2, peak);
+        block.reset(new unsigned char[size]);
+    }
+    offset = 0;
+    spilled = 0;
+}
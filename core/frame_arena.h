@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for data that lives for one frame: vertex and point
+// buffers handed straight to the renderer. Everything is released at once
+// by reset() at the top of the next frame. A frame that outgrows the block
+// spills into extra heap blocks; the next reset() folds them into one block
+// of the high-water size, so after warm-up a frame costs no allocation.
+class FrameArena {
+public:
+    explicit FrameArena(std::size_t capacity = 256 * 1024);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t));
+
+    // Uninitialized storage for n objects; nothing is destroyed on reset()
+    template <class T>
+    T* allocate_array(std::size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>, "FrameArena never runs destructors");
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void reset();
+
+    std::size_t used() const { return offset + spilled; }
+    std::size_t capacity() const { return size; }
+    std::size_t high_water() const { return peak; }
+
+private:
+    std::unique_ptr<unsigned char[]> block;
+    std::size_t size;
+    std::size_t offset = 0;
+    std::size_t spilled = 0;  // bytes served from `overflow` this frame
+    std::size_t peak = 0;
+    std::vector<std::unique_ptr<unsigned char[]>> overflow;
+};
@@ -0,0 +1,61 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>
+#endif
+
+FramePacer::FramePacer(double fps) {
+    set_rate(fps);
+#ifdef _WIN32
+    // The default 15.6 ms scheduler tick would swallow a whole 60 Hz frame
+    timeBeginPeriod(1);
+#endif
+}
+
+FramePacer::~FramePacer() {
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::set_rate(double fps) {
+    if (!(fps > 0)) throw std::invalid_argument("frame rate must be positive");
+    period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    next = clock::time_point{};
+}
+
+void FramePacer::wait() {
+    auto now = clock::now();
+    if (next == clock::time_point{} || now - next > period) {
+        // First frame, or more than a frame behind: restart the schedule
+        if (next != clock::time_point{}) ++late;
+        next = now + period;
+        return;
+    }
+    if (now >= next) {
+        ++late;
+        next += period;
+        return;
+    }
+
+    auto wake = next - spin;
+    if (now < wake) {
+        std::this_thread::sleep_until(wake);
+        auto overshoot = clock::now() - wake;
+        worst_overshoot = std::max(worst_overshoot, overshoot);
+        // Widen at once to cover a long oversleep, narrow slowly after
+        auto wanted = overshoot + overshoot / 2;
+        if (wanted > spin) spin = wanted;
+        else spin -= (spin - wanted) / 64;
+        spin = std::clamp<clock::duration>(spin, MIN_SPIN, MAX_SPIN);
+    }
+    while (clock::now() < next) {}
+    next += period;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Caps a render loop at a target rate when presenting does not block on
+// vsync. wait() sleeps until shortly before the next frame deadline and
+// spins the rest. The spin window follows the sleep overshoot actually
+// observed, so it stays sub-millisecond with precise timers and widens on
+// coarse ones. Deadlines advance by whole periods; after a stall the
+// schedule restarts from now instead of rushing out catch-up frames.
+class FramePacer {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit FramePacer(double fps = 60.0);
+    ~FramePacer();
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    void set_rate(double fps);
+    double rate() const { return 1.0 / std::chrono::duration<double>(period).count(); }
+
+    // Blocks until the next deadline; call once per frame after presenting
+    void wait();
+
+    // Current spin window and the worst sleep overshoot seen, seconds
+    double spin_seconds() const { return std::chrono::duration<double>(spin).count(); }
+    double max_overshoot_seconds() const { return std::chrono::duration<double>(worst_overshoot).count(); }
+    uint64_t late_frames() const { return late; }  // deadlines already past on arrival
+
+private:
+    static constexpr std::chrono::microseconds MIN_SPIN{200};
+    static constexpr std::chrono::microseconds MAX_SPIN{3000};
+
+    clock::duration period;
+    clock::time_point next{};
+    clock::duration spin = std::chrono::microseconds(500);
+    clock::duration worst_overshoot{0};
+    uint64_t late = 0;
+};
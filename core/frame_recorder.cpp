@@ -0,0 +1,129 @@
+#include "frame_recorder.h"
+
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+constexpr const char* PIPE_MODE = "wb";
+#else
+constexpr const char* PIPE_MODE = "w";  // POSIX popen has no binary mode, and glibc rejects "wb"
+#endif
+
+namespace {
+
+// The path as one shell word
+std::string shell_quote(const std::string& s) {
+#ifdef _WIN32
+    return "\"" + s + "\"";
+#else
+    std::string quoted = "'";
+    for (char c : s) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+#endif
+}
+
+// One %d conversion, optionally zero-padded to a width, and no other '%'
+bool valid_sequence_pattern(const std::string& s) {
+    std::size_t at = s.find('%');
+    std::size_t i = at + 1;
+    while (i < s.size() && (s[i] == '0' || std::isdigit(static_cast<unsigned char>(s[i])))) ++i;
+    return i < s.size() && s[i] == 'd' && s.find('%', i) == std::string::npos;
+}
+
+} // namespace
+
+FrameRecorder::FrameRecorder(const std::string& path, int width, int height, double fps)
+        : path(path), frame_width(width), frame_height(height), rate(fps),
+          sequence(path.find('%') != std::string::npos) {
+    if (width <= 0 || height <= 0) throw std::invalid_argument("frame size must be positive");
+    if (!(fps > 0.0)) throw std::invalid_argument("recording frame rate must be positive");
+    if (sequence && !valid_sequence_pattern(path)) {
+        throw std::invalid_argument(path + ": image sequences take one %d (or %05d) for the frame number");
+    }
+    if (!sequence) {
+        char size[64];
+        std::snprintf(size, sizeof size, "%dx%d -r %g", width, height, fps);
+        std::string command = std::string("ffmpeg -loglevel error -y -f rawvideo -pix_fmt rgb24 -s ") + size +
+                              " -i - -pix_fmt yuv420p " + shell_quote(path);
+#ifndef _WIN32
+        // A dead ffmpeg must turn into a write error, not kill the simulator
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+        pipe = popen(command.c_str(), PIPE_MODE);
+        if (!pipe) throw std::runtime_error("cannot start ffmpeg: " + std::string(std::strerror(errno)));
+    }
+
+    const std::size_t bytes = static_cast<std::size_t>(pitch()) * static_cast<std::size_t>(height);
+    for (std::size_t i = 0; i < POOL_FRAMES; ++i) {
+        buffers.push_back(std::make_unique<uint8_t[]>(bytes));
+        free_frames.push(buffers.back().get());
+    }
+    encoder = std::thread(&FrameRecorder::encoder_main, this);
+}
+
+FrameRecorder::~FrameRecorder() {
+    try {
+        close();
+    } catch (...) {
+        // Destructors must not throw; call close() to see the error
+    }
+}
+
+void FrameRecorder::encode(const uint8_t* pixels) {
+    const std::size_t bytes = static_cast<std::size_t>(pitch()) * static_cast<std::size_t>(frame_height);
+    if (sequence) {
+        char name[1024];
+        std::snprintf(name, sizeof name, path.c_str(), static_cast<int>(written.load(std::memory_order_relaxed)));
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(name, "wb"), &std::fclose);
+        if (!file) throw std::runtime_error("cannot write " + std::string(name) + ": " + std::strerror(errno));
+        std::fprintf(file.get(), "P6\n%d %d\n255\n", frame_width, frame_height);
+        if (std::fwrite(pixels, 1, bytes, file.get()) != bytes) throw std::runtime_error("cannot write " + std::string(name));
+    } else if (std::fwrite(pixels, 1, bytes, pipe) != bytes) {
+        throw std::runtime_error("ffmpeg stopped taking frames for " + path);
+    }
+    written.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameRecorder::encoder_main() {
+    for (;;) {
+        // Read the flag first, so the final pass sees every frame submitted before close()
+        bool last = stopping.load(std::memory_order_acquire);
+        uint8_t* pixels;
+        bool any = false;
+        while (ready_frames.pop(pixels)) {
+            if (error.empty()) {
+                try {
+                    encode(pixels);
+                } catch (const std::exception& e) {
+                    error = e.what();  // keep recycling buffers so the render side never runs dry
+                }
+            }
+            free_frames.push(pixels);
+            any = true;
+        }
+        if (last) break;
+        if (!any) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+void FrameRecorder::close() {
+    if (closed) return;
+    closed = true;
+    stopping.store(true, std::memory_order_release);
+    if (encoder.joinable()) encoder.join();
+    if (pipe) {
+        int status = pclose(pipe);
+        pipe = nullptr;
+        if (status != 0 && error.empty()) error = "ffmpeg failed writing " + path + " (exit status " + std::to_string(status) + ")";
+    }
+    if (!error.empty()) throw std::runtime_error(error);
+}
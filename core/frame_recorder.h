@@ -0,0 +1,92 @@
+#pragma once
+
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Records rendered frames as RGB24 (3 bytes per pixel, rows top to bottom,
+// no padding) to an image sequence or a video. The render thread borrows a
+// buffer from a fixed pool, reads the frame back into it and submits it; an
+// encoder thread writes it out and returns the buffer to the pool. Nothing
+// on the render side blocks or allocates: with every buffer still queued
+// for the encoder, acquire() returns nullptr and the frame is dropped.
+//
+// A path containing a printf conversion ("shots/frame%05d.ppm") is written
+// as numbered binary PPM images; anything else is piped as raw video to
+// ffmpeg, which must be on PATH and picks the container from the extension.
+class FrameRecorder {
+public:
+    // Frames in flight between the render and encoder threads
+    static constexpr std::size_t POOL_FRAMES = 8;
+
+    FrameRecorder(const std::string& path, int width, int height, double fps);
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    int width() const { return frame_width; }
+    int height() const { return frame_height; }
+    int pitch() const { return frame_width * 3; }
+
+    // Render thread: true when wall time `seconds` (from any fixed origin)
+    // has reached the next capture slot of the video's frame rate. Renders
+    // faster than `fps` are thinned out; slower ones capture every frame
+    // and the recording plays back faster than real time.
+    bool due(double seconds) {
+        if (next_slot < 0.0) next_slot = seconds;
+        if (seconds < next_slot) return false;
+        next_slot += 1.0 / rate;
+        if (next_slot <= seconds) next_slot = seconds + 1.0 / rate;  // fell behind: restart the clock
+        return true;
+    }
+
+    // Render thread: a free buffer of height() * pitch() bytes, or nullptr
+    // (the frame is counted as dropped) while the encoder is behind
+    uint8_t* acquire() {
+        uint8_t* pixels = nullptr;
+        if (held) std::swap(pixels, held);
+        else if (!free_frames.pop(pixels)) dropped.fetch_add(1, std::memory_order_relaxed);
+        return pixels;
+    }
+
+    // Render thread: hands an acquire()d buffer, now filled, to the encoder
+    void submit(uint8_t* pixels) { ready_frames.push(pixels); }
+    // Render thread: gives back an acquire()d buffer that never got a frame
+    void discard(uint8_t* pixels) { held = pixels; }
+
+    // Encodes whatever was submitted, finishes the file and joins the
+    // encoder. Rethrows a write error from the encoder thread.
+    void close();
+
+    uint64_t frames_written() const { return written.load(std::memory_order_relaxed); }
+    uint64_t frames_dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    void encoder_main();
+    void encode(const uint8_t* pixels);
+
+    std::string path;
+    int frame_width, frame_height;
+    double rate;
+    double next_slot = -1.0;
+    uint8_t* held = nullptr;  // discarded buffer, handed out again first
+    bool sequence;  // numbered PPM files rather than an ffmpeg pipe
+    std::FILE* pipe = nullptr;
+    std::vector<std::unique_ptr<uint8_t[]>> buffers;
+    SpscQueue<uint8_t*, POOL_FRAMES> free_frames;   // encoder -> render thread
+    SpscQueue<uint8_t*, POOL_FRAMES> ready_frames;  // render thread -> encoder
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> stopping{false};
+    std::string error;  // set by the encoder thread, read after join
+    bool closed = false;
+    std::thread encoder;
+};
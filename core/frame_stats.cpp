@@ -0,0 +1,70 @@
+#include "frame_stats.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+FrameStats::FrameStats(std::size_t window)
+        : samples(window) {
+    scratch.reserve(samples.capacity());
+}
+
+template <class Get>
+Percentiles FrameStats::summarize(Get get) const {
+    Percentiles out;
+    const std::size_t n = samples.size();
+    if (n == 0) return out;
+
+    scratch.clear();
+    for (std::size_t i = 0; i < n; ++i) scratch.push_back(get(samples[i]));
+    auto at = [&](double q) {
+        auto k = static_cast<std::ptrdiff_t>(q * (n - 1) + 0.5);
+        std::nth_element(scratch.begin(), scratch.begin() + k, scratch.end());
+        return scratch[k];
+    };
+    out.p50 = at(0.50);
+    out.p99 = at(0.99);
+    out.max = *std::max_element(scratch.begin(), scratch.end());
+    return out;
+}
+
+Percentiles FrameStats::phase(FramePhase p) const {
+    return summarize([p](const FrameSample& s) { return s.seconds[static_cast<int>(p)]; });
+}
+
+Percentiles FrameStats::total() const {
+    return summarize([](const FrameSample& s) { return s.total; });
+}
+
+Percentiles FrameStats::substeps() const {
+    return summarize([](const FrameSample& s) { return static_cast<double>(s.substeps); });
+}
+
+Percentiles FrameStats::allocations() const {
+    return summarize([](const FrameSample& s) { return static_cast<double>(s.allocations); });
+}
+
+const char* FrameStats::phase_name(FramePhase p) {
+    switch (p) {
+        case FramePhase::Events:  return "events";
+        case FramePhase::Physics: return "physics";
+        case FramePhase::Render:  return "render";
+        case FramePhase::Text:    return "text";
+        case FramePhase::Capture: return "capture";
+        case FramePhase::Present: return "present";
+        default:                  return "?";
+    }
+}
+
+void FrameStats::write_csv_header(std::FILE* out) {
+    std::fprintf(out, "frame");
+    for (int p = 0; p < static_cast<int>(FramePhase::Count); ++p) {
+        std::fprintf(out, ",%s_ms", phase_name(static_cast<FramePhase>(p)));
+    }
+    std::fprintf(out, ",total_ms,substeps,allocations\n");
+}
+
+void FrameStats::write_csv_row(std::FILE* out, uint64_t frame, const FrameSample& sample) {
+    std::fprintf(out, "%" PRIu64, frame);
+    for (double s : sample.seconds) std::fprintf(out, ",%.4f", s * 1e3);
+    std::fprintf(out, ",%.4f,%d,%" PRIu64 "\n", sample.total * 1e3, sample.substeps, sample.allocations);
+}
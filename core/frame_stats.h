@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ring_buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+enum class FramePhase { Events, Physics, Render, Text, Capture, Present, Count };
+
+struct FrameSample {
+    double seconds[static_cast<int>(FramePhase::Count)] = {};
+    double total = 0.0;
+    int substeps = 0;
+    uint64_t allocations = 0;  // operator new calls on the GUI thread
+};
+
+struct Percentiles {
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+// Sliding window of per-frame phase timings. Percentiles are computed on
+// demand into a preallocated scratch buffer, so nothing allocates per frame.
+class FrameStats {
+public:
+    explicit FrameStats(std::size_t window = 240);
+
+    void push(const FrameSample& sample) { samples.push(sample); }
+    std::size_t size() const { return samples.size(); }
+    const FrameSample& newest() const { return samples.newest(); }
+
+    Percentiles phase(FramePhase p) const;
+    Percentiles total() const;
+    Percentiles substeps() const;
+    Percentiles allocations() const;
+
+    static const char* phase_name(FramePhase p);
+
+    // One CSV row per frame, milliseconds
+    static void write_csv_header(std::FILE* out);
+    static void write_csv_row(std::FILE* out, uint64_t frame, const FrameSample& sample);
+
+private:
+    template <class Get>
+    Percentiles summarize(Get get) const;
+
+    RingBuffer<FrameSample> samples;
+    mutable std::vector<double> scratch;
+};
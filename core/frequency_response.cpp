@@ -0,0 +1,185 @@
+#include "frequency_response.h"
+#include "batch_engine.h"
+#include "sensor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double PV_OFFSET = BALL_SIZE / 2;
+
+// Fraction of the way from va to vb at which a linear segment reaches `at`
+double crossing(double va, double vb, double at) {
+    return vb != va ? (at - va) / (vb - va) : 0.0;
+}
+
+double lerp_log_hz(double ha, double hb, double t) {
+    return std::exp(std::log(ha) + (std::log(hb) - std::log(ha)) * t);
+}
+
+} // namespace
+
+std::complex<double> loop_transfer(double kp, double ki, double kd, double dt, unsigned delay_steps, double hz) {
+    const std::complex<double> z = std::polar(1.0, 2.0 * PI * hz * dt);
+    const std::complex<double> back = 1.0 - 1.0 / z;  // 1 - z^-1
+    std::complex<double> controller = kp + ki * dt / back + kd * back / dt;
+    std::complex<double> plant = dt * dt * z / ((z - 1.0) * (z - 1.0));
+    return controller * plant * std::pow(z, -static_cast<double>(delay_steps));
+}
+
+StabilityMargins stability_margins(const std::vector<double>& hz, const std::vector<std::complex<double>>& loop) {
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    StabilityMargins m{inf, nan, -inf, nan, inf, nan, inf, nan};
+    if (loop.empty()) return m;
+
+    // Unwrapped phase in degrees, continuous from the lowest frequency
+    std::vector<double> phase(loop.size());
+    phase[0] = std::arg(loop[0]) * 180.0 / PI;
+    for (std::size_t i = 1; i < loop.size(); ++i) {
+        double step = std::arg(loop[i] / loop[i - 1]) * 180.0 / PI;
+        phase[i] = phase[i - 1] + step;
+    }
+
+    for (std::size_t i = 0; i < loop.size(); ++i) {
+        double distance = std::abs(1.0 + loop[i]);
+        if (distance < m.modulus_margin) {
+            m.modulus_margin = distance;
+            m.modulus_hz = hz[i];
+        }
+    }
+
+    for (std::size_t i = 1; i < loop.size(); ++i) {
+        // Gain crossover, where |L| goes from above 1 to below
+        double ga = std::log10(std::abs(loop[i - 1])), gb = std::log10(std::abs(loop[i]));
+        if (ga >= 0.0 && gb < 0.0) {
+            double t = crossing(ga, gb, 0.0);
+            double p = phase[i - 1] + (phase[i] - phase[i - 1]) * t;
+            double pm = std::remainder(180.0 + p, 360.0);
+            if (std::abs(pm) < std::abs(m.phase_margin_deg)) {
+                m.phase_margin_deg = pm;
+                m.gain_crossover_hz = lerp_log_hz(hz[i - 1], hz[i], t);
+            }
+        }
+
+        // Phase crossovers, at every odd multiple of 180 deg between the two points
+        double lo = std::min(phase[i - 1], phase[i]), hi = std::max(phase[i - 1], phase[i]);
+        for (double k = std::ceil((lo - 180.0) / 360.0); -180.0 + 360.0 * k <= hi; k += 1.0) {
+            double at = -180.0 + 360.0 * k;
+            if (at < lo || phase[i - 1] == phase[i]) continue;
+            double t = crossing(phase[i - 1], phase[i], at);
+            double gm = -20.0 * (ga + (gb - ga) * t);
+            if (gm >= 0.0 && gm < m.gain_margin_db) {
+                m.gain_margin_db = gm;
+                m.phase_crossover_hz = lerp_log_hz(hz[i - 1], hz[i], t);
+            } else if (gm < 0.0 && gm > m.lower_gain_margin_db) {
+                m.lower_gain_margin_db = gm;
+                m.lower_crossover_hz = lerp_log_hz(hz[i - 1], hz[i], t);
+            }
+        }
+    }
+    return m;
+}
+
+double FrequencyResponse::model_error() const {
+    double worst = 0.0;
+    for (const FrequencyPoint& p : points) {
+        worst = std::max(worst, std::abs(p.measured - p.model) / std::max(std::abs(p.model), 1e-300));
+    }
+    return worst;
+}
+
+StabilityMargins FrequencyResponse::margins() const {
+    std::vector<double> hz(points.size());
+    std::vector<std::complex<double>> loop(points.size());
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        hz[i] = points[i].hz;
+        loop[i] = points[i].measured;
+    }
+    return stability_margins(hz, loop);
+}
+
+FrequencyResponse run_frequency_response(const FrequencyResponseConfig& cfg) {
+    if (cfg.points == 0 || !(cfg.min_hz > 0.0) || !(cfg.max_hz >= cfg.min_hz)) {
+        throw std::invalid_argument("frequency grid needs 0 < min <= max and at least one point");
+    }
+    if (cfg.max_hz >= 0.5 / cfg.dt) throw std::invalid_argument("frequency grid reaches the Nyquist rate 1 / (2 dt)");
+    if (cfg.kp == 0.0 && cfg.ki == 0.0) throw std::invalid_argument("kp or ki must be non-zero to hold the ball up");
+    if (cfg.delay_steps > MAX_SENSOR_DELAY) throw std::invalid_argument("sensor delay is limited to 63 steps");
+
+    const std::size_t n = cfg.points;
+    FrequencyResponse result;
+    result.config = cfg;
+    result.points.resize(n);
+
+    // Equilibrium: the integral carries gravity if it can, else a standing error does
+    double integral_eq = cfg.ki != 0.0 ? std::clamp(GRAVITY / cfg.ki, -INTEGRAL_LIMIT, INTEGRAL_LIMIT) : 0.0;
+    double error_eq = cfg.kp != 0.0 ? (GRAVITY - cfg.ki * integral_eq) / cfg.kp : 0.0;
+    double force_eq = cfg.kp * error_eq + cfg.ki * integral_eq;
+
+    BatchEngine engine(n);
+    std::vector<std::complex<double>> rotation(n), phasor(n, 1.0), force(n), injected(n);
+    std::vector<uint64_t> settle(n), start(n);
+    uint64_t total = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        double hz = n > 1 ? cfg.min_hz * std::pow(cfg.max_hz / cfg.min_hz, static_cast<double>(i) / (n - 1)) : cfg.min_hz;
+        result.points[i].hz = hz;
+        result.points[i].model = loop_transfer(cfg.kp, cfg.ki, cfg.kd, cfg.dt, cfg.delay_steps, hz);
+        rotation[i] = std::polar(1.0, 2.0 * PI * hz * cfg.dt);
+
+        double period_steps = 1.0 / (hz * cfg.dt);
+        settle[i] = static_cast<uint64_t>(std::ceil(cfg.settle_time / cfg.dt + cfg.settle_cycles * period_steps));
+        total = std::max(total, settle[i] + static_cast<uint64_t>(std::ceil(cfg.min_cycles * period_steps)));
+
+        engine.set_gains(i, cfg.kp, cfg.ki, cfg.kd);
+        engine.set_setpoint(i, cfg.setpoint);
+        engine.y[i] = cfg.setpoint - error_eq - PV_OFFSET;
+        engine.integral[i] = integral_eq;
+        engine.prev_error[i] = error_eq;
+    }
+    // All lanes run as long as the slowest one needs, so each correlates as
+    // many whole periods as fit after its own settling time: the longer the
+    // window, the less a fractional period leaks the sine's -w image into w
+    for (std::size_t i = 0; i < n; ++i) {
+        double period_steps = 1.0 / (result.points[i].hz * cfg.dt);
+        double cycles = std::floor(static_cast<double>(total - settle[i]) / period_steps);
+        start[i] = total - static_cast<uint64_t>(std::llround(cycles * period_steps));
+    }
+
+    SensorModel sensor;
+    sensor.delay_steps = cfg.delay_steps;
+    engine.set_sensor(sensor);
+    engine.set_disturbance_enabled(true);
+
+    std::vector<double> last_error(n);
+    for (uint64_t s = 0; s < total; ++s) {
+        for (std::size_t i = 0; i < n; ++i) {
+            engine.disturbance[i] = cfg.amplitude * phasor[i].imag();
+            last_error[i] = engine.prev_error[i];
+        }
+        engine.step(cfg.dt);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (s >= start[i]) {
+                // The kernel's force, rebuilt as evaluate_metrics does, less the equilibrium
+                double e = engine.prev_error[i];
+                double u = cfg.kp * e + cfg.ki * engine.integral[i] + cfg.kd * (e - last_error[i]) / cfg.dt;
+                std::complex<double> basis = std::conj(phasor[i]);
+                force[i] += (u - force_eq) * basis;
+                injected[i] += engine.disturbance[i] * basis;
+            }
+            phasor[i] *= rotation[i];
+        }
+        // The rotation recurrence drifts off the unit circle by rounding
+        if ((s & 1023) == 1023) {
+            for (auto& p : phasor) p /= std::abs(p);
+        }
+    }
+
+    for (std::size_t i = 0; i < n; ++i) result.points[i].measured = -force[i] / (force[i] + injected[i]);
+    result.lane_steps = total * n;
+    return result;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "constants.h"
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Open-loop frequency response L = C P of the PID + ball loop, measured on
+// the closed loop. Each frequency is one BatchEngine lane: the lane starts
+// at the equilibrium that holds the ball against gravity, a small sine force
+// d is injected at the plant input, and after the transient has died out
+// the controller force u and the total force u + d are correlated with the
+// sine. Around the equilibrium u = -L (u + d), so L = -U / (U + D). The
+// result is the response of the discrete loop as stepped, including the
+// sample-and-hold lag of the 1/dt controller and any sensor delay.
+struct FrequencyResponseConfig {
+    double kp = 80.0, ki = 0.0, kd = 0.0;
+    double setpoint = WINDOW_HEIGHT / 2.0;
+    double dt = FIXED_TIMESTEP;
+    unsigned delay_steps = 0;  // sensor delay, see SensorModel
+    // Log-spaced grid in Hz; max_hz must stay below the Nyquist rate 1 / (2 dt)
+    double min_hz = 0.05, max_hz = 25.0;
+    std::size_t points = 200;
+    double amplitude = 1.0;      // of the injected force; small enough to stay clear of the walls
+    double settle_time = 5.0;    // seconds before correlating, plus...
+    double settle_cycles = 3.0;  // ...this many periods of the lane's own frequency
+    double min_cycles = 8.0;     // periods correlated per lane (whole periods, rounded to a step)
+};
+
+struct FrequencyPoint {
+    double hz = 0.0;
+    std::complex<double> measured;  // L(e^{j w dt}) from the simulation
+    std::complex<double> model;     // loop_transfer() at the same frequency
+};
+
+// Margins of a sampled L, interpolated between grid points in log frequency.
+// Where L crosses a threshold more than once, the crossing with the smallest
+// margin wins; a margin with no crossing in the grid is infinite. Gain
+// margins are -20 log10 |L| where the phase crosses -180 deg (mod 360):
+// the upper one is how much the gain may rise, the lower one how far it
+// may fall, as in the conditionally stable PI + double integrator loop.
+struct StabilityMargins {
+    double gain_margin_db;     // > 0, or +inf
+    double phase_crossover_hz;
+    double lower_gain_margin_db;  // < 0, or -inf
+    double lower_crossover_hz;
+    double phase_margin_deg;   // 180 + arg L where |L| falls through 1
+    double gain_crossover_hz;
+    double modulus_margin;     // min |1 + L|, the closest approach to -1
+    double modulus_hz;
+};
+
+struct FrequencyResponse {
+    FrequencyResponseConfig config;
+    std::vector<FrequencyPoint> points;
+    uint64_t lane_steps = 0;
+
+    // Largest |measured - model| / |model| over the grid
+    double model_error() const;
+    StabilityMargins margins() const;
+};
+
+// Analytic L(e^{j w dt}) of the same discrete loop: the rectangular-rule
+// integral and backward-difference derivative of PID_Controller, times
+// Ball::update's semi-implicit Euler double integrator dt^2 z / (z - 1)^2,
+// times z^-delay. Assumes the integral stays inside INTEGRAL_LIMIT.
+std::complex<double> loop_transfer(double kp, double ki, double kd, double dt, unsigned delay_steps, double hz);
+
+StabilityMargins stability_margins(const std::vector<double>& hz, const std::vector<std::complex<double>>& loop);
+
+// Throws std::invalid_argument for a grid past Nyquist or gains that cannot
+// hold the ball up (kp and ki both zero)
+FrequencyResponse run_frequency_response(const FrequencyResponseConfig& config);
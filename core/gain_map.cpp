@@ -0,0 +1,177 @@
+#include "gain_map.h"
+#include "batch_engine.h"
+#include "sweep.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t MAX_BATCH = 1024;  // cells per evaluation pass, so new requests are seen quickly
+constexpr std::size_t MAX_CACHE = 1 << 20;
+
+unsigned default_threads() {
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw > 1 ? hw - 1 : 1;
+}
+
+} // namespace
+
+const char* cost_metric_name(CostMetric metric) {
+    switch (metric) {
+        case CostMetric::Iae:       return "iae";
+        case CostMetric::Ise:       return "ise";
+        case CostMetric::Itae:      return "itae";
+        case CostMetric::Overshoot: return "overshoot";
+        case CostMetric::Settling:  return "settling";
+    }
+    return "?";
+}
+
+bool parse_cost_metric(const char* name, CostMetric& out) {
+    for (CostMetric m : {CostMetric::Iae, CostMetric::Ise, CostMetric::Itae, CostMetric::Overshoot, CostMetric::Settling}) {
+        if (!std::strcmp(name, cost_metric_name(m))) {
+            out = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+GainMap::GainMap(CostMetric metric, uint64_t steps, double dt, unsigned threads)
+        : cost_metric(metric), steps(steps), dt(dt), pool(threads ? threads : default_threads()) {
+    worker = std::thread(&GainMap::worker_main, this);
+}
+
+GainMap::~GainMap() {
+    stopping.store(true, std::memory_order_relaxed);
+    worker.join();
+}
+
+void GainMap::request(const GainMapRequest& r) {
+    requests.publish(r);
+    request_count.fetch_add(1, std::memory_order_release);
+}
+
+const GainMapFrame& GainMap::latest() {
+    return frames.read();
+}
+
+float GainMap::cost_of(const LoopMetrics& m) const {
+    switch (cost_metric) {
+        case CostMetric::Iae:       return static_cast<float>(m.iae);
+        case CostMetric::Ise:       return static_cast<float>(m.ise);
+        case CostMetric::Itae:      return static_cast<float>(m.itae);
+        case CostMetric::Overshoot: return static_cast<float>(m.overshoot * 100.0);
+        // Never settling is as bad as settling at the very end
+        case CostMetric::Settling:  return static_cast<float>(std::isnan(m.settling_time) ? m.elapsed : m.settling_time);
+    }
+    return 0.0f;
+}
+
+void GainMap::worker_main() {
+    using namespace std::chrono_literals;
+    int stride = SIZE / 2;
+    while (!stopping.load(std::memory_order_relaxed)) {
+        uint64_t n = request_count.load(std::memory_order_acquire);
+        if (n != seen_requests) {
+            seen_requests = n;
+            GainMapRequest r = requests.read();
+            // Cached costs stay valid as long as only the two mapped gains move
+            bool same_slice = r.axes == current.axes && r.setpoint == current.setpoint &&
+                              (r.axes == GainAxes::KpKd ? r.ki == current.ki : r.kd == current.kd);
+            if (!same_slice || cache.size() > MAX_CACHE) cache.clear();
+            current = r;
+            double y_gain = r.axes == GainAxes::KpKd ? r.kd : r.ki;
+            origin_x = std::max(0, static_cast<int>(std::lround(r.kp / KP_STEP)) - SIZE / 2);
+            origin_y = std::max(0, static_cast<int>(std::lround(y_gain / y_step())) - SIZE / 2);
+            stride = SIZE / 2;
+            compose_frame();  // shifted window from whatever is cached, right away
+            continue;
+        }
+        if (seen_requests == 0) {
+            std::this_thread::sleep_for(10ms);
+            continue;
+        }
+        if (evaluate_pending(stride)) {
+            compose_frame();
+        } else if (stride > 1) {
+            stride /= 2;
+        } else {
+            std::this_thread::sleep_for(10ms);  // window complete; wait for the next request
+        }
+    }
+}
+
+// Evaluates up to MAX_BATCH uncached cells on the lattice of `stride`;
+// returns false once that level of the window is complete
+bool GainMap::evaluate_pending(int stride) {
+    std::vector<uint64_t> pending;
+    for (int y = 0; y < SIZE && pending.size() < MAX_BATCH; ++y) {
+        int ly = origin_y + y;
+        if (ly % stride) continue;
+        for (int x = 0; x < SIZE && pending.size() < MAX_BATCH; ++x) {
+            int lx = origin_x + x;
+            if (lx % stride || cache.count(key(lx, ly))) continue;
+            pending.push_back(key(lx, ly));
+        }
+    }
+    if (pending.empty()) return false;
+
+    BatchEngine engine(pending.size());
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        double kp = static_cast<double>(pending[i] >> 32) * KP_STEP;
+        double other = static_cast<double>(static_cast<uint32_t>(pending[i])) * y_step();
+        if (current.axes == GainAxes::KpKd) engine.set_gains(i, kp, current.ki, other);
+        else engine.set_gains(i, kp, other, current.kd);
+        engine.set_setpoint(i, current.setpoint);
+    }
+
+    std::vector<LoopMetrics> metrics(pending.size());
+    std::size_t padded = (pending.size() + BatchEngine::LANE_PAD - 1) / BatchEngine::LANE_PAD * BatchEngine::LANE_PAD;
+    pool.parallel_for(padded, BatchEngine::BLOCK_LANES, [&](std::size_t begin, std::size_t end, unsigned) {
+        LoopMetrics block[BatchEngine::BLOCK_LANES];
+        evaluate_metrics(engine, begin, end, steps, dt, block);
+        std::copy(block, block + (std::min(end, pending.size()) - begin), metrics.begin() + begin);
+    });
+    for (std::size_t i = 0; i < pending.size(); ++i) cache[pending[i]] = cost_of(metrics[i]);
+    return true;
+}
+
+void GainMap::compose_frame() {
+    GainMapFrame& f = frames.back();
+    f.x0 = origin_x * KP_STEP;
+    f.y0 = origin_y * y_step();
+    f.x_step = KP_STEP;
+    f.y_step = y_step();
+    f.axes = current.axes;
+    f.exact = 0;
+    float lo = std::numeric_limits<float>::infinity(), hi = -lo;
+    for (int y = 0; y < SIZE; ++y) {
+        for (int x = 0; x < SIZE; ++x) {
+            float value = std::numeric_limits<float>::quiet_NaN();
+            // Finest available ancestor on the coarse-to-fine lattice
+            for (int s = 1; s <= SIZE / 2; s *= 2) {
+                int lx = origin_x + x, ly = origin_y + y;
+                auto it = cache.find(key(lx - lx % s, ly - ly % s));
+                if (it == cache.end()) continue;
+                value = it->second;
+                if (s == 1) ++f.exact;
+                break;
+            }
+            f.cost[y * SIZE + x] = value;
+            if (std::isfinite(value)) {
+                lo = std::min(lo, value);
+                hi = std::max(hi, value);
+            }
+        }
+    }
+    f.lo = lo <= hi ? lo : 0.0f;
+    f.hi = lo <= hi ? hi : 0.0f;
+    f.version = ++version;
+    frames.publish();
+}
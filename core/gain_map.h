@@ -0,0 +1,95 @@
+#pragma once
+
+#include "constants.h"
+#include "loop_metrics.h"
+#include "thread_pool.h"
+#include "triple_buffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <unordered_map>
+
+enum class GainAxes : uint8_t { KpKd, KpKi };
+
+enum class CostMetric : uint8_t { Iae, Ise, Itae, Overshoot, Settling };
+
+const char* cost_metric_name(CostMetric metric);
+bool parse_cost_metric(const char* name, CostMetric& out);
+
+// What the map should be centred on; posted by the UI thread
+struct GainMapRequest {
+    double kp = 0.0, ki = 0.0, kd = 0.0;
+    double setpoint = 0.0;
+    GainAxes axes = GainAxes::KpKd;
+};
+
+// One published state of the map. Cell (x, y) holds the cost for
+// Kp = x0 + x * x_step along x and Ki or Kd = y0 + y * y_step along y. Cells
+// not evaluated yet show their nearest coarser ancestor; NaN means none.
+struct GainMapFrame {
+    static constexpr int SIZE = 64;
+
+    float cost[SIZE * SIZE];
+    double x0 = 0.0, y0 = 0.0, x_step = 0.0, y_step = 0.0;
+    float lo = 0.0f, hi = 0.0f;  // finite cost range, for colour scaling
+    int exact = 0;               // cells evaluated at full resolution
+    GainAxes axes = GainAxes::KpKd;
+    uint64_t version = 0;        // 0 = nothing published yet
+};
+
+// Cost of every gain pair in a window around the current gains, computed on
+// a background thread from App's initial state through the batch engine.
+// Cells are evaluated coarse to fine on a lattice fixed in gain space, so a
+// window shift after a key press keeps every cell it already had. The UI
+// side only ever touches wait-free triple buffers.
+class GainMap {
+public:
+    static constexpr int SIZE = GainMapFrame::SIZE;
+    // Lattice spacing; Kp matches the Up/Down key step so shifts stay on it
+    static constexpr double KP_STEP = 5.0;
+    static constexpr double KI_STEP = 0.05;
+    static constexpr double KD_STEP = 1.25;
+
+    // threads == 0 leaves one hardware thread for the UI
+    GainMap(CostMetric metric, uint64_t steps = 600, double dt = FIXED_TIMESTEP, unsigned threads = 0);
+    ~GainMap();
+
+    GainMap(const GainMap&) = delete;
+    GainMap& operator=(const GainMap&) = delete;
+
+    CostMetric metric() const { return cost_metric; }
+
+    void request(const GainMapRequest& r);  // UI thread only
+    const GainMapFrame& latest();           // UI thread only
+
+private:
+    void worker_main();
+    bool evaluate_pending(int stride);
+    void compose_frame();
+    float cost_of(const LoopMetrics& m) const;
+
+    int window_x0() const { return origin_x; }
+    int window_y0() const { return origin_y; }
+    double y_step() const { return current.axes == GainAxes::KpKd ? KD_STEP : KI_STEP; }
+    static uint64_t key(int x, int y) { return (static_cast<uint64_t>(x) << 32) | static_cast<uint32_t>(y); }
+
+    const CostMetric cost_metric;
+    const uint64_t steps;
+    const double dt;
+
+    TripleBuffer<GainMapRequest> requests;
+    std::atomic<uint64_t> request_count{0};
+    TripleBuffer<GainMapFrame> frames;
+
+    // Worker-owned
+    ThreadPool pool;
+    GainMapRequest current;
+    uint64_t seen_requests = 0;
+    int origin_x = 0, origin_y = 0;  // lattice index of window cell (0, 0)
+    std::unordered_map<uint64_t, float> cache;
+    uint64_t version = 0;
+
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+};
@@ -0,0 +1,153 @@
+#include "gain_schedule.h"
+#include "batch_kernels.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr char SCHEDULE_HEADER[] = "# pid gain schedule";
+
+void check_axis(const GainSchedule::Axis& a) {
+    if (a.points == 0 || !(a.max >= a.min) || (a.points > 1 && a.max == a.min)) {
+        throw std::invalid_argument("gain schedule axes need points >= 1 and min < max");
+    }
+}
+
+} // namespace
+
+GainSchedule::GainSchedule(const Axis& u, std::vector<ScheduledGains> gains, unsigned hold)
+        : GainSchedule(u, Axis{u.input == Y ? Setpoint : Y, 0.0, 0.0, 1}, std::move(gains), hold) {
+    dims = 1;
+}
+
+GainSchedule::GainSchedule(const Axis& u, const Axis& v, std::vector<ScheduledGains> gains, unsigned hold)
+        : axes{u, v}, dims(2), hold(hold) {
+    check_axis(u);
+    check_axis(v);
+    if (hold == 0) throw std::invalid_argument("gain schedule hold must be at least one step");
+    if (gains.size() != static_cast<std::size_t>(u.points) * v.points) {
+        throw std::invalid_argument("gain schedule needs one node per grid point");
+    }
+    // A one-point axis is stored as two equal nodes, so every lookup blends four
+    for (int a = 0; a < 2; ++a) {
+        unsigned cells = axes[a].points > 1 ? axes[a].points - 1 : 1;
+        table.min[a] = axes[a].min;
+        table.span[a] = axes[a].points > 1 ? static_cast<double>(cells) : 0.0;
+        table.scale[a] = axes[a].points > 1 ? cells / (axes[a].max - axes[a].min) : 0.0;
+        table.last_cell[a] = static_cast<int>(cells - 1);
+    }
+    const std::size_t columns = std::max(u.points, 2u), rows = std::max(v.points, 2u);
+    nodes.assign(columns * rows * 4, 0.0);
+    for (std::size_t r = 0; r < rows; ++r) {
+        for (std::size_t c = 0; c < columns; ++c) {
+            const ScheduledGains& g = gains[std::min<std::size_t>(r, v.points - 1) * u.points +
+                                            std::min<std::size_t>(c, u.points - 1)];
+            double* node = nodes.data() + (r * columns + c) * 4;
+            node[0] = g.kp;
+            node[1] = g.ki;
+            node[2] = g.kd;
+        }
+    }
+    table.nodes = nodes.data();
+    table.stride = static_cast<std::ptrdiff_t>(columns);
+}
+
+void schedule_lanes_scalar(const ScheduleView& s, const double* u, const double* v, std::size_t begin,
+                           std::size_t end, double* kp, double* ki, double* kd) {
+    for (std::size_t i = begin; i < end; ++i) {
+        ScheduledGains g = schedule_lookup(s, u[i], v[i]);
+        kp[i] = g.kp;
+        ki[i] = g.ki;
+        kd[i] = g.kd;
+    }
+}
+
+GainSchedule::Input parse_schedule_input(const std::string& name) {
+    if (name == "y") return GainSchedule::Y;
+    if (name == "velocity") return GainSchedule::Velocity;
+    if (name == "setpoint") return GainSchedule::Setpoint;
+    throw std::invalid_argument("gain schedule inputs are y, velocity and setpoint, not " + name);
+}
+
+const char* schedule_input_name(GainSchedule::Input input) {
+    switch (input) {
+        case GainSchedule::Velocity: return "velocity";
+        case GainSchedule::Setpoint: return "setpoint";
+        default: return "y";
+    }
+}
+
+GainSchedule load_gain_schedule(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "r");
+    if (!f) throw std::runtime_error("cannot read " + path + ": " + std::strerror(errno));
+    auto fail = [&](const std::string& what) {
+        std::fclose(f);
+        return std::runtime_error(path + ": " + what);
+    };
+
+    char line[256];
+    if (!std::fgets(line, sizeof(line), f) || std::strncmp(line, SCHEDULE_HEADER, sizeof(SCHEDULE_HEADER) - 1) != 0) {
+        throw fail("not a gain schedule (no \"# pid gain schedule\" header)");
+    }
+    GainSchedule::Axis axes[2];
+    int count = 0;
+    unsigned long hold = 1;
+    for (char* token = std::strtok(line + sizeof(SCHEDULE_HEADER) - 1, " \t\r\n"); token;
+         token = std::strtok(nullptr, " \t\r\n")) {
+        char* eq = std::strchr(token, '=');
+        if (eq && std::strncmp(token, "hold=", 5) == 0) {
+            char* end;
+            hold = std::strtoul(eq + 1, &end, 10);
+            if (*end != '\0' || hold == 0 || hold > 1u << 20) throw fail("hold takes a step count");
+            continue;
+        }
+        if (!eq || count == 2) throw fail(std::string("expected one or two NAME=MIN:MAX:POINTS axes, got ") + token);
+        *eq = '\0';
+        GainSchedule::Axis& a = axes[count++];
+        try {
+            a.input = parse_schedule_input(token);
+        } catch (const std::invalid_argument& e) {
+            throw fail(e.what());
+        }
+        char* end;
+        a.min = std::strtod(eq + 1, &end);
+        if (*end == ':') a.max = std::strtod(end + 1, &end);
+        if (*end == ':') a.points = static_cast<unsigned>(std::strtoul(end + 1, &end, 10));
+        if (*end != '\0') throw fail(std::string("expected MIN:MAX:POINTS for ") + token);
+    }
+    if (count == 0) throw fail("gain schedule names no axis");
+    if (count == 2 && axes[0].input == axes[1].input) throw fail("gain schedule axes must differ");
+
+    std::vector<ScheduledGains> gains;
+    unsigned long number = 1;
+    while (std::fgets(line, sizeof(line), f)) {
+        ++number;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+        ScheduledGains g;
+        char* end = line;
+        double* fields[3] = {&g.kp, &g.ki, &g.kd};
+        for (double* field : fields) {
+            char* start = end;
+            *field = std::strtod(start, &end);
+            if (end == start || !std::isfinite(*field)) throw fail("line " + std::to_string(number) + ": expected kp ki kd");
+            while (*end == ',') ++end;
+        }
+        while (*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n') ++end;
+        if (*end != '\0') throw fail("line " + std::to_string(number) + ": expected kp ki kd");
+        gains.push_back(g);
+    }
+    std::fclose(f);
+    try {
+        unsigned steps = static_cast<unsigned>(hold);
+        return count == 1 ? GainSchedule(axes[0], std::move(gains), steps)
+                          : GainSchedule(axes[0], axes[1], std::move(gains), steps);
+    } catch (const std::invalid_argument& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
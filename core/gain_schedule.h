@@ -0,0 +1,137 @@
+#pragma once
+
+#include "aligned.h"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ScheduledGains {
+    double kp = 0.0, ki = 0.0, kd = 0.0;
+};
+
+// Everything a schedule lookup reads, flat, for the scalar lookup below and
+// the per-ISA lane kernels in batch_kernels.h. Axis 0 is u, axis 1 is v.
+struct ScheduleView {
+    const double* nodes;    // kp, ki, kd, 0 per node, rows of `stride` nodes; 32-byte aligned
+    std::ptrdiff_t stride;
+    double min[2];
+    double scale[2];        // cells per unit of the input
+    double span[2];         // cells along the axis, as a double
+    int last_cell[2];
+};
+
+// Fraction across and index of the cell holding x on axis a. Written as
+// selects so they compile to maxsd/minsd; the index converts through int,
+// one instruction where a conversion to a 64-bit unsigned type branches.
+inline int schedule_cell(const ScheduleView& s, int a, double x, double& frac) {
+    double t = (x - s.min[a]) * s.scale[a];
+    t = t > 0.0 ? t : 0.0;
+    t = t < s.span[a] ? t : s.span[a];
+    int i = static_cast<int>(t);
+    i = i < s.last_cell[a] ? i : s.last_cell[a];
+    frac = t - i;
+    return i;
+}
+
+inline ScheduledGains schedule_lookup(const ScheduleView& s, double u, double v) {
+    double fu, fv;
+    int iu = schedule_cell(s, 0, u, fu), iv = schedule_cell(s, 1, v, fv);
+    const double* a = s.nodes + (iv * s.stride + iu) * 4;
+    const double* c = a + s.stride * 4;
+    auto blend = [&](int k) {
+        double lo = a[k] + (a[k + 4] - a[k]) * fu;
+        double hi = c[k] + (c[k + 4] - c[k]) * fu;
+        return lo + (hi - lo) * fv;
+    };
+    return {blend(0), blend(1), blend(2)};
+}
+
+// Kp/Ki/Kd as a function of the operating point, sampled on a regular grid
+// over one or two of the loop's signals and bilinearly interpolated between
+// nodes; outside the grid the edge nodes hold. Nodes are 32 bytes, two per
+// cache line, first axis fastest, so a lookup touches two pairs of adjacent
+// nodes. Lookups have no branches: a 1D table is stored as two equal rows
+// and blended like a 2D one with weight 0. A lookup can be held for
+// several steps, as schedules usually are: the operating point moves far
+// slower than the loop runs. Immutable once built; one schedule can drive
+// any number of loops.
+class GainSchedule {
+public:
+    enum Input : unsigned { Y, Velocity, Setpoint };  // pv (y + BALL_SIZE / 2), ball velocity, setpoint
+
+    struct Axis {
+        Input input = Y;
+        double min = 0.0, max = 0.0;
+        unsigned points = 1;
+    };
+
+    // nodes.size() must be u.points * v.points, u fastest; the gains are
+    // looked up every `hold` steps. Throws std::invalid_argument for an
+    // empty axis, max < min or a zero hold.
+    GainSchedule(const Axis& u, std::vector<ScheduledGains> nodes, unsigned hold = 1);
+    GainSchedule(const Axis& u, const Axis& v, std::vector<ScheduledGains> nodes, unsigned hold = 1);
+    // view() points into the object's own nodes, so copies and moves
+    // re-point it at theirs
+    GainSchedule(const GainSchedule& other) : GainSchedule(other, other.nodes) {}
+    GainSchedule(GainSchedule&& other) noexcept : GainSchedule(other, std::move(other.nodes)) {}
+    GainSchedule& operator=(const GainSchedule& other) { return assign(other, other.nodes); }
+    GainSchedule& operator=(GainSchedule&& other) noexcept { return assign(other, std::move(other.nodes)); }
+
+    const Axis& axis(unsigned i) const { return axes[i]; }
+    unsigned dimensions() const { return dims; }
+    unsigned hold_steps() const { return hold; }
+    const ScheduleView& view() const { return table; }
+
+    ScheduledGains at(double u, double v) const { return schedule_lookup(table, u, v); }
+
+    ScheduledGains at_state(double pv, double velocity, double setpoint) const {
+        const double op[3] = {pv, velocity, setpoint};
+        return at(op[axes[0].input], op[axes[1].input]);
+    }
+
+    // The u and v arrays among a loop's pv, velocity and setpoint arrays
+    void select_inputs(const double* pv, const double* velocity, const double* setpoint,
+                       const double*& u, const double*& v) const {
+        const double* inputs[3] = {pv, velocity, setpoint};
+        u = inputs[axes[0].input];
+        v = inputs[axes[1].input];
+    }
+
+private:
+    // `other`'s shape with `storage` as the nodes
+    GainSchedule(const GainSchedule& other, AlignedVector<double> storage)
+            : axes{other.axes[0], other.axes[1]}, dims(other.dims), hold(other.hold), nodes(std::move(storage)),
+              table(other.table) {
+        table.nodes = nodes.data();
+    }
+    GainSchedule& assign(const GainSchedule& other, AlignedVector<double> storage) {
+        axes[0] = other.axes[0];
+        axes[1] = other.axes[1];
+        dims = other.dims;
+        hold = other.hold;
+        table = other.table;
+        nodes = std::move(storage);
+        table.nodes = nodes.data();
+        return *this;
+    }
+
+    Axis axes[2];
+    unsigned dims;
+    unsigned hold;
+    AlignedVector<double> nodes;  // (u.points or 2) x (v.points or 2) nodes of 4 doubles
+    ScheduleView table;
+};
+
+GainSchedule::Input parse_schedule_input(const std::string& name);  // y, velocity or setpoint
+const char* schedule_input_name(GainSchedule::Input input);
+
+// Text schedule: a "# pid gain schedule" header naming one or two axes as
+// NAME=MIN:MAX:POINTS (NAME y, velocity or setpoint) and optionally
+// hold=STEPS, then "kp ki kd" per node, first axis fastest:
+//     # pid gain schedule y=100:700:3 velocity=-100:100:2 hold=10
+//     60 0.5 10
+//     ...
+// Throws std::runtime_error for an unreadable or malformed file.
+GainSchedule load_gain_schedule(const std::string& path);
@@ -0,0 +1,73 @@
+#include "ghost_preview.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr uint64_t CHECK_EVERY = 256;  // steps between checks for a newer request
+
+} // namespace
+
+GhostPreview::GhostPreview(double horizon, double dt) : horizon(horizon), dt(dt) {
+    worker = std::thread(&GhostPreview::worker_main, this);
+}
+
+GhostPreview::~GhostPreview() {
+    stopping.store(true, std::memory_order_relaxed);
+    worker.join();
+}
+
+void GhostPreview::request(const Simulation& from) {
+    requests.publish(from);
+    request_count.fetch_add(1, std::memory_order_release);
+}
+
+const GhostFrame& GhostPreview::latest() {
+    return frames.read();
+}
+
+void GhostPreview::worker_main() {
+    using namespace std::chrono_literals;
+    uint64_t seen = 0;
+    while (!stopping.load(std::memory_order_relaxed)) {
+        uint64_t n = request_count.load(std::memory_order_acquire);
+        if (n == seen) {
+            std::this_thread::sleep_for(5ms);
+            continue;
+        }
+        // Debounce: wait until requests stop arriving
+        std::this_thread::sleep_for(DEBOUNCE);
+        if (request_count.load(std::memory_order_acquire) != n) continue;
+        seen = n;
+        Simulation from = requests.read();
+        if (!predict(from, n)) abandoned.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool GhostPreview::predict(const Simulation& from, uint64_t generation) {
+    const uint64_t steps = static_cast<uint64_t>(std::ceil(horizon / dt));
+    const uint64_t stride = std::max<uint64_t>(1, (steps + GhostFrame::MAX_POINTS - 1) / GhostFrame::MAX_POINTS);
+
+    GhostFrame& out = frames.back();
+    Simulation sim = from;
+    sim.events = nullptr;  // predictions are not the loop the log describes
+    out.count = 0;
+    out.y[out.count++] = static_cast<float>(sim.ball.y);
+    for (uint64_t s = 1; s <= steps && out.count < GhostFrame::MAX_POINTS; ++s) {
+        sim.step(dt);
+        if (s % stride == 0) out.y[out.count++] = static_cast<float>(sim.ball.y);
+        if (s % CHECK_EVERY == 0 && (request_count.load(std::memory_order_acquire) != generation ||
+                                     stopping.load(std::memory_order_relaxed))) {
+            return false;
+        }
+    }
+    out.start_time = from.time;
+    out.sample_dt = dt * static_cast<double>(stride);
+    out.kp = from.pid.Kp;
+    out.ki = from.pid.Ki;
+    out.kd = from.pid.Kd;
+    out.version = ++version;
+    frames.publish();
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "constants.h"
+#include "simulation.h"
+#include "triple_buffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+// Predicted ball path for new gains, sampled evenly over the horizon
+struct GhostFrame {
+    static constexpr int MAX_POINTS = 512;
+
+    float y[MAX_POINTS];       // ball top, px
+    int count = 0;
+    double start_time = 0.0;   // Simulation::time the prediction starts from
+    double sample_dt = 0.0;    // s between points
+    double kp = 0.0, ki = 0.0, kd = 0.0;
+    uint64_t version = 0;      // 0 = nothing published yet
+};
+
+// Runs the loop forward from a copy of the live Simulation on a background
+// thread whenever the gains change. Requests are debounced and coalesced:
+// a burst of key repeats ends up as one prediction for the last gains, and
+// a newer request abandons the run in progress. The UI side only touches
+// wait-free triple buffers.
+class GhostPreview {
+public:
+    // Quiet time after the latest request before simulating it
+    static constexpr std::chrono::milliseconds DEBOUNCE{40};
+
+    explicit GhostPreview(double horizon = 5.0, double dt = FIXED_TIMESTEP);
+    ~GhostPreview();
+
+    GhostPreview(const GhostPreview&) = delete;
+    GhostPreview& operator=(const GhostPreview&) = delete;
+
+    void request(const Simulation& from);  // UI thread only; `from` carries the new gains
+    const GhostFrame& latest();            // UI thread only
+
+    uint64_t cancelled() const { return abandoned.load(std::memory_order_relaxed); }
+
+private:
+    void worker_main();
+    bool predict(const Simulation& from, uint64_t generation);
+
+    const double horizon;
+    const double dt;
+
+    TripleBuffer<Simulation> requests;
+    std::atomic<uint64_t> request_count{0};
+    TripleBuffer<GhostFrame> frames;
+
+    // Worker-owned
+    uint64_t version = 0;
+
+    std::atomic<uint64_t> abandoned{0};
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+};
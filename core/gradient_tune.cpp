@@ -0,0 +1,107 @@
+#include "gradient_tune.h"
+#include "dual.h"
+#include "simulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+using Dual3 = Dual<3>;
+
+double value_of(double v) { return v; }
+
+// ITAE + effort_weight * effort in the order MetricsAccumulator sums them,
+// so the double instance equals auto_tune_cost() of a metrics run
+template <class T>
+T loop_cost(const GradientTuneConfig& config, T kp, T ki, T kd) {
+    using std::abs;
+    BasicSimulation<T> sim;
+    sim.pid = BasicPID_Controller<T>(kp, ki, kd);
+    sim.setpoint = T(config.setpoint);
+    const T dt(config.dt);
+    const T offset = ScalarTraits<T>::pv_offset();
+    T itae(0.0), effort(0.0);
+    double elapsed = 0.0;
+    for (uint64_t s = 0; s < config.steps; ++s) {
+        sim.step(dt);
+        elapsed += config.dt;
+        T abs_e = abs(sim.setpoint - (sim.ball.y + offset));
+        itae += T(elapsed) * abs_e * dt;
+        effort += abs(sim.output) * dt;
+    }
+    return itae + T(config.effort_weight) * effort;
+}
+
+} // namespace
+
+void GradientTuneConfig::validate() const {
+    if (!(kp_max > 0.0) || !(ki_max >= 0.0) || !(kd_max >= 0.0)) {
+        throw std::invalid_argument("the tuning box needs Kp max > 0 and Ki, Kd max >= 0");
+    }
+    if (!(kp >= 0.0 && kp <= kp_max) || !(ki >= 0.0 && ki <= ki_max) || !(kd >= 0.0 && kd <= kd_max)) {
+        throw std::invalid_argument("the starting gains must lie inside the tuning box");
+    }
+    if (iterations == 0 || steps == 0) throw std::invalid_argument("gradient tuning needs at least one iteration and step");
+    if (!(step > 0.0) || !(min_step > 0.0) || !(effort_weight >= 0.0)) {
+        throw std::invalid_argument("gradient step sizes must be positive and the effort weight not negative");
+    }
+}
+
+CostGradient cost_gradient(const GradientTuneConfig& config, double kp, double ki, double kd) {
+    Dual3 c = loop_cost(config, Dual3::variable(kp, 0), Dual3::variable(ki, 1), Dual3::variable(kd, 2));
+    CostGradient out;
+    out.cost = c.value();
+    out.gradient = c.gradient();
+    return out;
+}
+
+double cost_only(const GradientTuneConfig& config, double kp, double ki, double kd) {
+    return value_of(loop_cost(config, kp, ki, kd));
+}
+
+GradientTuneResult run_gradient_tune(const GradientTuneConfig& config) {
+    config.validate();
+    const double box[3] = {config.kp_max, config.ki_max, config.kd_max};
+    double x[3] = {config.kp / box[0], box[1] > 0.0 ? config.ki / box[1] : 0.0, box[2] > 0.0 ? config.kd / box[2] : 0.0};
+
+    GradientTuneResult result;
+    result.kp = config.kp;
+    result.ki = config.ki;
+    result.kd = config.kd;
+    result.at_best = cost_gradient(config, config.kp, config.ki, config.kd);
+    result.start_cost = result.at_best.cost;
+    result.evaluations = 1;
+
+    double step = config.step;
+    while (result.evaluations < config.iterations && step >= config.min_step) {
+        // Steepest descent of the box-normalised cost; a gain pinned at a
+        // bound with the gradient pushing outwards drops out of the direction
+        double g[3], norm = 0.0;
+        for (int i = 0; i < 3; ++i) {
+            g[i] = result.at_best.gradient[i] * box[i];
+            if ((x[i] <= 0.0 && g[i] > 0.0) || (x[i] >= 1.0 && g[i] < 0.0)) g[i] = 0.0;
+            norm += g[i] * g[i];
+        }
+        norm = std::sqrt(norm);
+        if (!(norm > 0.0)) break;
+
+        double trial[3];
+        for (int i = 0; i < 3; ++i) trial[i] = std::clamp(x[i] - step * g[i] / norm, 0.0, 1.0);
+        CostGradient at = cost_gradient(config, trial[0] * box[0], trial[1] * box[1], trial[2] * box[2]);
+        ++result.evaluations;
+        if (at.cost < result.at_best.cost) {
+            std::copy(trial, trial + 3, x);
+            result.kp = trial[0] * box[0];
+            result.ki = trial[1] * box[1];
+            result.kd = trial[2] * box[2];
+            result.at_best = at;
+            ++result.accepted;
+            step *= 1.5;
+        } else {
+            step *= 0.5;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "constants.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Gain tuning by gradient descent on the cost of auto_tune_cost (ITAE plus
+// a weighted control effort), with the gradient from one forward pass of
+// BasicSimulation<Dual<3>>: the loop is stepped once with Kp, Ki and Kd as
+// the seeded inputs, so a cost and its three partial derivatives cost one
+// run instead of the four of forward differences (six for central ones).
+// See core/dual.h for the subgradients at the clamp and the walls.
+struct GradientTuneConfig {
+    double kp = 80.0, ki = 0.0, kd = 0.0;                 // starting point
+    double kp_max = 400.0, ki_max = 20.0, kd_max = 60.0;  // gains stay in [0, max]
+    double effort_weight = 1e-3;
+    double setpoint = WINDOW_HEIGHT / 2.0;
+    uint64_t steps = 600;
+    double dt = FIXED_TIMESTEP;
+    unsigned iterations = 200;  // evaluations at most
+    double step = 0.05;         // first step length, as a fraction of the box
+    double min_step = 1e-6;     // stop once the step shrinks below this
+
+    void validate() const;  // throws std::invalid_argument
+};
+
+struct CostGradient {
+    double cost = 0.0;
+    std::array<double, 3> gradient{};  // d cost / d (Kp, Ki, Kd)
+};
+
+// One forward pass from App's initial state
+CostGradient cost_gradient(const GradientTuneConfig& config, double kp, double ki, double kd);
+
+// The same cost from a plain double Simulation, for checks and finite differences
+double cost_only(const GradientTuneConfig& config, double kp, double ki, double kd);
+
+struct GradientTuneResult {
+    double kp = 0.0, ki = 0.0, kd = 0.0;
+    CostGradient at_best;
+    double start_cost = 0.0;
+    unsigned evaluations = 0;  // forward passes, each giving cost and gradient
+    unsigned accepted = 0;     // of those, steps that lowered the cost
+};
+
+// Normalised steepest descent in box coordinates with an adaptive step:
+// an improving step is kept and the next one is 1.5x longer, a worsening
+// one is undone and retried at half the length. Every trial is a single
+// forward pass, so its gradient is ready if it is accepted.
+GradientTuneResult run_gradient_tune(const GradientTuneConfig& config);
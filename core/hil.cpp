@@ -0,0 +1,171 @@
+#include "hil.h"
+#include "serial_port.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+uint8_t checksum(const uint8_t* bytes) {
+    uint8_t sum = 0;
+    for (std::size_t i = 0; i + 1 < HIL_FRAME_SIZE; ++i) sum = static_cast<uint8_t>(sum + bytes[i]);
+    return sum;
+}
+
+} // namespace
+
+void encode_hil_frame(const HilFrame& f, uint8_t* out) {
+    out[0] = f.magic;
+    out[1] = static_cast<uint8_t>(f.sequence);
+    out[2] = static_cast<uint8_t>(f.sequence >> 8);
+    std::memcpy(out + 3, &f.value, 4);
+    for (int i = 0; i < 4; ++i) out[7 + i] = static_cast<uint8_t>(f.micros >> (8 * i));
+    out[11] = checksum(out);
+}
+
+bool decode_hil_frame(const uint8_t* in, uint8_t magic, HilFrame& out) {
+    if (in[0] != magic || in[11] != checksum(in)) return false;
+    out.magic = in[0];
+    out.sequence = static_cast<uint16_t>(in[1] | (in[2] << 8));
+    std::memcpy(&out.value, in + 3, 4);
+    out.micros = 0;
+    for (int i = 0; i < 4; ++i) out.micros |= static_cast<uint32_t>(in[7 + i]) << (8 * i);
+    return true;
+}
+
+SerialPlant::SerialPlant(const std::string& device, unsigned baud)
+        : port(std::make_unique<SerialPort>(device, baud)) {}
+
+SerialPlant::~SerialPlant() = default;
+
+bool SerialPlant::send(uint16_t sequence, double output) {
+    HilFrame f;
+    f.magic = HIL_COMMAND_MAGIC;
+    f.sequence = sequence;
+    f.value = static_cast<float>(output);
+    f.micros = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - epoch).count());
+    uint8_t bytes[HIL_FRAME_SIZE];
+    encode_hil_frame(f, bytes);
+    return port->write(bytes, sizeof(bytes)) == sizeof(bytes);
+}
+
+std::size_t SerialPlant::poll(PlantMeasurement* out, std::size_t max) {
+    rx_used += port->read(rx + rx_used, sizeof(rx) - rx_used);
+    const auto now = std::chrono::steady_clock::now();
+
+    std::size_t n = 0, pos = 0;
+    while (rx_used - pos >= HIL_FRAME_SIZE && n < max) {
+        HilFrame f;
+        if (decode_hil_frame(rx + pos, HIL_MEASUREMENT_MAGIC, f)) {
+            out[n++] = {f.sequence, f.value, f.micros, now};
+            pos += HIL_FRAME_SIZE;
+        } else {
+            // Resynchronise one byte at a time; only a wrong checksum counts as an error
+            if (rx[pos] == HIL_MEASUREMENT_MAGIC) ++bad_frames;
+            ++pos;
+        }
+    }
+    std::memmove(rx, rx + pos, rx_used - pos);
+    rx_used -= pos;
+    return n;
+}
+
+bool SimulatedPlant::send(uint16_t sequence, double output) {
+    ball.update(output, dt);
+    latest = {sequence, ball.y + BALL_SIZE / 2, 0, std::chrono::steady_clock::now()};
+    pending = true;
+    return true;
+}
+
+std::size_t SimulatedPlant::poll(PlantMeasurement* out, std::size_t max) {
+    if (!pending || max == 0) return 0;
+    out[0] = latest;
+    pending = false;
+    return 1;
+}
+
+HilReport run_hil(Plant& plant, const HilConfig& config) {
+    using clock = std::chrono::steady_clock;
+    constexpr std::size_t SENT_SLOTS = 1024;  // send times of the newest commands, by sequence
+    constexpr std::size_t MAX_POLL = 32;
+
+    HilReport report;
+    PID_Controller pid(config.kp, config.ki, config.kd);
+    std::vector<clock::time_point> sent(SENT_SLOTS);
+    PlantMeasurement incoming[MAX_POLL];
+    const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(config.dt));
+
+    // Prime with a zero command and wait for the first measurement
+    double pv = 0.0;
+    bool primed = false;
+    plant.send(0, 0.0);
+    for (auto give_up = clock::now() + std::chrono::seconds(1); clock::now() < give_up && !primed;) {
+        std::size_t n = plant.poll(incoming, MAX_POLL);
+        if (n) {
+            pv = incoming[n - 1].pv;
+            primed = true;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    if (!primed) throw std::runtime_error("no measurement from the plant within 1 s");
+
+    uint16_t sequence = 0;
+    const auto start = clock::now();
+    for (uint64_t k = 1; k <= config.cycles; ++k) {
+        const auto deadline = start + period * static_cast<clock::rep>(k);
+        // Sleep in spin-sized slices and spin the final one, polling throughout
+        // so replies are timestamped close to their arrival, not at cycle start
+        std::size_t n = 0;
+        for (auto now = clock::now(); now < deadline; now = clock::now()) {
+            n += plant.poll(incoming + n, MAX_POLL - n);
+            const auto left = deadline - now;
+            if (left > config.spin) std::this_thread::sleep_for(std::min<clock::duration>(config.spin, left - config.spin));
+        }
+        const auto woke = clock::now();
+        const double late = std::chrono::duration<double>(woke - deadline).count();
+        report.jitter.add(late);
+        if (late > config.dt / 2) ++report.late_wakeups;
+
+        bool previous_answered = k == 1;
+        n += plant.poll(incoming + n, MAX_POLL - n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const PlantMeasurement& m = incoming[i];
+            // Only sequences still in the send-time window give a meaningful round trip
+            if (static_cast<uint16_t>(sequence - m.sequence) < SENT_SLOTS) {
+                report.round_trip.add(std::chrono::duration<double>(m.received - sent[m.sequence % SENT_SLOTS]).count());
+            }
+            if (m.sequence == sequence) previous_answered = true;
+        }
+        if (n) pv = incoming[n - 1].pv;
+        else if (k > 1) ++report.stale_cycles;  // cycle 1 follows the priming reply
+        if (!previous_answered) ++report.missed_deadlines;
+
+        double output = pid.calculate(config.setpoint, pv, config.dt);
+        ++sequence;
+        sent[sequence % SENT_SLOTS] = clock::now();
+        if (!plant.send(sequence, output)) ++report.send_failures;
+        ++report.cycles;
+    }
+    report.final_pv = pv;
+    return report;
+}
+
+void HilReport::print(std::FILE* out) const {
+    auto pct = [this](uint64_t v) { return cycles ? 100.0 * static_cast<double>(v) / cycles : 0.0; };
+    Percentiles rt = round_trip.summary(), j = jitter.summary();
+    std::fprintf(out, "cycles       %llu\n", static_cast<unsigned long long>(cycles));
+    std::fprintf(out, "missed       %llu (%.2f %%) deadlines\n", static_cast<unsigned long long>(missed_deadlines), pct(missed_deadlines));
+    std::fprintf(out, "stale        %llu cycles\n", static_cast<unsigned long long>(stale_cycles));
+    std::fprintf(out, "late wakeups %llu\n", static_cast<unsigned long long>(late_wakeups));
+    std::fprintf(out, "send fails   %llu\n", static_cast<unsigned long long>(send_failures));
+    std::fprintf(out, "round trip   p50 %.3f  p99 %.3f  max %.3f ms\n", rt.p50 * 1e3, rt.p99 * 1e3, rt.max * 1e3);
+    round_trip.print(out, "ms", 1e3);
+    std::fprintf(out, "jitter       p50 %.1f  p99 %.1f  max %.1f us\n", j.p50 * 1e6, j.p99 * 1e6, j.max * 1e6);
+    jitter.print(out, "us", 1e6);
+    std::fprintf(out, "final pv     %.3f\n", final_pv);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "histogram.h"
+#include "pid_controller.h"
+#include "simulation.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class SerialPort;
+
+// Wire format shared with the rig firmware (and tools/rig_sim.cpp). Every
+// frame is 12 bytes, little-endian:
+//   [0] magic  [1..2] sequence  [3..6] float32 value  [7..10] uint32 microseconds  [11] checksum
+// Host -> rig carries the controller output; rig -> host echoes the sequence
+// of the command it last applied and carries the measured position (px, the
+// same pv the simulator feeds PID_Controller). The checksum is the byte sum
+// of [0..10].
+constexpr std::size_t HIL_FRAME_SIZE = 12;
+constexpr uint8_t HIL_COMMAND_MAGIC = 0xA5;
+constexpr uint8_t HIL_MEASUREMENT_MAGIC = 0x5A;
+
+struct HilFrame {
+    uint8_t magic = 0;
+    uint16_t sequence = 0;
+    float value = 0.0f;
+    uint32_t micros = 0;  // sender's clock
+};
+
+void encode_hil_frame(const HilFrame& f, uint8_t* out);
+// False if the bytes are not a frame with the expected magic and checksum
+bool decode_hil_frame(const uint8_t* in, uint8_t magic, HilFrame& out);
+
+struct PlantMeasurement {
+    uint16_t sequence = 0;  // command the plant had applied when measuring
+    double pv = 0.0;
+    uint32_t device_micros = 0;
+    std::chrono::steady_clock::time_point received{};
+};
+
+// The process PID_Controller drives in hardware-in-the-loop mode. Both calls
+// are non-blocking and must not allocate: they run once per control cycle.
+class Plant {
+public:
+    virtual ~Plant() = default;
+
+    // Queue the actuator command of cycle `sequence`; false if it could not be sent whole
+    virtual bool send(uint16_t sequence, double output) = 0;
+    // Measurements that arrived since the last call, oldest first, up to `max`
+    virtual std::size_t poll(PlantMeasurement* out, std::size_t max) = 0;
+};
+
+// Plant on a serial/USB link speaking the frame format above. 1 kHz needs
+// about 12 kB/s each way: 230400 baud or a USB CDC device.
+class SerialPlant : public Plant {
+public:
+    SerialPlant(const std::string& device, unsigned baud);
+    ~SerialPlant() override;
+
+    bool send(uint16_t sequence, double output) override;
+    std::size_t poll(PlantMeasurement* out, std::size_t max) override;
+
+    uint64_t framing_errors() const { return bad_frames; }
+
+private:
+    std::unique_ptr<SerialPort> port;
+    uint8_t rx[512];
+    std::size_t rx_used = 0;
+    uint64_t bad_frames = 0;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+// In-process Ball answering instantly, for dry runs of the HIL loop
+class SimulatedPlant : public Plant {
+public:
+    explicit SimulatedPlant(double dt) : dt(dt) {}
+
+    bool send(uint16_t sequence, double output) override;
+    std::size_t poll(PlantMeasurement* out, std::size_t max) override;
+
+private:
+    Ball ball;
+    double dt;
+    bool pending = false;
+    PlantMeasurement latest;
+};
+
+struct HilConfig {
+    double dt = FIXED_TIMESTEP;
+    uint64_t cycles = 600;
+    double setpoint = WINDOW_HEIGHT / 2.0;
+    double kp = 80.0, ki = 0.0, kd = 0.0;
+    // The deadline for a command's measurement is the start of the next cycle
+    // (round trip < dt). Between cycles the loop sleeps in slices this long,
+    // polling the plant after each, and spins through the last one.
+    std::chrono::microseconds spin{200};
+};
+
+struct HilReport {
+    uint64_t cycles = 0;
+    uint64_t missed_deadlines = 0;  // no measurement for the previous command by cycle start
+    uint64_t stale_cycles = 0;      // no new measurement at all; the last pv was reused
+    uint64_t send_failures = 0;     // driver buffer full, command not sent whole
+    uint64_t late_wakeups = 0;      // cycle started more than dt/2 late
+    Histogram round_trip{50e-6, 200};  // seconds, command sent -> its measurement received
+    Histogram jitter{10e-6, 200};      // seconds, actual cycle start - scheduled start
+    double final_pv = 0.0;
+
+    void print(std::FILE* out) const;
+};
+
+// Runs the controller against `plant` at a fixed rate on the calling thread
+HilReport run_hil(Plant& plant, const HilConfig& config);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "frame_stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Fixed-width bucket histogram for latency-style samples. Storage is
+// allocated once up front, so add() is safe inside a hard-deadline loop.
+class Histogram {
+public:
+    Histogram(double bucket_width, std::size_t buckets)
+            : width(bucket_width), counts(buckets + 1, 0) {}  // last bucket = overflow
+
+    void add(double value) {
+        std::size_t b = value <= 0 ? 0 : static_cast<std::size_t>(value / width);
+        ++counts[std::min(b, counts.size() - 1)];
+        ++total;
+        peak = std::max(peak, value);
+        sum += value;
+    }
+
+    uint64_t count() const { return total; }
+    double max() const { return peak; }
+    double mean() const { return total ? sum / static_cast<double>(total) : 0.0; }
+
+    // Upper edge of the bucket holding quantile q; overflow reports the max
+    double percentile(double q) const {
+        if (total == 0) return 0.0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (std::size_t b = 0; b + 1 < counts.size(); ++b) {
+            seen += counts[b];
+            if (seen >= rank) return std::min(width * static_cast<double>(b + 1), peak);
+        }
+        return peak;
+    }
+
+    Percentiles summary() const { return {percentile(0.5), percentile(0.99), peak}; }
+
+    // Non-empty buckets as rows of '#', values multiplied by `scale` for display
+    void print(std::FILE* out, const char* unit, double scale) const {
+        uint64_t highest = *std::max_element(counts.begin(), counts.end());
+        if (highest == 0) return;
+        for (std::size_t b = 0; b < counts.size(); ++b) {
+            if (!counts[b]) continue;
+            int bar = static_cast<int>(50 * counts[b] / highest) + 1;
+            if (b + 1 < counts.size()) {
+                std::fprintf(out, "  %8.3f-%-8.3f %s %10llu %.*s\n", b * width * scale, (b + 1) * width * scale, unit,
+                             static_cast<unsigned long long>(counts[b]), bar, BAR);
+            } else {
+                std::fprintf(out, "  %8.3f+         %s %10llu %.*s\n", b * width * scale, unit,
+                             static_cast<unsigned long long>(counts[b]), bar, BAR);
+            }
+        }
+    }
+
+private:
+    static constexpr const char* BAR = "###################################################";
+
+    double width;
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    double peak = 0.0;
+    double sum = 0.0;
+};
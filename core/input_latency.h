@@ -0,0 +1,152 @@
+#pragma once
+
+#include "histogram.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// A setpoint click, stamped with the wall time it happened (seconds on the
+// frame loop's clock)
+struct TimedInput {
+    double at = 0.0;
+    double setpoint = 0.0;
+    double x = 0.0;  // horizontal target, used by the planar view
+};
+
+// Clicks waiting for the physics step they belong to. Input is polled once
+// per frame, but the steps run in a frame stand for a span of wall time
+// (dt each, ending where the accumulator leaves off). A click takes effect
+// at the first step whose time slot ends after it, as if the controller
+// had seen it live, not at whichever step the frame happens to start with.
+// Fixed capacity; never allocates.
+class InputTimeline {
+public:
+    static constexpr std::size_t CAPACITY = 32;
+
+    // False when full; the caller then applies the input at once
+    bool push(const TimedInput& input) {
+        if (count == CAPACITY) return false;
+        items[(head + count++) % CAPACITY] = input;
+        return true;
+    }
+
+    // The oldest pending input stamped before `until`, if any
+    bool pop_due(double until, TimedInput& out) {
+        if (count == 0 || items[head].at >= until) return false;
+        out = items[head];
+        head = (head + 1) % CAPACITY;
+        --count;
+        return true;
+    }
+
+    bool empty() const { return count == 0; }
+
+private:
+    std::array<TimedInput, CAPACITY> items{};
+    std::size_t head = 0, count = 0;
+};
+
+// Pointer positions of one left-button drag, resampled to one setpoint per
+// physics step. A fast mouse reports hundreds of motions a frame; each is
+// an O(1) push (motions less than a millisecond apart replace each other),
+// and the frame loop asks once per step for the pointer at the end of the
+// step's time slot, interpolated between the samples either side of it.
+// Fixed capacity; never allocates.
+class DragPath {
+public:
+    static constexpr std::size_t CAPACITY = 256;
+    static constexpr double COALESCE_SECONDS = 1e-3;
+
+    // A click starts a new stroke; whatever is left of the last one goes
+    void begin(const TimedInput& input) {
+        head = count = 0;
+        push(input);
+    }
+
+    void push(const TimedInput& input) {
+        ++motion_count;
+        // Within a millisecond of where the newest sample's slot opened, or
+        // no room: the newest takes the new position
+        if (count && (input.at - slot_start < COALESCE_SECONDS || count == CAPACITY)) {
+            items[newest()] = input;
+            ++coalesced_count;
+            return;
+        }
+        items[(head + count++) % CAPACITY] = input;
+        slot_start = input.at;
+    }
+
+    // The pointer at wall time `until`, once the stroke has reached it.
+    // Between two samples it is interpolated; past the last one it is that
+    // sample, which is then used up, so an idle drag costs nothing.
+    bool sample(double until, TimedInput& out) {
+        if (count == 0 || items[head].at >= until) return false;
+        while (count > 1 && items[(head + 1) % CAPACITY].at < until) {
+            head = (head + 1) % CAPACITY;
+            --count;
+        }
+        ++step_count;
+        const TimedInput& a = items[head];
+        if (count == 1) {
+            out = a;
+            head = count = 0;
+            return true;
+        }
+        const TimedInput& b = items[(head + 1) % CAPACITY];
+        double t = (until - a.at) / (b.at - a.at);
+        out = {until, a.setpoint + (b.setpoint - a.setpoint) * t, a.x + (b.x - a.x) * t};
+        return true;
+    }
+
+    bool empty() const { return count == 0; }
+
+    uint64_t motions() const { return motion_count; }      // samples pushed
+    uint64_t coalesced() const { return coalesced_count; }  // of those, folded into a neighbour
+    uint64_t steps() const { return step_count; }           // physics steps given a setpoint
+
+private:
+    std::size_t newest() const { return (head + count - 1) % CAPACITY; }
+
+    std::array<TimedInput, CAPACITY> items{};
+    std::size_t head = 0, count = 0;
+    double slot_start = 0.0;  // time of the first motion folded into the newest sample
+    uint64_t motion_count = 0, coalesced_count = 0, step_count = 0;
+};
+
+// Click-to-response latency, in seconds: to the physics step that first
+// steers toward the new setpoint, and to the present of the first frame
+// that shows that step
+class InputLatency {
+public:
+    // Step about to run at wall time `now` acts on an input from `at`
+    void applied(double at, double now) {
+        to_step.add(now - at);
+        if (waiting < awaiting.size()) awaiting[waiting++] = at;
+    }
+
+    // A frame has just been presented at `now`
+    void presented(double now) {
+        for (std::size_t i = 0; i < waiting; ++i) to_present.add(now - awaiting[i]);
+        waiting = 0;
+    }
+
+    const Histogram& step_latency() const { return to_step; }
+    const Histogram& present_latency() const { return to_present; }
+
+    void print(std::FILE* out) const {
+        if (to_step.count() == 0) return;
+        Percentiles s = to_step.summary(), p = to_present.summary();
+        std::fprintf(out, "input latency over %llu clicks (p50 / p99 / max, ms)\n",
+                     static_cast<unsigned long long>(to_step.count()));
+        std::fprintf(out, "  to physics step  %7.2f %7.2f %7.2f\n", s.p50 * 1e3, s.p99 * 1e3, s.max * 1e3);
+        std::fprintf(out, "  to present       %7.2f %7.2f %7.2f\n", p.p50 * 1e3, p.p99 * 1e3, p.max * 1e3);
+    }
+
+private:
+    Histogram to_step{0.5e-3, 400};  // 0.5 ms buckets up to 200 ms
+    Histogram to_present{0.5e-3, 400};
+    std::array<double, InputTimeline::CAPACITY> awaiting{};  // applied, not yet on screen
+    std::size_t waiting = 0;
+};
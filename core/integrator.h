@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstring>
+#include <initializer_list>
+
+// How BasicSimulation::step advances the loop over one dt
+enum class Integrator {
+    // Sampled controller, semi-implicit Euler plant: the original model.
+    // First order; the batch kernels reproduce it bit for bit.
+    SemiImplicitEuler,
+    // Sampled controller, plant advanced exactly under the held force.
+    // Zero integrator error for the sampled-data loop at any dt.
+    ExactZoh,
+    // Controller treated as continuous (derivative on -velocity, integral as
+    // a state) and the whole closed loop integrated with classic RK4.
+    // Fourth order against the continuous-time response.
+    Rk4,
+};
+
+inline const char* integrator_name(Integrator m) {
+    switch (m) {
+        case Integrator::SemiImplicitEuler: return "euler";
+        case Integrator::ExactZoh:          return "zoh";
+        case Integrator::Rk4:               return "rk4";
+    }
+    return "?";
+}
+
+// Parses the names above; returns false on anything else
+inline bool parse_integrator(const char* name, Integrator& out) {
+    for (Integrator m : {Integrator::SemiImplicitEuler, Integrator::ExactZoh, Integrator::Rk4}) {
+        if (!std::strcmp(name, integrator_name(m))) {
+            out = m;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,72 @@
+#include "lane_stepper.h"
+
+#include "batch_engine.h"
+#include "thread_pool.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// CPU time of the calling thread. Unlike the wall clock it stops while the
+// thread waits for a core, so a pool larger than the machine reports no
+// speedup it did not get.
+double thread_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+} // namespace
+
+LaneStepper::LaneStepper(BatchEngine& engine, ThreadPool* pool, std::size_t min_lanes)
+        : engine(engine),
+          pool(pool && pool->size() > 1 && engine.size() >= min_lanes ? pool : nullptr),
+          padded(engine.y.size()),
+          busy(std::make_unique<Busy[]>(threads())),
+          job([this](std::size_t begin, std::size_t end, unsigned participant) { run_chunk(begin, end, participant); }) {
+    // Each chunk's snapshot lands next to the lanes it copies, as the engine's do
+    previous.resize(padded);
+    auto copy = [this](std::size_t begin, std::size_t end, unsigned) {
+        std::copy(this->engine.y.begin() + begin, this->engine.y.begin() + end, previous.begin() + begin);
+    };
+    if (this->pool) this->pool->parallel_for(padded, BatchEngine::BLOCK_LANES, copy);
+    else copy(0, padded, 0);
+}
+
+unsigned LaneStepper::threads() const {
+    return pool ? pool->size() : 1;
+}
+
+void LaneStepper::run_chunk(std::size_t begin, std::size_t end, unsigned participant) {
+    const double start = thread_seconds();
+    const uint64_t first = job_snapshot ? job_steps - 1 : job_steps;
+    if (first > 0) engine.run_range(begin, end, first, job_dt);
+    if (job_snapshot) {
+        std::copy(engine.y.begin() + begin, engine.y.begin() + end, previous.begin() + begin);
+        engine.run_range(begin, end, 1, job_dt, first);
+    }
+    busy[participant].seconds += thread_seconds() - start;
+}
+
+void LaneStepper::advance(uint64_t steps, double dt, bool snapshot) {
+    if (steps == 0) return;
+    job_steps = steps;
+    job_dt = dt;
+    job_snapshot = snapshot;
+
+    auto start = std::chrono::steady_clock::now();
+    if (pool) pool->parallel_for(padded, BatchEngine::BLOCK_LANES, job);
+    else run_chunk(0, padded, 0);
+    engine.count_steps(steps);
+    totals.wall += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (unsigned p = 0; p < threads(); ++p) {
+        totals.busy += busy[p].seconds;
+        busy[p].seconds = 0.0;
+    }
+    ++totals.calls;
+    totals.steps += steps;
+}
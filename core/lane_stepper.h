@@ -0,0 +1,77 @@
+#pragma once
+
+#include "aligned.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+class BatchEngine;
+class ThreadPool;
+
+// Steps every lane of a BatchEngine across a persistent ThreadPool, one
+// parallel_for over BatchEngine::BLOCK_LANES chunks per advance(). A chunk
+// spans whole cache lines of every lane array (256 doubles), so two
+// participants never write the same line, and parallel_for returns only
+// once every chunk has run: it is the barrier between one advance() and
+// whatever reads or couples the lanes next. The lanes are independent, so
+// within one advance() each chunk runs all its steps before the next, as
+// BatchEngine::run does.
+//
+// An engine smaller than `min_lanes` runs on the calling thread and never
+// wakes the workers: a wake-up and barrier cost tens of microseconds, more
+// than stepping a few thousand lanes. Each participant adds the CPU time of
+// its own chunks to a slot on its own line, so scaling() can tell how much
+// of the pool did useful work.
+class LaneStepper {
+public:
+    static constexpr std::size_t DEFAULT_MIN_LANES = 8192;
+
+    // Neither is owned; `pool` may be null to always run inline
+    LaneStepper(BatchEngine& engine, ThreadPool* pool, std::size_t min_lanes = DEFAULT_MIN_LANES);
+
+    // Steps every lane `steps` times. With `snapshot`, y is copied into
+    // snapshot() before the last step, chunk by chunk, so a renderer can
+    // interpolate from it to y. Counts the steps as BatchEngine::run does.
+    void advance(uint64_t steps, double dt, bool snapshot = false);
+
+    // y before the last step of the latest advance(snapshot = true), padded
+    // like the engine's arrays; the engine's initial y until then
+    const double* snapshot() const { return previous.data(); }
+
+    bool parallel() const { return pool != nullptr; }
+    unsigned threads() const;
+
+    // Wall time of every advance() and the CPU time participants spent
+    // stepping in it; busy / wall is the speedup over one thread doing the
+    // same work, at most threads()
+    struct Scaling {
+        double wall = 0.0, busy = 0.0;
+        uint64_t calls = 0, steps = 0;
+
+        double speedup() const { return wall > 0.0 ? busy / wall : 1.0; }
+    };
+    const Scaling& scaling() const { return totals; }
+    void reset_scaling() { totals = Scaling{}; }
+
+private:
+    struct alignas(CACHE_LINE) Busy {
+        double seconds = 0.0;
+    };
+
+    void run_chunk(std::size_t begin, std::size_t end, unsigned participant);
+
+    BatchEngine& engine;
+    ThreadPool* pool;
+    std::size_t padded;
+    FirstTouchVector<double> previous;
+    std::unique_ptr<Busy[]> busy;  // per participant
+    Scaling totals;
+    // The current advance(); the job reads them, so it is built once and a
+    // step never allocates
+    uint64_t job_steps = 0;
+    double job_dt = 0.0;
+    bool job_snapshot = false;
+    std::function<void(std::size_t, std::size_t, unsigned)> job;
+};
@@ -0,0 +1,90 @@
+#include "load_scaling.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+const char* load_axis_name(LoadAxis axis) {
+    switch (axis) {
+        case LoadAxis::Balls: return "balls";
+        case LoadAxis::PhysicsHz: return "physics_hz";
+        case LoadAxis::History: return "history_s";
+        case LoadAxis::Tiles: return "tiles";
+        case LoadAxis::Count: break;
+    }
+    return "?";
+}
+
+std::vector<LoadPoint> load_scaling_plan() {
+    static const std::vector<double> values[static_cast<int>(LoadAxis::Count)] = {
+            {0, 1000, 4000, 16000, 64000, 100000},
+            {60, 240, 1000, 4000, 16000},
+            {10, 100, 1000, 10000},
+            {0, 1, 4, 8, 15},
+    };
+    std::vector<LoadPoint> plan;
+    for (int a = 0; a < static_cast<int>(LoadAxis::Count); ++a) {
+        for (double v : values[a]) plan.push_back({static_cast<LoadAxis>(a), v});
+    }
+    return plan;
+}
+
+std::size_t resident_bytes() {
+#ifdef __linux__
+    std::FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long long total = 0, resident = 0;
+    const bool ok = std::fscanf(f, "%llu %llu", &total, &resident) == 2;
+    std::fclose(f);
+    return ok ? static_cast<std::size_t>(resident) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+void print_load_scaling(const std::vector<LoadMeasurement>& points, std::FILE* out) {
+    std::fprintf(out, "%-11s %9s %9s %9s %9s %8s %14s %11s %9s\n", "axis", "value", "p50 ms", "p99 ms", "max ms",
+                 "realtime", "loop steps/s", "allocs", "RSS MiB");
+    for (const LoadMeasurement& m : points) {
+        std::fprintf(out, "%-11s %9g %9.3f %9.3f %9.3f %7.2fx %14.0f %11llu %9.1f%s\n", load_axis_name(m.point.axis),
+                     m.point.value, m.frame.p50 * 1e3, m.frame.p99 * 1e3, m.frame.max * 1e3, m.realtime(),
+                     m.steps_per_second(), static_cast<unsigned long long>(m.allocations),
+                     m.resident / (1024.0 * 1024.0), m.saturated() ? "  saturated" : "");
+    }
+    // A series saturates at its first point that cannot keep up
+    for (int a = 0; a < static_cast<int>(LoadAxis::Count); ++a) {
+        const LoadMeasurement* last_ok = nullptr;
+        const LoadMeasurement* first_bad = nullptr;
+        for (const LoadMeasurement& m : points) {
+            if (static_cast<int>(m.point.axis) != a) continue;
+            if (m.saturated()) {
+                first_bad = &m;
+                break;
+            }
+            last_ok = &m;
+        }
+        if (!last_ok && !first_bad) continue;
+        if (!first_bad) {
+            std::fprintf(out, "%-11s keeps up through %g\n", load_axis_name(static_cast<LoadAxis>(a)),
+                         last_ok->point.value);
+        } else if (!last_ok) {
+            std::fprintf(out, "%-11s saturated already at %g\n", load_axis_name(static_cast<LoadAxis>(a)),
+                         first_bad->point.value);
+        } else {
+            std::fprintf(out, "%-11s saturates between %g and %g\n", load_axis_name(static_cast<LoadAxis>(a)),
+                         last_ok->point.value, first_bad->point.value);
+        }
+    }
+}
+
+void write_load_scaling_csv(const std::vector<LoadMeasurement>& points, std::FILE* out) {
+    std::fprintf(out, "axis,value,frames,frame_time,wall_s,frame_p50_ms,frame_p99_ms,frame_max_ms,realtime,"
+                      "physics_hz,loops,loop_steps_per_s,allocations,resident_bytes,saturated\n");
+    for (const LoadMeasurement& m : points) {
+        std::fprintf(out, "%s,%g,%llu,%.9g,%.6f,%.4f,%.4f,%.4f,%.4f,%g,%zu,%.0f,%llu,%zu,%d\n",
+                     load_axis_name(m.point.axis), m.point.value, static_cast<unsigned long long>(m.frames),
+                     m.frame_time, m.wall, m.frame.p50 * 1e3, m.frame.p99 * 1e3, m.frame.max * 1e3, m.realtime(),
+                     m.physics_hz, m.loops, m.steps_per_second(), static_cast<unsigned long long>(m.allocations),
+                     m.resident, m.saturated() ? 1 : 0);
+    }
+}
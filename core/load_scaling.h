@@ -0,0 +1,59 @@
+#pragma once
+
+#include "frame_stats.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// What one series of SDL_game --bench-scaling grows, with everything else
+// at App's defaults
+enum class LoadAxis {
+    Balls,      // --scene balls stepped and drawn behind the interactive one
+    PhysicsHz,  // physics steps per simulated second
+    History,    // seconds of trajectory kept for the plot
+    Tiles,      // --compare loops, each with its own trail and label
+    Count
+};
+
+const char* load_axis_name(LoadAxis axis);
+
+struct LoadPoint {
+    LoadAxis axis;
+    double value;
+};
+
+// Every point of every series, in order. Each series stops at a stated
+// limit: 100000 scene balls (BallScene::MAX_BALLS), 16 kHz physics, 10000 s
+// of history (600k samples at the default rate) and 15 compared loops.
+std::vector<LoadPoint> load_scaling_plan();
+
+// One point, measured over `frames` frames of `frame_time` simulated
+// seconds each after a warm-up
+struct LoadMeasurement {
+    LoadPoint point;
+    uint64_t frames = 0;
+    double frame_time = 0.0;
+    double wall = 0.0;             // seconds the measured frames took
+    Percentiles frame;             // seconds per frame
+    double physics_hz = 0.0;       // of the interactive loop
+    std::size_t loops = 1;         // interactive + scene balls + compared loops
+    uint64_t allocations = 0;      // operator new calls on the GUI thread
+    std::size_t resident = 0;      // bytes, with the app still open
+
+    // Simulated seconds per wall second; below 1 the app cannot keep up
+    double realtime() const { return wall > 0.0 ? frames * frame_time / wall : 0.0; }
+    // Loop steps (every ball and compared loop counts) per wall second
+    double steps_per_second() const { return realtime() * physics_hz * static_cast<double>(loops); }
+    bool saturated() const { return realtime() < 1.0; }
+};
+
+// Resident set size of this process in bytes, 0 where it cannot be read
+std::size_t resident_bytes();
+
+// Table with one row per point, then where each series first saturated
+void print_load_scaling(const std::vector<LoadMeasurement>& points, std::FILE* out);
+// The scaling curve, one row per point, for plotting or diffing against a
+// previous run
+void write_load_scaling_csv(const std::vector<LoadMeasurement>& points, std::FILE* out);
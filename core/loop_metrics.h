@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+// Closed-loop figures of merit for the current step response; times are in
+// seconds since the response began, NaN while not (yet) defined
+struct LoopMetrics {
+    double iae = 0.0;     // integral of |e| dt
+    double ise = 0.0;     // integral of e^2 dt
+    double itae = 0.0;    // integral of t |e| dt
+    double effort = 0.0;  // integral of |u| dt
+    double overshoot = 0.0;  // peak travel past the setpoint, fraction of the step
+    double rise_time = std::numeric_limits<double>::quiet_NaN();      // 10% -> 90% of the step
+    double settling_time = std::numeric_limits<double>::quiet_NaN();  // stays within SETTLING_BAND from here on
+    double elapsed = 0.0;
+};
+
+// Reduces a trajectory to LoopMetrics one sample at a time in O(1) memory,
+// so runs and sweeps never have to keep the trajectory. A setpoint change
+// starts a new step response from the last seen pv.
+class MetricsAccumulator {
+public:
+    // Settling band, as a fraction of the step size
+    static constexpr double SETTLING_BAND = 0.02;
+    // Band used when the setpoint didn't move (regulation around a constant), px
+    static constexpr double MIN_BAND = 1.0;
+
+    explicit MetricsAccumulator(double pv = 0.0, double setpoint = 0.0) { begin(pv, setpoint); }
+
+    void begin(double pv, double setpoint) {
+        m = LoopMetrics{};
+        start_pv = last_pv = pv;
+        target = setpoint;
+        step = setpoint - pv;
+        band = std::fmax(std::fabs(step) * SETTLING_BAND, MIN_BAND);
+        t10 = std::numeric_limits<double>::quiet_NaN();
+        last_outside = 0.0;
+    }
+
+    // pv and output observed at the end of a step of length dt
+    void update(double pv, double setpoint, double output, double dt) {
+        if (setpoint != target) begin(last_pv, setpoint);
+        last_pv = pv;
+        m.elapsed += dt;
+
+        double e = setpoint - pv;
+        double abs_e = std::fabs(e);
+        m.iae += abs_e * dt;
+        m.ise += e * e * dt;
+        m.itae += m.elapsed * abs_e * dt;
+        m.effort += std::fabs(output) * dt;
+
+        if (step != 0.0) {
+            double progress = (pv - start_pv) / step;
+            m.overshoot = std::fmax(m.overshoot, progress - 1.0);
+            if (std::isnan(t10) && progress >= 0.1) t10 = m.elapsed;
+            if (std::isnan(m.rise_time) && progress >= 0.9) m.rise_time = m.elapsed - t10;
+        }
+
+        bool inside = abs_e <= band;
+        if (!inside) last_outside = m.elapsed;
+        m.settling_time = inside ? last_outside : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    const LoopMetrics& metrics() const { return m; }
+
+private:
+    LoopMetrics m;
+    double start_pv = 0.0, last_pv = 0.0, target = 0.0;
+    double step = 0.0, band = MIN_BAND;
+    double t10 = 0.0, last_outside = 0.0;
+};
@@ -0,0 +1,175 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace {
+
+[[noreturn]] void fail(const std::string& what) {
+#ifdef _WIN32
+    throw std::runtime_error(what + " (error " + std::to_string(GetLastError()) + ")");
+#else
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+#endif
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::string& path, Mode mode, std::size_t initial_size)
+        : mode(mode) {
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(),
+                       mode != Read ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                       FILE_SHARE_READ, nullptr,
+                       mode == Write ? CREATE_ALWAYS : mode == Append ? OPEN_ALWAYS : OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        fail("cannot open " + path);
+    }
+    std::size_t size = initial_size;
+    if (mode != Write) {
+        LARGE_INTEGER len;
+        GetFileSizeEx(file, &len);
+        std::size_t existing = static_cast<std::size_t>(len.QuadPart);
+        size = mode == Read || existing > size ? existing : size;
+    }
+#else
+    int flags = mode == Write ? O_RDWR | O_CREAT | O_TRUNC : mode == Append ? O_RDWR | O_CREAT : O_RDONLY;
+    fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0) fail("cannot open " + path);
+    std::size_t size = initial_size;
+    if (mode != Write) {
+        struct stat st;
+        if (fstat(fd, &st) != 0) fail("cannot stat " + path);
+        std::size_t existing = static_cast<std::size_t>(st.st_size);
+        size = mode == Read || existing > size ? existing : size;
+    }
+    if (mode != Read && ftruncate(fd, static_cast<off_t>(size)) != 0) fail("cannot size " + path);
+#endif
+    if (size == 0) throw std::runtime_error(path + " is empty");
+    map(size);
+}
+
+MappedFile::~MappedFile() {
+    if (is_open()) {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        if (is_open()) {
+            try { close(); } catch (...) {}
+        }
+        mode = other.mode;
+        base = std::exchange(other.base, nullptr);
+        mapped = std::exchange(other.mapped, 0);
+#ifdef _WIN32
+        file = std::exchange(other.file, nullptr);
+        mapping = std::exchange(other.mapping, nullptr);
+#else
+        fd = std::exchange(other.fd, -1);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::map(std::size_t size) {
+#ifdef _WIN32
+    DWORD protect = mode != Read ? PAGE_READWRITE : PAGE_READONLY;
+    mapping = CreateFileMappingA(file, nullptr, protect,
+                                 static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                                 static_cast<DWORD>(size), nullptr);
+    if (!mapping) fail("CreateFileMapping");
+    base = static_cast<uint8_t*>(MapViewOfFile(mapping, mode != Read ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size));
+    if (!base) fail("MapViewOfFile");
+#else
+    int prot = mode != Read ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* p = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) fail("mmap");
+    base = static_cast<uint8_t*>(p);
+#endif
+    mapped = size;
+}
+
+void MappedFile::unmap() {
+    if (!base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+    CloseHandle(mapping);
+    mapping = nullptr;
+#else
+    munmap(base, mapped);
+#endif
+    base = nullptr;
+    mapped = 0;
+}
+
+void MappedFile::resize(std::size_t new_size) {
+    if (mode == Read) throw std::logic_error("MappedFile::resize on a read-only map");
+    unmap();
+#ifndef _WIN32
+    if (ftruncate(fd, static_cast<off_t>(new_size)) != 0) fail("ftruncate");
+#endif
+    // On Windows, CreateFileMapping extends the file to the mapping size
+    map(new_size);
+}
+
+void MappedFile::flush_async(std::size_t offset, std::size_t length) {
+    if (!base || length == 0) return;
+#ifdef _WIN32
+    FlushViewOfFile(base + offset, length);
+#else
+    // msync needs a page-aligned start
+    std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t start = offset / page * page;
+    msync(base + start, length + (offset - start), MS_ASYNC);
+#endif
+}
+
+void MappedFile::close(std::size_t final_size) {
+    unmap();
+#ifdef _WIN32
+    if (file) {
+        if (mode != Read) {
+            LARGE_INTEGER len;
+            len.QuadPart = static_cast<LONGLONG>(final_size);
+            SetFilePointerEx(file, len, nullptr, FILE_BEGIN);
+            SetEndOfFile(file);
+        }
+        CloseHandle(file);
+        file = nullptr;
+    }
+#else
+    if (fd >= 0) {
+        if (mode != Read && ftruncate(fd, static_cast<off_t>(final_size)) != 0) {
+            ::close(fd);
+            fd = -1;
+            fail("ftruncate");
+        }
+        ::close(fd);
+        fd = -1;
+    }
+#endif
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Memory-mapped file. Writable maps grow in whole chunks; readable maps
+// cover the file as it was when opened. Write starts the file over, Append
+// keeps what is there and maps at least `initial_size` bytes of it.
+class MappedFile {
+public:
+    enum Mode { Read, Write, Append };
+
+    MappedFile() = default;
+    MappedFile(const std::string& path, Mode mode, std::size_t initial_size = 0);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool is_open() const { return base != nullptr; }
+    uint8_t* data() { return base; }
+    const uint8_t* data() const { return base; }
+    std::size_t size() const { return mapped; }
+
+    // Writable maps only: resize the file and the mapping (data() may move)
+    void resize(std::size_t new_size);
+    // Schedule dirty pages for write-back without waiting for the disk
+    void flush_async(std::size_t offset, std::size_t length);
+    // Unmap and, for writable maps, truncate the file to `final_size`
+    void close(std::size_t final_size);
+    void close() { close(mapped); }
+
+private:
+    void map(std::size_t size);
+    void unmap();
+
+    Mode mode = Read;
+    uint8_t* base = nullptr;
+    std::size_t mapped = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct LodRange {
+    float lo = std::numeric_limits<float>::infinity();
+    float hi = -std::numeric_limits<float>::infinity();
+
+    void add(float v) {
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+    }
+    void add(const LodRange& r) {
+        lo = std::min(lo, r.lo);
+        hi = std::max(hi, r.hi);
+    }
+};
+
+// One vertex of a decimated series: x runs from 0 (left edge of the
+// window) to 1 (right edge), v is the sample value
+struct LodPoint {
+    float x, v;
+};
+
+// Min/max pyramid (a mipmap of extremes) over a stream of samples with
+// Channels values each. Level k holds a LodRange per channel for every
+// aligned run of 2^(BASE_SHIFT + k) samples. push() folds a sample into the
+// open run of the finest level and each run that completes into the next
+// level's, so building costs O(1) amortized per sample and never
+// allocates: every level is a ring sized for the newest `capacity`
+// samples, allocated up front.
+//
+// range() covers [first, end) with the coarsest complete runs that fit
+// and reads raw samples only for the ragged ends, fewer than 2^BASE_SHIFT
+// on each side. A window therefore costs O(log length), whatever came
+// before it, and decimate() draws any zoom level from at most two points
+// per pixel column.
+//
+// Raw sample access is the caller's: `raw(index, channel)` returns the
+// value of absolute sample `index` (0 = the first sample pushed since
+// clear()). Queries must stay within the newest `capacity` samples.
+template <std::size_t Channels>
+class MinMaxPyramid {
+public:
+    static constexpr unsigned BASE_SHIFT = 2;  // the finest level's runs are 4 samples
+    static constexpr uint64_t BASE_RUN = uint64_t{1} << BASE_SHIFT;
+
+    explicit MinMaxPyramid(std::size_t capacity) {
+        while ((BASE_RUN << levels) <= capacity) ++levels;
+        masks.resize(levels);
+        data.resize(levels);
+        open.resize(levels * Channels);
+        for (unsigned k = 0; k < levels; ++k) {
+            // A power of two, so a run finds its slot with a mask
+            std::size_t n = 1;
+            while (n < (capacity >> (BASE_SHIFT + k)) + 2) n <<= 1;
+            masks[k] = n - 1;
+            data[k].resize(n * Channels);
+        }
+    }
+
+    uint64_t total() const { return pushed; }
+    unsigned level_count() const { return levels; }
+
+    void clear() {
+        pushed = 0;
+        std::fill(open.begin(), open.end(), LodRange{});
+    }
+
+    void push(const double (&values)[Channels]) {
+        if (levels == 0) {
+            ++pushed;
+            return;
+        }
+        for (std::size_t c = 0; c < Channels; ++c) open[c].add(static_cast<float>(values[c]));
+        ++pushed;
+        for (unsigned k = 0; k < levels && pushed % (BASE_RUN << k) == 0; ++k) {
+            const uint64_t run = (pushed >> (BASE_SHIFT + k)) - 1;
+            LodRange* done = &open[k * Channels];
+            LodRange* slot = &data[k][(static_cast<std::size_t>(run) & masks[k]) * Channels];
+            for (std::size_t c = 0; c < Channels; ++c) {
+                slot[c] = done[c];
+                if (k + 1 < levels) open[(k + 1) * Channels + c].add(done[c]);
+                done[c] = LodRange{};
+            }
+        }
+    }
+
+    // Min and max of `channel` over samples [first, end)
+    template <class Raw>
+    LodRange range(std::size_t channel, uint64_t first, uint64_t end, const Raw& raw) const {
+        LodRange r;
+        const uint64_t head_end = levels ? std::min(end, (first + BASE_RUN - 1) & ~(BASE_RUN - 1)) : end;
+        for (uint64_t s = first; s < head_end; ++s) r.add(static_cast<float>(raw(s, channel)));
+        if (head_end == end) return r;
+
+        const uint64_t body_end = end & ~(BASE_RUN - 1);
+        uint64_t pos = head_end;
+        unsigned k = 0;
+        while (pos < body_end) {
+            // The coarsest run that starts here and still fits: runs grow
+            // towards the middle of the window and shrink again after it
+            while (k + 1 < levels && (pos & ((BASE_RUN << (k + 1)) - 1)) == 0 && pos + (BASE_RUN << (k + 1)) <= body_end) ++k;
+            while (pos + (BASE_RUN << k) > body_end) --k;
+            const uint64_t run = pos >> (BASE_SHIFT + k);
+            r.add(data[k][(static_cast<std::size_t>(run) & masks[k]) * Channels + channel]);
+            pos += BASE_RUN << k;
+        }
+        for (uint64_t s = body_end; s < end; ++s) r.add(static_cast<float>(raw(s, channel)));
+        return r;
+    }
+
+    // Polyline of `channel` across `columns` pixel columns for the window of
+    // `span` samples ending at `end`, of which only [first, end) exist.
+    // Zoomed in to two samples a column or fewer, every sample is a point;
+    // further out, each column gets its min and max, ordered to continue
+    // from the previous column. `out` needs room for 2 * columns + 2
+    // points; returns how many were written.
+    template <class Raw>
+    std::size_t decimate(std::size_t channel, uint64_t first, uint64_t end, double span, std::size_t columns,
+                         const Raw& raw, LodPoint* out) const {
+        if (end <= first || columns == 0 || !(span > 0.0)) return 0;
+        const double start = static_cast<double>(end) - span;
+        const double per_column = span / static_cast<double>(columns);
+        std::size_t n = 0;
+        if (per_column <= 2.0) {
+            uint64_t s = start > static_cast<double>(first) ? static_cast<uint64_t>(std::ceil(start)) : first;
+            for (; s < end; ++s) {
+                out[n++] = {static_cast<float>((static_cast<double>(s + 1) - start) / span),
+                            static_cast<float>(raw(s, channel))};
+            }
+            return n;
+        }
+        for (std::size_t i = 0; i < columns; ++i) {
+            const double a = start + per_column * static_cast<double>(i);
+            const double b = a + per_column;
+            if (b <= static_cast<double>(first)) continue;
+            const uint64_t lo = std::max(first, static_cast<uint64_t>(std::ceil(std::max(a, 0.0))));
+            const uint64_t hi = i + 1 == columns ? end : std::min(end, static_cast<uint64_t>(std::ceil(b)));
+            if (lo >= hi) continue;
+            const LodRange r = range(channel, lo, hi, raw);
+            const float x = static_cast<float>((static_cast<double>(i) + 0.5) / static_cast<double>(columns));
+            if (r.lo == r.hi) {
+                out[n++] = {x, r.lo};
+            } else if (n > 0 && std::fabs(out[n - 1].v - r.hi) < std::fabs(out[n - 1].v - r.lo)) {
+                out[n++] = {x, r.hi};
+                out[n++] = {x, r.lo};
+            } else {
+                out[n++] = {x, r.lo};
+                out[n++] = {x, r.hi};
+            }
+        }
+        return n;
+    }
+
+private:
+    unsigned levels = 0;
+    uint64_t pushed = 0;
+    std::vector<std::size_t> masks;            // runs each level's ring holds, less one
+    std::vector<std::vector<LodRange>> data;   // per level: slot-major, Channels per slot
+    std::vector<LodRange> open;                // per level: the run still filling
+};
@@ -0,0 +1,111 @@
+#include "monte_carlo.h"
+#include "ball.h"
+#include "philox.h"
+#include "pid_controller.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Ball::update with the sample's parameters: a = F / m - g, the same
+// arithmetic as the nominal ball when m == 1 and g == GRAVITY
+struct VariedBall {
+    double y = Ball{}.y;
+    double velocity = Ball{}.velocity;
+    PlantSample p;
+
+    void update(double force, double dt) {
+        double acceleration = force / p.mass - p.gravity;
+        velocity += acceleration * dt;
+        y += velocity * dt;
+        if (y < 0.0) {
+            y = 0.0;
+            velocity *= p.bounce;
+        } else if (y > WINDOW_HEIGHT - BALL_SIZE) {
+            y = WINDOW_HEIGHT - BALL_SIZE;
+            velocity *= p.bounce;
+        }
+    }
+};
+
+// Samples per pool chunk; each one is a whole closed-loop run
+constexpr std::size_t SAMPLE_GRAIN = 16;
+// Sample i's timing draws come from stream TIMING_STREAM + i, apart from its plant draws
+constexpr uint64_t TIMING_STREAM = uint64_t{1} << 63;
+
+} // namespace
+
+LoopMetrics run_monte_carlo_sample(const MonteCarloConfig& config, std::size_t index, PlantSample* drawn) {
+    const PlantVariation& var = config.variation;
+    PhiloxStream rng(config.seed, index);
+
+    // Fixed draw order: gravity, mass, bounce, then one noise value per step
+    VariedBall ball;
+    ball.p.gravity = GRAVITY * (1.0 + var.gravity_sigma * rng.normal());
+    ball.p.mass = std::max(1.0 + var.mass_sigma * rng.normal(), 0.05);
+    ball.p.bounce = rng.uniform(var.bounce_min, var.bounce_max);
+    if (drawn) *drawn = ball.p;
+
+    constexpr double PV_OFFSET = BALL_SIZE / 2;
+    PID_Controller pid(config.kp, config.ki, config.kd);
+    ComputeTimingModel timing_model = config.timing;
+    timing_model.seed = config.seed;
+    ComputeTiming timing(timing_model, TIMING_STREAM + index);
+    MetricsAccumulator metrics(ball.y + PV_OFFSET, config.setpoint);
+    for (uint64_t s = 0; s < config.steps; ++s) {
+        double pv = ball.y + PV_OFFSET;
+        if (var.noise_sigma > 0.0) pv += var.noise_sigma * rng.normal();
+        double force = timing.ideal() ? pid.calculate(config.setpoint, pv, config.dt)
+                                      : timing.step([&] { return pid.calculate(config.setpoint, pv, config.dt); });
+        ball.update(force, config.dt);
+        metrics.update(ball.y + PV_OFFSET, config.setpoint, force, config.dt);
+    }
+    return metrics.metrics();
+}
+
+MonteCarloResult run_monte_carlo(ThreadPool& pool, const MonteCarloConfig& config) {
+    MonteCarloResult result;
+    result.config = config;
+    result.parameters.resize(config.samples);
+    result.metrics.resize(config.samples);
+    pool.parallel_for(config.samples, SAMPLE_GRAIN, [&](std::size_t begin, std::size_t end, unsigned) {
+        for (std::size_t i = begin; i < end; ++i) {
+            result.metrics[i] = run_monte_carlo_sample(config, i, &result.parameters[i]);
+        }
+    });
+    return result;
+}
+
+MetricSummary MonteCarloResult::summary(double LoopMetrics::*field) const {
+    std::vector<double> values;
+    values.reserve(metrics.size());
+    for (const LoopMetrics& m : metrics) {
+        if (!std::isnan(m.*field)) values.push_back(m.*field);
+    }
+
+    MetricSummary s;
+    s.defined = values.size();
+    if (values.empty()) return s;
+    std::sort(values.begin(), values.end());
+
+    // Sorted order makes the sums independent of how samples were scheduled
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    s.mean = sum / static_cast<double>(values.size());
+    double sq = 0.0;
+    for (double v : values) sq += (v - s.mean) * (v - s.mean);
+    s.stddev = values.size() > 1 ? std::sqrt(sq / static_cast<double>(values.size() - 1)) : 0.0;
+
+    // Nearest-rank percentiles
+    auto percentile = [&](double p) {
+        std::size_t rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(values.size())));
+        return values[std::min(std::max(rank, std::size_t{1}), values.size()) - 1];
+    };
+    s.p05 = percentile(0.05);
+    s.p50 = percentile(0.50);
+    s.p95 = percentile(0.95);
+    s.worst = values.back();
+    return s;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "compute_timing.h"
+#include "constants.h"
+#include "loop_metrics.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Monte Carlo robustness check of one gain set: every sample runs the ball
+// loop from App's initial state with its own gravity, mass, wall bounce and
+// sensor noise, and the per-sample LoopMetrics are summarised as
+// distributions. Sample i draws everything from PhiloxStream(seed, i), so a
+// sample's result depends only on (config, i), never on the thread count or
+// on which thread ran it. A non-ideal `timing` adds compute delay and
+// missed updates from a stream of its own, so the same samples with ideal
+// timing see the same plants and noise and the two runs compare pairwise.
+struct PlantVariation {
+    double gravity_sigma = 0.05;  // standard deviation relative to GRAVITY
+    double mass_sigma = 0.10;     // relative to the nominal unit mass
+    double bounce_min = -0.5;     // bounce coefficient, uniform in [min, max]
+    double bounce_max = -0.1;
+    double noise_sigma = 0.5;     // Gaussian sensor noise on every pv reading, pixels
+};
+
+// Parameters drawn for one sample
+struct PlantSample {
+    double gravity = GRAVITY;
+    double mass = 1.0;
+    double bounce = BOUNCE_COEFFICIENT;
+};
+
+struct MonteCarloConfig {
+    double kp = 80.0, ki = 0.0, kd = 0.0;
+    double setpoint = WINDOW_HEIGHT / 2.0;
+    uint64_t steps = 600;
+    double dt = FIXED_TIMESTEP;
+    std::size_t samples = 1000;
+    uint64_t seed = 1;
+    PlantVariation variation;
+    ComputeTimingModel timing;  // its seed is ignored; draws follow `seed`
+};
+
+// Distribution of one metric over the samples where it is defined (rise and
+// settling time are NaN for samples that never got there)
+struct MetricSummary {
+    std::size_t defined = 0;
+    double mean = 0.0, stddev = 0.0;
+    double p05 = 0.0, p50 = 0.0, p95 = 0.0;
+    double worst = 0.0;  // largest value; every metric here is lower-is-better
+};
+
+struct MonteCarloResult {
+    MonteCarloConfig config;
+    std::vector<PlantSample> parameters;  // per sample
+    std::vector<LoopMetrics> metrics;     // per sample, metrics of the true (noise-free) position
+
+    MetricSummary summary(double LoopMetrics::*field) const;
+};
+
+// Draws sample `index`'s parameters and runs its loop. With zero variation
+// (sigmas 0, bounce_min == bounce_max == BOUNCE_COEFFICIENT) this is step for
+// step the semi-implicit Euler Simulation.
+LoopMetrics run_monte_carlo_sample(const MonteCarloConfig& config, std::size_t index,
+                                   PlantSample* drawn = nullptr);
+
+// All config.samples samples across the pool; each writes its own slot
+MonteCarloResult run_monte_carlo(ThreadPool& pool, const MonteCarloConfig& config);
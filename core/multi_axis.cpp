@@ -0,0 +1,55 @@
+#include "multi_axis.h"
+
+#include <stdexcept>
+
+MultiAxisPlant::MultiAxisPlant(int axes) : axis_count(axes) {
+    if (axes < 1 || axes > MAX_AXES) throw std::invalid_argument("MultiAxisPlant takes 1 to 4 axes");
+    // Ball's start and walls on y; x from where Ball is drawn; others mid-range
+    const double extent[MAX_AXES] = {WINDOW_WIDTH - BALL_SIZE, WINDOW_HEIGHT - BALL_SIZE,
+                                     WINDOW_HEIGHT - BALL_SIZE, WINDOW_HEIGHT - BALL_SIZE};
+    for (int a = 0; a < MAX_AXES; ++a) {
+        hi[a] = extent[a];
+        pos[a] = a == X ? WINDOW_WIDTH / 2 - BALL_SIZE / 2 : WINDOW_HEIGHT / 2.0;
+        setpoint[a] = pos[a] + BALL_SIZE / 2;
+    }
+    gravity[Y] = GRAVITY;
+    setpoint[Y] = WINDOW_HEIGHT / 2.0;
+    set_gains(80.0, 0.0, 0.0);
+}
+
+void MultiAxisPlant::set_gains(double p, double i, double d) {
+    for (int a = 0; a < MAX_AXES; ++a) set_gains(a, p, i, d);
+}
+
+void MultiAxisPlant::set_gains(int axis, double p, double i, double d) {
+    kp[axis] = p;
+    ki[axis] = i;
+    kd[axis] = d;
+}
+
+void MultiAxisPlant::reset_controllers() {
+    for (int a = 0; a < MAX_AXES; ++a) integral[a] = prev_error[a] = 0.0;
+}
+
+void MultiAxisPlant::step(double dt) {
+    constexpr double PV_OFFSET = BALL_SIZE / 2;
+    // Same operations, in the same order, as PID_Controller::calculate and
+    // Ball::update; ternaries instead of branches so the loop vectorizes
+    for (int a = 0; a < MAX_AXES; ++a) {
+        double error = setpoint[a] - (pos[a] + PV_OFFSET);
+        double i = integral[a] + error * dt;
+        i = i < -INTEGRAL_LIMIT ? -INTEGRAL_LIMIT : (INTEGRAL_LIMIT < i ? INTEGRAL_LIMIT : i);
+        integral[a] = i;
+        double derivative = (error - prev_error[a]) / dt;
+        prev_error[a] = error;
+        double f = kp[a] * error + ki[a] * i + kd[a] * derivative;
+        force[a] = f;
+
+        double v = vel[a] + (f - gravity[a]) * dt;
+        double p = pos[a] + v * dt;
+        bool below = p < lo[a];
+        bool above = p > hi[a];
+        pos[a] = below ? lo[a] : (above ? hi[a] : p);
+        vel[a] = below || above ? v * BOUNCE_COEFFICIENT : v;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "constants.h"
+
+#include <cstddef>
+
+// Point mass moving in up to four axes (x, y, z), each with its own PID
+// controller. State is stored axis-major in fixed, 32-byte aligned arrays
+// of MAX_AXES, so one step is a single branch-free pass the compiler turns
+// into SSE2/AVX vector code. Padding axes are stepped too and ignored.
+// The y axis falls under gravity and matches Simulation bit for bit; the
+// other axes are frictionless and weightless, like a gantry or level flight.
+class MultiAxisPlant {
+public:
+    static constexpr int MAX_AXES = 4;
+    enum Axis : int { X = 0, Y = 1, Z = 2 };
+
+    explicit MultiAxisPlant(int axes = 2);
+
+    int axes() const { return axis_count; }
+
+    void set_gains(double kp, double ki, double kd);  // every axis
+    void set_gains(int axis, double kp, double ki, double kd);
+    void set_setpoint(int axis, double value) { setpoint[axis] = value; }
+    void reset_controllers();
+
+    void step(double dt);
+
+    double position(int axis) const { return pos[axis]; }       // top-left corner, px
+    double pv(int axis) const { return pos[axis] + BALL_SIZE / 2; }  // what the controller sees
+    double velocity(int axis) const { return vel[axis]; }
+    double output(int axis) const { return force[axis]; }
+    double error(int axis) const { return prev_error[axis]; }
+    double integral_value(int axis) const { return integral[axis]; }
+    double target(int axis) const { return setpoint[axis]; }
+    double gain(int axis, int term) const { return term == 0 ? kp[axis] : term == 1 ? ki[axis] : kd[axis]; }
+
+private:
+    int axis_count;
+    alignas(32) double kp[MAX_AXES] = {};
+    alignas(32) double ki[MAX_AXES] = {};
+    alignas(32) double kd[MAX_AXES] = {};
+    alignas(32) double setpoint[MAX_AXES] = {};
+    alignas(32) double integral[MAX_AXES] = {};
+    alignas(32) double prev_error[MAX_AXES] = {};
+    alignas(32) double pos[MAX_AXES] = {};
+    alignas(32) double vel[MAX_AXES] = {};
+    alignas(32) double force[MAX_AXES] = {};
+    alignas(32) double gravity[MAX_AXES] = {};
+    alignas(32) double lo[MAX_AXES] = {};
+    alignas(32) double hi[MAX_AXES] = {};
+};
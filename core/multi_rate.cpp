@@ -0,0 +1,98 @@
+#include "multi_rate.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr double PV_OFFSET = BALL_SIZE / 2;
+
+uint32_t period_of(double plant_hz, double rate_hz, const char* task) {
+    if (!(rate_hz > 0.0) || rate_hz > plant_hz) {
+        throw std::invalid_argument(std::string(task) + " rate must be positive and at most the plant rate");
+    }
+    double ratio = plant_hz / rate_hz;
+    double whole = std::round(ratio);
+    if (std::fabs(ratio - whole) > 1e-9 * whole || whole > 1e6) {
+        throw std::invalid_argument(std::string(task) + " rate must divide the plant rate");
+    }
+    return static_cast<uint32_t>(whole);
+}
+
+} // namespace
+
+MultiRateConfig parse_multi_rate(const char* text) {
+    char* end = const_cast<char*>(text);
+    double hz[3];
+    for (int i = 0; i < 3; ++i) {
+        const char* begin = end;
+        hz[i] = std::strtod(begin, &end);
+        if (end == begin || *end != (i < 2 ? ':' : '\0')) {
+            throw std::invalid_argument(std::string("expected PLANT:CONTROLLER:SENSOR rates in Hz: ") + text);
+        }
+        if (i < 2) ++end;
+    }
+    return {hz[0], hz[1], hz[2]};
+}
+
+RateSchedule RateSchedule::compile(const MultiRateConfig& config) {
+    if (!(config.plant_hz > 0.0)) throw std::invalid_argument("plant rate must be positive");
+    RateSchedule s;
+    s.sensor_period = period_of(config.plant_hz, config.sensor_hz, "sensor");
+    s.controller_period = period_of(config.plant_hz, config.controller_hz, "controller");
+    uint64_t lcm = std::lcm<uint64_t>(s.sensor_period, s.controller_period);
+    if (lcm > 1u << 24) throw std::invalid_argument("task periods have no common multiple under 2^24 plant ticks");
+    s.hyperperiod = static_cast<uint32_t>(lcm);
+
+    for (uint32_t t = 0; t < s.hyperperiod; ++t) {
+        unsigned tasks = (t % s.sensor_period == 0 ? TASK_SAMPLE : 0u) |
+                         (t % s.controller_period == 0 ? TASK_CONTROL : 0u);
+        if (tasks) s.slots.push_back({tasks, 0});
+        ++s.slots.back().plant_ticks;  // tick 0 runs both tasks, so slots is never empty here
+    }
+    return s;
+}
+
+MultiRateLoop::MultiRateLoop(const MultiRateConfig& config, const PID_Controller& pid, double setpoint,
+                             const SensorModel& model)
+        : pid(pid), setpoint(setpoint), measurement(ball.y + PV_OFFSET), rates(config),
+          table(RateSchedule::compile(config)), sensor(model, 0, ball.y + PV_OFFSET),
+          plant_step(1.0 / config.plant_hz), controller_step(1.0 / config.controller_hz) {}
+
+void MultiRateLoop::advance(uint64_t ticks) {
+    while (ticks > 0) {
+        if (pending == 0) {
+            const RateSlot& s = table.slots[slot];
+            if (s.tasks & TASK_SAMPLE) {
+                double pv = ball.y + PV_OFFSET;
+                measurement = sensor.ideal() ? pv : sensor.measure(pv);
+            }
+            if (s.tasks & TASK_CONTROL) output = pid.calculate(setpoint, measurement, controller_step);
+            pending = s.plant_ticks;
+            if (++slot == table.slots.size()) slot = 0;
+        }
+        uint32_t n = ticks < pending ? static_cast<uint32_t>(ticks) : pending;
+        const double force = output, dt = plant_step;
+        for (uint32_t i = 0; i < n; ++i) ball.update(force, dt);
+        pending -= n;
+        ticks -= n;
+        tick += n;
+    }
+}
+
+void run_multi_rate_reference(MultiRateLoop& loop, uint64_t ticks) {
+    const RateSchedule& s = loop.table;
+    for (uint64_t end = loop.tick + ticks; loop.tick < end; ++loop.tick) {
+        if (loop.tick % s.sensor_period == 0) {
+            double pv = loop.ball.y + PV_OFFSET;
+            loop.measurement = loop.sensor.ideal() ? pv : loop.sensor.measure(pv);
+        }
+        if (loop.tick % s.controller_period == 0) {
+            loop.output = loop.pid.calculate(loop.setpoint, loop.measurement, loop.controller_step);
+        }
+        loop.ball.update(loop.output, loop.plant_step);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ball.h"
+#include "pid_controller.h"
+#include "sensor.h"
+
+#include <cstdint>
+#include <vector>
+
+// Rates of a multi-rate loop. The plant is integrated at the base rate;
+// the controller and the sensor each run every N plant ticks, so both must
+// divide plant_hz exactly. The display is not part of the schedule: it
+// draws at its own rate from whatever state the loop has reached.
+struct MultiRateConfig {
+    double plant_hz = 10000.0;
+    double controller_hz = 1000.0;
+    double sensor_hz = 500.0;
+};
+
+// "P:C:S" in Hz, e.g. 10000:1000:500; throws std::invalid_argument
+MultiRateConfig parse_multi_rate(const char* text);
+
+enum RateTask : unsigned {
+    TASK_SAMPLE = 1u << 0,   // sensor reads the plant; the reading holds until the next one
+    TASK_CONTROL = 1u << 1,  // controller updates from the held reading; its force holds
+};
+
+// One entry of the static schedule: tasks due at a tick, in bit order,
+// then the plant ticks until the next tick that has any
+struct RateSlot {
+    unsigned tasks;
+    uint32_t plant_ticks;
+};
+
+// The schedule of one hyperperiod (the least common multiple of the task
+// periods), resolved once at setup. Running it is a walk over the slots
+// with a tight plant loop in each, with no rate checks per tick.
+struct RateSchedule {
+    uint32_t sensor_period = 1;      // plant ticks
+    uint32_t controller_period = 1;
+    uint32_t hyperperiod = 1;
+    std::vector<RateSlot> slots;
+
+    // Throws std::invalid_argument unless both task rates divide the plant rate
+    static RateSchedule compile(const MultiRateConfig& config);
+};
+
+// PID_Controller + Ball stepped on a RateSchedule: the ball integrated
+// with Ball::update at the plant rate under the held controller force,
+// the controller fed the held sensor reading. Deterministic: time is
+// counted in plant ticks, and with all three rates equal the loop is
+// Simulation::step, bit for bit.
+class MultiRateLoop {
+public:
+    MultiRateLoop(const MultiRateConfig& config, const PID_Controller& pid, double setpoint,
+                  const SensorModel& sensor = {});
+
+    // Integrates `ticks` plant ticks, running the tasks the schedule puts
+    // in between; may stop inside a slot and carry on from there
+    void advance(uint64_t ticks);
+
+    const MultiRateConfig& config() const { return rates; }
+    const RateSchedule& schedule() const { return table; }
+    double plant_dt() const { return plant_step; }
+    double controller_dt() const { return controller_step; }
+    uint64_t ticks() const { return tick; }
+    double time() const { return static_cast<double>(tick) * plant_step; }
+
+    Ball ball;
+    PID_Controller pid;
+    double setpoint;
+    double measurement;     // latest sensor reading, as the controller sees it
+    double output = 0.0;    // latest controller force, held on the plant
+
+private:
+    friend void run_multi_rate_reference(MultiRateLoop& loop, uint64_t ticks);
+
+    MultiRateConfig rates;
+    RateSchedule table;
+    Sensor sensor;
+    double plant_step, controller_step;
+    uint64_t tick = 0;
+    std::size_t slot = 0;    // next slot to start
+    uint32_t pending = 0;    // plant ticks left in the slot being run
+};
+
+// The loop MultiRateLoop compiles away, checking every task's period on
+// every plant tick; the reference its schedule must reproduce exactly. Run
+// it on a loop of its own, not one that advance() has stepped.
+void run_multi_rate_reference(MultiRateLoop& loop, uint64_t ticks);
@@ -0,0 +1,147 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// "0-3,8-11\n" as a sorted CPU list; empty for an unreadable file
+std::vector<int> read_cpu_list(const std::string& path) {
+    std::vector<int> cpus;
+    std::FILE* f = std::fopen(path.c_str(), "r");
+    if (!f) return cpus;
+    char line[4096];
+    if (std::fgets(line, sizeof(line), f)) {
+        for (char* p = line; *p && *p != '\n';) {
+            char* end;
+            long lo = std::strtol(p, &end, 10);
+            if (end == p) break;
+            long hi = lo;
+            if (*end == '-') hi = std::strtol(end + 1, &end, 10);
+            for (long c = lo; c <= hi; ++c) cpus.push_back(static_cast<int>(c));
+            p = *end == ',' ? end + 1 : end;
+        }
+    }
+    std::fclose(f);
+    return cpus;
+}
+
+std::string cpu_ranges(const std::vector<int>& cpus) {
+    std::string text;
+    for (std::size_t i = 0; i < cpus.size();) {
+        std::size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (!text.empty()) text += ',';
+        text += std::to_string(cpus[i]);
+        if (j > i) text += '-' + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return text;
+}
+
+} // namespace
+
+NumaTopology NumaTopology::detect() {
+    NumaTopology t;
+    std::vector<int> allowed;
+#ifdef __linux__
+    cpu_set_t mask;
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &mask)) allowed.push_back(c);
+        }
+    }
+    for (int node : read_cpu_list("/sys/devices/system/node/online")) {
+        std::vector<int> cpus;
+        for (int c : read_cpu_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist")) {
+            if (allowed.empty() || std::binary_search(allowed.begin(), allowed.end(), c)) cpus.push_back(c);
+        }
+        if (cpus.empty()) continue;  // memory-only node, or none of its CPUs allowed
+        t.nodes.push_back(std::move(cpus));
+        t.node_ids.push_back(node);
+    }
+#endif
+    if (t.nodes.empty()) {
+        if (allowed.empty()) {
+            for (unsigned c = 0; c < std::max(1u, std::thread::hardware_concurrency()); ++c) {
+                allowed.push_back(static_cast<int>(c));
+            }
+        }
+        t.nodes.push_back(allowed);
+        t.node_ids.push_back(0);
+    }
+    return t;
+}
+
+std::size_t NumaTopology::cpus() const {
+    std::size_t n = 0;
+    for (const std::vector<int>& node : nodes) n += node.size();
+    return n;
+}
+
+std::vector<int> NumaTopology::spread(unsigned participants) const {
+    std::vector<int> order;
+    for (const std::vector<int>& node : nodes) order.insert(order.end(), node.begin(), node.end());
+    std::vector<int> cpus(participants);
+    // Participant i takes the CPU a fraction i / participants of the way
+    // through the node-ordered list, so each node's share is contiguous
+    for (unsigned i = 0; i < participants; ++i) {
+        cpus[i] = order[static_cast<std::size_t>(i) * order.size() / participants];
+    }
+    return cpus;
+}
+
+int NumaTopology::node_of(int cpu) const {
+    for (std::size_t n = 0; n < nodes.size(); ++n) {
+        if (std::binary_search(nodes[n].begin(), nodes[n].end(), cpu)) return static_cast<int>(n);
+    }
+    return -1;
+}
+
+std::string NumaTopology::describe() const {
+    std::string text = std::to_string(nodes.size()) + (nodes.size() == 1 ? " node: " : " nodes: ");
+    for (std::size_t n = 0; n < nodes.size(); ++n) {
+        if (n) text += ", ";
+        text += cpu_ranges(nodes[n]);
+    }
+    return text;
+}
+
+bool pin_thread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+struct SavedAffinity::State {
+#ifdef __linux__
+    cpu_set_t mask;
+    bool saved = false;
+#endif
+};
+
+SavedAffinity::SavedAffinity() : state(std::make_unique<State>()) {
+#ifdef __linux__
+    state->saved = pthread_getaffinity_np(pthread_self(), sizeof(state->mask), &state->mask) == 0;
+#endif
+}
+
+SavedAffinity::~SavedAffinity() {
+#ifdef __linux__
+    if (state->saved) pthread_setaffinity_np(pthread_self(), sizeof(state->mask), &state->mask);
+#endif
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// The CPUs this process may run on, grouped by NUMA node. On Linux it is
+// read from /sys/devices/system/node and the process affinity mask; where
+// that is unavailable (other platforms, containers without sysfs) every CPU
+// is one node. No libnuma: memory is placed by first touch, which needs
+// only the threads to stay where they were put.
+struct NumaTopology {
+    std::vector<std::vector<int>> nodes;  // allowed CPUs of each node that has any, ascending
+    std::vector<int> node_ids;            // the kernel's number for each of `nodes`
+
+    static NumaTopology detect();
+
+    std::size_t cpus() const;
+    // CPU for each of `participants` threads, filling node after node so
+    // that consecutive participants share a node and every node gets a
+    // share in proportion to its CPUs; wraps around when there are more
+    // participants than CPUs
+    std::vector<int> spread(unsigned participants) const;
+    // Node (index into `nodes`) holding `cpu`, or -1
+    int node_of(int cpu) const;
+    // "2 nodes: 0-15, 16-31"
+    std::string describe() const;
+};
+
+// Pins the calling thread to `cpu`; false where refused or unsupported
+bool pin_thread(int cpu);
+
+// The calling thread's CPU affinity, restored on destruction
+class SavedAffinity {
+public:
+    SavedAffinity();
+    ~SavedAffinity();
+
+    SavedAffinity(const SavedAffinity&) = delete;
+    SavedAffinity& operator=(const SavedAffinity&) = delete;
+
+private:
+    struct State;
+    std::unique_ptr<State> state;
+};
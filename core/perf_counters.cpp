@@ -0,0 +1,100 @@
+#include "perf_counters.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace {
+
+int open_counter(uint32_t type, uint64_t config, int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+// The count, scaled to the whole interval if the counter was multiplexed
+uint64_t read_counter(int fd) {
+    uint64_t value[3] = {};  // count, time enabled, time running
+    if (fd < 0 || read(fd, value, sizeof(value)) != sizeof(value)) return 0;
+    if (value[2] == 0) return 0;
+    if (value[2] < value[1]) {
+        return static_cast<uint64_t>(static_cast<double>(value[0]) * value[1] / value[2]);
+    }
+    return value[0];
+}
+
+// Every event but Cycles leads its own group
+bool leader(PerfCounters::Event e) { return e != PerfCounters::Cycles; }
+
+} // namespace
+
+PerfCounters::PerfCounters() {
+    fds[Instructions] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1);
+    if (fds[Instructions] < 0) return;
+    fds[Cycles] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, fds[Instructions]);
+    fds[L1dMisses] = open_counter(PERF_TYPE_HW_CACHE,
+                                  PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                                          PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+                                  -1);
+    fds[LlcMisses] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, -1);
+    fds[BranchMisses] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, -1);
+}
+
+PerfCounters::~PerfCounters() {
+    // Group members before their leader
+    for (int e = EVENTS - 1; e >= 0; --e) {
+        if (fds[e] >= 0) close(fds[e]);
+    }
+}
+
+void PerfCounters::start() {
+    for (int e = 0; e < EVENTS; ++e) {
+        if (fds[e] < 0 || !leader(static_cast<Event>(e))) continue;
+        ioctl(fds[e], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[e], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void PerfCounters::stop() {
+    for (int e = 0; e < EVENTS; ++e) {
+        if (fds[e] >= 0 && leader(static_cast<Event>(e))) ioctl(fds[e], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+    for (int e = 0; e < EVENTS; ++e) counts[e] = read_counter(fds[e]);
+}
+
+#else
+
+PerfCounters::PerfCounters() = default;
+PerfCounters::~PerfCounters() = default;
+void PerfCounters::start() {}
+void PerfCounters::stop() {}
+
+#endif
+
+std::size_t peak_resident_bytes() {
+#if defined(__linux__) || defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) return 0;
+#if defined(__APPLE__)
+    return static_cast<std::size_t>(usage.ru_maxrss);  // bytes
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;  // KiB
+#endif
+#else
+    return 0;
+#endif
+}
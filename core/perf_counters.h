@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Hardware counters for the calling thread (Linux perf_event). On other
+// platforms, or when the kernel refuses access, available() is false and
+// reads return zero. Instructions and cycles are counted as one group; each
+// miss counter opens on its own, so a PMU without one (or a hypervisor that
+// hides it) costs only that column, and has() tells which are missing.
+// When the kernel multiplexes counters, reads are scaled up by the share
+// of the interval each counter actually ran.
+class PerfCounters {
+public:
+    enum Event {
+        Instructions,
+        Cycles,
+        L1dMisses,     // L1 data cache read misses
+        LlcMisses,     // PERF_COUNT_HW_CACHE_MISSES, usually the last-level cache
+        BranchMisses,
+        EVENTS
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return fds[Instructions] >= 0; }
+    bool has(Event e) const { return fds[e] >= 0; }
+
+    void start();
+    void stop();
+
+    // Counts between the latest start() and stop()
+    uint64_t count(Event e) const { return counts[e]; }
+    uint64_t instructions() const { return counts[Instructions]; }
+    uint64_t cycles() const { return counts[Cycles]; }
+    uint64_t l1d_misses() const { return counts[L1dMisses]; }
+    uint64_t llc_misses() const { return counts[LlcMisses]; }
+    uint64_t branch_misses() const { return counts[BranchMisses]; }
+
+private:
+    int fds[EVENTS] = {-1, -1, -1, -1, -1};
+    uint64_t counts[EVENTS] = {};
+};
+
+// Largest resident set size this process has had, in bytes (getrusage);
+// 0 where it cannot be read
+std::size_t peak_resident_bytes();
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3",
+// SC'11): a counter-based generator whose output block is a pure function of
+// a 64-bit key and a 128-bit counter. Any draw of any stream can be produced
+// directly, on any thread and in any order, with no state shared between
+// streams and no sequential seeding pass.
+struct Philox4x32 {
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    static Counter block(Counter c, Key k) {
+        for (int round = 0; round < 10; ++round) {
+            uint64_t p0 = uint64_t{0xD2511F53u} * c[0];
+            uint64_t p1 = uint64_t{0xCD9E8D57u} * c[2];
+            c = {static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0], static_cast<uint32_t>(p1),
+                 static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1], static_cast<uint32_t>(p0)};
+            k[0] += 0x9E3779B9u;
+            k[1] += 0xBB67AE85u;
+        }
+        return c;
+    }
+};
+
+// One independent stream: key = seed, counter = (stream, draw block). Draws
+// come out in a fixed order, so a stream reproduces exactly whichever thread
+// runs it and whatever other streams run beside it.
+class PhiloxStream {
+public:
+    PhiloxStream(uint64_t seed, uint64_t stream)
+        : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+          stream_lo(static_cast<uint32_t>(stream)), stream_hi(static_cast<uint32_t>(stream >> 32)) {}
+
+    uint32_t next_u32() {
+        if (used == 4) {
+            bits = Philox4x32::block({stream_lo, stream_hi, static_cast<uint32_t>(counter),
+                                      static_cast<uint32_t>(counter >> 32)}, key);
+            ++counter;
+            used = 0;
+        }
+        return bits[used++];
+    }
+
+    // [0, 1) with 53 random bits
+    double uniform() {
+        uint64_t hi = next_u32() >> 5, lo = next_u32() >> 6;
+        return (static_cast<double>(hi) * 67108864.0 + static_cast<double>(lo)) * 0x1p-53;
+    }
+
+    double uniform(double min, double max) { return min + (max - min) * uniform(); }
+
+    // Standard normal by Box-Muller; the second value of each pair is kept
+    // for the next call
+    double normal() {
+        if (has_spare) {
+            has_spare = false;
+            return spare;
+        }
+        double r = std::sqrt(-2.0 * std::log(1.0 - uniform()));  // 1 - u is in (0, 1]
+        double theta = 6.283185307179586 * uniform();
+        spare = r * std::sin(theta);
+        has_spare = true;
+        return r * std::cos(theta);
+    }
+
+private:
+    Philox4x32::Key key;
+    uint32_t stream_lo, stream_hi;
+    uint64_t counter = 0;
+    Philox4x32::Counter bits{};
+    int used = 4;
+    double spare = 0.0;
+    bool has_spare = false;
+};
@@ -0,0 +1,124 @@
+#include "physics_thread.h"
+#include "async_logger.h"
+#include "profiler.h"
+#include "shm_telemetry.h"
+#include "telemetry.h"
+#include "udp_stream.h"
+
+namespace {
+
+SimSnapshot initial_snapshot(const Simulation& sim) {
+    SimSnapshot first;
+    first.y = first.prev_y = sim.ball.y;
+    first.velocity = sim.ball.velocity;
+    first.setpoint = sim.setpoint;
+    first.time = sim.time;
+    first.stepped_at = std::chrono::steady_clock::now();
+    return first;
+}
+
+} // namespace
+
+PhysicsThread::PhysicsThread(const Simulation& initial, double dt)
+        : sim(initial), dt(dt), snapshots(initial_snapshot(initial)), period_jitter(dt) {}
+
+PhysicsThread::~PhysicsThread() {
+    stop();
+}
+
+void PhysicsThread::start() {
+    if (running.exchange(true)) return;
+    configured = std::promise<void>();
+    auto ready = configured.get_future();
+    thread = std::thread(&PhysicsThread::thread_main, this);
+    ready.wait();
+}
+
+void PhysicsThread::stop() {
+    running.store(false);
+    if (thread.joinable()) thread.join();
+}
+
+void PhysicsThread::apply(const SimCommand& cmd) {
+    switch (cmd.type) {
+        case SimCommand::SetSetpoint: sim.setpoint = cmd.a; break;
+        case SimCommand::SetGains:
+            sim.pid.Kp = cmd.a;
+            sim.pid.Ki = cmd.b;
+            sim.pid.Kd = cmd.c;
+            break;
+        case SimCommand::ResetPid: sim.pid.reset(); break;
+        case SimCommand::SetPlant:
+            sim.ball.gravity = cmd.a;
+            sim.ball.bounce = cmd.b;
+            sim.pid.integral_limit = cmd.c;
+            break;
+        case SimCommand::SetForm: sim.pid.set_form(static_cast<PidForm>(cmd.a)); break;
+    }
+}
+
+void PhysicsThread::thread_main() {
+    using clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(dt));
+    // Falling more than this far behind (suspend, debugger) resets the schedule
+    const auto max_lag = period * 8;
+
+    if (realtime.any()) problems = apply_realtime(realtime);
+    configured.set_value();
+
+    uint64_t step = 0;
+    auto next = clock::now();
+    auto woke = next;
+    bool resynced = true;  // no interval to measure across a schedule reset
+    while (running.load(std::memory_order_relaxed)) {
+        SimCommand cmd;
+        while (commands.pop(cmd)) apply(cmd);
+
+        double prev_y = sim.ball.y;
+        {
+            PID_ZONE("update_physics");
+            sim.step(dt);
+        }
+        ++step;
+        if (recorder || streamer || shm) {
+            TelemetryRecord r = record_of(sim);
+            if (recorder) recorder->record(r);
+            if (streamer) streamer->record(r);
+            if (shm) shm->record(r);
+        }
+
+        SimSnapshot& out = snapshots.back();
+        out.y = sim.ball.y;
+        out.prev_y = prev_y;
+        out.velocity = sim.ball.velocity;
+        out.setpoint = sim.setpoint;
+        out.error = sim.pid.last_error();
+        out.output = sim.output;
+        out.time = sim.time;
+        out.step = step;
+        out.stepped_at = clock::now();
+        snapshots.publish();
+
+        next += period;
+        auto now = clock::now();
+        if (now - next > max_lag) {
+            const uint64_t behind = static_cast<uint64_t>((now - next) / period);
+            dropped.fetch_add(behind, std::memory_order_relaxed);
+            if (sim.events) {
+                sim.events->log("physics thread %g steps behind, schedule reset (t=%g s)", static_cast<double>(behind),
+                                sim.time);
+            }
+            next = now;
+            resynced = true;
+        }
+        std::this_thread::sleep_until(next);
+
+        auto previous = woke;
+        woke = clock::now();
+        if (!resynced) {
+            period_jitter.add(std::chrono::duration<double>(woke - next).count(),
+                              std::chrono::duration<double>(woke - previous).count());
+        }
+        resynced = false;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "realtime.h"
+#include "simulation.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
+
+class TelemetryRecorder;
+class ShmTelemetryWriter;
+class UdpStreamer;
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <thread>
+
+// Input posted from the UI thread, applied before the next step
+struct SimCommand {
+    enum Type : uint8_t { SetSetpoint, SetGains, ResetPid, SetPlant, SetForm } type;
+    double a = 0.0, b = 0.0, c = 0.0;  // setpoint, Kp/Ki/Kd, gravity/bounce/integral limit, or PidForm
+};
+
+// State published after every step
+struct SimSnapshot {
+    double y = 0.0;
+    double prev_y = 0.0;
+    double velocity = 0.0;
+    double setpoint = 0.0;
+    double error = 0.0;
+    double output = 0.0;
+    double time = 0.0;
+    uint64_t step = 0;
+    std::chrono::steady_clock::time_point stepped_at{};
+};
+
+// Runs Simulation::step on its own thread at a fixed rate, independent of
+// how long the render loop takes to present a frame
+class PhysicsThread {
+public:
+    PhysicsThread(const Simulation& initial, double dt);
+    ~PhysicsThread();
+
+    PhysicsThread(const PhysicsThread&) = delete;
+    PhysicsThread& operator=(const PhysicsThread&) = delete;
+
+    // Optional per-step log; set before start()
+    void set_recorder(TelemetryRecorder* r) { recorder = r; }
+    // Optional live UDP stream; set before start()
+    void set_streamer(UdpStreamer* s) { streamer = s; }
+    // Optional shared-memory ring; set before start()
+    void set_shm(ShmTelemetryWriter* w) { shm = w; }
+    // Pinning/priority applied by the thread itself on start; set before start()
+    void set_realtime(const RealtimeOptions& options) { realtime = options; }
+
+    // Returns once the thread is running and has applied its RealtimeOptions
+    void start();
+    void stop();
+
+    bool post(const SimCommand& cmd) { return commands.push(cmd); }  // UI thread only
+    const SimSnapshot& latest() { return snapshots.read(); }         // UI thread only
+
+    double timestep() const { return dt; }
+    uint64_t dropped_steps() const { return dropped.load(std::memory_order_relaxed); }
+    // Steps of the RealtimeOptions that did not take effect; valid after start()
+    const std::string& realtime_problems() const { return problems; }
+    // Wake-up timing of every step; valid after stop()
+    const PeriodJitter& jitter() const { return period_jitter; }
+
+private:
+    void thread_main();
+    void apply(const SimCommand& cmd);
+
+    Simulation sim;  // owned by the physics thread while running
+    const double dt;
+    SpscQueue<SimCommand, 256> commands;
+    TripleBuffer<SimSnapshot> snapshots;
+    TelemetryRecorder* recorder = nullptr;
+    UdpStreamer* streamer = nullptr;
+    ShmTelemetryWriter* shm = nullptr;
+    RealtimeOptions realtime;
+    std::string problems;
+    std::promise<void> configured;
+    PeriodJitter period_jitter;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> dropped{0};
+    std::thread thread;
+};
@@ -0,0 +1,317 @@
+#pragma once
+
+#include "scalar_traits.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// How calculate() forms its output. Positional computes it whole from the
+// error, its clamped integral and its difference. Velocity (incremental)
+// form computes only the change since the previous step,
+//   du = Kp (e - e1) + Ki e dt + Kd (d - d1),  d = (e - e1) / dt,
+// and adds it to the held output, which is clamped instead of the
+// integral. In exact arithmetic the two agree until a clamp engages. A
+// gain change only scales later changes, so it never steps the output,
+// and a controller run at a lower rate keeps its state as it is.
+enum class PidForm : uint8_t { Positional, Velocity };
+
+inline const char* pid_form_name(PidForm f) {
+    return f == PidForm::Velocity ? "velocity" : "positional";
+}
+
+inline bool parse_pid_form(const char* name, PidForm& out) {
+    if (!std::strcmp(name, "positional")) out = PidForm::Positional;
+    else if (!std::strcmp(name, "velocity")) out = PidForm::Velocity;
+    else return false;
+    return true;
+}
+
+// Terms added to a controller's output beyond P, I and D, as plain values
+// for engines, sweeps and tuners that set them on many loops at once; see
+// BasicPID_Controller::feed_forward and disturbance_observer
+struct Compensation {
+    double feed_forward = 0.0;
+    bool observer = false;
+    double observer_filter = 0.0;  // Tq, s
+
+    bool any() const { return feed_forward != 0.0 || observer; }
+};
+
+template <class T>
+class BasicPID_Controller {
+    using Traits = ScalarTraits<T>;
+
+public:
+    BasicPID_Controller(T kp, T ki, T kd)
+            : Kp(kp), Ki(ki), Kd(kd) {}
+
+    T calculate(T setpoint, T pv, T dt) {
+        T error = setpoint - pv;
+        T out;
+        if (pid_form == PidForm::Velocity) {
+            out = increment(error, pv, dt);
+        } else {
+            integral += error * dt;
+            integral = std::clamp(integral, -integral_limit, integral_limit);
+            derivative = rate(error, pv, dt);
+            prev_error = error;
+            out = Kp * error + Ki * integral + Kd * derivative;
+        }
+        return feed_forward != T(0) || disturbance_observer ? compensate(out, pv, dt) : out;
+    }
+
+    // Controller terms as of the latest calculate(); the integral stays 0
+    // in velocity form, which keeps the output instead
+    T last_error() const { return prev_error; }
+    T integral_value() const { return integral; }
+    T last_derivative() const { return derivative; }
+    // The observer's estimate of the force the plant adds beyond the
+    // feed-forward's, 0 without it
+    T disturbance_estimate() const { return estimate; }
+
+    PidForm form() const { return pid_form; }
+    // Switches form without a bump: the velocity form starts holding the
+    // output the positional one would give for the latest step, and the
+    // positional form gets back the integral that reproduces the held
+    // output (clamped, and 0 without an integral gain)
+    void set_form(PidForm f) {
+        if (f == pid_form) return;
+        if (f == PidForm::Velocity) {
+            held = std::clamp(Kp * prev_error + Ki * integral + Kd * derivative, -output_limit, output_limit);
+            integral = T(0);
+        } else {
+            integral = Ki != T(0) ? std::clamp((held - Kp * prev_error - Kd * derivative) / Ki, -integral_limit,
+                                               integral_limit)
+                                  : T(0);
+            held = T(0);
+        }
+        pid_form = f;
+    }
+
+    // The anti-windup clamp is engaged: the integral (positional) or the
+    // output (velocity) sits at its limit
+    bool saturated() const {
+        if (pid_form == PidForm::Velocity) return held >= output_limit || held <= -output_limit;
+        return integral >= integral_limit || integral <= -integral_limit;
+    }
+
+    void reset() {
+        integral = T(0);
+        prev_error = T(0);
+        derivative = T(0);
+        held = T(0);
+        prev_input = T(0);
+        primed = false;
+        estimate = T(0);
+        observed_pv[0] = observed_pv[1] = T(0);
+        observed = 0;
+        last_output = T(0);
+    }
+
+    // Overwrite the controller state, e.g. after an integrator advanced it
+    // outside calculate(); the integral is clamped as usual
+    void load_state(T new_integral, T new_prev_error) {
+        integral = std::clamp(new_integral, -integral_limit, integral_limit);
+        prev_error = new_prev_error;
+    }
+
+    T Kp = T(80.0);
+    T Ki = T(0);
+    T Kd = T(0);
+    T integral_limit = Traits::integral_limit();  // anti-windup clamp, +/-
+    T output_limit = Traits::output_limit();      // velocity form's anti-windup clamp, +/-
+
+    // The derivative term differentiates the error by default, so a
+    // setpoint step lands whole in one step's derivative (the derivative
+    // kick). On measurement it differentiates -pv instead: the same while
+    // the setpoint holds, blind to its jumps. A filter time constant Tf > 0
+    // low-passes it against sensor noise with the backward-Euler recurrence
+    //   d = Tf / (Tf + dt) * d1 + (x - x1) / (Tf + dt),  x = error or -pv,
+    // whose two coefficients are recomputed only when dt or Tf changes. With
+    // neither option the raw (e - e1) / dt is kept, bit for bit. The first
+    // step after a reset has no x1 and takes dx = 0, so neither form kicks
+    // on its first measurement.
+    bool derivative_on_measurement = false;
+    T derivative_filter = T(0);  // Tf, s
+
+    // Added to the output after the PID terms (and after the velocity
+    // form's clamp). feed_forward is a constant bias, e.g. the plant's
+    // GRAVITY, so holding a setpoint against it takes no integral. The
+    // disturbance observer estimates the constant force the plant adds that
+    // the feed-forward does not already cancel, from the latest three
+    // measurements and the previous output less the feed-forward, r1:
+    //   w = (pv - 2 pv1 + pv2) / dt^2 - r1,
+    // the acceleration the measurements show less the one commanded,
+    // exact for the semi-implicit Euler ball between wall hits. The raw w
+    // is low-passed with time constant Tq by
+    //   w_hat = Tq / (Tq + dt) * w_hat1 + dt / (Tq + dt) * w,
+    // cached like the derivative filter's coefficients, and the output is
+    // (pid - w_hat) + feed_forward. Until a reset has been followed by three
+    // measurements the estimate stays 0. With feed_forward 0 and no
+    // observer the output is the PID terms, bit for bit.
+    T feed_forward = T(0);
+    bool disturbance_observer = false;
+    T observer_filter = T(0);  // Tq, s
+
+    void set_compensation(const Compensation& c) {
+        feed_forward = T(c.feed_forward);
+        disturbance_observer = c.observer;
+        observer_filter = T(c.observer_filter);
+    }
+
+private:
+    // This step's derivative; call before prev_error moves on
+    T rate(T error, T pv, T dt) {
+        const T x = derivative_on_measurement ? -pv : error;
+        const T dx = primed ? x - prev_input : T(0);
+        prev_input = x;
+        primed = true;
+        if (!derivative_on_measurement && derivative_filter == T(0)) return (error - prev_error) / dt;
+        if (dt != filter_dt || derivative_filter != filter_tf) {
+            filter_dt = dt;
+            filter_tf = derivative_filter;
+            filter_gain = T(1) / (derivative_filter + dt);
+            filter_keep = derivative_filter * filter_gain;
+        }
+        return filter_keep * derivative + filter_gain * dx;
+    }
+
+    T increment(T error, T pv, T dt) {
+        T slope = rate(error, pv, dt);
+        T change = Kp * (error - prev_error) + Ki * (error * dt) + Kd * (slope - derivative);
+        held = std::clamp(held + change, -output_limit, output_limit);
+        derivative = slope;
+        prev_error = error;
+        return held;
+    }
+
+    T compensate(T out, T pv, T dt) {
+        if (disturbance_observer) {
+            if (observed == 2) {
+                const T w = (pv - T(2) * observed_pv[0] + observed_pv[1]) / (dt * dt) - last_output;
+                if (dt != observer_dt || observer_filter != observer_tq) {
+                    observer_dt = dt;
+                    observer_tq = observer_filter;
+                    observer_gain = dt / (observer_filter + dt);
+                    observer_keep = observer_filter / (observer_filter + dt);
+                }
+                estimate = observer_keep * estimate + observer_gain * w;
+            } else {
+                ++observed;
+            }
+            observed_pv[1] = observed_pv[0];
+            observed_pv[0] = pv;
+        }
+        out = out - estimate;
+        last_output = out;
+        return out + feed_forward;
+    }
+
+    T integral = T(0);
+    T prev_error = T(0);
+    T derivative = T(0);
+    T held = T(0);  // velocity form's output
+    T prev_input = T(0);  // the derivative's x as of the latest step
+    bool primed = false;  // prev_input holds a step's x
+    T filter_dt = T(0), filter_tf = T(0), filter_keep = T(0), filter_gain = T(0);
+    T estimate = T(0);                  // the observer's w_hat
+    T observed_pv[2] = {T(0), T(0)};    // pv1, pv2
+    unsigned observed = 0;              // measurements since the reset, up to 2
+    T last_output = T(0);               // r1: the previous output less feed_forward
+    T observer_dt = T(0), observer_tq = T(0), observer_keep = T(0), observer_gain = T(0);
+    PidForm pid_form = PidForm::Positional;
+};
+
+using PID_Controller = BasicPID_Controller<double>;
+
+// Controller structure fixed at compile time. Disabled terms generate no code:
+// a pure P loop keeps no state at all, and without D there is no divide by dt.
+enum PidTerms : unsigned {
+    PID_P = 1u << 0,
+    PID_I = 1u << 1,
+    PID_D = 1u << 2,
+};
+
+// Timestep policies for StaticPID_Controller
+struct RuntimeTimestep {};
+struct FixedTimestep {
+    static constexpr double value = FIXED_TIMESTEP;
+};
+
+// StaticPID_Controller's state: the integral with an I term, the previous
+// error with a D term, and an empty base (no bytes) for a pure P loop
+template <class T, bool I, bool D>
+struct StaticPidState {
+    T integral = T(0);
+    T prev_error = T(0);
+};
+template <class T>
+struct StaticPidState<T, true, false> {
+    T integral = T(0);
+};
+template <class T>
+struct StaticPidState<T, false, true> {
+    T prev_error = T(0);
+};
+template <class T>
+struct StaticPidState<T, false, false> {};
+
+// Same arithmetic, in the same order, as BasicPID_Controller with the
+// missing gains set to zero, so results match it bit for bit.
+template <unsigned Terms, class T = double, class Step = RuntimeTimestep>
+class StaticPID_Controller : private StaticPidState<T, (Terms & PID_I) != 0, (Terms & PID_D) != 0> {
+    using Traits = ScalarTraits<T>;
+    static constexpr bool has_i = (Terms & PID_I) != 0;
+    static constexpr bool has_d = (Terms & PID_D) != 0;
+    static constexpr bool fixed_step = !std::is_same_v<Step, RuntimeTimestep>;
+
+public:
+    static_assert((Terms & PID_P) != 0, "StaticPID_Controller needs a proportional term");
+
+    explicit StaticPID_Controller(T kp, T ki = T(0), T kd = T(0))
+            : Kp(kp), Ki(ki), Kd(kd) {}
+
+    T calculate(T setpoint, T pv, T dt) {
+        static_assert(!fixed_step, "timestep is fixed at compile time; call calculate(setpoint, pv)");
+        return compute(setpoint, pv, dt);
+    }
+
+    T calculate(T setpoint, T pv) {
+        static_assert(fixed_step, "runtime timestep; call calculate(setpoint, pv, dt)");
+        return compute(setpoint, pv, T(Step::value));
+    }
+
+    void reset() {
+        if constexpr (has_i) this->integral = T(0);
+        if constexpr (has_d) this->prev_error = T(0);
+    }
+
+    T Kp;
+    T Ki;  // ignored unless Terms has PID_I
+    T Kd;  // ignored unless Terms has PID_D
+
+private:
+    T compute(T setpoint, T pv, T dt) {
+        T error = setpoint - pv;
+        T out = Kp * error;
+        if constexpr (has_i) {
+            this->integral += error * dt;
+            this->integral = std::clamp(this->integral, -Traits::integral_limit(), Traits::integral_limit());
+            out = out + Ki * this->integral;
+        }
+        if constexpr (has_d) {
+            T derivative = (error - this->prev_error) / dt;
+            this->prev_error = error;
+            out = out + Kd * derivative;
+        }
+        return out;
+    }
+};
+
+static_assert(sizeof(StaticPID_Controller<PID_P>) == 3 * sizeof(double), "a pure P loop keeps no state");
+
+using P_Controller = StaticPID_Controller<PID_P, double, FixedTimestep>;
+using PI_Controller = StaticPID_Controller<PID_P | PID_I, double, FixedTimestep>;
+using PD_Controller = StaticPID_Controller<PID_P | PID_D, double, FixedTimestep>;
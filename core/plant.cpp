@@ -0,0 +1,19 @@
+#include "plant.h"
+
+#include <type_traits>
+
+const PlantPreset& plant_preset(const std::string& name) {
+    for (const PlantPreset& p : PLANT_PRESETS) {
+        if (name == p.name) return p;
+    }
+    throw std::invalid_argument("unknown plant " + name);
+}
+
+std::unique_ptr<DynamicPlant> make_dynamic_plant(const std::string& name) {
+    std::unique_ptr<DynamicPlant> plant;
+    visit_plant(name, [&](const auto& model) {
+        using Model = std::decay_t<decltype(model)>;
+        plant = std::make_unique<DynamicPlantAdapter<Model>>(model);
+    });
+    return plant;
+}
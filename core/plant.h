@@ -0,0 +1,239 @@
+#pragma once
+
+#include "ball.h"
+#include "constants.h"
+#include "pid_controller.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// Plant models for the PID loop, picked at compile time. Each model is a
+// small value type deriving from PlantModel<Derived> (CRTP) and providing
+//   double measure() const           - the process variable
+//   void advance(double u, double dt) - one step under input u
+// so PlantLoop<P>::step() inlines the whole controller + plant update with
+// no indirect call. DynamicPlant below wraps the same models behind a
+// virtual interface for code that chooses the plant at run time.
+template <class Derived>
+class PlantModel {
+public:
+    double output() const { return static_cast<const Derived&>(*this).measure(); }
+    void step(double u, double dt) { static_cast<Derived&>(*this).advance(u, dt); }
+
+protected:
+    PlantModel() = default;
+};
+
+// The original ball: force against gravity, bouncing off the arena walls.
+// PlantLoop<BallPlant> is step for step identical to Simulation.
+class BallPlant : public PlantModel<BallPlant> {
+public:
+    Ball ball;
+
+    double measure() const { return ball.y + BALL_SIZE / 2; }
+    void advance(double u, double dt) { ball.update(u, dt); }
+};
+
+// m x'' + c x' + k x = u, semi-implicit Euler like Ball::update
+class MassSpringDamper : public PlantModel<MassSpringDamper> {
+public:
+    double mass = 1.0;
+    double damping = 2.0;
+    double stiffness = 20.0;
+    double position = 0.0;
+    double velocity = 0.0;
+
+    double measure() const { return position; }
+    void advance(double u, double dt) {
+        velocity += (u - damping * velocity - stiffness * position) / mass * dt;
+        position += velocity * dt;
+    }
+};
+
+// tau y' + y = K u, e.g. a heater or a velocity-controlled conveyor.
+// Advanced exactly for u held over the step, so any dt is stable.
+class FirstOrderLag : public PlantModel<FirstOrderLag> {
+public:
+    double time_constant = 0.5;  // s
+    double gain = 2.0;
+    double value = 0.0;
+
+    double measure() const { return value; }
+    void advance(double u, double dt) {
+        double decay = std::exp(-dt / time_constant);
+        value = gain * u + (value - gain * u) * decay;
+    }
+};
+
+// Rigid pendulum balanced upright on a torque-driven pivot. theta is
+// measured from vertical (0 = upright) and the loop has to hold it there:
+//   m l^2 theta'' = m g l sin(theta) - b theta' + u
+class InvertedPendulum : public PlantModel<InvertedPendulum> {
+public:
+    double mass = 1.0;      // kg
+    double length = 1.0;    // m
+    double friction = 0.1;  // N m s
+    double g = 9.81;
+    double theta = 0.1;     // rad
+    double omega = 0.0;
+
+    double measure() const { return theta; }
+    void advance(double u, double dt) {
+        double inertia = mass * length * length;
+        omega += (mass * g * length * std::sin(theta) - friction * omega + u) / inertia * dt;
+        theta += omega * dt;
+    }
+};
+
+// Armature-controlled DC motor driven by a voltage, measured by its speed:
+//   L di/dt = V - R i - Ke w,   J dw/dt = Kt i - b w
+class DcMotor : public PlantModel<DcMotor> {
+public:
+    double inertia = 0.01;     // J, kg m^2
+    double friction = 0.1;     // b, N m s
+    double torque_constant = 0.01;  // Kt = Ke
+    double resistance = 1.0;   // ohm
+    double inductance = 0.5;   // H
+    double current = 0.0;
+    double speed = 0.0;        // rad/s
+    double angle = 0.0;
+
+    double measure() const { return speed; }
+    void advance(double u, double dt) {
+        current += (u - resistance * current - torque_constant * speed) / inductance * dt;
+        speed += (torque_constant * current - friction * speed) / inertia * dt;
+        angle += speed * dt;
+    }
+};
+
+// Linear state-space model with N states and one input/output:
+//   x' = A x + B u,   y = C x + D u
+// Fixed-size arrays, so the products unroll at compile time. Stepped with
+// forward Euler; keep dt well below the fastest time constant of A.
+template <std::size_t N>
+class StateSpace : public PlantModel<StateSpace<N>> {
+public:
+    std::array<std::array<double, N>, N> A{};
+    std::array<double, N> B{};
+    std::array<double, N> C{};
+    double D = 0.0;
+    std::array<double, N> x{};
+
+    double measure() const {
+        double y = D * last_input;
+        for (std::size_t i = 0; i < N; ++i) y += C[i] * x[i];
+        return y;
+    }
+    void advance(double u, double dt) {
+        std::array<double, N> rate;
+        for (std::size_t i = 0; i < N; ++i) {
+            double r = B[i] * u;
+            for (std::size_t j = 0; j < N; ++j) r += A[i][j] * x[j];
+            rate[i] = r;
+        }
+        for (std::size_t i = 0; i < N; ++i) x[i] += rate[i] * dt;
+        last_input = u;
+    }
+
+private:
+    double last_input = 0.0;
+};
+
+// One PID controller closing the loop around a statically chosen plant
+template <class P>
+struct PlantLoop {
+    P plant;
+    PID_Controller pid{80.0, 0.0, 0.0};
+    double setpoint = 0.0;
+    double output = 0.0;  // controller output applied in the latest step
+    double time = 0.0;
+
+    void step(double dt) {
+        output = pid.calculate(setpoint, plant.output(), dt);
+        plant.step(output, dt);
+        time += dt;
+    }
+};
+
+// Default gains and setpoint per model, tuned for a 60 Hz loop; "ball" keeps
+// the app's own defaults. The pendulum holds a slight lean: balanced exactly
+// upright its state decays into subnormals and sin() slows down tenfold.
+struct PlantPreset {
+    const char* name;
+    double kp, ki, kd;
+    double setpoint;
+    const char* unit;
+};
+
+constexpr PlantPreset PLANT_PRESETS[] = {
+        {"ball", 80.0, 0.0, 0.0, WINDOW_HEIGHT / 2.0, "px"},
+        {"spring", 50.0, 20.0, 5.0, 1.0, "m"},
+        {"lag", 2.0, 4.0, 0.0, 1.0, ""},
+        {"pendulum", 40.0, 5.0, 8.0, 0.05, "rad"},
+        {"motor", 100.0, 200.0, 0.0, 10.0, "rad/s"},
+        {"state_space", 50.0, 20.0, 5.0, 1.0, ""},
+};
+
+// Throws std::invalid_argument for an unknown name
+const PlantPreset& plant_preset(const std::string& name);
+
+// Calls f(plant) with a default-constructed model of the named type, so the
+// caller's loop is instantiated, and inlined, once per model. "state_space"
+// is the spring as a 2-state model. Throws std::invalid_argument if unknown.
+template <class F>
+void visit_plant(const std::string& name, F&& f) {
+    if (name == "ball") f(BallPlant{});
+    else if (name == "spring") f(MassSpringDamper{});
+    else if (name == "lag") f(FirstOrderLag{});
+    else if (name == "pendulum") f(InvertedPendulum{});
+    else if (name == "motor") f(DcMotor{});
+    else if (name == "state_space") {
+        StateSpace<2> ss;
+        MassSpringDamper spring;
+        ss.A = {{{0.0, 1.0}, {-spring.stiffness / spring.mass, -spring.damping / spring.mass}}};
+        ss.B = {0.0, 1.0 / spring.mass};
+        ss.C = {1.0, 0.0};
+        f(ss);
+    }
+    else throw std::invalid_argument("unknown plant " + name);
+}
+
+// Run-time polymorphic plant: one virtual call per output() and step()
+class DynamicPlant {
+public:
+    virtual ~DynamicPlant() = default;
+    virtual double output() const = 0;
+    virtual void step(double u, double dt) = 0;
+};
+
+template <class P>
+class DynamicPlantAdapter final : public DynamicPlant {
+public:
+    explicit DynamicPlantAdapter(const P& plant) : plant(plant) {}
+    double output() const override { return plant.output(); }
+    void step(double u, double dt) override { plant.step(u, dt); }
+
+private:
+    P plant;
+};
+
+// Built out of line so callers cannot devirtualize it
+std::unique_ptr<DynamicPlant> make_dynamic_plant(const std::string& name);
+
+struct DynamicPlantLoop {
+    std::unique_ptr<DynamicPlant> plant;
+    PID_Controller pid{80.0, 0.0, 0.0};
+    double setpoint = 0.0;
+    double output = 0.0;
+    double time = 0.0;
+
+    void step(double dt) {
+        output = pid.calculate(setpoint, plant->output(), dt);
+        plant->step(output, dt);
+        time += dt;
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+// Profiler markers that cost nothing unless a backend is compiled in.
+//
+//   PID_ZONE("name")        times the enclosing scope
+//   PID_PLOT("name", value) adds a sample to a named value track
+//   PID_FRAME_MARK()        ends a frame
+//
+// Names must be string literals. Configure with -DPID_PROFILER=tracy
+// (Tracy client, which defines PID_PROFILE_TRACY) or -DPID_PROFILER=itt
+// (Intel ITT / VTune, PID_PROFILE_ITT). With neither, every macro expands
+// to a no-op statement and no profiler header is included.
+
+#if defined(PID_PROFILE_TRACY)
+
+#include <tracy/Tracy.hpp>
+
+#define PID_ZONE(name) ZoneScopedN(name)
+#define PID_PLOT(name, value) TracyPlot(name, static_cast<double>(value))
+#define PID_FRAME_MARK() FrameMark
+
+#elif defined(PID_PROFILE_ITT)
+
+#include <ittnotify.h>
+
+namespace pid_profile {
+
+inline __itt_domain* domain() {
+    static __itt_domain* const d = __itt_domain_create("pid_sim");
+    return d;
+}
+
+// Task from construction to destruction, on the calling thread
+class IttZone {
+public:
+    explicit IttZone(__itt_string_handle* name) { __itt_task_begin(domain(), __itt_null, __itt_null, name); }
+    ~IttZone() { __itt_task_end(domain()); }
+
+    IttZone(const IttZone&) = delete;
+    IttZone& operator=(const IttZone&) = delete;
+};
+
+inline void plot(__itt_counter counter, double value) { __itt_counter_set_value(counter, &value); }
+
+// ITT frames are begin/end pairs: close the running one and open the next
+inline void frame_mark() {
+    static bool open = false;
+    if (open) __itt_frame_end_v3(domain(), nullptr);
+    __itt_frame_begin_v3(domain(), nullptr);
+    open = true;
+}
+
+} // namespace pid_profile
+
+#define PID_PROFILE_CONCAT2(a, b) a##b
+#define PID_PROFILE_CONCAT(a, b) PID_PROFILE_CONCAT2(a, b)
+// Handles are created once per call site, on first use
+#define PID_ZONE(name)                                                                             \
+    static __itt_string_handle* const PID_PROFILE_CONCAT(pid_zone_name_, __LINE__) =               \
+            __itt_string_handle_create(name);                                                      \
+    ::pid_profile::IttZone PID_PROFILE_CONCAT(pid_zone_, __LINE__)(PID_PROFILE_CONCAT(pid_zone_name_, __LINE__))
+#define PID_PLOT(name, value)                                                                      \
+    do {                                                                                           \
+        static const __itt_counter pid_counter =                                                   \
+                __itt_counter_create_typed(name, "pid_sim", __itt_metadata_double);                \
+        ::pid_profile::plot(pid_counter, static_cast<double>(value));                              \
+    } while (0)
+#define PID_FRAME_MARK() ::pid_profile::frame_mark()
+
+#else
+
+#define PID_ZONE(name) static_cast<void>(0)
+#define PID_PLOT(name, value) static_cast<void>(0)
+#define PID_FRAME_MARK() static_cast<void>(0)
+
+#endif
@@ -0,0 +1,98 @@
+#include "realtime.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+#ifdef _MSC_VER
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void touch_stack(std::size_t bytes) {
+    // One write per page is enough to fault it in; volatile keeps it
+    constexpr std::size_t CHUNK = 16 * 1024;
+    // Recurse first so the call is not a tail call reusing this frame
+    unsigned char block[CHUNK];
+    volatile unsigned char* page = block;
+    if (bytes > CHUNK) touch_stack(bytes - CHUNK);
+    for (std::size_t i = 0; i < CHUNK; i += 4096) page[i] = 0;
+}
+
+#ifndef _WIN32
+std::string failure(const char* what, int err) {
+    return std::string(what) + ": " + std::strerror(err) + "\n";
+}
+#endif
+
+} // namespace
+
+std::string apply_realtime(const RealtimeOptions& options) {
+    std::string problems;
+#ifdef _WIN32
+    if (options.cpu >= 0) {
+        if (options.cpu >= static_cast<int>(8 * sizeof(DWORD_PTR)) ||
+            !SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << options.cpu)) {
+            problems += "cannot pin to CPU " + std::to_string(options.cpu) + "\n";
+        }
+    }
+    if (options.priority > 0 && !SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        problems += "cannot raise thread priority (error " + std::to_string(GetLastError()) + ")\n";
+    }
+    if (options.lock_memory) {
+        // Windows has no mlockall; raise the working-set floor so the
+        // loop's pages are not trimmed under memory pressure
+        SIZE_T lo = 0, hi = 0;
+        HANDLE self = GetCurrentProcess();
+        GetProcessWorkingSetSize(self, &lo, &hi);
+        if (!SetProcessWorkingSetSize(self, lo + (64 << 20), hi + (64 << 20))) {
+            problems += "cannot grow the working set (error " + std::to_string(GetLastError()) + ")\n";
+        }
+    }
+#else
+    if (options.cpu >= 0) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(options.cpu, &set);
+        if (int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+            problems += failure(("cannot pin to CPU " + std::to_string(options.cpu)).c_str(), err);
+        }
+#else
+        problems += "CPU pinning is not supported on this platform\n";
+#endif
+    }
+    if (options.priority > 0) {
+        sched_param param{};
+        param.sched_priority = options.priority;
+        if (int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) {
+            problems += failure("cannot switch to SCHED_FIFO", err);
+        }
+    }
+    if (options.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        problems += failure("cannot lock memory", errno);
+    }
+#endif
+    if (options.prefault_stack) touch_stack(options.prefault_stack);
+    return problems;
+}
+
+void PeriodJitter::print(std::FILE* out) const {
+    Percentiles late = lateness.summary(), err = period_error.summary();
+    std::fprintf(out, "period       %.3f ms nominal, %llu wake-ups\n", period * 1e3,
+                 static_cast<unsigned long long>(samples));
+    std::fprintf(out, "period error p50 %.1f  p99 %.1f  max %.1f us\n", err.p50 * 1e6, err.p99 * 1e6, err.max * 1e6);
+    period_error.print(out, "us", 1e6);
+    std::fprintf(out, "wake latency p50 %.1f  p99 %.1f  max %.1f us\n", late.p50 * 1e6, late.p99 * 1e6, late.max * 1e6);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "histogram.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Scheduling setup for a thread that must hit a fixed period: the physics
+// thread, or the HIL loop. Every field defaults to "leave as is".
+struct RealtimeOptions {
+    int cpu = -1;      // pin to this logical CPU
+    int priority = 0;  // SCHED_FIFO priority 1..99; on Windows any value means TIME_CRITICAL
+    bool lock_memory = false;  // mlockall current and future pages (process-wide)
+    // Touch this much stack up front so the loop never page-faults on it
+    std::size_t prefault_stack = 256 * 1024;
+
+    bool any() const { return cpu >= 0 || priority > 0 || lock_memory; }
+};
+
+// Applies `options` to the calling thread. Steps that fail (usually for lack
+// of privileges) are skipped, not fatal: the result lists them, one per
+// line, and is empty when everything took effect.
+std::string apply_realtime(const RealtimeOptions& options);
+
+// Period jitter of a fixed-rate loop, measured at each wake-up. Owned by the
+// loop's thread; read it once the loop has stopped.
+struct PeriodJitter {
+    explicit PeriodJitter(double period) : period(period) {}
+
+    // `late`: wake-up minus scheduled time; `interval`: since the previous wake-up
+    void add(double late, double interval) {
+        lateness.add(late);
+        period_error.add(std::abs(interval - period));
+        ++samples;
+    }
+
+    void print(std::FILE* out) const;
+
+    double period;
+    uint64_t samples = 0;
+    Histogram lateness{10e-6, 500};      // seconds
+    Histogram period_error{10e-6, 500};  // seconds, |actual period - nominal|
+};
@@ -0,0 +1,112 @@
+#include "reference.h"
+#include "determinism.h"
+#include "telemetry.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr char REFERENCE_HEADER[] = "# pid reference dt=";
+
+bool is_telemetry_log(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) throw std::runtime_error("cannot read " + path + ": " + std::strerror(errno));
+    char magic[sizeof(TELEMETRY_MAGIC)] = {};
+    std::size_t n = std::fread(magic, 1, sizeof(magic), f);
+    std::fclose(f);
+    return n == sizeof(magic) && std::memcmp(magic, TELEMETRY_MAGIC, sizeof(magic)) == 0;
+}
+
+ReferenceTrajectory load_telemetry(const std::string& path) {
+    TelemetryReader log(path);
+    ReferenceTrajectory ref;
+    ref.dt = log.timestep();
+    ref.setpoint.reserve(static_cast<std::size_t>(log.size()));
+    for (uint64_t i = 0; i < log.size(); ++i) ref.setpoint.push_back(log[i].setpoint);
+    return ref;
+}
+
+ReferenceTrajectory load_text(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "r");
+    if (!f) throw std::runtime_error("cannot read " + path + ": " + std::strerror(errno));
+    ReferenceTrajectory ref;
+    char line[128];
+    unsigned long number = 0;
+    bool header = false;
+    while (std::fgets(line, sizeof(line), f)) {
+        ++number;
+        if (line[0] == '#') {
+            if (std::strncmp(line, REFERENCE_HEADER, sizeof(REFERENCE_HEADER) - 1) == 0) {
+                ref.dt = std::strtod(line + sizeof(REFERENCE_HEADER) - 1, nullptr);
+                header = true;
+            }
+            continue;
+        }
+        char* end;
+        double v = std::strtod(line, &end);
+        while (*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n') ++end;
+        if (end == line || *end != '\0' || !std::isfinite(v)) {
+            std::fclose(f);
+            throw std::runtime_error(path + ":" + std::to_string(number) + ": not a setpoint");
+        }
+        ref.setpoint.push_back(v);
+    }
+    std::fclose(f);
+    if (!header) throw std::runtime_error(path + ": not a reference (no \"# pid reference\" header)");
+    if (!(ref.dt > 0.0)) throw std::runtime_error(path + ": reference dt must be positive");
+    return ref;
+}
+
+} // namespace
+
+ReferenceTrajectory load_reference(const std::string& path) {
+    ReferenceTrajectory ref = is_telemetry_log(path) ? load_telemetry(path) : load_text(path);
+    if (ref.setpoint.empty()) throw std::runtime_error(path + ": reference holds no steps");
+    return ref;
+}
+
+ReferenceWriter::ReferenceWriter(const std::string& path, double dt)
+        : path(path), file(std::fopen(path.c_str(), "w")) {
+    if (!file) throw std::runtime_error("cannot write " + path + ": " + std::strerror(errno));
+    std::fprintf(file, "%s%.17g\n", REFERENCE_HEADER, dt);
+}
+
+ReferenceWriter::~ReferenceWriter() {
+    if (file) std::fclose(file);
+}
+
+void ReferenceWriter::close() {
+    if (!file) return;
+    bool failed = std::ferror(file) != 0;
+    failed = std::fclose(file) != 0 || failed;
+    file = nullptr;
+    if (failed) throw std::runtime_error("cannot write " + path);
+}
+
+double TrackingError::rms() const {
+    return duration > 0.0 ? std::sqrt(ise / duration) : 0.0;
+}
+
+RunStats run_reference(Simulation& sim, const ReferenceTrajectory& reference, uint64_t steps,
+                       TrackingError* tracking, MetricsAccumulator* metrics, StateHasher* hashes) {
+    const double dt = reference.dt;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < steps; ++i) {
+        sim.setpoint = reference.at(i);
+        sim.step(dt);
+        if (tracking) tracking->update(sim.setpoint - (sim.ball.y + BALL_SIZE / 2), dt);
+        if (metrics) accumulate(*metrics, sim, dt);
+        if (hashes) hashes->sample(sim);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    RunStats stats;
+    stats.steps = steps;
+    stats.seconds = std::chrono::duration<double>(end - start).count();
+    return stats;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "constants.h"
+#include "simulation.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// A setpoint for every physics step, for tracking tests: drawn with the
+// mouse in SDL_game (--record-reference) and replayed by pid_headless
+// --reference. The text form is a "# pid reference dt=<dt>" header and one
+// setpoint per line in round-trip precision; a telemetry log (--record)
+// loads too, through its setpoint column.
+struct ReferenceTrajectory {
+    double dt = FIXED_TIMESTEP;
+    std::vector<double> setpoint;
+
+    uint64_t size() const { return setpoint.size(); }
+    // Setpoint for step `step` (0-based); the last one holds past the end
+    double at(uint64_t step) const {
+        return step < setpoint.size() ? setpoint[step] : setpoint.back();
+    }
+};
+
+// Throws std::runtime_error for an unreadable, malformed or empty file
+ReferenceTrajectory load_reference(const std::string& path);
+
+// Writes a reference one step at a time. stdio buffers the lines, so
+// record() never allocates and only touches the disk every few KiB.
+class ReferenceWriter {
+public:
+    ReferenceWriter(const std::string& path, double dt);
+    ~ReferenceWriter();
+
+    ReferenceWriter(const ReferenceWriter&) = delete;
+    ReferenceWriter& operator=(const ReferenceWriter&) = delete;
+
+    void record(double setpoint) {
+        std::fprintf(file, "%.17g\n", setpoint);
+        ++count;
+    }
+
+    // Flushes and closes the file; throws std::runtime_error on a write error
+    void close();
+
+    uint64_t written() const { return count; }
+
+private:
+    std::string path;
+    std::FILE* file = nullptr;
+    uint64_t count = 0;
+};
+
+// Error between the ball and a moving setpoint over a whole run. Unlike
+// LoopMetrics, which restarts at every setpoint change, these accumulate
+// from the first step to the last.
+struct TrackingError {
+    double iae = 0.0;        // integral of |e| dt
+    double ise = 0.0;        // integral of e^2 dt
+    double max_error = 0.0;  // largest |e| at any step
+    double duration = 0.0;
+
+    void update(double error, double dt) {
+        double a = error < 0 ? -error : error;
+        iae += a * dt;
+        ise += error * error * dt;
+        if (a > max_error) max_error = a;
+        duration += dt;
+    }
+
+    double rms() const;
+};
+
+class StateHasher;
+
+// Steps `sim` `steps` times at reference.dt, moving the setpoint to
+// reference.at(i) before step i. With `tracking`, every step is folded
+// into it; with `metrics`, into the step-response accumulator as well, and
+// with `hashes` into the state digest.
+RunStats run_reference(Simulation& sim, const ReferenceTrajectory& reference, uint64_t steps,
+                       TrackingError* tracking = nullptr, MetricsAccumulator* metrics = nullptr,
+                       StateHasher* hashes = nullptr);
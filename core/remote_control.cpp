@@ -0,0 +1,336 @@
+#include "remote_control.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using socket_t = SOCKET;
+constexpr socket_t NO_SOCKET = INVALID_SOCKET;
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using socket_t = int;
+constexpr socket_t NO_SOCKET = -1;
+#endif
+
+namespace {
+
+[[noreturn]] void fail(const std::string& what) {
+#ifdef _WIN32
+    throw std::runtime_error(what + " (error " + std::to_string(WSAGetLastError()) + ")");
+#else
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+#endif
+}
+
+void close_socket(socket_t s) {
+#ifdef _WIN32
+    closesocket(s);
+#else
+    ::close(s);
+#endif
+}
+
+bool would_block() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+void set_nonblocking(socket_t s) {
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket(s, FIONBIO, &on);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+// Requests and replies are small and answered one by one: no Nagle delay
+void set_nodelay(socket_t s) {
+    int on = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+}
+
+// PORT or HOST:PORT; `default_host` fills in a bare PORT
+sockaddr_in parse_address(const std::string& text, const char* default_host) {
+    std::size_t colon = text.rfind(':');
+    std::string host = colon == std::string::npos ? default_host : text.substr(0, colon);
+    int port = std::atoi(colon == std::string::npos ? text.c_str() : text.c_str() + colon + 1);
+    if (port <= 0 || port > 65535) throw std::invalid_argument("bad TCP port in " + text);
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        throw std::invalid_argument("expected a numeric IPv4 host in " + text);
+    }
+    return addr;
+}
+
+struct Connection {
+    socket_t socket;
+    uint32_t id;
+    std::string in, out;
+};
+
+void queue_reply(Connection& c, RemoteOp op, RemoteStatus status, uint32_t sequence, const double* values,
+                 std::size_t count) {
+    RemoteHeader h{};
+    std::memcpy(h.magic, REMOTE_MAGIC, sizeof(h.magic));
+    h.op = static_cast<uint8_t>(op);
+    h.status = static_cast<uint8_t>(status);
+    h.length = static_cast<uint16_t>(count * sizeof(double));
+    h.sequence = sequence;
+    c.out.append(reinterpret_cast<const char*>(&h), sizeof(h));
+    c.out.append(reinterpret_cast<const char*>(values), count * sizeof(double));
+}
+
+bool finite(const double* v, std::size_t n) {
+    return std::all_of(v, v + n, [](double x) { return std::isfinite(x); });
+}
+
+// Length and range checks the simulation loop should not have to repeat
+bool decode(const RemoteHeader& h, const char* payload, RemoteCommand& cmd) {
+    cmd.op = static_cast<RemoteOp>(h.op);
+    cmd.sequence = h.sequence;
+    switch (cmd.op) {
+        case RemoteOp::SetSetpoint:
+            if (h.length != sizeof(double)) return false;
+            std::memcpy(cmd.values, payload, sizeof(double));
+            return finite(cmd.values, 1);
+        case RemoteOp::SetGains:
+            if (h.length != 3 * sizeof(double)) return false;
+            std::memcpy(cmd.values, payload, 3 * sizeof(double));
+            return finite(cmd.values, 3) && cmd.values[0] >= 0.0 && cmd.values[1] >= 0.0 && cmd.values[2] >= 0.0;
+        case RemoteOp::StartRecording:
+            if (h.length >= sizeof(cmd.path) || std::memchr(payload, '\0', h.length)) return false;
+            std::memcpy(cmd.path, payload, h.length);
+            cmd.path[h.length] = '\0';
+            return true;
+        case RemoteOp::ResetPid:
+        case RemoteOp::StopRecording:
+        case RemoteOp::Query:
+            return h.length == 0;
+    }
+    return false;
+}
+
+} // namespace
+
+const char* remote_status_name(RemoteStatus status) {
+    switch (status) {
+        case RemoteStatus::Ok: return "ok";
+        case RemoteStatus::BadRequest: return "bad request";
+        case RemoteStatus::Unavailable: return "unavailable";
+        case RemoteStatus::Failed: return "failed";
+        case RemoteStatus::Busy: return "busy";
+    }
+    return "unknown";
+}
+
+RemoteControl::RemoteControl(const std::string& bind)
+        : commands(std::make_unique<SpscQueue<RemoteCommand, QUEUE_ITEMS>>()),
+          replies(std::make_unique<SpscQueue<RemoteReply, QUEUE_ITEMS>>()) {
+    sockaddr_in addr = parse_address(bind, "127.0.0.1");
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) fail("WSAStartup");
+#endif
+    socket_t s = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (s == NO_SOCKET) fail("socket");
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+    if (::bind(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(s, 16) != 0) {
+        close_socket(s);
+        fail("cannot listen on " + bind);
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(s, reinterpret_cast<sockaddr*>(&addr), &len);
+    bound_port = ntohs(addr.sin_port);
+    set_nonblocking(s);
+    listen_handle = static_cast<intptr_t>(s);
+    server = std::thread(&RemoteControl::server_main, this);
+}
+
+RemoteControl::~RemoteControl() {
+    close();
+}
+
+void RemoteControl::server_main() {
+    const socket_t listener = static_cast<socket_t>(listen_handle);
+    std::vector<Connection> connections;
+    std::vector<pollfd> fds;
+    uint32_t next_id = 1;
+    char buffer[4096];
+
+    while (!stopping.load(std::memory_order_acquire)) {
+        // Replies from the simulation loop go to their connection, if it is still open
+        RemoteReply r;
+        while (replies->pop(r)) {
+            auto c = std::find_if(connections.begin(), connections.end(),
+                                  [&](const Connection& x) { return x.id == r.client; });
+            if (c != connections.end()) queue_reply(*c, r.op, r.status, r.sequence, r.values, r.count);
+        }
+
+        fds.clear();
+        fds.push_back({listener, POLLIN, 0});
+        for (const Connection& c : connections) {
+            fds.push_back({c.socket, static_cast<short>(POLLIN | (c.out.empty() ? 0 : POLLOUT)), 0});
+        }
+        // Short enough that replies queued meanwhile go out promptly
+#ifdef _WIN32
+        WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), 2);
+#else
+        ::poll(fds.data(), fds.size(), 2);
+#endif
+
+        for (std::size_t i = 0; i < connections.size(); ++i) {
+            Connection& c = connections[i];
+            const short events = fds[i + 1].revents;
+            bool open = !(events & (POLLERR | POLLNVAL));
+            if (open && (events & (POLLIN | POLLHUP))) {
+                int n = static_cast<int>(::recv(c.socket, buffer, sizeof(buffer), 0));
+                if (n > 0) c.in.append(buffer, n);
+                else if (n == 0 || !would_block()) open = false;
+            }
+
+            // Every complete frame; a bad magic or oversized payload means the
+            // stream cannot be resynchronised, so the connection is dropped
+            std::size_t used = 0;
+            while (open && c.in.size() - used >= sizeof(RemoteHeader)) {
+                RemoteHeader h;
+                std::memcpy(&h, c.in.data() + used, sizeof(h));
+                if (std::memcmp(h.magic, REMOTE_MAGIC, sizeof(h.magic)) != 0 || h.length > REMOTE_MAX_PAYLOAD) {
+                    open = false;
+                    break;
+                }
+                if (c.in.size() - used < sizeof(h) + h.length) break;
+                RemoteCommand cmd;
+                cmd.client = c.id;
+                received_count.fetch_add(1, std::memory_order_relaxed);
+                if (!decode(h, c.in.data() + used + sizeof(h), cmd)) {
+                    rejected_count.fetch_add(1, std::memory_order_relaxed);
+                    queue_reply(c, static_cast<RemoteOp>(h.op), RemoteStatus::BadRequest, h.sequence, nullptr, 0);
+                } else if (!commands->push(cmd)) {
+                    rejected_count.fetch_add(1, std::memory_order_relaxed);
+                    queue_reply(c, cmd.op, RemoteStatus::Busy, h.sequence, nullptr, 0);
+                }
+                used += sizeof(h) + h.length;
+            }
+            c.in.erase(0, used);
+
+            if (open && !c.out.empty()) {
+                int n = static_cast<int>(::send(c.socket, c.out.data(), static_cast<int>(c.out.size()), 0));
+                if (n > 0) c.out.erase(0, n);
+                else if (n < 0 && !would_block()) open = false;
+            }
+            if (!open) {
+                close_socket(c.socket);
+                connections[i] = std::move(connections.back());
+                connections.pop_back();
+                fds[i + 1] = fds.back();  // keep the polled events lined up with the moved connection
+                fds.pop_back();
+                --i;
+            }
+        }
+
+        // After the sweep above, so fds and connections stay lined up
+        if (fds[0].revents & POLLIN) {
+            socket_t s = ::accept(listener, nullptr, nullptr);
+            if (s != NO_SOCKET) {
+                set_nonblocking(s);
+                set_nodelay(s);
+                connections.push_back({s, next_id++, {}, {}});
+            }
+        }
+    }
+    for (const Connection& c : connections) close_socket(c.socket);
+}
+
+void RemoteControl::close() {
+    if (closed) return;
+    closed = true;
+    stopping.store(true, std::memory_order_release);
+    if (server.joinable()) server.join();
+    close_socket(static_cast<socket_t>(listen_handle));
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+RemoteClient::RemoteClient(const std::string& address) {
+    sockaddr_in addr = parse_address(address, "127.0.0.1");
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) fail("WSAStartup");
+#endif
+    socket_t s = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (s == NO_SOCKET) fail("socket");
+    if (::connect(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close_socket(s);
+        fail("cannot connect to " + address);
+    }
+    set_nodelay(s);
+    socket_handle = static_cast<intptr_t>(s);
+}
+
+RemoteClient::~RemoteClient() {
+    close_socket(static_cast<socket_t>(socket_handle));
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+RemoteStatus RemoteClient::call(RemoteOp op, const void* payload, std::size_t length, double* values,
+                                std::size_t* count) {
+    if (length > REMOTE_MAX_PAYLOAD) throw std::invalid_argument("control payload too long");
+    const socket_t s = static_cast<socket_t>(socket_handle);
+    RemoteHeader h{};
+    std::memcpy(h.magic, REMOTE_MAGIC, sizeof(h.magic));
+    h.op = static_cast<uint8_t>(op);
+    h.length = static_cast<uint16_t>(length);
+    h.sequence = next_sequence++;
+    std::string frame(reinterpret_cast<const char*>(&h), sizeof(h));
+    frame.append(static_cast<const char*>(payload), length);
+    for (std::size_t sent = 0; sent < frame.size();) {
+        int n = static_cast<int>(::send(s, frame.data() + sent, static_cast<int>(frame.size() - sent), 0));
+        if (n <= 0) fail("control connection lost");
+        sent += n;
+    }
+
+    auto receive = [&](void* out, std::size_t bytes) {
+        for (std::size_t got = 0; got < bytes;) {
+            int n = static_cast<int>(::recv(s, static_cast<char*>(out) + got, static_cast<int>(bytes - got), 0));
+            if (n <= 0) fail("control connection lost");
+            got += n;
+        }
+    };
+    RemoteHeader reply;
+    receive(&reply, sizeof(reply));
+    double payload_values[REMOTE_QUERY_VALUES] = {};
+    if (std::memcmp(reply.magic, REMOTE_MAGIC, sizeof(reply.magic)) != 0 || reply.sequence != h.sequence ||
+        reply.length > sizeof(payload_values) || reply.length % sizeof(double) != 0) {
+        throw std::runtime_error("malformed control reply");
+    }
+    receive(payload_values, reply.length);
+    if (values) std::copy(payload_values, payload_values + reply.length / sizeof(double), values);
+    if (count) *count = reply.length / sizeof(double);
+    return static_cast<RemoteStatus>(reply.status);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Leads every request and every reply on the control connection; a request
+// is followed by `length` payload bytes, a reply by `length` bytes of
+// doubles. All fields are in the sender's byte order (little-endian on every
+// platform we build for).
+struct RemoteHeader {
+    char magic[4];      // "PIDR"
+    uint8_t op;         // RemoteOp
+    uint8_t status;     // RemoteStatus in replies, 0 in requests
+    uint16_t length;    // payload bytes
+    uint32_t sequence;  // chosen by the client, echoed in the reply
+};
+static_assert(sizeof(RemoteHeader) == 12, "control header layout is part of the wire format");
+
+constexpr char REMOTE_MAGIC[4] = {'P', 'I', 'D', 'R'};
+constexpr std::size_t REMOTE_MAX_PAYLOAD = 1024;
+
+// Request payloads: SetSetpoint one double, SetGains Kp, Ki, Kd, StartRecording
+// the log path (empty for the --record path), the rest none. A Query reply
+// carries time, setpoint, position, Kp, Ki, Kd and 1.0 while recording.
+enum class RemoteOp : uint8_t { SetSetpoint = 1, SetGains, ResetPid, StartRecording, StopRecording, Query };
+
+enum class RemoteStatus : uint8_t {
+    Ok = 0,
+    BadRequest,   // unknown op or malformed payload
+    Unavailable,  // not in the current mode (replay, recording under --physics-thread, ...)
+    Failed,       // accepted but it did not work, e.g. the log file could not be created
+    Busy,         // the command queue was full; nothing was done
+};
+
+constexpr std::size_t REMOTE_QUERY_VALUES = 7;
+
+// A request decoded by the server thread, handed to the simulation loop
+struct RemoteCommand {
+    RemoteOp op = RemoteOp::Query;
+    uint32_t client = 0;
+    uint32_t sequence = 0;
+    double values[3] = {};
+    char path[256] = {};  // StartRecording
+};
+
+struct RemoteReply {
+    uint32_t client = 0;
+    uint32_t sequence = 0;
+    RemoteOp op = RemoteOp::Query;
+    RemoteStatus status = RemoteStatus::Ok;
+    uint8_t count = 0;  // values in use
+    double values[REMOTE_QUERY_VALUES] = {};
+};
+
+// TCP control endpoint for driving a running simulator from scripts. A
+// server thread accepts any number of connections, decodes the fixed binary
+// frames and pushes them into a lock-free queue; the loop that owns the
+// simulation drains it with poll() between steps, applies each command the
+// same way a key press or click would, and answers with reply(), which the
+// server thread sends back on the requesting connection. Neither side ever
+// blocks on the other.
+class RemoteControl {
+public:
+    // `bind` is PORT or HOST:PORT with a numeric IPv4 host; PORT alone
+    // listens on 127.0.0.1 only
+    explicit RemoteControl(const std::string& bind);
+    ~RemoteControl();
+
+    RemoteControl(const RemoteControl&) = delete;
+    RemoteControl& operator=(const RemoteControl&) = delete;
+
+    // Simulation thread only
+    bool poll(RemoteCommand& out) { return commands->pop(out); }
+    void reply(const RemoteReply& r) {
+        if (!replies->push(r)) dropped_replies.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void close();
+
+    uint16_t port() const { return bound_port; }
+    uint64_t received() const { return received_count.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return rejected_count.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t QUEUE_ITEMS = 256;
+
+    void server_main();
+
+    std::unique_ptr<SpscQueue<RemoteCommand, QUEUE_ITEMS>> commands;
+    std::unique_ptr<SpscQueue<RemoteReply, QUEUE_ITEMS>> replies;
+    intptr_t listen_handle = -1;
+    uint16_t bound_port = 0;
+
+    std::atomic<uint64_t> received_count{0};
+    std::atomic<uint64_t> rejected_count{0};
+    std::atomic<uint64_t> dropped_replies{0};
+    std::atomic<bool> stopping{false};
+    bool closed = false;
+    std::thread server;
+};
+
+// Blocking client side of the protocol, for tools and test orchestration
+class RemoteClient {
+public:
+    // `address` is HOST:PORT with a numeric IPv4 host
+    explicit RemoteClient(const std::string& address);
+    ~RemoteClient();
+
+    RemoteClient(const RemoteClient&) = delete;
+    RemoteClient& operator=(const RemoteClient&) = delete;
+
+    // Sends one request and waits for its reply; `values` receives up to
+    // REMOTE_QUERY_VALUES doubles of the reply payload
+    RemoteStatus call(RemoteOp op, const void* payload, std::size_t length, double* values = nullptr,
+                      std::size_t* count = nullptr);
+
+private:
+    intptr_t socket_handle = -1;
+    uint32_t next_sequence = 1;
+};
+
+const char* remote_status_name(RemoteStatus status);
@@ -0,0 +1,199 @@
+#include "result_cache.h"
+#include "result_store.h"
+
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <io.h>
+#define fileno _fileno
+#define ftruncate _chsize
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// On-disk layout: this header, then fixed-size records
+struct StoreHeader {
+    char magic[8] = {'P', 'I', 'D', 'C', 'A', 'C', 'H', 'E'};
+    uint32_t version = 1;
+    uint32_t record_size = 0;
+};
+
+struct StoreRecord {
+    RunKey key;
+    LoopMetrics result;
+    uint64_t hash = 0;  // of key, so the index is rebuilt without rehashing
+};
+
+static_assert(std::is_trivially_copyable<StoreRecord>::value, "records are written as raw bytes");
+static_assert(sizeof(RunKey) == 10 * 8, "RunKey must have no padding");
+
+} // namespace
+
+RunKey RunKey::canonical() const {
+    RunKey c = *this;
+    for (double* v : {&c.kp, &c.ki, &c.kd, &c.setpoint, &c.y0, &c.v0, &c.dt}) {
+        if (*v == 0.0) *v = 0.0;
+    }
+    return c;
+}
+
+uint64_t RunKey::hash() const {
+    RunKey c = canonical();
+    unsigned char bytes[sizeof(RunKey)];
+    std::memcpy(bytes, &c, sizeof(bytes));
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char b : bytes) {
+        h ^= b;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+bool RunKey::operator==(const RunKey& o) const {
+    RunKey a = canonical(), b = o.canonical();
+    return std::memcmp(&a, &b, sizeof(RunKey)) == 0;
+}
+
+ResultCache::ResultCache(std::size_t capacity, const std::string& store_path)
+        : capacity(capacity ? capacity : 1) {
+    index.reserve(this->capacity);
+    if (!store_path.empty()) open_store(store_path);
+}
+
+ResultCache::~ResultCache() = default;
+
+void ResultCache::open_store(const std::string& path) {
+    disk.reset(std::fopen(path.c_str(), "r+b"));
+    if (!disk) disk.reset(std::fopen(path.c_str(), "w+b"));
+    if (!disk) throw std::runtime_error("cannot open result cache " + path);
+
+    StoreHeader expected;
+    expected.record_size = sizeof(StoreRecord);
+    StoreHeader header;
+    if (std::fread(&header, sizeof(header), 1, disk.get()) != 1) {
+        // New (or truncated) file: start it over
+        disk.reset(std::fopen(path.c_str(), "w+b"));
+        if (!disk || std::fwrite(&expected, sizeof(expected), 1, disk.get()) != 1) {
+            throw std::runtime_error("cannot write result cache " + path);
+        }
+        std::fflush(disk.get());
+        return;
+    }
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+        header.version != expected.version || header.record_size != expected.record_size) {
+        throw std::runtime_error(path + " is not a result cache of this build");
+    }
+
+    StoreRecord record;
+    long offset = static_cast<long>(sizeof(StoreHeader));
+    while (std::fread(&record, sizeof(record), 1, disk.get()) == 1) {
+        disk_index.emplace(record.hash, offset);
+        offset += static_cast<long>(sizeof(record));
+    }
+    // Drop a torn record left by an interrupted append, so the next append
+    // starts on a record boundary
+    std::fflush(disk.get());
+    if (ftruncate(fileno(disk.get()), offset) != 0) throw std::runtime_error("cannot truncate result cache " + path);
+    std::fseek(disk.get(), offset, SEEK_SET);
+    counters.disk_entries = disk_index.size();
+}
+
+bool ResultCache::read_disk_locked(const RunKey& key, uint64_t hash, LoopMetrics& out) {
+    auto range = disk_index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        StoreRecord record;
+        if (std::fseek(disk.get(), it->second, SEEK_SET) != 0 ||
+            std::fread(&record, sizeof(record), 1, disk.get()) != 1) {
+            continue;
+        }
+        if (record.key == key) {
+            out = record.result;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ResultCache::lookup(const RunKey& key, LoopMetrics& out) {
+    const uint64_t hash = key.hash();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto range = index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->key == key) {
+            lru.splice(lru.begin(), lru, it->second);
+            out = it->second->result;
+            ++counters.hits;
+            return true;
+        }
+    }
+    if ((disk && read_disk_locked(key, hash, out)) || (columns && columns->lookup(key, out))) {
+        insert_locked(key, out);
+        ++counters.disk_hits;
+        return true;
+    }
+    ++counters.misses;
+    return false;
+}
+
+void ResultCache::store(const RunKey& key, const LoopMetrics& result) {
+    const uint64_t hash = key.hash();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto range = index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->key == key) {
+            it->second->result = result;
+            lru.splice(lru.begin(), lru, it->second);
+            return;
+        }
+    }
+    insert_locked(key, result);
+
+    if (columns) columns->append(key, result);
+    if (disk) {
+        LoopMetrics existing;
+        if (read_disk_locked(key, hash, existing)) return;
+        StoreRecord record{key.canonical(), result, hash};
+        std::fseek(disk.get(), 0, SEEK_END);
+        long offset = std::ftell(disk.get());
+        // Flushed by stdio as the buffer fills and on close; a torn tail
+        // record is dropped on the next open
+        if (std::fwrite(&record, sizeof(record), 1, disk.get()) == 1) {
+            disk_index.emplace(hash, offset);
+            counters.disk_entries = disk_index.size();
+        }
+    }
+}
+
+void ResultCache::insert_locked(const RunKey& key, const LoopMetrics& result) {
+    if (lru.size() >= capacity) {
+        const Entry& victim = lru.back();
+        auto range = index.equal_range(victim.key.hash());
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == std::prev(lru.end())) {
+                index.erase(it);
+                break;
+            }
+        }
+        lru.pop_back();
+        ++counters.evictions;
+    }
+    lru.push_front({key.canonical(), result});
+    index.emplace(key.hash(), lru.begin());
+}
+
+void ResultCache::attach(ResultStore* store) {
+    std::lock_guard<std::mutex> lock(mutex);
+    columns = store;
+}
+
+ResultCacheStats ResultCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    ResultCacheStats s = counters;
+    s.entries = lru.size();
+    return s;
+}
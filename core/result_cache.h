@@ -0,0 +1,90 @@
+#pragma once
+
+#include "loop_metrics.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Everything that determines the outcome of one closed-loop run. The
+// simulation is deterministic, so equal keys always give equal results.
+// All fields are 8 bytes: the struct has no padding and hashes as raw bytes.
+struct RunKey {
+    double kp = 0.0, ki = 0.0, kd = 0.0;
+    double setpoint = 0.0;
+    double y0 = 0.0, v0 = 0.0;  // initial ball state; the controller starts reset
+    double dt = 0.0;
+    uint64_t steps = 0;
+    uint64_t integrator = 0;    // Integrator value, PidForm in bits 8 and up
+    uint64_t full_metrics = 0;  // 0: only LoopMetrics::iae is meaningful
+
+    // -0.0 and 0.0 run identically but differ in their bytes
+    RunKey canonical() const;
+    uint64_t hash() const;  // FNV-1a over the canonical bytes
+    bool operator==(const RunKey& o) const;
+};
+
+struct ResultCacheStats {
+    uint64_t hits = 0;       // served from memory
+    uint64_t disk_hits = 0;  // served from the on-disk store
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    std::size_t entries = 0;       // in memory
+    std::size_t disk_entries = 0;  // in the on-disk store
+
+    double hit_rate() const {
+        uint64_t lookups = hits + disk_hits + misses;
+        return lookups ? static_cast<double>(hits + disk_hits) / static_cast<double>(lookups) : 0.0;
+    }
+};
+
+class ResultStore;
+
+// Content-addressed cache of run results: an in-memory LRU of `capacity`
+// entries, optionally backed by an append-only file that persists across
+// processes. Thread-safe; callers look up a whole batch, run only the
+// misses, and store those.
+class ResultCache {
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 65536;  // about 12 MB
+
+    explicit ResultCache(std::size_t capacity = DEFAULT_CAPACITY, const std::string& store_path = "");
+    ~ResultCache();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    bool lookup(const RunKey& key, LoopMetrics& out);
+    void store(const RunKey& key, const LoopMetrics& result);
+
+    // Also look misses up in `store` (counted as disk hits) and append every
+    // stored result to it, under the cache's lock. Not owned; nullptr detaches.
+    void attach(ResultStore* store);
+
+    ResultCacheStats stats() const;
+
+private:
+    struct Entry {
+        RunKey key;
+        LoopMetrics result;
+    };
+    using Lru = std::list<Entry>;
+
+    void insert_locked(const RunKey& key, const LoopMetrics& result);
+    bool read_disk_locked(const RunKey& key, uint64_t hash, LoopMetrics& out);
+    void open_store(const std::string& path);
+
+    const std::size_t capacity;
+    mutable std::mutex mutex;
+    Lru lru;  // most recent first
+    std::unordered_multimap<uint64_t, Lru::iterator> index;
+    std::unordered_multimap<uint64_t, long> disk_index;  // hash -> record offset
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> disk{nullptr, std::fclose};
+    ResultStore* columns = nullptr;
+    ResultCacheStats counters;
+};
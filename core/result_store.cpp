@@ -0,0 +1,331 @@
+#include "result_store.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+struct StoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t fields;
+    uint64_t rows;  // committed, and indexed
+};
+
+constexpr char STORE_MAGIC[8] = {'P', 'I', 'D', 'S', 'T', 'O', 'R', 'E'};
+// Rows a new store's columns have room for; they grow by half again from there
+constexpr std::size_t GROW_ROWS = 1 << 16;
+
+const char* const FIELD_NAMES[STORE_FIELDS] = {
+    "kp", "ki", "kd", "setpoint", "y0", "v0", "dt", "steps", "integrator", "full_metrics",
+    "iae", "ise", "itae", "effort", "overshoot", "rise_time", "settling_time", "elapsed",
+};
+
+void to_fields(const RunKey& k, const LoopMetrics& m, double* out) {
+    const double values[STORE_FIELDS] = {
+        k.kp, k.ki, k.kd, k.setpoint, k.y0, k.v0, k.dt, static_cast<double>(k.steps),
+        static_cast<double>(k.integrator), static_cast<double>(k.full_metrics),
+        m.iae, m.ise, m.itae, m.effort, m.overshoot, m.rise_time, m.settling_time, m.elapsed,
+    };
+    std::copy(values, values + STORE_FIELDS, out);
+}
+
+// Index order: ascending, NaN last
+bool before(double a, double b) {
+    return !std::isnan(a) && (std::isnan(b) || a < b);
+}
+
+// Sorts rows [begin, end) by `less` and merges them into idx[0, begin) from
+// the back, so the merge needs no second buffer. Equal keys stay in row
+// order: the stable sort keeps it among the new rows, and on a tie the
+// merge places the (later) new row last.
+template <class Less>
+void merge_rows(uint32_t* idx, std::size_t begin, std::size_t end, Less less) {
+    std::vector<uint32_t> added(end - begin);
+    for (std::size_t r = begin; r < end; ++r) added[r - begin] = static_cast<uint32_t>(r);
+    std::stable_sort(added.begin(), added.end(), less);
+    std::size_t i = begin, j = added.size(), k = end;
+    while (j > 0) {
+        if (i > 0 && less(added[j - 1], idx[i - 1])) idx[--k] = idx[--i];
+        else idx[--k] = added[--j];
+    }
+}
+
+} // namespace
+
+const char* store_field_name(StoreField field) {
+    return FIELD_NAMES[static_cast<std::size_t>(field)];
+}
+
+bool parse_store_field(const std::string& name, StoreField& out) {
+    for (std::size_t f = 0; f < STORE_FIELDS; ++f) {
+        if (name == FIELD_NAMES[f]) {
+            out = static_cast<StoreField>(f);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool store_field_indexed(StoreField field) {
+    return field <= StoreField::Kd || (field >= StoreField::Iae && field < StoreField::Elapsed);
+}
+
+std::vector<StoreRange> parse_store_where(const std::string& text) {
+    std::vector<StoreRange> ranges;
+    std::size_t start = 0;
+    while (start <= text.size()) {
+        std::size_t comma = text.find(',', start);
+        std::string term = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        start = comma == std::string::npos ? text.size() + 1 : comma + 1;
+
+        std::size_t op = term.find_first_of("<>=");
+        if (op == std::string::npos || op == 0) throw std::invalid_argument("expected FIELD<VALUE in " + term);
+        std::size_t op_end = op + 1;
+        if (term[op] != '=' && op_end < term.size() && term[op_end] == '=') ++op_end;
+        StoreRange r;
+        if (!parse_store_field(term.substr(0, op), r.field)) {
+            throw std::invalid_argument("unknown result field " + term.substr(0, op));
+        }
+        char* end = nullptr;
+        double v = std::strtod(term.c_str() + op_end, &end);
+        if (op_end == term.size() || *end != '\0' || std::isnan(v)) {
+            throw std::invalid_argument("expected a number in " + term);
+        }
+        const double up = std::nextafter(v, std::numeric_limits<double>::infinity());
+        std::string cmp = term.substr(op, op_end - op);
+        if (cmp == "<") r.max = v;
+        else if (cmp == "<=") r.max = up;
+        else if (cmp == ">") r.min = up;
+        else if (cmp == ">=") r.min = v;
+        else {
+            r.min = v;
+            r.max = up;
+        }
+        ranges.push_back(r);
+    }
+    return ranges;
+}
+
+ResultStore::ResultStore(const std::string& path)
+        : path(path), header(path, MappedFile::Append, sizeof(StoreHeader)) {
+    StoreHeader h;
+    std::memcpy(&h, header.data(), sizeof(h));
+    static const char zero[8] = {};
+    if (std::memcmp(h.magic, zero, sizeof(zero)) == 0) {
+        // New store
+        std::memcpy(h.magic, STORE_MAGIC, sizeof(h.magic));
+        h.version = VERSION;
+        h.fields = STORE_FIELDS;
+        h.rows = 0;
+        std::memcpy(header.data(), &h, sizeof(h));
+    } else if (std::memcmp(h.magic, STORE_MAGIC, sizeof(h.magic)) != 0 || h.version != VERSION ||
+               h.fields != STORE_FIELDS) {
+        throw std::runtime_error(path + " is not a result store of this build");
+    }
+    rows = indexed_rows = static_cast<std::size_t>(h.rows);
+
+    const std::size_t min_rows = std::max(rows, GROW_ROWS);
+    for (std::size_t f = 0; f < STORE_FIELDS; ++f) {
+        open_column(data[f], path + "." + FIELD_NAMES[f], sizeof(double), min_rows);
+        if (store_field_indexed(static_cast<StoreField>(f))) indexed_fields.push_back(static_cast<StoreField>(f));
+    }
+    open_column(hashes, path + ".hash", sizeof(uint64_t), min_rows);
+    indexes.resize(indexed_fields.size() + 1);
+    for (std::size_t i = 0; i < indexed_fields.size(); ++i) {
+        open_column(indexes[i], path + "." + FIELD_NAMES[static_cast<std::size_t>(indexed_fields[i])] + ".idx",
+                    sizeof(uint32_t), min_rows);
+    }
+    open_column(indexes.back(), path + ".hash.idx", sizeof(uint32_t), min_rows);
+
+    capacity = hashes.file.size() / hashes.width;
+    for (const Column& c : data) capacity = std::min(capacity, c.file.size() / c.width);
+    for (std::size_t f = 0; f < STORE_FIELDS; ++f) columns[f] = reinterpret_cast<const double*>(data[f].file.data());
+}
+
+ResultStore::~ResultStore() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void ResultStore::open_column(Column& c, const std::string& file, std::size_t width, std::size_t min_rows) {
+    c.file = MappedFile(file, MappedFile::Append, min_rows * width);
+    c.width = width;
+    if (c.file.size() < rows * width) throw std::runtime_error(file + " is shorter than its store");
+}
+
+void ResultStore::reserve(std::size_t new_rows) {
+    if (new_rows <= capacity) return;
+    if (new_rows > MAX_ROWS) throw std::length_error("result store " + path + " is full");
+    capacity = std::min(std::max(new_rows, capacity + capacity / 2), MAX_ROWS);
+    for (Column& c : data) c.file.resize(capacity * c.width);
+    hashes.file.resize(capacity * hashes.width);
+    for (std::size_t f = 0; f < STORE_FIELDS; ++f) columns[f] = reinterpret_cast<const double*>(data[f].file.data());
+}
+
+bool ResultStore::append(const RunKey& key, const LoopMetrics& metrics) {
+    const RunKey k = key.canonical();
+    const uint64_t hash = k.hash();
+    LoopMetrics existing;
+    if (lookup(k, existing)) return false;
+    reserve(rows + 1);
+
+    double values[STORE_FIELDS];
+    to_fields(k, metrics, values);
+    for (std::size_t f = 0; f < STORE_FIELDS; ++f) {
+        std::memcpy(data[f].file.data() + rows * sizeof(double), &values[f], sizeof(double));
+    }
+    std::memcpy(hashes.file.data() + rows * sizeof(uint64_t), &hash, sizeof(hash));
+    pending.emplace(hash, rows);
+    ++rows;
+    return true;
+}
+
+StoreRow ResultStore::row(std::size_t r) const {
+    StoreRow out;
+    RunKey& k = out.key;
+    LoopMetrics& m = out.metrics;
+    double* key_fields[] = {&k.kp, &k.ki, &k.kd, &k.setpoint, &k.y0, &k.v0, &k.dt};
+    for (std::size_t f = 0; f < 7; ++f) *key_fields[f] = columns[f][r];
+    k.steps = static_cast<uint64_t>(value(r, StoreField::Steps));
+    k.integrator = static_cast<uint64_t>(value(r, StoreField::Integrator));
+    k.full_metrics = static_cast<uint64_t>(value(r, StoreField::FullMetrics));
+    double* metric_fields[] = {&m.iae, &m.ise, &m.itae, &m.effort, &m.overshoot, &m.rise_time, &m.settling_time,
+                               &m.elapsed};
+    for (std::size_t f = 0; f < 8; ++f) *metric_fields[f] = value(r, static_cast<StoreField>(f + 10));
+    return out;
+}
+
+const uint32_t* ResultStore::index(std::size_t slot) const {
+    return reinterpret_cast<const uint32_t*>(indexes[slot].file.data());
+}
+
+bool ResultStore::find_committed(const RunKey& key, uint64_t hash, std::size_t& at) const {
+    const uint64_t* h = reinterpret_cast<const uint64_t*>(hashes.file.data());
+    const uint32_t* idx = index(indexes.size() - 1);
+    const uint32_t* it = std::partition_point(idx, idx + indexed_rows, [&](uint32_t r) { return h[r] < hash; });
+    for (; it != idx + indexed_rows && h[*it] == hash; ++it) {
+        if (row(*it).key == key) {
+            at = *it;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ResultStore::lookup(const RunKey& key, LoopMetrics& out) const {
+    const uint64_t hash = key.hash();
+    std::size_t at;
+    bool found = find_committed(key, hash, at);
+    if (!found) {
+        auto range = pending.equal_range(hash);
+        for (auto it = range.first; it != range.second && !found; ++it) {
+            if (row(it->second).key == key) {
+                at = it->second;
+                found = true;
+            }
+        }
+    }
+    if (found) out = row(at).metrics;
+    return found;
+}
+
+void ResultStore::index_span(StoreField field, double min, double max, std::size_t& lo, std::size_t& hi) const {
+    auto slot = static_cast<std::size_t>(std::find(indexed_fields.begin(), indexed_fields.end(), field) -
+                                         indexed_fields.begin());
+    const uint32_t* idx = index(slot);
+    const double* col = columns[static_cast<std::size_t>(field)];
+    // NaN sorts last and compares false, so both predicates hold on a prefix
+    lo = static_cast<std::size_t>(
+            std::partition_point(idx, idx + indexed_rows, [&](uint32_t r) { return col[r] < min; }) - idx);
+    hi = static_cast<std::size_t>(
+            std::partition_point(idx, idx + indexed_rows, [&](uint32_t r) { return col[r] < max; }) - idx);
+    hi = std::max(lo, hi);
+}
+
+std::vector<std::size_t> ResultStore::select(const std::vector<StoreRange>& where, std::size_t limit) const {
+    auto matches = [&](std::size_t r) {
+        for (const StoreRange& range : where) {
+            double v = value(r, range.field);
+            if (!(v >= range.min && v < range.max)) return false;
+        }
+        return true;
+    };
+
+    // Narrowest index span among the indexed ranges
+    const StoreRange* driver = nullptr;
+    std::size_t lo = 0, hi = indexed_rows;
+    for (const StoreRange& range : where) {
+        if (!store_field_indexed(range.field)) continue;
+        std::size_t a, b;
+        index_span(range.field, range.min, range.max, a, b);
+        if (!driver || b - a < hi - lo) {
+            driver = &range;
+            lo = a;
+            hi = b;
+        }
+    }
+
+    std::vector<std::size_t> out;
+    if (driver) {
+        auto slot = static_cast<std::size_t>(std::find(indexed_fields.begin(), indexed_fields.end(), driver->field) -
+                                             indexed_fields.begin());
+        const uint32_t* idx = index(slot);
+        for (std::size_t i = lo; i < hi && out.size() < limit; ++i) {
+            if (matches(idx[i])) out.push_back(idx[i]);
+        }
+    } else {
+        for (std::size_t r = 0; r < indexed_rows && out.size() < limit; ++r) {
+            if (matches(r)) out.push_back(r);
+        }
+    }
+    for (std::size_t r = indexed_rows; r < rows && out.size() < limit; ++r) {
+        if (matches(r)) out.push_back(r);
+    }
+    return out;
+}
+
+void ResultStore::merge_index(std::size_t slot, std::size_t begin, std::size_t end) {
+    Column& c = indexes[slot];
+    if (c.file.size() < end * c.width) c.file.resize(capacity * c.width);
+    uint32_t* idx = reinterpret_cast<uint32_t*>(c.file.data());
+    if (slot == indexes.size() - 1) {
+        const uint64_t* h = reinterpret_cast<const uint64_t*>(hashes.file.data());
+        merge_rows(idx, begin, end, [h](uint32_t a, uint32_t b) { return h[a] < h[b]; });
+    } else {
+        const double* col = columns[static_cast<std::size_t>(indexed_fields[slot])];
+        merge_rows(idx, begin, end, [col](uint32_t a, uint32_t b) { return before(col[a], col[b]); });
+    }
+}
+
+void ResultStore::commit() {
+    if (rows == indexed_rows) return;
+    for (std::size_t slot = 0; slot < indexes.size(); ++slot) merge_index(slot, indexed_rows, rows);
+    for (Column& c : data) c.file.flush_async(indexed_rows * c.width, (rows - indexed_rows) * c.width);
+    hashes.file.flush_async(indexed_rows * hashes.width, (rows - indexed_rows) * hashes.width);
+    for (Column& c : indexes) c.file.flush_async(0, rows * c.width);
+    indexed_rows = rows;
+    pending.clear();
+    write_header();
+}
+
+void ResultStore::write_header() {
+    uint64_t committed = rows;
+    std::memcpy(header.data() + offsetof(StoreHeader, rows), &committed, sizeof(committed));
+    header.flush_async(0, sizeof(StoreHeader));
+}
+
+void ResultStore::close() {
+    if (closed) return;
+    commit();
+    closed = true;
+    for (Column& c : data) c.file.close(rows * c.width);
+    hashes.file.close(rows * hashes.width);
+    for (Column& c : indexes) c.file.close(rows * c.width);
+    header.close(sizeof(StoreHeader));
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "loop_metrics.h"
+#include "mapped_file.h"
+#include "result_cache.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Fields of a stored run: RunKey, then LoopMetrics. Each is one column of
+// float64 (the integer key fields are exact below 2^53).
+enum class StoreField : uint8_t {
+    Kp, Ki, Kd, Setpoint, Y0, V0, Dt, Steps, Integrator, FullMetrics,
+    Iae, Ise, Itae, Effort, Overshoot, RiseTime, SettlingTime, Elapsed,
+    Count
+};
+constexpr std::size_t STORE_FIELDS = static_cast<std::size_t>(StoreField::Count);
+
+const char* store_field_name(StoreField field);  // "kp", "iae", "settling_time", ...
+bool parse_store_field(const std::string& name, StoreField& out);
+// Gains and the metrics other than elapsed have a sorted index
+bool store_field_indexed(StoreField field);
+
+// min <= value < max; NaN (an undefined rise or settling time) never matches
+struct StoreRange {
+    StoreField field = StoreField::Iae;
+    double min = -std::numeric_limits<double>::infinity();
+    double max = std::numeric_limits<double>::infinity();
+};
+
+// "overshoot<0.05,settling_time<=2,kp>=100": comparisons with <, <=, >, >=
+// or =, joined by commas; throws std::invalid_argument on anything else
+std::vector<StoreRange> parse_store_where(const std::string& text);
+
+struct StoreRow {
+    RunKey key;
+    LoopMetrics metrics;
+};
+
+// Append-only columnar store of run results, for campaigns that outgrow
+// ResultCache's row file. `path` holds a small header; every field lives
+// beside it in `path`.<field>, memory-mapped and grown in chunks, plus a
+// key-hash column. Each indexed field and the hash have a sorted array of
+// row numbers (`path`.<field>.idx); commit() sorts the rows appended since
+// the last commit and merges them in from the back of the file, so the
+// indexes stay O(rows appended) to maintain. Rows not yet committed are
+// found by scanning, and are lost if the process dies before commit().
+//
+// Not thread-safe: callers serialize, as ResultCache does.
+class ResultStore {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr std::size_t MAX_ROWS = 0xFFFFFFFFu;  // row numbers are 32-bit
+
+    // Opens the store at `path`, creating it if there is none
+    explicit ResultStore(const std::string& path);
+    ~ResultStore();
+
+    ResultStore(const ResultStore&) = delete;
+    ResultStore& operator=(const ResultStore&) = delete;
+
+    std::size_t size() const { return rows; }
+    std::size_t indexed() const { return indexed_rows; }
+
+    // Adds a row unless one with an equal key is already stored; false then
+    bool append(const RunKey& key, const LoopMetrics& metrics);
+    bool lookup(const RunKey& key, LoopMetrics& out) const;
+
+    double value(std::size_t row, StoreField field) const { return columns[static_cast<std::size_t>(field)][row]; }
+    StoreRow row(std::size_t row) const;
+
+    // Row numbers matching every range, at most `limit` of them. With an
+    // indexed field among the ranges, the committed rows come from the
+    // narrowest index span in that field's order, the rest in row order.
+    std::vector<std::size_t> select(const std::vector<StoreRange>& where,
+                                     std::size_t limit = std::numeric_limits<std::size_t>::max()) const;
+
+    // Indexes the appended rows and writes the header; the store is durable after this
+    void commit();
+    void close();
+
+private:
+    struct Column {
+        MappedFile file;
+        std::size_t width = 0;  // bytes per row
+    };
+
+    void open_column(Column& c, const std::string& path, std::size_t width, std::size_t min_rows);
+    void reserve(std::size_t new_rows);
+    void merge_index(std::size_t slot, std::size_t begin, std::size_t end);
+    const uint32_t* index(std::size_t slot) const;
+    // Index span of [min, max) in `field`'s index over the committed rows
+    void index_span(StoreField field, double min, double max, std::size_t& lo, std::size_t& hi) const;
+    bool find_committed(const RunKey& key, uint64_t hash, std::size_t& at) const;
+    void write_header();
+
+    std::string path;
+    MappedFile header;
+    Column data[STORE_FIELDS];
+    Column hashes;
+    // One per indexed field, then the hash index
+    std::vector<Column> indexes;
+    std::vector<StoreField> indexed_fields;
+    const double* columns[STORE_FIELDS] = {};
+    std::size_t rows = 0;
+    std::size_t indexed_rows = 0;
+    std::size_t capacity = 0;  // rows every column file has room for
+    std::unordered_multimap<uint64_t, std::size_t> pending;  // hash -> row, uncommitted rows
+    bool closed = false;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Fixed-capacity ring that overwrites its oldest element once full. Storage
+// is allocated once in the constructor; push never allocates.
+template <class T>
+class RingBuffer {
+public:
+    explicit RingBuffer(std::size_t capacity) : items(capacity ? capacity : 1) {}
+
+    void push(const T& value) {
+        items[head] = value;
+        head = head + 1 == items.size() ? 0 : head + 1;
+        if (count < items.size()) ++count;
+    }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+    std::size_t size() const { return count; }
+    std::size_t capacity() const { return items.size(); }
+    bool empty() const { return count == 0; }
+
+    // 0 is the oldest retained element, size() - 1 the newest
+    const T& operator[](std::size_t i) const {
+        std::size_t start = count < items.size() ? 0 : head;
+        std::size_t idx = start + i;
+        return items[idx >= items.size() ? idx - items.size() : idx];
+    }
+    const T& newest() const { return (*this)[count - 1]; }
+
+private:
+    std::vector<T> items;
+    std::size_t head = 0;
+    std::size_t count = 0;
+};
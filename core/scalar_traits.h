@@ -0,0 +1,26 @@
+#pragma once
+
+#include "constants.h"
+#include "fixed_point.h"
+
+// Plant and controller constants expressed in the loop's scalar type, so
+// the fixed-point builds round them exactly once at compile time
+template <class T>
+struct ScalarTraits {
+    static constexpr T integral_limit() { return T(INTEGRAL_LIMIT); }
+    static constexpr T output_limit() { return T(OUTPUT_LIMIT); }
+    static constexpr T gravity() { return T(GRAVITY); }
+    static constexpr T bounce() { return T(BOUNCE_COEFFICIENT); }
+    static constexpr T zero() { return T(0); }
+    static constexpr T y_max() { return T(WINDOW_HEIGHT - BALL_SIZE); }
+    static constexpr T pv_offset() { return T(BALL_SIZE / 2); }
+    static double to_double(T v) { return static_cast<double>(v); }
+};
+
+template <class T> constexpr const char* scalar_name() { return "?"; }
+template <> constexpr const char* scalar_name<double>() { return "double"; }
+template <> constexpr const char* scalar_name<float>() { return "float"; }
+template <> constexpr const char* scalar_name<q16_16>() { return "q16.16"; }
+#ifdef PID_HAVE_Q32_31
+template <> constexpr const char* scalar_name<q32_31>() { return "q32.31"; }
+#endif
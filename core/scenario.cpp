@@ -0,0 +1,65 @@
+#include "scenario.h"
+
+#include <algorithm>
+
+Scenario::Scenario(const Simulation& initial, double dt, uint64_t interval)
+        : dt(dt), interval(interval ? interval : 1) {
+    current.sim = initial;
+    current.metrics.begin(initial.ball.y + BALL_SIZE / 2, initial.setpoint);
+    snapshots.push_back(current);
+}
+
+void Scenario::set_gains(uint64_t step, double kp, double ki, double kd) {
+    insert({ScenarioEvent::SetGains, step, kp, ki, kd});
+}
+
+void Scenario::set_setpoint(uint64_t step, double setpoint) {
+    insert({ScenarioEvent::SetSetpoint, step, setpoint});
+}
+
+void Scenario::insert(const ScenarioEvent& event) {
+    auto after = std::upper_bound(events.begin(), events.end(), event.step,
+                                  [](uint64_t s, const ScenarioEvent& e) { return s < e.step; });
+    events.insert(after, event);
+    // A snapshot at `event.step` predates the event and stays valid
+    while (snapshots.back().step > event.step) snapshots.pop_back();
+    if (current.step > event.step) current_valid = false;
+}
+
+void Scenario::apply(const ScenarioEvent& event) {
+    switch (event.type) {
+        case ScenarioEvent::SetGains:
+            current.sim.pid.Kp = event.a;
+            current.sim.pid.Ki = event.b;
+            current.sim.pid.Kd = event.c;
+            break;
+        case ScenarioEvent::SetSetpoint:
+            current.sim.setpoint = event.a;
+            break;
+    }
+}
+
+const Simulation& Scenario::run_to(uint64_t steps) {
+    // Latest snapshot at or before the target; use it unless the current
+    // state is valid and already closer
+    auto it = std::upper_bound(snapshots.begin(), snapshots.end(), steps,
+                               [](uint64_t s, const Snapshot& snap) { return s < snap.step; });
+    const Snapshot& nearest = *std::prev(it);
+    if (!current_valid || current.step > steps || nearest.step > current.step) {
+        current = nearest;
+        current_valid = true;
+    }
+    last_resume = current.step;
+
+    auto next_event = std::lower_bound(events.begin(), events.end(), current.step,
+                                       [](const ScenarioEvent& e, uint64_t s) { return e.step < s; });
+    while (current.step < steps) {
+        if (current.step % interval == 0 && current.step > snapshots.back().step) snapshots.push_back(current);
+        for (; next_event != events.end() && next_event->step == current.step; ++next_event) apply(*next_event);
+        current.sim.step(dt);
+        accumulate(current.metrics, current.sim, dt);
+        ++current.step;
+        ++simulated;
+    }
+    return current.sim;
+}
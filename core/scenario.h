@@ -0,0 +1,61 @@
+#pragma once
+
+#include "constants.h"
+#include "loop_metrics.h"
+#include "simulation.h"
+
+#include <cstdint>
+#include <vector>
+
+// A change to the loop applied just before step `step` runs
+struct ScenarioEvent {
+    enum Type : uint8_t { SetGains, SetSetpoint } type;
+    uint64_t step = 0;
+    double a = 0.0, b = 0.0, c = 0.0;  // Kp/Ki/Kd, or the setpoint
+};
+
+// A closed-loop run over a timeline of gain and setpoint changes that keeps
+// a full snapshot of the loop (ball, controller and metrics) every
+// `interval` steps. Editing the timeline drops only the snapshots after the
+// edit, so run_to() resumes from the nearest surviving one instead of t=0;
+// the result is bit-identical to a run from the start. Copying a Scenario
+// branches it: the copies share the past and diverge on their next edits.
+class Scenario {
+public:
+    explicit Scenario(const Simulation& initial, double dt = FIXED_TIMESTEP, uint64_t interval = 600);
+
+    void set_gains(uint64_t step, double kp, double ki, double kd);
+    void set_setpoint(uint64_t step, double setpoint);
+
+    // State after `steps` steps of the current timeline
+    const Simulation& run_to(uint64_t steps);
+
+    const Simulation& state() const { return current.sim; }
+    LoopMetrics metrics() const { return current.metrics.metrics(); }
+    uint64_t step() const { return current.step; }
+
+    // Where the latest run_to() started, and steps simulated over the lifetime
+    uint64_t resumed_from() const { return last_resume; }
+    uint64_t steps_simulated() const { return simulated; }
+    std::size_t checkpoints() const { return snapshots.size(); }
+    double timestep() const { return dt; }
+
+private:
+    struct Snapshot {
+        uint64_t step = 0;  // taken after this many steps, before that step's events
+        Simulation sim;
+        MetricsAccumulator metrics;
+    };
+
+    void insert(const ScenarioEvent& event);
+    void apply(const ScenarioEvent& event);
+
+    const double dt;
+    const uint64_t interval;
+    std::vector<ScenarioEvent> events;  // by step; equal steps keep insertion order
+    std::vector<Snapshot> snapshots;    // by step, snapshots[0] at step 0
+    Snapshot current;
+    bool current_valid = true;
+    uint64_t last_resume = 0;
+    uint64_t simulated = 0;
+};
@@ -0,0 +1,207 @@
+#include "scenario_script.h"
+#include "determinism.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr char SCRIPT_HEADER[] = "# pid scenario";
+constexpr char SEPARATORS[] = " \t\r\n";
+
+// One argument as a finite number; false when the line has run out too
+bool number(char* token, double& value) {
+    if (!token) return false;
+    char* end;
+    value = std::strtod(token, &end);
+    return end != token && *end == '\0' && std::isfinite(value);
+}
+
+// "noise=S", "delay=N", "quantum=Q", "seed=N" pairs, or "ideal"
+bool parse_sensor(SensorModel& model, std::string& error) {
+    char* token = std::strtok(nullptr, SEPARATORS);
+    if (!token) {
+        error = "sensor needs ideal or noise=, delay=, quantum=, seed= settings";
+        return false;
+    }
+    if (!std::strcmp(token, "ideal")) return true;
+    for (; token; token = std::strtok(nullptr, SEPARATORS)) {
+        char* eq = std::strchr(token, '=');
+        double v;
+        if (!eq || !number(eq + 1, v) || v < 0) {
+            error = std::string("expected NAME=VALUE, got ") + token;
+            return false;
+        }
+        *eq = '\0';
+        if (!std::strcmp(token, "noise")) model.noise_sigma = v;
+        else if (!std::strcmp(token, "quantum")) model.quantum = v;
+        else if (!std::strcmp(token, "delay") && v == std::floor(v) && v <= MAX_SENSOR_DELAY) model.delay_steps = static_cast<unsigned>(v);
+        else if (!std::strcmp(token, "seed") && v == std::floor(v)) model.seed = static_cast<uint64_t>(v);
+        else {
+            error = std::string("unknown or out of range sensor setting ") + token;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+ScenarioScript ScenarioScript::load(const std::string& path, double dt) {
+    if (!(dt > 0.0)) throw std::invalid_argument("scenario scripts need a positive timestep");
+    std::FILE* f = std::fopen(path.c_str(), "r");
+    if (!f) throw std::runtime_error("cannot read " + path + ": " + std::strerror(errno));
+    auto fail = [&](const std::string& what) {
+        std::fclose(f);
+        return std::runtime_error(path + ": " + what);
+    };
+
+    char line[256];
+    if (!std::fgets(line, sizeof(line), f) || std::strncmp(line, SCRIPT_HEADER, sizeof(SCRIPT_HEADER) - 1) != 0) {
+        throw fail("not a scenario script (no \"# pid scenario\" header)");
+    }
+    ScenarioScript script;
+    script.dt = dt;
+    unsigned long line_number = 1;
+    while (std::fgets(line, sizeof(line), f)) {
+        ++line_number;
+        if (char* comment = std::strchr(line, '#')) *comment = '\0';
+        char* token = std::strtok(line, SEPARATORS);
+        if (!token) continue;
+        const std::string where = "line " + std::to_string(line_number) + ": ";
+
+        double time;
+        if (!number(token, time) || time < 0) throw fail(where + "expected a time in seconds, got " + token);
+        ScriptEvent event;
+        event.step = static_cast<uint64_t>(std::llround(time / dt));
+        char* command = std::strtok(nullptr, SEPARATORS);
+        if (!command) throw fail(where + "expected a command after the time");
+
+        bool ok;
+        std::string error;
+        if (!std::strcmp(command, "setpoint")) {
+            event.type = ScriptEvent::Setpoint;
+            ok = number(std::strtok(nullptr, SEPARATORS), event.a);
+            if (!ok) error = "setpoint takes a height";
+        } else if (!std::strcmp(command, "gains")) {
+            event.type = ScriptEvent::Gains;
+            ok = number(std::strtok(nullptr, SEPARATORS), event.a) && number(std::strtok(nullptr, SEPARATORS), event.b) &&
+                 number(std::strtok(nullptr, SEPARATORS), event.c);
+            if (!ok) error = "gains takes Kp Ki Kd";
+        } else if (!std::strcmp(command, "disturb")) {
+            event.type = ScriptEvent::Disturbance;
+            ok = number(std::strtok(nullptr, SEPARATORS), event.a);
+            if (!ok) error = "disturb takes a force";
+        } else if (!std::strcmp(command, "sensor")) {
+            event.type = ScriptEvent::Sensor;
+            SensorModel model;
+            ok = parse_sensor(model, error);
+            event.sensor = static_cast<uint32_t>(script.sensors.size());
+            script.sensors.push_back(model);
+        } else {
+            throw fail(where + "unknown command " + command + " (setpoint, gains, disturb or sensor)");
+        }
+        if (!ok) throw fail(where + error);
+        // parse_sensor() consumes the rest of the line itself
+        if (event.type != ScriptEvent::Sensor && std::strtok(nullptr, SEPARATORS)) {
+            throw fail(where + "too many arguments for " + command);
+        }
+        script.used |= 1u << event.type;
+        script.list.push_back(event);
+    }
+    std::fclose(f);
+    if (script.list.empty()) throw std::runtime_error(path + ": scenario script holds no events");
+    std::stable_sort(script.list.begin(), script.list.end(),
+                     [](const ScriptEvent& a, const ScriptEvent& b) { return a.step < b.step; });
+    return script;
+}
+
+void ScriptPlayer::fire(const ScriptEvent& event, Simulation& sim) {
+    switch (event.type) {
+        case ScriptEvent::Setpoint:
+            sim.setpoint = event.a;
+            break;
+        case ScriptEvent::Gains:
+            sim.pid.Kp = event.a;
+            sim.pid.Ki = event.b;
+            sim.pid.Kd = event.c;
+            break;
+        case ScriptEvent::Disturbance:
+            sim.disturbance = event.a;
+            break;
+        case ScriptEvent::Sensor:
+            sim.set_sensor(script.sensor(event.sensor), stream);
+            break;
+    }
+}
+
+RunStats run_script(Simulation& sim, ScriptPlayer& player, uint64_t steps, double dt, MetricsAccumulator* metrics,
+                    StateHasher* hashes) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < steps; ++i) {
+        player.apply(i, sim);
+        sim.step(dt);
+        if (metrics) accumulate(*metrics, sim, dt);
+        if (hashes) hashes->sample(sim);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    RunStats stats;
+    stats.steps = steps;
+    stats.seconds = std::chrono::duration<double>(end - start).count();
+    return stats;
+}
+
+LaneScript::LaneScript(const ScenarioScript& script, std::size_t lanes, uint64_t lane_offset)
+        : source(script), offset(lane_offset) {
+    if (lane_offset && script.uses(ScriptEvent::Sensor)) {
+        throw std::invalid_argument("sensor events switch every lane at once; they need a lane offset of 0");
+    }
+    const std::vector<ScriptEvent>& events = script.events();
+    merged.reserve(lanes * events.size());
+    for (std::size_t lane = 0; lane < lanes; ++lane) {
+        for (std::size_t e = 0; e < events.size(); ++e) {
+            merged.push_back({events[e].step + lane_offset * lane, static_cast<uint32_t>(lane), static_cast<uint32_t>(e)});
+        }
+    }
+    std::stable_sort(merged.begin(), merged.end(), [](const Due& a, const Due& b) { return a.step < b.step; });
+}
+
+RunStats run_script(BatchEngine& engine, const LaneScript& lanes, uint64_t steps, double dt) {
+    const std::vector<ScriptEvent>& events = lanes.script().events();
+    const std::vector<LaneScript::Due>& due = lanes.due();
+    engine.set_disturbance_enabled(lanes.script().uses(ScriptEvent::Disturbance));
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t done = 0;
+    for (std::size_t i = 0; i < due.size() && due[i].step < steps;) {
+        engine.run(due[i].step - done, dt);
+        done = due[i].step;
+        for (; i < due.size() && due[i].step == done; ++i) {
+            const ScriptEvent& event = events[due[i].event];
+            const std::size_t lane = due[i].lane;
+            switch (event.type) {
+                case ScriptEvent::Setpoint: engine.set_setpoint(lane, event.a); break;
+                case ScriptEvent::Gains: engine.set_gains(lane, event.a, event.b, event.c); break;
+                case ScriptEvent::Disturbance: engine.disturbance[lane] = event.a; break;
+                case ScriptEvent::Sensor:
+                    // Due at the same step in every lane: install the model once
+                    if (lane == 0) engine.set_sensor(lanes.script().sensor(event.sensor));
+                    break;
+            }
+        }
+    }
+    engine.run(steps - done, dt);
+    auto end = std::chrono::steady_clock::now();
+
+    RunStats stats;
+    stats.steps = steps;
+    stats.seconds = std::chrono::duration<double>(end - start).count();
+    return stats;
+}
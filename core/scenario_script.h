@@ -0,0 +1,119 @@
+#pragma once
+
+#include "batch_engine.h"
+#include "constants.h"
+#include "loop_metrics.h"
+#include "sensor.h"
+#include "simulation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A regression campaign as a text file of timed changes to the loop, run
+// the same way by SDL_game --script, pid_headless --script and every lane
+// of pid_headless --lanes:
+//
+//   # pid scenario
+//   # time   command
+//   0.5      setpoint 300
+//   2.0      gains 300 2 20
+//   3.0      disturb -150    # added to the controller force from here on
+//   4.0      disturb 0
+//   5.0      sensor noise=0.5 delay=3 quantum=1
+//   6.0      sensor ideal
+//
+// Times are simulated seconds, rounded to the step they take effect
+// before, so an event fires at the same step in every mode. Lines may come
+// in any order; events of one step apply in file order. '#' starts a
+// comment.
+struct ScriptEvent {
+    enum Type : uint8_t { Setpoint, Gains, Disturbance, Sensor } type = Setpoint;
+    uint32_t sensor = 0;  // ScenarioScript::sensor() index of a Sensor event
+    uint64_t step = 0;
+    double a = 0.0, b = 0.0, c = 0.0;  // the setpoint, Kp/Ki/Kd, or the force
+};
+
+class ScenarioScript {
+public:
+    // Throws std::runtime_error for an unreadable or malformed file, naming
+    // the line
+    static ScenarioScript load(const std::string& path, double dt = FIXED_TIMESTEP);
+
+    // Sorted by step; never empty
+    const std::vector<ScriptEvent>& events() const { return list; }
+    const SensorModel& sensor(uint32_t index) const { return sensors[index]; }
+    bool uses(ScriptEvent::Type type) const { return (used >> type) & 1u; }
+    uint64_t last_step() const { return list.back().step; }
+    double timestep() const { return dt; }
+
+private:
+    double dt = FIXED_TIMESTEP;
+    std::vector<ScriptEvent> list;
+    std::vector<SensorModel> sensors;
+    unsigned used = 0;  // bit per ScriptEvent::Type
+};
+
+// Plays a script into one loop, `offset` steps late. The events are
+// sorted, so a step with nothing due costs one comparison. Sensor events
+// install their model with noise stream `stream`, as BatchEngine lane
+// `stream` does.
+class ScriptPlayer {
+public:
+    explicit ScriptPlayer(const ScenarioScript& script, uint64_t offset = 0, uint64_t stream = 0)
+            : script(script), next(script.events().data()), end(next + script.events().size()),
+              offset(offset), stream(stream) {}
+
+    // Applies every event due before step `step` (0-based) runs
+    void apply(uint64_t step, Simulation& sim) {
+        while (next != end && next->step + offset <= step) fire(*next++, sim);
+    }
+
+    bool done() const { return next == end; }
+    std::size_t fired() const { return script.events().size() - static_cast<std::size_t>(end - next); }
+
+private:
+    void fire(const ScriptEvent& event, Simulation& sim);
+
+    const ScenarioScript& script;
+    const ScriptEvent* next;
+    const ScriptEvent* end;
+    uint64_t offset;
+    uint64_t stream;
+};
+
+class StateHasher;
+
+// Steps `sim` `steps` times at `dt`, with `player` applying its events as
+// they come due; `metrics` and `hashes` as in run_headless()
+RunStats run_script(Simulation& sim, ScriptPlayer& player, uint64_t steps, double dt,
+                    MetricsAccumulator* metrics = nullptr, StateHasher* hashes = nullptr);
+
+// A script for every lane of a batch, lane i playing it lane_offset * i
+// steps late: the events of all lanes merged into one sorted array, built
+// once before the run. The engine has one sensor model for all lanes, so
+// sensor events need lane_offset 0 (std::invalid_argument otherwise).
+class LaneScript {
+public:
+    LaneScript(const ScenarioScript& script, std::size_t lanes, uint64_t lane_offset = 0);
+
+    struct Due {
+        uint64_t step;
+        uint32_t lane;
+        uint32_t event;  // index into script().events()
+    };
+
+    const ScenarioScript& script() const { return source; }
+    const std::vector<Due>& due() const { return merged; }
+    uint64_t lane_offset() const { return offset; }
+
+private:
+    const ScenarioScript& source;
+    uint64_t offset;
+    std::vector<Due> merged;  // by step; one lane's events keep the script's order
+};
+
+// Steps every lane of `engine` `steps` times, running it uninterrupted
+// between the steps where `lanes` has events due
+RunStats run_script(BatchEngine& engine, const LaneScript& lanes, uint64_t steps, double dt);
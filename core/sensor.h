@@ -0,0 +1,74 @@
+#pragma once
+
+#include "philox.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+// Past samples each sensor keeps; a power of two so the ring index is a mask
+constexpr std::size_t SENSOR_HISTORY = 64;
+constexpr unsigned MAX_SENSOR_DELAY = SENSOR_HISTORY - 1;
+
+// What the controller sees instead of the exact ball position: every step
+// the true pv gets Gaussian noise, is rounded to a multiple of `quantum`
+// (an ADC or encoder step), and reaches the controller `delay_steps` steps
+// later. The default is the ideal sensor the loop always had.
+struct SensorModel {
+    unsigned delay_steps = 0;
+    double quantum = 0.0;      // 0 = no quantization
+    double noise_sigma = 0.0;  // standard deviation, in pv units
+    uint64_t seed = 1;         // noise streams are PhiloxStream(seed, loop index)
+
+    bool ideal() const { return delay_steps == 0 && quantum == 0.0 && noise_sigma == 0.0; }
+
+    void validate() const {
+        if (delay_steps > MAX_SENSOR_DELAY) throw std::invalid_argument("sensor delay is limited to 63 steps");
+        if (!(quantum >= 0.0) || !(noise_sigma >= 0.0)) {
+            throw std::invalid_argument("sensor quantum and noise must not be negative");
+        }
+    }
+
+    // One reading of `pv` before the delay line; the noise draw comes first,
+    // quantization rounds the noisy value like a real converter would
+    double sample(double pv, PhiloxStream& rng) const {
+        if (noise_sigma > 0.0) pv += noise_sigma * rng.normal();
+        if (quantum > 0.0) pv = quantum * std::nearbyint(pv / quantum);
+        return pv;
+    }
+};
+
+// Delay line of one loop: a fixed ring of the last SENSOR_HISTORY readings.
+// measure() is O(1) and never allocates; the read position is a masked
+// offset from the write position, so the delay costs no branch.
+class Sensor {
+public:
+    Sensor() = default;
+    // The history starts full of ideal readings of `initial_pv`, as if the
+    // loop had been at rest there
+    Sensor(const SensorModel& model, uint64_t stream, double initial_pv)
+            : model_(model), rng(model.seed, stream), active(!model.ideal()) {
+        model.validate();
+        history.fill(initial_pv);
+    }
+
+    const SensorModel& model() const { return model_; }
+    bool ideal() const { return !active; }
+
+    double measure(double pv) {
+        head = (head + 1) & MASK;
+        history[head] = model_.sample(pv, rng);
+        return history[(head - model_.delay_steps) & MASK];
+    }
+
+private:
+    static constexpr unsigned MASK = SENSOR_HISTORY - 1;
+
+    SensorModel model_;
+    PhiloxStream rng{1, 0};
+    std::array<double, SENSOR_HISTORY> history{};
+    unsigned head = 0;
+    bool active = false;
+};
@@ -0,0 +1,128 @@
+#include "serial_port.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+[[noreturn]] void fail(const std::string& what) {
+#ifdef _WIN32
+    throw std::runtime_error(what + " (error " + std::to_string(GetLastError()) + ")");
+#else
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+#endif
+}
+
+#ifndef _WIN32
+speed_t baud_constant(unsigned baud) {
+    switch (baud) {
+        case 9600:    return B9600;
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+#ifdef B460800
+        case 460800:  return B460800;
+#endif
+#ifdef B921600
+        case 921600:  return B921600;
+#endif
+    }
+    throw std::invalid_argument("unsupported baud rate " + std::to_string(baud));
+}
+#endif
+
+} // namespace
+
+SerialPort::SerialPort(const std::string& device, unsigned baud) {
+#ifdef _WIN32
+    std::string path = device.rfind("\\\\.\\", 0) == 0 ? device : "\\\\.\\" + device;
+    HANDLE h = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (h == INVALID_HANDLE_VALUE) fail("cannot open " + device);
+    handle = reinterpret_cast<intptr_t>(h);
+
+    DCB dcb{};
+    dcb.DCBlength = sizeof(dcb);
+    GetCommState(h, &dcb);
+    dcb.BaudRate = baud;
+    dcb.ByteSize = 8;
+    dcb.Parity = NOPARITY;
+    dcb.StopBits = ONESTOPBIT;
+    dcb.fBinary = TRUE;
+    dcb.fOutxCtsFlow = dcb.fOutxDsrFlow = FALSE;
+    dcb.fOutX = dcb.fInX = FALSE;
+    if (!SetCommState(h, &dcb)) {
+        CloseHandle(h);
+        fail("cannot configure " + device);
+    }
+    // MAXDWORD/0/0 makes ReadFile return at once with what is buffered;
+    // writes normally land in the driver buffer at once, but are capped at
+    // 1 ms if it is ever full
+    COMMTIMEOUTS timeouts{MAXDWORD, 0, 0, 0, 1};
+    SetCommTimeouts(h, &timeouts);
+#else
+    int fd = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) fail("cannot open " + device);
+    handle = fd;
+
+    termios tio{};
+    if (tcgetattr(fd, &tio) != 0) {
+        ::close(fd);
+        fail("cannot configure " + device);
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    speed_t speed = baud_constant(baud);
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        ::close(fd);
+        fail("cannot configure " + device);
+    }
+    tcflush(fd, TCIOFLUSH);
+#endif
+}
+
+SerialPort::~SerialPort() {
+#ifdef _WIN32
+    CloseHandle(reinterpret_cast<HANDLE>(handle));
+#else
+    ::close(static_cast<int>(handle));
+#endif
+}
+
+std::size_t SerialPort::read(uint8_t* data, std::size_t capacity) {
+#ifdef _WIN32
+    DWORD got = 0;
+    if (!ReadFile(reinterpret_cast<HANDLE>(handle), data, static_cast<DWORD>(capacity), &got, nullptr)) return 0;
+    return got;
+#else
+    ssize_t got = ::read(static_cast<int>(handle), data, capacity);
+    return got > 0 ? static_cast<std::size_t>(got) : 0;
+#endif
+}
+
+std::size_t SerialPort::write(const uint8_t* data, std::size_t size) {
+#ifdef _WIN32
+    DWORD put = 0;
+    if (!WriteFile(reinterpret_cast<HANDLE>(handle), data, static_cast<DWORD>(size), &put, nullptr)) return 0;
+    return put;
+#else
+    ssize_t put = ::write(static_cast<int>(handle), data, size);
+    return put > 0 ? static_cast<std::size_t>(put) : 0;
+#endif
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Raw 8N1 serial port (or USB CDC device) opened for non-blocking I/O:
+// read() and write() return immediately with whatever the driver accepts.
+class SerialPort {
+public:
+    SerialPort(const std::string& device, unsigned baud);
+    ~SerialPort();
+
+    SerialPort(const SerialPort&) = delete;
+    SerialPort& operator=(const SerialPort&) = delete;
+
+    // Bytes read, 0 if nothing is pending
+    std::size_t read(uint8_t* data, std::size_t capacity);
+    // Bytes accepted by the driver; fewer than `size` means its buffer is full
+    std::size_t write(const uint8_t* data, std::size_t size);
+
+private:
+    intptr_t handle = -1;
+};
@@ -0,0 +1,179 @@
+#include "shm_telemetry.h"
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+[[noreturn]] void fail(const std::string& what) {
+#ifdef _WIN32
+    throw std::runtime_error(what + " (error " + std::to_string(GetLastError()) + ")");
+#else
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+#endif
+}
+
+std::string os_name(const std::string& name) {
+    if (name.empty()) throw std::invalid_argument("a shared-memory segment needs a name");
+#ifdef _WIN32
+    return name.find('\\') == std::string::npos ? "Local\\" + name : name;
+#else
+    return name[0] == '/' ? name : "/" + name;
+#endif
+}
+
+// Maps `bytes` of segment `name`, creating it afresh when `create` is set
+void* map_segment(const std::string& name, std::size_t bytes, bool create, intptr_t& handle) {
+#ifdef _WIN32
+    HANDLE h = create ? CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                           static_cast<DWORD>(static_cast<uint64_t>(bytes) >> 32),
+                                           static_cast<DWORD>(bytes), name.c_str())
+                      : OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (!h) fail("cannot open shared memory " + name);
+    void* base = MapViewOfFile(h, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, bytes);
+    if (!base) {
+        CloseHandle(h);
+        fail("cannot map shared memory " + name);
+    }
+    handle = reinterpret_cast<intptr_t>(h);
+    return base;
+#else
+    if (create) shm_unlink(name.c_str());  // a fresh segment, never a stale one a reader still sees
+    int fd = create ? shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644) : shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) fail("cannot open shared memory " + name);
+    if (create && ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        fail("cannot size shared memory " + name);
+    }
+    void* base = mmap(nullptr, bytes, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        if (create) shm_unlink(name.c_str());
+        fail("cannot map shared memory " + name);
+    }
+    handle = 0;
+    return base;
+#endif
+}
+
+void unmap_segment(const void* base, std::size_t bytes, intptr_t& handle) {
+    if (!base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+    CloseHandle(reinterpret_cast<HANDLE>(handle));
+#else
+    munmap(const_cast<void*>(base), bytes);
+#endif
+    handle = -1;
+}
+
+// Header plus the ring
+std::size_t segment_bytes(uint64_t capacity) {
+    return sizeof(ShmTelemetryHeader) + capacity * sizeof(ShmTelemetrySlot);
+}
+
+} // namespace
+
+ShmTelemetryWriter::ShmTelemetryWriter(const std::string& name, double dt, std::size_t capacity)
+        : segment_name(os_name(name)), mask(capacity - 1), bytes(segment_bytes(capacity)) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        throw std::invalid_argument("the shared-memory ring needs a power-of-two capacity");
+    }
+    void* base = map_segment(segment_name, bytes, true, handle);
+    // Fresh pages are zero: every slot reads as "never written"
+    header = new (base) ShmTelemetryHeader{};
+    std::memcpy(header->magic, SHM_TELEMETRY_MAGIC, sizeof(header->magic));
+    header->version = SHM_TELEMETRY_VERSION;
+    header->record_size = sizeof(TelemetryRecord);
+    header->capacity = capacity;
+    header->dt = dt;
+    slots = reinterpret_cast<ShmTelemetrySlot*>(static_cast<uint8_t*>(base) + sizeof(ShmTelemetryHeader));
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+ShmTelemetryWriter::~ShmTelemetryWriter() {
+    close();
+}
+
+void ShmTelemetryWriter::close() {
+    if (!header) return;
+    header->closed.store(1, std::memory_order_release);
+#ifndef _WIN32
+    shm_unlink(segment_name.c_str());  // mapped readers keep the segment until they let go
+#endif
+    unmap_segment(header, bytes, handle);
+    header = nullptr;
+    slots = nullptr;
+}
+
+ShmTelemetryReader::ShmTelemetryReader(const std::string& name) {
+    const std::string os = os_name(name);
+    // The header alone first, for the ring size
+    const auto* probe = static_cast<const ShmTelemetryHeader*>(
+            map_segment(os, sizeof(ShmTelemetryHeader), false, handle));
+    const bool valid = std::memcmp(probe->magic, SHM_TELEMETRY_MAGIC, sizeof(probe->magic)) == 0 &&
+                       probe->version == SHM_TELEMETRY_VERSION && probe->record_size == sizeof(TelemetryRecord);
+    const uint64_t capacity = probe->capacity;
+    unmap_segment(probe, sizeof(ShmTelemetryHeader), handle);
+    if (!valid || capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        throw std::runtime_error(os + " is not a PIDSHM1 telemetry segment");
+    }
+
+    bytes = segment_bytes(capacity);
+    const void* base = map_segment(os, bytes, false, handle);
+    header = static_cast<const ShmTelemetryHeader*>(base);
+    slots = reinterpret_cast<const ShmTelemetrySlot*>(static_cast<const uint8_t*>(base) + sizeof(ShmTelemetryHeader));
+    mask = capacity - 1;
+    cursor = header->head.load(std::memory_order_acquire);
+}
+
+ShmTelemetryReader::~ShmTelemetryReader() {
+    unmap_segment(header, bytes, handle);
+}
+
+std::size_t ShmTelemetryReader::poll(TelemetryRecord* out, std::size_t max) {
+    const uint64_t capacity = mask + 1;
+    uint64_t head = header->head.load(std::memory_order_acquire);
+    std::size_t n = 0;
+    while (n < max && cursor < head) {
+        if (head - cursor > capacity) {
+            // A whole ring behind: those steps are gone; resume half a ring
+            // back from the newest so the producer has room before it laps us again
+            uint64_t resume = head - capacity / 2;
+            lost_count += resume - cursor;
+            cursor = resume;
+        }
+        const ShmTelemetrySlot& slot = slots[cursor & mask];
+        const uint64_t done = 2 * cursor + 2;
+        if (slot.sequence.load(std::memory_order_acquire) == done) {
+            uint64_t words[SHM_RECORD_WORDS];
+            for (std::size_t i = 0; i < SHM_RECORD_WORDS; ++i) words[i] = slot.words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == done) {
+                std::memcpy(&out[n++], words, sizeof(words));
+                ++cursor;
+                continue;
+            }
+        }
+        // Overwritten while we looked: the producer lapped this slot
+        head = header->head.load(std::memory_order_acquire);
+        uint64_t resume = std::max(cursor + 1, head > capacity / 2 ? head - capacity / 2 : 0);
+        lost_count += resume - cursor;
+        cursor = resume;
+    }
+    return n;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "telemetry.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+constexpr std::size_t SHM_RECORD_WORDS = sizeof(TelemetryRecord) / sizeof(uint64_t);
+
+// Live physics steps in a named shared-memory segment, for plotting tools
+// and dashboards on the same machine: no socket, no copy through the
+// kernel. The segment is a header followed by a power-of-two ring of slots
+// that the single producer overwrites in order. Readers only ever load
+// from the segment, so absent, slow or stalled readers cannot hold the
+// producer up; a reader that falls a whole ring behind notices it, counts
+// the steps it missed and resumes near the newest ones.
+//
+// Each slot is a seqlock: the producer marks it odd (2n + 1) while
+// writing step n and even (2n + 2) when done, and a reader keeps a copy
+// only if it saw 2n + 2 both before and after copying. Record words are
+// relaxed atomics, so a copy that races the producer is discarded rather
+// than undefined. All fields are in the producer's byte order.
+struct ShmTelemetryHeader {
+    char magic[8];          // "PIDSHM1"
+    uint32_t version;
+    uint32_t record_size;   // sizeof(TelemetryRecord)
+    uint64_t capacity;      // slots, a power of two
+    double dt;
+    std::atomic<uint32_t> closed;  // set when the producer goes away
+    uint32_t reserved0;
+    uint64_t reserved[3];
+    alignas(64) std::atomic<uint64_t> head;  // steps published so far
+};
+
+struct alignas(64) ShmTelemetrySlot {
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> words[SHM_RECORD_WORDS];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory atomics must be address-free");
+static_assert(sizeof(ShmTelemetryHeader) == 128, "shared-memory header layout is part of the format");
+static_assert(sizeof(ShmTelemetrySlot) == 128, "shared-memory slot layout is part of the format");
+
+constexpr char SHM_TELEMETRY_MAGIC[8] = "PIDSHM1";
+constexpr uint32_t SHM_TELEMETRY_VERSION = 1;
+
+// Creates (or replaces) the segment `name`: "pid" becomes /pid under POSIX,
+// Local\pid on Windows
+class ShmTelemetryWriter {
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 1 << 16;  // 8 MiB of slots
+
+    ShmTelemetryWriter(const std::string& name, double dt, std::size_t capacity = DEFAULT_CAPACITY);
+    ~ShmTelemetryWriter();
+
+    ShmTelemetryWriter(const ShmTelemetryWriter&) = delete;
+    ShmTelemetryWriter& operator=(const ShmTelemetryWriter&) = delete;
+
+    // Stepping thread only; a handful of plain stores, never waits
+    void record(const TelemetryRecord& r) {
+        ShmTelemetrySlot& slot = slots[next & mask];
+        uint64_t words[SHM_RECORD_WORDS];
+        std::memcpy(words, &r, sizeof(words));
+        slot.sequence.store(2 * next + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < SHM_RECORD_WORDS; ++i) slot.words[i].store(words[i], std::memory_order_relaxed);
+        slot.sequence.store(2 * next + 2, std::memory_order_release);
+        header->head.store(++next, std::memory_order_release);
+    }
+
+    const std::string& name() const { return segment_name; }
+    uint64_t published() const { return next; }
+
+    // Marks the segment closed for readers and removes its name
+    void close();
+
+private:
+    std::string segment_name;
+    ShmTelemetryHeader* header = nullptr;
+    ShmTelemetrySlot* slots = nullptr;
+    uint64_t mask = 0;
+    uint64_t next = 0;
+    std::size_t bytes = 0;
+    intptr_t handle = -1;
+};
+
+// Reads the steps published after it attached
+class ShmTelemetryReader {
+public:
+    explicit ShmTelemetryReader(const std::string& name);
+    ~ShmTelemetryReader();
+
+    ShmTelemetryReader(const ShmTelemetryReader&) = delete;
+    ShmTelemetryReader& operator=(const ShmTelemetryReader&) = delete;
+
+    // Copies up to `max` new steps in order and returns how many; steps
+    // overwritten before this reader got to them are added to lost()
+    std::size_t poll(TelemetryRecord* out, std::size_t max);
+
+    double dt() const { return header->dt; }
+    uint64_t capacity() const { return header->capacity; }
+    uint64_t lost() const { return lost_count; }
+    bool producer_closed() const { return header->closed.load(std::memory_order_acquire) != 0; }
+
+private:
+    const ShmTelemetryHeader* header = nullptr;
+    const ShmTelemetrySlot* slots = nullptr;
+    uint64_t mask = 0;
+    uint64_t cursor = 0;
+    uint64_t lost_count = 0;
+    std::size_t bytes = 0;
+    intptr_t handle = -1;
+};
@@ -0,0 +1,48 @@
+#include "simulation.h"
+#include "async_logger.h"
+#include "determinism.h"
+
+#include <chrono>
+
+RunStats run_headless(Simulation& sim, uint64_t steps, double dt, MetricsAccumulator* metrics,
+                      StateHasher* hashes) {
+    auto start = std::chrono::steady_clock::now();
+    if (metrics || hashes) {
+        for (uint64_t i = 0; i < steps; ++i) {
+            sim.step(dt);
+            if (metrics) accumulate(*metrics, sim, dt);
+            if (hashes) hashes->sample(sim);
+        }
+    } else {
+        for (uint64_t i = 0; i < steps; ++i) {
+            sim.step(dt);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    RunStats stats;
+    stats.steps = steps;
+    stats.seconds = std::chrono::duration<double>(end - start).count();
+    return stats;
+}
+
+void log_step_events(AsyncLogger& log, const StepFlags& before, const StepFlags& after, double time, double y,
+                     double velocity, double clamped, double error, bool output_clamp) {
+    if (after.saturated != before.saturated) {
+        if (output_clamp) {
+            if (after.saturated) log.log("output saturated at %g, error %g (t=%g s)", clamped, error, time);
+            else log.log("output back inside its limit at %g (t=%g s)", clamped, time);
+        } else {
+            if (after.saturated) log.log("integral saturated at %g, error %g (t=%g s)", clamped, error, time);
+            else log.log("integral back inside its limit at %g (t=%g s)", clamped, time);
+        }
+    }
+    if (after.at_wall && !before.at_wall) {
+        if (y <= 0.0) log.log("ball hit the floor, rebounding at %g px/s (t=%g s)", velocity, time);
+        else log.log("ball hit the ceiling, rebounding at %g px/s (t=%g s)", velocity, time);
+    }
+    if (after.misses != before.misses) {
+        log.log("controller missed %g update(s), %g so far (t=%g s)", static_cast<double>(after.misses - before.misses),
+                static_cast<double>(after.misses), time);
+    }
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "ball.h"
+#include "compute_timing.h"
+#include "constants.h"
+#include "gain_schedule.h"
+#include "integrator.h"
+#include "loop_metrics.h"
+#include "pid_controller.h"
+#include "sensor.h"
+
+#include <cstdint>
+
+class AsyncLogger;
+
+// Loop conditions worth a log line when they begin or end
+struct StepFlags {
+    bool saturated = false;  // controller at its anti-windup clamp
+    bool at_wall = false;    // ball at the floor or ceiling
+    uint64_t misses = 0;     // controller updates missed so far
+};
+
+// Logs the changes between two steps' flags; out of line, so a step with
+// nothing to report only pays for the snapshot and a compare. `clamped` is
+// the integral, or with `output_clamp` (velocity form) the output.
+void log_step_events(AsyncLogger& log, const StepFlags& before, const StepFlags& after, double time, double y,
+                     double velocity, double clamped, double error, bool output_clamp);
+
+// Closed loop of one controller driving one ball, free of any SDL dependency.
+// T is the controller/plant scalar; simulated time stays double throughout.
+template <class T>
+struct BasicSimulation {
+    BasicBall<T> ball;
+    BasicPID_Controller<T> pid{T(80.0), T(0), T(0)};
+    T setpoint = T(WINDOW_HEIGHT / 2.0);
+    T measurement = ball.y + ScalarTraits<T>::pv_offset();  // pv fed to the controller in the latest step
+    T output = T(0);                                        // controller force applied in the latest step
+    T disturbance = T(0);  // external force added to the controller's, as BatchEngine::disturbance
+    double time = 0.0;
+    // Rk4 integrates pid in positional form, with its feed-forward but no observer
+    Integrator integrator = Integrator::SemiImplicitEuler;
+    // Delay, quantization and noise between the ball and the controller;
+    // ideal by default. RK4 integrates the loop in continuous form and
+    // always sees the exact position.
+    Sensor sensor;
+    // Compute delay and missed updates between the controller and the
+    // ball, ideal by default; euler/zoh only, like the sensor
+    ComputeTiming timing;
+    // When set, pid's gains are looked up from the operating point at the
+    // start of a step (after the sensor, before the controller) every
+    // schedule->hold_steps() steps. Not owned; nullptr keeps the gains.
+    const GainSchedule* schedule = nullptr;
+    unsigned schedule_phase = 0;  // steps since the last lookup
+    // When set, integral saturation, wall hits and missed updates are
+    // logged as they happen (core/async_logger.h). Not owned; nullptr
+    // costs one predictable branch per step.
+    AsyncLogger* events = nullptr;
+
+    // Installs `model` with its history at the current position; `stream`
+    // picks the noise stream, matching BatchEngine lane `stream`
+    void set_sensor(const SensorModel& model, uint64_t stream = 0) {
+        sensor = Sensor(model, stream, ScalarTraits<T>::to_double(ball.y + ScalarTraits<T>::pv_offset()));
+    }
+
+    // Installs `model`; `stream` picks the draw stream as for set_sensor()
+    void set_timing(const ComputeTimingModel& model, uint64_t stream = 0) { timing = ComputeTiming(model, stream); }
+
+    void step(T dt) {
+        if (events) step_logged(dt);
+        else advance(dt);
+    }
+
+    StepFlags flags() const {
+        using Traits = ScalarTraits<T>;
+        return {pid.saturated(), ball.y <= Traits::zero() || ball.y >= Traits::y_max(), timing.misses()};
+    }
+
+private:
+    void step_logged(T dt) {
+        using Traits = ScalarTraits<T>;
+        const StepFlags before = flags();
+        advance(dt);
+        const StepFlags after = flags();
+        if (after.saturated == before.saturated && after.at_wall == before.at_wall && after.misses == before.misses) {
+            return;
+        }
+        const bool output_clamp = pid.form() == PidForm::Velocity;
+        log_step_events(*events, before, after, time, Traits::to_double(ball.y), Traits::to_double(ball.velocity),
+                        Traits::to_double(output_clamp ? output : pid.integral_value()),
+                        Traits::to_double(pid.last_error()), output_clamp);
+    }
+
+    void advance(T dt) {
+        measurement = ball.y + ScalarTraits<T>::pv_offset();
+        if (integrator == Integrator::Rk4) {
+            if (schedule) apply_schedule();
+            step_rk4(dt);
+        } else {
+            if (!sensor.ideal()) measurement = T(sensor.measure(ScalarTraits<T>::to_double(measurement)));
+            if (schedule) apply_schedule();
+            T force = timing.ideal() ? pid.calculate(setpoint, measurement, dt)
+                                     : T(timing.step([&] {
+                                           return ScalarTraits<T>::to_double(pid.calculate(setpoint, measurement, dt));
+                                       }));
+            if (disturbance != T(0)) force += disturbance;
+            if (integrator == Integrator::ExactZoh) ball.update_exact(force, dt);
+            else ball.update(force, dt);
+            output = force;
+        }
+        time += static_cast<double>(dt);
+    }
+
+    void apply_schedule() {
+        using Traits = ScalarTraits<T>;
+        bool due = schedule_phase == 0;
+        if (++schedule_phase == schedule->hold_steps()) schedule_phase = 0;
+        if (!due) return;
+        ScheduledGains g = schedule->at_state(Traits::to_double(measurement), Traits::to_double(ball.velocity),
+                                              Traits::to_double(setpoint));
+        pid.Kp = T(g.kp);
+        pid.Ki = T(g.ki);
+        pid.Kd = T(g.kd);
+    }
+
+    // Closed-loop state derivative with the controller in continuous form.
+    // The setpoint is held over the step, so d(error)/dt = -velocity.
+    struct Rate { T dy, dv, di; };
+    Rate rate(T y, T v, T i) const {
+        T error = setpoint - (y + ScalarTraits<T>::pv_offset());
+        T force = pid.Kp * error + pid.Ki * i - pid.Kd * v + pid.feed_forward + disturbance;
+        return {v, force - ball.gravity, error};
+    }
+
+    void step_rk4(T dt) {
+        const T y0 = ball.y, v0 = ball.velocity, i0 = pid.integral_value();
+        const T half = dt * T(0.5);
+        Rate k1 = rate(y0, v0, i0);
+        Rate k2 = rate(y0 + half * k1.dy, v0 + half * k1.dv, i0 + half * k1.di);
+        Rate k3 = rate(y0 + half * k2.dy, v0 + half * k2.dv, i0 + half * k2.di);
+        Rate k4 = rate(y0 + dt * k3.dy, v0 + dt * k3.dv, i0 + dt * k3.di);
+        const T sixth = dt / T(6);
+        auto combine = [&](T x0, T a, T b, T c, T d) { return x0 + sixth * (a + T(2) * b + T(2) * c + d); };
+
+        output = k1.dv + ball.gravity;  // force at the start of the step
+        T y = combine(y0, k1.dy, k2.dy, k3.dy, k4.dy);
+        T v = combine(v0, k1.dv, k2.dv, k3.dv, k4.dv);
+        T i = combine(i0, k1.di, k2.di, k3.di, k4.di);
+        ball.set_state(y, v);
+        pid.load_state(i, setpoint - (ball.y + ScalarTraits<T>::pv_offset()));
+    }
+};
+
+using Simulation = BasicSimulation<double>;
+
+struct RunStats {
+    uint64_t steps = 0;
+    double seconds = 0.0;
+
+    double steps_per_second() const { return seconds > 0 ? steps / seconds : 0.0; }
+    double ns_per_step() const { return steps ? seconds * 1e9 / steps : 0.0; }
+};
+
+class StateHasher;
+
+// Steps the loop back-to-back with no pacing, as fast as the CPU allows.
+// With `metrics`, every step is also folded into the accumulator; with
+// `hashes`, into the state digest (core/determinism.h).
+RunStats run_headless(Simulation& sim, uint64_t steps, double dt = FIXED_TIMESTEP,
+                      MetricsAccumulator* metrics = nullptr, StateHasher* hashes = nullptr);
+
+// Feeds the state after the latest sim.step(dt) into `metrics`
+inline void accumulate(MetricsAccumulator& metrics, const Simulation& sim, double dt) {
+    metrics.update(sim.ball.y + BALL_SIZE / 2, sim.setpoint, sim.output, dt);
+}
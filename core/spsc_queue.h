@@ -0,0 +1,61 @@
+#pragma once
+
+#include "aligned.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free single-producer/single-consumer ring. Capacity must be
+// a power of two; push fails instead of blocking when the ring is full.
+template <class T, std::size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    bool push(const T& value) {
+        std::size_t tail = tail_pos.load(std::memory_order_relaxed);
+        if (tail - head_cache == Capacity) {
+            head_cache = head_pos.load(std::memory_order_acquire);
+            if (tail - head_cache == Capacity) return false;
+        }
+        items[tail & (Capacity - 1)] = value;
+        tail_pos.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) {
+        std::size_t head = head_pos.load(std::memory_order_relaxed);
+        if (head == tail_cache) {
+            tail_cache = tail_pos.load(std::memory_order_acquire);
+            if (head == tail_cache) return false;
+        }
+        out = items[head & (Capacity - 1)];
+        head_pos.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Zero-copy consumer side: points `first` at the oldest unread items and
+    // returns how many are readable contiguously (a span stops at the wrap);
+    // `total` receives the count including any past the wrap. Items stay
+    // valid until released with consume().
+    std::size_t peek(const T*& first, std::size_t& total) {
+        std::size_t head = head_pos.load(std::memory_order_relaxed);
+        tail_cache = tail_pos.load(std::memory_order_acquire);
+        std::size_t offset = head & (Capacity - 1);
+        first = &items[offset];
+        total = tail_cache - head;
+        return total < Capacity - offset ? total : Capacity - offset;
+    }
+
+    void consume(std::size_t n) {
+        head_pos.store(head_pos.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+private:
+    std::array<T, Capacity> items{};
+    alignas(CACHE_LINE) std::atomic<std::size_t> head_pos{0};
+    std::size_t tail_cache = 0;  // consumer's view of tail
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail_pos{0};
+    std::size_t head_cache = 0;  // producer's view of head
+};
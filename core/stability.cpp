@@ -0,0 +1,49 @@
+#include "stability.h"
+#include "batch_kernels.h"
+
+#include <cmath>
+
+namespace {
+
+bool cpu_has_avx2() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+// Jury conditions for monic z^3 + a2 z^2 + a1 z + a0 and z^2 + b1 z + b0,
+// the coefficients divided by powers of the radius. The AVX2 kernel does
+// the same operations in the same order.
+void screen_lanes_scalar(const double* kp, const double* ki, const double* kd, std::size_t begin, std::size_t end,
+                         double dt, double radius, uint8_t* keep) {
+    const double r2 = radius * radius, r3 = r2 * radius;
+    const double dt2 = dt * dt, dt3 = dt2 * dt;
+    for (std::size_t i = begin; i < end; ++i) {
+        double p = kp[i] * dt2, q = ki[i] * dt3, d = kd[i] * dt;
+        double a2 = (-3.0 + p + q + d) / radius;
+        double a1 = (3.0 - p - 2.0 * d) / r2;
+        double a0 = (d - 1.0) / r3;
+        bool cubic = (std::abs(a0) < 1.0) & (1.0 + a2 + a1 + a0 > 0.0) & (1.0 - a2 + a1 - a0 > 0.0) &
+                     (1.0 - a0 * a0 > std::abs(a0 * a2 - a1));
+        double b1 = (-2.0 + p + d) / radius;
+        double b0 = (1.0 - d) / r2;
+        bool quadratic = (std::abs(b0) < 1.0) & (1.0 + b1 + b0 > 0.0) & (1.0 - b1 + b0 > 0.0);
+        keep[i] = ki[i] == 0.0 ? quadratic : cubic;
+    }
+}
+
+void screen_gains(const double* kp, const double* ki, const double* kd, std::size_t count, double dt, double radius,
+                  uint8_t* keep) {
+    std::size_t vectorized = 0;
+#if defined(__x86_64__) || defined(_M_X64)
+    if (cpu_has_avx2()) {
+        vectorized = count / 4 * 4;
+        screen_lanes_avx2(kp, ki, kd, 0, vectorized, dt, radius, keep);
+    }
+#endif
+    screen_lanes_scalar(kp, ki, kd, vectorized, count, dt, radius, keep);
+}
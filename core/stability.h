@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Analytic stability screen for sweep candidates, no simulation involved.
+//
+// Around the setpoint the loop is linear: a double integrator stepped by
+// semi-implicit Euler under the discrete PID, gravity only shifting the
+// equilibrium. Its closed-loop characteristic polynomial is
+//
+//   P(z) = (z-1)^3 + Kd dt (z-1)^2 + Kp dt^2 z (z-1) + Ki dt^3 z^2
+//
+// and with Ki = 0 the integrator pole at z = 1 drops out, leaving
+// (z-1)^2 + Kd dt (z-1) + Kp dt^2 z. The Jury test on P(r z) then says
+// whether every pole lies inside radius r without finding any root. The
+// wall bounce and the integral clamp are left out, so the screen only
+// rejects candidates the linear model already condemns.
+struct StabilityScreen {
+    bool enabled = false;
+    // Also reject candidates whose slowest mode decays slower than
+    // e^(-t / max_time_constant), which covers lightly damped oscillation;
+    // 0 = reject only the unstable ones
+    double max_time_constant = 0.0;
+
+    // Pole radius a kept candidate stays strictly inside
+    double radius(double dt) const { return max_time_constant > 0.0 ? std::exp(-dt / max_time_constant) : 1.0; }
+};
+
+// keep[i] = 1 when candidate (kp[i], ki[i], kd[i]) has all its poles inside
+// `radius`, else 0. Four candidates at a time with AVX2 when the CPU has it;
+// the result does not depend on the kernel.
+void screen_gains(const double* kp, const double* ki, const double* kd, std::size_t count, double dt, double radius,
+                  uint8_t* keep);
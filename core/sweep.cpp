@@ -0,0 +1,384 @@
+#include "sweep.h"
+#include "ball.h"
+#include "batch_engine.h"
+#include "exporter.h"
+#include "integrator.h"
+#include "result_cache.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+void SweepResult::gains(std::size_t cell, double& kp, double& ki, double& kd) const {
+    std::size_t k = cell % config.kd.count;
+    std::size_t j = cell / config.kd.count % config.ki.count;
+    std::size_t i = cell / (config.kd.count * config.ki.count);
+    kp = config.kp.at(i);
+    ki = config.ki.at(j);
+    kd = config.kd.at(k);
+}
+
+std::size_t SweepResult::best() const {
+    return static_cast<std::size_t>(std::min_element(cost.begin(), cost.end()) - cost.begin());
+}
+
+namespace {
+
+// evaluate_metrics(), calling observe(step) after each step
+template <class Observe>
+void evaluate_metrics_observed(BatchEngine& engine, std::size_t begin, std::size_t end, uint64_t steps, double dt,
+                               LoopMetrics* out, Observe observe) {
+    constexpr double PV_OFFSET = BALL_SIZE / 2;
+    MetricsAccumulator acc[BatchEngine::BLOCK_LANES];
+    double last_error[BatchEngine::BLOCK_LANES];
+    const double* y = engine.y.data();
+    const double* sp = engine.setpoint.data();
+    const double* err = engine.prev_error.data();
+    const double* integral = engine.integral.data();
+    for (std::size_t i = begin; i < end; ++i) acc[i - begin].begin(y[i] + PV_OFFSET, sp[i]);
+    for (uint64_t s = 0; s < steps; ++s) {
+        std::copy(err + begin, err + end, last_error);
+        engine.step_range(begin, end, dt);
+        for (std::size_t i = begin; i < end; ++i) {
+            // Positional lanes don't keep their force; rebuild it as the
+            // kernel computed it. Velocity lanes hold it in integral[]
+            double force = integral[i];
+            if (engine.form() == PidForm::Positional) {
+                double derivative = (err[i] - last_error[i - begin]) / dt;
+                force = engine.kp[i] * err[i] + engine.ki[i] * integral[i] + engine.kd[i] * derivative;
+            }
+            force = engine.compensated(i, force);
+            acc[i - begin].update(y[i] + PV_OFFSET, sp[i], force, dt);
+        }
+        observe(s + 1);
+    }
+    for (std::size_t i = begin; i < end; ++i) out[i - begin] = acc[i - begin].metrics();
+}
+
+} // namespace
+
+void evaluate_metrics(BatchEngine& engine, std::size_t begin, std::size_t end,
+                      uint64_t steps, double dt, LoopMetrics* out) {
+    evaluate_metrics_observed(engine, begin, end, steps, dt, out, [](uint64_t) {});
+}
+
+RunKey sweep_key(const SweepConfig& config, double kp, double ki, double kd) {
+    Ball initial;
+    RunKey key;
+    key.kp = kp;
+    key.ki = ki;
+    key.kd = kd;
+    key.setpoint = config.setpoint;
+    key.y0 = initial.y;
+    key.v0 = initial.velocity;
+    key.dt = config.dt;
+    key.steps = config.steps;
+    key.integrator = static_cast<uint64_t>(Integrator::SemiImplicitEuler) | static_cast<uint64_t>(config.form) << 8;
+    key.full_metrics = config.metrics;
+    return key;
+}
+
+namespace {
+
+void export_cell(Exporter& out, unsigned producer, const SweepResult& grid, std::size_t cell, double cost,
+                 const LoopMetrics* m) {
+    ExportRow row{};
+    row[0] = static_cast<double>(cell);
+    grid.gains(cell, row[1], row[2], row[3]);
+    row[4] = cost;
+    if (m) {
+        row[5] = m->ise;
+        row[6] = m->itae;
+        row[7] = m->effort;
+        row[8] = m->overshoot;
+        row[9] = m->rise_time;
+        row[10] = m->settling_time;
+    }
+    out.write(producer, row);
+}
+
+// IAE of lanes [begin, end) under config.early. Active lanes are kept at
+// the front of the block and the kernel only runs over them, rounded up to
+// LANE_PAD. The criteria are sampled every CHECK_STEPS steps, so the
+// per-step work stays the plain IAE sum; a stopped lane swaps places with
+// the last active one, along with its counters and the cost slot it
+// reports to. Its remaining IAE is its last error held to the end, which
+// also covers a loop settled onto a standing offset.
+void evaluate_block_early(BatchEngine& engine, std::size_t begin, std::size_t end, std::size_t lanes,
+                          const SweepConfig& config, double* cost, EarlyStopStats& stats) {
+    constexpr double PV_OFFSET = BALL_SIZE / 2;
+    constexpr double Y_MAX = WINDOW_HEIGHT - BALL_SIZE;
+    constexpr std::size_t N = BatchEngine::BLOCK_LANES;
+    constexpr uint64_t CHECK_STEPS = 8;
+    const EarlyStop& rule = config.early;
+    // In samples; a criterion that is off never triggers
+    const uint64_t never = UINT64_MAX;
+    auto samples = [&](double seconds) {
+        return seconds > 0.0 ? std::max<uint64_t>(1, static_cast<uint64_t>(seconds / (config.dt * CHECK_STEPS))) : never;
+    };
+    const uint64_t settle_samples = rule.settle_band > 0.0 ? samples(rule.settle_time) : never;
+    const uint64_t saturate_samples = samples(rule.saturate_time);
+    const uint64_t wall_samples = rule.wall_steps > 0 ? std::max<uint64_t>(1, rule.wall_steps / CHECK_STEPS) : never;
+
+    double iae[N] = {};
+    uint64_t in_band[N] = {}, pinned[N] = {}, at_wall[N] = {};
+    std::size_t owner[N];
+    std::size_t active = std::min(end, lanes) > begin ? std::min(end, lanes) - begin : 0;
+    for (std::size_t i = 0; i < active; ++i) owner[i] = begin + i;
+
+    double* y = engine.y.data() + begin;
+    const double* sp = engine.setpoint.data() + begin;
+    const double* integral = engine.integral.data() + begin;
+    auto move_lane = [&](std::size_t from, std::size_t to) {
+        for (auto* a : {&engine.kp, &engine.ki, &engine.kd, &engine.setpoint, &engine.integral, &engine.prev_error,
+                        &engine.y, &engine.velocity}) {
+            (*a)[begin + to] = (*a)[begin + from];
+        }
+        iae[to] = iae[from];
+        in_band[to] = in_band[from];
+        pinned[to] = pinned[from];
+        at_wall[to] = at_wall[from];
+        owner[to] = owner[from];
+    };
+
+    for (uint64_t s = 0; s < config.steps && active > 0; ++s) {
+        std::size_t stepped = (active + BatchEngine::LANE_PAD - 1) / BatchEngine::LANE_PAD * BatchEngine::LANE_PAD;
+        engine.step_range(begin, begin + stepped, config.dt);
+        stats.lane_steps += active;
+        for (std::size_t i = 0; i < active; ++i) iae[i] += std::abs(sp[i] - (y[i] + PV_OFFSET)) * config.dt;
+        if ((s + 1) % CHECK_STEPS != 0 || s + 1 == config.steps) continue;
+
+        const double remaining = static_cast<double>(config.steps - s - 1) * config.dt;
+        for (std::size_t i = 0; i < active;) {
+            double tail = std::abs(sp[i] - (y[i] + PV_OFFSET));
+            in_band[i] = tail <= rule.settle_band ? in_band[i] + 1 : 0;
+            pinned[i] = std::abs(integral[i]) >= INTEGRAL_LIMIT ? pinned[i] + 1 : 0;
+            at_wall[i] += y[i] <= 0.0 || y[i] >= Y_MAX;
+            if (in_band[i] >= settle_samples) {
+                ++stats.settled;
+            } else if (pinned[i] >= saturate_samples) {
+                ++stats.saturated;
+            } else if (at_wall[i] >= wall_samples) {
+                ++stats.diverged;
+            } else {
+                ++i;
+                continue;
+            }
+            cost[owner[i] - begin] = iae[i] + tail * remaining;
+            if (i != --active) move_lane(active, i);
+        }
+    }
+    for (std::size_t i = 0; i < active; ++i) cost[owner[i] - begin] = iae[i];
+}
+
+// Runs the cells cell_at(0 .. lanes-1), one engine lane each, and writes
+// lane i's cost to cost[i] and (with config.metrics) its metrics to metrics[i]. With config.exporter
+// each block also streams its cells, and with config.trajectories their
+// steps, from the participant that ran it.
+template <class CellAt>
+void evaluate_cells(ThreadPool& pool, const SweepConfig& config, std::size_t lanes, CellAt cell_at,
+                    double* cost, LoopMetrics* metrics, EarlyStopStats* early = nullptr) {
+    if (lanes == 0) return;
+    SweepResult grid;  // only for the gains helper
+    grid.config = config;
+    // Each block's state is written first, and so placed, by the participant
+    // that steps it below: the same count and grain deal the same chunks
+    BatchEngine engine(lanes, pool);
+    if (config.form != PidForm::Positional) engine.set_form(config.form);
+    if (config.feed_forward != 0.0) engine.set_compensation({config.feed_forward});
+    std::size_t padded_lanes = (lanes + BatchEngine::LANE_PAD - 1) / BatchEngine::LANE_PAD * BatchEngine::LANE_PAD;
+    pool.parallel_for(padded_lanes, BatchEngine::BLOCK_LANES, [&](std::size_t begin, std::size_t end, unsigned) {
+        for (std::size_t lane = begin; lane < std::min(end, lanes); ++lane) {
+            double kp, ki, kd;
+            grid.gains(cell_at(lane), kp, ki, kd);
+            engine.set_gains(lane, kp, ki, kd);
+            engine.set_setpoint(lane, config.setpoint);
+        }
+    });
+
+    constexpr double PV_OFFSET = BALL_SIZE / 2;
+    // A trajectory row per lane of the block after `step`; the participant
+    // waits here only once its ring to the export writer is full
+    auto export_step = [&](unsigned p, std::size_t begin, std::size_t end, uint64_t step) {
+        if (!config.trajectories || step % config.trajectory_every) return;
+        ExportRow row{};
+        row[1] = static_cast<double>(step);
+        row[2] = static_cast<double>(step) * config.dt;
+        for (std::size_t i = begin; i < std::min(end, lanes); ++i) {
+            row[0] = static_cast<double>(cell_at(i));
+            row[3] = engine.y[i] + PV_OFFSET;
+            row[4] = engine.velocity[i];
+            config.trajectories->write(p, row);
+        }
+    };
+    if (config.metrics) {
+        pool.parallel_for(padded_lanes, BatchEngine::BLOCK_LANES, [&](std::size_t begin, std::size_t end, unsigned p) {
+            LoopMetrics block[BatchEngine::BLOCK_LANES];
+            evaluate_metrics_observed(engine, begin, end, config.steps, config.dt, block,
+                                      [&](uint64_t step) { export_step(p, begin, end, step); });
+            std::size_t last = std::min(end, lanes);
+            for (std::size_t i = begin; i < last; ++i) {
+                metrics[i] = block[i - begin];
+                cost[i] = block[i - begin].iae;
+                if (config.exporter) export_cell(*config.exporter, p, grid, cell_at(i), cost[i], &metrics[i]);
+            }
+        });
+    } else if (config.early.any()) {
+        std::vector<EarlyStopStats> per_block((padded_lanes + BatchEngine::BLOCK_LANES - 1) / BatchEngine::BLOCK_LANES);
+        pool.parallel_for(padded_lanes, BatchEngine::BLOCK_LANES, [&](std::size_t begin, std::size_t end, unsigned p) {
+            double block[BatchEngine::BLOCK_LANES];
+            evaluate_block_early(engine, begin, end, lanes, config, block, per_block[begin / BatchEngine::BLOCK_LANES]);
+            std::size_t last = std::min(end, lanes);
+            for (std::size_t i = begin; i < last; ++i) {
+                cost[i] = block[i - begin];
+                if (config.exporter) export_cell(*config.exporter, p, grid, cell_at(i), cost[i], nullptr);
+            }
+        });
+        if (early) {
+            for (const EarlyStopStats& b : per_block) {
+                early->settled += b.settled;
+                early->saturated += b.saturated;
+                early->diverged += b.diverged;
+                early->lane_steps += b.lane_steps;
+            }
+        }
+    } else {
+        pool.parallel_for(padded_lanes, BatchEngine::BLOCK_LANES, [&](std::size_t begin, std::size_t end, unsigned p) {
+            // Per-block accumulator stays in L1 alongside the block's state
+            double iae[BatchEngine::BLOCK_LANES] = {};
+            const double* y = engine.y.data();
+            const double* sp = engine.setpoint.data();
+            for (uint64_t s = 0; s < config.steps; ++s) {
+                engine.step_range(begin, end, config.dt);
+                for (std::size_t i = begin; i < end; ++i) {
+                    iae[i - begin] += std::abs(sp[i] - (y[i] + PV_OFFSET)) * config.dt;
+                }
+                export_step(p, begin, end, s + 1);
+            }
+            std::size_t last = std::min(end, lanes);
+            for (std::size_t i = begin; i < last; ++i) {
+                cost[i] = iae[i - begin];
+                if (config.exporter) export_cell(*config.exporter, p, grid, cell_at(i), cost[i], nullptr);
+            }
+        });
+    }
+}
+
+// keep[cell] of config.screen over the whole grid, in one vector pass
+std::vector<uint8_t> screen_cells(const SweepResult& grid) {
+    const SweepConfig& config = grid.config;
+    const std::size_t cells = grid.cells();
+    std::vector<double> gains(cells * 3);
+    double* kp = gains.data();
+    double* ki = kp + cells;
+    double* kd = ki + cells;
+    for (std::size_t cell = 0; cell < cells; ++cell) grid.gains(cell, kp[cell], ki[cell], kd[cell]);
+    std::vector<uint8_t> keep(cells);
+    screen_gains(kp, ki, kd, cells, config.dt, config.screen.radius(config.dt), keep.data());
+    return keep;
+}
+
+} // namespace
+
+SweepResult run_sweep(ThreadPool& pool, const SweepConfig& config) {
+    if (config.early.any() && (config.metrics || config.cache)) {
+        throw std::invalid_argument("early stopping applies to IAE sweeps without metrics or a cache");
+    }
+    if (config.early.any() && config.form != PidForm::Positional) {
+        throw std::invalid_argument("early stopping applies to positional-form sweeps");
+    }
+    if (config.trajectories && config.early.any()) throw std::invalid_argument("trajectory export takes no early stopping");
+    if (config.trajectories && config.trajectory_every == 0) throw std::invalid_argument("trajectory_every must be positive");
+    if (config.cache && config.feed_forward != 0.0) throw std::invalid_argument("the sweep cache takes no feed-forward");
+    SweepResult result;
+    result.config = config;
+    std::size_t cells = config.kp.count * config.ki.count * config.kd.count;
+    result.cost.assign(cells, 0.0);
+    if (config.metrics) result.metrics.resize(cells);
+    std::vector<uint8_t> keep;
+    if (config.screen.enabled) keep = screen_cells(result);
+
+    // Lane -> cell; with a cache only the misses get a lane, and with the
+    // screen only the cells it keeps
+    std::vector<std::size_t> todo;
+    todo.reserve(cells);
+    for (std::size_t cell = 0; cell < cells; ++cell) {
+        if (!keep.empty() && !keep[cell]) {
+            result.cost[cell] = INFINITY;
+            if (config.metrics) result.metrics[cell].iae = INFINITY;
+            ++result.screened;
+            continue;
+        }
+        LoopMetrics hit;
+        if (config.cache) {
+            double kp, ki, kd;
+            result.gains(cell, kp, ki, kd);
+            if (config.cache->lookup(sweep_key(config, kp, ki, kd), hit)) {
+                result.cost[cell] = hit.iae;
+                if (config.metrics) result.metrics[cell] = hit;
+                ++result.cached;
+                continue;
+            }
+        }
+        todo.push_back(cell);
+    }
+    if (todo.size() == cells) {
+        // Nothing cached: lanes map 1:1 onto cells, results land in place
+        evaluate_cells(pool, config, cells, [](std::size_t lane) { return lane; }, result.cost.data(),
+                       config.metrics ? result.metrics.data() : nullptr, &result.early);
+    } else {
+        // Cached cells never reach a lane; stream them from this thread while the pool is idle
+        if (config.exporter) {
+            for (std::size_t cell = 0, next = 0; cell < cells; ++cell) {
+                if (next < todo.size() && todo[next] == cell) {
+                    ++next;
+                    continue;
+                }
+                export_cell(*config.exporter, 0, result, cell, result.cost[cell],
+                            config.metrics ? &result.metrics[cell] : nullptr);
+            }
+        }
+        std::vector<double> cost(todo.size());
+        std::vector<LoopMetrics> metrics(config.metrics ? todo.size() : 0);
+        evaluate_cells(pool, config, todo.size(), [&](std::size_t lane) { return todo[lane]; }, cost.data(),
+                       metrics.data(), &result.early);
+        for (std::size_t lane = 0; lane < todo.size(); ++lane) {
+            result.cost[todo[lane]] = cost[lane];
+            if (config.metrics) result.metrics[todo[lane]] = metrics[lane];
+        }
+    }
+
+    if (config.cache) {
+        for (std::size_t cell : todo) {
+            double kp, ki, kd;
+            result.gains(cell, kp, ki, kd);
+            LoopMetrics stored;
+            if (config.metrics) stored = result.metrics[cell];
+            else stored.iae = result.cost[cell];
+            config.cache->store(sweep_key(config, kp, ki, kd), stored);
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> sweep_export_columns(bool metrics) {
+    std::vector<std::string> columns{"cell", "kp", "ki", "kd", "iae"};
+    if (metrics) columns.insert(columns.end(), {"ise", "itae", "effort", "overshoot", "rise_time", "settling_time"});
+    return columns;
+}
+
+std::vector<std::string> sweep_trajectory_columns() {
+    return {"cell", "step", "time", "pv", "velocity"};
+}
+
+void export_sweep(const SweepResult& result, Exporter& out) {
+    for (std::size_t cell = 0; cell < result.cells(); ++cell) {
+        export_cell(out, 0, result, cell, result.cost[cell], result.metrics.empty() ? nullptr : &result.metrics[cell]);
+    }
+}
+
+void run_sweep_range(ThreadPool& pool, const SweepConfig& config, std::size_t first, std::size_t count,
+                     double* cost, LoopMetrics* metrics) {
+    evaluate_cells(pool, config, count, [first](std::size_t lane) { return first + lane; }, cost, metrics);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "constants.h"
+#include "loop_metrics.h"
+#include "pid_controller.h"
+#include "stability.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class BatchEngine;
+class Exporter;
+class ResultCache;
+class ThreadPool;
+
+// `count` evenly spaced values from min to max inclusive
+struct GainRange {
+    double min = 0.0;
+    double max = 0.0;
+    std::size_t count = 1;
+
+    double at(std::size_t i) const {
+        return count > 1 ? min + (max - min) * static_cast<double>(i) / (count - 1) : min;
+    }
+};
+
+// Per-lane termination for IAE sweeps. A lane stops once its outcome is
+// clear and its remaining IAE is extrapolated from its final error held
+// for the rest of the run, so costs become estimates; stopped lanes are
+// compacted out of the block so they no longer take SIMD slots. Each
+// criterion is off at 0.
+struct EarlyStop {
+    double settle_band = 0.0;    // px: stop after |error| stays within it for settle_time
+    double settle_time = 1.0;    // s
+    double saturate_time = 0.0;  // s with the integral pinned at +-INTEGRAL_LIMIT
+    unsigned wall_steps = 0;     // steps ending against a wall before a lane counts as diverged
+
+    bool any() const { return settle_band > 0.0 || saturate_time > 0.0 || wall_steps > 0; }
+};
+
+struct EarlyStopStats {
+    uint64_t settled = 0, saturated = 0, diverged = 0;
+    uint64_t lane_steps = 0;  // actually stepped
+};
+
+struct SweepConfig {
+    GainRange kp{80.0, 80.0, 1};
+    GainRange ki{0.0, 0.0, 1};
+    GainRange kd{0.0, 0.0, 1};
+    double setpoint = WINDOW_HEIGHT / 2.0;
+    uint64_t steps = 600;
+    double dt = FIXED_TIMESTEP;
+    // Also reduce the full LoopMetrics per candidate (slower than IAE alone)
+    bool metrics = false;
+    // Optional: cells found here are not re-run, and new results are added
+    ResultCache* cache = nullptr;
+    // Optional: every cell is also streamed here as a sweep_export_columns()
+    // row, one producer per pool participant (the exporter needs pool.size())
+    Exporter* exporter = nullptr;
+    // IAE sweeps only (no metrics), and without the cache: stopped lanes'
+    // costs are estimates the cache must not keep
+    EarlyStop early;
+    // Cells it rejects are never simulated and cost +infinity; run_sweep()
+    // only, run_sweep_range() ignores it
+    StabilityScreen screen;
+    // Controller form of every lane; velocity sweeps take no early stopping
+    PidForm form = PidForm::Positional;
+    // Constant added to every lane's output (BatchEngine::set_compensation);
+    // takes no cache, whose keys have no room for it
+    double feed_forward = 0.0;
+    // Optional: the trajectory of every simulated cell is streamed here as
+    // sweep_trajectory_columns() rows, every trajectory_every steps, from
+    // the participant stepping it (one producer per pool participant).
+    // Takes no early stopping; cells the cache or the screen settle are
+    // never stepped and have none
+    Exporter* trajectories = nullptr;
+    uint64_t trajectory_every = 1;
+};
+
+// Cost per grid cell, stored kp-major: index = (i * ki.count + j) * kd.count + k
+struct SweepResult {
+    SweepConfig config;
+    std::vector<double> cost;
+    std::vector<LoopMetrics> metrics;  // per cell, only with config.metrics
+    std::size_t cached = 0;            // cells served by config.cache
+    std::size_t screened = 0;          // cells rejected by config.screen
+    EarlyStopStats early;              // with config.early
+
+    std::size_t cells() const { return cost.size(); }
+    std::size_t index(std::size_t i, std::size_t j, std::size_t k) const {
+        return (i * config.ki.count + j) * config.kd.count + k;
+    }
+    void gains(std::size_t cell, double& kp, double& ki, double& kd) const;
+    std::size_t best() const;
+};
+
+// Runs every Kp x Ki x Kd combination from App's initial state through the
+// batched engine across the pool. The cost is the integrated absolute
+// error (IAE) over the run. Each lane block writes its own result slots.
+SweepResult run_sweep(ThreadPool& pool, const SweepConfig& config);
+
+// Runs only cells [first, first + count) of the grid, without the cache:
+// cost[i] (and metrics[i], with config.metrics) receive cell first + i.
+// Distributed sweeps hand these ranges to worker nodes.
+void run_sweep_range(ThreadPool& pool, const SweepConfig& config, std::size_t first, std::size_t count,
+                     double* cost, LoopMetrics* metrics);
+
+// cell, kp, ki, kd, iae, and with `metrics` the rest of LoopMetrics
+std::vector<std::string> sweep_export_columns(bool metrics);
+
+// cell, step, time, pv, velocity
+std::vector<std::string> sweep_trajectory_columns();
+
+// Writes every cell of a finished sweep to `out` from the calling thread,
+// as producer 0; for results assembled elsewhere, such as a cluster sweep
+void export_sweep(const SweepResult& result, Exporter& out);
+
+struct RunKey;
+// Cache key of one sweep cell
+RunKey sweep_key(const SweepConfig& config, double kp, double ki, double kd);
+
+// Steps lanes [begin, end) of `engine` `steps` times from their current state
+// and writes each lane's LoopMetrics to out[lane - begin]. The range follows
+// BatchEngine::step_range's alignment rule and spans at most BLOCK_LANES.
+void evaluate_metrics(BatchEngine& engine, std::size_t begin, std::size_t end,
+                      uint64_t steps, double dt, LoopMetrics* out);
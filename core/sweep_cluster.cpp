@@ -0,0 +1,465 @@
+#include "sweep_cluster.h"
+#include "determinism.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using steady = std::chrono::steady_clock;
+
+#ifdef _WIN32
+using socket_t = SOCKET;
+constexpr socket_t NO_SOCKET = INVALID_SOCKET;
+constexpr int SEND_FLAGS = 0;
+void close_socket(socket_t s) { closesocket(s); }
+int poll_sockets(pollfd* fds, std::size_t n, int ms) { return WSAPoll(fds, static_cast<ULONG>(n), ms); }
+#else
+using socket_t = int;
+constexpr socket_t NO_SOCKET = -1;
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;  // a vanished peer is an error return, not SIGPIPE
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+void close_socket(socket_t s) { ::close(s); }
+int poll_sockets(pollfd* fds, std::size_t n, int ms) { return ::poll(fds, static_cast<nfds_t>(n), ms); }
+#endif
+
+[[noreturn]] void fail(const std::string& what) {
+#ifdef _WIN32
+    throw std::runtime_error(what + " (error " + std::to_string(WSAGetLastError()) + ")");
+#else
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+#endif
+}
+
+void start_sockets() {
+#ifdef _WIN32
+    static const bool started = [] {
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) fail("WSAStartup");
+        return true;
+    }();
+    (void)started;
+#endif
+}
+
+class Socket {
+public:
+    explicit Socket(socket_t s = NO_SOCKET) : s(s) {}
+    ~Socket() { reset(); }
+    Socket(Socket&& other) noexcept : s(other.s) { other.s = NO_SOCKET; }
+    Socket& operator=(Socket&& other) noexcept {
+        if (this != &other) {
+            reset();
+            s = other.s;
+            other.s = NO_SOCKET;
+        }
+        return *this;
+    }
+
+    socket_t get() const { return s; }
+    explicit operator bool() const { return s != NO_SOCKET; }
+    void reset() {
+        if (s != NO_SOCKET) close_socket(s);
+        s = NO_SOCKET;
+    }
+
+private:
+    socket_t s;
+};
+
+// Small messages go out at once instead of waiting for Nagle coalescing
+void set_no_delay(socket_t s) {
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+}
+
+bool send_all(socket_t s, const void* data, std::size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        int chunk = static_cast<int>(std::min<std::size_t>(bytes, 1 << 20));
+        auto n = ::send(s, p, chunk, SEND_FLAGS);
+        if (n <= 0) return false;
+        p += n;
+        bytes -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// False on end of stream or error
+bool recv_all(socket_t s, void* data, std::size_t bytes) {
+    char* p = static_cast<char*>(data);
+    while (bytes > 0) {
+        int chunk = static_cast<int>(std::min<std::size_t>(bytes, 1 << 20));
+        auto n = ::recv(s, p, chunk, 0);
+        if (n <= 0) return false;
+        p += n;
+        bytes -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool send_message(socket_t s, ClusterMessage type, const void* head = nullptr, std::size_t head_bytes = 0,
+                  const void* body = nullptr, std::size_t body_bytes = 0) {
+    ClusterMessageHeader h{};
+    std::memcpy(h.magic, CLUSTER_MAGIC, sizeof(h.magic));
+    h.version = CLUSTER_VERSION;
+    h.type = static_cast<uint16_t>(type);
+    h.bytes = static_cast<uint32_t>(head_bytes + body_bytes);
+    return send_all(s, &h, sizeof(h)) && (!head_bytes || send_all(s, head, head_bytes)) &&
+           (!body_bytes || send_all(s, body, body_bytes));
+}
+
+bool valid_header(const ClusterMessageHeader& h) {
+    return std::memcmp(h.magic, CLUSTER_MAGIC, sizeof(h.magic)) == 0 && h.version == CLUSTER_VERSION;
+}
+
+std::size_t cell_count(const SweepConfig& config) {
+    return config.kp.count * config.ki.count * config.kd.count;
+}
+
+std::size_t record_bytes(bool metrics) {
+    return metrics ? sizeof(LoopMetrics) : sizeof(double);
+}
+
+ClusterJob job_of(const SweepConfig& config, std::size_t chunk, std::size_t first, std::size_t count) {
+    ClusterJob job{};
+    job.chunk = chunk;
+    job.first = first;
+    job.count = count;
+    job.kp_min = config.kp.min;
+    job.kp_max = config.kp.max;
+    job.kp_count = config.kp.count;
+    job.ki_min = config.ki.min;
+    job.ki_max = config.ki.max;
+    job.ki_count = config.ki.count;
+    job.kd_min = config.kd.min;
+    job.kd_max = config.kd.max;
+    job.kd_count = config.kd.count;
+    job.setpoint = config.setpoint;
+    job.dt = config.dt;
+    job.steps = config.steps;
+    job.metrics = config.metrics;
+    return job;
+}
+
+SweepConfig config_of(const ClusterJob& job) {
+    SweepConfig config;
+    config.kp = {job.kp_min, job.kp_max, static_cast<std::size_t>(job.kp_count)};
+    config.ki = {job.ki_min, job.ki_max, static_cast<std::size_t>(job.ki_count)};
+    config.kd = {job.kd_min, job.kd_max, static_cast<std::size_t>(job.kd_count)};
+    config.setpoint = job.setpoint;
+    config.dt = job.dt;
+    config.steps = job.steps;
+    config.metrics = job.metrics != 0;
+    if (!config.kp.count || !config.ki.count || !config.kd.count || !(config.dt > 0) ||
+        job.first + job.count > cell_count(config)) {
+        throw std::runtime_error("malformed job from the coordinator");
+    }
+    return config;
+}
+
+Socket listen_on(uint16_t port) {
+    Socket s(::socket(AF_INET, SOCK_STREAM, 0));
+    if (!s) fail("socket");
+    int one = 1;
+    setsockopt(s.get(), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (::bind(s.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        fail("cannot listen on port " + std::to_string(port));
+    }
+    if (::listen(s.get(), 64) != 0) fail("listen");
+    return s;
+}
+
+Socket connect_to(const std::string& coordinator, std::chrono::seconds wait) {
+    std::size_t colon = coordinator.rfind(':');
+    if (colon == std::string::npos || colon + 1 == coordinator.size()) {
+        throw std::invalid_argument("expected HOST:PORT, got " + coordinator);
+    }
+    std::string host = coordinator.substr(0, colon);
+    std::string port = coordinator.substr(colon + 1);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    auto deadline = steady::now() + wait;
+    while (true) {
+        addrinfo* found = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) == 0) {
+            for (addrinfo* a = found; a; a = a->ai_next) {
+                Socket s(::socket(a->ai_family, a->ai_socktype, a->ai_protocol));
+                if (s && ::connect(s.get(), a->ai_addr, static_cast<int>(a->ai_addrlen)) == 0) {
+                    freeaddrinfo(found);
+                    return s;
+                }
+            }
+            freeaddrinfo(found);
+        }
+        // The coordinator may not be up yet when a batch of workers starts
+        if (steady::now() >= deadline) fail("cannot connect to " + coordinator);
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+}
+
+struct Chunk {
+    std::size_t first = 0;
+    std::size_t count = 0;
+    int running = 0;  // workers currently holding it
+    bool done = false;
+    steady::time_point issued{};  // when the oldest running copy went out
+};
+
+struct Connection {
+    Socket socket;
+    std::vector<char> inbox;
+    bool ready = false;      // sent its Hello
+    bool dead = false;
+    std::ptrdiff_t chunk = -1;  // in flight, -1 = idle
+    steady::time_point started{};
+};
+
+} // namespace
+
+SweepResult run_cluster_sweep(const SweepConfig& config, const ClusterOptions& options, ClusterStats* stats) {
+    start_sockets();
+    SweepResult result;
+    result.config = config;
+    result.config.cache = nullptr;
+    const std::size_t cells = cell_count(config);
+    result.cost.assign(cells, 0.0);
+    if (config.metrics) result.metrics.resize(cells);
+
+    const std::size_t chunk_cells = std::max<std::size_t>(options.chunk_cells, 1);
+    std::vector<Chunk> chunks;
+    std::deque<std::size_t> pending;
+    for (std::size_t first = 0; first < cells; first += chunk_cells) {
+        pending.push_back(chunks.size());
+        chunks.push_back({first, std::min(chunk_cells, cells - first)});
+    }
+    ClusterStats local;
+    ClusterStats& st = stats ? *stats : local;
+    st = ClusterStats{};
+    st.chunks = chunks.size();
+
+    const std::size_t max_payload = sizeof(ClusterResultHeader) + chunk_cells * record_bytes(config.metrics);
+    Socket listener = listen_on(options.port);
+    std::vector<Connection> workers;
+    std::size_t completed = 0;
+    steady::duration busy_time{0};  // summed over completed chunks
+    std::size_t timed_chunks = 0;
+
+    auto drop = [&](Connection& c) {
+        c.dead = true;
+        c.socket.reset();
+        if (c.chunk < 0) return;
+        Chunk& ch = chunks[static_cast<std::size_t>(c.chunk)];
+        --ch.running;
+        ++st.lost_workers;
+        if (!ch.done && ch.running == 0) {
+            pending.push_front(static_cast<std::size_t>(c.chunk));
+            ++st.reissued;
+        }
+        c.chunk = -1;
+    };
+
+    auto issue = [&](Connection& c, std::size_t index) {
+        Chunk& ch = chunks[index];
+        ClusterJob job = job_of(config, index, ch.first, ch.count);
+        if (!send_message(c.socket.get(), ClusterMessage::Job, &job, sizeof(job))) {
+            drop(c);
+            if (ch.running == 0 && !ch.done) pending.push_front(index);
+            return;
+        }
+        auto now = steady::now();
+        if (ch.running++ == 0) ch.issued = now;
+        c.chunk = static_cast<std::ptrdiff_t>(index);
+        c.started = now;
+    };
+
+    // Consumes every complete message in c.inbox; false on a protocol error
+    auto handle = [&](Connection& c) {
+        std::size_t offset = 0;
+        while (c.inbox.size() - offset >= sizeof(ClusterMessageHeader)) {
+            ClusterMessageHeader h;
+            std::memcpy(&h, c.inbox.data() + offset, sizeof(h));
+            if (!valid_header(h) || h.bytes > max_payload) return false;
+            if (c.inbox.size() - offset < sizeof(h) + h.bytes) break;
+            const char* payload = c.inbox.data() + offset + sizeof(h);
+            offset += sizeof(h) + h.bytes;
+
+            auto type = static_cast<ClusterMessage>(h.type);
+            if (type == ClusterMessage::Hello && !c.ready) {
+                // Results from a build that rounds differently would not be bit-identical
+                ClusterHello hello;
+                if (h.bytes != sizeof(hello)) return false;
+                std::memcpy(&hello, payload, sizeof(hello));
+                if (hello.deterministic != (DETERMINISTIC_BUILD ? 1u : 0u)) return false;
+                c.ready = true;
+                ++st.workers;
+                continue;
+            }
+            if (type != ClusterMessage::Result || c.chunk < 0 || h.bytes < sizeof(ClusterResultHeader)) return false;
+            ClusterResultHeader r;
+            std::memcpy(&r, payload, sizeof(r));
+            Chunk& ch = chunks[static_cast<std::size_t>(c.chunk)];
+            if (r.chunk != static_cast<uint64_t>(c.chunk) || r.first != ch.first || r.count != ch.count ||
+                r.metrics != static_cast<uint64_t>(config.metrics) ||
+                h.bytes != sizeof(r) + ch.count * record_bytes(config.metrics)) {
+                return false;
+            }
+            const char* records = payload + sizeof(r);
+            --ch.running;
+            if (!ch.done) {
+                // First copy in wins; a straggler's duplicate is identical anyway
+                if (config.metrics) {
+                    std::memcpy(result.metrics.data() + ch.first, records, ch.count * sizeof(LoopMetrics));
+                    for (std::size_t i = ch.first; i < ch.first + ch.count; ++i) result.cost[i] = result.metrics[i].iae;
+                } else {
+                    std::memcpy(result.cost.data() + ch.first, records, ch.count * sizeof(double));
+                }
+                ch.done = true;
+                ++completed;
+                busy_time += steady::now() - c.started;
+                ++timed_chunks;
+            }
+            c.chunk = -1;
+        }
+        c.inbox.erase(c.inbox.begin(), c.inbox.begin() + static_cast<std::ptrdiff_t>(offset));
+        return true;
+    };
+
+    std::vector<pollfd> fds;
+    std::vector<char> buffer(1 << 16);
+    while (completed < chunks.size()) {
+        fds.assign(1, pollfd{listener.get(), POLLIN, 0});
+        for (Connection& c : workers) fds.push_back(pollfd{c.socket.get(), POLLIN, 0});
+        if (poll_sockets(fds.data(), fds.size(), 200) < 0) {
+#ifndef _WIN32
+            if (errno == EINTR) continue;
+#endif
+            fail("poll");
+        }
+
+        for (std::size_t i = 0; i < workers.size(); ++i) {
+            Connection& c = workers[i];
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            auto n = ::recv(c.socket.get(), buffer.data(), static_cast<int>(buffer.size()), 0);
+            if (n <= 0) {
+                drop(c);
+                continue;
+            }
+            c.inbox.insert(c.inbox.end(), buffer.data(), buffer.data() + n);
+            if (!handle(c)) drop(c);
+        }
+        if (fds[0].revents & POLLIN) {
+            Socket s(::accept(listener.get(), nullptr, nullptr));
+            if (s) {
+                set_no_delay(s.get());
+                workers.emplace_back();
+                workers.back().socket = std::move(s);
+            }
+        }
+
+        auto now = steady::now();
+        for (Connection& c : workers) {
+            if (!c.dead && c.chunk >= 0 && now - c.started > options.chunk_timeout) drop(c);
+        }
+        workers.erase(std::remove_if(workers.begin(), workers.end(), [](const Connection& c) { return c.dead; }),
+                      workers.end());
+
+        for (Connection& c : workers) {
+            if (!c.ready || c.chunk >= 0 || c.dead) continue;
+            if (!pending.empty()) {
+                std::size_t index = pending.front();
+                pending.pop_front();
+                issue(c, index);
+                continue;
+            }
+            if (timed_chunks == 0) break;
+            // Nothing queued: back up the oldest chunk that runs far longer than usual
+            auto slow = std::chrono::duration_cast<steady::duration>(busy_time * options.straggler_factor / timed_chunks);
+            std::ptrdiff_t straggler = -1;
+            for (std::size_t j = 0; j < chunks.size(); ++j) {
+                const Chunk& ch = chunks[j];
+                if (ch.done || ch.running != 1 || now - ch.issued <= slow) continue;
+                if (straggler < 0 || ch.issued < chunks[static_cast<std::size_t>(straggler)].issued) {
+                    straggler = static_cast<std::ptrdiff_t>(j);
+                }
+            }
+            if (straggler < 0) break;
+            issue(c, static_cast<std::size_t>(straggler));
+            ++st.speculative;
+        }
+    }
+
+    for (Connection& c : workers) {
+        if (c.socket) send_message(c.socket.get(), ClusterMessage::Done);
+    }
+    return result;
+}
+
+std::size_t run_cluster_worker(const std::string& coordinator, unsigned threads, std::chrono::seconds connect_wait) {
+    start_sockets();
+    Socket s = connect_to(coordinator, connect_wait);
+    set_no_delay(s.get());
+    ThreadPool pool(threads);
+    ClusterHello hello{pool.size(), DETERMINISTIC_BUILD ? 1u : 0u};
+    if (!send_message(s.get(), ClusterMessage::Hello, &hello, sizeof(hello))) fail("cannot reach " + coordinator);
+
+    std::vector<double> cost;
+    std::vector<LoopMetrics> metrics;
+    std::size_t done = 0;
+    while (true) {
+        ClusterMessageHeader h;
+        // A closed connection means the sweep finished (or the coordinator stopped)
+        if (!recv_all(s.get(), &h, sizeof(h))) break;
+        if (!valid_header(h)) throw std::runtime_error(coordinator + " is not a sweep coordinator of this version");
+        auto type = static_cast<ClusterMessage>(h.type);
+        if (type == ClusterMessage::Done) break;
+        ClusterJob job;
+        if (type != ClusterMessage::Job || h.bytes != sizeof(job)) {
+            throw std::runtime_error("unexpected message from " + coordinator);
+        }
+        if (!recv_all(s.get(), &job, sizeof(job))) break;
+
+        SweepConfig config = config_of(job);
+        const std::size_t count = static_cast<std::size_t>(job.count);
+        cost.resize(count);
+        metrics.resize(config.metrics ? count : 0);
+        run_sweep_range(pool, config, static_cast<std::size_t>(job.first), count, cost.data(), metrics.data());
+
+        ClusterResultHeader r{job.chunk, job.first, job.count, job.metrics};
+        const void* records = config.metrics ? static_cast<const void*>(metrics.data()) : cost.data();
+        if (!send_message(s.get(), ClusterMessage::Result, &r, sizeof(r), records, count * record_bytes(config.metrics))) {
+            break;
+        }
+        ++done;
+    }
+    return done;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "sweep.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Sweeps sharded across machines over TCP. The coordinator cuts the gain
+// grid into chunks of consecutive cells and hands one chunk at a time to
+// each connected worker; workers run them through the batched engine and
+// send back one compact binary record per cell (the IAE, or the full
+// LoopMetrics). A chunk whose worker disconnects or exceeds the timeout
+// goes back to the queue. Once the queue is empty, idle workers also get
+// copies of chunks that have run much longer than the average, and the first
+// result to arrive wins, so one slow node cannot hold up the whole sweep.
+// Results are bit-identical to run_sweep on one machine.
+//
+// Every message is a ClusterMessageHeader plus `bytes` of payload, all in
+// the sender's byte order (little-endian on every platform we build for).
+struct ClusterMessageHeader {
+    char magic[4];  // "PIDC"
+    uint16_t version;
+    uint16_t type;  // ClusterMessage
+    uint32_t bytes; // payload after this header
+};
+static_assert(sizeof(ClusterMessageHeader) == 12, "cluster header layout is part of the wire format");
+
+constexpr char CLUSTER_MAGIC[4] = {'P', 'I', 'D', 'C'};
+constexpr uint16_t CLUSTER_VERSION = 1;
+
+enum class ClusterMessage : uint16_t {
+    Hello = 1,   // worker -> coordinator: ClusterHello
+    Job = 2,     // coordinator -> worker: ClusterJob
+    Result = 3,  // worker -> coordinator: ClusterResultHeader, then `count` doubles or LoopMetrics
+    Done = 4,    // coordinator -> worker: no payload, disconnect
+};
+
+struct ClusterHello {
+    uint32_t threads;
+    uint32_t deterministic;  // 1 from a PID_DETERMINISTIC build; only like builds share a sweep
+};
+
+// One chunk: cells [first, first + count) of the grid described by the rest
+struct ClusterJob {
+    uint64_t chunk;
+    uint64_t first;
+    uint64_t count;
+    double kp_min, kp_max;
+    double ki_min, ki_max;
+    double kd_min, kd_max;
+    uint64_t kp_count, ki_count, kd_count;
+    double setpoint;
+    double dt;
+    uint64_t steps;
+    uint64_t metrics;  // 1: LoopMetrics records, 0: one IAE double per cell
+};
+static_assert(sizeof(ClusterJob) == 128, "job layout is part of the wire format");
+
+struct ClusterResultHeader {
+    uint64_t chunk;
+    uint64_t first;
+    uint64_t count;
+    uint64_t metrics;
+};
+static_assert(sizeof(LoopMetrics) == 64, "metrics records are sent as raw doubles");
+
+struct ClusterOptions {
+    uint16_t port = 7878;
+    std::size_t chunk_cells = 4096;
+    // A worker that takes longer than this on one chunk is dropped and its chunk reissued
+    std::chrono::seconds chunk_timeout{300};
+    // Idle workers duplicate chunks running longer than this many times the mean chunk time
+    double straggler_factor = 3.0;
+};
+
+struct ClusterStats {
+    std::size_t chunks = 0;
+    std::size_t workers = 0;      // that completed the handshake
+    std::size_t lost_workers = 0; // disconnected or timed out holding a chunk
+    std::size_t reissued = 0;     // chunks requeued after a lost worker
+    std::size_t speculative = 0;  // straggler chunks duplicated onto idle workers
+};
+
+// Listens on options.port and serves the sweep to workers until every cell
+// has a result; then tells all workers to disconnect. Blocks indefinitely
+// while no worker is connected. config.cache is not used.
+SweepResult run_cluster_sweep(const SweepConfig& config, const ClusterOptions& options, ClusterStats* stats = nullptr);
+
+// Connects to the coordinator at HOST:PORT (retrying for `connect_wait`, so
+// workers may start first) and runs chunks on a pool of `threads` until the
+// coordinator says Done or closes the connection. Returns the number of
+// chunks it completed; throws if it cannot connect or on a protocol error.
+std::size_t run_cluster_worker(const std::string& coordinator, unsigned threads = 0,
+                               std::chrono::seconds connect_wait = std::chrono::seconds(60));
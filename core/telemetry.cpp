@@ -0,0 +1,97 @@
+#include "telemetry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+TelemetryRecorder::TelemetryRecorder(const std::string& path, double dt)
+        : file(path, MappedFile::Write, GROW_BYTES),
+          queue(std::make_unique<SpscQueue<TelemetryRecord, RING_RECORDS>>()) {
+    TelemetryHeader header{};
+    std::memcpy(header.magic, TELEMETRY_MAGIC, sizeof(header.magic));
+    header.version = TELEMETRY_VERSION;
+    header.record_size = sizeof(TelemetryRecord);
+    header.dt = dt;
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    writer = std::thread(&TelemetryRecorder::writer_main, this);
+}
+
+TelemetryRecorder::~TelemetryRecorder() {
+    close();
+}
+
+std::size_t TelemetryRecorder::drain() {
+    std::size_t n = 0;
+    TelemetryRecord r;
+    while (queue->pop(r)) {
+        if (used + sizeof(r) > file.size()) file.resize(file.size() + GROW_BYTES);
+        std::memcpy(file.data() + used, &r, sizeof(r));
+        used += sizeof(r);
+        ++n;
+    }
+    if (n) {
+        uint64_t count = (used - sizeof(TelemetryHeader)) / sizeof(TelemetryRecord);
+        std::memcpy(file.data() + offsetof(TelemetryHeader, record_count), &count, sizeof(count));
+        written_count.store(count, std::memory_order_relaxed);
+    }
+    if (used - flushed >= FLUSH_BYTES) {
+        file.flush_async(flushed, used - flushed);
+        file.flush_async(0, sizeof(TelemetryHeader));
+        flushed = used;
+    }
+    return n;
+}
+
+void TelemetryRecorder::writer_main() {
+    while (!stopping.load(std::memory_order_acquire)) {
+        // The ring holds ~18 minutes at 60 Hz, so a short nap never overflows it
+        if (drain() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    drain();
+}
+
+void TelemetryRecorder::close() {
+    if (closed) return;
+    closed = true;
+    stopping.store(true, std::memory_order_release);
+    if (writer.joinable()) writer.join();
+    file.close(used);
+}
+
+TelemetryReader::TelemetryReader(const std::string& path)
+        : file(path, MappedFile::Read) {
+    TelemetryHeader header;
+    if (file.size() < sizeof(header)) throw std::runtime_error(path + ": not a telemetry log");
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, TELEMETRY_MAGIC, sizeof(header.magic)) != 0 ||
+        header.record_size != sizeof(TelemetryRecord)) {
+        throw std::runtime_error(path + ": not a telemetry log");
+    }
+    if (header.version != TELEMETRY_VERSION) {
+        throw std::runtime_error(path + ": unsupported telemetry version " + std::to_string(header.version));
+    }
+
+    // A log cut short by a crash still has a valid header count, but never
+    // trust it beyond what the file actually holds
+    uint64_t capacity = (file.size() - sizeof(header)) / sizeof(TelemetryRecord);
+    count = std::min(header.record_count, capacity);
+    dt = header.dt;
+    records = reinterpret_cast<const TelemetryRecord*>(file.data() + sizeof(header));
+
+    index.reserve(static_cast<std::size_t>(count / INDEX_STRIDE + 1));
+    for (uint64_t i = 0; i < count; i += INDEX_STRIDE) index.push_back(records[i].time);
+}
+
+uint64_t TelemetryReader::seek(double t) const {
+    if (count == 0 || t <= records[0].time) return 0;
+    // Last indexed block starting at or before t
+    auto block = std::upper_bound(index.begin(), index.end(), t) - index.begin() - 1;
+    uint64_t first = static_cast<uint64_t>(block) * INDEX_STRIDE;
+    uint64_t last = std::min(first + INDEX_STRIDE, count);
+    const TelemetryRecord* hit = std::upper_bound(records + first, records + last, t,
+            [](double time, const TelemetryRecord& r) { return time < r.time; });
+    return static_cast<uint64_t>(hit - records) - 1;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "simulation.h"
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One physics step, exactly one cache line
+struct TelemetryRecord {
+    double time;
+    double setpoint;
+    double pv;
+    double error;
+    double integral;
+    double derivative;
+    double output;
+    double velocity;
+};
+static_assert(sizeof(TelemetryRecord) == 64, "telemetry records are fixed-width");
+
+struct TelemetryHeader {
+    char magic[8];             // "PIDTLM1"
+    uint32_t version;
+    uint32_t record_size;
+    double dt;
+    uint64_t record_count;     // refreshed as the writer makes progress
+    uint8_t reserved[32];
+};
+static_assert(sizeof(TelemetryHeader) == 64, "telemetry header is one record wide");
+
+constexpr char TELEMETRY_MAGIC[8] = "PIDTLM1";
+constexpr uint32_t TELEMETRY_VERSION = 1;
+
+inline TelemetryRecord record_of(const Simulation& sim) {
+    return {sim.time, sim.setpoint, sim.measurement, sim.pid.last_error(),
+            sim.pid.integral_value(), sim.pid.last_derivative(), sim.output, sim.ball.velocity};
+}
+
+// Append-only binary log of physics steps. record() only pushes into a
+// lock-free ring; a background thread copies records into a memory-mapped
+// file, grows it in large chunks and schedules write-back with msync, so
+// the stepping thread never touches the file or waits on the disk.
+class TelemetryRecorder {
+public:
+    TelemetryRecorder(const std::string& path, double dt);
+    ~TelemetryRecorder();
+
+    TelemetryRecorder(const TelemetryRecorder&) = delete;
+    TelemetryRecorder& operator=(const TelemetryRecorder&) = delete;
+
+    // Stepping thread only. Returns false (and counts a drop) if the writer
+    // has fallen a whole ring behind.
+    bool record(const TelemetryRecord& r) {
+        if (queue->push(r)) return true;
+        dropped_count.store(dropped_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Drains outstanding records, finalizes the header and truncates the file
+    void close();
+
+    uint64_t written() const { return written_count.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_count.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t RING_RECORDS = 1 << 16;
+    static constexpr std::size_t GROW_BYTES = 64u << 20;
+    static constexpr std::size_t FLUSH_BYTES = 8u << 20;
+
+    void writer_main();
+    std::size_t drain();
+
+    MappedFile file;
+    std::unique_ptr<SpscQueue<TelemetryRecord, RING_RECORDS>> queue;
+    std::size_t used = sizeof(TelemetryHeader);
+    std::size_t flushed = sizeof(TelemetryHeader);
+    std::atomic<uint64_t> written_count{0};
+    std::atomic<uint64_t> dropped_count{0};
+    std::atomic<bool> stopping{false};
+    bool closed = false;
+    std::thread writer;
+};
+
+// Read-only view of a telemetry log. A sparse index holds the time of every
+// INDEX_STRIDE-th record, so seeking is a binary search over the index and
+// then over one stride of records: O(log n) without scanning the file.
+class TelemetryReader {
+public:
+    static constexpr uint64_t INDEX_STRIDE = 4096;
+
+    explicit TelemetryReader(const std::string& path);
+
+    uint64_t size() const { return count; }
+    double timestep() const { return dt; }
+    const TelemetryRecord& operator[](uint64_t i) const { return records[i]; }
+
+    double start_time() const { return count ? records[0].time : 0.0; }
+    double end_time() const { return count ? records[count - 1].time : 0.0; }
+
+    // Index of the last record with time <= t, clamped to the recording
+    uint64_t seek(double t) const;
+
+private:
+    MappedFile file;
+    const TelemetryRecord* records = nullptr;
+    uint64_t count = 0;
+    double dt = 0.0;
+    std::vector<double> index;
+};
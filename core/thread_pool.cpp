@@ -0,0 +1,159 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint64_t pack(uint32_t begin, uint32_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | end;
+}
+constexpr uint32_t range_begin(uint64_t r) { return static_cast<uint32_t>(r >> 32); }
+constexpr uint32_t range_end(uint64_t r) { return static_cast<uint32_t>(r); }
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    start_workers(threads);
+}
+
+ThreadPool::ThreadPool(const std::vector<int>& cpus) : cpus(cpus) {
+    if (cpus.empty()) throw std::invalid_argument("ThreadPool: no CPUs to pin to");
+    caller_affinity = std::make_unique<SavedAffinity>();
+    if (pin_thread(cpus[0])) pinned_count.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active = static_cast<unsigned>(cpus.size()) - 1;
+    }
+    start_workers(static_cast<unsigned>(cpus.size()));
+    // Each worker pins itself before it waits for a job; nothing may be
+    // first-touched on its behalf until it has moved
+    std::unique_lock<std::mutex> lock(mutex);
+    job_done.wait(lock, [&] { return active == 0; });
+}
+
+void ThreadPool::start_workers(unsigned threads) {
+    slot_storage = std::make_unique<Slot[]>(threads);
+    for (unsigned i = 0; i < threads; ++i) slots.push_back(&slot_storage[i]);
+
+    workers.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::worker_main, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    job_ready.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+void ThreadPool::worker_main(unsigned index) {
+    if (!cpus.empty()) {
+        if (pin_thread(cpus[index])) pinned_count.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--active == 0) job_done.notify_all();
+    }
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_ready.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        run_participant(index);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--active == 0) job_done.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::take_own(unsigned index, uint32_t& chunk) {
+    std::atomic<uint64_t>& range = slots[index]->range;
+    uint64_t r = range.load(std::memory_order_acquire);
+    while (range_begin(r) < range_end(r)) {
+        if (range.compare_exchange_weak(r, pack(range_begin(r) + 1, range_end(r)),
+                                        std::memory_order_acq_rel)) {
+            chunk = range_begin(r);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::steal(unsigned index, uint32_t& chunk) {
+    unsigned n = size();
+    for (unsigned k = 1; k < n; ++k) {
+        std::atomic<uint64_t>& victim = slots[(index + k) % n]->range;
+        uint64_t r = victim.load(std::memory_order_acquire);
+        while (range_begin(r) < range_end(r)) {
+            uint32_t b = range_begin(r), e = range_end(r);
+            uint32_t mid = b + (e - b) / 2;
+            if (victim.compare_exchange_weak(r, pack(b, mid), std::memory_order_acq_rel)) {
+                // Our slot is empty, so nobody can be racing on it: publish the rest of the loot
+                slots[index]->range.store(pack(mid + 1, e), std::memory_order_release);
+                chunk = mid;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run_participant(unsigned index) {
+    uint32_t chunk;
+    while (chunks_left.load(std::memory_order_acquire) > 0) {
+        if (take_own(index, chunk) || steal(index, chunk)) {
+            std::size_t begin = static_cast<std::size_t>(chunk) * job_grain;
+            std::size_t end = std::min(begin + job_grain, job_count);
+            (*job)(begin, end, index);
+            chunks_left.fetch_sub(1, std::memory_order_acq_rel);
+        } else {
+            std::this_thread::yield();  // the last chunks are in flight elsewhere
+        }
+    }
+}
+
+void ThreadPool::parallel_for(std::size_t count, std::size_t grain,
+                              const std::function<void(std::size_t, std::size_t, unsigned)>& fn) {
+    if (count == 0) return;
+    grain = std::max<std::size_t>(grain, 1);
+    std::size_t chunks = (count + grain - 1) / grain;
+    if (chunks > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("ThreadPool::parallel_for: too many chunks, raise the grain");
+    }
+
+    // Deal contiguous chunk ranges out evenly; stealing balances what's left
+    unsigned n = size();
+    for (unsigned i = 0; i < n; ++i) {
+        auto b = static_cast<uint32_t>(chunks * i / n);
+        auto e = static_cast<uint32_t>(chunks * (i + 1) / n);
+        slots[i]->range.store(pack(b, e), std::memory_order_relaxed);
+    }
+    job = &fn;
+    job_count = count;
+    job_grain = grain;
+    chunks_left.store(chunks, std::memory_order_release);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active = n - 1;
+        ++generation;
+    }
+    job_ready.notify_all();
+
+    run_participant(0);
+
+    // Wait for every worker to leave the loop, so no stale steal attempt can
+    // touch the slots once the next job reuses them
+    std::unique_lock<std::mutex> lock(mutex);
+    job_done.wait(lock, [&] { return active == 0; });
+    job = nullptr;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "aligned.h"
+#include "numa.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool for data-parallel loops. parallel_for splits the index
+// range into chunks; each participant drains its own chunk range and
+// steals half of a victim's remaining range once empty. Ranges live in
+// one atomic word per participant, so there is no shared queue lock.
+class ThreadPool {
+public:
+    // threads == 0 uses std::thread::hardware_concurrency(); the calling
+    // thread takes part in every loop, so `threads - 1` workers are spawned
+    explicit ThreadPool(unsigned threads = 0);
+    // Pins participant i to cpus[i] (cpus.size() participants), e.g. from
+    // NumaTopology::spread. The calling thread is participant 0 and stays
+    // pinned until the pool is destroyed; pinning that is refused is
+    // skipped. Returns once every worker has been placed.
+    explicit ThreadPool(const std::vector<int>& cpus);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(slots.size()); }
+    // Participants running on their own CPU; 0 for an unpinned pool
+    unsigned pinned() const { return pinned_count.load(std::memory_order_relaxed); }
+
+    // Calls fn(begin, end, participant) over [0, count) in chunks of `grain`
+    // and blocks until every chunk has run. fn must not throw; not reentrant.
+    // Chunks are dealt by index alone, so loops with the same count and
+    // grain give each participant the same chunks except for what is
+    // stolen at the end: data first written in one such loop sits on the
+    // NUMA node of the participant that later uses it.
+    void parallel_for(std::size_t count, std::size_t grain,
+                      const std::function<void(std::size_t, std::size_t, unsigned)>& fn);
+
+private:
+    struct alignas(CACHE_LINE) Slot {
+        std::atomic<uint64_t> range{0};  // begin chunk in the high half, end in the low half
+    };
+
+    void start_workers(unsigned threads);
+    void worker_main(unsigned index);
+    void run_participant(unsigned index);
+    bool take_own(unsigned index, uint32_t& chunk);
+    bool steal(unsigned index, uint32_t& chunk);
+
+    std::unique_ptr<Slot[]> slot_storage;
+    std::vector<Slot*> slots;
+    std::vector<std::thread> workers;
+    std::vector<int> cpus;  // per participant; empty = unpinned
+    std::unique_ptr<SavedAffinity> caller_affinity;
+    std::atomic<unsigned> pinned_count{0};
+
+    std::mutex mutex;
+    std::condition_variable job_ready;
+    std::condition_variable job_done;
+    uint64_t generation = 0;
+    unsigned active = 0;
+    bool stopping = false;
+
+    const std::function<void(std::size_t, std::size_t, unsigned)>* job = nullptr;
+    std::size_t job_count = 0;
+    std::size_t job_grain = 1;
+    alignas(CACHE_LINE) std::atomic<std::size_t> chunks_left{0};
+};
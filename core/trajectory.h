@@ -0,0 +1,68 @@
+#pragma once
+
+#include "minmax_pyramid.h"
+#include "ring_buffer.h"
+#include "simulation.h"
+
+struct TrajectorySample {
+    double time;
+    double y;  // measured position (ball centre), same frame as the setpoint
+    double setpoint;
+    double error;
+    double output;
+};
+
+// The plotted series, in TrajectoryPyramid channel order
+enum class PlotSeries : uint8_t { Y, Setpoint, Error, Output, Count };
+constexpr std::size_t PLOT_SERIES = static_cast<std::size_t>(PlotSeries::Count);
+
+using TrajectoryPyramid = MinMaxPyramid<PLOT_SERIES>;
+
+inline double series_value(const TrajectorySample& s, std::size_t series) {
+    switch (static_cast<PlotSeries>(series)) {
+        case PlotSeries::Y: return s.y;
+        case PlotSeries::Setpoint: return s.setpoint;
+        case PlotSeries::Error: return s.error;
+        default: return s.output;
+    }
+}
+
+// The live plot's ring of samples plus a min/max pyramid over the same
+// samples, pushed together so a zoomed-out plot never walks the ring.
+// Samples are also addressed absolutely, as the pyramid counts them:
+// [first(), end()) are the ones retained.
+class TrajectoryHistory {
+public:
+    explicit TrajectoryHistory(std::size_t capacity) : ring(capacity), lod(ring.capacity()) {}
+
+    void push(const TrajectorySample& s) {
+        ring.push(s);
+        const double values[PLOT_SERIES] = {s.y, s.setpoint, s.error, s.output};
+        lod.push(values);
+    }
+
+    void clear() {
+        ring.clear();
+        lod.clear();
+    }
+
+    std::size_t size() const { return ring.size(); }
+    std::size_t capacity() const { return ring.capacity(); }
+    bool empty() const { return ring.empty(); }
+    // 0 is the oldest retained sample, size() - 1 the newest
+    const TrajectorySample& operator[](std::size_t i) const { return ring[i]; }
+    const TrajectorySample& newest() const { return ring.newest(); }
+
+    uint64_t end() const { return lod.total(); }
+    uint64_t first() const { return lod.total() - ring.size(); }
+    double value(uint64_t index, std::size_t series) const { return series_value(ring[index - first()], series); }
+    const TrajectoryPyramid& pyramid() const { return lod; }
+
+private:
+    RingBuffer<TrajectorySample> ring;
+    TrajectoryPyramid lod;
+};
+
+inline TrajectorySample sample_of(const Simulation& sim) {
+    return {sim.time, sim.ball.y + BALL_SIZE/2, sim.setpoint, sim.pid.last_error(), sim.output};
+}
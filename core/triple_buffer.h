@@ -0,0 +1,52 @@
+#pragma once
+
+#include "aligned.h"
+
+#include <atomic>
+#include <cstdint>
+
+// Wait-free single-writer/single-reader handoff of the latest value. The
+// writer fills its private slot and swaps it with the shared middle slot;
+// the reader swaps the middle slot into its own only when it is fresh.
+template <class T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T& initial) {
+        for (auto& s : slots) s.value = initial;
+    }
+
+    // Writer side
+    T& back() { return slots[back_index].value; }
+    void publish() {
+        uint8_t prev = middle.exchange(static_cast<uint8_t>(back_index | FRESH), std::memory_order_acq_rel);
+        back_index = prev & INDEX_MASK;
+    }
+    void publish(const T& value) {
+        back() = value;
+        publish();
+    }
+
+    // Reader side; returns the newest published value (or the previous one
+    // again if nothing new arrived)
+    const T& read() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            uint8_t prev = middle.exchange(front_index, std::memory_order_acq_rel);
+            front_index = prev & INDEX_MASK;
+        }
+        return slots[front_index].value;
+    }
+
+private:
+    static constexpr uint8_t FRESH = 0x4;
+    static constexpr uint8_t INDEX_MASK = 0x3;
+
+    struct alignas(CACHE_LINE) Slot {
+        T value{};
+    };
+
+    Slot slots[3];
+    alignas(CACHE_LINE) std::atomic<uint8_t> middle{1};
+    alignas(CACHE_LINE) uint8_t back_index = 0;   // writer-owned
+    alignas(CACHE_LINE) uint8_t front_index = 2;  // reader-owned
+};
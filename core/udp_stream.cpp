@@ -0,0 +1,150 @@
+#include "udp_stream.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(sockaddr_in) <= 16, "sockaddr_in must fit UdpStreamer::address");
+
+namespace {
+
+[[noreturn]] void fail(const std::string& what) {
+#ifdef _WIN32
+    throw std::runtime_error(what + " (error " + std::to_string(WSAGetLastError()) + ")");
+#else
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+#endif
+}
+
+sockaddr_in parse_destination(const std::string& destination) {
+    std::size_t colon = destination.rfind(':');
+    if (colon == std::string::npos) throw std::invalid_argument("expected HOST:PORT, got " + destination);
+    std::string host = destination.substr(0, colon);
+    int port = std::atoi(destination.c_str() + colon + 1);
+    if (port <= 0 || port > 65535) throw std::invalid_argument("bad UDP port in " + destination);
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        throw std::invalid_argument("expected a numeric IPv4 host in " + destination);
+    }
+    return addr;
+}
+
+} // namespace
+
+UdpStreamer::UdpStreamer(const std::string& destination, double dt, std::size_t batch,
+                         std::chrono::milliseconds max_delay)
+        : queue(std::make_unique<SpscQueue<TelemetryRecord, RING_RECORDS>>()),
+          batch(std::clamp<std::size_t>(batch, 1, UDP_MAX_BATCH)),
+          max_delay(max_delay) {
+    sockaddr_in addr = parse_destination(destination);
+    std::memcpy(address, &addr, sizeof(addr));
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) fail("WSAStartup");
+    SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) {
+        WSACleanup();
+        fail("socket");
+    }
+    socket_handle = static_cast<intptr_t>(s);
+#else
+    int s = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (s < 0) fail("socket");
+    socket_handle = s;
+#endif
+
+    std::memcpy(header.magic, UDP_MAGIC, sizeof(header.magic));
+    header.version = UDP_VERSION;
+    header.dt = dt;
+    sender = std::thread(&UdpStreamer::sender_main, this);
+}
+
+UdpStreamer::~UdpStreamer() {
+    close();
+}
+
+// One datagram: the header and a run of ring slots, gathered by the kernel
+bool UdpStreamer::send_batch(const TelemetryRecord* records, std::size_t count) {
+    header.count = static_cast<uint16_t>(count);
+    header.first_record = sent_records.load(std::memory_order_relaxed);
+    header.ring_dropped = dropped();
+#ifdef _WIN32
+    WSABUF bufs[2] = {{sizeof(header), reinterpret_cast<char*>(&header)},
+                      {static_cast<ULONG>(count * sizeof(TelemetryRecord)),
+                       reinterpret_cast<char*>(const_cast<TelemetryRecord*>(records))}};
+    DWORD bytes = 0;
+    bool ok = WSASendTo(static_cast<SOCKET>(socket_handle), bufs, 2, &bytes, 0,
+                        reinterpret_cast<const sockaddr*>(address), sizeof(sockaddr_in), nullptr, nullptr) == 0;
+#else
+    iovec iov[2] = {{&header, sizeof(header)},
+                    {const_cast<TelemetryRecord*>(records), count * sizeof(TelemetryRecord)}};
+    msghdr msg{};
+    msg.msg_name = address;
+    msg.msg_namelen = sizeof(sockaddr_in);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    bool ok = ::sendmsg(static_cast<int>(socket_handle), &msg, 0) >= 0;
+#endif
+    // The sequence advances even on failure, so receivers count the loss
+    ++header.sequence;
+    sent_datagrams.fetch_add(1, std::memory_order_relaxed);
+    sent_records.fetch_add(count, std::memory_order_relaxed);
+    return ok;
+}
+
+void UdpStreamer::sender_main() {
+    auto waiting_since = std::chrono::steady_clock::time_point::max();
+    while (true) {
+        bool stop = stopping.load(std::memory_order_acquire);
+        const TelemetryRecord* first = nullptr;
+        std::size_t total = 0;
+        std::size_t n = queue->peek(first, total);
+        // Full batch, or a run cut short by the ring wrap, or one that has waited long enough
+        bool due = n >= batch || (n > 0 && (stop || n < total ||
+                                            std::chrono::steady_clock::now() - waiting_since >= max_delay));
+        if (due) {
+            std::size_t take = std::min(n, batch);
+            send_batch(first, take);
+            queue->consume(take);
+            waiting_since = std::chrono::steady_clock::time_point::max();
+            continue;
+        }
+        if (n == 0 && stop) break;
+        if (n > 0 && waiting_since == std::chrono::steady_clock::time_point::max()) {
+            waiting_since = std::chrono::steady_clock::now();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void UdpStreamer::close() {
+    if (closed) return;
+    closed = true;
+    stopping.store(true, std::memory_order_release);
+    if (sender.joinable()) sender.join();
+#ifdef _WIN32
+    closesocket(static_cast<SOCKET>(socket_handle));
+    WSACleanup();
+#else
+    ::close(static_cast<int>(socket_handle));
+#endif
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "spsc_queue.h"
+#include "telemetry.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Leads every datagram, followed by `count` TelemetryRecords. All fields are
+// in the sender's byte order (little-endian on every platform we build for).
+struct UdpPacketHeader {
+    char magic[4];        // "PIDU"
+    uint16_t version;
+    uint16_t count;       // records in this datagram
+    uint64_t sequence;    // datagram number; a gap means datagrams were lost in transit
+    uint64_t first_record; // records sent before this datagram, for counting lost records
+    uint64_t ring_dropped; // steps the sender itself dropped so far (its ring was full)
+    double dt;
+};
+static_assert(sizeof(UdpPacketHeader) == 40, "UDP header layout is part of the wire format");
+
+constexpr char UDP_MAGIC[4] = {'P', 'I', 'D', 'U'};
+constexpr uint16_t UDP_VERSION = 1;
+// Records per datagram; keeps header + records under a 1472-byte Ethernet payload
+constexpr std::size_t UDP_MAX_BATCH = 22;
+
+// Streams physics steps to a UDP receiver. record() only pushes into a
+// lock-free ring; a sender thread hands contiguous runs of the ring straight
+// to the socket through scatter/gather I/O (header + records, no copy or
+// per-sample encoding), batching up to `batch` records per datagram and
+// flushing partial batches after `max_delay`.
+class UdpStreamer {
+public:
+    // `destination` is HOST:PORT with a numeric IPv4 host
+    UdpStreamer(const std::string& destination, double dt, std::size_t batch = 16,
+                std::chrono::milliseconds max_delay = std::chrono::milliseconds(20));
+    ~UdpStreamer();
+
+    UdpStreamer(const UdpStreamer&) = delete;
+    UdpStreamer& operator=(const UdpStreamer&) = delete;
+
+    // Stepping thread only; never blocks
+    bool record(const TelemetryRecord& r) {
+        if (queue->push(r)) return true;
+        dropped_count.store(dropped_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void close();
+
+    uint64_t sent() const { return sent_records.load(std::memory_order_relaxed); }
+    uint64_t datagrams() const { return sent_datagrams.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_count.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t RING_RECORDS = 1 << 14;
+
+    void sender_main();
+    bool send_batch(const TelemetryRecord* records, std::size_t count);
+
+    std::unique_ptr<SpscQueue<TelemetryRecord, RING_RECORDS>> queue;
+    intptr_t socket_handle = -1;
+    unsigned char address[16] = {};  // sockaddr_in, kept opaque to keep socket headers out
+    std::size_t batch;
+    std::chrono::milliseconds max_delay;
+    UdpPacketHeader header{};
+
+    std::atomic<uint64_t> sent_records{0};
+    std::atomic<uint64_t> sent_datagrams{0};
+    std::atomic<uint64_t> dropped_count{0};
+    std::atomic<bool> stopping{false};
+    bool closed = false;
+    std::thread sender;
+};
@@ -0,0 +1,335 @@
+#include "gl_sweep.h"
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr GLuint GROUP_SIZE = 256;
+// Steps per dispatch, so no single dispatch runs into a driver watchdog
+constexpr uint64_t STEPS_PER_DISPATCH = 600;
+// Candidates resident at once; bigger sweeps are processed in slices
+constexpr std::size_t SLICE_CELLS = std::size_t(1) << 23;
+
+// Mirrors step_lanes_scalar and the sweep's IAE accumulation operation for
+// operation. `precise` stops the compiler from fusing multiply-adds.
+const char* STEP_SHADER = R"(#version 430
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 0) buffer State { dvec4 state[]; };  // y, velocity, integral, prev_error
+layout(std430, binding = 1) buffer Cost { double cost[]; };
+
+uniform uint cells;
+uniform uint cell_offset;
+uniform uint steps;
+uniform uint first;
+uniform double dt;
+uniform double setpoint;
+uniform dvec3 gain_min;
+uniform dvec3 gain_max;
+uniform uvec3 counts;
+
+const double PV_OFFSET = double(BALL_SIZE) / 2.0;
+const double Y_MAX = double(WINDOW_HEIGHT - BALL_SIZE);
+
+double gain_at(double lo, double hi, uint i, uint n) {
+    precise double v = n > 1u ? lo + (hi - lo) * double(i) / double(n - 1u) : lo;
+    return v;
+}
+
+void main() {
+    uint local = gl_GlobalInvocationID.x;
+    if (local >= cells) return;
+    uint cell = cell_offset + local;
+    uint k = cell % counts.z;
+    uint j = cell / counts.z % counts.y;
+    uint i = cell / (counts.z * counts.y);
+    double kp = gain_at(gain_min.x, gain_max.x, i, counts.x);
+    double ki = gain_at(gain_min.y, gain_max.y, j, counts.y);
+    double kd = gain_at(gain_min.z, gain_max.z, k, counts.z);
+
+    precise dvec4 s = first != 0u ? dvec4(double(WINDOW_HEIGHT) / 2.0, 0.0, 0.0, 0.0) : state[local];
+    precise double iae = first != 0u ? 0.0 : cost[local];
+    for (uint n = 0u; n < steps; ++n) {
+        precise double error = setpoint - (s.x + PV_OFFSET);
+        precise double integral = min(max(s.z + error * dt, -INTEGRAL_LIMIT), INTEGRAL_LIMIT);
+        precise double derivative = (error - s.w) / dt;
+        precise double force = kp * error + ki * integral + kd * derivative;
+        s.z = integral;
+        s.w = error;
+
+        precise double velocity = s.y + (force - GRAVITY) * dt;
+        precise double y = s.x + velocity * dt;
+        bool below = y < 0.0;
+        bool above = y > Y_MAX;
+        s.x = below ? 0.0 : (above ? Y_MAX : y);
+        s.y = (below || above) ? velocity * BOUNCE_COEFFICIENT : velocity;
+        iae += abs(setpoint - (s.x + PV_OFFSET)) * dt;
+    }
+    state[local] = s;
+    cost[local] = iae;
+}
+)";
+
+// Per-workgroup minimum of the cost buffer, with the winning cell index
+const char* REDUCE_SHADER = R"(#version 430
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 1) buffer Cost { double cost[]; };
+struct Best { double cost; uint index; uint pad; };
+layout(std430, binding = 2) buffer Result { Best best[]; };
+
+uniform uint cells;
+
+shared double group_cost[256];
+shared uint group_index[256];
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    uint t = gl_LocalInvocationID.x;
+    group_cost[t] = i < cells ? cost[i] : 1.0e300lf;
+    group_index[t] = i;
+    barrier();
+    for (uint stride = 128u; stride > 0u; stride >>= 1) {
+        if (t < stride && group_cost[t + stride] < group_cost[t]) {
+            group_cost[t] = group_cost[t + stride];
+            group_index[t] = group_index[t + stride];
+        }
+        barrier();
+    }
+    if (t == 0u) best[gl_WorkGroupID.x] = Best(group_cost[0], group_index[0], 0u);
+}
+)";
+
+struct GroupBest {
+    double cost;
+    uint32_t index;
+    uint32_t pad;
+};
+
+// Exact GLSL double literal for a C++ constant
+std::string glsl_double(double v) {
+    char text[40];
+    std::snprintf(text, sizeof(text), "%.17elf", v);
+    return text;
+}
+
+template <class Fn>
+void load(Fn& fn, const char* name) {
+    fn = reinterpret_cast<Fn>(SDL_GL_GetProcAddress(name));
+    if (!fn) throw std::runtime_error(std::string("OpenGL entry point missing: ") + name);
+}
+
+} // namespace
+
+struct GlSweep::Impl {
+    SDL_Window* window = nullptr;
+    SDL_GLContext context = nullptr;
+    std::string device;
+
+    const GLubyte*(APIENTRY* GetString)(GLenum) = nullptr;
+    PFNGLCREATESHADERPROC CreateShader = nullptr;
+    PFNGLSHADERSOURCEPROC ShaderSource = nullptr;
+    PFNGLCOMPILESHADERPROC CompileShader = nullptr;
+    PFNGLGETSHADERIVPROC GetShaderiv = nullptr;
+    PFNGLGETSHADERINFOLOGPROC GetShaderInfoLog = nullptr;
+    PFNGLDELETESHADERPROC DeleteShader = nullptr;
+    PFNGLCREATEPROGRAMPROC CreateProgram = nullptr;
+    PFNGLATTACHSHADERPROC AttachShader = nullptr;
+    PFNGLLINKPROGRAMPROC LinkProgram = nullptr;
+    PFNGLGETPROGRAMIVPROC GetProgramiv = nullptr;
+    PFNGLGETPROGRAMINFOLOGPROC GetProgramInfoLog = nullptr;
+    PFNGLDELETEPROGRAMPROC DeleteProgram = nullptr;
+    PFNGLUSEPROGRAMPROC UseProgram = nullptr;
+    PFNGLGETUNIFORMLOCATIONPROC GetUniformLocation = nullptr;
+    PFNGLUNIFORM1UIPROC Uniform1ui = nullptr;
+    PFNGLUNIFORM3UIPROC Uniform3ui = nullptr;
+    PFNGLUNIFORM1DPROC Uniform1d = nullptr;
+    PFNGLUNIFORM3DPROC Uniform3d = nullptr;
+    PFNGLGENBUFFERSPROC GenBuffers = nullptr;
+    PFNGLDELETEBUFFERSPROC DeleteBuffers = nullptr;
+    PFNGLBINDBUFFERPROC BindBuffer = nullptr;
+    PFNGLBUFFERDATAPROC BufferData = nullptr;
+    PFNGLBINDBUFFERBASEPROC BindBufferBase = nullptr;
+    PFNGLGETBUFFERSUBDATAPROC GetBufferSubData = nullptr;
+    PFNGLDISPATCHCOMPUTEPROC DispatchCompute = nullptr;
+    PFNGLMEMORYBARRIERPROC MemoryBarrier = nullptr;
+
+    GLuint step_program = 0, reduce_program = 0;
+    GLuint buffers[3] = {};  // state, cost, per-group best
+
+    GLuint compile(const char* source) {
+        // The plant constants come from constants.h, not a second copy in GLSL
+        std::string defines = std::string("#version 430\n") +
+                              "#define WINDOW_HEIGHT " + std::to_string(WINDOW_HEIGHT) + "\n" +
+                              "#define BALL_SIZE " + std::to_string(BALL_SIZE) + "\n" +
+                              "const double GRAVITY = " + glsl_double(GRAVITY) + ";\n" +
+                              "const double INTEGRAL_LIMIT = " + glsl_double(INTEGRAL_LIMIT) + ";\n" +
+                              "const double BOUNCE_COEFFICIENT = " + glsl_double(BOUNCE_COEFFICIENT) + ";\n";
+        const char* body = std::strchr(source, '\n') + 1;  // skip the #version line
+        const char* parts[] = {defines.c_str(), body};
+
+        GLuint shader = CreateShader(GL_COMPUTE_SHADER);
+        ShaderSource(shader, 2, parts, nullptr);
+        CompileShader(shader);
+        GLint ok = 0;
+        GetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+        if (!ok) {
+            char log[2048];
+            GetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            DeleteShader(shader);
+            throw std::runtime_error(std::string("compute shader: ") + log);
+        }
+
+        GLuint program = CreateProgram();
+        AttachShader(program, shader);
+        LinkProgram(program);
+        DeleteShader(shader);
+        GetProgramiv(program, GL_LINK_STATUS, &ok);
+        if (!ok) {
+            char log[2048];
+            GetProgramInfoLog(program, sizeof(log), nullptr, log);
+            DeleteProgram(program);
+            throw std::runtime_error(std::string("compute program: ") + log);
+        }
+        return program;
+    }
+
+    GLint uniform(GLuint program, const char* name) { return GetUniformLocation(program, name); }
+
+    ~Impl() {
+        if (context) {
+            if (DeleteBuffers) DeleteBuffers(3, buffers);
+            if (DeleteProgram) {
+                DeleteProgram(step_program);
+                DeleteProgram(reduce_program);
+            }
+            SDL_GL_DeleteContext(context);
+        }
+        if (window) SDL_DestroyWindow(window);
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    }
+};
+
+GlSweep::GlSweep() : impl(std::make_unique<Impl>()) {
+    if (SDL_InitSubSystem(SDL_INIT_VIDEO)) throw std::runtime_error(SDL_GetError());
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    impl->window = SDL_CreateWindow("pid_gpu", 0, 0, 16, 16, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (!impl->window) throw std::runtime_error(SDL_GetError());
+    impl->context = SDL_GL_CreateContext(impl->window);
+    if (!impl->context) throw std::runtime_error(std::string("no OpenGL 4.3 context: ") + SDL_GetError());
+
+    Impl& gl = *impl;
+    load(gl.GetString, "glGetString");
+    load(gl.CreateShader, "glCreateShader");
+    load(gl.ShaderSource, "glShaderSource");
+    load(gl.CompileShader, "glCompileShader");
+    load(gl.GetShaderiv, "glGetShaderiv");
+    load(gl.GetShaderInfoLog, "glGetShaderInfoLog");
+    load(gl.DeleteShader, "glDeleteShader");
+    load(gl.CreateProgram, "glCreateProgram");
+    load(gl.AttachShader, "glAttachShader");
+    load(gl.LinkProgram, "glLinkProgram");
+    load(gl.GetProgramiv, "glGetProgramiv");
+    load(gl.GetProgramInfoLog, "glGetProgramInfoLog");
+    load(gl.DeleteProgram, "glDeleteProgram");
+    load(gl.UseProgram, "glUseProgram");
+    load(gl.GetUniformLocation, "glGetUniformLocation");
+    load(gl.Uniform1ui, "glUniform1ui");
+    load(gl.Uniform3ui, "glUniform3ui");
+    load(gl.Uniform1d, "glUniform1d");
+    load(gl.Uniform3d, "glUniform3d");
+    load(gl.GenBuffers, "glGenBuffers");
+    load(gl.DeleteBuffers, "glDeleteBuffers");
+    load(gl.BindBuffer, "glBindBuffer");
+    load(gl.BufferData, "glBufferData");
+    load(gl.BindBufferBase, "glBindBufferBase");
+    load(gl.GetBufferSubData, "glGetBufferSubData");
+    load(gl.DispatchCompute, "glDispatchCompute");
+    load(gl.MemoryBarrier, "glMemoryBarrier");
+
+    const char* renderer = reinterpret_cast<const char*>(gl.GetString(GL_RENDERER));
+    gl.device = renderer ? renderer : "unknown";
+    gl.step_program = gl.compile(STEP_SHADER);
+    gl.reduce_program = gl.compile(REDUCE_SHADER);
+    gl.GenBuffers(3, gl.buffers);
+}
+
+GlSweep::~GlSweep() = default;
+
+const std::string& GlSweep::device() const {
+    return impl->device;
+}
+
+GpuSweepResult GlSweep::run(const SweepConfig& config, std::size_t sample_cells) {
+    Impl& gl = *impl;
+    GpuSweepResult result;
+    result.cells = config.kp.count * config.ki.count * config.kd.count;
+    result.best_cost = 1e300;
+    if (result.cells > UINT32_MAX) throw std::runtime_error("GPU sweep is limited to 2^32 candidates");
+
+    const std::size_t slice = std::min(result.cells, SLICE_CELLS);
+    const auto allocate = [&](GLuint buffer, std::size_t bytes) {
+        gl.BindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        gl.BufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_DYNAMIC_COPY);
+    };
+    const std::size_t max_groups = (slice + GROUP_SIZE - 1) / GROUP_SIZE;
+    allocate(gl.buffers[0], slice * 4 * sizeof(double));
+    allocate(gl.buffers[1], slice * sizeof(double));
+    allocate(gl.buffers[2], max_groups * sizeof(GroupBest));
+    for (GLuint b = 0; b < 3; ++b) gl.BindBufferBase(GL_SHADER_STORAGE_BUFFER, b, gl.buffers[b]);
+
+    gl.UseProgram(gl.step_program);
+    gl.Uniform1d(gl.uniform(gl.step_program, "dt"), config.dt);
+    gl.Uniform1d(gl.uniform(gl.step_program, "setpoint"), config.setpoint);
+    gl.Uniform3d(gl.uniform(gl.step_program, "gain_min"), config.kp.min, config.ki.min, config.kd.min);
+    gl.Uniform3d(gl.uniform(gl.step_program, "gain_max"), config.kp.max, config.ki.max, config.kd.max);
+    gl.Uniform3ui(gl.uniform(gl.step_program, "counts"), static_cast<GLuint>(config.kp.count),
+                  static_cast<GLuint>(config.ki.count), static_cast<GLuint>(config.kd.count));
+
+    std::vector<GroupBest> groups(max_groups);
+    for (std::size_t offset = 0; offset < result.cells; offset += slice) {
+        const GLuint n = static_cast<GLuint>(std::min(slice, result.cells - offset));
+        const GLuint group_count = (n + GROUP_SIZE - 1) / GROUP_SIZE;
+
+        gl.UseProgram(gl.step_program);
+        gl.Uniform1ui(gl.uniform(gl.step_program, "cells"), n);
+        gl.Uniform1ui(gl.uniform(gl.step_program, "cell_offset"), static_cast<GLuint>(offset));
+        for (uint64_t done = 0; done < config.steps || done == 0; done += STEPS_PER_DISPATCH) {
+            const uint64_t steps = std::min(STEPS_PER_DISPATCH, config.steps - done);
+            gl.Uniform1ui(gl.uniform(gl.step_program, "steps"), static_cast<GLuint>(steps));
+            gl.Uniform1ui(gl.uniform(gl.step_program, "first"), done == 0);
+            gl.DispatchCompute(group_count, 1, 1);
+            gl.MemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            if (steps == 0) break;
+        }
+
+        gl.UseProgram(gl.reduce_program);
+        gl.Uniform1ui(gl.uniform(gl.reduce_program, "cells"), n);
+        gl.DispatchCompute(group_count, 1, 1);
+        gl.MemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        gl.BindBuffer(GL_SHADER_STORAGE_BUFFER, gl.buffers[2]);
+        gl.GetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, group_count * sizeof(GroupBest), groups.data());
+        for (GLuint g = 0; g < group_count; ++g) {
+            if (groups[g].cost < result.best_cost) {
+                result.best_cost = groups[g].cost;
+                result.best = offset + groups[g].index;
+            }
+        }
+        if (offset == 0 && sample_cells > 0) {
+            result.sample.resize(std::min<std::size_t>(sample_cells, n));
+            gl.BindBuffer(GL_SHADER_STORAGE_BUFFER, gl.buffers[1]);
+            gl.GetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, result.sample.size() * sizeof(double), result.sample.data());
+        }
+    }
+    return result;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "core/sweep.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct GpuSweepResult {
+    std::size_t cells = 0;
+    std::size_t best = 0;
+    double best_cost = 0.0;
+    // IAE of cells [0, sample.size()), read back for checking against the CPU
+    std::vector<double> sample;
+};
+
+// The IAE sweep of run_sweep as an OpenGL 4.3 compute shader. Every
+// candidate's state stays in GPU buffers across dispatches; only the
+// per-workgroup minimum and a small sample of costs are read back.
+//
+// The shader runs the batch kernel's arithmetic in double precision with
+// `precise` (no FMA contraction), but GLSL does not require correctly
+// rounded fp64 division, so results are checked against the CPU within
+// TOLERANCE rather than bit for bit.
+class GlSweep {
+public:
+    // Largest relative IAE difference from the CPU reference accepted
+    static constexpr double TOLERANCE = 1e-6;
+
+    // Opens a hidden window with a GL 4.3 core context; throws
+    // std::runtime_error when no such context is available
+    GlSweep();
+    ~GlSweep();
+
+    GlSweep(const GlSweep&) = delete;
+    GlSweep& operator=(const GlSweep&) = delete;
+
+    const std::string& device() const;
+
+    GpuSweepResult run(const SweepConfig& config, std::size_t sample_cells = 4096);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
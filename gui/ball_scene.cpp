@@ -0,0 +1,53 @@
+#include "ball_scene.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Cheap hue ramp, good enough to tell neighbouring gain groups apart
+SDL_Color hue_color(float h) {
+    float r = std::fabs(h * 6 - 3) - 1;
+    float g = 2 - std::fabs(h * 6 - 2);
+    float b = 2 - std::fabs(h * 6 - 4);
+    auto c = [](float v) { return static_cast<Uint8>(std::clamp(v, 0.0f, 1.0f) * 200); };
+    return {c(r), c(g), c(b), 255};
+}
+
+} // namespace
+
+BallScene::BallScene(SDL_Renderer* renderer, std::size_t balls)
+        : renderer(renderer), balls(std::min(balls, MAX_BALLS)) {
+    const float spacing = static_cast<float>(WINDOW_WIDTH) / this->balls;
+    ball_size = std::clamp(spacing, 2.0f, static_cast<float>(BALL_SIZE));
+
+    vertices.resize(this->balls * 4);
+    indices.resize(this->balls * 6);
+    for (std::size_t i = 0; i < this->balls; ++i) {
+        float x = std::min(i * spacing, WINDOW_WIDTH - ball_size);
+        SDL_Color color = hue_color(static_cast<float>(i % 16) / 16);
+        SDL_Vertex* v = &vertices[i * 4];
+        v[0] = {{x, 0}, color, {0, 0}};
+        v[1] = {{x + ball_size, 0}, color, {0, 0}};
+        v[2] = {{x + ball_size, 0}, color, {0, 0}};
+        v[3] = {{x, 0}, color, {0, 0}};
+
+        int base = static_cast<int>(i * 4);
+        int* idx = &indices[i * 6];
+        idx[0] = base; idx[1] = base + 1; idx[2] = base + 2;
+        idx[3] = base; idx[4] = base + 2; idx[5] = base + 3;
+    }
+}
+
+void BallScene::draw(const BatchEngine& engine, const double* prev_y, double alpha) {
+    // Squares are centred on the measured point, so small ones still show pv
+    const double offset = BALL_SIZE / 2.0 - ball_size / 2.0;
+    for (std::size_t i = 0; i < balls; ++i) {
+        float top = static_cast<float>(prev_y[i] + (engine.y[i] - prev_y[i]) * alpha + offset);
+        SDL_Vertex* v = &vertices[i * 4];
+        v[0].position.y = v[1].position.y = top;
+        v[2].position.y = v[3].position.y = top + ball_size;
+    }
+    SDL_RenderGeometry(renderer, nullptr, vertices.data(), static_cast<int>(vertices.size()),
+                       indices.data(), static_cast<int>(indices.size()));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "core/batch_engine.h"
+
+#include <SDL.h>
+#include <vector>
+
+// Draws every lane of a BatchEngine as a square, all in one
+// SDL_RenderGeometry call. x placement, size and colour are fixed per lane,
+// so each frame only rewrites the vertex y coordinates.
+class BallScene {
+public:
+    static constexpr std::size_t MAX_BALLS = 100000;
+
+    BallScene(SDL_Renderer* renderer, std::size_t balls);
+
+    std::size_t size() const { return balls; }
+    // Side of every square, and the horizontal centre of ball i
+    float ball_width() const { return ball_size; }
+    float center_x(std::size_t i) const { return vertices[i * 4].position.x + ball_size / 2; }
+
+    // Interpolates each lane between prev_y and y by alpha in [0, 1]
+    void draw(const BatchEngine& engine, const double* prev_y, double alpha);
+
+private:
+    SDL_Renderer* renderer;
+    std::size_t balls;
+    float ball_size;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
@@ -0,0 +1,28 @@
+#include "cached_layer.h"
+
+#include <stdexcept>
+
+CachedLayer::CachedLayer(SDL_Renderer* renderer, int w, int h, bool opaque)
+        : renderer(renderer), w(w), h(h) {
+    texture.reset(SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, w, h));
+    if (!texture) throw std::runtime_error(SDL_GetError());
+    SDL_SetTextureBlendMode(texture.get(), opaque ? SDL_BLENDMODE_NONE : SDL_BLENDMODE_BLEND);
+}
+
+SDL_Texture* CachedLayer::begin_paint() {
+    SDL_Texture* previous = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, texture.get());
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    return previous;
+}
+
+void CachedLayer::end_paint(SDL_Texture* previous) {
+    SDL_SetRenderTarget(renderer, previous);
+    dirty = false;
+}
+
+void CachedLayer::draw(int x, int y) {
+    SDL_Rect dst{x, y, w, h};
+    SDL_RenderCopy(renderer, texture.get(), nullptr, &dst);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <SDL.h>
+#include <memory>
+
+// Content that rarely changes, painted once into a target texture and then
+// composited with a single SDL_RenderCopy per frame. The owner repaints it
+// after mark_dirty(): when what it shows changes, or on
+// SDL_RENDER_TARGETS_RESET, which discards target texture contents.
+class CachedLayer {
+public:
+    // An opaque layer replaces what is under it, so it can stand in for a clear
+    CachedLayer(SDL_Renderer* renderer, int w, int h, bool opaque = false);
+
+    void mark_dirty() { dirty = true; }
+    bool is_dirty() const { return dirty; }
+
+    // Runs paint() with the layer as render target, cleared to transparent.
+    // Draw calls inside paint() use layer coordinates, (0, 0) at its top left.
+    template <class Paint>
+    void rebuild(Paint&& paint) {
+        SDL_Texture* previous = begin_paint();
+        paint();
+        end_paint(previous);
+    }
+
+    void draw(int x, int y);
+    int width() const { return w; }
+    int height() const { return h; }
+
+private:
+    SDL_Texture* begin_paint();
+    void end_paint(SDL_Texture* previous);
+
+    SDL_Renderer* renderer;
+    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> texture{nullptr, SDL_DestroyTexture};
+    int w, h;
+    bool dirty = true;
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+
+// Lato Regular (SIL OFL 1.1, see assets/fonts/OFL.txt), compiled into the
+// binary by cmake/embed_file.cmake so the GUI needs no system fonts
+extern const unsigned char EMBEDDED_FONT[];
+extern const std::size_t EMBEDDED_FONT_SIZE;
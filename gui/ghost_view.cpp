@@ -0,0 +1,29 @@
+#include "ghost_view.h"
+#include "core/constants.h"
+
+#include <algorithm>
+#include <cmath>
+
+void GhostView::draw(const GhostFrame& frame, float ball_x, double now) {
+    if (frame.version == 0 || frame.count < 2) return;
+    const double elapsed = now - frame.start_time;
+    const double span = frame.sample_dt * (frame.count - 1);
+    if (elapsed < 0.0 || elapsed >= span) return;
+
+    // Points already in the past are skipped; the first drawn one sits on the ball
+    int first = static_cast<int>(elapsed / frame.sample_dt);
+    int n = 0;
+    const float centre = BALL_SIZE / 2.0f;
+    for (int i = first; i < frame.count; ++i) {
+        float x = ball_x + centre + static_cast<float>((i * frame.sample_dt - elapsed) * PX_PER_SECOND);
+        if (x > WINDOW_WIDTH) break;
+        points[n++] = {x, frame.y[i] + centre};
+    }
+    if (n < 2) return;
+
+    const Uint8 alpha = static_cast<Uint8>(160.0 * (1.0 - elapsed / span));
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 200, 0, 0, alpha);
+    SDL_RenderDrawLinesF(renderer, points, n);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "core/ghost_preview.h"
+
+#include <SDL.h>
+
+// Faded overlay of a GhostFrame in the main view: time runs rightwards from
+// the ball, and the path scrolls into it as the prediction's start recedes
+// into the past, fading out once the horizon has elapsed.
+class GhostView {
+public:
+    // Horizontal px per simulated second
+    static constexpr float PX_PER_SECOND = 120.0f;
+
+    explicit GhostView(SDL_Renderer* renderer) : renderer(renderer) {}
+
+    void draw(const GhostFrame& frame, float ball_x, double now);
+
+private:
+    SDL_Renderer* renderer;
+    SDL_FPoint points[GhostFrame::MAX_POINTS];
+};
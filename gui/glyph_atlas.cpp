@@ -0,0 +1,119 @@
+#include "glyph_atlas.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+GlyphAtlas::GlyphAtlas(SDL_Renderer* renderer, TTF_Font* font, FrameArena& arena)
+        : renderer(renderer), arena(arena) {
+    const SDL_Color white = {255, 255, 255, 255};
+    line_skip = TTF_FontLineSkip(font);
+
+    // Rasterize every glyph first so the atlas height is known before packing
+    using SurfacePtr = std::unique_ptr<SDL_Surface, decltype(&SDL_FreeSurface)>;
+    std::vector<SurfacePtr> surfaces;
+    surfaces.reserve(glyphs.size());
+    int pen_x = 0, pen_y = 0, row_height = 0;
+    for (size_t i = 0; i < glyphs.size(); ++i) {
+        Uint32 ch = static_cast<Uint32>(FIRST_GLYPH + i);
+        int advance = 0;
+        TTF_GlyphMetrics32(font, ch, nullptr, nullptr, nullptr, nullptr, &advance);
+        glyphs[i].advance = advance;
+
+        surfaces.emplace_back(TTF_RenderGlyph32_Blended(font, ch, white), SDL_FreeSurface);
+        if (!surfaces[i]) continue;  // e.g. space has no pixels in some fonts
+
+        SDL_Surface* s = surfaces[i].get();
+        if (pen_x + s->w > ATLAS_WIDTH) {
+            pen_x = 0;
+            pen_y += row_height + 1;
+            row_height = 0;
+        }
+        glyphs[i].src = {pen_x, pen_y, s->w, s->h};
+        pen_x += s->w + 1;
+        row_height = std::max(row_height, s->h);
+    }
+    int atlas_height = pen_y + row_height;
+
+    SurfacePtr atlas{SDL_CreateRGBSurfaceWithFormat(0, ATLAS_WIDTH, atlas_height, 32, SDL_PIXELFORMAT_RGBA32),
+                     SDL_FreeSurface};
+    if (!atlas) throw std::runtime_error(SDL_GetError());
+    SDL_FillRect(atlas.get(), nullptr, SDL_MapRGBA(atlas->format, 255, 255, 255, 0));
+
+    for (size_t i = 0; i < glyphs.size(); ++i) {
+        if (!surfaces[i]) continue;
+        // Copy alpha as-is instead of blending onto the transparent atlas
+        SDL_SetSurfaceBlendMode(surfaces[i].get(), SDL_BLENDMODE_NONE);
+        SDL_Rect dst = glyphs[i].src;
+        SDL_BlitSurface(surfaces[i].get(), nullptr, atlas.get(), &dst);
+    }
+
+    texture.reset(SDL_CreateTextureFromSurface(renderer, atlas.get()));
+    if (!texture) throw std::runtime_error(SDL_GetError());
+    SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+
+    inv_width = 1.0f / ATLAS_WIDTH;
+    inv_height = 1.0f / atlas_height;
+}
+
+const GlyphAtlas::Glyph* GlyphAtlas::lookup(char c) const {
+    if (c < FIRST_GLYPH || c > LAST_GLYPH) c = '?';
+    return &glyphs[c - FIRST_GLYPH];
+}
+
+int GlyphAtlas::measure(std::string_view line) const {
+    int width = 0;
+    for (char c : line) {
+        if (c == '\n') break;
+        width += lookup(c)->advance;
+    }
+    return width;
+}
+
+void GlyphAtlas::push_quad(const Glyph& g, float x, float y, SDL_Color color, SDL_Vertex* v, int* index, int base) {
+    float u0 = g.src.x * inv_width, v0 = g.src.y * inv_height;
+    float u1 = (g.src.x + g.src.w) * inv_width, v1 = (g.src.y + g.src.h) * inv_height;
+    float x1 = x + g.src.w, y1 = y + g.src.h;
+
+    v[0] = {{x, y}, color, {u0, v0}};
+    v[1] = {{x1, y}, color, {u1, v0}};
+    v[2] = {{x1, y1}, color, {u1, v1}};
+    v[3] = {{x, y1}, color, {u0, v1}};
+    const int quad[6] = {base, base + 1, base + 2, base, base + 2, base + 3};
+    std::copy(quad, quad + 6, index);
+}
+
+void GlyphAtlas::draw(std::string_view text, int x, int y, SDL_Color color) {
+    const Label label{text, x, y, color};
+    draw(&label, 1);
+}
+
+void GlyphAtlas::draw(const Label* labels, std::size_t count) {
+    // At most one quad per character; SDL copies the geometry out before returning
+    std::size_t chars = 0;
+    for (std::size_t l = 0; l < count; ++l) chars += labels[l].text.size();
+    SDL_Vertex* vertices = arena.allocate_array<SDL_Vertex>(chars * 4);
+    int* indices = arena.allocate_array<int>(chars * 6);
+    int quads = 0;
+
+    for (std::size_t l = 0; l < count; ++l) {
+        const Label& label = labels[l];
+        float pen_x = static_cast<float>(label.x), pen_y = static_cast<float>(label.y);
+        for (char c : label.text) {
+            if (c == '\n') {
+                pen_x = static_cast<float>(label.x);
+                pen_y += line_skip;
+                continue;
+            }
+            const Glyph* g = lookup(c);
+            if (g->src.w > 0) {
+                push_quad(*g, pen_x, pen_y, label.color, vertices + quads * 4, indices + quads * 6, quads * 4);
+                ++quads;
+            }
+            pen_x += g->advance;
+        }
+    }
+
+    if (quads == 0) return;
+    SDL_RenderGeometry(renderer, texture.get(), vertices, quads * 4, indices, quads * 6);
+}
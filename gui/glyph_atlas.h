@@ -0,0 +1,53 @@
+#pragma once
+
+#include "core/frame_arena.h"
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+// Printable ASCII glyphs rasterized once from a TTF_Font into a single
+// texture. Text is drawn as one batch of textured quads per call, so an
+// unchanged string costs no rasterization and no texture creation. The
+// quads are built in the caller's FrameArena.
+class GlyphAtlas {
+public:
+    GlyphAtlas(SDL_Renderer* renderer, TTF_Font* font, FrameArena& arena);
+
+    void draw(std::string_view text, int x, int y, SDL_Color color);
+
+    struct Label {
+        std::string_view text;
+        int x, y;
+        SDL_Color color;
+    };
+    // Every label in one batch, however many there are
+    void draw(const Label* labels, std::size_t count);
+
+    int line_height() const { return line_skip; }
+    int measure(std::string_view line) const;
+
+private:
+    static constexpr char FIRST_GLYPH = ' ';
+    static constexpr char LAST_GLYPH = '~';
+    static constexpr int ATLAS_WIDTH = 512;
+
+    struct Glyph {
+        SDL_Rect src{0, 0, 0, 0};
+        int advance = 0;
+    };
+
+    const Glyph* lookup(char c) const;
+    void push_quad(const Glyph& g, float x, float y, SDL_Color color, SDL_Vertex* v, int* index, int base);
+
+    SDL_Renderer* renderer;
+    FrameArena& arena;
+    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> texture{nullptr, SDL_DestroyTexture};
+    std::array<Glyph, LAST_GLYPH - FIRST_GLYPH + 1> glyphs{};
+    int line_skip = 0;
+    float inv_width = 0.0f;
+    float inv_height = 0.0f;
+};
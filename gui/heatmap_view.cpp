@@ -0,0 +1,73 @@
+#include "heatmap_view.h"
+#include "glyph_atlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+constexpr int N = GainMapFrame::SIZE;
+
+// Dark blue (cheap) through green to yellow (expensive)
+Uint32 ramp(float t) {
+    t = std::clamp(t, 0.0f, 1.0f);
+    auto c = [](float v) { return static_cast<Uint32>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+    Uint32 r = c(t * t * 1.1f), g = c(0.1f + 0.85f * t), b = c(0.55f - 0.5f * t);
+    return (r << 24) | (g << 16) | (b << 8) | 0xFF;
+}
+
+} // namespace
+
+HeatmapView::HeatmapView(SDL_Renderer* renderer, GlyphAtlas& glyphs)
+        : renderer(renderer), glyphs(glyphs), pixels(N * N) {
+    texture.reset(SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, N, N));
+    if (!texture) throw std::runtime_error(SDL_GetError());
+    SDL_SetTextureScaleMode(texture.get(), SDL_ScaleModeNearest);
+}
+
+void HeatmapView::upload(const GainMapFrame& frame) {
+    // Log scale: costs near the optimum differ by far less than the unstable corners
+    const float lo = std::log1p(std::max(frame.lo, 0.0f));
+    const float hi = std::log1p(std::max(frame.hi, 0.0f));
+    const float scale = hi > lo ? 1.0f / (hi - lo) : 0.0f;
+    // Rows are flipped so the second gain grows upwards
+    for (int y = 0; y < N; ++y) {
+        for (int x = 0; x < N; ++x) {
+            float v = frame.cost[y * N + x];
+            pixels[(N - 1 - y) * N + x] = std::isnan(v) ? 0x505050FFu : ramp((std::log1p(std::max(v, 0.0f)) - lo) * scale);
+        }
+    }
+    SDL_UpdateTexture(texture.get(), nullptr, pixels.data(), N * sizeof(Uint32));
+    uploaded = frame.version;
+}
+
+void HeatmapView::draw(const GainMapFrame& frame, CostMetric metric, double kp, double y_gain, const SDL_FRect& area) {
+    if (frame.version == 0) return;
+    if (frame.version != uploaded) upload(frame);
+    SDL_RenderCopyF(renderer, texture.get(), nullptr, &area);
+
+    // Crosshair at the current gains, if they fall inside the window
+    float cx = static_cast<float>((kp - frame.x0) / frame.x_step + 0.5) * area.w / N;
+    float cy = static_cast<float>((y_gain - frame.y0) / frame.y_step + 0.5) * area.h / N;
+    if (cx >= 0 && cx <= area.w && cy >= 0 && cy <= area.h) {
+        float px = area.x + cx, py = area.y + area.h - cy;
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+        SDL_RenderDrawLineF(renderer, px - 6, py, px + 6, py);
+        SDL_RenderDrawLineF(renderer, px, py - 6, px, py + 6);
+    }
+    SDL_SetRenderDrawColor(renderer, 160, 160, 160, 255);
+    SDL_RenderDrawRectF(renderer, &area);
+
+    // Two right-aligned lines above the map, so long ranges grow leftwards
+    const SDL_Color black{0, 0, 0, 255};
+    const int right = static_cast<int>(area.x + area.w);
+    int y = static_cast<int>(area.y) - 2 * glyphs.line_height();
+    std::snprintf(label, sizeof(label), "%s  %d/%d cells", cost_metric_name(metric), frame.exact, N * N);
+    glyphs.draw(label, right - glyphs.measure(label), y, black);
+    std::snprintf(label, sizeof(label), "Kp %g-%g  %s %g-%g",
+                  frame.x0, frame.x0 + frame.x_step * (N - 1), frame.axes == GainAxes::KpKd ? "Kd" : "Ki",
+                  frame.y0, frame.y0 + frame.y_step * (N - 1));
+    glyphs.draw(label, right - glyphs.measure(label), y + glyphs.line_height(), black);
+}
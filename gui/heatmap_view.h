@@ -0,0 +1,29 @@
+#pragma once
+
+#include "core/gain_map.h"
+
+#include <SDL.h>
+#include <memory>
+#include <vector>
+
+class GlyphAtlas;
+
+// Shows GainMap frames through one streaming texture. A frame is converted
+// and uploaded with SDL_UpdateTexture only when its version changes; the
+// current gains are marked with a crosshair.
+class HeatmapView {
+public:
+    HeatmapView(SDL_Renderer* renderer, GlyphAtlas& glyphs);
+
+    void draw(const GainMapFrame& frame, CostMetric metric, double kp, double y_gain, const SDL_FRect& area);
+
+private:
+    void upload(const GainMapFrame& frame);
+
+    SDL_Renderer* renderer;
+    GlyphAtlas& glyphs;
+    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> texture{nullptr, SDL_DestroyTexture};
+    std::vector<Uint32> pixels;
+    uint64_t uploaded = 0;
+    char label[96] = "";
+};
@@ -0,0 +1,60 @@
+#include "hud.h"
+#include "glyph_atlas.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string_view>
+
+Hud::Hud(SDL_Renderer* renderer, GlyphAtlas& glyphs)
+        : renderer(renderer), glyphs(glyphs) {}
+
+void Hud::ensure_texture(int w, int h) {
+    if (texture && w <= tex_w && h <= tex_h) return;
+    tex_w = std::max(w, tex_w);
+    tex_h = std::max(h, tex_h);
+    texture.reset(SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                    SDL_TEXTUREACCESS_TARGET, tex_w, tex_h));
+    if (!texture) throw std::runtime_error(SDL_GetError());
+    SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+}
+
+void Hud::rebuild(double kp, double ki, double kd, const char* form) {
+    std::snprintf(text, sizeof(text),
+                  "Controls:\n"
+                  "Mouse Click - Set Target\n"
+                  "Up/Down - Kp: %f (+/-%g)\n"
+                  "Left/Right - Ki: %f (+/-%g)\n"
+                  "PgUp/PgDn - Kd: %f (+/-%g)\n"
+                  "V - Form: %s\n"
+                  "R - Reset PID", kp, steps[0], ki, steps[1], kd, steps[2], form);
+
+    text_w = 0;
+    text_h = 0;
+    std::string_view rest = text;
+    while (true) {
+        size_t nl = rest.find('\n');
+        text_w = std::max(text_w, glyphs.measure(rest.substr(0, nl)));
+        text_h += glyphs.line_height();
+        if (nl == std::string_view::npos) break;
+        rest.remove_prefix(nl + 1);
+    }
+
+    ensure_texture(text_w, text_h);
+
+    SDL_Texture* previous = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, texture.get());
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    glyphs.draw(text, 0, 0, {0, 0, 0, 255});
+    SDL_SetRenderTarget(renderer, previous);
+
+    dirty = false;
+}
+
+void Hud::draw(int x, int y) {
+    if (!texture) return;
+    SDL_Rect src{0, 0, text_w, text_h};
+    SDL_Rect dst{x, y, text_w, text_h};
+    SDL_RenderCopy(renderer, texture.get(), &src, &dst);
+}
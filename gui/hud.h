@@ -0,0 +1,40 @@
+#pragma once
+
+#include <SDL.h>
+#include <memory>
+
+class GlyphAtlas;
+
+// Retained HUD layer: the controls/gain readout is rendered into a cached
+// target texture and only rebuilt after mark_dirty().
+class Hud {
+public:
+    Hud(SDL_Renderer* renderer, GlyphAtlas& glyphs);
+
+    void mark_dirty() { dirty = true; }
+    bool is_dirty() const { return dirty; }
+
+    // Gain change per key press, shown beside each gain
+    void set_steps(double kp, double ki, double kd) {
+        steps[0] = kp;
+        steps[1] = ki;
+        steps[2] = kd;
+        dirty = true;
+    }
+
+    void rebuild(double kp, double ki, double kd, const char* form);
+    void draw(int x, int y);
+    int height() const { return text_h; }
+
+private:
+    void ensure_texture(int w, int h);
+
+    SDL_Renderer* renderer;
+    GlyphAtlas& glyphs;
+    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> texture{nullptr, SDL_DestroyTexture};
+    int tex_w = 0, tex_h = 0;
+    int text_w = 0, text_h = 0;
+    char text[256] = "";
+    double steps[3] = {5.0, 0.1, 5.0};
+    bool dirty = true;
+};
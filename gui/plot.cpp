@@ -0,0 +1,108 @@
+#include "plot.h"
+#include "glyph_atlas.h"
+#include "core/telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+
+TrajectoryPlot::TrajectoryPlot(SDL_Renderer* renderer, GlyphAtlas& glyphs, FrameArena& arena)
+        : renderer(renderer), glyphs(glyphs), arena(arena) {}
+
+void TrajectoryPlot::draw_series(const LodPoint* points, std::size_t n, const SDL_FRect& area, double lo, double hi,
+                                 SDL_Color color) {
+    const double scale = area.h / (hi - lo);
+    SDL_FPoint* screen = arena.allocate_array<SDL_FPoint>(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        double v = std::clamp(static_cast<double>(points[i].v), lo, hi);
+        screen[i] = {area.x + area.w * points[i].x, static_cast<float>(area.y + (v - lo) * scale)};
+    }
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderDrawLinesF(renderer, screen, static_cast<int>(n));
+}
+
+namespace {
+const SDL_Color y_color{200, 0, 0, 255}, sp_color{0, 200, 0, 255};
+const SDL_Color err_color{0, 90, 220, 255}, out_color{230, 140, 0, 255};
+
+// The window [end - span, end) of the samples [first, last), `back` before the newest
+void window_of(const PlotView& view, uint64_t first, uint64_t last, uint64_t& end, double& span) {
+    end = last - std::min(view.back, last - first);
+    const double retained = static_cast<double>(last - first);
+    span = view.span > 0.0 ? std::min(view.span, retained) : retained;
+}
+}
+
+void TrajectoryPlot::paint_frame(int w, int h) {
+    SDL_Rect box{0, 0, w, h};
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderFillRect(renderer, &box);
+    SDL_SetRenderDrawColor(renderer, 160, 160, 160, 255);
+    SDL_RenderDrawRect(renderer, &box);
+
+    int x = 4, y = h + 2;
+    glyphs.draw("y", x, y, y_color);
+    glyphs.draw("setpoint", x + glyphs.measure("y "), y, sp_color);
+    glyphs.draw("error", x + glyphs.measure("y setpoint "), y, err_color);
+    glyphs.draw("output", x + glyphs.measure("y setpoint error "), y, out_color);
+}
+
+void TrajectoryPlot::draw_frame(const SDL_FRect& area) {
+    const int w = static_cast<int>(area.w), h = static_cast<int>(area.h);
+    const int layer_h = h + 2 + glyphs.line_height();
+    if (!frame || frame->width() != w || frame->height() != layer_h) {
+        frame = std::make_unique<CachedLayer>(renderer, w, layer_h);
+    }
+    if (frame->is_dirty()) frame->rebuild([&] { paint_frame(w, h); });
+    frame->draw(static_cast<int>(area.x), static_cast<int>(area.y));
+}
+
+template <class Raw>
+void TrajectoryPlot::draw_window(const TrajectoryPyramid& lod, const Raw& raw, uint64_t first, uint64_t end,
+                                 double span, const SDL_FRect& area) {
+    if (end < first + 2) return;
+    const std::size_t columns = std::max<std::size_t>(1, static_cast<std::size_t>(area.w));
+    LodPoint* points = arena.allocate_array<LodPoint>(2 * columns + 2);
+    auto series = [&](PlotSeries s, double lo, double hi, SDL_Color color) {
+        std::size_t n = lod.decimate(static_cast<std::size_t>(s), first, end, span, columns, raw, points);
+        if (n >= 2) draw_series(points, n, area, lo, hi, color);
+    };
+    // Screen-space series keep the window's orientation (y grows downwards)
+    series(PlotSeries::Setpoint, 0, WINDOW_HEIGHT, sp_color);
+    series(PlotSeries::Y, 0, WINDOW_HEIGHT, y_color);
+    series(PlotSeries::Error, -WINDOW_HEIGHT / 2.0, WINDOW_HEIGHT / 2.0, err_color);
+
+    // The output scale follows the visible window, read off its decimated points
+    std::size_t n = lod.decimate(static_cast<std::size_t>(PlotSeries::Output), first, end, span, columns, raw, points);
+    double peak = 1.0;
+    for (std::size_t i = 0; i < n; ++i) peak = std::max(peak, static_cast<double>(std::fabs(points[i].v)));
+    if (n >= 2) draw_series(points, n, area, -peak, peak, out_color);
+}
+
+void TrajectoryPlot::draw(const TrajectoryHistory& history, const PlotView& view, const SDL_FRect& area) {
+    draw_frame(area);
+    uint64_t end;
+    double span;
+    window_of(view, history.first(), history.end(), end, span);
+    // A ring that has not filled yet still spans its full capacity, filling from the right
+    if (view.span <= 0.0) span = static_cast<double>(history.capacity());
+    auto raw = [&](uint64_t index, std::size_t series) { return history.value(index, series); };
+    draw_window(history.pyramid(), raw, history.first(), end, span, area);
+}
+
+void TrajectoryPlot::draw(const TelemetryReader& log, const TrajectoryPyramid& lod, uint64_t newest,
+                          const PlotView& view, const SDL_FRect& area) {
+    draw_frame(area);
+    uint64_t end;
+    double span;
+    window_of(view, 0, newest + 1, end, span);
+    auto raw = [&](uint64_t index, std::size_t series) {
+        const TelemetryRecord& r = log[index];
+        switch (static_cast<PlotSeries>(series)) {
+            case PlotSeries::Y: return r.pv;
+            case PlotSeries::Setpoint: return r.setpoint;
+            case PlotSeries::Error: return r.error;
+            default: return r.output;
+        }
+    };
+    draw_window(lod, raw, 0, end, span, area);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "cached_layer.h"
+#include "core/frame_arena.h"
+#include "core/trajectory.h"
+
+#include <SDL.h>
+#include <cstdint>
+#include <memory>
+
+class GlyphAtlas;
+class TelemetryReader;
+
+// Which samples the plot spans: the `span` samples ending `back` samples
+// before the newest. span 0 shows everything retained; back 0 follows the
+// newest sample as it arrives.
+struct PlotView {
+    double span = 0.0;
+    uint64_t back = 0;
+};
+
+// Scrolling plot of position, setpoint, error and controller output. Each
+// series is decimated through a TrajectoryPyramid to at most two points
+// per pixel column, so a frame costs the same for ten seconds of history
+// as for ten hours, and drawn with one SDL_RenderDrawLinesF call over
+// points in the FrameArena; the background, border and legend are a
+// CachedLayer.
+class TrajectoryPlot {
+public:
+    TrajectoryPlot(SDL_Renderer* renderer, GlyphAtlas& glyphs, FrameArena& arena);
+
+    void draw(const TrajectoryHistory& history, const PlotView& view, const SDL_FRect& area);
+    // A replayed log up to record `newest`, through a pyramid built over the whole log
+    void draw(const TelemetryReader& log, const TrajectoryPyramid& lod, uint64_t newest, const PlotView& view,
+              const SDL_FRect& area);
+    void mark_dirty() { if (frame) frame->mark_dirty(); }
+
+private:
+    void paint_frame(int w, int h);
+    void draw_frame(const SDL_FRect& area);
+    template <class Raw>
+    void draw_window(const TrajectoryPyramid& lod, const Raw& raw, uint64_t first, uint64_t end, double span,
+                     const SDL_FRect& area);
+    void draw_series(const LodPoint* points, std::size_t n, const SDL_FRect& area, double lo, double hi,
+                     SDL_Color color);
+
+    SDL_Renderer* renderer;
+    GlyphAtlas& glyphs;
+    FrameArena& arena;
+    std::unique_ptr<CachedLayer> frame;  // sized for the latest area plus the legend row
+};
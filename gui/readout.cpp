@@ -0,0 +1,57 @@
+#include "readout.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+std::size_t format_fixed(char* out, std::size_t capacity, double value, int precision) {
+    if (capacity == 0) return 0;
+    if (std::isnan(value)) {
+        out[0] = '-';
+        return 1;
+    }
+    auto [end, error] = std::to_chars(out, out + capacity, value, std::chars_format::fixed, precision);
+    if (error != std::errc()) {
+        // Too wide for the buffer: a column of '#' rather than a clipped number
+        std::fill(out, out + capacity, '#');
+        return capacity;
+    }
+    return static_cast<std::size_t>(end - out);
+}
+
+int ReadoutPanel::add_label(std::string_view text, int x, int y, SDL_Color color) {
+    // The views into label_text are taken in draw(), once the panel is built
+    label_text.emplace_back(text);
+    labels.insert(labels.begin() + static_cast<std::ptrdiff_t>(label_text.size() - 1), {{}, x, y, color});
+    return glyphs.measure(text);
+}
+
+std::size_t ReadoutPanel::add_number(int right, int y, int precision, SDL_Color color) {
+    Number n{};
+    n.right = right;
+    n.y = y;
+    n.precision = precision;
+    n.color = color;
+    n.text[0] = '-';
+    n.length = 1;
+    values.push_back(n);
+    labels.push_back({{}, right, y, color});
+    return values.size() - 1;
+}
+
+void ReadoutPanel::set(std::size_t index, double value) {
+    Number& n = values[index];
+    n.length = format_fixed(n.text, sizeof(n.text), value, n.precision);
+}
+
+void ReadoutPanel::draw() {
+    const std::size_t static_count = label_text.size();
+    for (std::size_t i = 0; i < static_count; ++i) labels[i].text = label_text[i];
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        const Number& n = values[i];
+        GlyphAtlas::Label& l = labels[static_count + i];
+        l.text = std::string_view(n.text, n.length);
+        l.x = n.right - glyphs.measure(l.text);
+    }
+    glyphs.draw(labels.data(), labels.size());
+}
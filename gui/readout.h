@@ -0,0 +1,53 @@
+#pragma once
+
+#include "glyph_atlas.h"
+
+#include <SDL.h>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Formats `value` with `precision` decimals into `out` through
+// std::to_chars: no locale, no allocation, no format string to parse.
+// NaN becomes "-"; returns the length written, truncated to `capacity`.
+std::size_t format_fixed(char* out, std::size_t capacity, double value, int precision);
+
+// Numbers that change every frame (timings, metrics, live error) would
+// defeat a per-string texture cache, so a panel keeps none: each number
+// sits in a fixed buffer that set() reformats in place, and draw() hands
+// every number and static label to GlyphAtlas as a single batch of quads
+// from the already rasterized digits. Numbers are right-aligned on their
+// column so that changing digits do not shift the layout. The layout is
+// built once with add_label()/add_number(); after that set() and draw()
+// never allocate.
+class ReadoutPanel {
+public:
+    explicit ReadoutPanel(GlyphAtlas& glyphs) : glyphs(glyphs) {}
+
+    // Static text, copied once; returns its width in pixels
+    int add_label(std::string_view text, int x, int y, SDL_Color color);
+    // A number whose right edge is at `right`; returns its index for set()
+    std::size_t add_number(int right, int y, int precision, SDL_Color color);
+
+    void set(std::size_t index, double value);
+    void draw();
+
+    std::size_t numbers() const { return values.size(); }
+    // Width of `digits` digits, for spacing number columns
+    int digit_width(int digits) const { return digits * glyphs.measure("0"); }
+
+private:
+    struct Number {
+        char text[24];
+        std::size_t length = 0;
+        int right, y;
+        int precision;
+        SDL_Color color;
+    };
+
+    GlyphAtlas& glyphs;
+    std::vector<std::string> label_text;
+    std::vector<GlyphAtlas::Label> labels;  // the static labels, then one per number
+    std::vector<Number> values;
+};
@@ -0,0 +1,119 @@
+#include "render_backend.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr Uint32 NEEDED = SDL_RENDERER_TARGETTEXTURE;  // CachedLayer and the HUD paint into textures
+
+void log_drivers() {
+    const int n = SDL_GetNumRenderDrivers();
+    for (int i = 0; i < n; ++i) {
+        SDL_RendererInfo info;
+        if (SDL_GetRenderDriverInfo(i, &info)) continue;
+        SDL_Log("Render driver %d: %s%s%s%s", i, info.name,
+                info.flags & SDL_RENDERER_ACCELERATED ? ", accelerated" : "",
+                info.flags & SDL_RENDERER_PRESENTVSYNC ? ", vsync" : "",
+                info.flags & NEEDED ? ", target textures" : "");
+    }
+}
+
+bool headless_video_driver() {
+    const char* driver = SDL_GetCurrentVideoDriver();
+    return driver && (!std::strcmp(driver, "dummy") || !std::strcmp(driver, "offscreen"));
+}
+
+// The first accelerated driver that opens, with vsync if it can
+SDL_Renderer* open_gpu(SDL_Window* window) {
+    const int n = SDL_GetNumRenderDrivers();
+    for (Uint32 vsync : {static_cast<Uint32>(SDL_RENDERER_PRESENTVSYNC), Uint32{0}}) {
+        for (int i = 0; i < n; ++i) {
+            SDL_RendererInfo info;
+            if (SDL_GetRenderDriverInfo(i, &info) || !(info.flags & SDL_RENDERER_ACCELERATED) ||
+                (info.flags & NEEDED) != NEEDED) {
+                continue;
+            }
+            if (SDL_Renderer* r = SDL_CreateRenderer(window, i, SDL_RENDERER_ACCELERATED | NEEDED | vsync)) return r;
+            SDL_Log("Render driver %s failed: %s", info.name, SDL_GetError());
+        }
+    }
+    return nullptr;
+}
+
+void open_offscreen(RenderOutput& out, int w, int h) {
+    if (SDL_Init(SDL_INIT_EVENTS)) throw std::runtime_error(SDL_GetError());
+    // The software renderer's own format, so drawing never converts
+    out.surface.reset(SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888));
+    if (!out.surface) throw std::runtime_error(SDL_GetError());
+    out.renderer.reset(SDL_CreateSoftwareRenderer(out.surface.get()));
+    if (!out.renderer) throw std::runtime_error(SDL_GetError());
+    out.backend = RenderBackend::Offscreen;
+}
+
+} // namespace
+
+const char* render_backend_name(RenderBackend backend) {
+    switch (backend) {
+        case RenderBackend::Auto: return "auto";
+        case RenderBackend::Gpu: return "gpu";
+        case RenderBackend::Software: return "software";
+        case RenderBackend::Offscreen: return "offscreen";
+    }
+    return "?";
+}
+
+bool parse_render_backend(const char* name, RenderBackend& out) {
+    for (RenderBackend b : {RenderBackend::Auto, RenderBackend::Gpu, RenderBackend::Software, RenderBackend::Offscreen}) {
+        if (!std::strcmp(name, render_backend_name(b))) {
+            out = b;
+            return true;
+        }
+    }
+    return false;
+}
+
+RenderOutput open_render_output(RenderBackend requested, const char* title, int w, int h) {
+    RenderOutput out;
+    if (requested != RenderBackend::Offscreen) {
+        if (SDL_Init(SDL_INIT_VIDEO)) {
+            if (requested != RenderBackend::Auto) throw std::runtime_error(SDL_GetError());
+            SDL_Log("No video driver (%s); rendering offscreen", SDL_GetError());
+            requested = RenderBackend::Offscreen;
+        } else if (requested == RenderBackend::Auto && headless_video_driver()) {
+            SDL_Log("Video driver %s has no display; rendering offscreen", SDL_GetCurrentVideoDriver());
+            SDL_QuitSubSystem(SDL_INIT_VIDEO);
+            requested = RenderBackend::Offscreen;
+        }
+    }
+    log_drivers();
+
+    if (requested == RenderBackend::Offscreen) {
+        open_offscreen(out, w, h);
+    } else {
+        out.window.reset(SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, w, h, SDL_WINDOW_SHOWN));
+        if (!out.window) {
+            if (requested != RenderBackend::Auto) throw std::runtime_error(SDL_GetError());
+            SDL_Log("Cannot open a window (%s); rendering offscreen", SDL_GetError());
+            SDL_QuitSubSystem(SDL_INIT_VIDEO);
+            open_offscreen(out, w, h);
+        } else {
+            if (requested != RenderBackend::Software) {
+                out.renderer.reset(open_gpu(out.window.get()));
+                out.backend = RenderBackend::Gpu;
+                if (!out.renderer && requested == RenderBackend::Gpu) {
+                    throw std::runtime_error("no accelerated render driver with target textures");
+                }
+            }
+            if (!out.renderer) {
+                out.renderer.reset(SDL_CreateRenderer(out.window.get(), -1, SDL_RENDERER_SOFTWARE | NEEDED));
+                if (!out.renderer) throw std::runtime_error(SDL_GetError());
+                out.backend = RenderBackend::Software;
+            }
+        }
+    }
+    if (SDL_GetRendererInfo(out.renderer.get(), &out.info)) throw std::runtime_error(SDL_GetError());
+    SDL_Log("Rendering %s with %s%s", render_backend_name(out.backend), out.info.name,
+            out.vsync() ? ", vsync" : "");
+    return out;
+}
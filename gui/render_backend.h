@@ -0,0 +1,36 @@
+#pragma once
+
+#include <SDL.h>
+#include <memory>
+
+// Where frames are drawn. Gpu and Software open a window; Offscreen draws
+// with SDL's software renderer into a surface that is never shown, so it
+// needs no display server and never waits for vsync. Auto takes the first
+// accelerated driver that works, then software, then offscreen when no
+// video driver can open a window at all (or only "dummy"/"offscreen" is
+// available).
+enum class RenderBackend { Auto, Gpu, Software, Offscreen };
+
+const char* render_backend_name(RenderBackend backend);
+// "auto", "gpu", "software" or "offscreen"; false for anything else
+bool parse_render_backend(const char* name, RenderBackend& out);
+
+// A window (or offscreen surface) and its renderer, destroyed renderer
+// first. `backend` is what was opened, never Auto.
+struct RenderOutput {
+    std::unique_ptr<SDL_Window, decltype(&SDL_DestroyWindow)> window{nullptr, SDL_DestroyWindow};
+    std::unique_ptr<SDL_Surface, decltype(&SDL_FreeSurface)> surface{nullptr, SDL_FreeSurface};
+    std::unique_ptr<SDL_Renderer, decltype(&SDL_DestroyRenderer)> renderer{nullptr, SDL_DestroyRenderer};
+    RenderBackend backend = RenderBackend::Offscreen;
+    SDL_RendererInfo info{};
+
+    bool vsync() const { return (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0; }
+};
+
+// Initializes SDL (video, or only events for Offscreen), logs the render
+// drivers SDL offers and opens `requested` at w x h. Gpu tries every
+// accelerated driver that supports target textures in SDL's order of
+// preference, with vsync and then without. Throws std::runtime_error when
+// an explicitly requested backend cannot be opened; Auto only throws if
+// not even the offscreen surface can be.
+RenderOutput open_render_output(RenderBackend requested, const char* title, int w, int h);
@@ -0,0 +1,133 @@
+#include "tile_view.h"
+#include "glyph_atlas.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float GAP = 4.0f;           // between tiles, px
+constexpr float LINE_HALF = 0.75f;    // half the thickness of setpoint lines and trails
+constexpr float TRAIL_SPACING = 2.0f;  // screen px between trail points
+
+const SDL_Color ball_color{200, 0, 0, 255};
+const SDL_Color trail_color{230, 120, 120, 255};
+const SDL_Color setpoint_color{0, 200, 0, 255};
+
+// Appends a quad as two triangles; corners in order around the quad
+void push_quad(SDL_Vertex*& v, int*& index, int& base, SDL_FPoint a, SDL_FPoint b, SDL_FPoint c, SDL_FPoint d,
+               SDL_Color color) {
+    v[0] = {a, color, {0, 0}};
+    v[1] = {b, color, {0, 0}};
+    v[2] = {c, color, {0, 0}};
+    v[3] = {d, color, {0, 0}};
+    const int quad[6] = {base, base + 1, base + 2, base, base + 2, base + 3};
+    std::copy(quad, quad + 6, index);
+    v += 4;
+    index += 6;
+    base += 4;
+}
+
+} // namespace
+
+TileView::TileView(SDL_Renderer* renderer, GlyphAtlas& glyphs, FrameArena& arena, std::size_t tiles, std::size_t trail)
+        : renderer(renderer), glyphs(glyphs), arena(arena), tiles(std::clamp<std::size_t>(tiles, 1, MAX_TILES)),
+          background(std::make_unique<CachedLayer>(renderer, WINDOW_WIDTH, WINDOW_HEIGHT, true)),
+          trail_capacity(std::max<std::size_t>(trail, 2)), trails(this->tiles * trail_capacity) {
+    // As square a grid as the count allows: 2 -> 2x1, 3-4 -> 2x2, 5-6 -> 3x2, ...
+    const std::size_t cols = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(this->tiles))));
+    const std::size_t rows = (this->tiles + cols - 1) / cols;
+    const float w = static_cast<float>(WINDOW_WIDTH) / cols, h = static_cast<float>(WINDOW_HEIGHT) / rows;
+    for (std::size_t i = 0; i < this->tiles; ++i) {
+        rects[i] = {(i % cols) * w + GAP / 2, (i / cols) * h + GAP / 2, w - GAP, h - GAP};
+    }
+    scale_x = (w - GAP) / WINDOW_WIDTH;
+    scale_y = (h - GAP) / WINDOW_HEIGHT;
+    ball_size = std::max(BALL_SIZE * std::min(scale_x, scale_y), 3.0f);
+}
+
+bool TileView::world_y_at(int x, int y, double& world_y) const {
+    for (std::size_t i = 0; i < tiles; ++i) {
+        const SDL_FRect& r = rects[i];
+        if (x >= r.x && x < r.x + r.w && y >= r.y && y < r.y + r.h) {
+            world_y = (y - r.y) / scale_y;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TileView::push(const BatchEngine& engine) {
+    trail_head = (trail_head + 1) % trail_capacity;
+    for (std::size_t i = 0; i < tiles; ++i) {
+        trails[i * trail_capacity + trail_head] = static_cast<float>(engine.y[i] + BALL_SIZE / 2.0);
+    }
+    trail_size = std::min(trail_size + 1, trail_capacity);
+}
+
+void TileView::paint_background() {
+    SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
+    SDL_RenderClear(renderer);
+    for (std::size_t i = 0; i < tiles; ++i) {
+        const SDL_FRect& r = rects[i];
+        SDL_SetRenderDrawColor(renderer, 240, 240, 240, 255);
+        SDL_RenderFillRectF(renderer, &r);
+        SDL_SetRenderDrawColor(renderer, 225, 225, 225, 255);
+        for (int y = 100; y < WINDOW_HEIGHT; y += 100) {
+            float sy = r.y + y * scale_y;
+            SDL_RenderDrawLineF(renderer, r.x, sy, r.x + r.w, sy);
+        }
+        SDL_SetRenderDrawColor(renderer, 160, 160, 160, 255);
+        SDL_RenderDrawRectF(renderer, &r);
+    }
+}
+
+void TileView::draw(const BatchEngine& engine, const std::vector<double>& prev_y, double alpha,
+                    const char* const* labels) {
+    if (background->is_dirty()) background->rebuild([&] { paint_background(); });
+    background->draw(0, 0);
+
+    // Trails are thinned to one point every TRAIL_SPACING px of tile width
+    const std::size_t points = std::min(trail_size, static_cast<std::size_t>(rects[0].w / TRAIL_SPACING) + 1);
+    const std::size_t stride = points > 1 ? (trail_capacity - 1) / (points - 1) : 1;
+    const std::size_t shown = points > 1 ? std::min(points, (trail_size - 1) / stride + 1) : points;
+    const std::size_t quads = tiles * (2 + (shown > 1 ? shown - 1 : 0));
+    SDL_Vertex* vertices = arena.allocate_array<SDL_Vertex>(quads * 4);
+    int* indices = arena.allocate_array<int>(quads * 6);
+    SDL_Vertex* v = vertices;
+    int* index = indices;
+    int base = 0;
+
+    const float x_step = stride * (rects[0].w - ball_size) / (trail_capacity - 1);
+    for (std::size_t i = 0; i < tiles; ++i) {
+        const SDL_FRect& r = rects[i];
+        const float* trail = &trails[i * trail_capacity];
+        auto screen_y = [&](double world_y) { return r.y + static_cast<float>(world_y) * scale_y; };
+
+        float sp = screen_y(engine.setpoint[i]);
+        push_quad(v, index, base, {r.x, sp - LINE_HALF}, {r.x + r.w, sp - LINE_HALF}, {r.x + r.w, sp + LINE_HALF},
+                  {r.x, sp + LINE_HALF}, setpoint_color);
+
+        // Newest point at the ball's centre, older ones to the left
+        const float head_x = r.x + r.w - ball_size / 2;
+        for (std::size_t p = 0; p + 1 < shown; ++p) {
+            float y0 = screen_y(trail[(trail_head + trail_capacity - p * stride) % trail_capacity]);
+            float y1 = screen_y(trail[(trail_head + trail_capacity - (p + 1) * stride) % trail_capacity]);
+            float x0 = head_x - p * x_step, x1 = x0 - x_step;
+            push_quad(v, index, base, {x1, y1 - LINE_HALF}, {x0, y0 - LINE_HALF}, {x0, y0 + LINE_HALF},
+                      {x1, y1 + LINE_HALF}, trail_color);
+        }
+
+        double ball_y = prev_y[i] + (engine.y[i] - prev_y[i]) * alpha + BALL_SIZE / 2.0;
+        float top = screen_y(ball_y) - ball_size / 2, left = r.x + r.w - ball_size;
+        push_quad(v, index, base, {left, top}, {left + ball_size, top}, {left + ball_size, top + ball_size},
+                  {left, top + ball_size}, ball_color);
+    }
+    SDL_RenderGeometry(renderer, nullptr, vertices, base, indices, static_cast<int>(index - indices));
+
+    GlyphAtlas::Label* text = arena.allocate_array<GlyphAtlas::Label>(tiles);
+    for (std::size_t i = 0; i < tiles; ++i) {
+        text[i] = {labels[i], static_cast<int>(rects[i].x) + 6, static_cast<int>(rects[i].y) + 4, {0, 0, 0, 255}};
+    }
+    glyphs.draw(text, tiles);
+}
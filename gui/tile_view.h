@@ -0,0 +1,58 @@
+#pragma once
+
+#include "cached_layer.h"
+#include "core/batch_engine.h"
+#include "core/frame_arena.h"
+
+#include <SDL.h>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class GlyphAtlas;
+
+// Side-by-side view of the lanes of a BatchEngine, one tile each in a grid
+// that fills the window, for comparing tunings on the same setpoint. Each
+// tile shows the whole world scaled down: a setpoint line, a trail of the
+// recent pv and the ball at the trail's head. Tile frames and grid lines
+// are one CachedLayer; all lines, trails and balls of every tile go out in
+// a single SDL_RenderGeometry call, and the labels in one shared-atlas batch.
+class TileView {
+public:
+    static constexpr std::size_t MAX_TILES = 16;
+
+    // `trail` steps of pv are kept per tile and span the tile's width
+    TileView(SDL_Renderer* renderer, GlyphAtlas& glyphs, FrameArena& arena, std::size_t tiles, std::size_t trail);
+
+    std::size_t size() const { return tiles; }
+
+    // World height under window point (x, y); false between or outside tiles
+    bool world_y_at(int x, int y, double& world_y) const;
+
+    // Appends the latest step of every lane to the trails
+    void push(const BatchEngine& engine);
+    void clear_trails() { trail_size = 0; }
+
+    // Interpolates each ball between prev_y and the engine by alpha in [0, 1];
+    // labels[i] (may span lines) goes in the top left corner of tile i
+    void draw(const BatchEngine& engine, const std::vector<double>& prev_y, double alpha, const char* const* labels);
+    void mark_dirty() { background->mark_dirty(); }
+
+private:
+    void paint_background();
+
+    SDL_Renderer* renderer;
+    GlyphAtlas& glyphs;
+    FrameArena& arena;
+    std::size_t tiles;
+    std::array<SDL_FRect, MAX_TILES> rects{};
+    float scale_x = 1.0f, scale_y = 1.0f;  // world px -> tile px
+    float ball_size = BALL_SIZE;
+    std::unique_ptr<CachedLayer> background;
+
+    // Trails, tile-major: trail_capacity pv values per tile in one ring
+    std::size_t trail_capacity;
+    std::size_t trail_head = 0, trail_size = 0;
+    std::vector<float> trails;
+};
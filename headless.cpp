@@ -0,0 +1,2146 @@
+#include "core/alloc_counter.h"
+#include "core/app_config.h"
+#include "core/async_logger.h"
+#include "core/auto_tune.h"
+#include "core/batch_engine.h"
+#include "core/compact_sweep.h"
+#include "core/control_graph.h"
+#include "core/determinism.h"
+#include "core/exporter.h"
+#include "core/frequency_response.h"
+#include "core/gain_schedule.h"
+#include "core/gradient_tune.h"
+#include "core/hil.h"
+#include "core/lane_stepper.h"
+#include "core/monte_carlo.h"
+#include "core/multi_axis.h"
+#include "core/multi_rate.h"
+#include "core/numa.h"
+#include "core/perf_counters.h"
+#include "core/plant.h"
+#include "core/realtime.h"
+#include "core/reference.h"
+#include "core/result_cache.h"
+#include "core/result_store.h"
+#include "core/scenario_script.h"
+#include "core/simulation.h"
+#include "core/sweep.h"
+#include "core/sweep_cluster.h"
+#include "core/thread_pool.h"
+#include "core/trajectory.h"
+#ifdef PID_HAVE_GPU
+#include "gpu/gl_sweep.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+struct Options {
+    uint64_t steps = 10'000'000;
+    double dt = FIXED_TIMESTEP;
+    double kp = 80.0;
+    double ki = 0.0;
+    double kd = 0.0;
+    double setpoint = WINDOW_HEIGHT / 2.0;
+    uint64_t lanes = 0;  // 0 = scalar Simulation, otherwise BatchEngine
+    int unroll = -1;     // BatchEngine::set_unroll for --lanes, -1 = its default
+    bool sweep = false;
+    SweepConfig sweep_config;
+    bool swept[3] = {false, false, false};  // kp, ki, kd
+    bool compact = false;                   // sweep in the float32 CompactEngine layout
+    CompactGains compact_gains = CompactGains::Float32;
+    unsigned threads = 0;
+    Integrator integrator = Integrator::SemiImplicitEuler;
+    bool metrics = false;
+    bool gpu = false;
+    std::string hil;  // serial device, "sim", or empty
+    unsigned baud = 230400;
+    bool steps_given = false;
+    RealtimeOptions realtime;
+    std::string cache_path;  // on-disk sweep result store, empty = off
+    std::string store_path;  // indexed columnar result store, empty = off
+    std::string where;       // query --store instead of running anything
+    std::size_t limit = 20;  // query rows printed
+    std::string graph;       // "single", "cascade", or empty for the fixed loop
+    int axes = 0;            // MultiAxisPlant axes, 0 = off
+    double target[MultiAxisPlant::MAX_AXES] = {};
+    int targets = 0;         // entries of `target` given by --target
+    std::string plant;       // core/plant.h model name, empty = Simulation
+    bool alloc_check = false;  // fail if the stepping loop allocates
+    bool counters = false;     // hardware counters around the stepping loop, and peak RSS
+    std::string golden;        // trajectory file to check the scalar loop against
+    bool write_golden = false;  // record `golden` instead of checking it
+    std::string hash_out;       // state hash log to write, empty = none
+    std::string hash_check;     // state hash log to verify the run against, empty = none
+    std::shared_ptr<const StateHashLog> expected_hashes;  // loaded from hash_check
+    uint64_t hash_every = 0;    // checkpoint interval, 0 = the checked log's, or 1000
+    int coordinator_port = 0;   // serve the sweep to workers on this port, 0 = local sweep
+    std::string worker;         // coordinator HOST:PORT to take chunks from
+    ClusterOptions cluster;
+    bool cluster_tuning = false;  // --chunk or --chunk-timeout given
+    std::size_t monte_carlo = 0;  // robustness samples per gain set, 0 = off
+    MonteCarloConfig mc;          // seed and plant variation for --monte-carlo
+    bool mc_tuning = false;       // an --mc-* option given
+    SensorModel sensor;           // measurement model for scalar and --lanes runs
+    ComputeTimingModel timing;    // compute delay and missed updates, scalar and --monte-carlo runs
+    bool bode = false;            // frequency-response analysis instead of a time run
+    bool auto_tune = false;       // CMA-ES gain search instead of a time run
+    AutoTuneConfig tune;
+    bool tune_tuning = false;     // --tune-box or --tune-effort given
+    bool cma_tuning = false;      // --tune-population or --tune-generations given
+    bool grad_tune = false;       // gradient descent from --kp/--ki/--kd with AD gradients
+    unsigned grad_iterations = 0; // evaluation cap for --grad-tune, 0 = default
+    FrequencyResponseConfig bode_config;
+    std::string bode_file;        // CSV of the response, empty = none
+    std::string export_path;      // trajectory or sweep cells, streamed; empty = none
+    std::string trajectories_path;  // every sweep cell's trajectory, streamed; empty = none
+    uint64_t trajectory_every = 0;  // steps between --trajectories rows, 0 = not given (every step)
+    std::string reference;        // setpoint per step to track, empty = fixed --setpoint
+    double max_rms = 0.0;         // fail a --reference run above this RMS error, 0 = off
+    bool dt_given = false;
+    std::string schedule_path;    // gain schedule for scalar and --lanes runs, empty = fixed gains
+    std::shared_ptr<const GainSchedule> schedule;
+    bool multi_rate = false;      // plant, controller and sensor at their own rates
+    MultiRateConfig rates;
+    std::string script_path;      // scenario script for scalar and --lanes runs, empty = none
+    std::string config_path;      // core/app_config.h file for scalar runs, empty = compiled defaults
+    std::string log_path;         // core/async_logger.h event log of a scalar run, "-" = stderr
+    bool numa = false;            // pin sweep threads node by node; lane state is placed by first touch
+    std::size_t plot_lod = 0;     // pixel columns to check the plot's min/max pyramid at, 0 = off
+    PidForm form = PidForm::Positional;  // controller form for scalar, --lanes, --multi-rate and sweep runs
+    double d_filter = 0.0;        // derivative filter time constant, s; 0 = unfiltered
+    bool d_on_measurement = false;  // differentiate -pv instead of the error
+    Compensation compensation;    // feed-forward and disturbance observer, off by default
+    AppConfig config;
+    std::shared_ptr<const ScenarioScript> script;
+    double script_stagger = 0.0;  // seconds lane i+1 plays the script after lane i
+    bool seed_given = false;
+    bool gains_given = false;
+    bool setpoint_given = false;
+};
+
+void print_metrics(const LoopMetrics& m) {
+    auto time_or_dash = [](double t) { return std::isnan(t) ? std::string("-") : std::to_string(t) + " s"; };
+    std::printf("IAE          %.6f\n", m.iae);
+    std::printf("ISE          %.6f\n", m.ise);
+    std::printf("ITAE         %.6f\n", m.itae);
+    std::printf("overshoot    %.3f %%\n", m.overshoot * 100.0);
+    std::printf("rise time    %s\n", time_or_dash(m.rise_time).c_str());
+    std::printf("settling     %s\n", time_or_dash(m.settling_time).c_str());
+    std::printf("effort       %.6f\n", m.effort);
+}
+
+void print_usage() {
+    std::printf(
+            "Usage: pid_headless [options]\n"
+            "  --steps N       closed-loop steps to run (default 10000000)\n"
+            "  --dt S          timestep in seconds (default 1/60)\n"
+            "  --kp/--ki/--kd  controller gains (default 80 0 0)\n"
+            "  --setpoint Y    target height in pixels (default 400)\n"
+            "  --integrator M  euler (default), zoh or rk4; scalar runs only\n"
+            "  --metrics       report IAE/ISE/ITAE, overshoot, rise/settling time, effort\n"
+            "  --alloc-check   count operator new calls in the stepping loop and exit 2\n"
+            "                  if there were any (scalar and --lanes runs)\n"
+            "  --counters      report cycles, instructions, L1d/LLC and branch misses per\n"
+            "                  step from perf_event, and peak RSS (scalar and single-thread\n"
+            "                  --lanes runs)\n"
+            "  --golden FILE   check every step of the scalar loop bit for bit against the\n"
+            "                  trajectory in FILE; exit 2 on the first difference\n"
+            "  --write-golden FILE\n"
+            "                  record the scalar trajectory to FILE instead\n"
+            "  --record-hashes FILE\n"
+            "                  write a rolling hash of the controller and ball state to\n"
+            "                  FILE every --hash-every steps (scalar and --reference runs)\n"
+            "  --check-hashes FILE\n"
+            "                  verify the run bit for bit against such a log, e.g. one from\n"
+            "                  SDL_game --record-hashes; exit 2 at the first checkpoint that\n"
+            "                  differs. --steps defaults to the log's length\n"
+            "  --hash-every N  steps between hash checkpoints (default 1000)\n"
+            "  --export FILE   stream the scalar trajectory, or every sweep cell, to FILE from\n"
+            "                  a background writer: CSV, or .arrow/.parquet in builds with\n"
+            "                  -DPID_ARROW=ON\n"
+            "  --trajectories FILE\n"
+            "                  stream every sweep candidate's trajectory to FILE as it runs\n"
+            "                  (cell, step, time, pv, velocity; format as --export)\n"
+            "  --trajectory-every N\n"
+            "                  keep every Nth step of --trajectories (default 1)\n"
+            "  --reference FILE\n"
+            "                  move the setpoint every step as recorded in FILE (SDL_game\n"
+            "                  --record-reference, or a --record telemetry log) and report\n"
+            "                  the tracking error; --steps defaults to its length, --dt to\n"
+            "                  its timestep\n"
+            "  --schedule FILE look Kp/Ki/Kd up every step from the gain schedule in FILE,\n"
+            "                  interpolated over y, velocity and/or setpoint (scalar and\n"
+            "                  --lanes runs; lanes are checked against the scalar loop)\n"
+            "  --multi-rate P:C:S\n"
+            "                  integrate the plant at P Hz, update the controller at C Hz\n"
+            "                  and sample the sensor at S Hz (C and S must divide P) from\n"
+            "                  a precomputed schedule; --steps counts controller updates\n"
+            "  --max-rms PX    exit 2 if the --reference RMS tracking error exceeds PX\n"
+            "  --script FILE   apply the timed setpoint, gain, disturbance and sensor events\n"
+            "                  of a scenario script (scalar and --lanes runs); --steps\n"
+            "                  defaults to one second past the last event\n"
+            "  --config FILE   plant constants, gains and timestep from a \"# pid config\"\n"
+            "                  file, as SDL_game --config (scalar runs); --dt, --kp,\n"
+            "                  --ki and --kd still win\n"
+            "  --log FILE      log integral saturation, wall hits and missed updates as\n"
+            "                  they happen, formatted off the step loop; - = stderr\n"
+            "                  (scalar runs)\n"
+            "  --plot-lod W    record the scalar run into the plot's history and check its\n"
+            "                  min/max pyramid against a scan of the samples for windows\n"
+            "                  at every zoom, W pixel columns wide; exit 2 on a mismatch\n"
+            "  --pid-form F    positional (default) or velocity: the incremental controller,\n"
+            "                  which adds a change to its held output each update (scalar\n"
+            "                  euler/zoh, --lanes, --multi-rate and local --sweep-* runs)\n"
+            "  --d-filter TF   low-pass the derivative with time constant TF s\n"
+            "  --d-on-measurement\n"
+            "                  differentiate the measurement instead of the error, so\n"
+            "                  setpoint steps do not kick the output (both: scalar\n"
+            "                  euler/zoh, --lanes and --multi-rate runs)\n"
+            "  --feed-forward F\n"
+            "                  add F px/s^2 to the controller output, or \"gravity\" for\n"
+            "                  the plant's own (scalar, --lanes, --multi-rate, --auto-tune\n"
+            "                  and uncached local --sweep-* runs)\n"
+            "  --observer TQ   subtract a disturbance observer's estimate of the force the\n"
+            "                  plant adds, low-passed with time constant TQ s (scalar\n"
+            "                  euler/zoh, --lanes, --multi-rate and --auto-tune runs)\n"
+            "  --script-stagger S\n"
+            "                  start lane i's script i*S seconds late (--lanes)\n"
+            "  --lanes N       step N identical loops with the batched SoA engine\n"
+            "  --unroll K      steps the --lanes register kernel unrolls: 1, 4 (default), 8\n"
+            "                  or 16, or 0 for one kernel call per step\n"
+            "  --bode          measure the open-loop frequency response by injecting\n"
+            "                  sines, one batch lane per frequency, and report gain and\n"
+            "                  phase margins; --sensor-delay is included\n"
+            "  --bode-hz A:B:N log-spaced grid for --bode (default 0.05:25:200)\n"
+            "  --auto-tune     search Kp/Ki/Kd by CMA-ES for the lowest ITAE + effort\n"
+            "                  penalty over --steps, a batch lane per candidate\n"
+            "  --tune-box KP:KI:KD\n"
+            "                  upper gain bounds of the search (default 400:20:60)\n"
+            "  --tune-population N, --tune-generations N\n"
+            "                  candidates per generation (default 64) and generation cap (60)\n"
+            "  --tune-effort W weight of the control effort in the cost (default 0.001)\n"
+            "  --grad-tune     descend from --kp/--ki/--kd on the same cost, with exact\n"
+            "                  gradients from one dual-number pass per step; takes\n"
+            "                  --tune-box and --tune-effort\n"
+            "  --grad-iterations N\n"
+            "                  forward passes --grad-tune may spend (default 200)\n"
+            "  --bode-file F   write frequency, gain and phase (measured and model) as CSV\n"
+            "  --sensor-delay N, --sensor-quantum Q, --sensor-noise S\n"
+            "                  feed the controller the position N steps late (up to 63),\n"
+            "                  rounded to multiples of Q, with Gaussian noise of S px;\n"
+            "                  scalar euler/zoh and --lanes runs\n"
+            "  --compute-delay A[:B]\n"
+            "                  apply each controller output A to B steps (up to 63) after\n"
+            "                  it was computed, uniformly distributed\n"
+            "  --compute-tail M\n"
+            "                  draw the delay as A plus an exponential overrun of mean M\n"
+            "                  steps instead, capped at B\n"
+            "  --compute-miss P\n"
+            "                  skip each controller update with probability P, holding\n"
+            "                  the last output; scalar euler/zoh runs and --monte-carlo,\n"
+            "                  which then reports the degradation against ideal timing\n"
+            "  --sweep-kp A:B:N, --sweep-ki A:B:N, --sweep-kd A:B:N\n"
+            "                  grid-sweep gains over all cores; --steps is per candidate\n"
+            "  --compact G     run the sweep in float32 with G = f32 or grid16 (16-bit\n"
+            "                  gains on the sweep grid) and check a sample against double\n"
+            "  --stop-settled BAND[:T]\n"
+            "                  stop a sweep candidate once its error stays within BAND px\n"
+            "                  for T s (default 1), extrapolating the rest of its IAE\n"
+            "  --stop-saturated T\n"
+            "                  stop a candidate whose integral sits at its limit for T s\n"
+            "  --stop-walls N  stop a candidate after N steps against a wall (diverged)\n"
+            "  --screen TAU    skip candidates whose linearized loop is unstable or has a\n"
+            "                  mode slower than TAU s (0 = unstable only), unsimulated\n"
+            "  --threads T     sweep worker count (default: all cores); with --lanes, step\n"
+            "                  the lanes on T threads once there are 8192 or more\n"
+            "  --numa          pin sweep threads node by node across the NUMA nodes, so\n"
+            "                  each block of lanes is stepped next to its memory\n"
+            "  --cache FILE    reuse sweep results stored in FILE and add new ones\n"
+            "  --store FILE    keep every sweep or --auto-tune result in the indexed\n"
+            "                  columnar store FILE (plus FILE.* columns), reusing those\n"
+            "                  already there\n"
+            "  --where EXPR    query --store FILE, e.g. overshoot<0.05,settling_time<2\n"
+            "                  (fields: kp ki kd iae ise itae effort overshoot rise_time\n"
+            "                  settling_time, ...; <, <=, >, >=, =)\n"
+            "  --limit N       matching rows --where prints (default 20)\n"
+            "  --coordinator PORT\n"
+            "                  shard the sweep across pid_headless --worker processes\n"
+            "                  that connect to PORT over TCP\n"
+            "  --chunk N       cells per work item for --coordinator (default 4096)\n"
+            "  --chunk-timeout S\n"
+            "                  reissue a chunk whose worker took longer than S seconds\n"
+            "                  (default 300)\n"
+            "  --worker HOST:PORT\n"
+            "                  run sweep chunks for the coordinator at HOST:PORT until\n"
+            "                  it finishes; --threads sets the local worker count\n"
+            "  --monte-carlo N run N samples of the loop with perturbed gravity, mass, bounce\n"
+            "                  and sensor noise and report the metric distributions;\n"
+            "                  with --sweep-*, re-rank the best candidates by p95 IAE\n"
+            "  --seed S        seed of Monte Carlo samples and sensor noise (default 1);\n"
+            "                  results do not depend on --threads\n"
+            "  --mc-gravity R, --mc-mass R\n"
+            "                  relative standard deviation of gravity (default 0.05) and\n"
+            "                  mass (default 0.1)\n"
+            "  --mc-bounce A:B bounce coefficient range (default -0.5:-0.1)\n"
+            "  --mc-noise PX   sensor noise standard deviation (default 0.5)\n"
+            "  --graph G       run a ControlGraph instead: single (same loop, checked\n"
+            "                  against Simulation) or cascade (position/velocity + FF);\n"
+            "                  --lanes N runs N copies\n"
+            "  --axes N        step a 1-3 axis point mass (x, y, z), one PID per axis\n"
+            "  --target X,Y,Z  per-axis setpoints for --axes (default: y from --setpoint)\n"
+            "  --plant P       close the loop around another model: ball, spring, lag,\n"
+            "                  pendulum, motor or state_space; gains and setpoint default\n"
+            "                  to the model's preset\n"
+#ifdef PID_HAVE_GPU
+            "  --gpu           run the sweep as an OpenGL 4.3 compute shader\n"
+#endif
+            "  --hil DEV       hardware-in-the-loop: drive a rig on serial device DEV\n"
+            "                  (or 'sim' for an in-process ball) at 1/--dt Hz for\n"
+            "                  --steps cycles (default 600)\n"
+            "  --baud B        serial baud rate for --hil (default 230400)\n"
+            "  --rt-cpu N, --rt-priority P, --rt-lock\n"
+            "                  pin the --hil loop to CPU N, run it SCHED_FIFO at P,\n"
+            "                  lock memory\n"
+            );
+}
+
+double parse_number(const char* flag, const char* value) {
+    char* end = nullptr;
+    double v = std::strtod(value, &end);
+    if (end == value || *end != '\0') {
+        throw std::invalid_argument(std::string("invalid value for ") + flag + ": " + value);
+    }
+    return v;
+}
+
+// A whole number from 0 to T's max; negatives, fractions and overflow are
+// rejected rather than wrapped by the cast
+template <class T>
+T parse_count(const char* flag, const char* value) {
+    double v = parse_number(flag, value);
+    // 2^digits is the first value past max that a double can hold exactly
+    const double limit = std::ldexp(1.0, std::numeric_limits<T>::digits);
+    if (!(v >= 0.0) || v >= limit || v != std::floor(v)) {
+        throw std::invalid_argument(std::string(flag) + " takes a whole number from 0 to " +
+                                    std::to_string(std::numeric_limits<T>::max()) + ": " + value);
+    }
+    return static_cast<T>(v);
+}
+
+GainRange parse_range(const char* flag, const char* value) {
+    GainRange r;
+    char* end = nullptr;
+    r.min = std::strtod(value, &end);
+    if (*end == ':') r.max = std::strtod(end + 1, &end); else r.max = r.min;
+    if (*end == ':') r.count = std::strtoul(end + 1, &end, 10);
+    if (*end != '\0' || r.count == 0) {
+        throw std::invalid_argument(std::string("expected MIN:MAX:COUNT for ") + flag + ": " + value);
+    }
+    return r;
+}
+
+// --script-stagger in steps
+uint64_t lane_offset(const Options& opt) {
+    return static_cast<uint64_t>(std::llround(opt.script_stagger / opt.dt));
+}
+
+Options parse_options(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (!std::strcmp(arg, "--help")) {
+            print_usage();
+            std::exit(0);
+        }
+        if (!std::strcmp(arg, "--rt-lock")) {
+            opt.realtime.lock_memory = true;
+            continue;
+        }
+        if (!std::strcmp(arg, "--metrics")) {
+            opt.metrics = true;
+            continue;
+        }
+        if (!std::strcmp(arg, "--bode")) {
+            opt.bode = true;
+            continue;
+        }
+        if (!std::strcmp(arg, "--auto-tune")) {
+            opt.auto_tune = true;
+            continue;
+        }
+        if (!std::strcmp(arg, "--grad-tune")) {
+            opt.grad_tune = true;
+            continue;
+        }
+        if (!std::strcmp(arg, "--d-on-measurement")) {
+            opt.d_on_measurement = true;
+            continue;
+        }
+        if (!std::strcmp(arg, "--numa")) {
+            opt.numa = true;
+            continue;
+        }
+        if (!std::strcmp(arg, "--counters")) {
+            opt.counters = true;
+            continue;
+        }
+        if (!std::strcmp(arg, "--alloc-check")) {
+            opt.alloc_check = true;
+            continue;
+        }
+#ifdef PID_HAVE_GPU
+        if (!std::strcmp(arg, "--gpu")) {
+            opt.gpu = true;
+            continue;
+        }
+#endif
+        if (i + 1 >= argc) throw std::invalid_argument(std::string("missing value for ") + arg);
+        const char* value = argv[++i];
+        if (!std::strcmp(arg, "--steps")) { opt.steps = parse_count<uint64_t>(arg, value); opt.steps_given = true; }
+        else if (!std::strcmp(arg, "--dt")) { opt.dt = parse_number(arg, value); opt.dt_given = true; }
+        else if (!std::strcmp(arg, "--kp")) { opt.kp = parse_number(arg, value); opt.gains_given = true; }
+        else if (!std::strcmp(arg, "--ki")) { opt.ki = parse_number(arg, value); opt.gains_given = true; }
+        else if (!std::strcmp(arg, "--kd")) { opt.kd = parse_number(arg, value); opt.gains_given = true; }
+        else if (!std::strcmp(arg, "--setpoint")) { opt.setpoint = parse_number(arg, value); opt.setpoint_given = true; }
+        else if (!std::strcmp(arg, "--plant")) opt.plant = value;
+        else if (!std::strcmp(arg, "--golden")) { opt.golden = value; opt.write_golden = false; }
+        else if (!std::strcmp(arg, "--write-golden")) { opt.golden = value; opt.write_golden = true; }
+        else if (!std::strcmp(arg, "--record-hashes")) opt.hash_out = value;
+        else if (!std::strcmp(arg, "--check-hashes")) opt.hash_check = value;
+        else if (!std::strcmp(arg, "--hash-every")) opt.hash_every = parse_count<uint64_t>(arg, value);
+        else if (!std::strcmp(arg, "--lanes")) opt.lanes = parse_count<uint64_t>(arg, value);
+        else if (!std::strcmp(arg, "--sweep-kp")) { opt.sweep_config.kp = parse_range(arg, value); opt.sweep = opt.swept[0] = true; }
+        else if (!std::strcmp(arg, "--sweep-ki")) { opt.sweep_config.ki = parse_range(arg, value); opt.sweep = opt.swept[1] = true; }
+        else if (!std::strcmp(arg, "--sweep-kd")) { opt.sweep_config.kd = parse_range(arg, value); opt.sweep = opt.swept[2] = true; }
+        else if (!std::strcmp(arg, "--integrator")) {
+            if (!parse_integrator(value, opt.integrator)) {
+                throw std::invalid_argument(std::string("unknown integrator ") + value);
+            }
+        }
+        else if (!std::strcmp(arg, "--d-filter")) opt.d_filter = parse_number(arg, value);
+        else if (!std::strcmp(arg, "--feed-forward")) {
+            opt.compensation.feed_forward = !std::strcmp(value, "gravity") ? GRAVITY : parse_number(arg, value);
+        }
+        else if (!std::strcmp(arg, "--observer")) {
+            opt.compensation.observer = true;
+            opt.compensation.observer_filter = parse_number(arg, value);
+        }
+        else if (!std::strcmp(arg, "--pid-form")) {
+            if (!parse_pid_form(value, opt.form)) {
+                throw std::invalid_argument(std::string("--pid-form takes positional or velocity, not ") + value);
+            }
+        }
+        else if (!std::strcmp(arg, "--compact")) {
+            if (!parse_compact_gains(value, opt.compact_gains)) {
+                throw std::invalid_argument(std::string("--compact takes f32 or grid16, not ") + value);
+            }
+            opt.compact = true;
+        }
+        else if (!std::strcmp(arg, "--stop-settled")) {
+            EarlyStop& early = opt.sweep_config.early;
+            char* end = nullptr;
+            early.settle_band = std::strtod(value, &end);
+            if (*end == ':') early.settle_time = std::strtod(end + 1, &end);
+            if (*end != '\0' || !(early.settle_band > 0.0) || !(early.settle_time > 0.0)) {
+                throw std::invalid_argument(std::string("expected BAND[:SECONDS] for --stop-settled: ") + value);
+            }
+        }
+        else if (!std::strcmp(arg, "--stop-saturated")) {
+            opt.sweep_config.early.saturate_time = parse_number(arg, value);
+            if (!(opt.sweep_config.early.saturate_time > 0.0)) throw std::invalid_argument("--stop-saturated must be positive");
+        }
+        else if (!std::strcmp(arg, "--stop-walls")) {
+            opt.sweep_config.early.wall_steps = parse_count<unsigned>(arg, value);
+            if (opt.sweep_config.early.wall_steps < 1) throw std::invalid_argument("--stop-walls takes a step count");
+        }
+        else if (!std::strcmp(arg, "--screen")) {
+            opt.sweep_config.screen.enabled = true;
+            opt.sweep_config.screen.max_time_constant = parse_number(arg, value);
+            if (opt.sweep_config.screen.max_time_constant < 0.0) throw std::invalid_argument("--screen takes TAU >= 0");
+        }
+        else if (!std::strcmp(arg, "--unroll")) opt.unroll = parse_count<int>(arg, value);
+        else if (!std::strcmp(arg, "--threads")) {
+            // Every worker is a real thread, so a count far past any core count is a typo
+            opt.threads = parse_count<unsigned>(arg, value);
+            if (opt.threads > 1024) throw std::invalid_argument("--threads takes 0 (all cores) to 1024");
+        }
+        else if (!std::strcmp(arg, "--cache")) opt.cache_path = value;
+        else if (!std::strcmp(arg, "--store")) opt.store_path = value;
+        else if (!std::strcmp(arg, "--where")) opt.where = value;
+        else if (!std::strcmp(arg, "--limit")) opt.limit = parse_count<std::size_t>(arg, value);
+        else if (!std::strcmp(arg, "--coordinator")) {
+            double port = parse_number(arg, value);
+            if (port < 1 || port > 65535) throw std::invalid_argument("--coordinator takes a TCP port");
+            opt.coordinator_port = static_cast<int>(port);
+            opt.cluster.port = static_cast<uint16_t>(port);
+        }
+        else if (!std::strcmp(arg, "--chunk")) {
+            opt.cluster.chunk_cells = parse_count<std::size_t>(arg, value);
+            if (opt.cluster.chunk_cells == 0) throw std::invalid_argument("--chunk must be positive");
+            opt.cluster_tuning = true;
+        }
+        else if (!std::strcmp(arg, "--chunk-timeout")) {
+            opt.cluster.chunk_timeout = std::chrono::seconds(static_cast<long long>(parse_number(arg, value)));
+            opt.cluster_tuning = true;
+        }
+        else if (!std::strcmp(arg, "--worker")) opt.worker = value;
+        else if (!std::strcmp(arg, "--monte-carlo")) opt.monte_carlo = parse_count<std::size_t>(arg, value);
+        else if (!std::strcmp(arg, "--seed")) {
+            opt.mc.seed = opt.sensor.seed = opt.timing.seed = opt.tune.seed = parse_count<uint64_t>(arg, value);
+            opt.seed_given = true;
+        }
+        else if (!std::strcmp(arg, "--tune-box")) {
+            char* end = nullptr;
+            opt.tune.kp_max = std::strtod(value, &end);
+            if (*end == ':') opt.tune.ki_max = std::strtod(end + 1, &end);
+            if (*end == ':') opt.tune.kd_max = std::strtod(end + 1, &end);
+            if (*end != '\0') throw std::invalid_argument(std::string("expected KP:KI:KD for --tune-box: ") + value);
+            opt.tune_tuning = true;
+        }
+        else if (!std::strcmp(arg, "--tune-population")) {
+            opt.tune.population = parse_count<std::size_t>(arg, value);
+            opt.cma_tuning = true;
+        }
+        else if (!std::strcmp(arg, "--tune-generations")) {
+            opt.tune.generations = parse_count<unsigned>(arg, value);
+            opt.cma_tuning = true;
+        }
+        else if (!std::strcmp(arg, "--grad-iterations")) {
+            opt.grad_iterations = parse_count<unsigned>(arg, value);
+            if (opt.grad_iterations < 1) throw std::invalid_argument("--grad-iterations takes a positive count");
+        }
+        else if (!std::strcmp(arg, "--tune-effort")) {
+            opt.tune.effort_weight = parse_number(arg, value);
+            opt.tune_tuning = true;
+        }
+        else if (!std::strcmp(arg, "--bode-hz")) {
+            GainRange r = parse_range(arg, value);
+            opt.bode_config.min_hz = r.min;
+            opt.bode_config.max_hz = r.max;
+            opt.bode_config.points = r.count;
+            opt.bode = true;
+        }
+        else if (!std::strcmp(arg, "--bode-file")) { opt.bode_file = value; opt.bode = true; }
+        else if (!std::strcmp(arg, "--export")) opt.export_path = value;
+        else if (!std::strcmp(arg, "--trajectories")) opt.trajectories_path = value;
+        else if (!std::strcmp(arg, "--trajectory-every")) opt.trajectory_every = parse_count<uint64_t>(arg, value);
+        else if (!std::strcmp(arg, "--reference")) opt.reference = value;
+        else if (!std::strcmp(arg, "--max-rms")) opt.max_rms = parse_number(arg, value);
+        else if (!std::strcmp(arg, "--schedule")) opt.schedule_path = value;
+        else if (!std::strcmp(arg, "--script")) opt.script_path = value;
+        else if (!std::strcmp(arg, "--config")) opt.config_path = value;
+        else if (!std::strcmp(arg, "--log")) opt.log_path = value;
+        else if (!std::strcmp(arg, "--plot-lod")) {
+            opt.plot_lod = parse_count<std::size_t>(arg, value);
+            if (opt.plot_lod < 1) throw std::invalid_argument("--plot-lod takes a column count");
+        }
+        else if (!std::strcmp(arg, "--script-stagger")) opt.script_stagger = parse_number(arg, value);
+        else if (!std::strcmp(arg, "--multi-rate")) { opt.rates = parse_multi_rate(value); opt.multi_rate = true; }
+        else if (!std::strcmp(arg, "--sensor-delay")) opt.sensor.delay_steps = parse_count<unsigned>(arg, value);
+        else if (!std::strcmp(arg, "--sensor-quantum")) opt.sensor.quantum = parse_number(arg, value);
+        else if (!std::strcmp(arg, "--sensor-noise")) opt.sensor.noise_sigma = parse_number(arg, value);
+        else if (!std::strcmp(arg, "--compute-delay")) {
+            char* end = nullptr;
+            double lo = std::strtod(value, &end), hi = lo;
+            if (*end == ':') hi = std::strtod(end + 1, &end);
+            if (*end != '\0' || !(lo >= 0.0) || !(hi >= lo) || hi > MAX_COMPUTE_DELAY) {
+                throw std::invalid_argument(std::string("expected A[:B] steps, 0 <= A <= B <= 63, for --compute-delay: ") + value);
+            }
+            opt.timing.delay_min = static_cast<unsigned>(lo);
+            opt.timing.delay_max = static_cast<unsigned>(hi);
+        }
+        else if (!std::strcmp(arg, "--compute-tail")) {
+            opt.timing.jitter = ComputeTimingModel::Jitter::Exponential;
+            opt.timing.delay_mean = parse_number(arg, value);
+        }
+        else if (!std::strcmp(arg, "--compute-miss")) opt.timing.miss_probability = parse_number(arg, value);
+        else if (!std::strcmp(arg, "--mc-gravity")) { opt.mc.variation.gravity_sigma = parse_number(arg, value); opt.mc_tuning = true; }
+        else if (!std::strcmp(arg, "--mc-mass")) { opt.mc.variation.mass_sigma = parse_number(arg, value); opt.mc_tuning = true; }
+        else if (!std::strcmp(arg, "--mc-noise")) { opt.mc.variation.noise_sigma = parse_number(arg, value); opt.mc_tuning = true; }
+        else if (!std::strcmp(arg, "--mc-bounce")) {
+            GainRange r = parse_range(arg, value);
+            opt.mc.variation.bounce_min = r.min;
+            opt.mc.variation.bounce_max = r.max;
+            opt.mc_tuning = true;
+        }
+        else if (!std::strcmp(arg, "--graph")) opt.graph = value;
+        else if (!std::strcmp(arg, "--axes")) opt.axes = parse_count<int>(arg, value);
+        else if (!std::strcmp(arg, "--target")) {
+            char* end = const_cast<char*>(value);
+            for (opt.targets = 0; opt.targets < MultiAxisPlant::MAX_AXES; ) {
+                opt.target[opt.targets++] = std::strtod(end, &end);
+                if (*end != ',') break;
+                ++end;
+            }
+            if (*end != '\0') throw std::invalid_argument(std::string("expected X,Y[,Z] for --target: ") + value);
+        }
+        else if (!std::strcmp(arg, "--hil")) opt.hil = value;
+        else if (!std::strcmp(arg, "--baud")) opt.baud = parse_count<unsigned>(arg, value);
+        else if (!std::strcmp(arg, "--rt-cpu")) opt.realtime.cpu = parse_count<int>(arg, value);
+        else if (!std::strcmp(arg, "--rt-priority")) opt.realtime.priority = parse_count<int>(arg, value);
+        else throw std::invalid_argument(std::string("unknown option ") + arg);
+    }
+    if (opt.dt <= 0) throw std::invalid_argument("--dt must be positive");
+    if (opt.unroll >= 0 && !opt.lanes) throw std::invalid_argument("--unroll applies to --lanes");
+    if (opt.gpu && (!opt.sweep || opt.metrics)) throw std::invalid_argument("--gpu runs IAE sweeps only");
+    if (!opt.cache_path.empty() && (!opt.sweep || opt.gpu)) throw std::invalid_argument("--cache applies to CPU sweeps");
+    if (!opt.where.empty() && (opt.store_path.empty() || opt.sweep || opt.auto_tune)) {
+        throw std::invalid_argument("--where queries a --store on its own");
+    }
+    if (!opt.store_path.empty() && opt.where.empty() &&
+        (!(opt.sweep || opt.auto_tune) || opt.gpu || opt.compact || opt.coordinator_port || opt.sweep_config.early.any())) {
+        throw std::invalid_argument("--store applies to CPU sweeps without --compact, --coordinator or --stop-*, "
+                                    "and to --auto-tune");
+    }
+    if (opt.coordinator_port && (!opt.sweep || opt.gpu || !opt.cache_path.empty())) {
+        throw std::invalid_argument("--coordinator serves a CPU sweep without --cache");
+    }
+    if (opt.compact && (!opt.sweep || opt.gpu || opt.metrics || opt.coordinator_port || !opt.cache_path.empty() ||
+                        !opt.export_path.empty() || opt.monte_carlo)) {
+        throw std::invalid_argument("--compact applies to local IAE sweeps without --cache or --export");
+    }
+    if (opt.sweep_config.early.any() && (!opt.sweep || opt.gpu || opt.metrics || opt.compact ||
+                                         opt.coordinator_port || !opt.cache_path.empty())) {
+        throw std::invalid_argument("--stop-* options apply to local IAE sweeps without --cache");
+    }
+    if (opt.sweep_config.screen.enabled && (!opt.sweep || opt.gpu || opt.compact || opt.coordinator_port)) {
+        throw std::invalid_argument("--screen applies to local CPU sweeps");
+    }
+    if (opt.cluster_tuning && !opt.coordinator_port) throw std::invalid_argument("--chunk options apply to --coordinator");
+    if (!opt.worker.empty() && (opt.sweep || opt.lanes || !opt.hil.empty() || !opt.graph.empty() || opt.axes ||
+                                !opt.plant.empty() || !opt.golden.empty())) {
+        throw std::invalid_argument("--worker takes its work from the coordinator");
+    }
+    if (opt.mc_tuning && !opt.monte_carlo) throw std::invalid_argument("--mc-* options apply to --monte-carlo");
+    if (opt.tune_tuning && !opt.auto_tune && !opt.grad_tune) {
+        throw std::invalid_argument("--tune-* options apply to --auto-tune and --grad-tune");
+    }
+    if (opt.cma_tuning && !opt.auto_tune) throw std::invalid_argument("--tune-population and --tune-generations apply to --auto-tune");
+    if (opt.grad_iterations && !opt.grad_tune) throw std::invalid_argument("--grad-iterations applies to --grad-tune");
+    if ((opt.auto_tune || opt.grad_tune) &&
+        (opt.auto_tune == opt.grad_tune || opt.sweep || opt.lanes || opt.bode || !opt.hil.empty() || !opt.graph.empty() ||
+                          opt.axes || !opt.plant.empty() || !opt.golden.empty() || opt.monte_carlo || !opt.worker.empty() ||
+                          opt.multi_rate || !opt.reference.empty() || !opt.export_path.empty() || opt.alloc_check ||
+                          !opt.sensor.ideal() || opt.integrator != Integrator::SemiImplicitEuler)) {
+        throw std::invalid_argument("--auto-tune and --grad-tune run on their own");
+    }
+    if (opt.seed_given && !opt.monte_carlo && !opt.auto_tune && opt.sensor.noise_sigma == 0.0 && opt.timing.ideal()) {
+        throw std::invalid_argument("--seed applies to --monte-carlo, --auto-tune, --sensor-noise and --compute-*");
+    }
+    opt.sensor.validate();
+    opt.timing.validate();
+    if (opt.timing.jitter == ComputeTimingModel::Jitter::Exponential && opt.timing.delay_max == 0) {
+        throw std::invalid_argument("--compute-tail needs a --compute-delay A:B range to cap it");
+    }
+    if (!opt.timing.ideal() &&
+        ((opt.sweep && !opt.monte_carlo) || opt.lanes || !opt.hil.empty() || !opt.graph.empty() || opt.axes ||
+         !opt.plant.empty() || !opt.golden.empty() || !opt.worker.empty() || opt.bode || opt.auto_tune ||
+         opt.grad_tune || opt.multi_rate || !opt.reference.empty() || !opt.export_path.empty() ||
+         opt.integrator == Integrator::Rk4)) {
+        throw std::invalid_argument("--compute-* options apply to scalar euler/zoh runs and --monte-carlo");
+    }
+    if (opt.bode) {
+        if (opt.sweep || opt.lanes || !opt.hil.empty() || !opt.graph.empty() || opt.axes || !opt.plant.empty() ||
+            !opt.golden.empty() || opt.monte_carlo || !opt.worker.empty() || opt.alloc_check ||
+            opt.integrator != Integrator::SemiImplicitEuler) {
+            throw std::invalid_argument("--bode analyses the semi-implicit Euler loop on its own");
+        }
+        if (opt.sensor.quantum != 0.0 || opt.sensor.noise_sigma != 0.0) {
+            throw std::invalid_argument("--bode needs a linear sensor; only --sensor-delay applies");
+        }
+    }
+    if (!opt.sensor.ideal() && !opt.bode && !opt.multi_rate && (opt.sweep || !opt.hil.empty() || !opt.graph.empty() || opt.axes || !opt.plant.empty() ||
+                                !opt.golden.empty() || opt.monte_carlo || !opt.worker.empty() ||
+                                opt.integrator == Integrator::Rk4)) {
+        throw std::invalid_argument("--sensor-* options apply to scalar euler/zoh and --lanes runs");
+    }
+    if (opt.monte_carlo && (opt.lanes || opt.gpu || opt.coordinator_port || !opt.cache_path.empty() ||
+                            !opt.hil.empty() || !opt.graph.empty() || opt.axes || !opt.plant.empty() ||
+                            !opt.golden.empty() || !opt.worker.empty() || opt.alloc_check)) {
+        throw std::invalid_argument("--monte-carlo runs on its own or after a local CPU sweep");
+    }
+    if (!opt.export_path.empty()) {
+        if (opt.gpu || opt.lanes || !opt.hil.empty() || !opt.graph.empty() || opt.axes || !opt.plant.empty() ||
+            !opt.golden.empty() || !opt.worker.empty() || opt.bode || opt.alloc_check || (opt.monte_carlo && !opt.sweep)) {
+            throw std::invalid_argument("--export applies to scalar runs and CPU sweeps");
+        }
+        if (!export_format_available(export_format_for(opt.export_path))) {
+            throw std::invalid_argument("--export " + opt.export_path + " needs a build with -DPID_ARROW=ON");
+        }
+    }
+    if (!opt.trajectories_path.empty()) {
+        if (!opt.sweep || opt.gpu || opt.compact || opt.coordinator_port || !opt.cache_path.empty() ||
+            !opt.store_path.empty() || opt.sweep_config.early.any()) {
+            throw std::invalid_argument("--trajectories applies to local CPU sweeps without --compact, --cache, "
+                                        "--store or --stop-*");
+        }
+        if (!export_format_available(export_format_for(opt.trajectories_path))) {
+            throw std::invalid_argument("--trajectories " + opt.trajectories_path + " needs a build with -DPID_ARROW=ON");
+        }
+    }
+    if (opt.trajectory_every && opt.trajectories_path.empty()) {
+        throw std::invalid_argument("--trajectory-every applies to --trajectories");
+    }
+    if (!opt.reference.empty()) {
+        if (opt.sweep || opt.gpu || opt.lanes || !opt.hil.empty() || !opt.graph.empty() || opt.axes ||
+            !opt.plant.empty() || !opt.golden.empty() || !opt.worker.empty() || opt.bode || opt.monte_carlo) {
+            throw std::invalid_argument("--reference drives the scalar loop on its own");
+        }
+        if (opt.setpoint_given) throw std::invalid_argument("--reference replaces --setpoint");
+    }
+    if (!opt.schedule_path.empty()) {
+        if (opt.sweep || opt.gpu || !opt.hil.empty() || !opt.graph.empty() || opt.axes || !opt.plant.empty() ||
+            !opt.golden.empty() || !opt.worker.empty() || opt.bode || opt.monte_carlo) {
+            throw std::invalid_argument("--schedule applies to scalar and --lanes runs");
+        }
+        if (opt.gains_given) throw std::invalid_argument("--schedule replaces --kp, --ki and --kd");
+        opt.schedule = std::make_shared<GainSchedule>(load_gain_schedule(opt.schedule_path));
+    }
+    if (opt.multi_rate) {
+        if (opt.sweep || opt.gpu || opt.lanes || !opt.hil.empty() || !opt.graph.empty() || opt.axes ||
+            !opt.plant.empty() || !opt.golden.empty() || !opt.worker.empty() || opt.bode || opt.monte_carlo ||
+            !opt.export_path.empty() || !opt.reference.empty() || opt.schedule || opt.alloc_check || opt.dt_given ||
+            opt.integrator != Integrator::SemiImplicitEuler) {
+            throw std::invalid_argument("--multi-rate runs on its own; its rates replace --dt");
+        }
+        RateSchedule::compile(opt.rates);  // reject rates that do not divide the plant rate here
+    }
+    if (opt.max_rms < 0.0) throw std::invalid_argument("--max-rms must not be negative");
+    if (opt.max_rms > 0.0 && opt.reference.empty()) throw std::invalid_argument("--max-rms applies to --reference");
+    if (opt.monte_carlo && opt.integrator != Integrator::SemiImplicitEuler) {
+        throw std::invalid_argument("--monte-carlo uses the semi-implicit Euler loop");
+    }
+    if (opt.mc.variation.gravity_sigma < 0 || opt.mc.variation.mass_sigma < 0 || opt.mc.variation.noise_sigma < 0) {
+        throw std::invalid_argument("--mc-* deviations must not be negative");
+    }
+    if (!opt.graph.empty() && opt.graph != "single" && opt.graph != "cascade") {
+        throw std::invalid_argument("--graph takes single or cascade");
+    }
+    if (!opt.graph.empty() && (opt.sweep || !opt.hil.empty())) throw std::invalid_argument("--graph runs on its own");
+    if (opt.axes && (opt.axes < 1 || opt.axes > 3)) throw std::invalid_argument("--axes takes 1 to 3");
+    if (opt.axes && (opt.sweep || opt.lanes || !opt.hil.empty() || !opt.graph.empty())) {
+        throw std::invalid_argument("--axes runs on its own");
+    }
+    if (opt.targets > opt.axes) throw std::invalid_argument("--target has more values than --axes");
+    if (!opt.plant.empty()) {
+        const PlantPreset& preset = plant_preset(opt.plant);
+        if (opt.sweep || opt.lanes || !opt.hil.empty() || !opt.graph.empty() || opt.axes) {
+            throw std::invalid_argument("--plant runs on its own");
+        }
+        if (!opt.gains_given) {
+            opt.kp = preset.kp;
+            opt.ki = preset.ki;
+            opt.kd = preset.kd;
+        }
+        if (!opt.setpoint_given) opt.setpoint = preset.setpoint;
+    }
+    // The SoA kernels implement the semi-implicit Euler model only
+    if ((opt.sweep || opt.lanes > 0) && opt.integrator != Integrator::SemiImplicitEuler) {
+        throw std::invalid_argument("--integrator applies to scalar runs only");
+    }
+    if (!opt.hil.empty() && (opt.sweep || opt.lanes > 0 || opt.gpu)) {
+        throw std::invalid_argument("--hil drives a single loop");
+    }
+    if (opt.alloc_check && (opt.sweep || !opt.hil.empty() || !opt.graph.empty() || opt.axes || !opt.plant.empty())) {
+        throw std::invalid_argument("--alloc-check applies to scalar and --lanes runs");
+    }
+    if (!opt.golden.empty() && (opt.sweep || opt.lanes || !opt.hil.empty() || !opt.graph.empty() || opt.axes ||
+                                !opt.plant.empty() || opt.alloc_check)) {
+        throw std::invalid_argument("--golden checks the scalar loop on its own");
+    }
+    if (!opt.hash_out.empty() || !opt.hash_check.empty()) {
+        if (opt.sweep || opt.gpu || opt.lanes || !opt.hil.empty() || !opt.graph.empty() || opt.axes ||
+            !opt.plant.empty() || !opt.golden.empty() || !opt.worker.empty() || opt.bode || opt.monte_carlo ||
+            opt.auto_tune || opt.grad_tune || opt.multi_rate || !opt.export_path.empty()) {
+            throw std::invalid_argument("--record-hashes and --check-hashes apply to scalar and --reference runs");
+        }
+    } else if (opt.hash_every) {
+        throw std::invalid_argument("--hash-every applies to --record-hashes and --check-hashes");
+    }
+    if (!opt.hash_check.empty()) {
+        opt.expected_hashes = std::make_shared<StateHashLog>(load_state_hashes(opt.hash_check));
+        if (opt.hash_every && opt.hash_every != opt.expected_hashes->every) {
+            throw std::invalid_argument("--hash-every differs from the checkpoint interval of " + opt.hash_check);
+        }
+        opt.hash_every = opt.expected_hashes->every;
+        if (!opt.steps_given) opt.steps = opt.expected_hashes->steps;
+    }
+    const bool scalar_run = !(opt.sweep || opt.gpu || !opt.hil.empty() || !opt.graph.empty() || opt.axes ||
+                              !opt.plant.empty() || opt.lanes || !opt.golden.empty() || !opt.worker.empty() ||
+                              opt.bode || opt.monte_carlo || opt.auto_tune || opt.grad_tune || opt.multi_rate ||
+                              !opt.reference.empty() || !opt.export_path.empty() || !opt.where.empty());
+    if (!opt.log_path.empty() && !scalar_run) throw std::invalid_argument("--log applies to scalar runs");
+    // perf_event counts the calling thread; pool workers would go uncounted
+    if (opt.counters && !(scalar_run || (opt.lanes && !opt.threads))) {
+        throw std::invalid_argument("--counters applies to scalar and single-thread --lanes runs");
+    }
+    if (opt.numa && (!opt.sweep || opt.gpu || opt.compact || opt.coordinator_port || !opt.worker.empty())) {
+        throw std::invalid_argument("--numa applies to local --sweep-* runs");
+    }
+    if (opt.form != PidForm::Positional) {
+        // The float32, GPU, gradient and cluster paths keep the positional form only
+        if (!(scalar_run || opt.lanes || opt.multi_rate || opt.sweep) || opt.gpu || opt.compact ||
+            opt.coordinator_port || opt.sweep_config.early.any()) {
+            throw std::invalid_argument("--pid-form applies to scalar, --lanes, --multi-rate and local --sweep-* runs "
+                                        "without early stopping");
+        }
+        if (opt.integrator == Integrator::Rk4) throw std::invalid_argument("--pid-form velocity needs euler or zoh");
+    }
+    if (opt.d_filter != 0.0 || opt.d_on_measurement) {
+        if (!(opt.d_filter >= 0.0)) throw std::invalid_argument("--d-filter must not be negative");
+        if (!(scalar_run || opt.lanes || opt.multi_rate)) {
+            throw std::invalid_argument("--d-filter and --d-on-measurement apply to scalar, --lanes and --multi-rate runs");
+        }
+        if (opt.integrator == Integrator::Rk4) {
+            throw std::invalid_argument("--d-filter and --d-on-measurement need euler or zoh");
+        }
+    }
+    if (opt.compensation.any()) {
+        const Compensation& c = opt.compensation;
+        if (!std::isfinite(c.feed_forward)) throw std::invalid_argument("--feed-forward must be finite");
+        if (c.observer && !(c.observer_filter >= 0.0 && std::isfinite(c.observer_filter))) {
+            throw std::invalid_argument("--observer must be a finite time constant of 0 or more");
+        }
+        // The float32, GPU and cluster paths have no compensation, and the
+        // observer keeps per-lane history a sweep's early stop cannot carry
+        if (!(scalar_run || opt.lanes || opt.multi_rate || opt.auto_tune || (opt.sweep && !c.observer)) ||
+            opt.gpu || opt.compact || opt.coordinator_port || opt.monte_carlo) {
+            throw std::invalid_argument("--feed-forward applies to scalar, --lanes, --multi-rate, --auto-tune and "
+                                        "local --sweep-* runs; --observer to all but the sweeps");
+        }
+        if (opt.sweep && !opt.cache_path.empty()) {
+            throw std::invalid_argument("--cache keys cells by gains only; drop it with --feed-forward");
+        }
+        if (!opt.store_path.empty()) {
+            throw std::invalid_argument("--store keys results by gains only; drop it with --feed-forward or --observer");
+        }
+        if (c.observer && opt.integrator == Integrator::Rk4) throw std::invalid_argument("--observer needs euler or zoh");
+    }
+    if (opt.plot_lod && (!scalar_run || opt.script || !opt.log_path.empty() || !opt.hash_out.empty() ||
+                         !opt.hash_check.empty() || opt.alloc_check)) {
+        throw std::invalid_argument("--plot-lod checks the plain scalar loop");
+    }
+    if (!opt.config_path.empty()) {
+        if (!scalar_run) throw std::invalid_argument("--config applies to scalar runs");
+        opt.config = AppConfig::load(opt.config_path);
+        // Command-line values win over the file's
+        if (!opt.dt_given) opt.dt = opt.config.timestep;
+        if (!opt.gains_given && !opt.schedule) {
+            opt.kp = opt.config.kp;
+            opt.ki = opt.config.ki;
+            opt.kd = opt.config.kd;
+        }
+    }
+    if (!opt.script_path.empty()) {
+        if (opt.sweep || opt.gpu || !opt.hil.empty() || !opt.graph.empty() || opt.axes || !opt.plant.empty() ||
+            !opt.golden.empty() || !opt.worker.empty() || opt.bode || opt.monte_carlo || opt.auto_tune ||
+            opt.grad_tune || opt.multi_rate || !opt.reference.empty() || !opt.export_path.empty() || opt.schedule) {
+            throw std::invalid_argument("--script drives scalar and --lanes runs");
+        }
+        if (!(opt.script_stagger >= 0.0)) throw std::invalid_argument("--script-stagger must not be negative");
+        if (opt.script_stagger > 0.0 && !opt.lanes) throw std::invalid_argument("--script-stagger applies to --lanes");
+        if (opt.lanes && opt.threads) throw std::invalid_argument("--lanes steps a --script on one thread; drop --threads");
+        opt.script = std::make_shared<ScenarioScript>(ScenarioScript::load(opt.script_path, opt.dt));
+        if (opt.script->uses(ScriptEvent::Sensor) && opt.integrator == Integrator::Rk4) {
+            throw std::invalid_argument("--script sensor events need the euler or zoh integrator");
+        }
+        if (!opt.steps_given && !opt.expected_hashes) {
+            opt.steps = opt.script->last_step() + lane_offset(opt) * (std::max<uint64_t>(opt.lanes, 1) - 1) +
+                        static_cast<uint64_t>(std::llround(1.0 / opt.dt));
+        }
+    } else if (opt.script_stagger != 0.0) {
+        throw std::invalid_argument("--script-stagger applies to --script");
+    }
+    if (opt.monte_carlo && !opt.steps_given) opt.steps = opt.mc.steps;
+    if (opt.realtime.any() && opt.hil.empty()) throw std::invalid_argument("--rt-* options apply to --hil");
+    if (opt.realtime.priority < 0 || opt.realtime.priority > 99) throw std::invalid_argument("--rt-priority takes 1 to 99");
+    return opt;
+}
+
+void print_sensor(const SensorModel& s) {
+    if (s.ideal()) return;
+    std::printf("sensor       delay %u steps, quantum %g px, noise %g px (seed %llu)\n", s.delay_steps, s.quantum,
+                s.noise_sigma, static_cast<unsigned long long>(s.seed));
+}
+
+// --kp/--ki/--kd in the --pid-form form
+PID_Controller make_controller(const Options& opt) {
+    PID_Controller pid(opt.kp, opt.ki, opt.kd);
+    pid.set_form(opt.form);
+    pid.derivative_filter = opt.d_filter;
+    pid.derivative_on_measurement = opt.d_on_measurement;
+    pid.set_compensation(opt.compensation);
+    return pid;
+}
+
+void print_form(const Options& opt) {
+    if (opt.form != PidForm::Positional) std::printf("pid form     %s\n", pid_form_name(opt.form));
+    if (opt.d_filter != 0.0 || opt.d_on_measurement) {
+        std::printf("derivative   of %s, filter %g s\n", opt.d_on_measurement ? "measurement" : "error", opt.d_filter);
+    }
+    const Compensation& c = opt.compensation;
+    if (c.feed_forward != 0.0) std::printf("feed-forward %g px/s^2\n", c.feed_forward);
+    if (c.observer) std::printf("observer     filter %g s\n", c.observer_filter);
+}
+
+void print_timing(const ComputeTimingModel& t) {
+    if (t.ideal()) return;
+    if (t.jitter == ComputeTimingModel::Jitter::Exponential) {
+        std::printf("compute      delay %u + exp(mean %g) steps, capped at %u; miss %g %%\n", t.delay_min, t.delay_mean,
+                    t.delay_max, t.miss_probability * 100.0);
+    } else {
+        std::printf("compute      delay %u:%u steps; miss %g %%\n", t.delay_min, t.delay_max, t.miss_probability * 100.0);
+    }
+}
+
+void print_schedule(const Options& opt) {
+    if (!opt.schedule) return;
+    std::printf("schedule     %s (", opt.schedule_path.c_str());
+    for (unsigned a = 0; a < opt.schedule->dimensions(); ++a) {
+        const GainSchedule::Axis& axis = opt.schedule->axis(a);
+        std::printf("%s%s %g:%g:%u", a ? " x " : "", schedule_input_name(axis.input), axis.min, axis.max, axis.points);
+    }
+    std::printf(")\n");
+}
+
+void print_script(const Options& opt) {
+    if (!opt.script) return;
+    const ScenarioScript& s = *opt.script;
+    std::printf("script       %s (%zu events to %.3f s", opt.script_path.c_str(), s.events().size(),
+                s.last_step() * opt.dt);
+    if (opt.script_stagger > 0.0) std::printf(", lanes %g s apart", lane_offset(opt) * opt.dt);
+    std::printf(")\n");
+}
+
+void print_config(const Options& opt) {
+    if (opt.config_path.empty()) return;
+    const AppConfig& c = opt.config;
+    std::printf("config       %s (gravity %g, bounce %g, integral limit %g)\n", opt.config_path.c_str(), c.gravity,
+                c.bounce, c.integral_limit);
+}
+
+// Closes `out` and reports it; the drain time is what the run still waited
+// for the writer after its last row
+void finish_export(Exporter& out, const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    out.close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("export       %llu rows to %s (%llu producer stalls, %.3f s drain)\n",
+                static_cast<unsigned long long>(out.rows_written()), path.c_str(),
+                static_cast<unsigned long long>(out.producer_stalls()), seconds);
+}
+
+// --counters report: hardware events per `steps` (lane-)steps, then peak RSS
+void print_counters(const PerfCounters& counters, double steps, const char* step) {
+    if (!counters.available()) {
+        std::printf("counters     unavailable (no perf_event access)\n");
+    } else {
+        const double n = steps > 0 ? steps : 1.0;
+        std::printf("counters     %.2f cycles, %.2f instructions per %s (IPC %.2f)\n", counters.cycles() / n,
+                    counters.instructions() / n, step,
+                    counters.cycles() ? static_cast<double>(counters.instructions()) / counters.cycles() : 0.0);
+        std::printf("misses      ");
+        const PerfCounters::Event misses[] = {PerfCounters::L1dMisses, PerfCounters::LlcMisses,
+                                              PerfCounters::BranchMisses};
+        const char* names[] = {"L1d", "LLC", "branch"};
+        for (int i = 0; i < 3; ++i) {
+            if (counters.has(misses[i])) std::printf(" %.4f %s", counters.count(misses[i]) / n, names[i]);
+            else std::printf(" - %s", names[i]);
+            std::printf(i < 2 ? "," : " per %s\n", step);
+        }
+    }
+    std::printf("peak RSS     %.1f MiB\n", peak_resident_bytes() / (1024.0 * 1024.0));
+}
+
+// --alloc-check verdict; false if the loop allocated
+bool report_allocations(uint64_t count) {
+    if (!allocation_counting_enabled()) {
+        std::printf("allocations  unknown (built with PID_ALLOC_COUNTER=OFF)\n");
+        return true;
+    }
+    std::printf("allocations  %llu\n", static_cast<unsigned long long>(count));
+    return count == 0;
+}
+
+// Golden trajectory file: a header naming the run, then one line per step
+// with ball.y, ball.velocity and the controller output, printed with 17
+// significant digits so that reading them back gives the same doubles
+std::string golden_header(const Options& opt) {
+    char line[256];
+    std::snprintf(line, sizeof line, "# pid_headless trajectory integrator=%s kp=%.17g ki=%.17g kd=%.17g setpoint=%.17g dt=%.17g steps=%llu\n",
+                  integrator_name(opt.integrator), opt.kp, opt.ki, opt.kd, opt.setpoint, opt.dt,
+                  static_cast<unsigned long long>(opt.steps));
+    return line;
+}
+
+int run_golden(const Options& opt) {
+    Simulation sim;
+    sim.pid = make_controller(opt);
+    sim.setpoint = opt.setpoint;
+    sim.integrator = opt.integrator;
+    const std::string header = golden_header(opt);
+
+    std::unique_ptr<FILE, int (*)(FILE*)> file(std::fopen(opt.golden.c_str(), opt.write_golden ? "w" : "r"), &std::fclose);
+    if (!file) throw std::runtime_error("cannot open " + opt.golden);
+    if (opt.write_golden) {
+        std::fputs(header.c_str(), file.get());
+        for (uint64_t s = 1; s <= opt.steps; ++s) {
+            sim.step(opt.dt);
+            std::fprintf(file.get(), "%llu %.17g %.17g %.17g\n", static_cast<unsigned long long>(s),
+                         sim.ball.y, sim.ball.velocity, sim.output);
+        }
+        if (std::fflush(file.get()) != 0) throw std::runtime_error("cannot write " + opt.golden);
+        std::printf("golden       wrote %llu steps to %s\n", static_cast<unsigned long long>(opt.steps), opt.golden.c_str());
+        return 0;
+    }
+
+    char recorded[256] = {};
+    if (!std::fgets(recorded, sizeof recorded, file.get()) || header != recorded) {
+        throw std::runtime_error(opt.golden + " was not recorded with these options; it starts with:\n" + recorded);
+    }
+    for (uint64_t s = 1; s <= opt.steps; ++s) {
+        sim.step(opt.dt);
+        unsigned long long step = 0;
+        double y = 0, v = 0, u = 0;
+        if (std::fscanf(file.get(), "%llu %lf %lf %lf", &step, &y, &v, &u) != 4 || step != s) {
+            throw std::runtime_error(opt.golden + ": malformed at step " + std::to_string(s));
+        }
+        if (y != sim.ball.y || v != sim.ball.velocity || u != sim.output) {
+            std::printf("golden       MISMATCH at step %llu\n", step);
+            std::printf("  expected   y %.17g v %.17g u %.17g\n", y, v, u);
+            std::printf("  got        y %.17g v %.17g u %.17g\n", sim.ball.y, sim.ball.velocity, sim.output);
+            return 2;
+        }
+    }
+    std::printf("steps        %llu\n", static_cast<unsigned long long>(opt.steps));
+    std::printf("final y      %.6f\n", sim.ball.y);
+    std::printf("golden       bit-exact\n");
+    return 0;
+}
+
+bool hashing(const Options& opt) {
+    return !opt.hash_out.empty() || opt.expected_hashes;
+}
+
+StateHasher make_hasher(const Options& opt, double dt) {
+    if (opt.expected_hashes && opt.expected_hashes->dt != dt) {
+        throw std::invalid_argument(opt.hash_check + " was recorded at dt " + std::to_string(opt.expected_hashes->dt));
+    }
+    StateHasher hasher(opt.hash_every ? opt.hash_every : 1000);
+    if (hashing(opt)) hasher.reserve(opt.steps);
+    return hasher;
+}
+
+// Writes and checks the state hashes of a finished run; false, after
+// saying where, when the run parted from the checked log
+bool report_hashes(const Options& opt, const StateHasher& hasher, double dt) {
+    std::printf("float env    %s build, round to nearest, no flush to zero\n",
+                DETERMINISTIC_BUILD ? "deterministic" : "default");
+    std::printf("state hash   %016llx over %llu steps\n", static_cast<unsigned long long>(hasher.digest()),
+                static_cast<unsigned long long>(hasher.sampled()));
+    if (!opt.hash_out.empty()) {
+        write_state_hashes(opt.hash_out, hasher, dt);
+        std::printf("hashes       wrote %zu checkpoints to %s\n", hasher.checkpoints().size(), opt.hash_out.c_str());
+    }
+    if (!opt.expected_hashes) return true;
+
+    const StateHashLog& log = *opt.expected_hashes;
+    if (log.deterministic != DETERMINISTIC_BUILD) {
+        std::printf("note         %s was recorded by a %s build\n", opt.hash_check.c_str(),
+                    log.deterministic ? "deterministic" : "default");
+    }
+    if (const StateCheckpoint* at = first_divergence(log, hasher)) {
+        const StateCheckpoint& got = hasher.checkpoints()[at - log.checkpoints.data()];
+        std::printf("hashes       MISMATCH by step %llu\n", static_cast<unsigned long long>(at->step));
+        std::printf("  expected   %016llx\n", static_cast<unsigned long long>(at->hash));
+        std::printf("  got        %016llx\n", static_cast<unsigned long long>(got.hash));
+        return false;
+    }
+    if (hasher.sampled() == log.steps && hasher.digest() != log.digest) {
+        std::printf("hashes       MISMATCH after the last checkpoint\n");
+        return false;
+    }
+    std::size_t compared = std::min(log.checkpoints.size(), hasher.checkpoints().size());
+    if (hasher.sampled() == log.steps) {
+        std::printf("hashes       bit-exact (%zu checkpoints)\n", compared);
+    } else {
+        std::printf("hashes       bit-exact over the %zu checkpoints both runs reached\n", compared);
+    }
+    return true;
+}
+
+void print_tracking(const TrackingError& t) {
+    std::printf("track IAE    %.6f\n", t.iae);
+    std::printf("track RMS    %.6f px\n", t.rms());
+    std::printf("track max    %.6f px\n", t.max_error);
+}
+
+// False, after saying so, when --max-rms is set and the run tracked worse
+bool check_tracking(const Options& opt, const TrackingError& t) {
+    if (opt.max_rms == 0.0 || t.rms() <= opt.max_rms) return true;
+    std::printf("tracking     FAILED (RMS %.6f px over the %.6f px limit)\n", t.rms(), opt.max_rms);
+    return false;
+}
+
+// The scalar run recorded into a TrajectoryHistory that has wrapped, then
+// every series' pyramid range() and decimate() for windows of every zoom,
+// from a few samples to the whole history, checked against a plain scan of
+// the same samples
+int run_plot_lod(const Options& opt) {
+    Simulation sim;
+    sim.pid = make_controller(opt);
+    sim.setpoint = opt.setpoint;
+    sim.integrator = opt.integrator;
+    sim.set_sensor(opt.sensor);
+    sim.set_timing(opt.timing);
+    opt.config.apply_plant(sim);
+    // Two thirds of the run, so the ring and the pyramid levels wrap
+    TrajectoryHistory history(static_cast<std::size_t>(std::max<uint64_t>(opt.steps * 2 / 3, 2)));
+    for (uint64_t s = 0; s < opt.steps; ++s) {
+        sim.step(opt.dt);
+        history.push(sample_of(sim));
+    }
+    const TrajectoryPyramid& lod = history.pyramid();
+    auto raw = [&](uint64_t index, std::size_t series) { return history.value(index, series); };
+    auto scan = [&](std::size_t series, uint64_t first, uint64_t end) {
+        LodRange r;
+        for (uint64_t i = first; i < end; ++i) r.add(static_cast<float>(history.value(i, series)));
+        return r;
+    };
+
+    const std::size_t columns = opt.plot_lod;
+    std::vector<LodPoint> points(2 * columns + 2);
+    const uint64_t first = history.first(), end = history.end();
+    uint64_t windows = 0, mismatches = 0, lcg = 1;
+    double decimate_seconds = 0.0;
+    std::size_t most_points = 0;
+    for (uint64_t span = 3; span <= end - first; span = span * 3 / 2 + 1) {
+        for (int trial = 0; trial < 8; ++trial) {
+            lcg = lcg * 6364136223846793005ull + 1442695040888963407ull;
+            const uint64_t window_end = first + span + (lcg >> 33) % (end - first - span + 1);
+            const uint64_t window_first = window_end - span;
+            for (std::size_t c = 0; c < PLOT_SERIES; ++c) {
+                const LodRange want = scan(c, window_first, window_end);
+                const LodRange got = lod.range(c, window_first, window_end, raw);
+                auto t0 = std::chrono::steady_clock::now();
+                const std::size_t n = lod.decimate(c, window_first, window_end, static_cast<double>(span), columns,
+                                                   raw, points.data());
+                decimate_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                // The drawn extremes are the window's, within two points a column, left to right
+                LodRange drawn;
+                bool ordered = n <= 2 * columns + 2;
+                for (std::size_t i = 0; i < n; ++i) {
+                    drawn.add(points[i].v);
+                    if (points[i].x < 0.0f || points[i].x > 1.0f || (i && points[i].x < points[i - 1].x)) ordered = false;
+                }
+                most_points = std::max(most_points, n);
+                if (got.lo != want.lo || got.hi != want.hi || drawn.lo != want.lo || drawn.hi != want.hi || !ordered) {
+                    if (mismatches++ == 0) {
+                        std::printf("mismatch     series %zu, samples [%llu, %llu): range %g:%g, drawn %g:%g, want %g:%g\n",
+                                    c, static_cast<unsigned long long>(window_first),
+                                    static_cast<unsigned long long>(window_end), got.lo, got.hi, drawn.lo, drawn.hi,
+                                    want.lo, want.hi);
+                    }
+                }
+            }
+            ++windows;
+        }
+    }
+    std::printf("history      %zu of %llu samples, %u pyramid levels\n", history.size(),
+                static_cast<unsigned long long>(end), lod.level_count());
+    std::printf("windows      %llu x %zu series at %zu columns, at most %zu points\n",
+                static_cast<unsigned long long>(windows), PLOT_SERIES, columns, most_points);
+    std::printf("decimate     %.2f us per series\n", decimate_seconds * 1e6 / static_cast<double>(windows * PLOT_SERIES));
+    std::printf("mismatches   %llu\n", static_cast<unsigned long long>(mismatches));
+    return mismatches ? 2 : 0;
+}
+
+// Scalar run with every step streamed to --export; the loop only fills rows,
+// and the Simulation must end exactly where an unexported run does. With a
+// --reference the setpoint follows it, as in run_reference().
+int run_export(const Options& opt, const ReferenceTrajectory* ref = nullptr) {
+    Simulation sim;
+    sim.pid = make_controller(opt);
+    sim.setpoint = ref ? ref->at(0) : opt.setpoint;
+    sim.integrator = opt.integrator;
+    sim.set_sensor(opt.sensor);
+    sim.schedule = opt.schedule.get();
+    Exporter out(opt.export_path, {"step", "time", "setpoint", "pv", "y", "velocity", "output", "integral"});
+
+    auto start = std::chrono::steady_clock::now();
+    ExportRow row{};
+    TrackingError tracking;
+    for (uint64_t s = 1; s <= opt.steps; ++s) {
+        if (ref) sim.setpoint = ref->at(s - 1);
+        sim.step(opt.dt);
+        if (ref) tracking.update(sim.setpoint - (sim.ball.y + BALL_SIZE / 2), opt.dt);
+        row[0] = static_cast<double>(s);
+        row[1] = sim.time;
+        row[2] = sim.setpoint;
+        row[3] = sim.measurement;
+        row[4] = sim.ball.y;
+        row[5] = sim.ball.velocity;
+        row[6] = sim.output;
+        row[7] = sim.pid.integral_value();
+        out.write(0, row);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Simulation reference;
+    reference.pid = make_controller(opt);
+    reference.setpoint = ref ? ref->at(0) : opt.setpoint;
+    reference.integrator = opt.integrator;
+    reference.set_sensor(opt.sensor);
+    reference.schedule = opt.schedule.get();
+    if (ref) run_reference(reference, *ref, opt.steps);
+    else run_headless(reference, opt.steps, opt.dt);
+    bool exact = sim.ball.y == reference.ball.y && sim.ball.velocity == reference.ball.velocity;
+
+    std::printf("integrator   %s\n", integrator_name(opt.integrator));
+    print_form(opt);
+    print_sensor(opt.sensor);
+    print_schedule(opt);
+    std::printf("steps        %llu\n", static_cast<unsigned long long>(opt.steps));
+    std::printf("wall time    %.3f s\n", seconds);
+    std::printf("steps/sec    %.0f\n", seconds > 0 ? opt.steps / seconds : 0.0);
+    std::printf("final y      %.6f\n", sim.ball.y);
+    if (ref) print_tracking(tracking);
+    finish_export(out, opt.export_path);
+    std::printf("reference    %s\n", exact ? "bit-exact" : "MISMATCH");
+    if (ref && !check_tracking(opt, tracking)) return 2;
+    return exact ? 0 : 2;
+}
+
+// Plant, controller and sensor each at their own rate. The schedule walk
+// is checked against the loop that tests every period on every plant tick,
+// and with all three rates equal against Simulation itself.
+int run_multi_rate(const Options& opt) {
+    MultiRateLoop loop(opt.rates, make_controller(opt), opt.setpoint, opt.sensor);
+    const uint64_t period = loop.schedule().controller_period;
+    MetricsAccumulator metrics(loop.measurement, opt.setpoint);
+
+    auto start = std::chrono::steady_clock::now();
+    if (opt.metrics) {
+        for (uint64_t s = 0; s < opt.steps; ++s) {
+            loop.advance(period);
+            metrics.update(loop.ball.y + BALL_SIZE / 2, opt.setpoint, loop.output, loop.controller_dt());
+        }
+    } else {
+        loop.advance(opt.steps * period);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    MultiRateLoop reference(opt.rates, make_controller(opt), opt.setpoint, opt.sensor);
+    run_multi_rate_reference(reference, loop.ticks());
+    bool exact = loop.ball.y == reference.ball.y && loop.ball.velocity == reference.ball.velocity;
+    if (exact && opt.rates.controller_hz == opt.rates.plant_hz && opt.rates.sensor_hz == opt.rates.plant_hz) {
+        Simulation sim;
+        sim.pid = make_controller(opt);
+        sim.setpoint = opt.setpoint;
+        sim.set_sensor(opt.sensor);
+        run_headless(sim, opt.steps, loop.plant_dt());
+        exact = loop.ball.y == sim.ball.y && loop.ball.velocity == sim.ball.velocity;
+    }
+
+    const RateSchedule& table = loop.schedule();
+    double plant_steps = static_cast<double>(loop.ticks());
+    std::printf("rates        plant %g Hz, controller %g Hz, sensor %g Hz\n", opt.rates.plant_hz,
+                opt.rates.controller_hz, opt.rates.sensor_hz);
+    std::printf("schedule     %zu slots per %u plant ticks\n", table.slots.size(), table.hyperperiod);
+    print_form(opt);
+    print_sensor(opt.sensor);
+    std::printf("steps        %llu\n", static_cast<unsigned long long>(opt.steps));
+    std::printf("plant steps  %llu\n", static_cast<unsigned long long>(loop.ticks()));
+    std::printf("sim time     %.3f s\n", loop.time());
+    std::printf("wall time    %.3f s\n", seconds);
+    std::printf("plant-step/s %.0f\n", seconds > 0 ? plant_steps / seconds : 0.0);
+    std::printf("final y      %.6f\n", loop.ball.y);
+    std::printf("final v      %.6f\n", loop.ball.velocity);
+    if (opt.metrics) print_metrics(metrics.metrics());
+    std::printf("reference    %s\n", exact ? "bit-exact" : "MISMATCH");
+    return exact ? 0 : 2;
+}
+
+// Scalar loop chasing a recorded setpoint trajectory, one value per step
+int run_tracking(Options opt) {
+    ReferenceTrajectory ref = load_reference(opt.reference);
+    if (opt.dt_given && opt.dt != ref.dt) {
+        throw std::invalid_argument("--dt differs from the reference timestep " + std::to_string(ref.dt));
+    }
+    opt.dt = ref.dt;
+    if (!opt.steps_given) opt.steps = ref.size();
+    std::printf("tracking     %s (%llu steps at %g Hz)\n", opt.reference.c_str(),
+                static_cast<unsigned long long>(ref.size()), 1.0 / ref.dt);
+    if (!opt.export_path.empty()) return run_export(opt, &ref);
+
+    Simulation sim;
+    sim.pid = make_controller(opt);
+    sim.setpoint = ref.at(0);
+    sim.integrator = opt.integrator;
+    sim.set_sensor(opt.sensor);
+    sim.schedule = opt.schedule.get();
+
+    MetricsAccumulator metrics(sim.measurement, sim.setpoint);
+    TrackingError tracking;
+    StateHasher hasher = make_hasher(opt, ref.dt);
+    FloatEnvironment env;
+    AllocationScope allocations;
+    RunStats stats = run_reference(sim, ref, opt.steps, &tracking, opt.metrics ? &metrics : nullptr,
+                                   hashing(opt) ? &hasher : nullptr);
+    uint64_t allocated = allocations.count();
+
+    std::printf("integrator   %s\n", integrator_name(opt.integrator));
+    print_form(opt);
+    print_sensor(opt.sensor);
+    print_schedule(opt);
+    std::printf("steps        %llu\n", static_cast<unsigned long long>(stats.steps));
+    std::printf("sim time     %.3f s\n", stats.steps * opt.dt);
+    std::printf("wall time    %.3f s\n", stats.seconds);
+    std::printf("steps/sec    %.0f\n", stats.steps_per_second());
+    std::printf("final y      %.6f\n", sim.ball.y);
+    print_tracking(tracking);
+    if (opt.metrics) print_metrics(metrics.metrics());
+    if (hashing(opt) && !report_hashes(opt, hasher, ref.dt)) return 2;
+    if (opt.alloc_check && !report_allocations(allocated)) return 2;
+    return check_tracking(opt, tracking) ? 0 : 2;
+}
+
+int run_batched(const Options& opt) {
+    // With --threads each pool participant first touches the blocks it steps
+    std::unique_ptr<ThreadPool> pool;
+    if (opt.threads) pool = std::make_unique<ThreadPool>(opt.threads);
+    BatchEngine engine = pool ? BatchEngine(opt.lanes, *pool) : BatchEngine(opt.lanes);
+    if (opt.unroll >= 0) engine.set_unroll(static_cast<unsigned>(opt.unroll));
+    engine.set_form(opt.form);
+    engine.set_derivative_filter(opt.d_filter, opt.d_on_measurement);
+    engine.set_compensation(opt.compensation);
+    for (size_t i = 0; i < engine.size(); ++i) {
+        engine.set_gains(i, opt.kp, opt.ki, opt.kd);
+        engine.set_setpoint(i, opt.setpoint);
+    }
+    engine.set_sensor(opt.sensor);
+    engine.set_schedule(opt.schedule.get());
+    std::unique_ptr<LaneScript> script;
+    if (opt.script) script = std::make_unique<LaneScript>(*opt.script, engine.size(), lane_offset(opt));
+    LaneStepper stepper(engine, pool.get());
+
+    std::unique_ptr<PerfCounters> counters;
+    if (opt.counters) counters = std::make_unique<PerfCounters>();
+    AllocationScope allocations;
+    auto start = std::chrono::steady_clock::now();
+    if (counters) counters->start();
+    if (script) run_script(engine, *script, opt.steps, opt.dt);
+    else stepper.advance(opt.steps, opt.dt);
+    if (counters) counters->stop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocated = allocations.count();
+
+    // The scalar calculate() -> update() pair is the reference every lane must reproduce
+    auto matches_scalar = [&](std::size_t lane) {
+        Simulation reference;
+        reference.pid = make_controller(opt);
+        reference.setpoint = opt.setpoint;
+        reference.set_sensor(opt.sensor, lane);
+        reference.schedule = opt.schedule.get();
+        if (opt.script) {
+            ScriptPlayer player(*opt.script, lane_offset(opt) * lane, lane);
+            run_script(reference, player, opt.steps, opt.dt);
+        } else {
+            run_headless(reference, opt.steps, opt.dt);
+        }
+        return engine.y[lane] == reference.ball.y && engine.velocity[lane] == reference.ball.velocity;
+    };
+    // A staggered script gives the last lane a different run from the first,
+    // and a pool steps it on another thread
+    bool exact = matches_scalar(0) && (!(opt.script || stepper.parallel()) || matches_scalar(engine.size() - 1));
+
+    double lane_steps = static_cast<double>(opt.steps) * engine.size();
+    std::printf("kernel       %s\n", engine.isa());
+    if (engine.register_run() && !script) std::printf("run kernel   registers, %u-step unroll\n", engine.unroll());
+    std::printf("lanes        %zu\n", engine.size());
+    if (stepper.parallel()) {
+        std::printf("threads      %u, %.2fx speedup\n", stepper.threads(), stepper.scaling().speedup());
+    } else if (pool && engine.size() < LaneStepper::DEFAULT_MIN_LANES) {
+        std::printf("threads      1 (fewer than %zu lanes)\n", LaneStepper::DEFAULT_MIN_LANES);
+    } else if (pool) {
+        std::printf("threads      1\n");
+    }
+    print_form(opt);
+    print_sensor(opt.sensor);
+    print_schedule(opt);
+    print_script(opt);
+    std::printf("steps        %llu\n", static_cast<unsigned long long>(opt.steps));
+    std::printf("wall time    %.3f s\n", seconds);
+    std::printf("lane-steps/s %.0f\n", seconds > 0 ? lane_steps / seconds : 0.0);
+    std::printf("final y      %.6f\n", engine.y[0]);
+    if (counters) print_counters(*counters, lane_steps, "lane-step");
+    std::printf("reference    %s\n", exact ? "bit-exact" : "MISMATCH");
+    if (opt.alloc_check && !report_allocations(allocated)) return 2;
+    return exact ? 0 : 2;
+}
+
+int run_graph(const Options& opt) {
+    const std::size_t lanes = std::max<uint64_t>(opt.lanes, 1);
+    GraphLoop loop = opt.graph == "cascade" ? make_cascade(opt.setpoint, lanes, opt.dt)
+                                            : make_single_loop(opt.kp, opt.ki, opt.kd, opt.setpoint, lanes, opt.dt);
+    MetricsAccumulator metrics(loop.graph.ball(loop.ball).y + BALL_SIZE / 2, opt.setpoint);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t s = 0; s < opt.steps; ++s) {
+        loop.graph.step();
+        if (opt.metrics) {
+            metrics.update(loop.graph.ball(loop.ball).y + BALL_SIZE / 2, opt.setpoint, loop.graph.value(loop.force), opt.dt);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const Ball& ball = loop.graph.ball(loop.ball);
+    std::printf("graph        %s\n", opt.graph.c_str());
+    std::printf("lanes        %zu\n", lanes);
+    std::printf("steps        %llu\n", static_cast<unsigned long long>(opt.steps));
+    std::printf("wall time    %.3f s\n", seconds);
+    std::printf("lane-steps/s %.0f\n", seconds > 0 ? static_cast<double>(opt.steps) * lanes / seconds : 0.0);
+    std::printf("final y      %.6f\n", ball.y);
+    std::printf("final v      %.6f\n", ball.velocity);
+    if (opt.metrics) print_metrics(metrics.metrics());
+    if (opt.graph != "single") return 0;
+
+    Simulation reference;
+    reference.pid = make_controller(opt);
+    reference.setpoint = opt.setpoint;
+    run_headless(reference, opt.steps, opt.dt);
+    bool exact = ball.y == reference.ball.y && ball.velocity == reference.ball.velocity;
+    std::printf("reference    %s\n", exact ? "bit-exact" : "MISMATCH");
+    return exact ? 0 : 2;
+}
+
+int run_multi_axis(const Options& opt) {
+    MultiAxisPlant plant(opt.axes);
+    plant.set_gains(opt.kp, opt.ki, opt.kd);
+    plant.set_setpoint(MultiAxisPlant::Y, opt.setpoint);
+    for (int a = 0; a < opt.targets; ++a) plant.set_setpoint(a, opt.target[a]);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t s = 0; s < opt.steps; ++s) plant.step(opt.dt);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    static const char* const names[] = {"x", "y", "z"};
+    std::printf("axes         %d\n", opt.axes);
+    std::printf("steps        %llu\n", static_cast<unsigned long long>(opt.steps));
+    std::printf("wall time    %.3f s\n", seconds);
+    std::printf("steps/sec    %.0f\n", seconds > 0 ? opt.steps / seconds : 0.0);
+    for (int a = 0; a < opt.axes; ++a) {
+        std::printf("final %s      %.6f (target %.1f, v %.6f)\n", names[a], plant.pv(a), plant.target(a), plant.velocity(a));
+    }
+    if (opt.axes < 2) return 0;
+
+    // The y axis is the original loop and must track it exactly
+    Simulation reference;
+    reference.pid = make_controller(opt);
+    reference.setpoint = plant.target(MultiAxisPlant::Y);
+    run_headless(reference, opt.steps, opt.dt);
+    bool exact = plant.position(MultiAxisPlant::Y) == reference.ball.y &&
+                 plant.velocity(MultiAxisPlant::Y) == reference.ball.velocity;
+    std::printf("reference    %s\n", exact ? "bit-exact" : "MISMATCH");
+    return exact ? 0 : 2;
+}
+
+int run_plant(const Options& opt) {
+    int status = 0;
+    visit_plant(opt.plant, [&](const auto& model) {
+        using Model = std::decay_t<decltype(model)>;
+        PlantLoop<Model> loop{model};
+        loop.pid = make_controller(opt);
+        loop.setpoint = opt.setpoint;
+        MetricsAccumulator metrics(loop.plant.output(), opt.setpoint);
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t s = 0; s < opt.steps; ++s) {
+            loop.step(opt.dt);
+            if (opt.metrics) metrics.update(loop.plant.output(), opt.setpoint, loop.output, opt.dt);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const PlantPreset& preset = plant_preset(opt.plant);
+        std::printf("plant        %s\n", preset.name);
+        std::printf("steps        %llu\n", static_cast<unsigned long long>(opt.steps));
+        std::printf("wall time    %.3f s\n", seconds);
+        std::printf("steps/sec    %.0f\n", seconds > 0 ? opt.steps / seconds : 0.0);
+        std::printf("final pv     %.6f %s (setpoint %g)\n", loop.plant.output(), preset.unit, opt.setpoint);
+        std::printf("final u      %.6f\n", loop.output);
+        if (opt.metrics) print_metrics(metrics.metrics());
+
+        if constexpr (std::is_same_v<Model, BallPlant>) {
+            // The ball model is the original loop and must track it exactly
+            Simulation reference;
+            reference.pid = make_controller(opt);
+            reference.setpoint = opt.setpoint;
+            run_headless(reference, opt.steps, opt.dt);
+            const Ball& ball = loop.plant.ball;
+            bool exact = ball.y == reference.ball.y && ball.velocity == reference.ball.velocity;
+            std::printf("reference    %s\n", exact ? "bit-exact" : "MISMATCH");
+            if (!exact) status = 2;
+        }
+    });
+    return status;
+}
+
+#ifdef PID_HAVE_GPU
+// Sweep on the GPU, then re-run the sampled cells and the winner on the CPU
+// and fail if any cost differs by more than GlSweep::TOLERANCE (relative)
+int run_gpu_sweep(const SweepConfig& cfg) {
+    GlSweep gpu;
+    auto start = std::chrono::steady_clock::now();
+    GpuSweepResult result = gpu.run(cfg);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    SweepResult cells;  // only for the gains/index helpers
+    cells.config = cfg;
+    std::vector<std::size_t> checked(result.sample.size());
+    for (std::size_t i = 0; i < checked.size(); ++i) checked[i] = i;
+    checked.push_back(result.best);
+
+    BatchEngine engine(checked.size());
+    for (std::size_t i = 0; i < checked.size(); ++i) {
+        double kp, ki, kd;
+        cells.gains(checked[i], kp, ki, kd);
+        engine.set_gains(i, kp, ki, kd);
+        engine.set_setpoint(i, cfg.setpoint);
+    }
+    double worst = 0.0;
+    for (std::size_t begin = 0; begin < checked.size(); begin += BatchEngine::BLOCK_LANES) {
+        std::size_t end = std::min(begin + BatchEngine::BLOCK_LANES, checked.size());
+        std::size_t padded_end = (end + BatchEngine::LANE_PAD - 1) / BatchEngine::LANE_PAD * BatchEngine::LANE_PAD;
+        LoopMetrics block[BatchEngine::BLOCK_LANES];
+        evaluate_metrics(engine, begin, padded_end, cfg.steps, cfg.dt, block);
+        for (std::size_t i = begin; i < end; ++i) {
+            double gpu_cost = i < result.sample.size() ? result.sample[i] : result.best_cost;
+            double cpu_cost = block[i - begin].iae;
+            worst = std::max(worst, std::abs(gpu_cost - cpu_cost) / std::max(std::abs(cpu_cost), 1e-12));
+        }
+    }
+
+    double kp, ki, kd;
+    cells.gains(result.best, kp, ki, kd);
+    double lane_steps = static_cast<double>(cfg.steps) * result.cells;
+    std::printf("device       %s\n", gpu.device().c_str());
+    std::printf("candidates   %zu\n", result.cells);
+    std::printf("wall time    %.3f s\n", seconds);
+    std::printf("lane-steps/s %.0f\n", seconds > 0 ? lane_steps / seconds : 0.0);
+    std::printf("best gains   Kp=%g Ki=%g Kd=%g\n", kp, ki, kd);
+    std::printf("best IAE     %.6f\n", result.best_cost);
+    std::printf("cpu check    %zu cells, max rel. diff %.3e (%s)\n", checked.size(), worst,
+                worst <= GlSweep::TOLERANCE ? "ok" : "OUT OF TOLERANCE");
+    return worst <= GlSweep::TOLERANCE ? 0 : 2;
+}
+#endif
+
+void commit_store(ResultStore& store, std::size_t before) {
+    auto start = std::chrono::steady_clock::now();
+    store.commit();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::printf("store        %zu rows, %zu new, indexed in %.1f ms\n", store.size(), store.size() - before, ms);
+}
+
+// Prints the rows of --store matching --where
+int run_store_query(const Options& opt) {
+    ResultStore store(opt.store_path);
+    std::vector<StoreRange> where = parse_store_where(opt.where);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::size_t> rows = store.select(where);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("store        %zu rows (%zu indexed)\n", store.size(), store.indexed());
+    std::printf("matches      %zu\n", rows.size());
+    std::printf("query time   %.3f ms\n", ms);
+    if (rows.empty() || opt.limit == 0) return 0;
+    std::printf("%10s %10s %10s %12s %11s %11s %11s %6s\n", "Kp", "Ki", "Kd", "IAE", "overshoot%", "rise s",
+                "settling s", "steps");
+    for (std::size_t i = 0; i < rows.size() && i < opt.limit; ++i) {
+        StoreRow r = store.row(rows[i]);
+        std::printf("%10g %10g %10g %12.6g %11.4g %11.4g %11.4g %6llu\n", r.key.kp, r.key.ki, r.key.kd, r.metrics.iae,
+                    r.metrics.overshoot * 100.0, r.metrics.rise_time, r.metrics.settling_time,
+                    static_cast<unsigned long long>(r.key.steps));
+    }
+    return 0;
+}
+
+void print_sweep_summary(const SweepResult& result, double seconds) {
+    double kp, ki, kd;
+    std::size_t best = result.best();
+    result.gains(best, kp, ki, kd);
+    double lane_steps = static_cast<double>(result.config.steps) *
+                        static_cast<double>(result.cells() - result.cached - result.screened);
+    if (result.config.screen.enabled) {
+        std::printf("screen       %zu of %zu candidates rejected unsimulated\n", result.screened, result.cells());
+    }
+    if (result.config.early.any()) {
+        const EarlyStopStats& e = result.early;
+        std::printf("early stop   %llu settled, %llu saturated, %llu diverged; %.1f %% of lane-steps saved\n",
+                    static_cast<unsigned long long>(e.settled), static_cast<unsigned long long>(e.saturated),
+                    static_cast<unsigned long long>(e.diverged),
+                    lane_steps > 0 ? (1.0 - static_cast<double>(e.lane_steps) / lane_steps) * 100.0 : 0.0);
+        lane_steps = static_cast<double>(e.lane_steps);
+    }
+    std::printf("wall time    %.3f s\n", seconds);
+    std::printf("lane-steps/s %.0f\n", seconds > 0 ? lane_steps / seconds : 0.0);
+    std::printf("best gains   Kp=%g Ki=%g Kd=%g\n", kp, ki, kd);
+    std::printf("best IAE     %.6f\n", result.cost[best]);
+    if (result.config.metrics) print_metrics(result.metrics[best]);
+}
+
+MonteCarloConfig monte_carlo_config(const Options& opt, double kp, double ki, double kd) {
+    MonteCarloConfig mc = opt.mc;
+    mc.kp = kp;
+    mc.ki = ki;
+    mc.kd = kd;
+    mc.setpoint = opt.setpoint;
+    mc.steps = opt.steps;
+    mc.dt = opt.dt;
+    mc.samples = opt.monte_carlo;
+    mc.timing = opt.timing;
+    return mc;
+}
+
+void print_variation(const MonteCarloConfig& mc) {
+    const PlantVariation& v = mc.variation;
+    std::printf("samples      %zu (seed %llu)\n", mc.samples, static_cast<unsigned long long>(mc.seed));
+    std::printf("variation    gravity %.3g %%, mass %.3g %%, bounce %g:%g, noise %g px\n",
+                v.gravity_sigma * 100.0, v.mass_sigma * 100.0, v.bounce_min, v.bounce_max, v.noise_sigma);
+}
+
+// Robustness of one gain set, plus a zero-variation sample checked against
+// the nominal Simulation
+int run_monte_carlo_mode(const Options& opt) {
+    MonteCarloConfig mc = monte_carlo_config(opt, opt.kp, opt.ki, opt.kd);
+    ThreadPool pool(opt.threads);
+    auto start = std::chrono::steady_clock::now();
+    MonteCarloResult result = run_monte_carlo(pool, mc);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("threads      %u\n", pool.size());
+    print_variation(mc);
+    print_timing(mc.timing);
+    std::printf("gains        Kp=%g Ki=%g Kd=%g\n", mc.kp, mc.ki, mc.kd);
+    std::printf("wall time    %.3f s\n", seconds);
+    std::printf("samples/s    %.0f\n", seconds > 0 ? mc.samples / seconds : 0.0);
+
+    struct Row { const char* name; double LoopMetrics::*field; double scale; };
+    const Row rows[] = {
+        {"IAE", &LoopMetrics::iae, 1.0},
+        {"ISE", &LoopMetrics::ise, 1.0},
+        {"ITAE", &LoopMetrics::itae, 1.0},
+        {"overshoot %", &LoopMetrics::overshoot, 100.0},
+        {"rise time s", &LoopMetrics::rise_time, 1.0},
+        {"settling s", &LoopMetrics::settling_time, 1.0},
+        {"effort", &LoopMetrics::effort, 1.0},
+    };
+    std::printf("%-12s %12s %12s %12s %12s %12s %12s %9s\n", "", "mean", "stddev", "p5", "p50", "p95", "worst", "samples");
+    for (const Row& row : rows) {
+        MetricSummary s = result.summary(row.field);
+        std::printf("%-12s %12.6g %12.6g %12.6g %12.6g %12.6g %12.6g %9zu\n", row.name, s.mean * row.scale,
+                    s.stddev * row.scale, s.p05 * row.scale, s.p50 * row.scale, s.p95 * row.scale,
+                    s.worst * row.scale, s.defined);
+    }
+
+    if (!mc.timing.ideal()) {
+        // Same plants and noise with an ideal controller; what the timing costs
+        MonteCarloConfig ideal = mc;
+        ideal.timing = ComputeTimingModel{};
+        MonteCarloResult baseline = run_monte_carlo(pool, ideal);
+        std::printf("\n%-12s %12s %12s %9s %12s %12s %9s\n", "vs ideal", "p50 ideal", "p50", "change", "p95 ideal",
+                    "p95", "change");
+        auto change = [](double base, double value) {
+            return base != 0.0 ? (value - base) / std::fabs(base) * 100.0 : 0.0;
+        };
+        for (const Row& row : rows) {
+            MetricSummary b = baseline.summary(row.field), s = result.summary(row.field);
+            std::printf("%-12s %12.6g %12.6g %8.1f%% %12.6g %12.6g %8.1f%%\n", row.name, b.p50 * row.scale,
+                        s.p50 * row.scale, change(b.p50, s.p50), b.p95 * row.scale, s.p95 * row.scale,
+                        change(b.p95, s.p95));
+        }
+        std::printf("unsettled    %zu samples (%zu with ideal timing)\n",
+                    mc.samples - result.summary(&LoopMetrics::settling_time).defined,
+                    mc.samples - baseline.summary(&LoopMetrics::settling_time).defined);
+    }
+
+    MonteCarloConfig nominal = mc;
+    nominal.variation = {0.0, 0.0, BOUNCE_COEFFICIENT, BOUNCE_COEFFICIENT, 0.0};
+    nominal.timing = ComputeTimingModel{};
+    LoopMetrics sample = run_monte_carlo_sample(nominal, 0);
+    Simulation reference;
+    reference.pid = PID_Controller(mc.kp, mc.ki, mc.kd);
+    reference.setpoint = mc.setpoint;
+    MetricsAccumulator metrics(reference.measurement, reference.setpoint);
+    run_headless(reference, mc.steps, mc.dt, &metrics);
+    bool exact = sample.iae == metrics.metrics().iae && sample.ise == metrics.metrics().ise &&
+                 sample.effort == metrics.metrics().effort;
+    std::printf("nominal      %s\n", exact ? "bit-exact" : "MISMATCH");
+    return exact ? 0 : 2;
+}
+
+// Searches the gains, then reruns the winner through the scalar Simulation:
+// its metrics must match the batch lane's bit for bit
+int run_auto_tune_mode(const Options& opt) {
+    AutoTuneConfig cfg = opt.tune;
+    cfg.setpoint = opt.setpoint;
+    cfg.dt = opt.dt;
+    cfg.steps = opt.steps_given ? opt.steps : cfg.steps;
+    cfg.compensation = opt.compensation;
+    std::unique_ptr<ResultStore> store;
+    if (!opt.store_path.empty()) store = std::make_unique<ResultStore>(opt.store_path);
+    cfg.store = store.get();
+    const std::size_t stored_before = store ? store->size() : 0;
+
+    ThreadPool pool(opt.threads);
+    auto start = std::chrono::steady_clock::now();
+    AutoTuneResult result = run_auto_tune(pool, cfg);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Simulation sim;
+    sim.pid = PID_Controller(result.kp, result.ki, result.kd);
+    sim.pid.set_compensation(cfg.compensation);
+    sim.setpoint = cfg.setpoint;
+    MetricsAccumulator metrics(sim.measurement, sim.setpoint);
+    run_headless(sim, cfg.steps, cfg.dt, &metrics);
+    const bool exact = auto_tune_cost(cfg, metrics.metrics()) == result.cost;
+
+    std::printf("threads      %u\n", pool.size());
+    std::printf("search box   Kp 0:%g Ki 0:%g Kd 0:%g\n", cfg.kp_max, cfg.ki_max, cfg.kd_max);
+    print_form(opt);
+    std::printf("generations  %zu x %zu candidates (seed %llu)\n", result.history.size(), cfg.population,
+                static_cast<unsigned long long>(cfg.seed));
+    std::printf("wall time    %.3f s\n", seconds);
+    std::printf("evals/s      %.0f\n", seconds > 0 ? result.evaluations / seconds : 0.0);
+    if (store) commit_store(*store, stored_before);
+    std::printf("best gains   Kp=%g Ki=%g Kd=%g\n", result.kp, result.ki, result.kd);
+    std::printf("cost         %.6f (ITAE + %g x effort)\n", result.cost, cfg.effort_weight);
+    print_metrics(result.metrics);
+    std::printf("reference    %s\n", exact ? "bit-exact" : "MISMATCH");
+    return exact ? 0 : 2;
+}
+
+// Checks the AD gradient at the start against central differences, then
+// descends; the final cost must match a scalar Simulation metrics run bit for bit
+int run_grad_tune_mode(const Options& opt) {
+    GradientTuneConfig cfg;
+    cfg.kp = opt.kp;
+    cfg.ki = opt.ki;
+    cfg.kd = opt.kd;
+    cfg.kp_max = opt.tune.kp_max;
+    cfg.ki_max = opt.tune.ki_max;
+    cfg.kd_max = opt.tune.kd_max;
+    cfg.effort_weight = opt.tune.effort_weight;
+    cfg.setpoint = opt.setpoint;
+    cfg.dt = opt.dt;
+    cfg.steps = opt.steps_given ? opt.steps : cfg.steps;
+    if (opt.grad_iterations) cfg.iterations = opt.grad_iterations;
+    cfg.validate();
+
+    CostGradient start = cost_gradient(cfg, cfg.kp, cfg.ki, cfg.kd);
+    const double gains[3] = {cfg.kp, cfg.ki, cfg.kd};
+    const double box[3] = {cfg.kp_max, cfg.ki_max, cfg.kd_max};
+    double worst = 0.0;
+    for (int i = 0; i < 3; ++i) {
+        double h = 1e-6 * box[i], lo[3], hi[3];
+        if (h == 0.0) continue;
+        std::copy(gains, gains + 3, lo);
+        std::copy(gains, gains + 3, hi);
+        lo[i] -= h;
+        hi[i] += h;
+        double fd = (cost_only(cfg, hi[0], hi[1], hi[2]) - cost_only(cfg, lo[0], lo[1], lo[2])) / (2.0 * h);
+        worst = std::max(worst, std::abs(fd - start.gradient[i]) / std::max(std::abs(fd), 1e-9));
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    GradientTuneResult result = run_gradient_tune(cfg);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    Simulation sim;
+    sim.pid = PID_Controller(result.kp, result.ki, result.kd);
+    sim.setpoint = cfg.setpoint;
+    MetricsAccumulator metrics(sim.measurement, sim.setpoint);
+    run_headless(sim, cfg.steps, cfg.dt, &metrics);
+    AutoTuneConfig cost_of;
+    cost_of.effort_weight = cfg.effort_weight;
+    const bool exact = auto_tune_cost(cost_of, metrics.metrics()) == result.at_best.cost;
+
+    std::printf("start        Kp=%g Ki=%g Kd=%g, cost %.6f\n", cfg.kp, cfg.ki, cfg.kd, start.cost);
+    std::printf("gradient     %.6g %.6g %.6g (1 run)\n", start.gradient[0], start.gradient[1], start.gradient[2]);
+    std::printf("fd check     max rel. diff %.3e against central differences (6 runs)\n", worst);
+    std::printf("evaluations  %u (%u steps taken), cost and gradient each\n", result.evaluations, result.accepted);
+    std::printf("wall time    %.3f s\n", seconds);
+    std::printf("best gains   Kp=%g Ki=%g Kd=%g\n", result.kp, result.ki, result.kd);
+    std::printf("cost         %.6f (ITAE + %g x effort)\n", result.at_best.cost, cfg.effort_weight);
+    print_metrics(metrics.metrics());
+    std::printf("reference    %s\n", exact ? "bit-exact" : "MISMATCH");
+    return exact ? 0 : 2;
+}
+
+// Largest relative difference allowed between the measured response and
+// loop_transfer(); what remains is transient and window leakage
+constexpr double BODE_MODEL_TOLERANCE = 1e-3;
+constexpr double DEGREES_PER_RADIAN = 57.295779513082321;
+
+// Bode/Nyquist analysis. The measured response is checked against the
+// analytic model of the same discrete loop; exit 2 if they disagree.
+int run_bode(const Options& opt) {
+    FrequencyResponseConfig cfg = opt.bode_config;
+    cfg.kp = opt.kp;
+    cfg.ki = opt.ki;
+    cfg.kd = opt.kd;
+    cfg.setpoint = opt.setpoint;
+    cfg.dt = opt.dt;
+    cfg.delay_steps = opt.sensor.delay_steps;
+
+    auto start = std::chrono::steady_clock::now();
+    FrequencyResponse response = run_frequency_response(cfg);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    StabilityMargins m = response.margins();
+    double error = response.model_error();
+    const bool agrees = error <= BODE_MODEL_TOLERANCE;
+
+    auto at_hz = [](double hz) { return std::isnan(hz) ? std::string("(no crossing)") : "at " + std::to_string(hz) + " Hz"; };
+    std::printf("gains        Kp=%g Ki=%g Kd=%g\n", cfg.kp, cfg.ki, cfg.kd);
+    if (cfg.delay_steps) std::printf("sensor delay %u steps\n", cfg.delay_steps);
+    std::printf("points       %zu (%g to %g Hz)\n", cfg.points, cfg.min_hz, cfg.max_hz);
+    std::printf("lane-steps   %llu\n", static_cast<unsigned long long>(response.lane_steps));
+    std::printf("wall time    %.3f s\n", seconds);
+    std::printf("gain margin  %.3f dB %s\n", m.gain_margin_db, at_hz(m.phase_crossover_hz).c_str());
+    if (!std::isnan(m.lower_crossover_hz)) {
+        std::printf("lower margin %.3f dB %s\n", m.lower_gain_margin_db, at_hz(m.lower_crossover_hz).c_str());
+    }
+    std::printf("phase margin %.3f deg %s\n", m.phase_margin_deg, at_hz(m.gain_crossover_hz).c_str());
+    std::printf("min |1 + L|  %.4f at %g Hz\n", m.modulus_margin, m.modulus_hz);
+    std::printf("model check  max rel. diff %.3e (%s)\n", error, agrees ? "ok" : "OUT OF TOLERANCE");
+
+    if (!opt.bode_file.empty()) {
+        std::FILE* f = std::fopen(opt.bode_file.c_str(), "w");
+        if (!f) throw std::runtime_error("cannot write " + opt.bode_file);
+        std::fprintf(f, "hz,gain_db,phase_deg,model_gain_db,model_phase_deg,re,im\n");
+        for (const FrequencyPoint& p : response.points) {
+            std::fprintf(f, "%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n", p.hz, 20.0 * std::log10(std::abs(p.measured)),
+                         std::arg(p.measured) * DEGREES_PER_RADIAN, 20.0 * std::log10(std::abs(p.model)),
+                         std::arg(p.model) * DEGREES_PER_RADIAN, p.measured.real(), p.measured.imag());
+        }
+        std::fclose(f);
+    }
+    return agrees ? 0 : 2;
+}
+
+// Candidates re-ranked by Monte Carlo after a sweep
+constexpr std::size_t ROBUST_CANDIDATES = 8;
+
+// Runs --monte-carlo on the sweep's best cells by nominal IAE and lists them
+// by their 95th percentile IAE, the most robust first
+void print_robust_candidates(ThreadPool& pool, const Options& opt, const SweepResult& result) {
+    std::vector<std::size_t> order(result.cells());
+    for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::size_t count = std::min(ROBUST_CANDIDATES, order.size());
+    std::partial_sort(order.begin(), order.begin() + count, order.end(),
+                      [&](std::size_t a, std::size_t b) { return result.cost[a] < result.cost[b]; });
+
+    struct Candidate { std::size_t cell; MetricSummary iae; MetricSummary overshoot; };
+    std::vector<Candidate> candidates;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t c = 0; c < count; ++c) {
+        double kp, ki, kd;
+        result.gains(order[c], kp, ki, kd);
+        MonteCarloResult mc = run_monte_carlo(pool, monte_carlo_config(opt, kp, ki, kd));
+        candidates.push_back({order[c], mc.summary(&LoopMetrics::iae), mc.summary(&LoopMetrics::overshoot)});
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const Candidate& a, const Candidate& b) { return a.iae.p95 < b.iae.p95; });
+
+    print_variation(monte_carlo_config(opt, 0, 0, 0));
+    std::printf("robust time  %.3f s\n", seconds);
+    std::printf("%-30s %12s %12s %12s %14s\n", "robust ranking", "nominal IAE", "IAE p50", "IAE p95", "overshoot p95");
+    for (const Candidate& c : candidates) {
+        double kp, ki, kd;
+        result.gains(c.cell, kp, ki, kd);
+        char gains[64];
+        std::snprintf(gains, sizeof gains, "Kp=%g Ki=%g Kd=%g", kp, ki, kd);
+        std::printf("%-30s %12.6g %12.6g %12.6g %12.3f %%\n", gains, result.cost[c.cell], c.iae.p50, c.iae.p95,
+                    c.overshoot.p95 * 100.0);
+    }
+}
+
+// The sweep in float32, then a sample of its cells in double to show what
+// the smaller layout cost in accuracy
+int run_compact_sweep_mode(const Options& opt, const SweepConfig& cfg) {
+    ThreadPool pool(opt.threads);
+    auto start = std::chrono::steady_clock::now();
+    SweepResult result = run_compact_sweep(pool, cfg, opt.compact_gains);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    CompactEngine probe(0, opt.compact_gains, cfg);
+    std::printf("threads      %u\n", pool.size());
+    std::printf("candidates   %zu\n", result.cells());
+    std::printf("compact      %s, %zu B per loop (%.1f MiB), kernel %s\n", compact_gains_name(opt.compact_gains),
+                probe.bytes_per_lane(), probe.bytes_per_lane() * static_cast<double>(result.cells()) / (1 << 20),
+                probe.isa());
+    print_sweep_summary(result, seconds);
+
+    CompactAccuracy a = compact_accuracy(pool, result);
+    std::printf("double check %zu cells, IAE rel. error max %.3e, mean %.3e\n", a.cells, a.max_rel_error,
+                a.mean_rel_error);
+    std::printf("best check   double IAE %.6f at the compact best, %.6f best sampled\n", a.best_cost,
+                a.reference_best);
+    return 0;
+}
+
+int run_sweep_mode(Options opt) {
+    // Unswept gains stay at the scalar --kp/--ki/--kd values
+    SweepConfig& cfg = opt.sweep_config;
+    if (!opt.swept[0]) cfg.kp = {opt.kp, opt.kp, 1};
+    if (!opt.swept[1]) cfg.ki = {opt.ki, opt.ki, 1};
+    if (!opt.swept[2]) cfg.kd = {opt.kd, opt.kd, 1};
+    cfg.setpoint = opt.setpoint;
+    cfg.dt = opt.dt;
+    cfg.steps = opt.steps;
+    cfg.metrics = opt.metrics;
+    cfg.form = opt.form;
+    cfg.feed_forward = opt.compensation.feed_forward;
+#ifdef PID_HAVE_GPU
+    if (opt.gpu) return run_gpu_sweep(cfg);
+#endif
+
+    if (opt.compact) return run_compact_sweep_mode(opt, cfg);
+
+    if (opt.coordinator_port) {
+        std::printf("coordinator  listening on port %d\n", opt.coordinator_port);
+        std::fflush(stdout);
+        ClusterStats stats;
+        auto start = std::chrono::steady_clock::now();
+        SweepResult result = run_cluster_sweep(cfg, opt.cluster, &stats);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("workers      %zu (%zu lost)\n", stats.workers, stats.lost_workers);
+        std::printf("chunks       %zu (%zu reissued, %zu speculative)\n", stats.chunks, stats.reissued, stats.speculative);
+        std::printf("candidates   %zu\n", result.cells());
+        print_sweep_summary(result, seconds);
+        if (!opt.export_path.empty()) {
+            // Cells arrive in chunks over the network; write them once they are all in
+            Exporter out(opt.export_path, sweep_export_columns(cfg.metrics));
+            export_sweep(result, out);
+            finish_export(out, opt.export_path);
+        }
+        return 0;
+    }
+
+    std::unique_ptr<ResultCache> cache;
+    if (!opt.cache_path.empty()) {
+        cache = std::make_unique<ResultCache>(ResultCache::DEFAULT_CAPACITY, opt.cache_path);
+        cfg.cache = cache.get();
+    }
+    std::unique_ptr<ResultStore> store;
+    if (!opt.store_path.empty()) {
+        store = std::make_unique<ResultStore>(opt.store_path);
+        if (!cache) cache = std::make_unique<ResultCache>();
+        cache->attach(store.get());
+        cfg.cache = cache.get();
+    }
+    const std::size_t stored_before = store ? store->size() : 0;
+
+    print_form(opt);
+    std::unique_ptr<ThreadPool> pool_storage;
+    if (opt.numa) {
+        NumaTopology topology = NumaTopology::detect();
+        unsigned threads = opt.threads ? opt.threads : static_cast<unsigned>(topology.cpus());
+        pool_storage = std::make_unique<ThreadPool>(topology.spread(threads));
+        std::printf("numa         %s; %u of %u threads pinned\n", topology.describe().c_str(), pool_storage->pinned(),
+                    threads);
+    } else {
+        pool_storage = std::make_unique<ThreadPool>(opt.threads);
+    }
+    ThreadPool& pool = *pool_storage;
+    std::unique_ptr<Exporter> out;
+    if (!opt.export_path.empty()) {
+        out = std::make_unique<Exporter>(opt.export_path, sweep_export_columns(cfg.metrics), pool.size());
+        cfg.exporter = out.get();
+    }
+    std::unique_ptr<Exporter> trajectories;
+    if (!opt.trajectories_path.empty()) {
+        trajectories = std::make_unique<Exporter>(opt.trajectories_path, sweep_trajectory_columns(), pool.size());
+        cfg.trajectories = trajectories.get();
+        cfg.trajectory_every = std::max<uint64_t>(opt.trajectory_every, 1);
+    }
+    auto start = std::chrono::steady_clock::now();
+    SweepResult result = run_sweep(pool, cfg);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("threads      %u\n", pool.size());
+    std::printf("candidates   %zu\n", result.cells());
+    if (cache) {
+        ResultCacheStats stats = cache->stats();
+        std::printf("cache        %llu hits (%llu from disk), %llu misses, %.1f %% hit rate, %zu stored\n",
+                    static_cast<unsigned long long>(stats.hits + stats.disk_hits),
+                    static_cast<unsigned long long>(stats.disk_hits),
+                    static_cast<unsigned long long>(stats.misses), stats.hit_rate() * 100.0, stats.disk_entries);
+    }
+    if (store) commit_store(*store, stored_before);
+    print_sweep_summary(result, seconds);
+    if (cfg.early.any()) {
+        // The best cost may be extrapolated; rerun that cell to the end
+        SweepConfig full = cfg;
+        full.early = EarlyStop{};
+        full.exporter = nullptr;
+        result.gains(result.best(), full.kp.min, full.ki.min, full.kd.min);
+        full.kp = {full.kp.min, full.kp.min, 1};
+        full.ki = {full.ki.min, full.ki.min, 1};
+        full.kd = {full.kd.min, full.kd.min, 1};
+        std::printf("best full    IAE %.6f without early stopping\n", run_sweep(pool, full).cost[0]);
+    }
+    if (out) finish_export(*out, opt.export_path);
+    if (trajectories) {
+        // Every simulated cell, one row per kept step
+        const uint64_t expected = (result.cells() - result.screened) * (cfg.steps / cfg.trajectory_every);
+        finish_export(*trajectories, opt.trajectories_path);
+        if (trajectories->rows_written() != expected) {
+            std::printf("trajectories MISMATCH: %llu rows expected\n", static_cast<unsigned long long>(expected));
+            return 2;
+        }
+    }
+    if (opt.monte_carlo) print_robust_candidates(pool, opt, result);
+    return 0;
+}
+
+int run_worker_mode(const Options& opt) {
+    std::printf("worker       %s\n", opt.worker.c_str());
+    std::fflush(stdout);
+    auto start = std::chrono::steady_clock::now();
+    std::size_t chunks = run_cluster_worker(opt.worker, opt.threads);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("chunks       %zu\n", chunks);
+    std::printf("wall time    %.3f s\n", seconds);
+    return 0;
+}
+
+int run_hil_mode(const Options& opt) {
+    HilConfig config;
+    config.dt = opt.dt;
+    config.cycles = opt.steps_given ? opt.steps : config.cycles;
+    config.setpoint = opt.setpoint;
+    config.kp = opt.kp;
+    config.ki = opt.ki;
+    config.kd = opt.kd;
+
+    std::unique_ptr<Plant> plant;
+    if (opt.hil == "sim") plant = std::make_unique<SimulatedPlant>(opt.dt);
+    else plant = std::make_unique<SerialPlant>(opt.hil, opt.baud);
+
+    if (opt.realtime.any()) {
+        std::string problems = apply_realtime(opt.realtime);
+        if (!problems.empty()) std::fprintf(stderr, "pid_headless: realtime setup incomplete:\n%s", problems.c_str());
+    }
+    std::printf("plant        %s\n", opt.hil.c_str());
+    std::printf("rate         %.1f Hz\n", 1.0 / opt.dt);
+    HilReport report = run_hil(*plant, config);
+    report.print(stdout);
+    if (auto* serial = dynamic_cast<SerialPlant*>(plant.get())) {
+        std::printf("bad frames   %llu\n", static_cast<unsigned long long>(serial->framing_errors()));
+    }
+    return report.missed_deadlines ? 2 : 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        Options opt = parse_options(argc, argv);
+        if (!opt.hil.empty()) return run_hil_mode(opt);
+        if (!opt.worker.empty()) return run_worker_mode(opt);
+        if (!opt.where.empty()) return run_store_query(opt);
+        if (!opt.graph.empty()) return run_graph(opt);
+        if (opt.axes) return run_multi_axis(opt);
+        if (!opt.plant.empty()) return run_plant(opt);
+        if (opt.sweep) return run_sweep_mode(opt);
+        if (opt.lanes > 0) return run_batched(opt);
+        if (!opt.golden.empty()) return run_golden(opt);
+        if (opt.monte_carlo) return run_monte_carlo_mode(opt);
+        if (opt.bode) return run_bode(opt);
+        if (opt.auto_tune) return run_auto_tune_mode(opt);
+        if (opt.grad_tune) return run_grad_tune_mode(opt);
+        if (opt.multi_rate) return run_multi_rate(opt);
+        if (!opt.reference.empty()) return run_tracking(opt);
+        if (!opt.export_path.empty()) return run_export(opt);
+        if (opt.plot_lod) return run_plot_lod(opt);
+
+        Simulation sim;
+        sim.pid = make_controller(opt);
+        sim.setpoint = opt.setpoint;
+        sim.integrator = opt.integrator;
+        sim.set_sensor(opt.sensor);
+        sim.set_timing(opt.timing);
+        sim.schedule = opt.schedule.get();
+        opt.config.apply_plant(sim);
+        std::unique_ptr<AsyncLogger> log;
+        if (!opt.log_path.empty()) {
+            log = std::make_unique<AsyncLogger>(opt.log_path);
+            sim.events = log.get();
+        }
+
+        MetricsAccumulator metrics(sim.measurement, sim.setpoint);
+        StateHasher hasher = make_hasher(opt, opt.dt);
+        FloatEnvironment env;
+        std::unique_ptr<PerfCounters> counters;
+        if (opt.counters) counters = std::make_unique<PerfCounters>();
+        AllocationScope allocations;
+        RunStats stats;
+        if (counters) counters->start();
+        if (opt.script) {
+            ScriptPlayer player(*opt.script);
+            stats = run_script(sim, player, opt.steps, opt.dt, opt.metrics ? &metrics : nullptr,
+                               hashing(opt) ? &hasher : nullptr);
+        } else {
+            stats = run_headless(sim, opt.steps, opt.dt, opt.metrics ? &metrics : nullptr,
+                                 hashing(opt) ? &hasher : nullptr);
+        }
+        if (counters) counters->stop();
+        uint64_t allocated = allocations.count();
+
+        std::printf("integrator   %s\n", integrator_name(opt.integrator));
+        print_form(opt);
+        print_sensor(opt.sensor);
+        print_timing(opt.timing);
+        print_schedule(opt);
+        print_script(opt);
+        print_config(opt);
+        std::printf("steps        %llu\n", static_cast<unsigned long long>(stats.steps));
+        std::printf("sim time     %.3f s\n", stats.steps * opt.dt);
+        std::printf("wall time    %.3f s\n", stats.seconds);
+        std::printf("steps/sec    %.0f\n", stats.steps_per_second());
+        std::printf("final y      %.6f\n", sim.ball.y);
+        std::printf("final v      %.6f\n", sim.ball.velocity);
+        if (counters) print_counters(*counters, static_cast<double>(stats.steps), "step");
+        if (!sim.timing.ideal()) {
+            std::printf("missed       %llu updates\n", static_cast<unsigned long long>(sim.timing.misses()));
+        }
+        if (log) {
+            log->close();
+            std::printf("log          %llu events to %s (%llu dropped)\n", static_cast<unsigned long long>(log->written()),
+                        opt.log_path.c_str(), static_cast<unsigned long long>(log->dropped()));
+        }
+        if (opt.metrics) print_metrics(metrics.metrics());
+        if (hashing(opt) && !report_hashes(opt, hasher, opt.dt)) return 2;
+        if (opt.alloc_check && !report_allocations(allocated)) return 2;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "pid_headless: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -1,221 +1,2073 @@
 #include <SDL.h>
 #include <SDL_ttf.h>
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+#include "core/alloc_counter.h"
+#include "core/app_config.h"
+#include "core/async_logger.h"
+#include "core/auto_tune.h"
+#include "core/batch_engine.h"
+#include "core/bench.h"
+#include "core/collisions.h"
+#include "core/control_graph.h"
+#include "core/determinism.h"
+#include "core/frame_arena.h"
+#include "core/frame_pacer.h"
+#include "core/frame_recorder.h"
+#include "core/frame_stats.h"
+#include "core/gain_map.h"
+#include "core/input_latency.h"
+#include "core/ghost_preview.h"
+#include "core/lane_stepper.h"
+#include "core/load_scaling.h"
+#include "core/multi_axis.h"
+#include "core/multi_rate.h"
+#include "core/physics_thread.h"
+#include "core/profiler.h"
+#include "core/reference.h"
+#include "core/remote_control.h"
+#include "core/scenario_script.h"
+#include "core/shm_telemetry.h"
+#include "core/simulation.h"
+#include "core/telemetry.h"
+#include "core/thread_pool.h"
+#include "core/trajectory.h"
+#include "core/udp_stream.h"
+#include "gui/ball_scene.h"
+#include "gui/cached_layer.h"
+#include "gui/embedded_font.h"
+#include "gui/ghost_view.h"
+#include "gui/glyph_atlas.h"
+#include "gui/heatmap_view.h"
+#include "gui/hud.h"
+#include "gui/plot.h"
+#include "gui/readout.h"
+#include "gui/render_backend.h"
+#include "gui/tile_view.h"
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 #include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 
 #undef main
 
-constexpr int WINDOW_WIDTH = 800;
-constexpr int WINDOW_HEIGHT = 800;
-constexpr int BALL_SIZE = 30;
-constexpr double GRAVITY = 98;
-constexpr double FIXED_TIMESTEP = 1.0 / 60.0;
+struct AppOptions {
+    // Substeps allowed per frame before the accumulator backlog is shed
+    int max_substeps = 8;
+    // Physics step; rendering interpolates between steps, so it can be coarser than the display
+    double timestep = FIXED_TIMESTEP;
+    // Simulated seconds per wall second, 0.1 to 100; [ and ] halve and double it
+    double warp = 1.0;
+    // Wall time a frame may spend stepping physics above 1x; a warp the CPU
+    // cannot sustain is shed beyond it, so the window stays responsive
+    double warp_budget_ms = 8.0;
+    // Virtual clock for the frame loop: each frame stands for this many
+    // seconds whatever the wall clock says, 0 = wall clock
+    double frame_time = 0.0;
+    // Quit after this many frames, 0 = run until closed
+    uint64_t max_frames = 0;
+    // Render-rate cap, independent of the physics rate: 0 = off, < 0 = auto
+    // (at the display rate, only if presenting turns out not to wait for vsync)
+    double fps = -1.0;
+    // Step physics on its own fixed-rate thread instead of inside the frame loop
+    bool physics_thread = false;
+    // Scheduling for that thread; a period-jitter report is printed on exit
+    RealtimeOptions realtime;
+    // Span of the live trajectory plot
+    double history_seconds = 10.0;
+    // Binary per-step telemetry log, empty = off
+    std::string record_path;
+    // Live per-step stream to HOST:PORT over UDP, empty = off
+    std::string udp_destination;
+    // Live per-step ring in the named shared-memory segment, empty = off
+    std::string shm_name;
+    // TCP control endpoint, PORT (loopback only) or HOST:PORT, empty = off
+    std::string control_address;
+    // Play back a telemetry log instead of simulating, starting at replay_start seconds
+    std::string replay_path;
+    double replay_start = 0.0;
+    // Window with a GPU or software renderer, or an offscreen surface with
+    // no window (gui/render_backend.h); auto probes for the fastest that opens
+    RenderBackend render_backend = RenderBackend::Auto;
+    // Per-frame phase timings as CSV, empty = off
+    std::string frame_stats_path;
+    // Integral saturation, wall hits, missed updates and frame stalls as
+    // they happen, through core/async_logger.h; "-" = stderr, empty = off
+    std::string log_path;
+    // Exit with status 2 if a frame without input allocated after warm-up
+    bool alloc_check = false;
+    // Stop rendering and block on input once the loop has settled
+    bool idle = false;
+    double idle_error = 2.0;     // px
+    double idle_velocity = 1.0;  // px/s
+    double idle_hold = 0.5;      // s both must stay under threshold
+    // Extra balls stepped as one SoA batch behind the interactive one, each
+    // with its own gains; 0 = off
+    std::size_t scene_balls = 0;
+    // Let the scene balls collide with each other (core/collisions.h); they
+    // start stacked so that none overlap
+    bool scene_collide = false;
+    // Start with the gain-space heatmap shown, and the metric it colours by
+    bool heatmap = false;
+    CostMetric heatmap_metric = CostMetric::Iae;
+    // Step a ControlGraph preset ("single" or "cascade") instead of the fixed
+    // loop; the gain keys tune its primary controller. Empty = off
+    std::string graph;
+    // Step a MultiAxisPlant with this many axes (2 adds x); the mouse sets
+    // a 2D target. 1 = the plain vertical loop
+    int axes = 1;
+    // Delay, quantization and noise between the ball and its controller
+    // (and the --scene balls); ideal by default
+    SensorModel sensor;
+    // Derivative low-pass time constant in seconds (0 = raw) and whether
+    // it differentiates the measurement rather than the error
+    double d_filter = 0.0;
+    bool d_on_measurement = false;
+    // Feed-forward and disturbance observer on the controller's output;
+    // off by default
+    Compensation compensation;
+    // Compute delay and missed controller updates (core/compute_timing.h);
+    // ideal by default
+    ComputeTimingModel timing;
+    // Window recording: a video file (through ffmpeg) or a %d image
+    // sequence, captured at capture_fps; empty = off
+    std::string capture_path;
+    double capture_fps = 60.0;
+    // Setpoint of every physics step as a core/reference.h trajectory, for
+    // pid_headless --reference; empty = off
+    std::string reference_path;
+    // Rolling controller + ball state hash every hash_every steps, for
+    // pid_headless --check-hashes to verify a replay of the session; empty = off
+    std::string hash_path;
+    uint64_t hash_every = 1000;
+    // core/scenario_script.h events played into the loop as their steps
+    // come due, as pid_headless --script does; empty = off
+    std::string script_path;
+    // Extra loops tiled beside the interactive one, all on its setpoint,
+    // as Kp, Ki, Kd each; empty = the usual single view
+    std::vector<std::array<double, 3>> compare;
+    // Plant, controller and sensor at their own rates (core/multi_rate.h);
+    // one physics step is one controller period, drawn at the display rate
+    bool multi_rate = false;
+    MultiRateConfig rates;
+    // Search the gains by CMA-ES at startup, as T does (core/auto_tune.h)
+    bool auto_tune = false;
+    // Plant constants, initial gains, timestep and key steps
+    // (core/app_config.h); with a path, edits to the file apply live
+    std::string config_path;
+    AppConfig config;
+};
 
-class PID_Controller {
+class App {
 public:
-    PID_Controller(double kp, double ki, double kd)
-            : Kp(kp), Ki(ki), Kd(kd) {}
+    explicit App(const AppOptions& options)
+            : options(options),
+              history(static_cast<std::size_t>(options.history_seconds / options.timestep)) {
+        display = open_render_output(options.render_backend, "PID Control Simulator", WINDOW_WIDTH, WINDOW_HEIGHT);
+        init_pacing();
+        warp = warp_achieved = options.warp;
+        background = std::make_unique<CachedLayer>(display.renderer.get(), WINDOW_WIDTH, WINDOW_HEIGHT, true);
+
+        config = options.config;
+        config.apply_plant(sim);
+        sim.pid = PID_Controller(config.kp, config.ki, config.kd);
+        sim.pid.integral_limit = config.integral_limit;
+        if (!options.config_path.empty()) config_watcher = std::make_unique<ConfigWatcher>(options.config_path);
+        if (!options.log_path.empty()) {
+            event_log = std::make_unique<AsyncLogger>(options.log_path);
+            sim.events = event_log.get();
+        }
+        sim.set_sensor(options.sensor);
+        sim.set_timing(options.timing);
+        sim.pid.derivative_filter = options.d_filter;
+        sim.pid.derivative_on_measurement = options.d_on_measurement;
+        sim.pid.set_compensation(options.compensation);
+        if (options.scene_balls > 0) init_scene();
+        if (!options.compare.empty()) init_tiles();
+        if (!options.graph.empty()) {
+            graph = std::make_unique<GraphLoop>(
+                    options.graph == "cascade" ? make_cascade(sim.setpoint, 1, options.timestep)
+                                               : make_single_loop(sim.pid.Kp, sim.pid.Ki, sim.pid.Kd, sim.setpoint,
+                                                                  1, options.timestep));
+            const PID_Controller& c = graph->graph.pid(graph->controller);
+            sim.pid = PID_Controller(c.Kp, c.Ki, c.Kd);
+        }
+        if (options.axes > 1) {
+            plane = std::make_unique<MultiAxisPlant>(options.axes);
+            plane->set_gains(sim.pid.Kp, sim.pid.Ki, sim.pid.Kd);
+            sim.ball.x = prev_ball_x = plane->position(MultiAxisPlant::X);
+        }
+        if (options.multi_rate) {
+            rate_loop = std::make_unique<MultiRateLoop>(options.rates, sim.pid, sim.setpoint, options.sensor);
+            apply_plant(config);
+        }
+        // The preview starts from App's own Simulation, which only the default loop steps
+        if (options.replay_path.empty() && !options.physics_thread && !graph && !plane && !tile_engine && !rate_loop) {
+            ghost = std::make_unique<GhostPreview>(GHOST_HORIZON, options.timestep);
+            ghost_view = std::make_unique<GhostView>(display.renderer.get());
+        }
+        if (options.heatmap && options.replay_path.empty()) set_heatmap_mode(1);
+        if (options.auto_tune) start_auto_tune();
 
-    double calculate(double setpoint, double pv, double dt) {
-        double error = setpoint - pv;
-        integral += error * dt;
-        integral = std::clamp(integral, -1000.0, 1000.0);
-        double derivative = (error - prev_error) / dt;
-        prev_error = error;
-        return Kp * error + Ki * integral + Kd * derivative;
+        if (!options.record_path.empty()) {
+            recorder = std::make_unique<TelemetryRecorder>(options.record_path, options.timestep);
+            recording_path = options.record_path;
+        }
+        if (!options.reference_path.empty()) {
+            reference_out = std::make_unique<ReferenceWriter>(options.reference_path, options.timestep);
+        }
+        if (!options.hash_path.empty()) state_hashes = std::make_unique<StateHasher>(options.hash_every);
+        if (!options.script_path.empty()) {
+            script = std::make_unique<ScenarioScript>(ScenarioScript::load(options.script_path, options.timestep));
+            script_player = std::make_unique<ScriptPlayer>(*script);
+        }
+        if (!options.udp_destination.empty()) {
+            streamer = std::make_unique<UdpStreamer>(options.udp_destination, options.timestep);
+        }
+        if (!options.control_address.empty()) {
+            remote = std::make_unique<RemoteControl>(options.control_address);
+            SDL_Log("Remote control listening on port %u", remote->port());
+        }
+        if (!options.shm_name.empty()) {
+            shm = std::make_unique<ShmTelemetryWriter>(options.shm_name, options.timestep);
+        }
+        if (!options.frame_stats_path.empty()) {
+            frame_csv.reset(std::fopen(options.frame_stats_path.c_str(), "w"));
+            if (!frame_csv) throw std::runtime_error("cannot write " + options.frame_stats_path);
+            FrameStats::write_csv_header(frame_csv.get());
+        }
+        if (!options.capture_path.empty()) {
+            int w = WINDOW_WIDTH, h = WINDOW_HEIGHT;
+            SDL_GetRendererOutputSize(display.renderer.get(), &w, &h);  // larger than the window on HiDPI displays
+            capture = std::make_unique<FrameRecorder>(options.capture_path, w, h, options.capture_fps);
+        }
+    }
+
+    ~App() {
+        if (tune_thread.joinable()) tune_thread.join();
     }
 
-    void reset() {
-        integral = 0.0;
-        prev_error = 0.0;
+    void run() {
+        if (!options.replay_path.empty()) {
+            run_replay();
+            close_capture();
+            return;
+        }
+        if (options.physics_thread) {
+            run_threaded();
+            return;
+        }
+
+        while (true) {
+            // Sleep until input arrives or the next batch of steps is due;
+            // a NULL event leaves the event in the queue for handle_events.
+            // The virtual clock never waits: its time does not pass by itself
+            if (settled && options.frame_time == 0.0) SDL_WaitEventTimeout(nullptr, idle_wait_ms());
+            if (!iterate(host_frame_time())) break;
+        }
+        finish();
     }
 
-    double Kp = 80.0;
-    double Ki = 0;
-    double Kd = 0;
+    // One frame of the default fixed-step loop: the frame's events, physics
+    // for the time since the previous call, and drawing. It never waits for
+    // input, so a host can call it from its own loop (emscripten_set_main_loop,
+    // an editor tick, a test harness) instead of run(). With frame_seconds
+    // >= 0 the clock is virtual: every frame stands for exactly that much
+    // time, the wall-clock physics budget and frame pacing are left to the
+    // host, and the same input gives the same steps on every run. Returns
+    // false once the app should quit; call finish() then.
+    bool iterate(double frame_seconds = -1.0) {
+        const double ticks_per_second = perf_frequency;
+        if (!loop_started) {
+            loop_started = true;
+            last_time = SDL_GetPerformanceCounter();
+        }
+        virtual_clock = frame_seconds >= 0.0;
+        Uint64 current_time = SDL_GetPerformanceCounter();
+        double frame_time = 0.0;
+        if (virtual_clock) {
+            frame_time = frame_seconds;
+            virtual_now += frame_seconds;
+        } else {
+            frame_time = (current_time - last_time) / ticks_per_second;
+            last_time = current_time;
+        }
+        const double now = virtual_clock ? virtual_now : current_time / ticks_per_second;
+        accumulator += frame_time * warp;
 
-private:
-    double integral = 0.0;
-    double prev_error = 0.0;
-};
+        begin_frame();
+        bool running = true;
+        bool had_input = handle_events(running);
+        end_phase(FramePhase::Events);
 
-class Ball {
-public:
-    SDL_Rect rect{0, 0, BALL_SIZE, BALL_SIZE};  // 修正：初始化x,y位置
-    double y = WINDOW_HEIGHT / 2.0;
-    double velocity = 0.0;
+        int substeps = 0;
+        const double dt = options.timestep;
+        const double step_wall = dt / warp;  // wall time one step stands for
+        // Wall time the next step stands for: the accumulator is how far physics trails the clock
+        double slot = now - accumulator / warp;
+        const int limit = static_cast<int>(std::ceil(options.max_substeps * std::max(warp, 1.0)));
+        const Uint64 deadline = SDL_GetPerformanceCounter() +
+                                static_cast<Uint64>(options.warp_budget_ms * 1e-3 * ticks_per_second);
+        bool over_budget = false;
+        while (accumulator >= dt && substeps < limit) {
+            int n = 1;
+            if (inputs.empty() && drag.empty()) {
+                // Nothing to apply between steps: take them as one run,
+                // reading the clock once per WARP_CHUNK steps
+                double due = std::floor(accumulator / dt);
+                if (due * dt > accumulator) due -= 1.0;
+                n = static_cast<int>(std::clamp(due, 1.0, static_cast<double>(std::min(limit - substeps, WARP_CHUNK))));
+            } else {
+                apply_due_inputs(slot + step_wall);
+            }
+            advance(n, dt);
+            accumulator -= n * dt;
+            slot += n * step_wall;
+            substeps += n;
+            if (warp > 1.0 && !virtual_clock && SDL_GetPerformanceCounter() > deadline) {
+                over_budget = true;
+                break;
+            }
+        }
+        if (frame_time > 0.0) warp_achieved += (substeps * dt / frame_time - warp_achieved) * 0.05;
+        if (dragged) {
+            // One preview per frame, however many steps the drag moved
+            request_heatmap();
+            request_ghost();
+            dragged = false;
+        }
+        if (accumulator >= dt) {
+            // Over budget after a stall: drop whole steps instead of catching up
+            double backlog = accumulator - std::fmod(accumulator, dt);
+            accumulator -= backlog;
+            if (over_budget || (substeps >= limit && warp > 1.0)) {
+                ++warp_limited_frames;  // asked for more than the CPU gives, not a stall
+                if (event_log) event_log->log("warp %gx over budget, shed %g s of physics", warp, backlog);
+            } else {
+                dropped_time += backlog;
+                ++stalled_frames;
+                if (event_log) event_log->log("frame stalled, dropped %g s of physics", backlog);
+            }
+        }
+        end_phase(FramePhase::Physics);
 
-    Ball() {
-        rect.x = WINDOW_WIDTH / 2 - BALL_SIZE / 2;  // 设置初始x位置
-        rect.y = static_cast<int>(y);  // 设置初始y位置
+        if (options.max_frames && ++loop_frames >= options.max_frames) running = false;
+        double ball_y = prev_ball_y + (sim.ball.y - prev_ball_y) * (accumulator / dt);
+        if (options.idle) {
+            update_settled(substeps * dt, had_input);
+            // Idle frames are only drawn if the picture would actually change
+            if (settled && !had_input && static_cast<int>(ball_y) == drawn_ball_y &&
+                static_cast<int>(sim.setpoint) == drawn_setpoint) {
+                return running;
+            }
+        }
+        drawn_ball_y = static_cast<int>(ball_y);
+        drawn_setpoint = static_cast<int>(sim.setpoint);
+        render(ball_y, sim.setpoint, accumulator / dt);
+        end_frame(substeps);
+        return running;
     }
 
-    void update(double force, double dt) {
-        double acceleration = force - GRAVITY;
-        velocity += acceleration * dt;
-        y += velocity * dt;
-        apply_boundary_constraints();
-        rect.y = static_cast<int>(y);
+    // What run() passes to iterate(): the --frame-time virtual clock, or
+    // -1 for the wall clock
+    double host_frame_time() const { return options.frame_time > 0.0 ? options.frame_time : -1.0; }
+
+    // Summaries and file finalization after the last iterate()
+    void finish() {
+        if (stalled_frames > 0) {
+            SDL_Log("Dropped %.3f s of simulated time over %llu frames (max %d substeps/frame)",
+                    dropped_time, static_cast<unsigned long long>(stalled_frames), options.max_substeps);
+        }
+        if (warp_limited_frames > 0) {
+            SDL_Log("Time warp fell short of the request on %llu frames (%.1f ms physics budget)",
+                    static_cast<unsigned long long>(warp_limited_frames), options.warp_budget_ms);
+        }
+        close_recorder();
+        close_capture();
+        latency.print(stdout);
+        if (collide_steps > 0) {
+            SDL_Log("Scene collisions: %zu balls on %u threads, %.3f ms per step, %llu contacts in the last",
+                    collider->size(), scene_pool->size(), collide_seconds * 1e3 / collide_steps,
+                    static_cast<unsigned long long>(collider->contacts()));
+        }
+        if (scene_stepper && scene_stepper->scaling().steps > 0) {
+            const LaneStepper::Scaling& scaling = scene_stepper->scaling();
+            SDL_Log("Scene stepping: %zu balls on %u threads, %.3f ms per step, %.2fx speedup",
+                    scene_engine->size(), scene_stepper->threads(), scaling.wall * 1e3 / scaling.steps,
+                    scaling.speedup());
+        }
+        if (rate_loop) {
+            SDL_Log("Multi-rate: %llu plant steps at %g Hz, controller %g Hz, sensor %g Hz",
+                    static_cast<unsigned long long>(rate_loop->ticks()), options.rates.plant_hz,
+                    options.rates.controller_hz, options.rates.sensor_hz);
+        }
+        if (drag.motions() > 0) {
+            SDL_Log("Resampled %llu drag motions (%llu coalesced) into %llu physics steps",
+                    static_cast<unsigned long long>(drag.motions()), static_cast<unsigned long long>(drag.coalesced()),
+                    static_cast<unsigned long long>(drag.steps()));
+        }
     }
 
+    // Frames past warm-up with no input, and how many of them allocated
+    uint64_t idle_frames() const { return steady_frames; }
+    uint64_t allocating_frames() const { return steady_allocating_frames; }
+    // The latest frames' phase timings
+    const FrameStats& frame_timings() const { return frame_stats; }
+
 private:
-    void apply_boundary_constraints() {
-        if (y < 0) {
-            y = 0;
-            velocity *= -0.3;
-        } else if (y > WINDOW_HEIGHT - BALL_SIZE) {
-            y = WINDOW_HEIGHT - BALL_SIZE;
-            velocity *= -0.3;
+    // Lays a Kp x Kd grid over the scene: Kp rises left to right, Kd cycles
+    // through 16 values (one colour each) within every Kp group.
+    //
+    // One persistent pool steps the lanes and resolves their contacts. A
+    // scene too small to gain from it and without collisions never starts
+    // one; a larger one has each block of lanes first touched by the
+    // participant that steps it.
+    void init_scene() {
+        const std::size_t n = std::min(options.scene_balls, BallScene::MAX_BALLS);
+        if (n >= LaneStepper::DEFAULT_MIN_LANES || options.scene_collide) scene_pool = std::make_unique<ThreadPool>();
+        scene_engine = scene_pool ? std::make_unique<BatchEngine>(n, *scene_pool) : std::make_unique<BatchEngine>(n);
+        const std::size_t groups = (n + 15) / 16;
+        for (std::size_t i = 0; i < n; ++i) {
+            double kp = 20.0 + 380.0 * static_cast<double>(i / 16) / std::max<std::size_t>(groups - 1, 1);
+            scene_engine->set_gains(i, kp, 0.0, static_cast<double>(i % 16) * 2.5);
+            scene_engine->set_setpoint(i, sim.setpoint);
         }
+        scene = std::make_unique<BallScene>(display.renderer.get(), n);
+        if (options.scene_collide) init_collisions();
+        scene_engine->set_sensor(options.sensor);
+        scene_stepper = std::make_unique<LaneStepper>(*scene_engine, scene_pool.get());
     }
-};
 
-class App {
-public:
-    App() {
-        if (SDL_Init(SDL_INIT_VIDEO)) throw std::runtime_error(SDL_GetError());
-        if (TTF_Init()) throw std::runtime_error(TTF_GetError());
-
-        window.reset(SDL_CreateWindow(
-                "PID Control Simulator",
-                SDL_WINDOWPOS_CENTERED,
-                SDL_WINDOWPOS_CENTERED,
-                WINDOW_WIDTH,
-                WINDOW_HEIGHT,
-                SDL_WINDOW_SHOWN
-        ));
-        if (!window) throw std::runtime_error(SDL_GetError());
-
-        renderer.reset(SDL_CreateRenderer(
-                window.get(),
-                -1,
-                SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
-        ));
-        if (!renderer) throw std::runtime_error(SDL_GetError());
-
-        load_font();
+    // Balls closer than one width in x share a column; each takes a level of
+    // its column's stack, centred on the interactive ball, and keeps that
+    // level's offset from the setpoint so the stack is at rest when settled.
+    // Levels get half a width of slack where the arena has room for it.
+    void init_collisions() {
+        const std::size_t n = scene->size();
+        const double width = scene->ball_width();
+        const auto levels = static_cast<std::size_t>(std::ceil(width * n / WINDOW_WIDTH));
+        const double gap = std::min(1.5 * width, static_cast<double>(WINDOW_HEIGHT - BALL_SIZE) / levels);
+        scene_stack_half = (levels - 1) / 2.0 * gap;
+        std::vector<double> x(n);
+        scene_level.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            x[i] = scene->center_x(i);
+            scene_level[i] = (static_cast<double>(i % levels) - (levels - 1) / 2.0) * gap;
+            scene_engine->y[i] = std::clamp(sim.ball.y + scene_level[i], 0.0, static_cast<double>(WINDOW_HEIGHT - BALL_SIZE));
+            scene_engine->set_setpoint(i, scene_setpoint(i));
+        }
+        collider = std::make_unique<BallCollider>(std::move(x), width);
     }
 
-    void run() {
+    // A colliding stack keeps to the arena as a whole: the setpoint is
+    // clamped so that no level of it asks for a place beyond a wall
+    double scene_setpoint(std::size_t i) const {
+        if (scene_level.empty()) return sim.setpoint;
+        const double lo = BALL_SIZE / 2.0 + scene_stack_half, hi = WINDOW_HEIGHT - BALL_SIZE / 2.0 - scene_stack_half;
+        return std::clamp(sim.setpoint, lo, hi) + scene_level[i];
+    }
+
+    void collide_scene(double dt) {
+        auto start = std::chrono::steady_clock::now();
+        collider->resolve(scene_engine->y.data(), scene_engine->velocity.data(), dt, scene_pool.get());
+        collide_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++collide_steps;
+    }
+
+    // Lane 0 mirrors `sim` and follows the gain keys; lane i > 0 runs --compare entry i - 1
+    void init_tiles() {
+        const std::size_t n = options.compare.size() + 1;
+        tile_engine = std::make_unique<BatchEngine>(n);
+        tile_engine->set_gains(0, sim.pid.Kp, sim.pid.Ki, sim.pid.Kd);
+        for (std::size_t i = 1; i < n; ++i) {
+            const auto& g = options.compare[i - 1];
+            tile_engine->set_gains(i, g[0], g[1], g[2]);
+        }
+        for (std::size_t i = 0; i < n; ++i) tile_engine->set_setpoint(i, sim.setpoint);
+        tile_engine->set_sensor(options.sensor);
+        tile_prev_y.assign(tile_engine->y.begin(), tile_engine->y.begin() + n);
+        tile_last_error.assign(n, 0.0);
+        tile_metrics.assign(n, MetricsAccumulator(sim.ball.y + BALL_SIZE/2, sim.setpoint));
+    }
+
+    void step_tiles(double dt) {
+        BatchEngine& e = *tile_engine;
+        const std::size_t n = tile_prev_y.size();
+        std::copy_n(e.y.begin(), n, tile_prev_y.begin());
+        std::copy_n(e.prev_error.begin(), n, tile_last_error.begin());
+        e.step(dt);
+        for (std::size_t i = 0; i < n; ++i) {
+            // Positional lanes don't keep their force; rebuild it as the
+            // kernel computed it. Velocity lanes hold it in integral[]
+            double force = e.integral[i];
+            if (e.form() == PidForm::Positional) {
+                force = e.kp[i] * e.prev_error[i] + e.ki[i] * e.integral[i] +
+                        e.kd[i] * (e.prev_error[i] - tile_last_error[i]) / dt;
+            }
+            tile_metrics[i].update(e.y[i] + BALL_SIZE/2, e.setpoint[i], force, dt);
+        }
+        if (tile_view) tile_view->push(e);
+    }
+
+    // Gains and step-response figures per tile; fixed buffers, no allocation
+    void draw_tiles(double alpha) {
+        if (!tile_view) tile_view = std::make_unique<TileView>(display.renderer.get(), *glyphs, frame_arena, tile_prev_y.size(),
+                                                               history.capacity());
+        const char* labels[TileView::MAX_TILES];
+        for (std::size_t i = 0; i < tile_view->size(); ++i) {
+            const LoopMetrics& m = tile_metrics[i].metrics();
+            std::snprintf(tile_text[i], sizeof(tile_text[i]), "%sKp %.1f  Ki %.2f  Kd %.1f\nIAE %.1f  overshoot %.1f%%",
+                          i == 0 ? "> " : "", tile_engine->kp[i], tile_engine->ki[i], tile_engine->kd[i], m.iae,
+                          m.overshoot * 100.0);
+            labels[i] = tile_text[i];
+        }
+        tile_view->draw(*tile_engine, tile_prev_y, alpha, labels);
+    }
+
+    // The config's plant on every loop App steps itself: sim and the
+    // --multi-rate loop
+    void apply_plant(const AppConfig& c) {
+        c.apply_plant(sim);
+        if (rate_loop) {
+            rate_loop->ball.gravity = c.gravity;
+            rate_loop->ball.bounce = c.bounce;
+            rate_loop->pid.integral_limit = c.integral_limit;
+        }
+    }
+
+    // BatchEngine lanes (heatmap sweeps, auto-tune) step GRAVITY and
+    // BOUNCE_COEFFICIENT; their results only describe sim when it does too
+    bool compiled_plant() const { return sim.ball.gravity == GRAVITY && sim.ball.bounce == BOUNCE_COEFFICIENT; }
+
+    // 0 = hidden, 1 = Kp x Kd, 2 = Kp x Ki; the worker starts on first use
+    void set_heatmap_mode(int mode) {
+        if (mode && !compiled_plant()) {
+            SDL_Log("Heatmap unavailable: its sweeps step the compiled plant, not the config's gravity and bounce");
+            return;
+        }
+        heatmap_mode = mode;
+        if (mode && !gain_map) {
+            gain_map = std::make_unique<GainMap>(options.heatmap_metric);
+            init_text();
+            heatmap_view = std::make_unique<HeatmapView>(display.renderer.get(), *glyphs);
+        }
+        request_heatmap();
+    }
+
+    // Predict the path under the current gains and setpoint; never waits on the worker
+    void request_ghost() {
+        if (ghost && show_ghost) ghost->request(sim);
+    }
+
+    // CMA-ES search over the batch engine from the current setpoint, on a
+    // background thread so frames keep coming; poll_auto_tune() applies the
+    // result like a key press once it is in. One search at a time.
+    void start_auto_tune() {
+        if (tune_thread.joinable()) return;
+        if (!compiled_plant()) {
+            SDL_Log("Auto-tune unavailable: it searches on the compiled plant, not the config's gravity and bounce");
+            return;
+        }
+        AutoTuneConfig cfg;
+        cfg.setpoint = sim.setpoint;
+        cfg.dt = options.timestep;
+        cfg.steps = static_cast<uint64_t>(std::llround(cfg.steps * FIXED_TIMESTEP / options.timestep));
+        cfg.compensation = options.compensation;  // tune for the loop that runs
+        tune_done.store(false, std::memory_order_relaxed);
+        tune_thread = std::thread([this, cfg] {
+            unsigned hw = std::thread::hardware_concurrency();
+            ThreadPool pool(hw > 1 ? hw - 1 : 1);  // leave the UI its core
+            auto start = std::chrono::steady_clock::now();
+            tune_result = run_auto_tune(pool, cfg);
+            tune_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            tune_done.store(true, std::memory_order_release);
+        });
+    }
+
+    void poll_auto_tune() {
+        if (!tune_thread.joinable() || !tune_done.load(std::memory_order_acquire)) return;
+        tune_thread.join();
+        sim.pid.Kp = tune_result.kp;
+        sim.pid.Ki = tune_result.ki;
+        sim.pid.Kd = tune_result.kd;
+        apply_gains();
+        SDL_Log("Auto-tune: Kp=%g Ki=%g Kd=%g, ITAE + effort cost %.3f after %zu runs in %.3f s",
+                tune_result.kp, tune_result.ki, tune_result.kd, tune_result.cost, tune_result.evaluations,
+                tune_seconds);
+    }
+
+    // Recentre the map on the current gains; never waits on the worker
+    void request_heatmap() {
+        if (!gain_map || !heatmap_mode) return;
+        gain_map->request({sim.pid.Kp, sim.pid.Ki, sim.pid.Kd, sim.setpoint,
+                           heatmap_mode == 1 ? GainAxes::KpKd : GainAxes::KpKi});
+    }
+
+    void update_settled(double elapsed, bool had_input) {
+        bool quiet = std::abs(sim.pid.last_error()) < options.idle_error &&
+                     std::abs(sim.ball.velocity) < options.idle_velocity;
+        settled_for = quiet && !had_input ? settled_for + elapsed : 0.0;
+        settled = settled_for >= options.idle_hold;
+    }
+
+    // Long enough to stop spinning, short enough that the physics catch-up
+    // on wake stays within the per-frame substep budget
+    Uint32 idle_wait_ms() const {
+        double budget = (options.max_substeps - 1) * options.timestep;
+        return static_cast<Uint32>(std::clamp(budget, options.timestep, 0.1) * 1000);
+    }
+
+    // Render loop for --physics-thread: physics runs elsewhere, frames only
+    // read the latest published snapshot and post input as commands
+    void run_threaded() {
+        physics = std::make_unique<PhysicsThread>(sim, options.timestep);
+        physics->set_recorder(recorder.get());
+        physics->set_streamer(streamer.get());
+        physics->set_shm(shm.get());
+        physics->set_realtime(options.realtime);
+        physics->start();
+        if (!physics->realtime_problems().empty()) {
+            SDL_Log("Physics thread realtime setup incomplete:\n%s", physics->realtime_problems().c_str());
+        }
+
         bool running = true;
-        Uint32 last_time = SDL_GetTicks();
-        double accumulator = 0.0;
+        uint64_t recorded_step = 0;
+        while (running) {
+            begin_frame();
+            handle_events(running);
+            end_phase(FramePhase::Events);
+
+            const SimSnapshot& snap = physics->latest();
+            // Only the newest step of each frame reaches the plot in this mode
+            if (snap.step != recorded_step) {
+                history.push({snap.time, snap.y + BALL_SIZE/2, snap.setpoint, snap.error, snap.output});
+                recorded_step = snap.step;
+            }
+            double since_step = std::chrono::duration<double>(std::chrono::steady_clock::now() - snap.stepped_at).count();
+            double alpha = std::clamp(since_step / physics->timestep(), 0.0, 1.0);
+            end_phase(FramePhase::Physics);
+            render(snap.prev_y + (snap.y - snap.prev_y) * alpha, snap.setpoint);
+            end_frame(0);
+        }
+
+        physics->stop();
+        if (physics->dropped_steps() > 0) {
+            SDL_Log("Physics thread fell behind and skipped %llu steps",
+                    static_cast<unsigned long long>(physics->dropped_steps()));
+        }
+        physics->jitter().print(stdout);
+        close_recorder();
+        close_capture();
+    }
+
+    struct Replay {
+        std::unique_ptr<TelemetryReader> log;
+        double time = 0.0;
+        double speed = 1.0;
+        bool paused = false;
+        uint64_t shown = 0;  // record currently on screen
+        std::unique_ptr<TrajectoryPyramid> lod;  // over the whole log, so the plot can zoom out to all of it
+    };
+
+    // Drives render() from a recorded log. Each frame seeks straight to the
+    // record for the playback clock, so fast-forward skips everything between.
+    void run_replay() {
+        replay = std::make_unique<Replay>();
+        replay->log = std::make_unique<TelemetryReader>(options.replay_path);
+        const TelemetryReader& log = *replay->log;
+        if (log.size() == 0) throw std::runtime_error(options.replay_path + " holds no records");
+        replay->time = std::clamp(options.replay_start, log.start_time(), log.end_time());
+        replay->shown = log.seek(replay->time);
+        replay->lod = std::make_unique<TrajectoryPyramid>(log.size());
+        for (uint64_t i = 0; i < log.size(); ++i) {
+            const TelemetryRecord& r = log[i];
+            const double values[PLOT_SERIES] = {r.pv, r.setpoint, r.error, r.output};
+            replay->lod->push(values);
+        }
+        // Open at the live plot's span; the wheel zooms out to the whole log
+        plot_view.span = static_cast<double>(history.capacity());
 
+        bool running = true;
+        const double ticks_per_second = static_cast<double>(SDL_GetPerformanceFrequency());
+        Uint64 last_time = SDL_GetPerformanceCounter();
         while (running) {
-            Uint32 current_time = SDL_GetTicks();
-            double frame_time = (current_time - last_time) / 1000.0;
+            Uint64 current_time = SDL_GetPerformanceCounter();
+            double frame_time = (current_time - last_time) / ticks_per_second;
             last_time = current_time;
-            accumulator += frame_time;
 
+            begin_frame();
             handle_events(running);
+            end_phase(FramePhase::Events);
+            if (!replay->paused) replay->time += frame_time * replay->speed;
+            replay->time = std::clamp(replay->time, log.start_time(), log.end_time());
+
+            uint64_t target = log.seek(replay->time);
+            replay->shown = target;
+
+            const TelemetryRecord& r = log[target];
+            std::snprintf(status_line, sizeof(status_line),
+                          "Replay %.2f / %.2f s  x%g%s\n"
+                          "Space pause, Up/Down speed\n"
+                          "Left/Right 10 s, PgUp/PgDn 60 s",
+                          r.time, log.end_time(), replay->speed, replay->paused ? " (paused)" : "");
+            end_phase(FramePhase::Physics);
+            render(r.pv - BALL_SIZE/2, r.setpoint);
+            end_frame(0);
+        }
+    }
+
+    // The wheel over the plot zooms its span by 2x; Shift+wheel, or a
+    // horizontal wheel, pans back through the retained samples
+    void handle_plot_wheel(const SDL_MouseWheelEvent& wheel) {
+        int mx, my;
+        SDL_GetMouseState(&mx, &my);
+        const SDL_FRect& a = PLOT_AREA;
+        if (!show_plot || mx < a.x || mx >= a.x + a.w || my < a.y || my >= a.y + a.h) return;
+        const double limit = replay ? static_cast<double>(replay->shown + 1) : static_cast<double>(history.capacity());
+        const double span = plot_view.span > 0.0 ? plot_view.span : limit;
+        const bool pan = wheel.x != 0 || (SDL_GetModState() & KMOD_SHIFT);
+        const int notches = wheel.x != 0 ? -wheel.x : wheel.y;
+        if (pan) {
+            const double step = std::max(1.0, span / 4.0) * notches;
+            const double back = std::clamp(static_cast<double>(plot_view.back) + step, 0.0, std::max(0.0, limit - span));
+            plot_view.back = static_cast<uint64_t>(back);
+        } else if (notches != 0) {
+            const double zoomed = notches > 0 ? span / 2.0 : span * 2.0;
+            plot_view.span = std::clamp(zoomed, 8.0, std::max(8.0, limit));
+        }
+    }
+
+    void handle_replay_key(SDL_Keycode key) {
+        switch (key) {
+            case SDLK_SPACE:    replay->paused = !replay->paused; break;
+            case SDLK_UP:       replay->speed = std::min(replay->speed * 2, 1024.0); break;
+            case SDLK_DOWN:     replay->speed = std::max(replay->speed / 2, 1.0 / 16); break;
+            case SDLK_RIGHT:    replay->time += 10; break;
+            case SDLK_LEFT:     replay->time -= 10; break;
+            case SDLK_PAGEUP:   replay->time += 60; break;
+            case SDLK_PAGEDOWN: replay->time -= 60; break;
+            case SDLK_HOME:     replay->time = replay->log->start_time(); break;
+            case SDLK_p:        show_plot = !show_plot; break;
+        }
+    }
+
+    void begin_frame() {
+        frame_arena.reset();
+        frame_allocations_start = thread_allocations();
+        frame_sample = FrameSample{};
+        frame_start = phase_start = SDL_GetPerformanceCounter();
+    }
 
-            while (accumulator >= FIXED_TIMESTEP) {
-                update_physics(FIXED_TIMESTEP);
-                accumulator -= FIXED_TIMESTEP;
+    void end_phase(FramePhase phase) {
+        Uint64 now = SDL_GetPerformanceCounter();
+        frame_sample.seconds[static_cast<int>(phase)] += (now - phase_start) / perf_frequency;
+        phase_start = now;
+    }
+
+    void end_frame(int substeps) {
+        frame_sample.total = (SDL_GetPerformanceCounter() - frame_start) / perf_frequency;
+        frame_sample.substeps = substeps;
+        frame_sample.allocations = thread_allocations() - frame_allocations_start;
+        // Input legitimately allocates (HUD text, worker requests); idle frames must not
+        if (frame_index >= ALLOC_WARMUP_FRAMES && !frame_had_input) {
+            ++steady_frames;
+            if (frame_sample.allocations > 0) {
+                if (event_log) {
+                    event_log->log("frame %g allocated %g times without input", static_cast<double>(frame_index),
+                                   static_cast<double>(frame_sample.allocations));
+                }
+                if (steady_allocating_frames == 0) {
+                    SDL_Log("Frame %llu allocated %llu times without input",
+                            static_cast<unsigned long long>(frame_index),
+                            static_cast<unsigned long long>(frame_sample.allocations));
+                }
+                ++steady_allocating_frames;
             }
+        }
+        frame_stats.push(frame_sample);
+        PID_PLOT("error", sim.pid.last_error());
+        PID_PLOT("substeps", substeps);
+        if (!virtual_clock) pace_frame();  // a virtual clock is paced by its host
+        PID_FRAME_MARK();
+        if (frame_csv) FrameStats::write_csv_row(frame_csv.get(), frame_index, frame_sample);
+        ++frame_index;
+    }
 
-            render();
+    void init_pacing() {
+        SDL_DisplayMode mode;
+        if (display.window && !SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(display.window.get()), &mode) &&
+            mode.refresh_rate > 0) {
+            display_hz = mode.refresh_rate;
+        }
+        const bool offscreen = display.backend == RenderBackend::Offscreen;
+        if (options.fps > 0) {
+            pacer.set_rate(options.fps);
+            pacing = true;
+        } else if (offscreen) {
+            // Nobody watches: frames go as fast as they render unless --fps caps them
+        } else if (options.fps < 0 && !display.vsync()) {
+            SDL_Log("Renderer %s has no vsync; capping at %d fps", display.info.name, display_hz);
+            pacer.set_rate(display_hz);
+            pacing = true;
         }
+        probing_vsync = options.fps < 0 && !pacing && !offscreen;
     }
 
-private:
-    std::unique_ptr<SDL_Window, decltype(&SDL_DestroyWindow)> window{nullptr, SDL_DestroyWindow};
-    std::unique_ptr<SDL_Renderer, decltype(&SDL_DestroyRenderer)> renderer{nullptr, SDL_DestroyRenderer};
-    std::unique_ptr<TTF_Font, decltype(&TTF_CloseFont)> font{nullptr, TTF_CloseFont};
+    // Auto mode watches the first second of frames: presents that return much
+    // faster than the display refreshes mean vsync is ignored (remote desktop,
+    // software rendering), and from then on the pacer holds the display rate
+    void pace_frame() {
+        if (probing_vsync) {
+            Uint64 now = SDL_GetPerformanceCounter();
+            if (probe_frames++ == 0) probe_start = now;
+            double elapsed = (now - probe_start) / perf_frequency;
+            if (elapsed >= 1.0) {
+                double fps = (probe_frames - 1) / elapsed;
+                if (fps > 1.5 * display_hz) {
+                    SDL_Log("Presenting at %.0f fps ignores vsync; capping at %d fps", fps, display_hz);
+                    pacer.set_rate(display_hz);
+                    pacing = true;
+                }
+                probing_vsync = false;
+            }
+        }
+        if (pacing) {
+            PID_ZONE("pace");
+            pacer.wait();
+        }
+    }
+
+    // p50/p99/max of every frame phase, the frame, substeps, allocations
+    // and click latency, in ms where they are times
+    void build_stats_panel() {
+        constexpr int PHASES = static_cast<int>(FramePhase::Count);
+        const SDL_Color black = {0, 0, 0, 255};
+        const char* rows[PHASES + 4];
+        for (int p = 0; p < PHASES; ++p) rows[p] = FrameStats::phase_name(static_cast<FramePhase>(p));
+        rows[PHASES] = "frame";
+        rows[PHASES + 1] = "substeps";
+        rows[PHASES + 2] = "allocs";
+        rows[PHASES + 3] = "click";
+
+        stats_panel = std::make_unique<ReadoutPanel>(*glyphs);
+        const int line = glyphs->line_height();
+        const int x = 10, top = WINDOW_HEIGHT - (PHASES + 5) * line - 10;
+        int name_w = glyphs->measure("ms");
+        for (const char* row : rows) name_w = std::max(name_w, glyphs->measure(row));
+        const int column = stats_panel->digit_width(7);
+        const char* heads[3] = {"p50", "p99", "max"};
+        stats_panel->add_label("ms", x, top, black);
+        for (int c = 0; c < 3; ++c) {
+            int right = x + name_w + (c + 1) * column;
+            stats_panel->add_label(heads[c], right - glyphs->measure(heads[c]), top, black);
+        }
+        for (int r = 0; r < PHASES + 4; ++r) {
+            int y = top + (r + 1) * line;
+            bool counts = r == PHASES + 1 || r == PHASES + 2;
+            stats_panel->add_label(rows[r], x, y, black);
+            for (int c = 0; c < 3; ++c) stats_panel->add_number(x + name_w + (c + 1) * column, y, counts ? 0 : 2, black);
+        }
+    }
+
+    void draw_frame_stats() {
+        if (!stats_panel) build_stats_panel();
+        std::size_t n = 0;
+        auto row = [&](const Percentiles& q, double scale) {
+            stats_panel->set(n++, q.p50 * scale);
+            stats_panel->set(n++, q.p99 * scale);
+            stats_panel->set(n++, q.max * scale);
+        };
+        for (int p = 0; p < static_cast<int>(FramePhase::Count); ++p) row(frame_stats.phase(static_cast<FramePhase>(p)), 1e3);
+        row(frame_stats.total(), 1e3);
+        row(frame_stats.substeps(), 1.0);
+        row(frame_stats.allocations(), 1.0);
+        row(latency.present_latency().summary(), 1e3);
+        stats_panel->draw();
+        if (scene_stepper) draw_scene_scaling();
+    }
+
+    // Threads stepping the scene, time per step and speedup over one
+    // thread, on the line above the panel; refreshed every 30 advances
+    void draw_scene_scaling() {
+        const LaneStepper::Scaling& now = scene_stepper->scaling();
+        if (now.steps == 0) return;
+        if (scene_text[0] == '\0' || now.calls >= scene_scaling_mark.calls + 30) {
+            const double wall = now.wall - scene_scaling_mark.wall, busy = now.busy - scene_scaling_mark.busy;
+            const uint64_t steps = now.steps - scene_scaling_mark.steps;
+            std::snprintf(scene_text, sizeof(scene_text), "Scene %zu balls: %u threads, %.3f ms/step, %.2fx",
+                          scene_engine->size(), scene_stepper->threads(), wall * 1e3 / steps,
+                          wall > 0.0 ? busy / wall : 1.0);
+            scene_scaling_mark = now;
+        }
+        constexpr int PHASES = static_cast<int>(FramePhase::Count);
+        const int line = glyphs->line_height();
+        glyphs->draw(scene_text, 10, WINDOW_HEIGHT - (PHASES + 6) * line - 10, {0, 0, 0, 255});
+    }
+
+    // Requested and achieved warp, bottom left, whenever time is not 1x
+    void draw_warp() {
+        if (warp == 1.0 && std::fabs(warp_achieved - 1.0) < 0.05) return;
+        std::snprintf(warp_text, sizeof(warp_text), "Warp %gx (achieved %.1fx)", warp, warp_achieved);
+        glyphs->draw(warp_text, 10, WINDOW_HEIGHT - 10 - glyphs->line_height(), {60, 60, 60, 255});
+    }
+
+    // Three rows of name, number and unit in three columns; numbers are
+    // added row by row, in the order draw_metrics() sets them
+    void build_metrics_panel(int x, int y) {
+        const SDL_Color grey = {60, 60, 60, 255};
+        const char* names[3][3] = {{"IAE", "ISE", "ITAE"}, {"Overshoot", "Rise", "Settle"}, {"Effort", nullptr, nullptr}};
+        const char* units[3][3] = {{"", "", ""}, {"%", "s", "s"}, {"", "", ""}};
+        const int precision[3][3] = {{2, 1, 2}, {1, 3, 3}, {0, 0, 0}};
+
+        metrics_panel = std::make_unique<ReadoutPanel>(*glyphs);
+        metrics_origin = {x, y};
+        const int space = glyphs->measure(" ");
+        const int number_w = metrics_panel->digit_width(7);
+        int name_w[3] = {}, column_x[3] = {};
+        for (int c = 0; c < 3; ++c) {
+            for (int r = 0; r < 3; ++r) {
+                if (names[r][c]) name_w[c] = std::max(name_w[c], glyphs->measure(names[r][c]));
+            }
+            column_x[c] = c == 0 ? x : column_x[c - 1] + name_w[c - 1] + number_w + glyphs->measure("%") + 3 * space;
+        }
+        for (int r = 0; r < 3; ++r) {
+            int row_y = y + r * glyphs->line_height();
+            for (int c = 0; c < 3 && names[r][c]; ++c) {
+                int right = column_x[c] + name_w[c] + space + number_w;
+                metrics_panel->add_label(names[r][c], column_x[c], row_y, grey);
+                metrics_panel->add_number(right, row_y, precision[r][c], grey);
+                if (*units[r][c]) metrics_panel->add_label(units[r][c], right + space / 2, row_y, grey);
+            }
+        }
+    }
+
+    // Metrics of the step response since the last setpoint change or reset
+    void draw_metrics(int x, int y) {
+        if (!metrics_panel || metrics_origin.x != x || metrics_origin.y != y) build_metrics_panel(x, y);
+        const LoopMetrics& m = metrics.metrics();
+        const double values[] = {m.iae, m.ise, m.itae, m.overshoot * 100.0, m.rise_time, m.settling_time, m.effort};
+        for (std::size_t i = 0; i < std::size(values); ++i) metrics_panel->set(i, values[i]);
+        metrics_panel->draw();
+    }
+
+    void close_recorder() {
+        if (event_log) {
+            sim.events = nullptr;
+            event_log->close();
+            SDL_Log("Logged %llu events to %s (%llu dropped)", static_cast<unsigned long long>(event_log->written()),
+                    options.log_path.c_str(), static_cast<unsigned long long>(event_log->dropped()));
+            event_log.reset();
+        }
+        if (streamer) {
+            streamer->close();
+            SDL_Log("Streamed %llu steps in %llu datagrams (%llu dropped)",
+                    static_cast<unsigned long long>(streamer->sent()),
+                    static_cast<unsigned long long>(streamer->datagrams()),
+                    static_cast<unsigned long long>(streamer->dropped()));
+        }
+        if (shm) {
+            shm->close();
+            SDL_Log("Published %llu steps to shared memory %s", static_cast<unsigned long long>(shm->published()),
+                    shm->name().c_str());
+        }
+        if (state_hashes) {
+            write_state_hashes(options.hash_path, *state_hashes, options.timestep);
+            SDL_Log("Hashed %llu steps into %zu checkpoints in %s, digest %016llx",
+                    static_cast<unsigned long long>(state_hashes->sampled()), state_hashes->checkpoints().size(),
+                    options.hash_path.c_str(), static_cast<unsigned long long>(state_hashes->digest()));
+            state_hashes.reset();
+        }
+        if (script_player) {
+            SDL_Log("Script %s fired %zu of %zu events over %llu steps", options.script_path.c_str(),
+                    script_player->fired(), script->events().size(), static_cast<unsigned long long>(script_step));
+            script_player.reset();
+        }
+        if (reference_out) {
+            reference_out->close();
+            SDL_Log("Recorded a %llu-step reference to %s", static_cast<unsigned long long>(reference_out->written()),
+                    options.reference_path.c_str());
+        }
+        stop_recording();
+    }
+
+    void stop_recording() {
+        if (!recorder) return;
+        recorder->close();
+        SDL_Log("Recorded %llu steps to %s (%llu dropped)",
+                static_cast<unsigned long long>(recorder->written()), recording_path.c_str(),
+                static_cast<unsigned long long>(recorder->dropped()));
+        recorder.reset();
+    }
 
-    Ball ball;
-    PID_Controller pid{80.0, 0, 0};
-    double setpoint = WINDOW_HEIGHT / 2.0;
+    void close_capture() {
+        if (!capture) return;
+        capture->close();
+        SDL_Log("Captured %llu frames to %s (%llu dropped while the encoder was behind)",
+                static_cast<unsigned long long>(capture->frames_written()), options.capture_path.c_str(),
+                static_cast<unsigned long long>(capture->frames_dropped()));
+    }
 
-    void load_font() {
-        font.reset(TTF_OpenFont("C:/Windows/Fonts/arial.ttf", 24));
-        if (!font) {
-            font.reset(TTF_OpenFont("/usr/share/fonts/truetype/freefont/FreeSans.ttf", 24));
-            if (!font) throw std::runtime_error(TTF_GetError());
+    // Reads the finished frame back into a pooled buffer for the encoder
+    // thread. Must come before SDL_RenderPresent, after which the back
+    // buffer is undefined. The readback itself waits for the GPU; the
+    // encoding and the disk never hold up the frame.
+    void capture_frame() {
+        // On a virtual clock the frames captured depend only on the frame count
+        const double now = virtual_clock ? virtual_now : SDL_GetPerformanceCounter() / perf_frequency;
+        if (!capture || !capture->due(now)) return;
+        PID_ZONE("capture");
+        uint8_t* pixels = capture->acquire();
+        if (!pixels) return;
+        if (SDL_RenderReadPixels(display.renderer.get(), nullptr, SDL_PIXELFORMAT_RGB24, pixels, capture->pitch()) == 0) {
+            capture->submit(pixels);
+        } else {
+            capture->discard(pixels);
         }
     }
 
-    void handle_events(bool& running) {
+    // Mirror a UI-side change into the physics thread, if one is running
+    void post(const SimCommand& cmd) {
+        if (physics && !physics->post(cmd)) SDL_Log("Physics command queue full, input dropped");
+    }
+
+    AppOptions options;
+    TrajectoryHistory history;
+    bool show_plot = true;
+    PlotView plot_view;
+    static constexpr SDL_FRect PLOT_AREA{WINDOW_WIDTH - 310.0f, 10.0f, 300.0f, 160.0f};
+    bool show_ghost = true;
+    // Before physics, so it outlives the thread that logs into it
+    std::unique_ptr<AsyncLogger> event_log;
+    std::unique_ptr<PhysicsThread> physics;
+    std::unique_ptr<ConfigWatcher> config_watcher;
+    AppConfig config;
+    std::unique_ptr<TelemetryRecorder> recorder;
+    std::string recording_path;
+    std::unique_ptr<RemoteControl> remote;
+    std::unique_ptr<UdpStreamer> streamer;
+    std::unique_ptr<ShmTelemetryWriter> shm;
+    std::unique_ptr<FrameRecorder> capture;
+    std::unique_ptr<Replay> replay;
+    static constexpr double MIN_WARP = 0.1, MAX_WARP = 100.0;
+    static constexpr int WARP_CHUNK = 64;  // steps between budget checks
+    double warp = 1.0;           // options.warp, changed by [ and ]
+    double warp_achieved = 1.0;  // simulated seconds per wall second, smoothed over frames
+    uint64_t warp_limited_frames = 0;
+    char warp_text[48] = "";
+
+    InputTimeline inputs;  // clicks waiting for their physics step
+    InputLatency latency;
+    DragPath drag;         // motions of the current drag, one setpoint per step
+    bool dragged = false;  // a step this frame took its setpoint from the drag
+    std::unique_ptr<ReferenceWriter> reference_out;
+    std::unique_ptr<StateHasher> state_hashes;
+    std::unique_ptr<ScenarioScript> script;
+    std::unique_ptr<ScriptPlayer> script_player;
+    uint64_t script_step = 0;  // physics steps since the script started
+
+    bool settled = false;
+    double settled_for = 0.0;
+    int drawn_ball_y = -1, drawn_setpoint = -1;
+
+    // Frame loop state between iterate() calls
+    bool loop_started = false;
+    Uint64 last_time = 0;
+    double accumulator = 0.0;  // wall time physics trails the clock, times warp
+    bool virtual_clock = false;
+    double virtual_now = 0.0;  // seconds on the virtual clock
+    uint64_t loop_frames = 0;
+
+    const double perf_frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+    Uint64 frame_start = 0, phase_start = 0;
+    FrameSample frame_sample;
+    FrameStats frame_stats;
+    uint64_t frame_index = 0;
+    FramePacer pacer;
+    bool pacing = false;  // off while presenting is paced by vsync
+    int display_hz = 60;
+    bool probing_vsync = false;
+    uint64_t probe_frames = 0;
+    Uint64 probe_start = 0;
+    static constexpr uint64_t ALLOC_WARMUP_FRAMES = 120;
+    uint64_t frame_allocations_start = 0;
+    bool frame_had_input = false;
+    uint64_t steady_frames = 0;             // frames past warm-up without input
+    uint64_t steady_allocating_frames = 0;  // ...of which allocated
+    bool show_frame_stats = false;
+    std::unique_ptr<ReadoutPanel> stats_panel;
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> frame_csv{nullptr, std::fclose};
+    char status_line[128] = "";
+    double dropped_time = 0.0;
+    uint64_t stalled_frames = 0;
+
+    RenderOutput display;
+    std::unique_ptr<TTF_Font, decltype(&TTF_CloseFont)> font{nullptr, TTF_CloseFont};
+    std::unique_ptr<CachedLayer> background;  // clear colour, grid and setpoint lines
+    int background_setpoint = INT_MIN, background_target_x = INT_MIN;
+    FrameArena frame_arena;  // per-frame vertex and point buffers
+    std::unique_ptr<GlyphAtlas> glyphs;
+    std::unique_ptr<Hud> hud;
+    std::unique_ptr<TrajectoryPlot> plot;
+    std::unique_ptr<BatchEngine> scene_engine;
+    std::unique_ptr<LaneStepper> scene_stepper;  // keeps the y the scene is drawn from
+    LaneStepper::Scaling scene_scaling_mark;     // scaling() when scene_text was written
+    char scene_text[96] = "";
+    std::unique_ptr<BallScene> scene;
+    std::unique_ptr<BallCollider> collider;
+    std::vector<double> scene_level;  // setpoint offset of each colliding ball's place in its stack
+    double scene_stack_half = 0.0;    // largest |scene_level|
+    std::unique_ptr<ThreadPool> scene_pool;
+    double collide_seconds = 0.0;
+    uint64_t collide_steps = 0;
+    std::unique_ptr<BatchEngine> tile_engine;
+    std::vector<double> tile_prev_y, tile_last_error;
+    std::vector<MetricsAccumulator> tile_metrics;
+    std::unique_ptr<TileView> tile_view;
+    char tile_text[TileView::MAX_TILES][96] = {};
+    std::unique_ptr<GainMap> gain_map;
+    std::unique_ptr<HeatmapView> heatmap_view;
+    std::unique_ptr<GraphLoop> graph;
+    std::unique_ptr<GhostPreview> ghost;
+    std::unique_ptr<GhostView> ghost_view;
+    static constexpr double GHOST_HORIZON = 5.0;  // s
+    int heatmap_mode = 0;
+
+    Simulation sim;
+    double prev_ball_y = sim.ball.y;  // state before the latest step, for interpolation
+    double prev_ball_x = sim.ball.x;
+    std::unique_ptr<MultiAxisPlant> plane;
+    std::unique_ptr<MultiRateLoop> rate_loop;
+    std::thread tune_thread;
+    std::atomic<bool> tune_done{false};
+    AutoTuneResult tune_result;  // written by tune_thread before tune_done
+    double tune_seconds = 0.0;
+    MetricsAccumulator metrics{sim.measurement, sim.setpoint};
+    std::unique_ptr<ReadoutPanel> metrics_panel;
+    SDL_Point metrics_origin = {0, 0};
+
+    // SDL_ttf, the font and everything that draws text start with the first
+    // frame that needs them, after the window is already up
+    void init_text() {
+        if (glyphs) return;
+        if (!TTF_WasInit() && TTF_Init()) throw std::runtime_error(TTF_GetError());
+        font.reset(TTF_OpenFontRW(SDL_RWFromConstMem(EMBEDDED_FONT, static_cast<int>(EMBEDDED_FONT_SIZE)), 1, 24));
+        if (!font) throw std::runtime_error(TTF_GetError());
+        glyphs = std::make_unique<GlyphAtlas>(display.renderer.get(), font.get(), frame_arena);
+        hud = std::make_unique<Hud>(display.renderer.get(), *glyphs);
+        hud->set_steps(config.kp_step, config.ki_step, config.kd_step);
+        plot = std::make_unique<TrajectoryPlot>(display.renderer.get(), *glyphs, frame_arena);
+    }
+
+    // Returns whether any event arrived this frame
+    bool handle_events(bool& running) {
+        PID_ZONE("handle_events");
+        bool any = false;
         SDL_Event e;
+        bool moved = false;  // physics thread only: the frame's last drag position
+        TimedInput pointer;
         while (SDL_PollEvent(&e)) {
+            any = true;
             if (e.type == SDL_QUIT) running = false;
-            else if (e.type == SDL_MOUSEBUTTONDOWN) {
-                setpoint = e.button.y;
+            else if (e.type == SDL_RENDER_TARGETS_RESET) {
+                // Target texture contents were lost
+                background->mark_dirty();
+                if (hud) hud->mark_dirty();
+                if (plot) plot->mark_dirty();
+                if (tile_view) tile_view->mark_dirty();
+            }
+            else if (e.type == SDL_MOUSEBUTTONDOWN && !replay) {
+                double world_y = e.button.y;
+                if (tile_view && !tile_view->world_y_at(e.button.x, e.button.y, world_y)) continue;
+                TimedInput input{event_time(e.button.timestamp), world_y, static_cast<double>(e.button.x)};
+                // The physics thread takes commands as they come; the frame loop waits for the click's step
+                if (physics || !inputs.push(input)) set_setpoint(input);
+                if (!physics) drag.begin(input);
+            }
+            else if (e.type == SDL_MOUSEMOTION && (e.motion.state & SDL_BUTTON_LMASK) && !replay) {
+                double world_y = e.motion.y;
+                if (tile_view && !tile_view->world_y_at(e.motion.x, e.motion.y, world_y)) continue;
+                pointer = {event_time(e.motion.timestamp), world_y, static_cast<double>(e.motion.x)};
+                if (physics) moved = true;
+                else drag.push(pointer);
+            }
+            else if (e.type == SDL_MOUSEWHEEL) {
+                handle_plot_wheel(e.wheel);
             }
             else if (e.type == SDL_KEYDOWN) {
                 handle_keypress(e.key.keysym.sym);
             }
         }
+        // The thread is sent one setpoint per frame, not one per motion
+        if (moved) set_setpoint(pointer);
+        poll_auto_tune();
+        if (poll_remote()) any = true;
+        if (poll_config()) any = true;
+        frame_had_input = any;
+        return any;
+    }
+
+    // SDL stamps events in SDL_GetTicks milliseconds; place them on the
+    // performance counter clock the frame loop runs on
+    double event_time(Uint32 timestamp) const {
+        Uint32 age_ms = SDL_GetTicks() - timestamp;  // unsigned, so a wrap in between still works
+        return SDL_GetPerformanceCounter() / perf_frequency - age_ms * 1e-3;
+    }
+
+    void set_setpoint(const TimedInput& input) {
+        move_setpoint(input);
+        request_heatmap();
+        request_ghost();
+    }
+
+    // set_setpoint() without the previews, cheap enough to run every step
+    void move_setpoint(const TimedInput& input) {
+        sim.setpoint = input.setpoint;
+        if (plane) plane->set_setpoint(MultiAxisPlant::X, input.x);
+        post({SimCommand::SetSetpoint, sim.setpoint});
+        if (scene_engine) {
+            for (std::size_t i = 0; i < scene_engine->size(); ++i) {
+                scene_engine->set_setpoint(i, scene_setpoint(i));
+            }
+        }
+        if (tile_engine) {
+            for (std::size_t i = 0; i < tile_engine->size(); ++i) tile_engine->set_setpoint(i, sim.setpoint);
+        }
+    }
+
+    // Applies the clicks that happened before the end of the step about to
+    // run, then the drag position at that moment
+    void apply_due_inputs(double slot_end) {
+        TimedInput input;
+        while (inputs.pop_due(slot_end, input)) {
+            set_setpoint(input);
+            latency.applied(input.at, SDL_GetPerformanceCounter() / perf_frequency);
+        }
+        if (drag.sample(slot_end, input)) {
+            move_setpoint(input);
+            dragged = true;
+        }
     }
 
     void handle_keypress(SDL_Keycode key) {
-        const double step = 5.0;
+        if (key == SDLK_F3) {
+            show_frame_stats = !show_frame_stats;
+            return;
+        }
+        if (replay) {
+            handle_replay_key(key);
+            return;
+        }
+        if (!physics && (key == SDLK_LEFTBRACKET || key == SDLK_RIGHTBRACKET || key == SDLK_BACKSLASH)) {
+            double w = key == SDLK_BACKSLASH ? 1.0 : key == SDLK_LEFTBRACKET ? warp / 2 : warp * 2;
+            warp = std::clamp(w, MIN_WARP, MAX_WARP);
+            return;
+        }
         switch (key) {
-            case SDLK_UP:    pid.Kp += step; break;
-            case SDLK_DOWN:  pid.Kp = std::max(0.0, pid.Kp - step); break;
-            case SDLK_LEFT:  pid.Ki = std::max(0.0, pid.Ki - 0.1); break;
-            case SDLK_RIGHT: pid.Ki += 0.1; break;
-            case SDLK_PAGEUP:    pid.Kd += step; break;
-            case SDLK_PAGEDOWN:  pid.Kd = std::max(0.0, pid.Kd - step); break;
-            case SDLK_r: pid.reset(); break;
+            case SDLK_UP:    sim.pid.Kp += config.kp_step; break;
+            case SDLK_DOWN:  sim.pid.Kp = std::max(0.0, sim.pid.Kp - config.kp_step); break;
+            case SDLK_LEFT:  sim.pid.Ki = std::max(0.0, sim.pid.Ki - config.ki_step); break;
+            case SDLK_RIGHT: sim.pid.Ki += config.ki_step; break;
+            case SDLK_PAGEUP:    sim.pid.Kd += config.kd_step; break;
+            case SDLK_PAGEDOWN:  sim.pid.Kd = std::max(0.0, sim.pid.Kd - config.kd_step); break;
+            case SDLK_p: show_plot = !show_plot; return;
+            case SDLK_h:
+                if (!tile_engine) set_heatmap_mode((heatmap_mode + 1) % 3);
+                return;
+            case SDLK_g:
+                show_ghost = !show_ghost;
+                request_ghost();
+                return;
+            case SDLK_t:
+                start_auto_tune();
+                return;
+            case SDLK_r:
+                reset_pid();
+                return;
+            case SDLK_v:
+                toggle_form();
+                return;
+            default: return;
+        }
+        apply_gains();
+    }
+
+    // Clears the integral and derivative history of every loop, as after a fresh start
+    void reset_pid() {
+        sim.pid.reset();
+        if (graph) graph->graph.pid(graph->controller).reset();
+        if (plane) plane->reset_controllers();
+        if (rate_loop) rate_loop->pid.reset();
+        post({SimCommand::ResetPid});
+        metrics.begin(sim.ball.y + BALL_SIZE/2, sim.setpoint);
+        // Setting the form again zeroes every lane's controller state
+        if (scene_engine) scene_engine->set_form(scene_engine->form());
+        if (tile_engine) {
+            tile_engine->set_form(tile_engine->form());
+            for (std::size_t i = 0; i < tile_metrics.size(); ++i) {
+                tile_metrics[i].begin(tile_engine->y[i] + BALL_SIZE/2, sim.setpoint);
+            }
+        }
+        if (hud) hud->mark_dirty();
+    }
+
+    // Switches every loop between the positional and velocity (incremental)
+    // forms. The scalar controllers carry their output across, so the ball
+    // feels no kick and later gain changes stay bumpless; the batch engines
+    // restart their lanes' controllers in the new form.
+    void toggle_form() {
+        PidForm form = sim.pid.form() == PidForm::Positional ? PidForm::Velocity : PidForm::Positional;
+        sim.pid.set_form(form);
+        if (graph) graph->graph.pid(graph->controller).set_form(form);
+        if (rate_loop) rate_loop->pid.set_form(form);
+        post({SimCommand::SetForm, static_cast<double>(form)});
+        if (scene_engine) scene_engine->set_form(form);
+        if (tile_engine) tile_engine->set_form(form);
+        if (hud) hud->mark_dirty();
+    }
+
+    // Applies edits to --config at the frame boundary, redoing only what
+    // each changed setting feeds: the plant constants go to the loop (and
+    // the physics thread) and the ghost, gains go out like a key press, key
+    // steps rebuild the HUD. Returns whether the file was reloaded.
+    bool poll_config() {
+        if (!config_watcher || replay) return false;
+        unsigned changed = config_watcher->poll(SDL_GetPerformanceCounter() / perf_frequency);
+        if (changed == ConfigWatcher::REJECTED) {
+            SDL_Log("Config %s not applied: %s", config_watcher->path().c_str(), config_watcher->error().c_str());
+            return true;
+        }
+        if (!changed) return false;
+        const AppConfig& next = config_watcher->config();
+        if (changed & AppConfig::Plant) {
+            apply_plant(next);
+            post({SimCommand::SetPlant, next.gravity, next.bounce, next.integral_limit});
+            request_ghost();
+            if (heatmap_mode && !compiled_plant()) {
+                SDL_Log("Heatmap hidden: its sweeps step the compiled plant, not the config's");
+                set_heatmap_mode(0);
+            }
+        }
+        if (changed & AppConfig::Timestep) {
+            if (const char* holder = timestep_holder()) {
+                SDL_Log("Config timestep %g s needs a restart: %s runs at the step it started with", next.timestep, holder);
+            } else {
+                options.timestep = next.timestep;
+                if (ghost) ghost = std::make_unique<GhostPreview>(GHOST_HORIZON, options.timestep);
+                request_ghost();
+            }
+        }
+        if (changed & AppConfig::Gains) {
+            sim.pid.Kp = next.kp;
+            sim.pid.Ki = next.ki;
+            sim.pid.Kd = next.kd;
+            apply_gains();
+        }
+        if ((changed & AppConfig::KeySteps) && hud) hud->set_steps(next.kp_step, next.ki_step, next.kd_step);
+        config = next;
+        SDL_Log("Reloaded config %s", config_watcher->path().c_str());
+        return true;
+    }
+
+    // What fixed options.timestep when it was built, if anything did; the
+    // plot keeps its sample count and so covers a different span
+    const char* timestep_holder() const {
+        if (physics) return "the physics thread";
+        if (rate_loop) return "--multi-rate";
+        if (graph) return "--graph";
+        if (recorder) return "the telemetry recording";
+        if (reference_out) return "--record-reference";
+        if (state_hashes) return "--record-hashes";
+        if (script) return "--script";
+        if (streamer) return "--udp";
+        if (shm) return "--shm";
+        return nullptr;
+    }
+
+    // Applies the commands that arrived on the control endpoint since the
+    // last frame, each the way the matching key or click would, and
+    // answers every one; returns whether there were any
+    bool poll_remote() {
+        if (!remote) return false;
+        bool any = false;
+        RemoteCommand cmd;
+        while (remote->poll(cmd)) {
+            remote->reply(apply_remote(cmd));
+            any = true;
+        }
+        return any;
+    }
+
+    RemoteReply apply_remote(const RemoteCommand& cmd) {
+        RemoteReply r;
+        r.client = cmd.client;
+        r.sequence = cmd.sequence;
+        r.op = cmd.op;
+        if (replay && cmd.op != RemoteOp::Query) {
+            r.status = RemoteStatus::Unavailable;
+            return r;
+        }
+        switch (cmd.op) {
+            case RemoteOp::SetSetpoint:
+                set_setpoint({SDL_GetPerformanceCounter() / perf_frequency, cmd.values[0],
+                              plane ? plane->target(MultiAxisPlant::X) : 0.0});
+                break;
+            case RemoteOp::SetGains:
+                sim.pid.Kp = cmd.values[0];
+                sim.pid.Ki = cmd.values[1];
+                sim.pid.Kd = cmd.values[2];
+                apply_gains();
+                break;
+            case RemoteOp::ResetPid:
+                reset_pid();
+                break;
+            case RemoteOp::StartRecording:
+                // The physics thread is handed its recorder once, before it starts
+                if (physics) r.status = RemoteStatus::Unavailable;
+                else if (recorder) r.status = RemoteStatus::Failed;
+                else r.status = start_recording(cmd.path[0] ? cmd.path : options.record_path);
+                break;
+            case RemoteOp::StopRecording:
+                if (physics) r.status = RemoteStatus::Unavailable;
+                else if (!recorder) r.status = RemoteStatus::Failed;
+                else stop_recording();
+                break;
+            case RemoteOp::Query: {
+                const bool threaded = physics != nullptr;
+                const SimSnapshot* snap = threaded ? &physics->latest() : nullptr;
+                double values[REMOTE_QUERY_VALUES] = {threaded ? snap->time : sim.time,
+                                                      threaded ? snap->setpoint : sim.setpoint,
+                                                      threaded ? snap->y : sim.ball.y,
+                                                      sim.pid.Kp, sim.pid.Ki, sim.pid.Kd,
+                                                      recorder ? 1.0 : 0.0};
+                std::copy(values, values + REMOTE_QUERY_VALUES, r.values);
+                r.count = REMOTE_QUERY_VALUES;
+                break;
+            }
+        }
+        return r;
+    }
+
+    RemoteStatus start_recording(const std::string& path) {
+        if (path.empty()) return RemoteStatus::BadRequest;
+        try {
+            recorder = std::make_unique<TelemetryRecorder>(path, options.timestep);
+        } catch (const std::exception& e) {
+            SDL_Log("Remote recording not started: %s", e.what());
+            return RemoteStatus::Failed;
+        }
+        recording_path = path;
+        SDL_Log("Recording to %s", path.c_str());
+        return RemoteStatus::Ok;
+    }
+
+    // Hands sim.pid's gains to every loop that follows the keyboard
+    void apply_gains() {
+        post({SimCommand::SetGains, sim.pid.Kp, sim.pid.Ki, sim.pid.Kd});
+        if (graph) {
+            PID_Controller& c = graph->graph.pid(graph->controller);
+            c.Kp = sim.pid.Kp;
+            c.Ki = sim.pid.Ki;
+            c.Kd = sim.pid.Kd;
+        }
+        if (plane) plane->set_gains(sim.pid.Kp, sim.pid.Ki, sim.pid.Kd);
+        if (rate_loop) {
+            rate_loop->pid.Kp = sim.pid.Kp;
+            rate_loop->pid.Ki = sim.pid.Ki;
+            rate_loop->pid.Kd = sim.pid.Kd;
+        }
+        if (tile_engine) tile_engine->set_gains(0, sim.pid.Kp, sim.pid.Ki, sim.pid.Kd);
+        if (hud) hud->mark_dirty();
+        request_heatmap();
+        request_ghost();
+    }
+
+    // One graph step, mirrored into `sim` so drawing, history, telemetry
+    // and metrics see it like the fixed loop
+    void step_graph(double dt) {
+        ControlGraph& g = graph->graph;
+        g.set_input(graph->setpoint, 0, sim.setpoint);
+        sim.measurement = sim.ball.y + BALL_SIZE/2;
+        g.step();
+        const Ball& b = g.ball(graph->ball);
+        sim.ball.y = b.y;
+        sim.ball.velocity = b.velocity;
+        const PID_Controller& c = g.pid(graph->controller);
+        sim.pid.load_state(c.integral_value(), c.last_error());
+        sim.output = g.value(graph->force);
+        sim.time += dt;
+    }
+
+    // One multi-axis step; axis y stands in for the scalar loop in `sim`
+    void step_plane(double dt) {
+        plane->set_setpoint(MultiAxisPlant::Y, sim.setpoint);
+        sim.measurement = sim.ball.y + BALL_SIZE/2;
+        plane->step(dt);
+        sim.ball.x = plane->position(MultiAxisPlant::X);
+        sim.ball.y = plane->position(MultiAxisPlant::Y);
+        sim.ball.velocity = plane->velocity(MultiAxisPlant::Y);
+        sim.pid.load_state(plane->integral_value(MultiAxisPlant::Y), plane->error(MultiAxisPlant::Y));
+        sim.output = plane->output(MultiAxisPlant::Y);
+        sim.time += dt;
+    }
+
+    // One controller period of the multi-rate loop, mirrored into `sim`
+    void step_multi_rate(double dt) {
+        rate_loop->setpoint = sim.setpoint;
+        rate_loop->advance(rate_loop->schedule().controller_period);
+        sim.ball.y = rate_loop->ball.y;
+        sim.ball.velocity = rate_loop->ball.velocity;
+        sim.measurement = rate_loop->measurement;
+        sim.pid.load_state(rate_loop->pid.integral_value(), rate_loop->pid.last_error());
+        sim.output = rate_loop->output;
+        sim.time += dt;
+    }
+
+    // `n` steps with no input between them. The interactive loop and the
+    // tiles go one step at a time, since the plot and metrics want every
+    // step, but the scene batch takes all n in one LaneStepper::advance,
+    // each cache-sized block of lanes running every step before the next
+    // block, spread over the scene pool when there is one. advance()
+    // returns once every block is done, so the frame draws a finished step.
+    void advance(int n, double dt) {
+        for (int i = 0; i < n; ++i) update_physics(dt);
+        if (collider) {
+            // Contacts couple the lanes, so colliding balls go one step at a
+            // time: the pool finishes the step before the contact pass reads it
+            for (int i = 0; i < n; ++i) {
+                scene_stepper->advance(1, dt, i == n - 1);
+                collide_scene(dt);
+            }
+        } else if (scene_engine) {
+            scene_stepper->advance(static_cast<uint64_t>(n), dt, true);
         }
     }
 
+    // One step of everything but the scene batch, which advance() runs
     void update_physics(double dt) {
-        double force = pid.calculate(setpoint, ball.y + BALL_SIZE/2, dt);
-        ball.update(force, dt);
+        PID_ZONE("update_physics");
+        prev_ball_y = sim.ball.y;
+        prev_ball_x = sim.ball.x;
+        if (graph) step_graph(dt);
+        else if (plane) step_plane(dt);
+        else if (rate_loop) step_multi_rate(dt);
+        else {
+            if (script_player) script_player->apply(script_step++, sim);
+            sim.step(dt);
+        }
+        history.push(sample_of(sim));
+        if (reference_out) reference_out->record(sim.setpoint);
+        if (state_hashes) state_hashes->sample(sim);
+        if (recorder || streamer || shm) {
+            TelemetryRecord r = record_of(sim);
+            if (recorder) recorder->record(r);
+            if (streamer) streamer->record(r);
+            if (shm) shm->record(r);
+        }
+        accumulate(metrics, sim, dt);
+        if (tile_engine) step_tiles(dt);
     }
 
-    void render() {
-        // Clear screen
-        SDL_SetRenderDrawColor(renderer.get(), 240, 240, 240, 255);
-        SDL_RenderClear(renderer.get());
+    // alpha is how far between the last two physics steps the frame falls
+    void render(double ball_y, double setpoint, double alpha = 1.0) {
+        PID_ZONE("render");
+        init_text();
+        if (tile_engine) {
+            // The tiles replace the whole picture, the HUD included
+            draw_tiles(alpha);
+            end_phase(FramePhase::Render);
+            draw_warp();
+            if (show_frame_stats) draw_frame_stats();
+            end_phase(FramePhase::Text);
+            capture_frame();
+            end_phase(FramePhase::Capture);
+            present();
+            return;
+        }
 
-        // Draw setpoint line
-        SDL_SetRenderDrawColor(renderer.get(), 0, 200, 0, 255);
-        SDL_RenderDrawLine(renderer.get(),
-                           0, static_cast<int>(setpoint),
-                           WINDOW_WIDTH, static_cast<int>(setpoint)
-        );
+        // Static content is one opaque copy, repainted only when a target moves
+        int target_y = static_cast<int>(setpoint);
+        int target_x = plane ? static_cast<int>(plane->target(MultiAxisPlant::X)) : -1;
+        if (target_y != background_setpoint || target_x != background_target_x) background->mark_dirty();
+        if (background->is_dirty()) {
+            background->rebuild([&] { paint_background(target_y, target_x); });
+            background_setpoint = target_y;
+            background_target_x = target_x;
+        }
+        background->draw(0, 0);
+
+        if (scene) scene->draw(*scene_engine, scene_stepper->snapshot(), alpha);
+        if (ghost && show_ghost) {
+            // The drawn ball lags sim.time by the unrendered part of the step
+            ghost_view->draw(ghost->latest(), static_cast<float>(sim.ball.x), sim.time - (1.0 - alpha) * options.timestep);
+        }
 
         // Draw ball
-        SDL_SetRenderDrawColor(renderer.get(), 200, 0, 0, 255);
-        SDL_RenderFillRect(renderer.get(), &ball.rect);
+        SDL_SetRenderDrawColor(display.renderer.get(), 200, 0, 0, 255);
+        double ball_x = prev_ball_x + (sim.ball.x - prev_ball_x) * alpha;
+        SDL_FRect ball_rect{static_cast<float>(ball_x), static_cast<float>(ball_y), BALL_SIZE, BALL_SIZE};
+        SDL_RenderFillRectF(display.renderer.get(), &ball_rect);
+
+        if (show_plot && replay) plot->draw(*replay->log, *replay->lod, replay->shown, plot_view, PLOT_AREA);
+        else if (show_plot) plot->draw(history, plot_view, PLOT_AREA);
+        if (heatmap_mode && !replay) {
+            heatmap_view->draw(gain_map->latest(), gain_map->metric(), sim.pid.Kp,
+                               heatmap_mode == 1 ? sim.pid.Kd : sim.pid.Ki,
+                               {WINDOW_WIDTH - 266.0f, WINDOW_HEIGHT - 266.0f, 256.0f, 256.0f});
+        }
+
+        end_phase(FramePhase::Render);
 
         // Render UI text
-        render_text(
-                "Controls:\n"
-                "Mouse Click - Set Target\n"
-                "Up/Down - Kp: " + std::to_string(pid.Kp) + "\n" +
-                "Left/Right - Ki: " + std::to_string(pid.Ki) + "\n" +
-                "PgUp/PgDn - Kd: " + std::to_string(pid.Kd) + "\n" +
-                "R - Reset PID",
-                10, 10
-        );
+        {
+            PID_ZONE("text");
+            if (replay) {
+                PID_ZONE("status_line");
+                glyphs->draw(status_line, 10, 10, {0, 0, 0, 255});
+            } else {
+                {
+                    PID_ZONE("hud");
+                    if (hud->is_dirty()) hud->rebuild(sim.pid.Kp, sim.pid.Ki, sim.pid.Kd, pid_form_name(sim.pid.form()));
+                    hud->draw(10, 10);
+                }
+                if (!physics) draw_metrics(10, 10 + hud->height() + glyphs->line_height() / 2);
+                draw_warp();
+            }
+            if (show_frame_stats) draw_frame_stats();
+        }
+        end_phase(FramePhase::Text);
+
+        capture_frame();
+        end_phase(FramePhase::Capture);
+
+        present();
+    }
 
-        SDL_RenderPresent(renderer.get());
+    void present() {
+        {
+            PID_ZONE("SDL_RenderPresent");
+            SDL_RenderPresent(display.renderer.get());
+        }
+        latency.presented(SDL_GetPerformanceCounter() / perf_frequency);
+        end_phase(FramePhase::Present);
     }
 
-    void render_text(const std::string& text, int x, int y) {
-        SDL_Color black = {0, 0, 0, 255};
-        SDL_Surface* surface = TTF_RenderText_Blended_Wrapped(font.get(), text.c_str(), black, WINDOW_WIDTH);
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer.get(), surface);
+    // Window background: grid every 100 px and the setpoint line(s);
+    // target_x < 0 means no vertical target
+    void paint_background(int target_y, int target_x) {
+        SDL_Renderer* r = display.renderer.get();
+        SDL_SetRenderDrawColor(r, 240, 240, 240, 255);
+        SDL_RenderClear(r);
 
-        SDL_Rect rect{x, y, surface->w, surface->h};
-        SDL_RenderCopy(renderer.get(), texture, nullptr, &rect);
+        SDL_SetRenderDrawColor(r, 225, 225, 225, 255);
+        for (int x = 100; x < WINDOW_WIDTH; x += 100) SDL_RenderDrawLine(r, x, 0, x, WINDOW_HEIGHT);
+        for (int y = 100; y < WINDOW_HEIGHT; y += 100) SDL_RenderDrawLine(r, 0, y, WINDOW_WIDTH, y);
 
-        SDL_FreeSurface(surface);
-        SDL_DestroyTexture(texture);
+        SDL_SetRenderDrawColor(r, 0, 200, 0, 255);
+        SDL_RenderDrawLine(r, 0, target_y, WINDOW_WIDTH, target_y);
+        if (target_x >= 0) SDL_RenderDrawLine(r, target_x, 0, target_x, WINDOW_HEIGHT);
     }
 };
 
-int main() {
+// SDL_game --bench [millions]: time update_physics with no window or rendering
+static int run_bench_mode(int argc, char* argv[]) {
+    double millions = 10.0;
+    if (argc > 2) {
+        char* end = nullptr;
+        millions = std::strtod(argv[2], &end);
+        if (end == argv[2] || *end != '\0' || millions <= 0) {
+            std::fprintf(stderr, "--bench expects a positive step count in millions\n");
+            return 1;
+        }
+    }
+    BenchResult result = run_benchmark(static_cast<uint64_t>(millions * 1e6));
+    print_benchmark(result, stdout);
+    return 0;
+}
+
+// SDL_game --bench-scaling [--csv FILE] [--renderer R]: the whole app, one
+// series per LoadAxis. Each point opens a fresh App (offscreen unless
+// --renderer says otherwise) on a virtual clock at the display rate with
+// no frame cap, so frames run back to back and physics is never shed;
+// after a warm-up it times as many frames as FrameStats keeps.
+static int run_scaling_mode(int argc, char* argv[]) {
+    constexpr uint64_t WARMUP_FRAMES = 60;
+    constexpr uint64_t MEASURED_FRAMES = 240;  // FrameStats' window
+    constexpr double FRAME_TIME = 1.0 / 60.0;
+    std::string csv_path;
+    RenderBackend backend = RenderBackend::Offscreen;
+    for (int i = 2; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--csv") && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--renderer") && i + 1 < argc && parse_render_backend(argv[i + 1], backend)) {
+            ++i;
+        } else {
+            std::fprintf(stderr, "--bench-scaling takes --csv FILE and --renderer auto|gpu|software|offscreen\n");
+            return 1;
+        }
+    }
+
+    std::vector<LoadMeasurement> points;
+    for (const LoadPoint& point : load_scaling_plan()) {
+        AppOptions options;
+        options.render_backend = backend;
+        options.fps = 0.0;
+        switch (point.axis) {
+            case LoadAxis::Balls: options.scene_balls = static_cast<std::size_t>(point.value); break;
+            case LoadAxis::PhysicsHz: options.timestep = 1.0 / point.value; break;
+            case LoadAxis::History: options.history_seconds = point.value; break;
+            case LoadAxis::Tiles:
+                for (int t = 0; t < static_cast<int>(point.value); ++t) {
+                    options.compare.push_back({40.0 + 20.0 * t, 0.5, 10.0 + 2.0 * t});
+                }
+                break;
+            case LoadAxis::Count: break;
+        }
+        // Room for every step a frame owes, so the load is never shed
+        options.max_substeps = static_cast<int>(std::ceil(FRAME_TIME / options.timestep)) + 1;
+
+        LoadMeasurement m;
+        m.point = point;
+        m.frames = MEASURED_FRAMES;
+        m.frame_time = FRAME_TIME;
+        m.physics_hz = 1.0 / options.timestep;
+        m.loops = 1 + options.scene_balls + options.compare.size();
+        {
+            App app(options);
+            for (uint64_t f = 0; f < WARMUP_FRAMES; ++f) app.iterate(FRAME_TIME);
+            AllocationScope allocations;
+            const auto start = std::chrono::steady_clock::now();
+            for (uint64_t f = 0; f < MEASURED_FRAMES; ++f) app.iterate(FRAME_TIME);
+            m.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            m.allocations = allocations.count();
+            m.frame = app.frame_timings().total();
+            m.resident = resident_bytes();
+        }
+        std::fprintf(stderr, "%s %g: %.2fx realtime\n", load_axis_name(point.axis), point.value, m.realtime());
+        points.push_back(m);
+    }
+
+    print_load_scaling(points, stdout);
+    if (!csv_path.empty()) {
+        std::FILE* out = std::fopen(csv_path.c_str(), "w");
+        if (!out) {
+            std::fprintf(stderr, "cannot write %s\n", csv_path.c_str());
+            return 1;
+        }
+        write_load_scaling_csv(points, out);
+        std::fclose(out);
+    }
+    return 0;
+}
+
+static AppOptions parse_app_options(int argc, char* argv[]) {
+    AppOptions options;
+    bool physics_hz = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--max-substeps") && i + 1 < argc) {
+            options.max_substeps = std::atoi(argv[++i]);
+            if (options.max_substeps < 1) throw std::invalid_argument("--max-substeps must be at least 1");
+        } else if (!std::strcmp(argv[i], "--physics-hz") && i + 1 < argc) {
+            double hz = std::atof(argv[++i]);
+            if (hz <= 0) throw std::invalid_argument("--physics-hz must be positive");
+            options.timestep = 1.0 / hz;
+            physics_hz = true;
+        } else if (!std::strcmp(argv[i], "--config") && i + 1 < argc) {
+            options.config_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--fps") && i + 1 < argc) {
+            const char* value = argv[++i];
+            options.fps = std::strcmp(value, "auto") ? std::atof(value) : -1.0;
+            if (options.fps < 0 && std::strcmp(value, "auto")) {
+                throw std::invalid_argument("--fps takes a rate, 0 (off) or auto");
+            }
+        } else if (!std::strcmp(argv[i], "--warp") && i + 1 < argc) {
+            options.warp = std::atof(argv[++i]);
+            if (!(options.warp >= 0.1 && options.warp <= 100.0)) throw std::invalid_argument("--warp takes 0.1 to 100");
+        } else if (!std::strcmp(argv[i], "--warp-budget") && i + 1 < argc) {
+            options.warp_budget_ms = std::atof(argv[++i]);
+            if (options.warp_budget_ms <= 0) throw std::invalid_argument("--warp-budget must be positive");
+        } else if (!std::strcmp(argv[i], "--frame-time") && i + 1 < argc) {
+            options.frame_time = std::atof(argv[++i]);
+            if (!(options.frame_time > 0.0)) throw std::invalid_argument("--frame-time must be positive");
+        } else if (!std::strcmp(argv[i], "--frames") && i + 1 < argc) {
+            long long n = std::atoll(argv[++i]);
+            if (n <= 0) throw std::invalid_argument("--frames must be positive");
+            options.max_frames = static_cast<uint64_t>(n);
+        } else if (!std::strcmp(argv[i], "--physics-thread")) {
+            options.physics_thread = true;
+        } else if (!std::strcmp(argv[i], "--rt-cpu") && i + 1 < argc) {
+            options.realtime.cpu = std::atoi(argv[++i]);
+            if (options.realtime.cpu < 0) throw std::invalid_argument("--rt-cpu must not be negative");
+        } else if (!std::strcmp(argv[i], "--rt-priority") && i + 1 < argc) {
+            options.realtime.priority = std::atoi(argv[++i]);
+            if (options.realtime.priority < 1 || options.realtime.priority > 99) {
+                throw std::invalid_argument("--rt-priority takes 1 to 99");
+            }
+        } else if (!std::strcmp(argv[i], "--rt-lock")) {
+            options.realtime.lock_memory = true;
+        } else if (!std::strcmp(argv[i], "--history") && i + 1 < argc) {
+            options.history_seconds = std::atof(argv[++i]);
+            if (options.history_seconds <= 0) throw std::invalid_argument("--history must be positive");
+        } else if (!std::strcmp(argv[i], "--record") && i + 1 < argc) {
+            options.record_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--multi-rate") && i + 1 < argc) {
+            options.rates = parse_multi_rate(argv[++i]);
+            options.multi_rate = true;
+        } else if (!std::strcmp(argv[i], "--record-reference") && i + 1 < argc) {
+            options.reference_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--record-hashes") && i + 1 < argc) {
+            options.hash_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--script") && i + 1 < argc) {
+            options.script_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--hash-every") && i + 1 < argc) {
+            long n = std::atol(argv[++i]);
+            if (n < 1) throw std::invalid_argument("--hash-every takes a positive step count");
+            options.hash_every = static_cast<uint64_t>(n);
+        } else if (!std::strcmp(argv[i], "--udp") && i + 1 < argc) {
+            options.udp_destination = argv[++i];
+        } else if (!std::strcmp(argv[i], "--shm") && i + 1 < argc) {
+            options.shm_name = argv[++i];
+        } else if (!std::strcmp(argv[i], "--control") && i + 1 < argc) {
+            options.control_address = argv[++i];
+        } else if (!std::strcmp(argv[i], "--replay") && i + 1 < argc) {
+            options.replay_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--seek") && i + 1 < argc) {
+            options.replay_start = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--frame-stats") && i + 1 < argc) {
+            options.frame_stats_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--log") && i + 1 < argc) {
+            options.log_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--alloc-check")) {
+            options.alloc_check = true;
+        } else if (!std::strcmp(argv[i], "--idle")) {
+            options.idle = true;
+        } else if (!std::strcmp(argv[i], "--idle-error") && i + 1 < argc) {
+            options.idle_error = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--idle-velocity") && i + 1 < argc) {
+            options.idle_velocity = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--auto-tune")) {
+            options.auto_tune = true;
+        } else if (!std::strcmp(argv[i], "--heatmap")) {
+            options.heatmap = true;
+        } else if (!std::strcmp(argv[i], "--heatmap-metric") && i + 1 < argc) {
+            if (!parse_cost_metric(argv[++i], options.heatmap_metric)) {
+                throw std::invalid_argument("--heatmap-metric takes iae, ise, itae, overshoot or settling");
+            }
+            options.heatmap = true;
+        } else if (!std::strcmp(argv[i], "--graph") && i + 1 < argc) {
+            options.graph = argv[++i];
+            if (options.graph != "single" && options.graph != "cascade") {
+                throw std::invalid_argument("--graph takes single or cascade");
+            }
+        } else if (!std::strcmp(argv[i], "--axes") && i + 1 < argc) {
+            options.axes = std::atoi(argv[++i]);
+            if (options.axes < 1 || options.axes > 2) throw std::invalid_argument("--axes takes 1 or 2");
+        } else if (!std::strcmp(argv[i], "--scene") && i + 1 < argc) {
+            long n = std::atol(argv[++i]);
+            if (n < 0 || n > static_cast<long>(BallScene::MAX_BALLS)) {
+                throw std::invalid_argument("--scene takes 0 to 100000 balls");
+            }
+            options.scene_balls = static_cast<std::size_t>(n);
+        } else if (!std::strcmp(argv[i], "--scene-collide")) {
+            options.scene_collide = true;
+        } else if (!std::strcmp(argv[i], "--sensor-delay") && i + 1 < argc) {
+            int delay = std::atoi(argv[++i]);
+            if (delay < 0 || delay > static_cast<int>(MAX_SENSOR_DELAY)) {
+                throw std::invalid_argument("--sensor-delay takes 0 to 63 steps");
+            }
+            options.sensor.delay_steps = static_cast<unsigned>(delay);
+        } else if (!std::strcmp(argv[i], "--sensor-quantum") && i + 1 < argc) {
+            options.sensor.quantum = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--sensor-noise") && i + 1 < argc) {
+            options.sensor.noise_sigma = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--d-filter") && i + 1 < argc) {
+            options.d_filter = std::atof(argv[++i]);
+            if (!(options.d_filter >= 0.0 && std::isfinite(options.d_filter))) {
+                throw std::invalid_argument("--d-filter takes a time constant >= 0 s");
+            }
+        } else if (!std::strcmp(argv[i], "--d-on-measurement")) {
+            options.d_on_measurement = true;
+        } else if (!std::strcmp(argv[i], "--feed-forward") && i + 1 < argc) {
+            ++i;
+            options.compensation.feed_forward = !std::strcmp(argv[i], "gravity") ? GRAVITY : std::atof(argv[i]);
+            if (!std::isfinite(options.compensation.feed_forward)) {
+                throw std::invalid_argument("--feed-forward takes a force in px/s^2 or gravity");
+            }
+        } else if (!std::strcmp(argv[i], "--observer") && i + 1 < argc) {
+            options.compensation.observer = true;
+            options.compensation.observer_filter = std::atof(argv[++i]);
+            if (!(options.compensation.observer_filter >= 0.0 && std::isfinite(options.compensation.observer_filter))) {
+                throw std::invalid_argument("--observer takes a time constant >= 0 s");
+            }
+        } else if (!std::strcmp(argv[i], "--compute-delay") && i + 1 < argc) {
+            char* end = nullptr;
+            long lo = std::strtol(argv[++i], &end, 10), hi = lo;
+            if (*end == ':') hi = std::strtol(end + 1, &end, 10);
+            if (*end != '\0' || lo < 0 || hi < lo || hi > static_cast<long>(MAX_COMPUTE_DELAY)) {
+                throw std::invalid_argument("--compute-delay takes A[:B] steps, 0 <= A <= B <= 63");
+            }
+            options.timing.delay_min = static_cast<unsigned>(lo);
+            options.timing.delay_max = static_cast<unsigned>(hi);
+        } else if (!std::strcmp(argv[i], "--compute-tail") && i + 1 < argc) {
+            options.timing.jitter = ComputeTimingModel::Jitter::Exponential;
+            options.timing.delay_mean = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--compute-miss") && i + 1 < argc) {
+            options.timing.miss_probability = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--compare") && i + 1 < argc) {
+            std::array<double, 3> gains{};
+            const char* value = argv[++i];
+            char* end = nullptr;
+            for (int g = 0; g < 3; ++g) {
+                gains[g] = std::strtod(value, &end);
+                if (end == value || (g < 2 && *end != ',') || (g == 2 && *end != '\0')) {
+                    throw std::invalid_argument(std::string("--compare takes KP,KI,KD: ") + argv[i]);
+                }
+                value = end + 1;
+            }
+            options.compare.push_back(gains);
+            if (options.compare.size() >= TileView::MAX_TILES) throw std::invalid_argument("--compare takes up to 15 gain sets");
+        } else if (!std::strcmp(argv[i], "--renderer") && i + 1 < argc) {
+            if (!parse_render_backend(argv[++i], options.render_backend)) {
+                throw std::invalid_argument("--renderer takes auto, gpu, software or offscreen");
+            }
+        } else if (!std::strcmp(argv[i], "--capture") && i + 1 < argc) {
+            options.capture_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--capture-fps") && i + 1 < argc) {
+            options.capture_fps = std::atof(argv[++i]);
+            if (options.capture_fps <= 0) throw std::invalid_argument("--capture-fps must be positive");
+        } else {
+            throw std::invalid_argument(std::string("unknown option ") + argv[i]);
+        }
+    }
+    if (options.scene_balls > 0 && (options.physics_thread || !options.replay_path.empty() || options.idle)) {
+        throw std::invalid_argument("--scene runs only in the default single-thread loop");
+    }
+    if (options.scene_collide && options.scene_balls == 0) throw std::invalid_argument("--scene-collide applies to --scene");
+    if (!options.graph.empty() && (options.physics_thread || !options.replay_path.empty())) {
+        throw std::invalid_argument("--graph runs only in the default single-thread loop");
+    }
+    if (options.axes > 1 && (options.physics_thread || !options.replay_path.empty() || options.idle ||
+                             !options.graph.empty())) {
+        throw std::invalid_argument("--axes runs only in the default single-thread loop, without --idle or --graph");
+    }
+    if (!options.compare.empty() && (options.physics_thread || !options.replay_path.empty() || options.idle ||
+                                     options.scene_balls > 0 || !options.graph.empty() || options.axes > 1 ||
+                                     options.heatmap)) {
+        throw std::invalid_argument("--compare runs only in the default single-thread loop, on its own");
+    }
+    if (options.warp != 1.0 && (options.physics_thread || !options.replay_path.empty())) {
+        throw std::invalid_argument("--warp applies to the default single-thread loop; replays have their own speed keys");
+    }
+    if ((options.frame_time > 0.0 || options.max_frames) && (options.physics_thread || !options.replay_path.empty())) {
+        throw std::invalid_argument("--frame-time and --frames drive the default single-thread loop");
+    }
+    if (!options.reference_path.empty() && (options.physics_thread || !options.replay_path.empty())) {
+        throw std::invalid_argument("--record-reference runs in the default single-thread loop; "
+                                    "with --physics-thread, --record a telemetry log instead");
+    }
+    if (!options.script_path.empty() && (options.physics_thread || !options.replay_path.empty() ||
+                                         !options.graph.empty() || options.axes > 1 || options.multi_rate)) {
+        throw std::invalid_argument("--script drives the default single-thread loop");
+    }
+    if (!options.hash_path.empty() && (options.physics_thread || !options.replay_path.empty() ||
+                                       !options.graph.empty() || options.axes > 1 || options.multi_rate)) {
+        throw std::invalid_argument("--record-hashes runs in the default single-thread loop");
+    }
+    if (!options.config_path.empty()) {
+        // --scene and --compare lanes step the compiled plant; the file's
+        // would apply to the interactive ball alone
+        if (options.scene_balls > 0 || !options.compare.empty()) {
+            throw std::invalid_argument("--config applies to the interactive loop; drop --scene and --compare");
+        }
+        options.config = AppConfig::load(options.config_path);
+        // --physics-hz on the command line wins over the file's timestep
+        if (!physics_hz) options.timestep = options.config.timestep;
+    }
+    if (options.multi_rate) {
+        if (options.physics_thread || !options.replay_path.empty() || !options.graph.empty() || options.axes > 1 ||
+            !options.compare.empty()) {
+            throw std::invalid_argument("--multi-rate runs only in the default single-thread loop, without --graph, "
+                                        "--axes or --compare");
+        }
+        RateSchedule::compile(options.rates);
+        options.timestep = 1.0 / options.rates.controller_hz;
+    }
+    if (options.auto_tune && !options.replay_path.empty()) throw std::invalid_argument("--auto-tune needs a live loop");
+    options.sensor.validate();
+    if (!options.sensor.ideal() && (!options.graph.empty() || options.axes > 1 || !options.replay_path.empty())) {
+        throw std::invalid_argument("--sensor-* options apply to the plain vertical loop");
+    }
+    if ((options.d_filter > 0.0 || options.d_on_measurement) &&
+        (!options.graph.empty() || options.axes > 1 || !options.replay_path.empty() || !options.compare.empty())) {
+        throw std::invalid_argument("--d-filter and --d-on-measurement apply to the plain vertical loop");
+    }
+    if (options.compensation.any() &&
+        (!options.graph.empty() || options.axes > 1 || !options.replay_path.empty() || !options.compare.empty())) {
+        throw std::invalid_argument("--feed-forward and --observer apply to the plain vertical loop");
+    }
+    options.timing.validate();
+    if (!options.timing.ideal() && (!options.graph.empty() || options.axes > 1 || !options.replay_path.empty() ||
+                                    options.multi_rate)) {
+        throw std::invalid_argument("--compute-* options apply to the plain vertical loop");
+    }
+    if (options.realtime.any() && !options.physics_thread) {
+        throw std::invalid_argument("--rt-cpu, --rt-priority and --rt-lock need --physics-thread");
+    }
+    return options;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && !std::strcmp(argv[1], "--bench")) {
+        return run_bench_mode(argc, argv);
+    }
+    if (argc > 1 && !std::strcmp(argv[1], "--bench-scaling")) {
+        try {
+            return run_scaling_mode(argc, argv);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "SDL_game: %s\n", e.what());
+            return 1;
+        }
+    }
+
     try {
-        App app;
+        AppOptions options = parse_app_options(argc, argv);
+#ifdef __EMSCRIPTEN__
+        // The browser owns the loop: it calls back once per animation frame
+        // and main must return to it. The app outlives main on purpose.
+        static std::unique_ptr<App> app;
+        app = std::make_unique<App>(options);
+        emscripten_set_main_loop_arg([](void* arg) {
+            App& a = *static_cast<App*>(arg);
+            if (!a.iterate(a.host_frame_time())) {
+                a.finish();
+                emscripten_cancel_main_loop();
+            }
+        }, app.get(), 0, false);
+        return 0;
+#else
+        App app(options);
         app.run();
+        if (options.alloc_check) {
+            std::printf("allocations: %llu of %llu idle frames after warm-up allocated%s\n",
+                        static_cast<unsigned long long>(app.allocating_frames()),
+                        static_cast<unsigned long long>(app.idle_frames()),
+                        allocation_counting_enabled() ? "" : " (counter disabled)");
+            if (app.allocating_frames() > 0) return 2;
+        }
+#endif
     } catch (const std::exception& e) {
+        // stderr too: without a display the message box cannot appear
+        std::fprintf(stderr, "SDL_game: %s\n", e.what());
         SDL_ShowSimpleMessageBox(
                 SDL_MESSAGEBOX_ERROR,
                 "Error",
@@ -0,0 +1,207 @@
+// Python bindings (pybind11) for the headless loop, the batched engine and
+// the gain sweep. Engine state is exposed as NumPy views over the engine's
+// own arrays, and results are handed over without copying: the array owns
+// the C++ buffer through a capsule. Anything that steps releases the GIL.
+#include "core/batch_engine.h"
+#include "core/simulation.h"
+#include "core/sweep.h"
+#include "core/thread_pool.h"
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace {
+
+// NumPy array that takes ownership of `data`; freed together with the array
+template <class T>
+py::array_t<T> adopt(std::vector<T>&& data, std::vector<py::ssize_t> shape) {
+    auto* owned = new std::vector<T>(std::move(data));
+    py::capsule free_when_done(owned, [](void* p) { delete static_cast<std::vector<T>*>(p); });
+    return py::array_t<T>(shape, owned->data(), free_when_done);
+}
+
+// Writable 1-D view of one engine lane array; `owner` keeps the engine alive
+py::array_t<double> lane_view(BatchEngine& engine, FirstTouchVector<double>& lanes, py::handle owner) {
+    return py::array_t<double>({static_cast<py::ssize_t>(engine.size())}, {sizeof(double)}, lanes.data(), owner);
+}
+
+void check_lane(const BatchEngine& engine, std::size_t lane) {
+    if (lane >= engine.size()) throw py::index_error("lane out of range");
+}
+
+GainRange to_range(const std::tuple<double, double, std::size_t>& t) {
+    GainRange r{std::get<0>(t), std::get<1>(t), std::get<2>(t)};
+    if (r.count == 0) throw std::invalid_argument("a gain range needs at least one value");
+    return r;
+}
+
+} // namespace
+
+PYBIND11_MODULE(pidsim, m) {
+    m.doc() = "PID ball simulator: scalar loop, batched SoA engine and gain sweeps";
+    PYBIND11_NUMPY_DTYPE(LoopMetrics, iae, ise, itae, effort, overshoot, rise_time, settling_time, elapsed);
+    m.attr("FIXED_TIMESTEP") = FIXED_TIMESTEP;
+    m.attr("WINDOW_HEIGHT") = WINDOW_HEIGHT;
+
+    py::class_<Simulation>(m, "Simulation")
+            .def(py::init([](double kp, double ki, double kd, double setpoint) {
+                     Simulation sim;
+                     sim.pid = PID_Controller(kp, ki, kd);
+                     sim.setpoint = setpoint;
+                     return sim;
+                 }),
+                 py::arg("kp") = 80.0, py::arg("ki") = 0.0, py::arg("kd") = 0.0,
+                 py::arg("setpoint") = WINDOW_HEIGHT / 2.0)
+            .def_property("kp", [](const Simulation& s) { return s.pid.Kp; }, [](Simulation& s, double v) { s.pid.Kp = v; })
+            .def_property("ki", [](const Simulation& s) { return s.pid.Ki; }, [](Simulation& s, double v) { s.pid.Ki = v; })
+            .def_property("kd", [](const Simulation& s) { return s.pid.Kd; }, [](Simulation& s, double v) { s.pid.Kd = v; })
+            .def_readwrite("setpoint", &Simulation::setpoint)
+            .def_property("y", [](const Simulation& s) { return s.ball.y; }, [](Simulation& s, double v) { s.ball.y = v; })
+            .def_property("velocity", [](const Simulation& s) { return s.ball.velocity; },
+                          [](Simulation& s, double v) { s.ball.velocity = v; })
+            .def_readonly("output", &Simulation::output)
+            .def_readonly("time", &Simulation::time)
+            .def("step", [](Simulation& s, double dt) { s.step(dt); }, py::arg("dt") = FIXED_TIMESTEP)
+            .def("run", [](Simulation& s, uint64_t steps, double dt) {
+                     py::gil_scoped_release release;
+                     return run_headless(s, steps, dt).seconds;
+                 },
+                 py::arg("steps"), py::arg("dt") = FIXED_TIMESTEP,
+                 "Steps back-to-back without the GIL; returns wall seconds")
+            .def("trajectory", [](Simulation& s, uint64_t steps, double dt) {
+                     std::vector<double> y(steps);
+                     {
+                         py::gil_scoped_release release;
+                         for (uint64_t i = 0; i < steps; ++i) {
+                             s.step(dt);
+                             y[i] = s.ball.y;
+                         }
+                     }
+                     return adopt(std::move(y), {static_cast<py::ssize_t>(steps)});
+                 },
+                 py::arg("steps"), py::arg("dt") = FIXED_TIMESTEP,
+                 "Steps and returns ball.y after each step as a float64 array");
+
+    py::class_<BatchEngine>(m, "BatchEngine")
+            .def(py::init<std::size_t>(), py::arg("lanes"))
+            .def("__len__", &BatchEngine::size)
+            .def_property_readonly("isa", &BatchEngine::isa)
+            .def("set_gains", [](BatchEngine& e, std::size_t lane, double kp, double ki, double kd) {
+                     check_lane(e, lane);
+                     e.set_gains(lane, kp, ki, kd);
+                 },
+                 py::arg("lane"), py::arg("kp"), py::arg("ki"), py::arg("kd"))
+            .def("set_setpoint", [](BatchEngine& e, std::size_t lane, double setpoint) {
+                     check_lane(e, lane);
+                     e.set_setpoint(lane, setpoint);
+                 },
+                 py::arg("lane"), py::arg("setpoint"))
+            .def("reset_lane", [](BatchEngine& e, std::size_t lane) {
+                     check_lane(e, lane);
+                     e.reset_lane(lane);
+                 },
+                 py::arg("lane"))
+            // Views share memory with the engine: writes from NumPy change the next step
+            .def_property_readonly("kp", [](py::object self) {
+                BatchEngine& e = self.cast<BatchEngine&>();
+                return lane_view(e, e.kp, self);
+            })
+            .def_property_readonly("ki", [](py::object self) {
+                BatchEngine& e = self.cast<BatchEngine&>();
+                return lane_view(e, e.ki, self);
+            })
+            .def_property_readonly("kd", [](py::object self) {
+                BatchEngine& e = self.cast<BatchEngine&>();
+                return lane_view(e, e.kd, self);
+            })
+            .def_property_readonly("setpoint", [](py::object self) {
+                BatchEngine& e = self.cast<BatchEngine&>();
+                return lane_view(e, e.setpoint, self);
+            })
+            .def_property_readonly("integral", [](py::object self) {
+                BatchEngine& e = self.cast<BatchEngine&>();
+                return lane_view(e, e.integral, self);
+            })
+            .def_property_readonly("prev_error", [](py::object self) {
+                BatchEngine& e = self.cast<BatchEngine&>();
+                return lane_view(e, e.prev_error, self);
+            })
+            .def_property_readonly("y", [](py::object self) {
+                BatchEngine& e = self.cast<BatchEngine&>();
+                return lane_view(e, e.y, self);
+            })
+            .def_property_readonly("velocity", [](py::object self) {
+                BatchEngine& e = self.cast<BatchEngine&>();
+                return lane_view(e, e.velocity, self);
+            })
+            .def("step", [](BatchEngine& e, double dt) {
+                     py::gil_scoped_release release;
+                     e.step(dt);
+                 },
+                 py::arg("dt") = FIXED_TIMESTEP)
+            .def("run", [](BatchEngine& e, uint64_t steps, double dt) {
+                     py::gil_scoped_release release;
+                     e.run(steps, dt);
+                 },
+                 py::arg("steps"), py::arg("dt") = FIXED_TIMESTEP)
+            .def("record", [](BatchEngine& e, uint64_t steps, double dt) {
+                     // Written straight into the returned array, one row per step
+                     py::array_t<double> out({static_cast<py::ssize_t>(steps), static_cast<py::ssize_t>(e.size())});
+                     double* rows = out.mutable_data();
+                     {
+                         py::gil_scoped_release release;
+                         for (uint64_t s = 0; s < steps; ++s) {
+                             e.step(dt);
+                             std::copy_n(e.y.data(), e.size(), rows + s * e.size());
+                         }
+                     }
+                     return out;
+                 },
+                 py::arg("steps"), py::arg("dt") = FIXED_TIMESTEP,
+                 "Steps and returns ball.y of every lane after each step, shape (steps, lanes)");
+
+    m.def("sweep", [](std::tuple<double, double, std::size_t> kp, std::tuple<double, double, std::size_t> ki,
+                      std::tuple<double, double, std::size_t> kd, double setpoint, uint64_t steps, double dt,
+                      unsigned threads, bool metrics) {
+              SweepConfig config;
+              config.kp = to_range(kp);
+              config.ki = to_range(ki);
+              config.kd = to_range(kd);
+              config.setpoint = setpoint;
+              config.steps = steps;
+              config.dt = dt;
+              config.metrics = metrics;
+
+              SweepResult result;
+              {
+                  py::gil_scoped_release release;
+                  ThreadPool pool(threads);
+                  result = run_sweep(pool, config);
+              }
+              double best_kp, best_ki, best_kd;
+              result.gains(result.best(), best_kp, best_ki, best_kd);
+              std::vector<py::ssize_t> shape{static_cast<py::ssize_t>(config.kp.count),
+                                             static_cast<py::ssize_t>(config.ki.count),
+                                             static_cast<py::ssize_t>(config.kd.count)};
+              py::dict out;
+              out["best"] = py::make_tuple(best_kp, best_ki, best_kd);
+              out["cost"] = adopt(std::move(result.cost), shape);
+              if (metrics) out["metrics"] = adopt(std::move(result.metrics), shape);
+              return out;
+          },
+          py::arg("kp"), py::arg("ki") = std::make_tuple(0.0, 0.0, std::size_t(1)),
+          py::arg("kd") = std::make_tuple(0.0, 0.0, std::size_t(1)), py::arg("setpoint") = WINDOW_HEIGHT / 2.0,
+          py::arg("steps") = 600, py::arg("dt") = FIXED_TIMESTEP, py::arg("threads") = 0, py::arg("metrics") = false,
+          "Grid-sweeps (min, max, count) gain ranges on all cores without the GIL. Returns a dict with "
+          "'best' gains, the IAE 'cost' array of shape (kp, ki, kd) and, with metrics=True, a structured "
+          "'metrics' array of the same shape");
+}
@@ -0,0 +1,75 @@
+// Command-line client for SDL_game --control: sends one command per
+// argument group and prints each reply, so a test orchestrator can drive a
+// fleet of simulators from a shell script.
+//
+//   pid_remote 127.0.0.1:7000 gains 300 2 20 setpoint 240 reset query
+#include "core/remote_control.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+double number(int& i, int argc, char* argv[]) {
+    if (i + 1 >= argc) throw std::invalid_argument(std::string(argv[i]) + " needs a value");
+    char* end = nullptr;
+    double v = std::strtod(argv[++i], &end);
+    if (*end) throw std::invalid_argument(std::string("not a number: ") + argv[i]);
+    return v;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::printf("Usage: pid_remote HOST:PORT COMMAND...\n"
+                    "  setpoint Y | gains KP KI KD | reset | record [PATH] | stop-record | query\n");
+        return 1;
+    }
+    try {
+        RemoteClient client(argv[1]);
+        int failures = 0;
+        for (int i = 2; i < argc; ++i) {
+            const char* cmd = argv[i];
+            double values[REMOTE_QUERY_VALUES];
+            std::size_t count = 0;
+            RemoteStatus status;
+            if (!std::strcmp(cmd, "setpoint")) {
+                double y = number(i, argc, argv);
+                status = client.call(RemoteOp::SetSetpoint, &y, sizeof(y));
+            } else if (!std::strcmp(cmd, "gains")) {
+                double gains[3];
+                for (double& g : gains) g = number(i, argc, argv);
+                status = client.call(RemoteOp::SetGains, gains, sizeof(gains));
+            } else if (!std::strcmp(cmd, "reset")) {
+                status = client.call(RemoteOp::ResetPid, nullptr, 0);
+            } else if (!std::strcmp(cmd, "record")) {
+                // An optional path: anything that is not the next command
+                std::string path = i + 1 < argc && std::strcmp(argv[i + 1], "stop-record") &&
+                                                   std::strcmp(argv[i + 1], "query") ? argv[++i] : "";
+                status = client.call(RemoteOp::StartRecording, path.data(), path.size());
+            } else if (!std::strcmp(cmd, "stop-record")) {
+                status = client.call(RemoteOp::StopRecording, nullptr, 0);
+            } else if (!std::strcmp(cmd, "query")) {
+                status = client.call(RemoteOp::Query, nullptr, 0, values, &count);
+            } else {
+                throw std::invalid_argument(std::string("unknown command ") + cmd);
+            }
+
+            if (status == RemoteStatus::Ok && count == REMOTE_QUERY_VALUES) {
+                std::printf("query        t=%.3f setpoint=%g y=%g Kp=%g Ki=%g Kd=%g recording=%s\n", values[0],
+                            values[1], values[2], values[3], values[4], values[5], values[6] != 0.0 ? "yes" : "no");
+            } else {
+                std::printf("%-12s %s\n", cmd, remote_status_name(status));
+            }
+            if (status != RemoteStatus::Ok) ++failures;
+        }
+        return failures ? 2 : 0;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "pid_remote: %s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,82 @@
+// Stand-in for the rig firmware on a pseudo-terminal, for exercising
+// pid_headless --hil without hardware. Prints the device path to pass to
+// --hil, then answers every command frame by stepping a Ball with the
+// commanded force and replying with the measured position.
+#include "core/hil.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+int main(int argc, char* argv[]) {
+    double dt = FIXED_TIMESTEP;
+    long latency_us = 0;  // added before each reply, to emulate a slow link
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--dt")) dt = std::atof(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--latency-us")) latency_us = std::atol(argv[i + 1]);
+        else {
+            std::printf("Usage: pid_rig_sim [--dt S] [--latency-us US]\n");
+            return 1;
+        }
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        std::perror("pid_rig_sim: pty");
+        return 1;
+    }
+    std::printf("%s\n", ptsname(master));
+    std::fflush(stdout);
+
+    Ball ball;
+    const auto epoch = std::chrono::steady_clock::now();
+    uint8_t rx[256];
+    std::size_t used = 0;
+    uint64_t commands = 0;
+    for (;;) {
+        pollfd p{master, POLLIN, 0};
+        if (::poll(&p, 1, -1) < 0) break;
+        ssize_t n = ::read(master, rx + used, sizeof(rx) - used);
+        if (n <= 0) {
+            // EIO until the host opens the slave side, and again once it hangs up
+            if (commands) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        used += static_cast<std::size_t>(n);
+
+        std::size_t pos = 0;
+        while (used - pos >= HIL_FRAME_SIZE) {
+            HilFrame command;
+            if (!decode_hil_frame(rx + pos, HIL_COMMAND_MAGIC, command)) {
+                ++pos;
+                continue;
+            }
+            pos += HIL_FRAME_SIZE;
+            ++commands;
+            ball.update(command.value, dt);
+            if (latency_us) std::this_thread::sleep_for(std::chrono::microseconds(latency_us));
+
+            HilFrame reply;
+            reply.magic = HIL_MEASUREMENT_MAGIC;
+            reply.sequence = command.sequence;
+            reply.value = static_cast<float>(ball.y + BALL_SIZE / 2);
+            reply.micros = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - epoch).count());
+            uint8_t bytes[HIL_FRAME_SIZE];
+            encode_hil_frame(reply, bytes);
+            if (::write(master, bytes, sizeof(bytes)) != static_cast<ssize_t>(sizeof(bytes))) break;
+        }
+        std::memmove(rx, rx + pos, used - pos);
+        used -= pos;
+    }
+    std::printf("commands     %llu\n", static_cast<unsigned long long>(commands));
+    ::close(master);
+    return 0;
+}
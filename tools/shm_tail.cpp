@@ -0,0 +1,54 @@
+// Minimal reader for SDL_game --shm: prints throughput and the steps it
+// missed once a second, or with --csv every step as a CSV row on stdout
+// for piping into a plotting tool. It only reads the segment, so however
+// slowly it runs, the simulator never waits for it.
+#include "core/shm_telemetry.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+int main(int argc, char* argv[]) {
+    bool csv = argc == 3 && !std::strcmp(argv[2], "--csv");
+    if (argc != 2 && !csv) {
+        std::printf("Usage: pid_shm_tail NAME [--csv]\n");
+        return 1;
+    }
+    try {
+        ShmTelemetryReader reader(argv[1]);
+        if (csv) std::printf("time,setpoint,pv,error,integral,derivative,output,velocity\n");
+        TelemetryRecord batch[256];
+        uint64_t steps = 0;
+        double last_time = 0.0;
+        auto report_at = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (true) {
+            std::size_t n = reader.poll(batch, std::size(batch));
+            for (std::size_t i = 0; csv && i < n; ++i) {
+                const TelemetryRecord& r = batch[i];
+                std::printf("%.6f,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n", r.time, r.setpoint, r.pv, r.error,
+                            r.integral, r.derivative, r.output, r.velocity);
+            }
+            steps += n;
+            if (n) last_time = batch[n - 1].time;
+            if (n == 0) {
+                if (reader.producer_closed()) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (!csv && now >= report_at) {
+                std::printf("t=%.2f s  %llu steps  missed %llu\n", last_time, static_cast<unsigned long long>(steps),
+                            static_cast<unsigned long long>(reader.lost()));
+                std::fflush(stdout);
+                report_at = now + std::chrono::seconds(1);
+            }
+        }
+        std::fprintf(stderr, "pid_shm_tail: producer closed after %llu steps (%llu missed)\n",
+                     static_cast<unsigned long long>(steps), static_cast<unsigned long long>(reader.lost()));
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "pid_shm_tail: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Minimal receiver for SDL_game --udp: prints throughput and loss once a
+// second. Loss in transit shows up as sequence gaps; steps the sender had to
+// drop before they reached the socket are reported by the sender itself.
+#include "core/udp_stream.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using socket_t = SOCKET;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using socket_t = int;
+#endif
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::printf("Usage: pid_udp_listen PORT\n");
+        return 1;
+    }
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+    socket_t s = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(std::atoi(argv[1])));
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::perror("bind");
+        return 1;
+    }
+
+    alignas(8) char packet[2048];
+    uint64_t datagrams = 0, records = 0, lost_datagrams = 0, lost_records = 0;
+    uint64_t next_sequence = 0, next_record = 0, ring_dropped = 0;
+    bool first = true;
+    double last_time = 0.0;
+    auto report_at = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (true) {
+        int n = static_cast<int>(::recv(s, packet, sizeof(packet), 0));
+        if (n < static_cast<int>(sizeof(UdpPacketHeader))) continue;
+        UdpPacketHeader h;
+        std::memcpy(&h, packet, sizeof(h));
+        if (std::memcmp(h.magic, UDP_MAGIC, sizeof(h.magic)) != 0 || h.version != UDP_VERSION ||
+            n != static_cast<int>(sizeof(h) + h.count * sizeof(TelemetryRecord))) {
+            continue;
+        }
+        if (!first && h.sequence > next_sequence) {
+            lost_datagrams += h.sequence - next_sequence;
+            lost_records += h.first_record - next_record;
+        }
+        first = false;
+        next_sequence = h.sequence + 1;
+        next_record = h.first_record + h.count;
+        ring_dropped = h.ring_dropped;
+        ++datagrams;
+        records += h.count;
+        if (h.count) {
+            TelemetryRecord last;
+            std::memcpy(&last, packet + sizeof(h) + (h.count - 1) * sizeof(TelemetryRecord), sizeof(last));
+            last_time = last.time;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= report_at) {
+            std::printf("t=%.2f s  %llu datagrams, %llu steps  lost %llu datagrams / %llu steps  sender dropped %llu\n",
+                        last_time, static_cast<unsigned long long>(datagrams), static_cast<unsigned long long>(records),
+                        static_cast<unsigned long long>(lost_datagrams), static_cast<unsigned long long>(lost_records),
+                        static_cast<unsigned long long>(ring_dropped));
+            std::fflush(stdout);
+            report_at = now + std::chrono::seconds(1);
+        }
+    }
+}